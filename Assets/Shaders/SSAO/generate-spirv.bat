@@ -0,0 +1,14 @@
+glslangvalidator -V Fullscreen.vert -o Fullscreen.vert.spv
+glslangvalidator -V DefferedModel.frag -o DefferedModel.frag.spv
+glslangvalidator -V DefferedMRT.vert -o DefferedMRT.vert.spv 
+glslangvalidator -V DefferedMRT.frag -o DefferedMRT.frag.spv
+glslangvalidator -V DebugQuad.vert -o DebugQuad.vert.spv 
+glslangvalidator -V DebugQuad.frag -o DebugQuad.frag.spv
+glslangvalidator -V DebugNormals.vert -o DebugNormals.vert.spv 
+glslangvalidator -V DebugNormals.geom -o DebugNormals.geom.spv
+glslangvalidator -V DebugNormals.frag -o DebugNormals.frag.spv
+glslangvalidator -V SSAO.frag -o SSAO.frag.spv
+glslangvalidator -V Blur.frag -o Blur.frag.spv
+
+glslangvalidator -V SSAO.comp -o SSAO.comp.spv
+glslangvalidator -V Blur.comp -o Blur.comp.spv
\ No newline at end of file
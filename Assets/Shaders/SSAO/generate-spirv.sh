@@ -0,0 +1,20 @@
+#!/bin/sh
+# Same steps as generate-spirv.bat. Set GLSLANG to use a validator that is not on PATH
+set -e
+cd "$(dirname "$0")"
+GLSLANG=${GLSLANG:-glslangValidator}
+
+$GLSLANG -V Fullscreen.vert -o Fullscreen.vert.spv
+$GLSLANG -V DefferedModel.frag -o DefferedModel.frag.spv
+$GLSLANG -V DefferedMRT.vert -o DefferedMRT.vert.spv
+$GLSLANG -V DefferedMRT.frag -o DefferedMRT.frag.spv
+$GLSLANG -V DebugQuad.vert -o DebugQuad.vert.spv
+$GLSLANG -V DebugQuad.frag -o DebugQuad.frag.spv
+$GLSLANG -V DebugNormals.vert -o DebugNormals.vert.spv
+$GLSLANG -V DebugNormals.geom -o DebugNormals.geom.spv
+$GLSLANG -V DebugNormals.frag -o DebugNormals.frag.spv
+$GLSLANG -V SSAO.frag -o SSAO.frag.spv
+$GLSLANG -V Blur.frag -o Blur.frag.spv
+
+$GLSLANG -V SSAO.comp -o SSAO.comp.spv
+$GLSLANG -V Blur.comp -o Blur.comp.spv
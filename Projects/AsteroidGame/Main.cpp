@@ -26,6 +26,12 @@ int main()
 
 bool GenerateEvents(MSG& msg)
 {
+	//No window to pump messages for, the run ends after its frame count
+	if (g_Renderer.IsHeadless())
+	{
+		return !g_Renderer.IsHeadlessFinished();
+	}
+
 	if (PeekMessage(&msg, NULL, 0, 0, PM_REMOVE))
 	{
 		if (msg.message == WM_QUIT)
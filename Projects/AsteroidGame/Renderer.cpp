@@ -11,14 +11,14 @@
 #include <conio.h>
 
 //Renderer Includes
-#include <Renderer\VKRenderer.h>
-#include <Renderer\Vulkan\VulkanTools.h>
-#include <Renderer\Vulkan\VulkanTextureLoader.h>
-#include <Renderer\Geometry\VertData.h>
+#include <Renderer/VKRenderer.h>
+#include <Renderer/Vulkan/VulkanTools.h>
+#include <Renderer/Vulkan/VulkanTextureLoader.h>
+#include <Renderer/Geometry/VertData.h>
 
 
 //math
-#include <External\glm\glm\gtc\matrix_inverse.hpp>
+#include <External/glm/glm/gtc/matrix_inverse.hpp>
 
 
 
@@ -87,14 +87,9 @@ Renderer::~Renderer()
 	//Destroy texture
 	vkDestroyImageView(m_pWRenderer->m_SwapChain.device, m_VkTexture.view, nullptr);
 	vkDestroyImage(m_pWRenderer->m_SwapChain.device, m_VkTexture.image, nullptr);
-	vkFreeMemory(m_pWRenderer->m_SwapChain.device, m_VkTexture.deviceMemory, nullptr);
+	memoryAllocator->Free(m_VkTexture.allocation);
 	vkDestroySampler(m_pWRenderer->m_SwapChain.device, m_VkTexture.sampler, nullptr);
 
-	//Destroy Shader Module
-	for (int i = 0; i < m_ShaderModules.size(); i++)
-	{
-		vkDestroyShaderModule(m_pWRenderer->m_SwapChain.device, m_ShaderModules[i], nullptr);
-	}
 
 	//Release semaphores
 	vkDestroySemaphore(m_pWRenderer->m_SwapChain.device, Semaphores.presentComplete, nullptr);
@@ -1,16 +1,16 @@
 #pragma once
 
 //Pch files
-#include <RendererPch\stdafx.h>
+#include <RendererPch/stdafx.h>
 
 //Renderer Includes
-#include <Renderer\VKRenderer.h>
-#include <Renderer\Vulkan\VulkanTools.h>
-#include <Renderer\Vulkan\VulkanTextureLoader.h>
+#include <Renderer/VKRenderer.h>
+#include <Renderer/Vulkan/VulkanTools.h>
+#include <Renderer/Vulkan/VulkanTextureLoader.h>
 
 //Vulkan Includes
-#include <Renderer\Vulkan\VkBufferObject.h>
-#include <Renderer\Vulkan\VulkanSwapChain.h>
+#include <Renderer/Vulkan/VkBufferObject.h>
+#include <Renderer/Vulkan/VulkanSwapChain.h>
 
 //forward declaration
 class Camera;
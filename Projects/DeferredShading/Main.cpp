@@ -4,40 +4,51 @@
 *	This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
 */
 
-#include <RendererPch\stdafx.h>
+#include <RendererPch/stdafx.h>
 #include <iomanip>
 #include <random> //std::uniform_real_distribution
 
 //Triangle Includes
 #include "Main.h"
+#if defined(_WIN32)
 #include <conio.h>
+#endif
 
 //Renderer Includes
-#include <Renderer\VKRenderer.h>
-#include <Renderer\Vulkan\VulkanTools.h>
-#include <Renderer\Vulkan\VulkanTextureLoader.h>
+#include <Renderer/VKRenderer.h>
+#include <Renderer/VertexCache.h>
+#include <Renderer/Vulkan/VulkanTools.h>
+#include <Renderer/Vulkan/VulkanTextureLoader.h>
 
 //Model Loader Includes
-#include <Renderer\MeshLoader\Model_local.h>
-#include <Renderer\MeshLoader\ImageManager.h>
-#include <Renderer\MeshLoader\Material.h>
+#include <Renderer/MeshLoader/Model_local.h>
+#include <Renderer/MeshLoader/ImageManager.h>
+#include <Renderer/MeshLoader/Material.h>
 
 //Vulkan Includes
-#include <Renderer\Vulkan\VkBufferObject.h>
-#include <Renderer\Vulkan\VulkanSwapChain.h>
+#include <Renderer/Vulkan/VkBufferObject.h>
+#include <Renderer/Vulkan/VulkanSwapChain.h>
+#include <Renderer/Vulkan/VulkanFrameManager.h>
+#include <Renderer/Vulkan/VulkanDescriptorAllocator.h>
+#include <Renderer/Vulkan/VulkanCommandRecorder.h>
+#include <Renderer/Vulkan/VulkanRenderGraph.h>
+#include <Renderer/Profiler/CpuProfiler.h>
 
 
 //Font Rendering
-#include <Renderer\ThirdParty\FreeType\VkFont.h>
+#include <Renderer/ThirdParty/FreeType/VkFont.h>
 
 
 //math
-#include <External\glm\glm\gtc\matrix_inverse.hpp>
+#include <External/glm/glm/gtc/matrix_inverse.hpp>
 
 //Camera
-#include <Renderer\Camera.h>
+#include <Renderer/Camera.h>
 
-#include <Renderer\ThirdParty\ImGui\imgui.h>
+//Culling
+#include <Renderer/Culling/OcclusionCuller.h>
+
+#include <Renderer/ThirdParty/ImGui/imgui.h>
 
 
 
@@ -128,6 +139,8 @@ VkClearColorValue g_DefaultClearColor = { { 0.5f, 0.5f, 0.5f, 1.0f } };
 
 
 #define VERTEX_BUFFER_BIND_ID 0
+// Surfaces recorded into one secondary command buffer of the G-Buffer pass
+#define GBUFFER_DRAWS_PER_CHUNK 64
 // Set to "true" to enable Vulkan's validation layers
 // See vulkandebug.cpp for details
 #define ENABLE_VALIDATION false
@@ -162,8 +175,10 @@ VkClearColorValue g_DefaultClearColor = { { 0.5f, 0.5f, 0.5f, 1.0f } };
 //====================================================================================
 
 bool GenerateEvents(MSG& msg);
+#if defined(_WIN32)
 void WIN_Sizing(WORD side, RECT *rect);
 LRESULT CALLBACK HandleWindowMessages(HWND hWnd, UINT uMsg, WPARAM wParam, LPARAM lParam);
+#endif
 
 //====================================================================================
 
@@ -180,9 +195,8 @@ private:
 	VkDescriptorSet descriptorSet;
 	VkDescriptorSetLayout descriptorSetLayout;
 
+	//Swap chain acquire and present semaphores belong to frameManager, one pair per frame in flight
 	struct {
-		// Swap chain image presentation
-		VkSemaphore presentComplete;
 		// Command buffer submission and execution
 		VkSemaphore renderComplete;
 		// Text overlay submission and execution
@@ -208,42 +222,21 @@ private:
 	uint32_t numUvs = 0;
 	uint32_t numNormals = 0;
 
-	std::vector<VkBufferObject_s>	listLocalBuffers;
 	std::vector<VkDescriptorSet>	listDescriptros;
-	std::vector<uint32_t>			meshSize;
+	std::vector<uint32_t>			visibleSurfaces;	// surfaces recorded this frame
 
 
 
 
-	// Framebuffer for offscreen rendering
-	struct FrameBufferAttachment {
-		VkImage image;
-		VkDeviceMemory mem;
-		VkImageView view;
-		VkFormat format;
-	};
-	struct OffscreenFrameBuffer
-	{
-		int32_t width, height;
-		VkFramebuffer frameBuffer;
-		FrameBufferAttachment position;
-		FrameBufferAttachment nm; //normal and diffuse
-		FrameBufferAttachment depth;
-		VkRenderPass renderPass;
-	} offScreenFrameBuf;
-
-
-	struct FrameBuffer
+	// G-Buffer targets live in the render graph
+	VulkanRenderGraph*	m_pRenderGraph = nullptr;
+	struct
 	{
-		int32_t width, height;
-		VkFramebuffer frameBuffer;
-		FrameBufferAttachment attachement;
-		VkRenderPass renderPass;
-
-		//vkDestroyImageView(m_pWRenderer->m_SwapChain.device, attachement.view, nullptr);
-		//vkDestroyImage(m_pWRenderer->m_SwapChain.device, attachement.image, nullptr);
-		//vkFreeMemory(m_pWRenderer->m_SwapChain.device, attachement.mem, nullptr);
-	};
+		uint32_t position;
+		uint32_t nm; //normal and diffuse
+		uint32_t depth;
+	} graphImages;
+	uint32_t gbufferPass;
 
 	// One sampler for the frame buffer color attachments
 	VkSampler colorSampler;
@@ -252,7 +245,6 @@ private:
 	{
 		VkTools::UniformData mesh;
 		VkTools::UniformData quad;
-		VkTools::UniformData fsLights;
 		VkTools::UniformData vsFullScreen;
 	}  uniformData;
 
@@ -277,7 +269,6 @@ private:
 	} uboFullScreen;
 
 	VkPipeline			frameBufferPipeline;
-	VkCommandBuffer		GBufferScreenCmdBuffer = VK_NULL_HANDLE;
 	VkPipelineLayout	frameBufferPipelineLayout;
 	VkDescriptorSet		frameBufferDescriptorSet;
 
@@ -294,13 +285,22 @@ private:
 	VkDescriptorSet  quadDescriptorSet;
 	VkDescriptorSet  defferedModelDescriptorSet;
 
+	//Lights change every frame, they are written to vertexCache uniform memory
+	//and selected with a dynamic offset on binding 4
+	vertCacheHandle_t lightsHandle;
+
 
 	struct {
 		glm::mat4 mvp;
 	} quadUniformData;
 
 	RenderModelStatic staticModel;
-	VkCommandBuffer  cmdGui;
+
+	//Occlusion culling. Every surface is occluder and occludee
+	OcclusionCuller				occlusionCuller;
+	std::vector<glm::vec3>		surfaceBoundsMin;
+	std::vector<glm::vec3>		surfaceBoundsMax;
+	std::vector<bool>			surfaceVisible;
 public:
 	Renderer();
 	~Renderer();
@@ -313,7 +313,6 @@ public:
 	void PreparePipeline() override;
 	void SetupDescriptorSet() override;
 	void SetupDescriptorSetLayout() override;
-	void SetupDescriptorPool() override;
 	void LoadAssets() override;
 	void PrepareSemaphore() override;
 	void StartFrame() override;
@@ -323,14 +322,15 @@ public:
 	void ChangeLodBias(float delta);
 	void BeginTextUpdate();
 	void CreateFrameBuffer();
-	void CreateAttachement(VkFormat format, VkImageUsageFlagBits usage, FrameBufferAttachment *attachment, VkCommandBuffer layoutCmd); //Add to TywRendere DLL
 
-	void PrepareFramebufferCommands();
+	void RecordFramebufferCommands(VkCommandBuffer cmdBuffer);
 	void PrepareMainRendererCommands();
+	void BuildMainRendererCommandBuffer(uint32_t i);
 
 	void GenerateQuad();
 	void UpdateQuadUniformData(const glm::vec3& pos = glm::vec3(1.0, 1.0, 0.0));
 	void UpdateUniformBuffersLights();
+	void CullSurfaces();
 	void ImguiRender();
 };
 
@@ -354,49 +354,18 @@ Renderer::~Renderer()
 	staticModel.Clear(m_pWRenderer->m_SwapChain.device);
 
 
-	//Delete memory
-	for (int i = 0; i < listLocalBuffers.size(); i++)
-	{
-		VkBufferObject::DeleteBufferMemory(m_pWRenderer->m_SwapChain.device, listLocalBuffers[i], nullptr);
-	}
-
-
-	//Destroy Shader Module
-	for (int i = 0; i < m_ShaderModules.size(); i++)
-	{
-		vkDestroyShaderModule(m_pWRenderer->m_SwapChain.device, m_ShaderModules[i], nullptr);
-	}
 
 	//Uniform Data
-	vkDestroyBuffer(m_pWRenderer->m_SwapChain.device, uniformData.mesh.buffer, nullptr);
-	vkFreeMemory(m_pWRenderer->m_SwapChain.device, uniformData.mesh.memory, nullptr);
+	VkTools::DestroyUniformData(m_pWRenderer->m_SwapChain.device, uniformData.mesh);
 	VkTools::DestroyUniformData(m_pWRenderer->m_SwapChain.device, uniformData.quad);
-	VkTools::DestroyUniformData(m_pWRenderer->m_SwapChain.device, uniformData.fsLights);
 	VkTools::DestroyUniformData(m_pWRenderer->m_SwapChain.device, uniformData.vsFullScreen);
 
 	//QUad
 	VkBufferObject::DeleteBufferMemory(m_pWRenderer->m_SwapChain.device, quadMesh.vertex, nullptr);
 	VkBufferObject::DeleteBufferMemory(m_pWRenderer->m_SwapChain.device, quadMesh.index, nullptr);
 
-	//Position
-	vkDestroyImageView(m_pWRenderer->m_SwapChain.device, offScreenFrameBuf.position.view, nullptr);
-	vkDestroyImage(m_pWRenderer->m_SwapChain.device, offScreenFrameBuf.position.image, nullptr);
-	vkFreeMemory(m_pWRenderer->m_SwapChain.device, offScreenFrameBuf.position.mem, nullptr);
-
-	//Normal and Diffuse
-	vkDestroyImageView(m_pWRenderer->m_SwapChain.device, offScreenFrameBuf.nm.view, nullptr);
-	vkDestroyImage(m_pWRenderer->m_SwapChain.device, offScreenFrameBuf.nm.image, nullptr);
-	vkFreeMemory(m_pWRenderer->m_SwapChain.device, offScreenFrameBuf.nm.mem, nullptr);
-
-
-	//Depth
-	vkDestroyImageView(m_pWRenderer->m_SwapChain.device, offScreenFrameBuf.depth.view, nullptr);
-	vkDestroyImage(m_pWRenderer->m_SwapChain.device, offScreenFrameBuf.depth.image, nullptr);
-	vkFreeMemory(m_pWRenderer->m_SwapChain.device, offScreenFrameBuf.depth.mem, nullptr);
-
-
-	//Destroy framebuffer
-	vkDestroyFramebuffer(m_pWRenderer->m_SwapChain.device, offScreenFrameBuf.frameBuffer, nullptr);
+	//G-Buffer targets, render pass and framebuffer
+	SAFE_DELETE(m_pRenderGraph);
 
 
 	//Destroy FrameBufferPipeline
@@ -411,16 +380,11 @@ Renderer::~Renderer()
 	//Destroy layout
 	vkDestroyDescriptorSetLayout(m_pWRenderer->m_SwapChain.device, descriptorSetLayout, nullptr);
 
-	//Destroy RenderPass
-	vkDestroyRenderPass(m_pWRenderer->m_SwapChain.device, offScreenFrameBuf.renderPass, nullptr);
-
-	//Destroy Command Buffer and Semaphore
-	vkFreeCommandBuffers(m_pWRenderer->m_SwapChain.device, m_pWRenderer->m_CmdPool, 1, &GBufferScreenCmdBuffer);
+	//Destroy Semaphore
 	vkDestroySemaphore(m_pWRenderer->m_SwapChain.device, Semaphores.defferedSemaphore, nullptr);
 
 
 	//Release semaphores
-	vkDestroySemaphore(m_pWRenderer->m_SwapChain.device, Semaphores.presentComplete, nullptr);
 	vkDestroySemaphore(m_pWRenderer->m_SwapChain.device, Semaphores.renderComplete, nullptr);
 	vkDestroySemaphore(m_pWRenderer->m_SwapChain.device, Semaphores.textOverlayComplete, nullptr);
 }
@@ -429,7 +393,6 @@ void Renderer::PrepareSemaphore()
 {
 	VkSemaphoreCreateInfo semaphoreCreateInfo = VkTools::Initializer::SemaphoreCreateInfo();
 
-	VK_CHECK_RESULT(vkCreateSemaphore(m_pWRenderer->m_SwapChain.device, &semaphoreCreateInfo, nullptr, &Semaphores.presentComplete));
 	VK_CHECK_RESULT(vkCreateSemaphore(m_pWRenderer->m_SwapChain.device, &semaphoreCreateInfo, nullptr, &Semaphores.renderComplete));
 	VK_CHECK_RESULT(vkCreateSemaphore(m_pWRenderer->m_SwapChain.device, &semaphoreCreateInfo, nullptr, &Semaphores.textOverlayComplete));
 	VK_CHECK_RESULT(vkCreateSemaphore(m_pWRenderer->m_SwapChain.device, &semaphoreCreateInfo, nullptr, &Semaphores.defferedSemaphore));
@@ -440,6 +403,62 @@ void Renderer::ImguiRender()
 {
 	ImGui::SetNextWindowSize(ImVec2(200, 100), ImGuiSetCond_FirstUseEver);
 	ImGui::Text("%.3f ms/frame (%.1f FPS)", 1000.0f / ImGui::GetIO().Framerate, ImGui::GetIO().Framerate);
+
+	const OcclusionStats& occlusion = occlusionCuller.GetStats();
+	ImGui::Text("Occluded %u/%u (%.0f%%)", occlusion.numOccludeesCulled, occlusion.numOccludeesTested, occlusion.GetOcclusionRate() * 100.0f);
+	ImGui::Text("Occlusion raster %.3f ms test %.3f ms", occlusion.rasterMilliSec, occlusion.testMilliSec);
+
+	VulkanCommandRecorderStats recorder = m_pCommandRecorder->GetStats();
+	ImGui::Text("G-Buffer %u draws, %u chunks on %u threads %.3f ms", recorder.numDraws, recorder.numChunks, recorder.numThreads, recorder.recordMicroSec / 1000.0f);
+
+	const VulkanRenderGraphStats graphStats = m_pRenderGraph->GetStats();
+	ImGui::Text("Render graph %u barriers, %.1f MB saved", graphStats.numBarriers, graphStats.GetSavedBytes() / (1024.0f * 1024.0f));
+
+	cpuProfiler->DrawImGui();
+}
+
+
+//
+// Renderer::CullSurfaces
+//
+//	Rasterizes every surface instance into occlusion buffer, then tests surface bounds.
+//	G-Buffer commands are recorded every frame, so they pick up the new visibility.
+//
+void Renderer::CullSurfaces()
+{
+	TYW_PROFILE_FUNCTION();
+	if (surfaceVisible.empty())
+		return;
+
+	occlusionCuller.BeginFrame(m_uboVS.projectionMatrix * m_uboVS.viewMatrix);
+
+	const uint32_t numInstances = static_cast<uint32_t>(sizeof(m_uboVS.instancePos) / sizeof(m_uboVS.instancePos[0]));
+	glm::mat4 instanceWorld[numInstances];
+	for (uint32_t k = 0; k < numInstances; k++)
+	{
+		instanceWorld[k] = m_uboVS.modelMatrix * glm::translate(glm::mat4(), glm::vec3(m_uboVS.instancePos[k]));
+	}
+
+	for (size_t i = 0; i < staticModel.surfaces.size(); i++)
+	{
+		const srfTriangles_t* tr = staticModel.surfaces[i].geometry;
+		for (uint32_t k = 0; k < numInstances; k++)
+		{
+			occlusionCuller.RenderOccluder(tr->verts, tr->numVerts, tr->indexes, tr->numIndexes, instanceWorld[k]);
+		}
+	}
+
+	for (size_t i = 0; i < surfaceVisible.size(); i++)
+	{
+		//All instances share one draw call
+		bool bVisible = false;
+		for (uint32_t k = 0; k < numInstances && !bVisible; k++)
+		{
+			bVisible = occlusionCuller.TestAABB(surfaceBoundsMin[i], surfaceBoundsMax[i], instanceWorld[k]);
+		}
+
+		surfaceVisible[i] = bVisible;
+	}
 }
 
 float lerp(float a, float b, float f)
@@ -504,10 +523,7 @@ void Renderer::UpdateUniformBuffersLights()
 	// Current view position
 	uboFragmentLights.viewPos = glm::vec4(m_Camera.position, 0.0f) * glm::vec4(-1.0f, 1.0f, -1.0f, 1.0f);
 
-	uint8_t *pData;
-	VK_CHECK_RESULT(vkMapMemory(m_pWRenderer->m_SwapChain.device, uniformData.fsLights.memory, 0, sizeof(uboFragmentLights), 0, (void **)&pData));
-	memcpy(pData, &uboFragmentLights, sizeof(uboFragmentLights));
-	vkUnmapMemory(m_pWRenderer->m_SwapChain.device, uniformData.fsLights.memory);
+	lightsHandle = vertexCache.AllocUniform(&uboFragmentLights, sizeof(uboFragmentLights));
 }
 
 void Renderer::LoadGUI()
@@ -627,25 +643,14 @@ void Renderer::GenerateQuad()
 		quadMesh.index);
 
 
-	//Create new command buffer
-	VkCommandBuffer copyCmd = GetCommandBuffer(true);
-
-
 	//Submit info to the queue
 	VkBufferObject::SubmitBufferObjects(
-		copyCmd,
-		m_pWRenderer->m_Queue,
-		*m_pWRenderer,
 		static_cast<uint32_t>(sizeof(drawVert) * vertData.size()),
 		staggingBufferVbo,
 		quadMesh.vertex, (drawVertFlags::Vertex | drawVertFlags::Uv | drawVertFlags::Normal));
 
 
-	copyCmd = GetCommandBuffer(true);
 	VkBufferObject::SubmitBufferObjects(
-		copyCmd,
-		m_pWRenderer->m_Queue,
-		*m_pWRenderer,
 		static_cast<uint32_t>(sizeof(uint32_t) * indexBuffer.size()),
 		staggingIndexBufferVbo,
 		quadMesh.index, drawVertFlags::None);
@@ -657,15 +662,23 @@ void Renderer::UpdateQuadUniformData(const glm::vec3& pos)
 	quadUniformData.mvp = mvp;
 
 	// Map uniform buffer and update it
-	uint8_t *pData;
-	VK_CHECK_RESULT(vkMapMemory(m_pWRenderer->m_SwapChain.device, uniformData.quad.memory, 0, sizeof(quadUniformData), 0, (void **)&pData));
-	memcpy(pData, &quadUniformData, sizeof(quadUniformData));
-	vkUnmapMemory(m_pWRenderer->m_SwapChain.device, uniformData.quad.memory);
+	memcpy(uniformData.quad.mapped, &quadUniformData, sizeof(quadUniformData));
 }
 
 
 void Renderer::PrepareMainRendererCommands()
 {
+	for (uint32_t i = 0; i < m_pWRenderer->m_DrawCmdBuffers.size(); ++i)
+	{
+		BuildMainRendererCommandBuffer(i);
+	}
+}
+
+//Records composition for swap chain image i. Redone every frame, lights move to a new uniform offset each frame
+void Renderer::BuildMainRendererCommandBuffer(uint32_t i)
+{
+	const uint32_t lightsOffset = static_cast<uint32_t>(lightsHandle.offset);
+
 	VkCommandBufferBeginInfo cmdBufInfo = {};
 	cmdBufInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
 	cmdBufInfo.pNext = NULL;
@@ -688,329 +701,146 @@ void Renderer::PrepareMainRendererCommands()
 	renderPassBeginInfo.clearValueCount = 2;
 	renderPassBeginInfo.pClearValues = clearValues;
 
-	for (int32_t i = 0; i < m_pWRenderer->m_DrawCmdBuffers.size(); ++i)
-	{
-
-		// Set target frame buffer
-		renderPassBeginInfo.framebuffer = m_pWRenderer->m_FrameBuffers[i];
-
-		VK_CHECK_RESULT(vkBeginCommandBuffer(m_pWRenderer->m_DrawCmdBuffers[i], &cmdBufInfo));
-
-		// Start the first sub pass specified in our default render pass setup by the base class
-		// This will clear the color and depth attachment
-		vkCmdBeginRenderPass(m_pWRenderer->m_DrawCmdBuffers[i], &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
-
-		// Update dynamic viewport state
-		VkViewport viewport = {};
-		viewport.height = (float)g_iDesktopHeight;
-		viewport.width = (float)g_iDesktopWidth;
-		viewport.minDepth = (float) 0.0f;
-		viewport.maxDepth = (float) 1.0f;
-		vkCmdSetViewport(m_pWRenderer->m_DrawCmdBuffers[i], 0, 1, &viewport);
-
-		// Update dynamic scissor state
-		VkRect2D scissor = {};
-		scissor.extent.width = g_iDesktopWidth;
-		scissor.extent.height = g_iDesktopHeight;
-		scissor.offset.x = 0;
-		scissor.offset.y = 0;
-		vkCmdSetScissor(m_pWRenderer->m_DrawCmdBuffers[i], 0, 1, &scissor);
-		VkDeviceSize offsets[1] = { 0 };
-
-		// Final composition as full screen quad
-		{
-			vkCmdBindPipeline(m_pWRenderer->m_DrawCmdBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
-			vkCmdBindDescriptorSets(m_pWRenderer->m_DrawCmdBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &defferedModelDescriptorSet, 0, NULL);
-			vkCmdBindVertexBuffers(m_pWRenderer->m_DrawCmdBuffers[i], VERTEX_BUFFER_BIND_ID, 1, &quadMesh.vertex.buffer, offsets);
-			vkCmdBindIndexBuffer(m_pWRenderer->m_DrawCmdBuffers[i], quadMesh.index.buffer, 0, VK_INDEX_TYPE_UINT32);
-			vkCmdDrawIndexed(m_pWRenderer->m_DrawCmdBuffers[i], 6, 1, 0, 0, 1);
-		}
-
-		//quad debug
-		{
-			vkCmdBindPipeline(m_pWRenderer->m_DrawCmdBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, quadPipeline);
-			vkCmdBindDescriptorSets(m_pWRenderer->m_DrawCmdBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &quadDescriptorSet, 0, NULL);
-			vkCmdBindVertexBuffers(m_pWRenderer->m_DrawCmdBuffers[i], VERTEX_BUFFER_BIND_ID, 1, &quadMesh.vertex.buffer, offsets);
-			vkCmdBindIndexBuffer(m_pWRenderer->m_DrawCmdBuffers[i], quadMesh.index.buffer, 0, VK_INDEX_TYPE_UINT32);
-			vkCmdDrawIndexed(m_pWRenderer->m_DrawCmdBuffers[i], quadMesh.numIndexes, 1, 0, 0, 1);
-
-			//			viewport.x = viewport.width * 0.5f;
-			//			viewport.y = viewport.height * 0.5f;
-			//			vkCmdSetViewport(m_pWRenderer->m_DrawCmdBuffers[i], 0, 1, &viewport);
-		}
-
-		vkCmdEndRenderPass(m_pWRenderer->m_DrawCmdBuffers[i]);
-		VK_CHECK_RESULT(vkEndCommandBuffer(m_pWRenderer->m_DrawCmdBuffers[i]));
-
-	}
-}
+	// Set target frame buffer
+	renderPassBeginInfo.framebuffer = m_pWRenderer->m_FrameBuffers[i];
+
+	VK_CHECK_RESULT(vkBeginCommandBuffer(m_pWRenderer->m_DrawCmdBuffers[i], &cmdBufInfo));
+
+	// Start the first sub pass specified in our default render pass setup by the base class
+	// This will clear the color and depth attachment
+	vkCmdBeginRenderPass(m_pWRenderer->m_DrawCmdBuffers[i], &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
+
+	// Update dynamic viewport state
+	VkViewport viewport = {};
+	viewport.height = (float)g_iDesktopHeight;
+	viewport.width = (float)g_iDesktopWidth;
+	viewport.minDepth = (float) 0.0f;
+	viewport.maxDepth = (float) 1.0f;
+	vkCmdSetViewport(m_pWRenderer->m_DrawCmdBuffers[i], 0, 1, &viewport);
+
+	// Update dynamic scissor state
+	VkRect2D scissor = {};
+	scissor.extent.width = g_iDesktopWidth;
+	scissor.extent.height = g_iDesktopHeight;
+	scissor.offset.x = 0;
+	scissor.offset.y = 0;
+	vkCmdSetScissor(m_pWRenderer->m_DrawCmdBuffers[i], 0, 1, &scissor);
+	VkDeviceSize offsets[1] = { 0 };
 
-void Renderer::PrepareFramebufferCommands()
-{
-	if (GBufferScreenCmdBuffer == VK_NULL_HANDLE)
+	// Final composition as full screen quad
 	{
-		VkCommandBufferAllocateInfo cmdBufAllocateInfo =
-			VkTools::Initializer::CommandBufferAllocateInfo(
-				m_pWRenderer->m_CmdPool,
-				VK_COMMAND_BUFFER_LEVEL_PRIMARY,
-				1);
-
-		VK_CHECK_RESULT(vkAllocateCommandBuffers(m_pWRenderer->m_SwapChain.device, &cmdBufAllocateInfo, &GBufferScreenCmdBuffer));
+		vkCmdBindPipeline(m_pWRenderer->m_DrawCmdBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+		vkCmdBindDescriptorSets(m_pWRenderer->m_DrawCmdBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &defferedModelDescriptorSet, 1, &lightsOffset);
+		vkCmdBindVertexBuffers(m_pWRenderer->m_DrawCmdBuffers[i], VERTEX_BUFFER_BIND_ID, 1, &quadMesh.vertex.buffer, offsets);
+		vkCmdBindIndexBuffer(m_pWRenderer->m_DrawCmdBuffers[i], quadMesh.index.buffer, 0, VK_INDEX_TYPE_UINT32);
+		vkCmdDrawIndexed(m_pWRenderer->m_DrawCmdBuffers[i], 6, 1, 0, 0, 1);
 	}
 
-	VkCommandBufferBeginInfo cmdBufInfo = VkTools::Initializer::CommandBufferBeginInfo();
-
-	std::array<VkClearValue, 3> clearValues;
-	clearValues[0].color = { { 0.0f, 0.0f, 0.0f, 0.0f } };
-	clearValues[1].color = { { 0.0f, 0.0f, 0.0f, 0.0f } };
-	clearValues[2].depthStencil = { 1.0f, 0 };
-
-	VkRenderPassBeginInfo renderPassBeginInfo = VkTools::Initializer::RenderPassBeginInfo();
-	renderPassBeginInfo.renderPass = offScreenFrameBuf.renderPass;
-	renderPassBeginInfo.framebuffer = offScreenFrameBuf.frameBuffer;
-	renderPassBeginInfo.renderArea.offset.x = 0;
-	renderPassBeginInfo.renderArea.offset.y = 0;
-	renderPassBeginInfo.renderArea.extent.width = offScreenFrameBuf.width;
-	renderPassBeginInfo.renderArea.extent.height = offScreenFrameBuf.height;
-	renderPassBeginInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
-	renderPassBeginInfo.pClearValues = clearValues.data();
-
-	VK_CHECK_RESULT(vkBeginCommandBuffer(GBufferScreenCmdBuffer, &cmdBufInfo));
-
-
-	VkViewport viewport = VkTools::Initializer::Viewport((float)offScreenFrameBuf.width, (float)offScreenFrameBuf.height, 0.0f, 1.0f);
-	vkCmdSetViewport(GBufferScreenCmdBuffer, 0, 1, &viewport);
-
-	VkRect2D scissor = VkTools::Initializer::Rect2D(offScreenFrameBuf.width, offScreenFrameBuf.height, 0, 0);
-	vkCmdSetScissor(GBufferScreenCmdBuffer, 0, 1, &scissor);
-
-
-	vkCmdBeginRenderPass(GBufferScreenCmdBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
-	vkCmdBindPipeline(GBufferScreenCmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, frameBufferPipeline);
-
-	// Bind triangle vertex buffer (contains position and colors)
-	VkDeviceSize offsets[1] = { 0 };
-	for (int j = 0; j < listLocalBuffers.size(); j++)
+	//quad debug
 	{
-		// Bind descriptor sets describing shader binding points
-		vkCmdBindDescriptorSets(GBufferScreenCmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, frameBufferPipelineLayout, 0, 1, &listDescriptros[j], 0, NULL);
-
-		//Bind Buffer
-		vkCmdBindVertexBuffers(GBufferScreenCmdBuffer, VERTEX_BUFFER_BIND_ID, 1, &listLocalBuffers[j].buffer, offsets);
-
-		//Draw
-		//vkCmdDrawIndirect(GBufferScreenCmdBuffer, nullptr , 0, 3, 0);
-		vkCmdDraw(GBufferScreenCmdBuffer, meshSize[j], 3, 0, 0);
+		vkCmdBindPipeline(m_pWRenderer->m_DrawCmdBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, quadPipeline);
+		vkCmdBindDescriptorSets(m_pWRenderer->m_DrawCmdBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &quadDescriptorSet, 1, &lightsOffset);
+		vkCmdBindVertexBuffers(m_pWRenderer->m_DrawCmdBuffers[i], VERTEX_BUFFER_BIND_ID, 1, &quadMesh.vertex.buffer, offsets);
+		vkCmdBindIndexBuffer(m_pWRenderer->m_DrawCmdBuffers[i], quadMesh.index.buffer, 0, VK_INDEX_TYPE_UINT32);
+		vkCmdDrawIndexed(m_pWRenderer->m_DrawCmdBuffers[i], quadMesh.numIndexes, 1, 0, 0, 1);
+
+		//			viewport.x = viewport.width * 0.5f;
+		//			viewport.y = viewport.height * 0.5f;
+		//			vkCmdSetViewport(m_pWRenderer->m_DrawCmdBuffers[i], 0, 1, &viewport);
 	}
-	vkCmdEndRenderPass(GBufferScreenCmdBuffer);
-	VK_CHECK_RESULT(vkEndCommandBuffer(GBufferScreenCmdBuffer));
-}
-
 
+	vkCmdEndRenderPass(m_pWRenderer->m_DrawCmdBuffers[i]);
+	VK_CHECK_RESULT(vkEndCommandBuffer(m_pWRenderer->m_DrawCmdBuffers[i]));
+}
 
-void Renderer::CreateAttachement(
-	VkFormat format,
-	VkImageUsageFlagBits usage,
-	FrameBufferAttachment *attachment,
-	VkCommandBuffer layoutCmd)
+void Renderer::RecordFramebufferCommands(VkCommandBuffer cmdBuffer)
 {
-	VkImageAspectFlags aspectMask = 0;
-	VkImageLayout imageLayout;
-	attachment->format = format;
+	TYW_PROFILE_FUNCTION();
+	VkCommandBufferBeginInfo cmdBufInfo = VkTools::Initializer::CommandBufferBeginInfo();
+
+	VK_CHECK_RESULT(vkBeginCommandBuffer(cmdBuffer, &cmdBufInfo));
 
-	if (usage & VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT)
+	// Only visible surfaces are split between the recording threads
+	visibleSurfaces.clear();
+	for (uint32_t j = 0; j < staticModel.surfaces.size(); j++)
 	{
-		aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-		imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+		if (surfaceVisible[j])
+			visibleSurfaces.push_back(j);
 	}
-	if (usage & VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT)
+
+	if (!m_pRenderGraph->BeginPass(cmdBuffer, gbufferPass, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS))
 	{
-		aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT;
-		imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+		VK_CHECK_RESULT(vkEndCommandBuffer(cmdBuffer));
+		return;
 	}
 
+	const VkExtent2D extent = m_pRenderGraph->GetExtent(gbufferPass);
+	m_pCommandRecorder->Record(cmdBuffer, m_pRenderGraph->GetRenderPass(gbufferPass), 0, m_pRenderGraph->GetFramebuffer(gbufferPass),
+		static_cast<uint32_t>(visibleSurfaces.size()), GBUFFER_DRAWS_PER_CHUNK, [this, extent](VkCommandBuffer secondary, uint32_t first, uint32_t last)
+	{
+		// Secondary command buffers do not inherit any state
+		VkViewport viewport = VkTools::Initializer::Viewport((float)extent.width, (float)extent.height, 0.0f, 1.0f);
+		vkCmdSetViewport(secondary, 0, 1, &viewport);
 
-	assert(aspectMask > 0);
-
-	VkImageCreateInfo image = VkTools::Initializer::ImageCreateInfo();
-	image.imageType = VK_IMAGE_TYPE_2D;
-	image.format = format;
-	image.extent.width = offScreenFrameBuf.width;
-	image.extent.height = offScreenFrameBuf.height;
-	image.extent.depth = 1;
-	image.mipLevels = 1;
-	image.arrayLayers = 1;
-	image.samples = VK_SAMPLE_COUNT_1_BIT;
-	image.tiling = VK_IMAGE_TILING_OPTIMAL;
-	image.usage = usage | VK_IMAGE_USAGE_SAMPLED_BIT;
-
-	VkMemoryAllocateInfo memAlloc = VkTools::Initializer::MemoryAllocateInfo();
-	VkMemoryRequirements memReqs;
-
-	VK_CHECK_RESULT(vkCreateImage(m_pWRenderer->m_SwapChain.device, &image, nullptr, &attachment->image));
-	vkGetImageMemoryRequirements(m_pWRenderer->m_SwapChain.device, attachment->image, &memReqs);
-	memAlloc.allocationSize = memReqs.size;
-	memAlloc.memoryTypeIndex = VkTools::GetMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_pWRenderer->m_DeviceMemoryProperties);
-
-	VK_CHECK_RESULT(vkAllocateMemory(m_pWRenderer->m_SwapChain.device, &memAlloc, nullptr, &attachment->mem));
-	VK_CHECK_RESULT(vkBindImageMemory(m_pWRenderer->m_SwapChain.device, attachment->image, attachment->mem, 0));
-
-	VkImageViewCreateInfo imageView = VkTools::Initializer::ImageViewCreateInfo();
-	imageView.viewType = VK_IMAGE_VIEW_TYPE_2D;
-	imageView.format = format;
-	imageView.subresourceRange = {};
-	imageView.subresourceRange.aspectMask = aspectMask;
-	imageView.subresourceRange.baseMipLevel = 0;
-	imageView.subresourceRange.levelCount = 1;
-	imageView.subresourceRange.baseArrayLayer = 0;
-	imageView.subresourceRange.layerCount = 1;
-	imageView.image = attachment->image;
-	VK_CHECK_RESULT(vkCreateImageView(m_pWRenderer->m_SwapChain.device, &imageView, nullptr, &attachment->view));
-}
+		VkRect2D scissor = VkTools::Initializer::Rect2D(extent.width, extent.height, 0, 0);
+		vkCmdSetScissor(secondary, 0, 1, &scissor);
 
+		vkCmdBindPipeline(secondary, VK_PIPELINE_BIND_POINT_GRAPHICS, frameBufferPipeline);
 
-void Renderer::CreateFrameBuffer()
-{
+		//G-Buffer shaders do not read lights, but the shared layout has a dynamic binding that needs an offset
+		const uint32_t unusedLightsOffset = 0;
 
-	//Create command buffer
-	VkCommandBuffer layoutCmd;
-	VkCommandBufferAllocateInfo cmdBufAllocateInfo =
-		VkTools::Initializer::CommandBufferAllocateInfo(
-			m_pWRenderer->m_CmdPool,
-			VK_COMMAND_BUFFER_LEVEL_PRIMARY,
-			1);
-
-	VK_CHECK_RESULT(vkAllocateCommandBuffers(m_pWRenderer->m_SwapChain.device, &cmdBufAllocateInfo, &layoutCmd));
-
-	VkCommandBufferBeginInfo cmdBufInfo = VkTools::Initializer::CommandBufferBeginInfo();
-
-	//Command buffer created and started
-	VK_CHECK_RESULT(vkBeginCommandBuffer(layoutCmd, &cmdBufInfo));
+		// All surfaces share one vertex and index buffer
+		staticModel.BindBuffers(secondary, VERTEX_BUFFER_BIND_ID);
+		for (uint32_t k = first; k < last; k++)
+		{
+			const uint32_t j = visibleSurfaces[k];
 
-	//Set framebuffer sizes
-	offScreenFrameBuf.width = GBUFF_DIM;
-	offScreenFrameBuf.height = GBUFF_DIM;
+			// Bind descriptor sets describing shader binding points
+			vkCmdBindDescriptorSets(secondary, VK_PIPELINE_BIND_POINT_GRAPHICS, frameBufferPipelineLayout, 0, 1, &listDescriptros[j], 1, &unusedLightsOffset);
 
+			//Draw
+			const modelSurface_t& surf = staticModel.surfaces[j];
+			vkCmdDrawIndexed(secondary, surf.indexCount, 3, surf.firstIndex, surf.vertexOffset, 0);
+		}
+	});
+	m_pRenderGraph->EndPass(cmdBuffer, gbufferPass);
+	VK_CHECK_RESULT(vkEndCommandBuffer(cmdBuffer));
+}
 
-	//Normal, Diffuse, Depth - Packed
-	CreateAttachement(VK_FORMAT_R32G32B32A32_UINT,
-		VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
-		&offScreenFrameBuf.nm,
-		layoutCmd);
 
-	//Position, Specular - Packed
-	CreateAttachement(VK_FORMAT_R32G32B32A32_UINT,
-		VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
-		&offScreenFrameBuf.position,
-		layoutCmd);
 
+void Renderer::CreateFrameBuffer()
+{
+	const VkClearColorValue clearColor = { { 0.0f, 0.0f, 0.0f, 0.0f } };
+	const VkClearDepthStencilValue clearDepth = { 1.0f, 0 };
 
 	// Find a suitable depth format
 	VkFormat attDepthFormat;
 	VkBool32 validDepthFormat = VkTools::GetSupportedDepthFormat(m_pWRenderer->m_SwapChain.physicalDevice, attDepthFormat);
 	assert(validDepthFormat);
 
-	//Depth
-	CreateAttachement(attDepthFormat,
-		VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
-		&offScreenFrameBuf.depth,
-		layoutCmd);
+	m_pRenderGraph = TYW_NEW VulkanRenderGraph(m_pWRenderer->m_SwapChain.device);
 
-	//Free command buffer
-	VK_CHECK_RESULT(vkEndCommandBuffer(layoutCmd));
-	VkSubmitInfo submitInfo = {};
-	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-	submitInfo.commandBufferCount = 1;
-	submitInfo.pCommandBuffers = &layoutCmd;
+	//Position, Specular - Packed
+	graphImages.position = m_pRenderGraph->CreateImage("Position Specular", VK_FORMAT_R32G32B32A32_UINT, GBUFF_DIM, GBUFF_DIM);
 
-	VK_CHECK_RESULT(vkQueueSubmit(m_pWRenderer->m_Queue, 1, &submitInfo, VK_NULL_HANDLE));
-	VK_CHECK_RESULT(vkQueueWaitIdle(m_pWRenderer->m_Queue));
-	vkFreeCommandBuffers(m_pWRenderer->m_SwapChain.device, m_pWRenderer->m_CmdPool, 1, &layoutCmd);
+	//Normal, Diffuse, Depth - Packed
+	graphImages.nm = m_pRenderGraph->CreateImage("Normal Diffuse", VK_FORMAT_R32G32B32A32_UINT, GBUFF_DIM, GBUFF_DIM);
 
-	//Deffered FrameBuffer
-	{
-		std::array<VkAttachmentDescription, 3> attachmentDescs = {};
+	//Depth
+	graphImages.depth = m_pRenderGraph->CreateImage("Depth", attDepthFormat, GBUFF_DIM, GBUFF_DIM);
 
-		// Init attachment properties
-		for (uint32_t i = 0; i < attachmentDescs.size(); ++i)
-		{
-			attachmentDescs[i].samples = VK_SAMPLE_COUNT_1_BIT;
-			attachmentDescs[i].loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-			attachmentDescs[i].storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-			attachmentDescs[i].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-			attachmentDescs[i].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-
-			//depth buffer == 2
-			attachmentDescs[i].initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-			attachmentDescs[i].finalLayout = (i == 2) ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL : VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-		}
+	gbufferPass = m_pRenderGraph->AddPass("G-Buffer");
+	m_pRenderGraph->WriteColor(gbufferPass, graphImages.position, clearColor);
+	m_pRenderGraph->WriteColor(gbufferPass, graphImages.nm, clearColor);
+	m_pRenderGraph->WriteDepth(gbufferPass, graphImages.depth, clearDepth);
 
-		// Formats
-		attachmentDescs[0].format = offScreenFrameBuf.position.format;
-		attachmentDescs[1].format = offScreenFrameBuf.nm.format;
-		attachmentDescs[2].format = offScreenFrameBuf.depth.format;
-
-		std::vector<VkAttachmentReference> colorReferences;
-		colorReferences.push_back({ 0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL });
-		colorReferences.push_back({ 1, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL });
-
-		VkAttachmentReference depthReference = {};
-		depthReference.attachment = 2;
-		depthReference.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
-
-		VkSubpassDescription subpass = {};
-		subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
-		subpass.pColorAttachments = colorReferences.data();
-		subpass.colorAttachmentCount = static_cast<uint32_t>(colorReferences.size());
-		subpass.pDepthStencilAttachment = &depthReference;
-
-		// Use subpass dependencies for attachment layput transitions
-		std::array<VkSubpassDependency, 2> dependencies;
-
-		dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
-		dependencies[0].dstSubpass = 0;
-		dependencies[0].srcStageMask = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
-		dependencies[0].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-		dependencies[0].srcAccessMask = VK_ACCESS_MEMORY_READ_BIT;
-		dependencies[0].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-		dependencies[0].dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
-
-		dependencies[1].srcSubpass = 0;
-		dependencies[1].dstSubpass = VK_SUBPASS_EXTERNAL;
-		dependencies[1].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-		dependencies[1].dstStageMask = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
-		dependencies[1].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-		dependencies[1].dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
-		dependencies[1].dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
-
-
-		VkRenderPassCreateInfo renderPassInfo = {};
-		renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-		renderPassInfo.pAttachments = attachmentDescs.data();
-		renderPassInfo.attachmentCount = static_cast<uint32_t>(attachmentDescs.size());
-		renderPassInfo.subpassCount = 1;
-		renderPassInfo.pSubpasses = &subpass;
-		renderPassInfo.dependencyCount = 2;
-		renderPassInfo.pDependencies = dependencies.data();
-
-		VK_CHECK_RESULT(vkCreateRenderPass(m_pWRenderer->m_SwapChain.device, &renderPassInfo, nullptr, &offScreenFrameBuf.renderPass));
-
-		std::array<VkImageView, 3> attachments;
-		attachments[0] = offScreenFrameBuf.position.view;
-		attachments[1] = offScreenFrameBuf.nm.view;
-		attachments[2] = offScreenFrameBuf.depth.view;
-
-		VkFramebufferCreateInfo fbufCreateInfo = {};
-		fbufCreateInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-		fbufCreateInfo.pNext = NULL;
-		fbufCreateInfo.renderPass = offScreenFrameBuf.renderPass;
-		fbufCreateInfo.pAttachments = attachments.data();
-		fbufCreateInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
-		fbufCreateInfo.width = offScreenFrameBuf.width;
-		fbufCreateInfo.height = offScreenFrameBuf.height;
-		fbufCreateInfo.layers = 1;
-		VK_CHECK_RESULT(vkCreateFramebuffer(m_pWRenderer->m_SwapChain.device, &fbufCreateInfo, nullptr, &offScreenFrameBuf.frameBuffer));
-	}
+	//Composition samples these after the graph
+	m_pRenderGraph->Export(graphImages.position);
+	m_pRenderGraph->Export(graphImages.nm);
+
+	m_pRenderGraph->Compile();
 
 
 	// Create sampler to sample from the color attachments
@@ -1045,11 +875,7 @@ void Renderer::BeginTextUpdate()
 
 void Renderer::BuildCommandBuffers()
 {
-	VkCommandBufferAllocateInfo cmdBufAllocateInfo = VkTools::Initializer::CommandBufferAllocateInfo(m_pWRenderer->m_CmdPool, VK_COMMAND_BUFFER_LEVEL_PRIMARY, 1);
-	VK_CHECK_RESULT(vkAllocateCommandBuffers(m_pWRenderer->m_SwapChain.device, &cmdBufAllocateInfo, &cmdGui));
-
-	//Prepare FrameBuffer Commands
-	PrepareFramebufferCommands();
+	//G-Buffer and GUI commands are recorded every frame into frame manager command buffers
 
 	//Main Rendere Commands
 	PrepareMainRendererCommands();
@@ -1077,20 +903,14 @@ void Renderer::UpdateUniformBuffers()
 	m_uboVS.modelMatrix = glm::scale(m_uboVS.modelMatrix, glm::vec3(0.2, 0.2, 0.2));
 	{
 		// Map uniform buffer and update it
-		uint8_t *pData;
-		VK_CHECK_RESULT(vkMapMemory(m_pWRenderer->m_SwapChain.device, uniformData.mesh.memory, 0, sizeof(m_uboVS), 0, (void **)&pData));
-		memcpy(pData, &m_uboVS, sizeof(m_uboVS));
-		vkUnmapMemory(m_pWRenderer->m_SwapChain.device, uniformData.mesh.memory);
+		memcpy(uniformData.mesh.mapped, &m_uboVS, sizeof(m_uboVS));
 	}
 
 	//FullScreen
 	uboFullScreen.projection = glm::ortho(0.0f, 1.0f, 0.0f, 1.0f, -1.0f, 1.0f);
 	uboFullScreen.model = glm::mat4();
 	{
-		uint8_t *pData;
-		VK_CHECK_RESULT(vkMapMemory(m_pWRenderer->m_SwapChain.device, uniformData.vsFullScreen.memory, 0, sizeof(uboFullScreen), 0, (void **)&pData));
-		memcpy(pData, &uboFullScreen, sizeof(uboFullScreen));
-		vkUnmapMemory(m_pWRenderer->m_SwapChain.device, uniformData.vsFullScreen.memory);
+		memcpy(uniformData.vsFullScreen.mapped, &uboFullScreen, sizeof(uboFullScreen));
 	}
 }
 
@@ -1113,14 +933,6 @@ void Renderer::PrepareUniformBuffers()
 		uniformData.quad,
 		&quadUniformData);
 
-	//prepare light
-	CreateUniformBuffer(
-		VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-		sizeof(uboFragmentLights),
-		uniformData.fsLights,
-		&uboFragmentLights);
-
 	//prepare fullscreen
 	CreateUniformBuffer(
 		VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
@@ -1151,34 +963,35 @@ void Renderer::PrepareVertices(bool useStagingBuffers)
 
 	staticModel.InitFromFile("Geometry/nanosuit/nanosuit2.obj", GetAssetPath());
 
-	std::vector<VkBufferObject_s> listStagingBuffers;
-	listLocalBuffers.resize(staticModel.surfaces.size());
-	listStagingBuffers.resize(staticModel.surfaces.size());
 	listDescriptros.resize(staticModel.surfaces.size());
+	surfaceBoundsMin.resize(staticModel.surfaces.size(), glm::vec3(FLT_MAX));
+	surfaceBoundsMax.resize(staticModel.surfaces.size(), glm::vec3(-FLT_MAX));
+	surfaceVisible.resize(staticModel.surfaces.size(), true);
 
-	m_pWRenderer->m_DescriptorPool = VK_NULL_HANDLE;
-	SetupDescriptorPool();
-	VkDescriptorSetAllocateInfo allocInfo = VkTools::Initializer::DescriptorSetAllocateInfo(m_pWRenderer->m_DescriptorPool, &descriptorSetLayout, 1);
+	//Sets come from the shared pooled allocator, it grows with the number of surfaces
 
 
 	// Image descriptor for the color attachement
 	VkDescriptorImageInfo GBufferPosition =
 		VkTools::Initializer::DescriptorImageInfo(
 			colorSampler,
-			offScreenFrameBuf.position.view,
-			VK_IMAGE_LAYOUT_GENERAL);
+			m_pRenderGraph->GetImageView(graphImages.position),
+			VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
 
 	//Normal, Diffuse and Specular packed texture
 	VkDescriptorImageInfo GBufferNM =
 		VkTools::Initializer::DescriptorImageInfo(
 			colorSampler,
-			offScreenFrameBuf.nm.view,
-			VK_IMAGE_LAYOUT_GENERAL);
+			m_pRenderGraph->GetImageView(graphImages.nm),
+			VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+
 
 
+	//Lights, offset is given when binding
+	VkDescriptorBufferInfo lightsDescriptor = vertexCache.UniformDescriptor(sizeof(uboFragmentLights));
 
 	// Debug Descriptor
-	VK_CHECK_RESULT(vkAllocateDescriptorSets(m_pWRenderer->m_SwapChain.device, &allocInfo, &quadDescriptorSet));
+	quadDescriptorSet = descriptorAllocator->Allocate(descriptorSetLayout);
 	std::vector<VkWriteDescriptorSet> quadWriteDescriptorSets =
 	{
 		// Binding 0 : Vertex shader uniform buffer
@@ -1189,11 +1002,14 @@ void Renderer::PrepareVertices(bool useStagingBuffers)
 
 		// Binding 2: Image descriptor
 		VkTools::Initializer::WriteDescriptorSet(quadDescriptorSet,VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,2, &GBufferNM),
+
+		// Binding 4: written in every set, dynamic bindings always take an offset
+		VkTools::Initializer::WriteDescriptorSet(quadDescriptorSet,VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 4, &lightsDescriptor),
 	};
 	vkUpdateDescriptorSets(m_pWRenderer->m_SwapChain.device, quadWriteDescriptorSets.size(), quadWriteDescriptorSets.data(), 0, NULL);
 
 	// FullScreen Descriptor
-	VK_CHECK_RESULT(vkAllocateDescriptorSets(m_pWRenderer->m_SwapChain.device, &allocInfo, &defferedModelDescriptorSet));
+	defferedModelDescriptorSet = descriptorAllocator->Allocate(descriptorSetLayout);
 	std::vector<VkWriteDescriptorSet> defferedWriteModelDescriptorSet =
 	{
 		// Binding 0 : Vertex shader uniform buffer
@@ -1206,7 +1022,7 @@ void Renderer::PrepareVertices(bool useStagingBuffers)
 		VkTools::Initializer::WriteDescriptorSet(defferedModelDescriptorSet,VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,2, &GBufferNM),
 
 		//Binding 4
-		VkTools::Initializer::WriteDescriptorSet(defferedModelDescriptorSet,VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 4, &uniformData.fsLights.descriptor),
+		VkTools::Initializer::WriteDescriptorSet(defferedModelDescriptorSet,VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 4, &lightsDescriptor),
 	};
 	vkUpdateDescriptorSets(m_pWRenderer->m_SwapChain.device, defferedWriteModelDescriptorSet.size(), defferedWriteModelDescriptorSet.data(), 0, NULL);
 
@@ -1217,12 +1033,21 @@ void Renderer::PrepareVertices(bool useStagingBuffers)
 		//Get triangles
 		srfTriangles_t* tr = staticModel.surfaces[i].geometry;
 
+		//Occludee bounds
+		for (int v = 0; v < tr->numVerts; v++)
+		{
+			surfaceBoundsMin[i] = glm::min(surfaceBoundsMin[i], tr->verts[v].vertex);
+			surfaceBoundsMax[i] = glm::max(surfaceBoundsMax[i], tr->verts[v].vertex);
+		}
 
-		VK_CHECK_RESULT(vkAllocateDescriptorSets(m_pWRenderer->m_SwapChain.device, &allocInfo, &listDescriptros[i]));
+		listDescriptros[i] = descriptorAllocator->Allocate(descriptorSetLayout);
 		std::vector<VkWriteDescriptorSet> writeDescriptorSets =
 		{
 			//uniform descriptor
-			VkTools::Initializer::WriteDescriptorSet(listDescriptros[i],VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,	0,&uniformData.mesh.descriptor)
+			VkTools::Initializer::WriteDescriptorSet(listDescriptros[i],VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,	0,&uniformData.mesh.descriptor),
+
+			//lights
+			VkTools::Initializer::WriteDescriptorSet(listDescriptros[i],VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 4, &lightsDescriptor)
 		};
 
 		//We need this because descriptorset will take pointer to vkDescriptorImageInfo.
@@ -1244,50 +1069,21 @@ void Renderer::PrepareVertices(bool useStagingBuffers)
 		vkUpdateDescriptorSets(m_pWRenderer->m_SwapChain.device, writeDescriptorSets.size(), writeDescriptorSets.data(), 0, NULL);
 
 
-		//Create stagging buffer first
-		VkBufferObject::CreateBuffer(
-			m_pWRenderer->m_SwapChain,
-			m_pWRenderer->m_DeviceMemoryProperties,
-			VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT,
-			static_cast<uint32_t>(sizeof(drawVert) * tr->numVerts),
-			listStagingBuffers[i],
-			tr->verts);
-
-		//Create Local Copy
-		VkBufferObject::CreateBuffer(
-			m_pWRenderer->m_SwapChain,
-			m_pWRenderer->m_DeviceMemoryProperties,
-			VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-			static_cast<uint32_t>(sizeof(drawVert) * tr->numVerts),
-			listLocalBuffers[i]);
-
-
-		//Create new command buffer
-		VkCommandBuffer copyCmd = GetCommandBuffer(true);
-
-
-		//Submit info to the queue
-		VkBufferObject::SubmitBufferObjects(
-			copyCmd,
-			m_pWRenderer->m_Queue,
-			*m_pWRenderer,
-			static_cast<uint32_t>(sizeof(drawVert) * tr->numVerts),
-			listStagingBuffers[i],
-			listLocalBuffers[i], (drawVertFlags::Vertex | drawVertFlags::Normal | drawVertFlags::Uv | drawVertFlags::Tangent | drawVertFlags::Binormal));
-
-		meshSize.push_back(tr->numVerts);
-
 		numVerts += tr->numVerts;
 		numUvs += tr->numVerts;
 		numNormals += tr->numVerts;
 	}
+
+	//One vertex and one index buffer for the whole model
+	staticModel.CreateBuffers(m_pWRenderer->m_SwapChain, m_pWRenderer->m_DeviceMemoryProperties);
 }
 
 
 void Renderer::PreparePipeline()
 {
+	//Pipelines do not depend on each other, they are compiled together on worker threads
+	VulkanPipelineBuilder pipelineBuilder(m_pWRenderer->m_SwapChain.device, m_pWRenderer->m_PipelineCache);
+
 	VkPipelineInputAssemblyStateCreateInfo inputAssemblyState =
 		VkTools::Initializer::PipelineInputAssemblyStateCreateInfo(
 			VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST,
@@ -1361,7 +1157,7 @@ void Renderer::PreparePipeline()
 	pipelineCreateInfo.pDynamicState = &dynamicState;
 
 	// Create rendering pipeline
-	VK_CHECK_RESULT(vkCreateGraphicsPipelines(m_pWRenderer->m_SwapChain.device, m_pWRenderer->m_PipelineCache, 1, &pipelineCreateInfo, nullptr, &pipeline));
+	pipelineBuilder.Add(pipelineCreateInfo, &pipeline);
 
 	//Debug Quad Pipeline
 	shaderStages[0] = LoadShader(GetAssetPath() + "Shaders/DeferredShading/DebugQuad.vert.spv", VK_SHADER_STAGE_VERTEX_BIT);
@@ -1376,14 +1172,14 @@ void Renderer::PreparePipeline()
 			VK_FRONT_FACE_CLOCKWISE,
 			0);
 
-	VK_CHECK_RESULT(vkCreateGraphicsPipelines(m_pWRenderer->m_SwapChain.device, m_pWRenderer->m_PipelineCache, 1, &pipelineCreateInfo, nullptr, &quadPipeline));
+	pipelineBuilder.Add(pipelineCreateInfo, &quadPipeline);
 
 	//G-Buffer
 	shaderStages[0] = LoadShader(GetAssetPath() + "Shaders/DeferredShading/DefferedMRT.vert.spv", VK_SHADER_STAGE_VERTEX_BIT);
 	shaderStages[1] = LoadShader(GetAssetPath() + "Shaders/DeferredShading/DefferedMRT.frag.spv", VK_SHADER_STAGE_FRAGMENT_BIT);
 
 	// Separate render pass
-	pipelineCreateInfo.renderPass = offScreenFrameBuf.renderPass;
+	pipelineCreateInfo.renderPass = m_pRenderGraph->GetRenderPass(gbufferPass);
 
 	// Separate layout
 	pipelineCreateInfo.layout = frameBufferPipelineLayout;
@@ -1399,7 +1195,7 @@ void Renderer::PreparePipeline()
 	colorBlendState.attachmentCount = static_cast<uint32_t>(blendAttachmentStates.size());
 	colorBlendState.pAttachments = blendAttachmentStates.data();
 
-	pipelineCreateInfo.pVertexInputState = &listLocalBuffers[0].inputState;
+	pipelineCreateInfo.pVertexInputState = &staticModel.vertexBuffer.inputState;
 
 	//Turn on culling again
 	rasterizationState =
@@ -1409,7 +1205,9 @@ void Renderer::PreparePipeline()
 			VK_FRONT_FACE_CLOCKWISE,
 			0);
 
-	VK_CHECK_RESULT(vkCreateGraphicsPipelines(m_pWRenderer->m_SwapChain.device, m_pWRenderer->m_PipelineCache, 1, &pipelineCreateInfo, nullptr, &frameBufferPipeline));
+	pipelineBuilder.Add(pipelineCreateInfo, &frameBufferPipeline);
+
+	BuildPipelines(pipelineBuilder);
 }
 
 
@@ -1437,8 +1235,8 @@ void Renderer::SetupDescriptorSetLayout()
 			// Binding 3 : Fragment shader image sampler
 			VkTools::Initializer::DescriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,VK_SHADER_STAGE_FRAGMENT_BIT,3),
 
-			// Binding 4 : Fragment shader uniform buffer
-			VkTools::Initializer::DescriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,VK_SHADER_STAGE_FRAGMENT_BIT,4),
+			// Binding 4 : Fragment shader uniform buffer, lights from vertexCache uniform memory
+			VkTools::Initializer::DescriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,VK_SHADER_STAGE_FRAGMENT_BIT,4),
 		};
 
 		VkDescriptorSetLayoutCreateInfo descriptorLayout = VkTools::Initializer::DescriptorSetLayoutCreateInfo(setLayoutBindings.data(), setLayoutBindings.size());
@@ -1452,20 +1250,6 @@ void Renderer::SetupDescriptorSetLayout()
 	}
 }
 
-void Renderer::SetupDescriptorPool()
-{
-	// Example uses one ubo and one image sampler
-	std::vector<VkDescriptorPoolSize> poolSizes =
-	{
-		VkTools::Initializer::DescriptorPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 23),
-		VkTools::Initializer::DescriptorPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 8 * 4 + 4)
-	};
-
-	VkDescriptorPoolCreateInfo descriptorPoolInfo = VkTools::Initializer::DescriptorPoolCreateInfo(poolSizes.size(), poolSizes.data(), 10);
-	VK_CHECK_RESULT(vkCreateDescriptorPool(m_pWRenderer->m_SwapChain.device, &descriptorPoolInfo, nullptr, &m_pWRenderer->m_DescriptorPool));
-}
-
-
 void Renderer::SetupDescriptorSet()
 {
 
@@ -1473,76 +1257,70 @@ void Renderer::SetupDescriptorSet()
 
 void Renderer::StartFrame()
 {
+	TYW_PROFILE_FUNCTION();
+	// Get next image in the swap chain (back/front buffer).
+	// Waits only if a frame still in flight rendered to the same image
+	VK_CHECK_RESULT(frameManager->AcquireImage(m_pWRenderer->m_SwapChain, &m_pWRenderer->m_currentBuffer));
 
-	{
-		// Get next image in the swap chain (back/front buffer)
-		VK_CHECK_RESULT(m_pWRenderer->m_SwapChain.GetNextImage(Semaphores.presentComplete, &m_pWRenderer->m_currentBuffer));
-
-		// Submit the post present image barrier to transform the image back to a color attachment
-		// that can be used to write to by our render pass
-		VkSubmitInfo submitInfo = VkTools::Initializer::SubmitInfo();
-		submitInfo.commandBufferCount = 1;
-		submitInfo.pCommandBuffers = &m_pWRenderer->m_PostPresentCmdBuffers[m_pWRenderer->m_currentBuffer];
-
-		VK_CHECK_RESULT(vkQueueSubmit(m_pWRenderer->m_Queue, 1, &submitInfo, VK_NULL_HANDLE));
-
-		// Make sure that the image barrier command submitted to the queue 
-		// has finished executing
-		VK_CHECK_RESULT(vkQueueWaitIdle(m_pWRenderer->m_Queue));
-	}
+	//Lights were written to a new uniform offset this frame.
+	//Per image command buffer is free again, its last frame has finished
+	BuildMainRendererCommandBuffer(m_pWRenderer->m_currentBuffer);
 
+	//Per frame command buffers, recycled once this frame has finished on gpu
+	VkCommandBuffer gbufferCmd = frameManager->GetCommandBuffer();
+	RecordFramebufferCommands(gbufferCmd);
 
+	VkCommandBuffer guiCmd = frameManager->GetCommandBuffer();
+	ImGui_ImplGlfwVulkan_Render(guiCmd, m_pWRenderer->m_currentBuffer);
 
 	{
-		//Submit model
 		VkPipelineStageFlags submitPipelineStages = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
 		VkPipelineStageFlags stageFlags = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
 		VkSubmitInfo submitInfo = VkTools::Initializer::SubmitInfo();
 
-		//Base info
-		submitInfo.pWaitDstStageMask = &submitPipelineStages;
-		submitInfo.commandBufferCount = 1;
-		submitInfo.waitSemaphoreCount = 1;
+		//Start Deffered Pass. Does not touch the swap chain image, so it does not wait for it
+		VkCommandBuffer gbufferCmds[] = { frameManager->BeginFrameTimer(), gbufferCmd };
+		submitInfo.commandBufferCount = 2;
+		submitInfo.pCommandBuffers = gbufferCmds;
 		submitInfo.signalSemaphoreCount = 1;
-
-		//Start Deffered Pass
-		submitInfo.pCommandBuffers = &GBufferScreenCmdBuffer;
-		submitInfo.pWaitSemaphores = &Semaphores.presentComplete;
 		submitInfo.pSignalSemaphores = &Semaphores.defferedSemaphore;
 		VK_CHECK_RESULT(vkQueueSubmit(m_pWRenderer->m_Queue, 1, &submitInfo, VK_NULL_HANDLE));
 
 
 		//Start Main Pass (Combines all images and does calculation for all lights)
-		submitInfo.pWaitSemaphores = &Semaphores.defferedSemaphore;
+		//Post present barrier transforms the image back to a color attachment once it is acquired
+		VkSemaphore mainWaitSemaphores[] = { Semaphores.defferedSemaphore, frameManager->ImageAcquiredSemaphore() };
+		VkPipelineStageFlags mainWaitStages[] = { submitPipelineStages, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT };
+		VkCommandBuffer mainCmds[] = { m_pWRenderer->m_PostPresentCmdBuffers[m_pWRenderer->m_currentBuffer], m_pWRenderer->m_DrawCmdBuffers[m_pWRenderer->m_currentBuffer] };
+		submitInfo.waitSemaphoreCount = 2;
+		submitInfo.pWaitSemaphores = mainWaitSemaphores;
+		submitInfo.pWaitDstStageMask = mainWaitStages;
+		submitInfo.commandBufferCount = 2;
+		submitInfo.pCommandBuffers = mainCmds;
 		submitInfo.pSignalSemaphores = &Semaphores.renderComplete;
-		submitInfo.pCommandBuffers = &m_pWRenderer->m_DrawCmdBuffers[m_pWRenderer->m_currentBuffer];
 		VK_CHECK_RESULT(vkQueueSubmit(m_pWRenderer->m_Queue, 1, &submitInfo, VK_NULL_HANDLE));
 
 
-		//Wait for color output before rendering text
-		submitInfo.pWaitDstStageMask = &stageFlags;
-
-		//ImGUI Render
-		ImGui_ImplGlfwVulkan_Render(cmdGui, m_pWRenderer->m_currentBuffer);
+		//ImGUI Render. Wait for color output before rendering text
+		submitInfo.waitSemaphoreCount = 1;
 		submitInfo.pWaitSemaphores = &Semaphores.renderComplete;
+		submitInfo.pWaitDstStageMask = &stageFlags;
+		submitInfo.commandBufferCount = 1;
+		submitInfo.pCommandBuffers = &guiCmd;
 		submitInfo.pSignalSemaphores = &Semaphores.textOverlayComplete;
-		submitInfo.pCommandBuffers = &cmdGui;
 		VK_CHECK_RESULT(vkQueueSubmit(m_pWRenderer->m_Queue, 1, &submitInfo, VK_NULL_HANDLE));
-	}
 
-	{
+
 		// Submit pre present image barrier to transform the image from color attachment to present(khr) for presenting to the swap chain
-		VkSubmitInfo submitInfo = VkTools::Initializer::SubmitInfo();
-		submitInfo.commandBufferCount = 1;
+		VkSemaphore renderComplete = frameManager->RenderCompleteSemaphore();
+		submitInfo.pWaitSemaphores = &Semaphores.textOverlayComplete;
 		submitInfo.pCommandBuffers = &m_pWRenderer->m_PrePresentCmdBuffers[m_pWRenderer->m_currentBuffer];
+		submitInfo.pSignalSemaphores = &renderComplete;
 		VK_CHECK_RESULT(vkQueueSubmit(m_pWRenderer->m_Queue, 1, &submitInfo, VK_NULL_HANDLE));
 
-
-		// Present the current buffer to the swap chain
-		// We pass the signal semaphore from the submit info
-		// to ensure that the image is not rendered until
-		// all commands have been submitted
-		VK_CHECK_RESULT(m_pWRenderer->m_SwapChain.QueuePresent(m_pWRenderer->m_Queue, m_pWRenderer->m_currentBuffer, Semaphores.textOverlayComplete));
+		// Present the current buffer to the swap chain once the whole frame has been rendered.
+		// EndFrame fences the frame, there is no wait for the queue here
+		VK_CHECK_RESULT(m_pWRenderer->m_SwapChain.QueuePresent(m_pWRenderer->m_Queue, m_pWRenderer->m_currentBuffer, renderComplete));
 	}
 }
 
@@ -1559,17 +1337,32 @@ Renderer g_Renderer;
 
 int main()
 {
+#if defined(_WIN32)
 	g_bPrepared = g_Renderer.VInitRenderer(720, 1280, false, HandleWindowMessages);
+#else
+	//No window on other platforms, needs TYW_HEADLESS=<frames>. Size is what WM_SIZE reports on Windows
+	g_iDesktopWidth = 1280;
+	g_iDesktopHeight = 720;
+	g_bPrepared = g_Renderer.VInitRenderer(g_iDesktopHeight, g_iDesktopWidth, false, nullptr);
+#endif
+	if (!g_bPrepared)
+	{
+		return 1;
+	}
 	ImGui_ImplGlfwVulkan_MouseOnWinodws(true); //for now will work. Should test against windows rect
 
-#if defined(_WIN32)
 	MSG msg;
-#endif
 
 	while (TRUE)
 	{
 		if (!GenerateEvents(msg))break;
 
+		//Fixed time step and recorded camera path while benchmarking
+		if (g_Renderer.UpdateBenchmark(&g_Renderer.m_Camera))
+		{
+			g_Renderer.m_bViewUpdated = true;
+		}
+
 		auto tStart = std::chrono::high_resolution_clock::now();
 		ImGui_ImplGlfwVulkan_NewFrame(g_Renderer.frameTimer);
 		g_Renderer.ImguiRender();
@@ -1580,6 +1373,7 @@ int main()
 			g_Renderer.m_bViewUpdated = false;
 			g_Renderer.UpdateUniformBuffers();
 			g_Renderer.UpdateQuadUniformData();
+			g_Renderer.CullSurfaces();
 		}
 
 		//Update lights all the time as they move
@@ -1612,6 +1406,7 @@ int main()
 }
 
 
+#if defined(_WIN32)
 LRESULT CALLBACK HandleWindowMessages(HWND hWnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
 {
 	switch (uMsg)
@@ -1746,10 +1541,24 @@ LRESULT CALLBACK HandleWindowMessages(HWND hWnd, UINT uMsg, WPARAM wParam, LPARA
 	}
 	return DefWindowProc(hWnd, uMsg, wParam, lParam);
 }
+#endif
 
 
 bool GenerateEvents(MSG& msg)
 {
+	//Benchmark ends with its camera path, the report is written by then
+	if (g_Renderer.IsBenchmarkFinished())
+	{
+		return false;
+	}
+
+	//No window to pump messages for, the run ends after its frame count
+	if (g_Renderer.IsHeadless())
+	{
+		return !g_Renderer.IsHeadlessFinished();
+	}
+
+#if defined(_WIN32)
 	if (PeekMessage(&msg, NULL, 0, 0, PM_REMOVE))
 	{
 		if (msg.message == WM_QUIT)
@@ -1763,9 +1572,13 @@ bool GenerateEvents(MSG& msg)
 		}
 	}
 	return true;
+#else
+	return false;
+#endif
 }
 
 
+#if defined(_WIN32)
 void WIN_Sizing(WORD side, RECT *rect)
 {
 	// restrict to a standard aspect ratio
@@ -1780,4 +1593,5 @@ void WIN_Sizing(WORD side, RECT *rect)
 
 	g_iDesktopWidth -= decoWidth;
 	g_iDesktopHeight -= decoHeight;
-}
\ No newline at end of file
+}
+#endif
@@ -5,26 +5,27 @@
 */
 
 
-#include <RendererPch\stdafx.h>
+#include <RendererPch/stdafx.h>
 
 //Triangle Includes
 #include "Main.h"
 #include <conio.h>
 
 //Renderer Includes
-#include <Renderer\VKRenderer.h>
-#include <Renderer\Vulkan\VulkanTools.h>
-#include <Renderer\Vulkan\VulkanTextureLoader.h>
-#include <Renderer\Geometry\VertData.h>
-#include <Renderer\Vulkan\VkBufferObject.h>
+#include <Renderer/VKRenderer.h>
+#include <Renderer/Vulkan/VulkanTools.h>
+#include <Renderer/Vulkan/VulkanTextureLoader.h>
+#include <Renderer/Geometry/VertData.h>
+#include <Renderer/Vulkan/VkBufferObject.h>
+#include <Renderer/Vulkan/VulkanFrameManager.h>
 
 
 //math
-#include <External\glm\glm\gtc\matrix_inverse.hpp>
+#include <External/glm/glm/gtc/matrix_inverse.hpp>
 
 //Font Renderer
-#include <Renderer\ThirdParty\FreeType\FreetypeLoad.h>
-#include <Renderer\ThirdParty\FreeType\VkFont.h>
+#include <Renderer/ThirdParty/FreeType/FreetypeLoad.h>
+#include <Renderer/ThirdParty/FreeType/VkFont.h>
 
 
 
@@ -99,21 +100,6 @@ private:
 	VkPipeline pipeline;
 
 
-	// Synchronization semaphores
-	// Semaphores are used to synchronize dependencies between command buffers
-	// We use them to ensure that we e.g. don't present to the swap chain
-	// until all rendering has completed
-	struct
-	{
-		// Swap chain image presentation
-		VkSemaphore presentComplete;
-		// Command buffer submission and execution
-		VkSemaphore renderComplete;
-		// Text overlay submission and execution
-		VkSemaphore textOverlayComplete;
-	} Semaphores;
-
-
 	VkFont*	m_VkFont;
 
 	//Vertex
@@ -157,16 +143,6 @@ Renderer::~Renderer()
 	//Delete buffer data
 	VkBufferObject::DeleteBufferMemory(m_pWRenderer->m_SwapChain.device, m_BufferData, nullptr);
 
-	//Destroy Shader Module
-	for (int i = 0; i < m_ShaderModules.size(); i++)
-	{
-		vkDestroyShaderModule(m_pWRenderer->m_SwapChain.device, m_ShaderModules[i], nullptr);
-	}
-
-	//Release semaphores
-	vkDestroySemaphore(m_pWRenderer->m_SwapChain.device, Semaphores.presentComplete, nullptr);
-	vkDestroySemaphore(m_pWRenderer->m_SwapChain.device, Semaphores.renderComplete, nullptr);
-	vkDestroySemaphore(m_pWRenderer->m_SwapChain.device, Semaphores.textOverlayComplete, nullptr);
 
 	//DestroyPipeline
 	vkDestroyPipeline(m_pWRenderer->m_SwapChain.device, pipeline, nullptr);
@@ -181,25 +157,9 @@ void Renderer::ChangeLodBias(float delta)
 
 void Renderer::PrepareSemaphore()
 {
-	VkSemaphoreCreateInfo semaphoreCreateInfo = {};
-	semaphoreCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
-	semaphoreCreateInfo.pNext = NULL;
-
-	// This semaphore ensures that the image is complete
-	// before starting to submit again
-	VK_CHECK_RESULT(vkCreateSemaphore(m_pWRenderer->m_SwapChain.device, &semaphoreCreateInfo, nullptr, &Semaphores.presentComplete));
-
-	// This semaphore ensures that all commands submitted
-	// have been finished before submitting the image to the queue
-	VK_CHECK_RESULT(vkCreateSemaphore(m_pWRenderer->m_SwapChain.device, &semaphoreCreateInfo, nullptr, &Semaphores.renderComplete));
-
-
-	// This semaphore ensures that all commands submitted
-	// have been finished before submitting the image to the queue
-	VK_CHECK_RESULT(vkCreateSemaphore(m_pWRenderer->m_SwapChain.device, &semaphoreCreateInfo, nullptr, &Semaphores.textOverlayComplete));
+	//Swap chain acquire and present semaphores belong to frameManager, one pair per frame in flight
 }
 
-
 void Renderer::BuildCommandBuffers()
 {
 	VkCommandBufferBeginInfo cmdBufInfo = {};
@@ -307,6 +267,8 @@ void Renderer::BuildCommandBuffers()
 
 void Renderer::UpdateUniformBuffers()
 {
+	//Every frame reads the one font uniform buffer. Only input changes it, wait for the frames in flight then
+	frameManager->WaitIdle();
 	m_VkFont->UpdateUniformBuffers(m_WindowWidth, m_WindowHeight, g_zoom);
 
 	/*
@@ -384,7 +346,6 @@ void Renderer::PrepareVertices(bool useStagingBuffers)
 	
 	m_VkFont->CreateFontVk((GetAssetPath() + "Textures/freetype/AmazDooMLeft.ttf"), 64, 96);
 
-	m_VkFont->SetupDescriptorPool();
 	m_VkFont->SetupDescriptorSetLayout();
 	m_VkFont->PrepareUniformBuffers();
 	m_VkFont->InitializeChars("qwertyuiopasdfghjklzxcvbnmQWERTYUIOPASDFGHJKLZXCVBNM-:.@1234567890", *m_pTextureLoader);
@@ -500,7 +461,8 @@ void Renderer::PrepareVertices(bool useStagingBuffers)
 
 void Renderer::PreparePipeline()
 {
-
+	//Pipelines do not depend on each other, they are compiled together on worker threads
+	VulkanPipelineBuilder pipelineBuilder(m_pWRenderer->m_SwapChain.device, m_pWRenderer->m_PipelineCache);
 
 	VkGraphicsPipelineCreateInfo pipelineCreateInfo = {};
 	pipelineCreateInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
@@ -616,14 +578,16 @@ void Renderer::PreparePipeline()
 	pipelineCreateInfo.pDynamicState = &dynamicState;
 
 	// Create rendering pipeline
-	VK_CHECK_RESULT(vkCreateGraphicsPipelines(m_pWRenderer->m_SwapChain.device, m_pWRenderer->m_PipelineCache, 1, &pipelineCreateInfo, nullptr, &pipeline));
+	pipelineBuilder.Add(pipelineCreateInfo, &pipeline);
 
 
 	shaderStages[0] = LoadShader(VKRenderer::GetAssetPath() + "Shaders/FontRendering/NonSdf.vert.spv", VK_SHADER_STAGE_VERTEX_BIT);
 	shaderStages[1] = LoadShader(VKRenderer::GetAssetPath() + "Shaders/FontRendering/NonSdf.frag.spv", VK_SHADER_STAGE_FRAGMENT_BIT);
 
 	// Create rendering pipeline
-	VK_CHECK_RESULT(vkCreateGraphicsPipelines(m_pWRenderer->m_SwapChain.device, m_pWRenderer->m_PipelineCache, 1, &pipelineCreateInfo, nullptr, &nonSdfPipeline));
+	pipelineBuilder.Add(pipelineCreateInfo, &nonSdfPipeline);
+
+	BuildPipelines(pipelineBuilder);
 }
 
 
@@ -653,53 +617,34 @@ void Renderer::SetupDescriptorSet()
 
 void Renderer::StartFrame()
 {
-	{
-		// Get next image in the swap chain (back/front buffer)
-		VK_CHECK_RESULT(m_pWRenderer->m_SwapChain.GetNextImage(Semaphores.presentComplete, &m_pWRenderer->m_currentBuffer));
-
-		// Submit the post present image barrier to transform the image back to a color attachment
-		// that can be used to write to by our render pass
-		VkSubmitInfo submitInfo = VkTools::Initializer::SubmitInfo();
-		submitInfo.commandBufferCount = 1;
-		submitInfo.pCommandBuffers = &m_pWRenderer->m_PostPresentCmdBuffers[m_pWRenderer->m_currentBuffer];
-
-		VK_CHECK_RESULT(vkQueueSubmit(m_pWRenderer->m_Queue, 1, &submitInfo, VK_NULL_HANDLE));
-
-		// Make sure that the image barrier command submitted to the queue 
-		// has finished executing
-		VK_CHECK_RESULT(vkQueueWaitIdle(m_pWRenderer->m_Queue));
-	}
-
-
+	// Get next image in the swap chain (back/front buffer).
+	// Waits only if a frame still in flight rendered to the same image
+	VK_CHECK_RESULT(frameManager->AcquireImage(m_pWRenderer->m_SwapChain, &m_pWRenderer->m_currentBuffer));
 
 	{
 		// The submit infor strcuture contains a list of
 		// command buffers and semaphores to be submitted to a queue
-		// If you want to submit multiple command buffers, pass an array
-		VkPipelineStageFlags pipelineStages = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+		// Post present barrier transforms the image back to a color attachment once it is acquired
+		VkPipelineStageFlags pipelineStages = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+		VkSemaphore imageAcquired = frameManager->ImageAcquiredSemaphore();
+		VkSemaphore renderComplete = frameManager->RenderCompleteSemaphore();
+		VkCommandBuffer cmds[] = { frameManager->BeginFrameTimer(), m_pWRenderer->m_PostPresentCmdBuffers[m_pWRenderer->m_currentBuffer], m_pWRenderer->m_DrawCmdBuffers[m_pWRenderer->m_currentBuffer] };
+
 		VkSubmitInfo submitInfo = VkTools::Initializer::SubmitInfo();
 		submitInfo.pWaitDstStageMask = &pipelineStages;
-		// The wait semaphore ensures that the image is presented 
-		// before we start submitting command buffers agein
 		submitInfo.waitSemaphoreCount = 1;
-		submitInfo.pWaitSemaphores = &Semaphores.presentComplete;
-		// Submit the currently active command buffer
-		submitInfo.commandBufferCount = 1;
-		submitInfo.pCommandBuffers = &m_pWRenderer->m_DrawCmdBuffers[m_pWRenderer->m_currentBuffer];
-		// The signal semaphore is used during queue presentation
-		// to ensure that the image is not rendered before all
-		// commands have been submitted
+		submitInfo.pWaitSemaphores = &imageAcquired;
+		submitInfo.commandBufferCount = 3;
+		submitInfo.pCommandBuffers = cmds;
 		submitInfo.signalSemaphoreCount = 1;
-		submitInfo.pSignalSemaphores = &Semaphores.renderComplete;
+		submitInfo.pSignalSemaphores = &renderComplete;
 
 		// Submit to the graphics queue
 		VK_CHECK_RESULT(vkQueueSubmit(m_pWRenderer->m_Queue, 1, &submitInfo, VK_NULL_HANDLE));
 
-		// Present the current buffer to the swap chain
-		// We pass the signal semaphore from the submit info
-		// to ensure that the image is not rendered until
-		// all commands have been submitted
-		VK_CHECK_RESULT(m_pWRenderer->m_SwapChain.QueuePresent(m_pWRenderer->m_Queue, m_pWRenderer->m_currentBuffer, Semaphores.renderComplete));
+		// Present the current buffer to the swap chain once the whole frame has been rendered.
+		// EndFrame fences the frame, there is no wait for the queue here
+		VK_CHECK_RESULT(m_pWRenderer->m_SwapChain.QueuePresent(m_pWRenderer->m_Queue, m_pWRenderer->m_currentBuffer, renderComplete));
 	}
 }
 
@@ -725,6 +670,9 @@ int main()
 	{
 		if (!GenerateEvents(msg))break;
 
+		//Fixed time step while benchmarking
+		g_Renderer.UpdateBenchmark(nullptr);
+
 		auto tStart = std::chrono::high_resolution_clock::now();
 		g_Renderer.StartFrame();
 		//Do something
@@ -891,6 +839,18 @@ LRESULT CALLBACK HandleWindowMessages(HWND hWnd, UINT uMsg, WPARAM wParam, LPARA
 
 bool GenerateEvents(MSG& msg)
 {
+	//Benchmark ends with its camera path, the report is written by then
+	if (g_Renderer.IsBenchmarkFinished())
+	{
+		return false;
+	}
+
+	//No window to pump messages for, the run ends after its frame count
+	if (g_Renderer.IsHeadless())
+	{
+		return !g_Renderer.IsHeadlessFinished();
+	}
+
 	if (PeekMessage(&msg, NULL, 0, 0, PM_REMOVE))
 	{
 		if (msg.message == WM_QUIT)
@@ -4,21 +4,23 @@
 *	This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
 */
 
-#include <RendererPch\stdafx.h>
+#include <RendererPch/stdafx.h>
 
 //Triangle Includes
 #include "Main.h"
 #include <conio.h>
 
 //Renderer Includes
-#include <Renderer\VKRenderer.h>
-#include <Renderer\Vulkan\VulkanTools.h>
-#include <Renderer\Vulkan\VulkanTextureLoader.h>
-#include <Renderer\Geometry\VertData.h>
+#include <Renderer/VKRenderer.h>
+#include <Renderer/VertexCache.h>
+#include <Renderer/Vulkan/VulkanTools.h>
+#include <Renderer/Vulkan/VulkanTextureLoader.h>
+#include <Renderer/Vulkan/VulkanFrameManager.h>
+#include <Renderer/Geometry/VertData.h>
 
 
 //math
-#include <External\glm\glm\gtc\matrix_inverse.hpp>
+#include <External/glm/glm/gtc/matrix_inverse.hpp>
 
 //Global variables
 //====================================================================================
@@ -103,20 +105,6 @@ private:
 	// different descriptor sets as long as the binding points (and shaders) match
 	VkDescriptorSetLayout descriptorSetLayout;
 
-	// Synchronization semaphores
-	// Semaphores are used to synchronize dependencies between command buffers
-	// We use them to ensure that we e.g. don't present to the swap chain
-	// until all rendering has completed
-	struct
-	{
-		// Swap chain image presentation
-		VkSemaphore presentComplete;
-		// Command buffer submission and execution
-		VkSemaphore renderComplete;
-		// Text overlay submission and execution
-		VkSemaphore textOverlayComplete;
-	} Semaphores;
-
 
 	VkTools::VulkanTexture m_NormalTexture;
 	VkTools::VulkanTexture m_DiffuseTexture;
@@ -130,11 +118,8 @@ private:
 		float lodBias = 0.0f;
 	}m_uboVS;
 
-	struct {
-		VkBuffer buffer;
-		VkDeviceMemory memory;
-		VkDescriptorBufferInfo descriptor;
-	}  uniformDataVS;
+	//m_uboVS copied to the vertex cache for the frame that is being recorded
+	vertCacheHandle_t uniformHandle;
 
 	struct {
 		VkBuffer buf;
@@ -155,6 +140,7 @@ public:
 	~Renderer();
 
 	void BuildCommandBuffers() override;
+	void BuildCommandBuffer(uint32_t i);
 	void UpdateUniformBuffers() override;
 	void PrepareUniformBuffers() override;
 	void PrepareVertices(bool useStagingBuffers) override;
@@ -181,24 +167,14 @@ Renderer::~Renderer()
 	//Destroy texture
 	vkDestroyImageView(m_pWRenderer->m_SwapChain.device, m_DiffuseTexture.view, nullptr);
 	vkDestroyImage(m_pWRenderer->m_SwapChain.device, m_DiffuseTexture.image, nullptr);
-	vkFreeMemory(m_pWRenderer->m_SwapChain.device, m_DiffuseTexture.deviceMemory, nullptr);
+	memoryAllocator->Free(m_DiffuseTexture.allocation);
 	vkDestroySampler(m_pWRenderer->m_SwapChain.device, m_DiffuseTexture.sampler, nullptr);
 
 	vkDestroyImageView(m_pWRenderer->m_SwapChain.device, m_NormalTexture.view, nullptr);
 	vkDestroyImage(m_pWRenderer->m_SwapChain.device, m_NormalTexture.image, nullptr);
-	vkFreeMemory(m_pWRenderer->m_SwapChain.device, m_NormalTexture.deviceMemory, nullptr);
+	memoryAllocator->Free(m_NormalTexture.allocation);
 	vkDestroySampler(m_pWRenderer->m_SwapChain.device, m_NormalTexture.sampler, nullptr);
 
-	//Destroy Shader Module
-	for (int i = 0; i < m_ShaderModules.size(); i++)
-	{
-		vkDestroyShaderModule(m_pWRenderer->m_SwapChain.device, m_ShaderModules[i], nullptr);
-	}
-
-	//Release semaphores
-	vkDestroySemaphore(m_pWRenderer->m_SwapChain.device, Semaphores.presentComplete, nullptr);
-	vkDestroySemaphore(m_pWRenderer->m_SwapChain.device, Semaphores.renderComplete, nullptr);
-	vkDestroySemaphore(m_pWRenderer->m_SwapChain.device, Semaphores.textOverlayComplete, nullptr);
 
 	//DestroyPipeline
 	vkDestroyPipeline(m_pWRenderer->m_SwapChain.device, pipeline, nullptr);
@@ -207,37 +183,19 @@ Renderer::~Renderer()
 	vkDestroyDescriptorSetLayout(m_pWRenderer->m_SwapChain.device, descriptorSetLayout, nullptr);
 
 	//DestroyBuffer
-	vkDestroyBuffer(m_pWRenderer->m_SwapChain.device, uniformDataVS.buffer, nullptr);
 	vkDestroyBuffer(m_pWRenderer->m_SwapChain.device, indices.buf, nullptr);
 	vkDestroyBuffer(m_pWRenderer->m_SwapChain.device, vertices.buf, nullptr);
 
 	//Free memory
-	vkFreeMemory(m_pWRenderer->m_SwapChain.device, uniformDataVS.memory, nullptr);
 	vkFreeMemory(m_pWRenderer->m_SwapChain.device, indices.mem, nullptr);
 	vkFreeMemory(m_pWRenderer->m_SwapChain.device, vertices.mem, nullptr);
 }
 
 void Renderer::PrepareSemaphore()
 {
-	VkSemaphoreCreateInfo semaphoreCreateInfo = {};
-	semaphoreCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
-	semaphoreCreateInfo.pNext = NULL;
-
-	// This semaphore ensures that the image is complete
-	// before starting to submit again
-	VK_CHECK_RESULT(vkCreateSemaphore(m_pWRenderer->m_SwapChain.device, &semaphoreCreateInfo, nullptr, &Semaphores.presentComplete));
-
-	// This semaphore ensures that all commands submitted
-	// have been finished before submitting the image to the queue
-	VK_CHECK_RESULT(vkCreateSemaphore(m_pWRenderer->m_SwapChain.device, &semaphoreCreateInfo, nullptr, &Semaphores.renderComplete));
-
-
-	// This semaphore ensures that all commands submitted
-	// have been finished before submitting the image to the queue
-	VK_CHECK_RESULT(vkCreateSemaphore(m_pWRenderer->m_SwapChain.device, &semaphoreCreateInfo, nullptr, &Semaphores.textOverlayComplete));
+	//Swap chain acquire and present semaphores belong to frameManager, one pair per frame in flight
 }
 
-
 void Renderer::ChangeLodBias(float delta)
 {
 	m_uboVS.lodBias += delta;
@@ -256,6 +214,17 @@ void Renderer::ChangeLodBias(float delta)
 
 void Renderer::BuildCommandBuffers()
 {
+	for (uint32_t i = 0; i < m_pWRenderer->m_DrawCmdBuffers.size(); ++i)
+	{
+		BuildCommandBuffer(i);
+	}
+}
+
+//Records swap chain image i. Redone every frame, the uniform block moves to a new offset each frame
+void Renderer::BuildCommandBuffer(uint32_t i)
+{
+	const uint32_t uniformOffset = static_cast<uint32_t>(uniformHandle.offset);
+
 	VkCommandBufferBeginInfo cmdBufInfo = {};
 	cmdBufInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
 	cmdBufInfo.pNext = NULL;
@@ -278,81 +247,78 @@ void Renderer::BuildCommandBuffers()
 	renderPassBeginInfo.clearValueCount = 2;
 	renderPassBeginInfo.pClearValues = clearValues;
 
-	for (int32_t i = 0; i < m_pWRenderer->m_DrawCmdBuffers.size(); ++i)
-	{
-		// Set target frame buffer
-		renderPassBeginInfo.framebuffer = m_pWRenderer->m_FrameBuffers[i];
-
-		VK_CHECK_RESULT(vkBeginCommandBuffer(m_pWRenderer->m_DrawCmdBuffers[i], &cmdBufInfo));
-
-		// Start the first sub pass specified in our default render pass setup by the base class
-		// This will clear the color and depth attachment
-		vkCmdBeginRenderPass(m_pWRenderer->m_DrawCmdBuffers[i], &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
-
-		// Update dynamic viewport state
-		VkViewport viewport = {};
-		viewport.height = (float)g_iDesktopHeight;
-		viewport.width = (float)g_iDesktopWidth;
-		viewport.minDepth = (float) 0.0f;
-		viewport.maxDepth = (float) 1.0f;
-		vkCmdSetViewport(m_pWRenderer->m_DrawCmdBuffers[i], 0, 1, &viewport);
-
-		// Update dynamic scissor state
-		VkRect2D scissor = {};
-		scissor.extent.width = g_iDesktopWidth;
-		scissor.extent.height = g_iDesktopHeight;
-		scissor.offset.x = 0;
-		scissor.offset.y = 0;
-		vkCmdSetScissor(m_pWRenderer->m_DrawCmdBuffers[i], 0, 1, &scissor);
-
-		// Bind descriptor sets describing shader binding points
-		vkCmdBindDescriptorSets(m_pWRenderer->m_DrawCmdBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &descriptorSet, 0, NULL);
-
-		// Bind the rendering pipeline
-		// The pipeline (state object) contains all states of the rendering pipeline
-		// So once we bind a pipeline all states that were set upon creation of that
-		// pipeline will be set
-		vkCmdBindPipeline(m_pWRenderer->m_DrawCmdBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
-
-		// Bind triangle vertex buffer (contains position and colors)
-		VkDeviceSize offsets[1] = { 0 };
-		vkCmdBindVertexBuffers(m_pWRenderer->m_DrawCmdBuffers[i], VERTEX_BUFFER_BIND_ID, 1, &vertices.buf, offsets);
-
-		// Bind triangle index buffer
-		vkCmdBindIndexBuffer(m_pWRenderer->m_DrawCmdBuffers[i], indices.buf, 0, VK_INDEX_TYPE_UINT32);
-
-		// Draw indexed triangle
-		vkCmdDrawIndexed(m_pWRenderer->m_DrawCmdBuffers[i], indices.count, 1, 0, 0, 1);
-
-		vkCmdEndRenderPass(m_pWRenderer->m_DrawCmdBuffers[i]);
-
-		// Add a present memory barrier to the end of the command buffer
-		// This will transform the frame buffer color attachment to a
-		// new layout for presenting it to the windowing system integration 
-		VkImageMemoryBarrier prePresentBarrier = {};
-		prePresentBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-		prePresentBarrier.pNext = NULL;
-		prePresentBarrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-		prePresentBarrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
-		prePresentBarrier.oldLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-		prePresentBarrier.newLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
-		prePresentBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-		prePresentBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-		prePresentBarrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
-		prePresentBarrier.image = m_pWRenderer->m_SwapChain.buffers[i].image;
-
-		VkImageMemoryBarrier *pMemoryBarrier = &prePresentBarrier;
-		vkCmdPipelineBarrier(
-			m_pWRenderer->m_DrawCmdBuffers[i],
-			VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
-			VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
-			VK_FLAGS_NONE,
-			0, nullptr,
-			0, nullptr,
-			1, &prePresentBarrier);
-
-		VK_CHECK_RESULT(vkEndCommandBuffer(m_pWRenderer->m_DrawCmdBuffers[i]));
-	}
+	// Set target frame buffer
+	renderPassBeginInfo.framebuffer = m_pWRenderer->m_FrameBuffers[i];
+
+	VK_CHECK_RESULT(vkBeginCommandBuffer(m_pWRenderer->m_DrawCmdBuffers[i], &cmdBufInfo));
+
+	// Start the first sub pass specified in our default render pass setup by the base class
+	// This will clear the color and depth attachment
+	vkCmdBeginRenderPass(m_pWRenderer->m_DrawCmdBuffers[i], &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
+
+	// Update dynamic viewport state
+	VkViewport viewport = {};
+	viewport.height = (float)g_iDesktopHeight;
+	viewport.width = (float)g_iDesktopWidth;
+	viewport.minDepth = (float) 0.0f;
+	viewport.maxDepth = (float) 1.0f;
+	vkCmdSetViewport(m_pWRenderer->m_DrawCmdBuffers[i], 0, 1, &viewport);
+
+	// Update dynamic scissor state
+	VkRect2D scissor = {};
+	scissor.extent.width = g_iDesktopWidth;
+	scissor.extent.height = g_iDesktopHeight;
+	scissor.offset.x = 0;
+	scissor.offset.y = 0;
+	vkCmdSetScissor(m_pWRenderer->m_DrawCmdBuffers[i], 0, 1, &scissor);
+
+	// Bind descriptor sets describing shader binding points
+	vkCmdBindDescriptorSets(m_pWRenderer->m_DrawCmdBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &descriptorSet, 1, &uniformOffset);
+
+	// Bind the rendering pipeline
+	// The pipeline (state object) contains all states of the rendering pipeline
+	// So once we bind a pipeline all states that were set upon creation of that
+	// pipeline will be set
+	vkCmdBindPipeline(m_pWRenderer->m_DrawCmdBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+
+	// Bind triangle vertex buffer (contains position and colors)
+	VkDeviceSize offsets[1] = { 0 };
+	vkCmdBindVertexBuffers(m_pWRenderer->m_DrawCmdBuffers[i], VERTEX_BUFFER_BIND_ID, 1, &vertices.buf, offsets);
+
+	// Bind triangle index buffer
+	vkCmdBindIndexBuffer(m_pWRenderer->m_DrawCmdBuffers[i], indices.buf, 0, VK_INDEX_TYPE_UINT32);
+
+	// Draw indexed triangle
+	vkCmdDrawIndexed(m_pWRenderer->m_DrawCmdBuffers[i], indices.count, 1, 0, 0, 1);
+
+	vkCmdEndRenderPass(m_pWRenderer->m_DrawCmdBuffers[i]);
+
+	// Add a present memory barrier to the end of the command buffer
+	// This will transform the frame buffer color attachment to a
+	// new layout for presenting it to the windowing system integration 
+	VkImageMemoryBarrier prePresentBarrier = {};
+	prePresentBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	prePresentBarrier.pNext = NULL;
+	prePresentBarrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+	prePresentBarrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
+	prePresentBarrier.oldLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+	prePresentBarrier.newLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+	prePresentBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	prePresentBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	prePresentBarrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+	prePresentBarrier.image = m_pWRenderer->m_SwapChain.buffers[i].image;
+
+	VkImageMemoryBarrier *pMemoryBarrier = &prePresentBarrier;
+	vkCmdPipelineBarrier(
+		m_pWRenderer->m_DrawCmdBuffers[i],
+		VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+		VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+		VK_FLAGS_NONE,
+		0, nullptr,
+		0, nullptr,
+		1, &prePresentBarrier);
+
+	VK_CHECK_RESULT(vkEndCommandBuffer(m_pWRenderer->m_DrawCmdBuffers[i]));
 }
 
 void Renderer::UpdateUniformBuffers()
@@ -371,55 +337,13 @@ void Renderer::UpdateUniformBuffers()
 
 	m_uboVS.viewPos = glm::vec4(0.0f, 0.0f, -5.0f, 0.0f);
 
-	// Map uniform buffer and update it
-	uint8_t *pData;
-	VK_CHECK_RESULT(vkMapMemory(m_pWRenderer->m_SwapChain.device, uniformDataVS.memory, 0, sizeof(m_uboVS), 0, (void **)&pData));
-	memcpy(pData, &m_uboVS, sizeof(m_uboVS));
-	vkUnmapMemory(m_pWRenderer->m_SwapChain.device, uniformDataVS.memory);
+	//StartFrame copies the block to the vertex cache, frames in flight keep reading their own copy
 }
 
 void Renderer::PrepareUniformBuffers()
 {
-	// Prepare and initialize a uniform buffer block containing shader uniforms
-	// In Vulkan there are no more single uniforms like in GL
-	// All shader uniforms are passed as uniform buffer blocks 
-	VkMemoryRequirements memReqs;
-
-	// Vertex shader uniform buffer block
-	VkBufferCreateInfo bufferInfo = {};
-	VkMemoryAllocateInfo allocInfo = {};
-	allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-	allocInfo.pNext = NULL;
-	allocInfo.allocationSize = 0;
-	allocInfo.memoryTypeIndex = 0;
-
-	bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-	bufferInfo.size = sizeof(m_uboVS);
-	bufferInfo.usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT;
-
-	// Create a new buffer
-	VK_CHECK_RESULT(vkCreateBuffer(m_pWRenderer->m_SwapChain.device, &bufferInfo, nullptr, &uniformDataVS.buffer));
-	// Get memory requirements including size, alignment and memory type 
-	vkGetBufferMemoryRequirements(m_pWRenderer->m_SwapChain.device, uniformDataVS.buffer, &memReqs);
-	allocInfo.allocationSize = memReqs.size;
-	// Get the memory type index that supports host visibile memory access
-	// Most implementations offer multiple memory tpyes and selecting the 
-	// correct one to allocate memory from is important
-	// We also want the buffer to be host coherent so we don't have to flush 
-	// after every update. 
-	// Note that this may affect performance so you might not want to do this 
-	// in a real world application that updates buffers on a regular base
-	allocInfo.memoryTypeIndex = VkTools::GetMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, m_pWRenderer->m_DeviceMemoryProperties);
-	// Allocate memory for the uniform buffer
-	VK_CHECK_RESULT(vkAllocateMemory(m_pWRenderer->m_SwapChain.device, &allocInfo, nullptr, &(uniformDataVS.memory)));
-	// Bind memory to buffer
-	VK_CHECK_RESULT(vkBindBufferMemory(m_pWRenderer->m_SwapChain.device, uniformDataVS.buffer, uniformDataVS.memory, 0));
-
-	// Store information in the uniform's descriptor
-	uniformDataVS.descriptor.buffer = uniformDataVS.buffer;
-	uniformDataVS.descriptor.offset = 0;
-	uniformDataVS.descriptor.range = sizeof(m_uboVS);
-
+	// Vertex shader uniform block lives in the vertex cache uniform buffer,
+	// bound as a dynamic uniform buffer and selected per frame with uniformHandle.offset
 	UpdateUniformBuffers();
 }
 
@@ -864,7 +788,7 @@ void Renderer::SetupDescriptorSetLayout()
 	std::vector<VkDescriptorSetLayoutBinding> setLayoutBindings =
 	{
 		// Binding 0 : Vertex shader uniform buffer
-		VkTools::Initializer::DescriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,VK_SHADER_STAGE_VERTEX_BIT,0),
+		VkTools::Initializer::DescriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,VK_SHADER_STAGE_VERTEX_BIT,0),
 
 		// Binding 1 : Fragment shader image sampler Normal Map
 		VkTools::Initializer::DescriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,VK_SHADER_STAGE_FRAGMENT_BIT,1),
@@ -885,7 +809,7 @@ void Renderer::SetupDescriptorPool()
 	// Example uses one ubo and one image sampler
 	std::vector<VkDescriptorPoolSize> poolSizes =
 	{
-		VkTools::Initializer::DescriptorPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1),
+		VkTools::Initializer::DescriptorPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1),
 		VkTools::Initializer::DescriptorPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 2)
 	};
 
@@ -905,11 +829,12 @@ void Renderer::SetupDescriptorSet()
 
 	//Image descriptor for the diffuseMap
 	VkDescriptorImageInfo diffuseTexDescriptor = VkTools::Initializer::DescriptorImageInfo(m_DiffuseTexture.sampler, m_DiffuseTexture.view, VK_IMAGE_LAYOUT_GENERAL);
+	VkDescriptorBufferInfo uniformDescriptor = vertexCache.UniformDescriptor(sizeof(m_uboVS));
 
 	std::vector<VkWriteDescriptorSet> writeDescriptorSets =
 	{
 		// Binding 0 : Vertex shader uniform buffer
-		VkTools::Initializer::WriteDescriptorSet(descriptorSet,VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,	0,&uniformDataVS.descriptor),
+		VkTools::Initializer::WriteDescriptorSet(descriptorSet,VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,	0,&uniformDescriptor),
 	
 		// Binding 1 : Fragment shader texture sampler Normal Map
 		VkTools::Initializer::WriteDescriptorSet(descriptorSet,VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1,&normalTexDescriptor),
@@ -924,53 +849,38 @@ void Renderer::SetupDescriptorSet()
 
 void Renderer::StartFrame()
 {
-	{
-		// Get next image in the swap chain (back/front buffer)
-		VK_CHECK_RESULT(m_pWRenderer->m_SwapChain.GetNextImage(Semaphores.presentComplete, &m_pWRenderer->m_currentBuffer));
-
-		// Submit the post present image barrier to transform the image back to a color attachment
-		// that can be used to write to by our render pass
-		VkSubmitInfo submitInfo = VkTools::Initializer::SubmitInfo();
-		submitInfo.commandBufferCount = 1;
-		submitInfo.pCommandBuffers = &m_pWRenderer->m_PostPresentCmdBuffers[m_pWRenderer->m_currentBuffer];
-
-		VK_CHECK_RESULT(vkQueueSubmit(m_pWRenderer->m_Queue, 1, &submitInfo, VK_NULL_HANDLE));
-
-		// Make sure that the image barrier command submitted to the queue 
-		// has finished executing
-		VK_CHECK_RESULT(vkQueueWaitIdle(m_pWRenderer->m_Queue));
-	}
-
+	// Get next image in the swap chain (back/front buffer).
+	// Waits only if a frame still in flight rendered to the same image
+	VK_CHECK_RESULT(frameManager->AcquireImage(m_pWRenderer->m_SwapChain, &m_pWRenderer->m_currentBuffer));
 
+	//Matrices go to a new uniform offset every frame, the command buffer of the image is free again
+	uniformHandle = vertexCache.AllocUniform(&m_uboVS, sizeof(m_uboVS));
+	BuildCommandBuffer(m_pWRenderer->m_currentBuffer);
 
 	{
 		// The submit infor strcuture contains a list of
 		// command buffers and semaphores to be submitted to a queue
-		// If you want to submit multiple command buffers, pass an array
-		VkPipelineStageFlags pipelineStages = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+		// Post present barrier transforms the image back to a color attachment once it is acquired
+		VkPipelineStageFlags pipelineStages = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+		VkSemaphore imageAcquired = frameManager->ImageAcquiredSemaphore();
+		VkSemaphore renderComplete = frameManager->RenderCompleteSemaphore();
+		VkCommandBuffer cmds[] = { frameManager->BeginFrameTimer(), m_pWRenderer->m_PostPresentCmdBuffers[m_pWRenderer->m_currentBuffer], m_pWRenderer->m_DrawCmdBuffers[m_pWRenderer->m_currentBuffer] };
+
 		VkSubmitInfo submitInfo = VkTools::Initializer::SubmitInfo();
 		submitInfo.pWaitDstStageMask = &pipelineStages;
-		// The wait semaphore ensures that the image is presented 
-		// before we start submitting command buffers agein
 		submitInfo.waitSemaphoreCount = 1;
-		submitInfo.pWaitSemaphores = &Semaphores.presentComplete;
-		// Submit the currently active command buffer
-		submitInfo.commandBufferCount = 1;
-		submitInfo.pCommandBuffers = &m_pWRenderer->m_DrawCmdBuffers[m_pWRenderer->m_currentBuffer];
-		// The signal semaphore is used during queue presentation
-		// to ensure that the image is not rendered before all
-		// commands have been submitted
+		submitInfo.pWaitSemaphores = &imageAcquired;
+		submitInfo.commandBufferCount = 3;
+		submitInfo.pCommandBuffers = cmds;
 		submitInfo.signalSemaphoreCount = 1;
-		submitInfo.pSignalSemaphores = &Semaphores.renderComplete;
+		submitInfo.pSignalSemaphores = &renderComplete;
 
 		// Submit to the graphics queue
 		VK_CHECK_RESULT(vkQueueSubmit(m_pWRenderer->m_Queue, 1, &submitInfo, VK_NULL_HANDLE));
 
-		// Present the current buffer to the swap chain
-		// We pass the signal semaphore from the submit info
-		// to ensure that the image is not rendered until
-		// all commands have been submitted
-		VK_CHECK_RESULT(m_pWRenderer->m_SwapChain.QueuePresent(m_pWRenderer->m_Queue, m_pWRenderer->m_currentBuffer, Semaphores.renderComplete));
+		// Present the current buffer to the swap chain once the whole frame has been rendered.
+		// EndFrame fences the frame, there is no wait for the queue here
+		VK_CHECK_RESULT(m_pWRenderer->m_SwapChain.QueuePresent(m_pWRenderer->m_Queue, m_pWRenderer->m_currentBuffer, renderComplete));
 	}
 }
 
@@ -1003,6 +913,9 @@ int main()
 	{
 		if (!GenerateEvents(msg))break;
 
+		//Fixed time step while benchmarking
+		g_Renderer.UpdateBenchmark(nullptr);
+
 		auto tStart = std::chrono::high_resolution_clock::now();
 		g_Renderer.StartFrame();
 		//Do something
@@ -1169,6 +1082,18 @@ LRESULT CALLBACK HandleWindowMessages(HWND hWnd, UINT uMsg, WPARAM wParam, LPARA
 
 bool GenerateEvents(MSG& msg)
 {
+	//Benchmark ends with its camera path, the report is written by then
+	if (g_Renderer.IsBenchmarkFinished())
+	{
+		return false;
+	}
+
+	//No window to pump messages for, the run ends after its frame count
+	if (g_Renderer.IsHeadless())
+	{
+		return !g_Renderer.IsHeadlessFinished();
+	}
+
 	if (PeekMessage(&msg, NULL, 0, 0, PM_REMOVE))
 	{
 		if (msg.message == WM_QUIT)
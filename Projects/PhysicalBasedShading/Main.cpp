@@ -4,7 +4,7 @@
 *	This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
 */
 
-#include <RendererPch\stdafx.h>
+#include <RendererPch/stdafx.h>
 #include <iomanip>
 
 //Triangle Includes
@@ -12,29 +12,31 @@
 #include <conio.h>
 
 //Renderer Includes
-#include <Renderer\VKRenderer.h>
-#include <Renderer\Vulkan\VulkanTools.h>
-#include <Renderer\Vulkan\VulkanTextureLoader.h>
+#include <Renderer/VKRenderer.h>
+#include <Renderer/VertexCache.h>
+#include <Renderer/Vulkan/VulkanTools.h>
+#include <Renderer/Vulkan/VulkanTextureLoader.h>
 
 //Model Loader Includes
-#include <Renderer\MeshLoader\Model_local.h>
-#include <Renderer\MeshLoader\ImageManager.h>
-#include <Renderer\MeshLoader\Material.h>
+#include <Renderer/MeshLoader/Model_local.h>
+#include <Renderer/MeshLoader/ImageManager.h>
+#include <Renderer/MeshLoader/Material.h>
 
 //Vulkan Includes
-#include <Renderer\Vulkan\VkBufferObject.h>
-#include <Renderer\Vulkan\VulkanSwapChain.h>
+#include <Renderer/Vulkan/VkBufferObject.h>
+#include <Renderer/Vulkan/VulkanSwapChain.h>
+#include <Renderer/Vulkan/VulkanFrameManager.h>
 
 
 //Font Rendering
-#include <Renderer\ThirdParty\ImGui\imgui.h>
+#include <Renderer/ThirdParty/ImGui/imgui.h>
 
 
 //math
-#include <External\glm\glm\gtc\matrix_inverse.hpp>
+#include <External/glm/glm/gtc/matrix_inverse.hpp>
 
 //ImGui
-#include <Renderer\ThirdParty\ImGui\imgui.h>
+#include <Renderer/ThirdParty/ImGui/imgui.h>
 
 
 //Global variables
@@ -98,25 +100,17 @@ private:
 	VkPipelineLayout pipelineLayout;
 	VkDescriptorSet descriptorSet;
 	VkDescriptorSetLayout descriptorSetLayout;
-	VkCommandBuffer  cmdGui;
 
+	// Swap chain acquire and present semaphores belong to frameManager
 	struct
 	{
-		// Swap chain image presentation
-		VkSemaphore presentComplete;
 		// Command buffer submission and execution
 		VkSemaphore renderComplete;
-		// Text overlay submission and execution
-		VkSemaphore textOverlayComplete;
-		//Imgui sumbission and excetuion
-		VkSemaphore guiComplete;
 	} Semaphores;
 public:
 	RenderModelStatic			  staticModel;
 	VkTools::VulkanTexture		  m_VkTexture;
 
-	std::vector<VkBufferObject_s> listLocalBuffers;
-	std::vector<uint32_t>		  meshSize;
 
 	struct {
 		glm::mat4 projectionMatrix;
@@ -139,11 +133,9 @@ public:
 		float	  ScreenGamma;
 	}m_UniformShaderData;
 
-	struct
-	{
-		VkTools::UniformData shaderData;
-		VkTools::UniformData uniformDataVS;
-	}m_descriptors;
+	//m_uboVS and m_UniformShaderData copied to the vertex cache for the frame that is being recorded
+	vertCacheHandle_t uniformHandle;
+	vertCacheHandle_t shaderDataHandle;
 
 	uint32_t numVerts;
 	uint32_t numUvs;
@@ -153,6 +145,7 @@ public:
 	~Renderer();
 
 	void BuildCommandBuffers() override;
+	void BuildCommandBuffer(uint32_t i);
 	void UpdateUniformBuffers() override;
 	void PrepareUniformBuffers() override;
 	void PrepareVertices(bool useStagingBuffers) override;
@@ -197,10 +190,7 @@ void Renderer::PrepareSemaphore()
 	semaphoreCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
 	semaphoreCreateInfo.pNext = NULL;
 
-	VK_CHECK_RESULT(vkCreateSemaphore(m_pWRenderer->m_SwapChain.device, &semaphoreCreateInfo, nullptr, &Semaphores.presentComplete));
 	VK_CHECK_RESULT(vkCreateSemaphore(m_pWRenderer->m_SwapChain.device, &semaphoreCreateInfo, nullptr, &Semaphores.renderComplete));
-	VK_CHECK_RESULT(vkCreateSemaphore(m_pWRenderer->m_SwapChain.device, &semaphoreCreateInfo, nullptr, &Semaphores.textOverlayComplete));
-	VK_CHECK_RESULT(vkCreateSemaphore(m_pWRenderer->m_SwapChain.device, &semaphoreCreateInfo, nullptr, &Semaphores.guiComplete));
 }
 
 
@@ -212,33 +202,13 @@ Renderer::Renderer()
 Renderer::~Renderer()
 {
 
-	//Delete memory
-	for (int i = 0; i < listLocalBuffers.size(); i++)
-	{
-		VkBufferObject::DeleteBufferMemory(m_pWRenderer->m_SwapChain.device, listLocalBuffers[i], nullptr);
-	}
-
 	//Delete data from static model
 	staticModel.Clear(m_pWRenderer->m_SwapChain.device);
 
 
-	//Destroy Shader Module
-	for (int i = 0; i < m_ShaderModules.size(); i++)
-	{
-		vkDestroyShaderModule(m_pWRenderer->m_SwapChain.device, m_ShaderModules[i], nullptr);
-	}
-
-	//destroy uniform data
-	vkDestroyBuffer(m_pWRenderer->m_SwapChain.device, m_descriptors.uniformDataVS.buffer, nullptr);
-	vkFreeMemory(m_pWRenderer->m_SwapChain.device, m_descriptors.uniformDataVS.memory, nullptr);
-
-	vkDestroyBuffer(m_pWRenderer->m_SwapChain.device, m_descriptors.shaderData.buffer, nullptr);
-	vkFreeMemory(m_pWRenderer->m_SwapChain.device, m_descriptors.shaderData.memory, nullptr);
 
 	//Release semaphores
-	vkDestroySemaphore(m_pWRenderer->m_SwapChain.device, Semaphores.presentComplete, nullptr);
 	vkDestroySemaphore(m_pWRenderer->m_SwapChain.device, Semaphores.renderComplete, nullptr);
-	vkDestroySemaphore(m_pWRenderer->m_SwapChain.device, Semaphores.textOverlayComplete, nullptr);
 
 	//DestroyPipeline
 	vkDestroyPipeline(m_pWRenderer->m_SwapChain.device, pipeline, nullptr);
@@ -251,9 +221,17 @@ Renderer::~Renderer()
 
 void Renderer::BuildCommandBuffers()
 {
-	VkCommandBufferAllocateInfo cmdBufAllocateInfo = VkTools::Initializer::CommandBufferAllocateInfo(m_pWRenderer->m_CmdPool,VK_COMMAND_BUFFER_LEVEL_PRIMARY,1);
-	VK_CHECK_RESULT(vkAllocateCommandBuffers(m_pWRenderer->m_SwapChain.device, &cmdBufAllocateInfo, &cmdGui));
+	for (uint32_t i = 0; i < m_pWRenderer->m_DrawCmdBuffers.size(); ++i)
+	{
+		BuildCommandBuffer(i);
+	}
+}
 
+//Records swap chain image i. Redone every frame, the uniform blocks move to new offsets each frame
+void Renderer::BuildCommandBuffer(uint32_t i)
+{
+	//Binding 0 and binding 1, in binding order
+	const uint32_t uniformOffsets[] = { static_cast<uint32_t>(uniformHandle.offset), static_cast<uint32_t>(shaderDataHandle.offset) };
 
 	VkCommandBufferBeginInfo cmdBufInfo = {};
 	cmdBufInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
@@ -277,89 +255,81 @@ void Renderer::BuildCommandBuffers()
 	renderPassBeginInfo.clearValueCount = 2;
 	renderPassBeginInfo.pClearValues = clearValues;
 
-	for (int32_t i = 0; i < m_pWRenderer->m_DrawCmdBuffers.size(); ++i)
-	{
+	// Set target frame buffer
+	renderPassBeginInfo.framebuffer = m_pWRenderer->m_FrameBuffers[i];
 
-		// Set target frame buffer
-		renderPassBeginInfo.framebuffer = m_pWRenderer->m_FrameBuffers[i];
+	VK_CHECK_RESULT(vkBeginCommandBuffer(m_pWRenderer->m_DrawCmdBuffers[i], &cmdBufInfo));
 
-		VK_CHECK_RESULT(vkBeginCommandBuffer(m_pWRenderer->m_DrawCmdBuffers[i], &cmdBufInfo));
+	// Start the first sub pass specified in our default render pass setup by the base class
+	// This will clear the color and depth attachment
+	vkCmdBeginRenderPass(m_pWRenderer->m_DrawCmdBuffers[i], &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
 
-		// Start the first sub pass specified in our default render pass setup by the base class
-		// This will clear the color and depth attachment
-		vkCmdBeginRenderPass(m_pWRenderer->m_DrawCmdBuffers[i], &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
+	// Update dynamic viewport state
+	VkViewport viewport = {};
+	viewport.height = (float)g_iDesktopHeight;
+	viewport.width = (float)g_iDesktopWidth;
+	viewport.minDepth = 0.0f;
+	viewport.maxDepth = 1.0f;
+	vkCmdSetViewport(m_pWRenderer->m_DrawCmdBuffers[i], 0, 1, &viewport);
 
-		// Update dynamic viewport state
-		VkViewport viewport = {};
-		viewport.height = (float)g_iDesktopHeight;
-		viewport.width = (float)g_iDesktopWidth;
-		viewport.minDepth = 0.0f;
-		viewport.maxDepth = 1.0f;
-		vkCmdSetViewport(m_pWRenderer->m_DrawCmdBuffers[i], 0, 1, &viewport);
+	// Update dynamic scissor state
+	VkRect2D scissor = {};
+	scissor.extent.width = g_iDesktopWidth;
+	scissor.extent.height = g_iDesktopHeight;
+	scissor.offset.x = 0;
+	scissor.offset.y = 0;
+	vkCmdSetScissor(m_pWRenderer->m_DrawCmdBuffers[i], 0, 1, &scissor);
 
-		// Update dynamic scissor state
-		VkRect2D scissor = {};
-		scissor.extent.width = g_iDesktopWidth;
-		scissor.extent.height = g_iDesktopHeight;
-		scissor.offset.x = 0;
-		scissor.offset.y = 0;
-		vkCmdSetScissor(m_pWRenderer->m_DrawCmdBuffers[i], 0, 1, &scissor);
 
+	// Bind the rendering pipeline
+	// The pipeline (state object) contains all states of the rendering pipeline
+	// So once we bind a pipeline all states that were set upon creation of that
+	// pipeline will be set
+	vkCmdBindPipeline(m_pWRenderer->m_DrawCmdBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
 
-		// Bind the rendering pipeline
-		// The pipeline (state object) contains all states of the rendering pipeline
-		// So once we bind a pipeline all states that were set upon creation of that
-		// pipeline will be set
-		vkCmdBindPipeline(m_pWRenderer->m_DrawCmdBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
-
-
-		// Bind triangle vertex buffer (contains position and colors)
-		VkDeviceSize offsets[1] = { 0 };
-
-		// Bind descriptor sets describing shader binding points
-		vkCmdBindDescriptorSets(m_pWRenderer->m_DrawCmdBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &descriptorSet, 0, NULL);
-		for (int j = 0; j < listLocalBuffers.size(); j++)
-		{
-			//Bind Buffer
-			vkCmdBindVertexBuffers(m_pWRenderer->m_DrawCmdBuffers[i], VERTEX_BUFFER_BIND_ID, 1, &listLocalBuffers[j].buffer, offsets);
 
-			//Draw
-			vkCmdDraw(m_pWRenderer->m_DrawCmdBuffers[i], meshSize[j], 1, 0, 0);
-		}
+	// Bind descriptor sets describing shader binding points
+	vkCmdBindDescriptorSets(m_pWRenderer->m_DrawCmdBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &descriptorSet, 2, uniformOffsets);
+	// All surfaces share one vertex and index buffer
+	staticModel.BindBuffers(m_pWRenderer->m_DrawCmdBuffers[i], VERTEX_BUFFER_BIND_ID);
+	for (int j = 0; j < staticModel.surfaces.size(); j++)
+	{
+		//Draw
+		vkCmdDrawIndexed(m_pWRenderer->m_DrawCmdBuffers[i], staticModel.surfaces[j].indexCount, 1, staticModel.surfaces[j].firstIndex, staticModel.surfaces[j].vertexOffset, 0);
+	}
 
 
-		vkCmdEndRenderPass(m_pWRenderer->m_DrawCmdBuffers[i]);
-
-		/*
-		// Add a present memory barrier to the end of the command buffer
-		// This will transform the frame buffer color attachment to a
-		// new layout for presenting it to the windowing system integration 
-		VkImageMemoryBarrier prePresentBarrier = {};
-		prePresentBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-		prePresentBarrier.pNext = NULL;
-		prePresentBarrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-		prePresentBarrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
-		prePresentBarrier.oldLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-		prePresentBarrier.newLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
-		prePresentBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-		prePresentBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-		prePresentBarrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
-		prePresentBarrier.image = m_pWRenderer->m_SwapChain.buffers[i].image;
-
-		VkImageMemoryBarrier *pMemoryBarrier = &prePresentBarrier;
-		vkCmdPipelineBarrier(
-			m_pWRenderer->m_DrawCmdBuffers[i],
-			VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
-			VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
-			VK_FLAGS_NONE,
-			0, nullptr,
-			0, nullptr,
-			1, &prePresentBarrier);
-
-		*/
-		VK_CHECK_RESULT(vkEndCommandBuffer(m_pWRenderer->m_DrawCmdBuffers[i]));
+	vkCmdEndRenderPass(m_pWRenderer->m_DrawCmdBuffers[i]);
+
+	/*
+	// Add a present memory barrier to the end of the command buffer
+	// This will transform the frame buffer color attachment to a
+	// new layout for presenting it to the windowing system integration 
+	VkImageMemoryBarrier prePresentBarrier = {};
+	prePresentBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	prePresentBarrier.pNext = NULL;
+	prePresentBarrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+	prePresentBarrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
+	prePresentBarrier.oldLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+	prePresentBarrier.newLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+	prePresentBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	prePresentBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	prePresentBarrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+	prePresentBarrier.image = m_pWRenderer->m_SwapChain.buffers[i].image;
+
+	VkImageMemoryBarrier *pMemoryBarrier = &prePresentBarrier;
+	vkCmdPipelineBarrier(
+		m_pWRenderer->m_DrawCmdBuffers[i],
+		VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+		VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+		VK_FLAGS_NONE,
+		0, nullptr,
+		0, nullptr,
+		1, &prePresentBarrier);
+
+	*/
+	VK_CHECK_RESULT(vkEndCommandBuffer(m_pWRenderer->m_DrawCmdBuffers[i]));
 
-	}
 }
 
 void Renderer::UpdateUniformBuffers()
@@ -376,22 +346,9 @@ void Renderer::UpdateUniformBuffers()
 		m_uboVS.normal = (glm::inverseTranspose(m_uboVS.viewMatrix * m_uboVS.modelMatrix));
 
 		m_uboVS.viewPos = glm::vec4(0.0f, 0.0f, -15.0f, 0.0f);
-
-		// Map uniform buffer and update it
-		uint8_t *pData;
-		VK_CHECK_RESULT(vkMapMemory(m_pWRenderer->m_SwapChain.device, m_descriptors.uniformDataVS.memory, 0, sizeof(m_uboVS), 0, (void **)&pData));
-		memcpy(pData, &m_uboVS, sizeof(m_uboVS));
-		vkUnmapMemory(m_pWRenderer->m_SwapChain.device, m_descriptors.uniformDataVS.memory);
 	}
 
-
-	{
-		// Map uniform buffer and update it
-		uint8_t *pData;
-		VK_CHECK_RESULT(vkMapMemory(m_pWRenderer->m_SwapChain.device, m_descriptors.shaderData.memory, 0, sizeof(m_UniformShaderData), 0, (void **)&pData));
-		memcpy(pData, &m_UniformShaderData, sizeof(m_UniformShaderData));
-		vkUnmapMemory(m_pWRenderer->m_SwapChain.device, m_descriptors.shaderData.memory);
-	}
+	//StartFrame copies both blocks to the vertex cache, frames in flight keep reading their own copy
 }
 
 void Renderer::PrepareUniformBuffers()
@@ -399,64 +356,8 @@ void Renderer::PrepareUniformBuffers()
 	//Set data first
 	SetupShaderData();
 
-	{
-		VkMemoryRequirements memReqs;
-
-		// Vertex shader uniform buffer block
-		VkBufferCreateInfo bufferInfo = {};
-		VkMemoryAllocateInfo allocInfo = {};
-		allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-		allocInfo.pNext = NULL;
-		allocInfo.allocationSize = 0;
-		allocInfo.memoryTypeIndex = 0;
-
-		bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-		bufferInfo.size = sizeof(m_uboVS);
-		bufferInfo.usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT;
-
-		// Create a new buffer
-		VK_CHECK_RESULT(vkCreateBuffer(m_pWRenderer->m_SwapChain.device, &bufferInfo, nullptr, &m_descriptors.uniformDataVS.buffer));
-		vkGetBufferMemoryRequirements(m_pWRenderer->m_SwapChain.device, m_descriptors.uniformDataVS.buffer, &memReqs);
-		allocInfo.allocationSize = memReqs.size;
-		allocInfo.memoryTypeIndex = VkTools::GetMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, m_pWRenderer->m_DeviceMemoryProperties);
-		VK_CHECK_RESULT(vkAllocateMemory(m_pWRenderer->m_SwapChain.device, &allocInfo, nullptr, &(m_descriptors.uniformDataVS.memory)));
-		VK_CHECK_RESULT(vkBindBufferMemory(m_pWRenderer->m_SwapChain.device, m_descriptors.uniformDataVS.buffer, m_descriptors.uniformDataVS.memory, 0));
-
-		m_descriptors.uniformDataVS.descriptor.buffer = m_descriptors.uniformDataVS.buffer;
-		m_descriptors.uniformDataVS.descriptor.offset = 0;
-		m_descriptors.uniformDataVS.descriptor.range = sizeof(m_uboVS);
-	}
-
-
-	{
-		VkMemoryRequirements memReqs;
-
-		// Vertex shader uniform buffer block
-		VkBufferCreateInfo bufferInfo = {};
-		VkMemoryAllocateInfo allocInfo = {};
-		allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-		allocInfo.pNext = NULL;
-		allocInfo.allocationSize = 0;
-		allocInfo.memoryTypeIndex = 0;
-
-		bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-		bufferInfo.size = sizeof(m_UniformShaderData);
-		bufferInfo.usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT;
-
-		// Create a new buffer
-		VK_CHECK_RESULT(vkCreateBuffer(m_pWRenderer->m_SwapChain.device, &bufferInfo, nullptr, &m_descriptors.shaderData.buffer));
-		vkGetBufferMemoryRequirements(m_pWRenderer->m_SwapChain.device, m_descriptors.shaderData.buffer, &memReqs);
-		allocInfo.allocationSize = memReqs.size;
-		allocInfo.memoryTypeIndex = VkTools::GetMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, m_pWRenderer->m_DeviceMemoryProperties);
-		VK_CHECK_RESULT(vkAllocateMemory(m_pWRenderer->m_SwapChain.device, &allocInfo, nullptr, &(m_descriptors.shaderData.memory)));
-		VK_CHECK_RESULT(vkBindBufferMemory(m_pWRenderer->m_SwapChain.device, m_descriptors.shaderData.buffer, m_descriptors.shaderData.memory, 0));
-
-		// Store information in the uniform's descriptor
-		m_descriptors.shaderData.descriptor.buffer = m_descriptors.shaderData.buffer;
-		m_descriptors.shaderData.descriptor.offset = 0;
-		m_descriptors.shaderData.descriptor.range = sizeof(m_UniformShaderData);
-	}
-
+	// Both uniform blocks live in the vertex cache uniform buffer, bound as dynamic
+	// uniform buffers and selected per frame with the handle offsets
 	UpdateUniformBuffers();
 }
 
@@ -465,9 +366,6 @@ void Renderer::PrepareVertices(bool useStagingBuffers)
 	staticModel.InitFromFile("Geometry/teapot/teapotTriangulated.obj", GetAssetPath());
 
 
-	std::vector<VkBufferObject_s> listStagingBuffers;
-	listLocalBuffers.resize(staticModel.surfaces.size());
-	listStagingBuffers.resize(staticModel.surfaces.size());
 
 	for (int i = 0; i < staticModel.surfaces.size(); i++) 
 	{
@@ -475,45 +373,14 @@ void Renderer::PrepareVertices(bool useStagingBuffers)
 		srfTriangles_t* tr = staticModel.surfaces[i].geometry;
 
 
-		//Create stagging buffer first
-		VkBufferObject::CreateBuffer(
-			m_pWRenderer->m_SwapChain,
-			m_pWRenderer->m_DeviceMemoryProperties,
-			VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT,
-			static_cast<uint32_t>(sizeof(drawVert) * tr->numVerts),
-			listStagingBuffers[i],
-			tr->verts);
-
-		//Create Local Copy
-		VkBufferObject::CreateBuffer(
-			m_pWRenderer->m_SwapChain,
-			m_pWRenderer->m_DeviceMemoryProperties,
-			VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-			static_cast<uint32_t>(sizeof(drawVert) * tr->numVerts),
-			listLocalBuffers[i]);
-
-
-		//Create new command buffer
-		VkCommandBuffer copyCmd = GetCommandBuffer(true);
-
-
-		//Submit info to the queue
-		VkBufferObject::SubmitBufferObjects(
-			copyCmd,
-			m_pWRenderer->m_Queue,
-			*m_pWRenderer,
-			static_cast<uint32_t>(sizeof(drawVert) * tr->numVerts),
-			listStagingBuffers[i],
-			listLocalBuffers[i], (drawVertFlags::Vertex | drawVertFlags::Normal | drawVertFlags::Uv | drawVertFlags::Tangent | drawVertFlags::Binormal));
-
-		meshSize.push_back(tr->numVerts);
 
 		numVerts += tr->numVerts;
 		numUvs += tr->numVerts;
 		numNormals += tr->numVerts;
 	}
+
+	//One vertex and one index buffer for the whole model
+	staticModel.CreateBuffers(m_pWRenderer->m_SwapChain, m_pWRenderer->m_DeviceMemoryProperties);
 }
 
 
@@ -583,7 +450,7 @@ void Renderer::PreparePipeline()
 	// Create Pipeline state VI-IA-VS-VP-RS-FS-CB
 	pipelineCreateInfo.stageCount = static_cast<uint32_t>(shaderStages.size());
 	pipelineCreateInfo.pStages = shaderStages.data();
-	pipelineCreateInfo.pVertexInputState = &listLocalBuffers[0].inputState;
+	pipelineCreateInfo.pVertexInputState = &staticModel.vertexBuffer.inputState;
 	pipelineCreateInfo.pInputAssemblyState = &inputAssemblyState;
 	pipelineCreateInfo.pRasterizationState = &rasterizationState;
 	pipelineCreateInfo.pColorBlendState = &colorBlendState;
@@ -613,8 +480,8 @@ void Renderer::SetupDescriptorSetLayout()
 	std::vector<VkDescriptorSetLayoutBinding> setLayoutBindings =
 	{
 		// Binding 0 : Vertex shader uniform buffer
-		VkTools::Initializer::DescriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,VK_SHADER_STAGE_VERTEX_BIT,0),
-		VkTools::Initializer::DescriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,VK_SHADER_STAGE_FRAGMENT_BIT,1),
+		VkTools::Initializer::DescriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,VK_SHADER_STAGE_VERTEX_BIT,0),
+		VkTools::Initializer::DescriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,VK_SHADER_STAGE_FRAGMENT_BIT,1),
 		VkTools::Initializer::DescriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,VK_SHADER_STAGE_FRAGMENT_BIT,2),
 	};
 
@@ -630,7 +497,7 @@ void Renderer::SetupDescriptorPool()
 	// Example uses one ubo and one image sampler
 	std::vector<VkDescriptorPoolSize> poolSizes =
 	{
-		VkTools::Initializer::DescriptorPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 2),
+		VkTools::Initializer::DescriptorPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 2),
 		VkTools::Initializer::DescriptorPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1)
 	};
 
@@ -643,11 +510,13 @@ void Renderer::SetupDescriptorSet()
 {
 	VkDescriptorSetAllocateInfo allocInfo = VkTools::Initializer::DescriptorSetAllocateInfo(m_pWRenderer->m_DescriptorPool, &descriptorSetLayout, 1);
 	VK_CHECK_RESULT(vkAllocateDescriptorSets(m_pWRenderer->m_SwapChain.device, &allocInfo, &descriptorSet));
+	VkDescriptorBufferInfo uniformDescriptor = vertexCache.UniformDescriptor(sizeof(m_uboVS));
+	VkDescriptorBufferInfo shaderDataDescriptor = vertexCache.UniformDescriptor(sizeof(m_UniformShaderData));
 	std::vector<VkWriteDescriptorSet> writeDescriptorSets =
 	{
 		//uniform descriptor
-		VkTools::Initializer::WriteDescriptorSet(descriptorSet,VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,	0, &m_descriptors.uniformDataVS.descriptor),
-		VkTools::Initializer::WriteDescriptorSet(descriptorSet,VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,	1, &m_descriptors.shaderData.descriptor),
+		VkTools::Initializer::WriteDescriptorSet(descriptorSet,VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,	0, &uniformDescriptor),
+		VkTools::Initializer::WriteDescriptorSet(descriptorSet,VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,	1, &shaderDataDescriptor),
 		VkTools::Initializer::WriteDescriptorSet(descriptorSet, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 2, &m_VkTexture.descriptor)
 	};
 	//Update descriptor set
@@ -656,74 +525,51 @@ void Renderer::SetupDescriptorSet()
 
 void Renderer::StartFrame()
 {
+	// Get next image in the swap chain (back/front buffer).
+	// Waits only if a frame still in flight rendered to the same image
+	VK_CHECK_RESULT(frameManager->AcquireImage(m_pWRenderer->m_SwapChain, &m_pWRenderer->m_currentBuffer));
 
-	{
-		// Get next image in the swap chain (back/front buffer)
-		VK_CHECK_RESULT(m_pWRenderer->m_SwapChain.GetNextImage(Semaphores.presentComplete, &m_pWRenderer->m_currentBuffer));
-
-		// Submit the post present image barrier to transform the image back to a color attachment
-		// that can be used to write to by our render pass
-		VkSubmitInfo submitInfo = VkTools::Initializer::SubmitInfo();
-		submitInfo.commandBufferCount = 1;
-		submitInfo.pCommandBuffers = &m_pWRenderer->m_PostPresentCmdBuffers[m_pWRenderer->m_currentBuffer];
-
-		VK_CHECK_RESULT(vkQueueSubmit(m_pWRenderer->m_Queue, 1, &submitInfo, VK_NULL_HANDLE));
-
-		// Make sure that the image barrier command submitted to the queue 
-		// has finished executing
-		VK_CHECK_RESULT(vkQueueWaitIdle(m_pWRenderer->m_Queue));
-	}
-
+	//Blocks go to new uniform offsets every frame, GUI edits show up without waiting for the gpu.
+	//Command buffer of the image is free again
+	uniformHandle = vertexCache.AllocUniform(&m_uboVS, sizeof(m_uboVS));
+	shaderDataHandle = vertexCache.AllocUniform(&m_UniformShaderData, sizeof(m_UniformShaderData));
+	BuildCommandBuffer(m_pWRenderer->m_currentBuffer);
 
+	//ImGUI Render, per frame command buffer recycled once this frame has finished on gpu
+	VkCommandBuffer guiCmd = frameManager->GetCommandBuffer();
+	ImGui_ImplGlfwVulkan_Render(guiCmd, m_pWRenderer->m_currentBuffer);
 
 	{
-		//ImGUI Render
-		ImGui_ImplGlfwVulkan_Render(cmdGui, m_pWRenderer->m_currentBuffer);
-
-
-		//Submit model
-		VkPipelineStageFlags submitPipelineStages = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+		VkPipelineStageFlags submitPipelineStages = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
 		VkPipelineStageFlags stageFlags = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
 		VkSubmitInfo submitInfo = VkTools::Initializer::SubmitInfo();
 
 		//Render model
-		{
-			submitInfo.commandBufferCount = 1;
-			submitInfo.signalSemaphoreCount = 1;
-			submitInfo.waitSemaphoreCount = 1;
-
-			submitInfo.pWaitDstStageMask = &submitPipelineStages;
-			submitInfo.pWaitSemaphores = &Semaphores.presentComplete;
-
-			submitInfo.pSignalSemaphores = &Semaphores.renderComplete;
-			submitInfo.pCommandBuffers = &m_pWRenderer->m_DrawCmdBuffers[m_pWRenderer->m_currentBuffer];
-			VK_CHECK_RESULT(vkQueueSubmit(m_pWRenderer->m_Queue, 1, &submitInfo, VK_NULL_HANDLE));
-		}
-		
-		//Now Render GUI
-		{
-			submitInfo.pWaitDstStageMask = &stageFlags;
-
-			submitInfo.pCommandBuffers = &cmdGui;
-			submitInfo.pWaitSemaphores = &Semaphores.renderComplete;
-			submitInfo.pSignalSemaphores = &Semaphores.guiComplete;
-			VK_CHECK_RESULT(vkQueueSubmit(m_pWRenderer->m_Queue, 1, &submitInfo, VK_NULL_HANDLE));
-		}
-	}
-
-	{
-		// Submit pre present image barrier to transform the image from color attachment to present(khr) for presenting to the swap chain
-		VkSubmitInfo submitInfo = VkTools::Initializer::SubmitInfo();
-		submitInfo.commandBufferCount = 1;
-		submitInfo.pCommandBuffers = &m_pWRenderer->m_PrePresentCmdBuffers[m_pWRenderer->m_currentBuffer];
+		//Post present barrier transforms the image back to a color attachment once it is acquired
+		VkSemaphore imageAcquired = frameManager->ImageAcquiredSemaphore();
+		VkCommandBuffer modelCmds[] = { frameManager->BeginFrameTimer(), m_pWRenderer->m_PostPresentCmdBuffers[m_pWRenderer->m_currentBuffer], m_pWRenderer->m_DrawCmdBuffers[m_pWRenderer->m_currentBuffer] };
+		submitInfo.waitSemaphoreCount = 1;
+		submitInfo.pWaitSemaphores = &imageAcquired;
+		submitInfo.pWaitDstStageMask = &submitPipelineStages;
+		submitInfo.commandBufferCount = 3;
+		submitInfo.pCommandBuffers = modelCmds;
+		submitInfo.signalSemaphoreCount = 1;
+		submitInfo.pSignalSemaphores = &Semaphores.renderComplete;
 		VK_CHECK_RESULT(vkQueueSubmit(m_pWRenderer->m_Queue, 1, &submitInfo, VK_NULL_HANDLE));
 
+		//Now Render GUI, then the pre present barrier transforms the image to present(khr)
+		VkSemaphore renderComplete = frameManager->RenderCompleteSemaphore();
+		VkCommandBuffer guiCmds[] = { guiCmd, m_pWRenderer->m_PrePresentCmdBuffers[m_pWRenderer->m_currentBuffer] };
+		submitInfo.pWaitSemaphores = &Semaphores.renderComplete;
+		submitInfo.pWaitDstStageMask = &stageFlags;
+		submitInfo.commandBufferCount = 2;
+		submitInfo.pCommandBuffers = guiCmds;
+		submitInfo.pSignalSemaphores = &renderComplete;
+		VK_CHECK_RESULT(vkQueueSubmit(m_pWRenderer->m_Queue, 1, &submitInfo, VK_NULL_HANDLE));
 
-		// Present the current buffer to the swap chain
-		// We pass the signal semaphore from the submit info
-		// to ensure that the image is not rendered until
-		// all commands have been submitted
-		VK_CHECK_RESULT(m_pWRenderer->m_SwapChain.QueuePresent(m_pWRenderer->m_Queue, m_pWRenderer->m_currentBuffer, Semaphores.guiComplete));
+		// Present the current buffer to the swap chain once the whole frame has been rendered.
+		// EndFrame fences the frame, there is no wait for the queue here
+		VK_CHECK_RESULT(m_pWRenderer->m_SwapChain.QueuePresent(m_pWRenderer->m_Queue, m_pWRenderer->m_currentBuffer, renderComplete));
 	}
 }
 
@@ -796,6 +642,9 @@ int main()
 	{
 		if (!GenerateEvents(msg))break;
 
+		//Fixed time step while benchmarking
+		g_Renderer.UpdateBenchmark(nullptr);
+
 		auto tStart = std::chrono::high_resolution_clock::now();
 		ImGui_ImplGlfwVulkan_NewFrame(g_Renderer.frameTimer);
 		g_Renderer.ImguiRender();
@@ -923,6 +772,18 @@ LRESULT CALLBACK HandleWindowMessages(HWND hWnd, UINT uMsg, WPARAM wParam, LPARA
 
 bool GenerateEvents(MSG& msg)
 {
+	//Benchmark ends with its camera path, the report is written by then
+	if (g_Renderer.IsBenchmarkFinished())
+	{
+		return false;
+	}
+
+	//No window to pump messages for, the run ends after its frame count
+	if (g_Renderer.IsHeadless())
+	{
+		return !g_Renderer.IsHeadlessFinished();
+	}
+
 	if (PeekMessage(&msg, NULL, 0, 0, PM_REMOVE))
 	{
 		if (msg.message == WM_QUIT)
@@ -4,40 +4,48 @@
 *	This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
 */
 
-#include <RendererPch\stdafx.h>
+#include <RendererPch/stdafx.h>
 #include <iomanip>
 #include <random> //std::uniform_real_distribution
 
 //Triangle Includes
 #include "Main.h"
+#if defined(_WIN32)
 #include <conio.h>
+#endif
 
 //Renderer Includes
-#include <Renderer\VKRenderer.h>
-#include <Renderer\Vulkan\VulkanTools.h>
-#include <Renderer\Vulkan\VulkanTextureLoader.h>
+#include <Renderer/VKRenderer.h>
+#include <Renderer/VertexCache.h>
+#include <Renderer/Vulkan/VulkanTools.h>
+#include <Renderer/Vulkan/VulkanTextureLoader.h>
 
 //Model Loader Includes
-#include <Renderer\MeshLoader\Model_local.h>
-#include <Renderer\MeshLoader\ImageManager.h>
-#include <Renderer\MeshLoader\Material.h>
+#include <Renderer/MeshLoader/Model_local.h>
+#include <Renderer/MeshLoader/ImageManager.h>
+#include <Renderer/MeshLoader/Material.h>
 
 //Vulkan Includes
-#include <Renderer\Vulkan\VkBufferObject.h>
-#include <Renderer\Vulkan\VulkanSwapChain.h>
+#include <Renderer/Vulkan/VkBufferObject.h>
+#include <Renderer/Vulkan/VulkanSwapChain.h>
+#include <Renderer/Vulkan/VulkanFrameManager.h>
+#include <Renderer/Vulkan/VulkanGpuProfiler.h>
+#include <Renderer/Vulkan/VulkanRenderGraph.h>
+#include <Renderer/Vulkan/VulkanShaderRegistry.h>
+#include <Renderer/Profiler/CpuProfiler.h>
 
 
 //Font Rendering
-#include <Renderer\ThirdParty\FreeType\VkFont.h>
+#include <Renderer/ThirdParty/FreeType/VkFont.h>
 
 
 //math
-#include <External\glm\glm\gtc\matrix_inverse.hpp>
+#include <External/glm/glm/gtc/matrix_inverse.hpp>
 
 //Camera
-#include <Renderer\Camera.h>
+#include <Renderer/Camera.h>
 
-#include <Renderer\ThirdParty\ImGui\imgui.h>
+#include <Renderer/ThirdParty/ImGui/imgui.h>
 
 
 
@@ -153,6 +161,14 @@ VkClearColorValue g_DefaultClearColor = { { 0.5f, 0.5f, 0.5f, 1.0f } };
 #endif
 #define GBUFF_FILTER VK_FILTER_LINEAR
 
+// Work group size of SSAO.comp and Blur.comp
+#define SSAO_GROUP_SIZE 16
+
+// G-Buffer and SSAO targets are double buffered. Frame N+1 renders its G-Buffer
+// while compute SSAO of frame N still reads the other set
+#define GBUFF_SETS 2
+#define GBUFF_NO_SET 0xFFFFFFFF
+
 
 
 //====================================================================================
@@ -162,8 +178,10 @@ VkClearColorValue g_DefaultClearColor = { { 0.5f, 0.5f, 0.5f, 1.0f } };
 //====================================================================================
 
 bool GenerateEvents(MSG& msg);
+#if defined(_WIN32)
 void WIN_Sizing(WORD side, RECT *rect);
 LRESULT CALLBACK HandleWindowMessages(HWND hWnd, UINT uMsg, WPARAM wParam, LPARAM lParam);
+#endif
 
 //====================================================================================
 
@@ -181,18 +199,14 @@ private:
 	VkDescriptorSetLayout descriptorSetLayout;
 
 	struct {
-		// Swap chain image presentation
-		VkSemaphore presentComplete;
 		// Command buffer submission and execution
 		VkSemaphore renderComplete;
 		// Text overlay submission and execution
 		VkSemaphore textOverlayComplete;
-		//SSAO passs semaphore
-		VkSemaphore ssaoSemaphore;
-		//Blur pass semaphore
-		VkSemaphore blurSemaphore;
-		//Deffered pass Semaphore
-		VkSemaphore defferedSemaphore;
+		//Blur pass semaphore, compute SSAO of the set is done
+		VkSemaphore blurSemaphore[GBUFF_SETS];
+		//Deffered pass Semaphore, G-Buffer of the set is done
+		VkSemaphore defferedSemaphore[GBUFF_SETS];
 	} Semaphores;
 
 
@@ -213,51 +227,35 @@ private:
 	uint32_t numUvs = 0;
 	uint32_t numNormals = 0;
 
-	std::vector<VkBufferObject_s>	listLocalBuffersVerts;
-	std::vector<VkBufferObject_s>	listLocalBuffersIndexes;
 	std::vector<VkDescriptorSet>	listDescriptros;
-	std::vector<uint32_t>			meshSize;
+	vertCacheHandle_t				meshHandle;
+	vertCacheHandle_t				lightsHandle;
 
 
 
 
-	// Framebuffer for offscreen rendering
-	struct FrameBufferAttachment {
-		VkImage image;
-		VkDeviceMemory mem;
-		VkImageView view;
-		VkFormat format;
-	};
-	struct OffscreenFrameBuffer 
-	{
-		int32_t width, height;
-		VkFramebuffer frameBuffer;
-		FrameBufferAttachment position;
-		FrameBufferAttachment specular;
-		FrameBufferAttachment nm; //normal and diffuse
-		FrameBufferAttachment modeNormal; //face normals
-		FrameBufferAttachment depth;
-		VkRenderPass renderPass;
-	} offScreenFrameBuf;
-
-
-	struct FrameBuffer
+	// G-Buffer and SSAO targets live in the render graph, targets with disjoint lifetimes share memory.
+	// One graph per set, both declare the same images and passes
+	VulkanRenderGraph*	m_pRenderGraphs[GBUFF_SETS] = {};
+	uint32_t			m_CurrentSet = 0;					// written by this frame
+	uint32_t			m_CompositeSet = GBUFF_NO_SET;		// compute SSAO submitted last frame, composited this frame
+	struct
 	{
-		int32_t width, height;
-		VkFramebuffer frameBuffer;
-		FrameBufferAttachment attachement;
-		VkRenderPass renderPass;
+		uint32_t position;
+		uint32_t specular;
+		uint32_t nm; //normal and diffuse
+		uint32_t modeNormal; //face normals
+		uint32_t depth;
+		uint32_t ssao;
+		uint32_t ssaoBlur;
+	} graphImages;
 
-		//vkDestroyImageView(m_pWRenderer->m_SwapChain.device, attachement.view, nullptr);
-		//vkDestroyImage(m_pWRenderer->m_SwapChain.device, attachement.image, nullptr);
-		//vkFreeMemory(m_pWRenderer->m_SwapChain.device, attachement.mem, nullptr);
-	};
-
-	struct FrameBuffersSSAO
+	struct
 	{
-		FrameBuffer ssao;
-		FrameBuffer ssaoBlur;
-	}frameBuffersSSAO;
+		uint32_t gbuffer;
+		uint32_t ssao;
+		uint32_t ssaoBlur;
+	} graphPasses;
 
 
 	// One sampler for the frame buffer color attachments
@@ -265,12 +263,10 @@ private:
 
 	struct
 	{
-		VkTools::UniformData mesh;
 		VkTools::UniformData quad;
-		VkTools::UniformData fsLights;
 		VkTools::UniformData vsFullScreen;
 		VkTools::UniformData ssaokernel;
-		VkTools::UniformData ssaoprojection;
+		VkTools::UniformData ssaoprojection[GBUFF_SETS];	// compute SSAO of a set may outlive its frame
 		VkTools::UniformData defferedDebugOption;
 	}  uniformData;
 
@@ -319,7 +315,6 @@ private:
 	} uboFullScreen;
 
 	VkPipeline			frameBufferPipeline;
-	VkCommandBuffer		GBufferScreenCmdBuffer = VK_NULL_HANDLE;
 	VkPipelineLayout	frameBufferPipelineLayout;
 	VkDescriptorSet		frameBufferDescriptorSet;
 	VkDescriptorSetLayout frameBufferDescriptorSetLayout;
@@ -335,15 +330,14 @@ private:
 	VkPipeline				 quadPipeline;
 	VkPipelineLayout		 quadPipelineLayout;
 	VkDescriptorSetLayout	 quadDescriptorSetLayout;
-	VkDescriptorSet			 quadDescriptorSet;
-	VkDescriptorSet			 defferedModelDescriptorSet;
+	VkDescriptorSet			 quadDescriptorSet[GBUFF_SETS];
+	VkDescriptorSet			 defferedModelDescriptorSet[GBUFF_SETS];
 
 	//SSAO
 	VkPipeline ssaoPipeline;
 	VkPipelineLayout ssaoPipelineLayout;
 	VkDescriptorSetLayout ssaoDescriptorSetLayout;
-	VkDescriptorSet  ssaoDescriptorSet;
-	VkCommandBuffer	 ssaoCmdBuffer = VK_NULL_HANDLE;
+	VkDescriptorSet  ssaoDescriptorSet[GBUFF_SETS];
 	VkTools::VulkanTexture m_NoiseGeneratedTexture;
 
 	//Debug Normals
@@ -356,8 +350,15 @@ private:
 	VkPipeline				blurPipeline;
 	VkPipelineLayout		blurPipelineLayout;
 	VkDescriptorSetLayout	blurDescriptorSetLayout;
-	VkDescriptorSet			blurDescriptorSet;
-	VkCommandBuffer			blurCmdBuffer = VK_NULL_HANDLE;
+	VkDescriptorSet			blurDescriptorSet[GBUFF_SETS];
+
+	//SSAO and blur as compute passes, on the async compute queue if the device has one.
+	//Pipelines, layouts and descriptor sets above are the compute ones then
+	bool					m_bComputeSSAO = false;
+	VkCommandPool			m_ComputeCmdPool = VK_NULL_HANDLE;
+	VkCommandBuffer			m_ComputeCmdBuffers[GBUFF_SETS] = {};
+	VkFence					m_ComputeFences[GBUFF_SETS] = {};	// frame fences only cover the graphics queue
+	uint32_t				m_ComputeProfilerQueue = 0;
 
 	struct {
 		glm::mat4 mvp;
@@ -365,7 +366,6 @@ private:
 
 	//RenderModelStatic staticModel;
 	RenderModelAssimp staticModel;
-	VkCommandBuffer  cmdGui;
 
 	//Imguidata
 	struct imgui
@@ -399,12 +399,11 @@ public:
 	void ChangeLodBias(float delta);
 	void BeginTextUpdate();
 	void CreateFrameBuffer();
-	void CreateAttachement(VkFormat format, VkImageUsageFlagBits usage, FrameBufferAttachment *attachment, VkCommandBuffer layoutCmd); //Add to TywRendere DLL
 
-	void PrepareFramebufferCommands();
-	void PrepareSSAOCommands();
-	void PrepareSSAOBlurCommands();
-	void PrepareMainRendererCommands();
+	void RecordFramebufferCommands(VkCommandBuffer cmdBuffer, uint32_t set);
+	void RecordSSAOCommands(VkCommandBuffer cmdBuffer, uint32_t set);
+	void RecordSSAOBlurCommands(VkCommandBuffer cmdBuffer, uint32_t set);
+	void BuildMainRendererCommandBuffer(uint32_t i, uint32_t set);
 
 	void GenerateQuad();
 	void UpdateQuadUniformData(const glm::vec3& pos = glm::vec3(1.0, 1.0, 0.0));
@@ -456,78 +455,26 @@ Renderer::~Renderer()
 	staticModel.Clear(m_pWRenderer->m_SwapChain.device);
 
 
-	//Delete memory
-	for (int i = 0; i < listLocalBuffersVerts.size(); i++)
-	{
-		VkBufferObject::DeleteBufferMemory(m_pWRenderer->m_SwapChain.device, listLocalBuffersVerts[i], nullptr);
-	}
-
-	for (int i = 0; i < listLocalBuffersIndexes.size(); i++)
-	{
-		VkBufferObject::DeleteBufferMemory(m_pWRenderer->m_SwapChain.device, listLocalBuffersIndexes[i], nullptr);
-	}
-
-
-	//Destroy Shader Module
-	for (int i = 0; i < m_ShaderModules.size(); i++)
-	{
-		vkDestroyShaderModule(m_pWRenderer->m_SwapChain.device, m_ShaderModules[i], nullptr);
-	}
 
 	//Uniform Data
-	vkDestroyBuffer(m_pWRenderer->m_SwapChain.device, uniformData.mesh.buffer, nullptr);
-	vkFreeMemory(m_pWRenderer->m_SwapChain.device, uniformData.mesh.memory, nullptr);
 	VkTools::DestroyUniformData(m_pWRenderer->m_SwapChain.device, uniformData.quad);
-	VkTools::DestroyUniformData(m_pWRenderer->m_SwapChain.device, uniformData.fsLights);
 	VkTools::DestroyUniformData(m_pWRenderer->m_SwapChain.device, uniformData.vsFullScreen);
 	VkTools::DestroyUniformData(m_pWRenderer->m_SwapChain.device, uniformData.ssaokernel);
-	VkTools::DestroyUniformData(m_pWRenderer->m_SwapChain.device, uniformData.ssaoprojection);
 	VkTools::DestroyUniformData(m_pWRenderer->m_SwapChain.device, uniformData.defferedDebugOption);
+	for (uint32_t i = 0; i < GBUFF_SETS; i++)
+	{
+		VkTools::DestroyUniformData(m_pWRenderer->m_SwapChain.device, uniformData.ssaoprojection[i]);
+	}
 
 	//QUad
 	VkBufferObject::DeleteBufferMemory(m_pWRenderer->m_SwapChain.device, quadMesh.vertex, nullptr);
 	VkBufferObject::DeleteBufferMemory(m_pWRenderer->m_SwapChain.device, quadMesh.index, nullptr);
 
-	//Position
-	vkDestroyImageView(m_pWRenderer->m_SwapChain.device, offScreenFrameBuf.position.view, nullptr);
-	vkDestroyImage(m_pWRenderer->m_SwapChain.device, offScreenFrameBuf.position.image, nullptr);
-	vkFreeMemory(m_pWRenderer->m_SwapChain.device, offScreenFrameBuf.position.mem, nullptr);
-
-
-	//Specular
-	vkDestroyImageView(m_pWRenderer->m_SwapChain.device, offScreenFrameBuf.specular.view, nullptr);
-	vkDestroyImage(m_pWRenderer->m_SwapChain.device, offScreenFrameBuf.specular.image, nullptr);
-	vkFreeMemory(m_pWRenderer->m_SwapChain.device, offScreenFrameBuf.specular.mem, nullptr);
-
-
-	//Normal and Diffuse
-	vkDestroyImageView(m_pWRenderer->m_SwapChain.device, offScreenFrameBuf.nm.view, nullptr);
-	vkDestroyImage(m_pWRenderer->m_SwapChain.device, offScreenFrameBuf.nm.image, nullptr);
-	vkFreeMemory(m_pWRenderer->m_SwapChain.device, offScreenFrameBuf.nm.mem, nullptr);
-
-	//Model normal
-	vkDestroyImageView(m_pWRenderer->m_SwapChain.device, offScreenFrameBuf.modeNormal.view, nullptr);
-	vkDestroyImage(m_pWRenderer->m_SwapChain.device, offScreenFrameBuf.modeNormal.image, nullptr);
-	vkFreeMemory(m_pWRenderer->m_SwapChain.device, offScreenFrameBuf.modeNormal.mem, nullptr);
-
-	//SSAO
-	vkDestroyImageView(m_pWRenderer->m_SwapChain.device, frameBuffersSSAO.ssao.attachement.view, nullptr);
-	vkDestroyImage(m_pWRenderer->m_SwapChain.device, frameBuffersSSAO.ssao.attachement.image, nullptr);
-	vkFreeMemory(m_pWRenderer->m_SwapChain.device, frameBuffersSSAO.ssao.attachement.mem, nullptr);
-
-	//SSAO blur
-	vkDestroyImageView(m_pWRenderer->m_SwapChain.device, frameBuffersSSAO.ssaoBlur.attachement.view, nullptr);
-	vkDestroyImage(m_pWRenderer->m_SwapChain.device, frameBuffersSSAO.ssaoBlur.attachement.image, nullptr);
-	vkFreeMemory(m_pWRenderer->m_SwapChain.device, frameBuffersSSAO.ssaoBlur.attachement.mem, nullptr);
-
-	//Depth
-	vkDestroyImageView(m_pWRenderer->m_SwapChain.device, offScreenFrameBuf.depth.view, nullptr);
-	vkDestroyImage(m_pWRenderer->m_SwapChain.device, offScreenFrameBuf.depth.image, nullptr);
-	vkFreeMemory(m_pWRenderer->m_SwapChain.device, offScreenFrameBuf.depth.mem, nullptr);
-
-
-	//Destroy framebuffer
-	vkDestroyFramebuffer(m_pWRenderer->m_SwapChain.device, offScreenFrameBuf.frameBuffer, nullptr);
+	//G-Buffer and SSAO targets, their render passes and framebuffers
+	for (uint32_t i = 0; i < GBUFF_SETS; i++)
+	{
+		SAFE_DELETE(m_pRenderGraphs[i]);
+	}
 
 
 	//Destroy FrameBufferPipeline
@@ -550,35 +497,37 @@ Renderer::~Renderer()
 	vkDestroyDescriptorSetLayout(m_pWRenderer->m_SwapChain.device, ssaoDescriptorSetLayout, nullptr);
 	vkDestroyDescriptorSetLayout(m_pWRenderer->m_SwapChain.device, blurDescriptorSetLayout, nullptr);
 
-	//Destroy RenderPass
-	vkDestroyRenderPass(m_pWRenderer->m_SwapChain.device, offScreenFrameBuf.renderPass, nullptr);
-	vkDestroyRenderPass(m_pWRenderer->m_SwapChain.device, frameBuffersSSAO.ssao.renderPass, nullptr);
-	vkDestroyRenderPass(m_pWRenderer->m_SwapChain.device, frameBuffersSSAO.ssaoBlur.renderPass, nullptr);
-
-	//Destroy Command Buffer
-	vkFreeCommandBuffers(m_pWRenderer->m_SwapChain.device, m_pWRenderer->m_CmdPool, 1, &GBufferScreenCmdBuffer);
-	vkFreeCommandBuffers(m_pWRenderer->m_SwapChain.device, m_pWRenderer->m_CmdPool, 1, &ssaoCmdBuffer);
-	vkFreeCommandBuffers(m_pWRenderer->m_SwapChain.device, m_pWRenderer->m_CmdPool, 1, &blurCmdBuffer);
+	//Destroy compute command buffers, the pool frees them
+	if (m_ComputeCmdPool != VK_NULL_HANDLE)
+	{
+		vkDestroyCommandPool(m_pWRenderer->m_SwapChain.device, m_ComputeCmdPool, nullptr);
+	}
 
 	//Release semaphores
-	vkDestroySemaphore(m_pWRenderer->m_SwapChain.device, Semaphores.presentComplete, nullptr);
 	vkDestroySemaphore(m_pWRenderer->m_SwapChain.device, Semaphores.renderComplete, nullptr);
 	vkDestroySemaphore(m_pWRenderer->m_SwapChain.device, Semaphores.textOverlayComplete, nullptr);
-	vkDestroySemaphore(m_pWRenderer->m_SwapChain.device, Semaphores.ssaoSemaphore, nullptr);
-	vkDestroySemaphore(m_pWRenderer->m_SwapChain.device, Semaphores.blurSemaphore, nullptr);
-	vkDestroySemaphore(m_pWRenderer->m_SwapChain.device, Semaphores.defferedSemaphore, nullptr);
+	for (uint32_t i = 0; i < GBUFF_SETS; i++)
+	{
+		vkDestroySemaphore(m_pWRenderer->m_SwapChain.device, Semaphores.blurSemaphore[i], nullptr);
+		vkDestroySemaphore(m_pWRenderer->m_SwapChain.device, Semaphores.defferedSemaphore[i], nullptr);
+		if (m_ComputeFences[i] != VK_NULL_HANDLE)
+		{
+			vkDestroyFence(m_pWRenderer->m_SwapChain.device, m_ComputeFences[i], nullptr);
+		}
+	}
 }
 
 void Renderer::PrepareSemaphore()
 {
 	VkSemaphoreCreateInfo semaphoreCreateInfo = VkTools::Initializer::SemaphoreCreateInfo();
 
-	VK_CHECK_RESULT(vkCreateSemaphore(m_pWRenderer->m_SwapChain.device, &semaphoreCreateInfo, nullptr, &Semaphores.presentComplete));
 	VK_CHECK_RESULT(vkCreateSemaphore(m_pWRenderer->m_SwapChain.device, &semaphoreCreateInfo, nullptr, &Semaphores.renderComplete));
 	VK_CHECK_RESULT(vkCreateSemaphore(m_pWRenderer->m_SwapChain.device, &semaphoreCreateInfo, nullptr, &Semaphores.textOverlayComplete));
-	VK_CHECK_RESULT(vkCreateSemaphore(m_pWRenderer->m_SwapChain.device, &semaphoreCreateInfo, nullptr, &Semaphores.ssaoSemaphore));
-	VK_CHECK_RESULT(vkCreateSemaphore(m_pWRenderer->m_SwapChain.device, &semaphoreCreateInfo, nullptr, &Semaphores.blurSemaphore));
-	VK_CHECK_RESULT(vkCreateSemaphore(m_pWRenderer->m_SwapChain.device, &semaphoreCreateInfo, nullptr, &Semaphores.defferedSemaphore));
+	for (uint32_t i = 0; i < GBUFF_SETS; i++)
+	{
+		VK_CHECK_RESULT(vkCreateSemaphore(m_pWRenderer->m_SwapChain.device, &semaphoreCreateInfo, nullptr, &Semaphores.blurSemaphore[i]));
+		VK_CHECK_RESULT(vkCreateSemaphore(m_pWRenderer->m_SwapChain.device, &semaphoreCreateInfo, nullptr, &Semaphores.defferedSemaphore[i]));
+	}
 }
 
 
@@ -599,6 +548,13 @@ void Renderer::ImguiRender()
 	ImGui::SetNextWindowSize(ImVec2(200, 100), ImGuiSetCond_FirstUseEver);
 	ImGui::Text("%.3f ms/frame (%.1f FPS)", 1000.0f / ImGui::GetIO().Framerate, ImGui::GetIO().Framerate);
 
+	const VulkanRenderGraphStats graphStats = m_pRenderGraphs[0]->GetStats();
+	ImGui::Text("Render graph %u barriers, %.1f MB saved", graphStats.numBarriers, graphStats.GetSavedBytes() / (1024.0f * 1024.0f));
+
+	//GPU time of every pass
+	m_pGpuProfiler->DrawImGui();
+	cpuProfiler->DrawImGui();
+
 	bSSAOKernelSize = ImGui::DragInt("SSAO Kernel Size", &uboSSAOKernel.kernelSize, 0.0f, 0, 64, "%.0f");
 	bSSAOKernelRadius = ImGui::DragFloat("SSAO Radius", &uboSSAOKernel.ssaoRadius, 0.0f, 0, 64, "%.3f");
 	bSSAOBias = ImGui::DragFloat("SSAO Bias", &uboSSAOKernel.ssaoBias, 0.0f, 0, 3, "%.3f");
@@ -631,19 +587,11 @@ void Renderer::ImguiRender()
 	bPressedDebugFrameBuffers = ImGui::Checkbox("Show generated framebuffers (On/Off)", &imguiData.bDebugFrameBuffers);
 	bPressedbNormalDebug = ImGui::Checkbox("Normal debug (On/Off)", &imguiData.bNormalDebugOn);
 
-
-	//RebuildCommandBuffers
-	if (bTurnOnSSAO || bPressedDebugFrameBuffers || bPressedbNormalDebug)
-	{
-		BuildCommandBuffers();
-	}
+	//Toggles are picked up by the next frame, its commands are recorded in StartFrame
 
 	if (bSSAOKernelSize || bSSAOKernelRadius || bSSAOBias)
 	{
-		void * pData;
-		VK_CHECK_RESULT(vkMapMemory(m_pWRenderer->m_SwapChain.device, uniformData.ssaokernel.memory, 0, sizeof(uboSSAOKernel), 0, (void **)&pData));
-		memcpy(pData, &uboSSAOKernel, sizeof(uboSSAOKernel));
-		vkUnmapMemory(m_pWRenderer->m_SwapChain.device, uniformData.ssaokernel.memory);
+		memcpy(uniformData.ssaokernel.mapped, &uboSSAOKernel, sizeof(uboSSAOKernel));
 	}
 
 	if (bDebugDiffuse || bDebugDiffuseAndSSAO || bPressedSSAOWithBlur || bPressedSSAO || bTurnOnSSAO)
@@ -694,10 +642,7 @@ void Renderer::InitializeSSAOData()
 	GenerateTexture(ssaoNoise, 4, 4, 1, VK_FORMAT_R32G32B32A32_SFLOAT, &m_NoiseGeneratedTexture, VK_IMAGE_USAGE_SAMPLED_BIT, VK_FILTER_NEAREST);
 
 	//Send data
-	void * pData;
-	VK_CHECK_RESULT(vkMapMemory(m_pWRenderer->m_SwapChain.device, uniformData.ssaokernel.memory, 0, sizeof(uboSSAOKernel), 0, (void **)&pData));
-	memcpy(pData, &uboSSAOKernel, sizeof(uboSSAOKernel));
-	vkUnmapMemory(m_pWRenderer->m_SwapChain.device, uniformData.ssaokernel.memory);
+	memcpy(uniformData.ssaokernel.mapped, &uboSSAOKernel, sizeof(uboSSAOKernel));
 }
 
 void Renderer::GenerateTexture(std::vector<glm::vec4> &tex2D, uint32_t imageX, uint32_t imageY, uint32_t mipMapLevel, VkFormat format, VkTools::VulkanTexture *texture, VkImageUsageFlags imageUsageFlags, VkFilter filter)
@@ -782,6 +727,15 @@ void Renderer::GenerateTexture(std::vector<glm::vec4> &tex2D, uint32_t imageX, u
 	imageCreateInfo.extent = { texture->width, texture->height, 1 };
 	imageCreateInfo.usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
 
+	//Compute SSAO samples it on the compute family, shared by both it needs no ownership transfer
+	const uint32_t queueFamilies[] = { m_pWRenderer->m_graphicsQueueIndex, m_pWRenderer->m_computeQueueIndex };
+	if (m_bComputeSSAO && queueFamilies[0] != queueFamilies[1])
+	{
+		imageCreateInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+		imageCreateInfo.queueFamilyIndexCount = 2;
+		imageCreateInfo.pQueueFamilyIndices = queueFamilies;
+	}
+
 	VK_CHECK_RESULT(vkCreateImage(m_pWRenderer->m_SwapChain.device, &imageCreateInfo, nullptr, &texture->image));
 
 	vkGetImageMemoryRequirements(m_pWRenderer->m_SwapChain.device, texture->image, &memReqs);
@@ -947,10 +901,7 @@ void Renderer::SetupLight(Light *light, glm::vec3 pos, glm::vec3 color, float ra
 
 void Renderer::UpdateDefferedDebugUniformData()
 {
-	uint8_t *pData;
-	VK_CHECK_RESULT(vkMapMemory(m_pWRenderer->m_SwapChain.device, uniformData.defferedDebugOption.memory, 0, sizeof(uboDefferedDebugOptions), 0, (void **)&pData));
-	memcpy(pData, &uboDefferedDebugOptions, sizeof(uboDefferedDebugOptions));
-	vkUnmapMemory(m_pWRenderer->m_SwapChain.device, uniformData.defferedDebugOption.memory);
+	memcpy(uniformData.defferedDebugOption.mapped, &uboDefferedDebugOptions, sizeof(uboDefferedDebugOptions));
 }
 
 void Renderer::UpdateUniformBuffersLights()
@@ -970,10 +921,8 @@ void Renderer::UpdateUniformBuffersLights()
 	// Current view position
 	uboFragmentLights.viewPos = glm::vec4(m_Camera.position, 0.0f) * glm::vec4(-1.0f, 1.0f, -1.0f, 1.0f);
 
-	uint8_t *pData;
-	VK_CHECK_RESULT(vkMapMemory(m_pWRenderer->m_SwapChain.device, uniformData.fsLights.memory, 0, sizeof(uboFragmentLights), 0, (void **)&pData));
-	memcpy(pData, &uboFragmentLights, sizeof(uboFragmentLights));
-	vkUnmapMemory(m_pWRenderer->m_SwapChain.device, uniformData.fsLights.memory);
+	//Composite of this frame reads them, offset is given when binding
+	lightsHandle = vertexCache.AllocUniform(&uboFragmentLights, sizeof(uboFragmentLights));
 }
 
 void Renderer::LoadGUI()
@@ -1093,25 +1042,14 @@ void Renderer::GenerateQuad()
 		quadMesh.index);
 
 
-	//Create new command buffer
-	VkCommandBuffer copyCmd = GetCommandBuffer(true);
-
-
 	//Submit info to the queue
 	VkBufferObject::SubmitBufferObjects(
-		copyCmd,
-		m_pWRenderer->m_Queue,
-		*m_pWRenderer,
 		static_cast<uint32_t>(sizeof(drawVert) * vertData.size()),
 		staggingBufferVbo,
 		quadMesh.vertex, (drawVertFlags::Vertex | drawVertFlags::Uv | drawVertFlags::Normal));
 
 
-	copyCmd = GetCommandBuffer(true);
 	VkBufferObject::SubmitBufferObjects(
-		copyCmd,
-		m_pWRenderer->m_Queue,
-		*m_pWRenderer,
 		static_cast<uint32_t>(sizeof(uint32_t) * indexBuffer.size()),
 		staggingIndexBufferVbo,
 		quadMesh.index, drawVertFlags::None);
@@ -1123,116 +1061,107 @@ void Renderer::UpdateQuadUniformData(const glm::vec3& pos)
 	quadUniformData.mvp = mvp;
 
 	// Map uniform buffer and update it
-	uint8_t *pData;
-	VK_CHECK_RESULT(vkMapMemory(m_pWRenderer->m_SwapChain.device, uniformData.quad.memory, 0, sizeof(quadUniformData), 0, (void **)&pData));
-	memcpy(pData, &quadUniformData, sizeof(quadUniformData));
-	vkUnmapMemory(m_pWRenderer->m_SwapChain.device, uniformData.quad.memory);
+	memcpy(uniformData.quad.mapped, &quadUniformData, sizeof(quadUniformData));
 }
 
-void Renderer::PrepareSSAOBlurCommands()
+void Renderer::RecordSSAOBlurCommands(VkCommandBuffer cmdBuffer, uint32_t set)
 {
-	if (blurCmdBuffer == VK_NULL_HANDLE)
+	VulkanRenderGraph* pRenderGraph = m_pRenderGraphs[set];
+	const VkExtent2D extent = pRenderGraph->GetExtent(graphPasses.ssaoBlur);
+	if (m_bComputeSSAO)
 	{
-		VkCommandBufferAllocateInfo cmdBufAllocateInfo =
-			VkTools::Initializer::CommandBufferAllocateInfo(
-				m_pWRenderer->m_CmdPool,
-				VK_COMMAND_BUFFER_LEVEL_PRIMARY,
-				1);
-
-		VK_CHECK_RESULT(vkAllocateCommandBuffers(m_pWRenderer->m_SwapChain.device, &cmdBufAllocateInfo, &blurCmdBuffer));
-	}
-
-	VkCommandBufferBeginInfo cmdBufInfo = VkTools::Initializer::CommandBufferBeginInfo();
-
-	std::array<VkClearValue, 1> clearValues;
-	clearValues[0].color = { { 0.0f, 0.0f, 0.0f, 0.0f } };
-	//clearValues[1].depthStencil = { 1.0f, 0 };
+		m_pGpuProfiler->BeginScope(cmdBuffer, "SSAO Blur");
+		if (pRenderGraph->BeginPass(cmdBuffer, graphPasses.ssaoBlur))
+		{
+			vkCmdBindPipeline(cmdBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, blurPipeline);
+			vkCmdBindDescriptorSets(cmdBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, blurPipelineLayout, 0, 1, &blurDescriptorSet[set], 0, NULL);
 
-	VkRenderPassBeginInfo renderPassBeginInfo = VkTools::Initializer::RenderPassBeginInfo();
-	renderPassBeginInfo.renderPass = frameBuffersSSAO.ssaoBlur.renderPass;
-	renderPassBeginInfo.framebuffer = frameBuffersSSAO.ssaoBlur.frameBuffer;
-	renderPassBeginInfo.renderArea.offset.x = 0;
-	renderPassBeginInfo.renderArea.offset.y = 0;
-	renderPassBeginInfo.renderArea.extent.width = frameBuffersSSAO.ssaoBlur.width;
-	renderPassBeginInfo.renderArea.extent.height = frameBuffersSSAO.ssaoBlur.height;
-	renderPassBeginInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
-	renderPassBeginInfo.pClearValues = clearValues.data();
+			if (imguiData.bSSAOIsOn)
+			{
+				vkCmdDispatch(cmdBuffer, (extent.width + SSAO_GROUP_SIZE - 1) / SSAO_GROUP_SIZE, (extent.height + SSAO_GROUP_SIZE - 1) / SSAO_GROUP_SIZE, 1);
+			}
 
-	VK_CHECK_RESULT(vkBeginCommandBuffer(blurCmdBuffer, &cmdBufInfo));
+			pRenderGraph->EndPass(cmdBuffer, graphPasses.ssaoBlur);
+		}
+		m_pGpuProfiler->EndScope(cmdBuffer);
+		return;
+	}
 
+	VkViewport viewport = VkTools::Initializer::Viewport((float)extent.width, (float)extent.height, 0.0f, 1.0f);
+	vkCmdSetViewport(cmdBuffer, 0, 1, &viewport);
 
-	VkViewport viewport = VkTools::Initializer::Viewport((float)frameBuffersSSAO.ssaoBlur.width, (float)frameBuffersSSAO.ssaoBlur.height, 0.0f, 1.0f);
-	vkCmdSetViewport(blurCmdBuffer, 0, 1, &viewport);
+	VkRect2D scissor = VkTools::Initializer::Rect2D(extent.width, extent.height, 0, 0);
+	vkCmdSetScissor(cmdBuffer, 0, 1, &scissor);
 
-	VkRect2D scissor = VkTools::Initializer::Rect2D(frameBuffersSSAO.ssaoBlur.width, frameBuffersSSAO.ssaoBlur.height, 0, 0);
-	vkCmdSetScissor(blurCmdBuffer, 0, 1, &scissor);
+	m_pGpuProfiler->BeginScope(cmdBuffer, "SSAO Blur");
+	if (pRenderGraph->BeginPass(cmdBuffer, graphPasses.ssaoBlur))
+	{
+		vkCmdBindPipeline(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, blurPipeline);
+		vkCmdBindDescriptorSets(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, blurPipelineLayout, 0, 1, &blurDescriptorSet[set], 0, NULL);
 
-	vkCmdBeginRenderPass(blurCmdBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
-	vkCmdBindPipeline(blurCmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, blurPipeline);
-	vkCmdBindDescriptorSets(blurCmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, blurPipelineLayout, 0, 1, &blurDescriptorSet, 0, NULL);
+		if (imguiData.bSSAOIsOn)
+		{
+			vkCmdDraw(cmdBuffer, 3, 1, 0, 0);
+		}
 
-	if (imguiData.bSSAOIsOn)
-	{
-		vkCmdDraw(blurCmdBuffer, 3, 1, 0, 0);
+		pRenderGraph->EndPass(cmdBuffer, graphPasses.ssaoBlur);
 	}
-
-	vkCmdEndRenderPass(blurCmdBuffer);
-	VK_CHECK_RESULT(vkEndCommandBuffer(blurCmdBuffer));
+	m_pGpuProfiler->EndScope(cmdBuffer);
 }
 
-void Renderer::PrepareSSAOCommands()
+void Renderer::RecordSSAOCommands(VkCommandBuffer cmdBuffer, uint32_t set)
 {
-	if (ssaoCmdBuffer == VK_NULL_HANDLE)
+	VulkanRenderGraph* pRenderGraph = m_pRenderGraphs[set];
+	const VkExtent2D extent = pRenderGraph->GetExtent(graphPasses.ssao);
+	if (m_bComputeSSAO)
 	{
-		VkCommandBufferAllocateInfo cmdBufAllocateInfo =
-			VkTools::Initializer::CommandBufferAllocateInfo(
-				m_pWRenderer->m_CmdPool,
-				VK_COMMAND_BUFFER_LEVEL_PRIMARY,
-				1);
-
-		VK_CHECK_RESULT(vkAllocateCommandBuffers(m_pWRenderer->m_SwapChain.device, &cmdBufAllocateInfo, &ssaoCmdBuffer));
-	}
-
-	VkCommandBufferBeginInfo cmdBufInfo = VkTools::Initializer::CommandBufferBeginInfo();
-
-	std::array<VkClearValue, 1> clearValues;
-	clearValues[0].color = { { 0.0f, 0.0f, 0.0f, 0.0f } };
-	//clearValues[1].depthStencil = { 1.0f, 0 };
+		//Barriers of the pass acquire the G-Buffer targets from the graphics family
+		m_pGpuProfiler->BeginScope(cmdBuffer, "SSAO");
+		if (pRenderGraph->BeginPass(cmdBuffer, graphPasses.ssao))
+		{
+			vkCmdBindPipeline(cmdBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, ssaoPipeline);
+			vkCmdBindDescriptorSets(cmdBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, ssaoPipelineLayout, 0, 1, &ssaoDescriptorSet[set], 0, NULL);
 
-	VkRenderPassBeginInfo renderPassBeginInfo = VkTools::Initializer::RenderPassBeginInfo();
-	renderPassBeginInfo.renderPass = frameBuffersSSAO.ssao.renderPass;
-	renderPassBeginInfo.framebuffer = frameBuffersSSAO.ssao.frameBuffer;
-	renderPassBeginInfo.renderArea.offset.x = 0;
-	renderPassBeginInfo.renderArea.offset.y = 0;
-	renderPassBeginInfo.renderArea.extent.width = frameBuffersSSAO.ssao.width;
-	renderPassBeginInfo.renderArea.extent.height = frameBuffersSSAO.ssao.height;
-	renderPassBeginInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
-	renderPassBeginInfo.pClearValues = clearValues.data();
+			if (imguiData.bSSAOIsOn)
+			{
+				vkCmdDispatch(cmdBuffer, (extent.width + SSAO_GROUP_SIZE - 1) / SSAO_GROUP_SIZE, (extent.height + SSAO_GROUP_SIZE - 1) / SSAO_GROUP_SIZE, 1);
+			}
 
-	VK_CHECK_RESULT(vkBeginCommandBuffer(ssaoCmdBuffer, &cmdBufInfo));
+			pRenderGraph->EndPass(cmdBuffer, graphPasses.ssao);
+		}
+		m_pGpuProfiler->EndScope(cmdBuffer);
+		return;
+	}
 
+	VkViewport viewport = VkTools::Initializer::Viewport((float)extent.width, (float)extent.height, 0.0f, 1.0f);
+	vkCmdSetViewport(cmdBuffer, 0, 1, &viewport);
 
-	VkViewport viewport = VkTools::Initializer::Viewport((float)frameBuffersSSAO.ssao.width, (float)frameBuffersSSAO.ssao.height, 0.0f, 1.0f);
-	vkCmdSetViewport(ssaoCmdBuffer, 0, 1, &viewport);
+	VkRect2D scissor = VkTools::Initializer::Rect2D(extent.width, extent.height, 0, 0);
+	vkCmdSetScissor(cmdBuffer, 0, 1, &scissor);
 
-	VkRect2D scissor = VkTools::Initializer::Rect2D(frameBuffersSSAO.ssao.width, frameBuffersSSAO.ssao.height, 0, 0);
-	vkCmdSetScissor(ssaoCmdBuffer, 0, 1, &scissor);
+	m_pGpuProfiler->BeginScope(cmdBuffer, "SSAO");
+	if (pRenderGraph->BeginPass(cmdBuffer, graphPasses.ssao))
+	{
+		vkCmdBindPipeline(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, ssaoPipeline);
+		vkCmdBindDescriptorSets(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, ssaoPipelineLayout, 0, 1, &ssaoDescriptorSet[set], 0, NULL);
 
-	vkCmdBeginRenderPass(ssaoCmdBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
-	vkCmdBindPipeline(ssaoCmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, ssaoPipeline);
-	vkCmdBindDescriptorSets(ssaoCmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, ssaoPipelineLayout, 0, 1, &ssaoDescriptorSet, 0, NULL);
+		if (imguiData.bSSAOIsOn)
+		{
+			vkCmdDraw(cmdBuffer, 3, 1, 0, 0);
+		}
 
-	if (imguiData.bSSAOIsOn)
-	{
-		vkCmdDraw(ssaoCmdBuffer, 3, 1, 0, 0);
+		pRenderGraph->EndPass(cmdBuffer, graphPasses.ssao);
 	}
-
-	vkCmdEndRenderPass(ssaoCmdBuffer);
-	VK_CHECK_RESULT(vkEndCommandBuffer(ssaoCmdBuffer));
+	m_pGpuProfiler->EndScope(cmdBuffer);
 }
 
-void Renderer::PrepareMainRendererCommands()
+//Records composition of a set for swap chain image i. Redone every frame, lights move to a new uniform offset each frame.
+//GBUFF_NO_SET only clears, there is no finished set before the first compute SSAO
+void Renderer::BuildMainRendererCommandBuffer(uint32_t i, uint32_t set)
 {
+	const uint32_t lightsOffset = static_cast<uint32_t>(lightsHandle.offset);
+	const uint32_t meshOffset = static_cast<uint32_t>(meshHandle.offset);
+
 	VkCommandBufferBeginInfo cmdBufInfo = {};
 	cmdBufInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
 	cmdBufInfo.pNext = NULL;
@@ -1255,517 +1184,201 @@ void Renderer::PrepareMainRendererCommands()
 	renderPassBeginInfo.clearValueCount = 2;
 	renderPassBeginInfo.pClearValues = clearValues;
 
-	for (int32_t i = 0; i < m_pWRenderer->m_DrawCmdBuffers.size(); ++i)
-	{
+	// Set target frame buffer
+	renderPassBeginInfo.framebuffer = m_pWRenderer->m_FrameBuffers[i];
 
-		// Set target frame buffer
-		renderPassBeginInfo.framebuffer = m_pWRenderer->m_FrameBuffers[i];
+	VK_CHECK_RESULT(vkBeginCommandBuffer(m_pWRenderer->m_DrawCmdBuffers[i], &cmdBufInfo));
 
-		VK_CHECK_RESULT(vkBeginCommandBuffer(m_pWRenderer->m_DrawCmdBuffers[i], &cmdBufInfo));
+	// Start the first sub pass specified in our default render pass setup by the base class
+	// This will clear the color and depth attachment
+	m_pGpuProfiler->BeginScope(m_pWRenderer->m_DrawCmdBuffers[i], "Composite");
 
-		// Start the first sub pass specified in our default render pass setup by the base class
-		// This will clear the color and depth attachment
-		vkCmdBeginRenderPass(m_pWRenderer->m_DrawCmdBuffers[i], &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
+	//SSAO images and the G-Buffer targets it sampled come back from the compute family
+	if (set != GBUFF_NO_SET)
+	{
+		m_pRenderGraphs[set]->AcquireExports(m_pWRenderer->m_DrawCmdBuffers[i]);
+	}
+	vkCmdBeginRenderPass(m_pWRenderer->m_DrawCmdBuffers[i], &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
 
-		// Update dynamic viewport state
-		VkViewport viewport = VkTools::Initializer::Viewport((float)g_iDesktopWidth, (float)g_iDesktopHeight, 0.0f, 1.0f);
-		vkCmdSetViewport(m_pWRenderer->m_DrawCmdBuffers[i], 0, 1, &viewport);
+	// Update dynamic viewport state
+	VkViewport viewport = VkTools::Initializer::Viewport((float)g_iDesktopWidth, (float)g_iDesktopHeight, 0.0f, 1.0f);
+	vkCmdSetViewport(m_pWRenderer->m_DrawCmdBuffers[i], 0, 1, &viewport);
 
-		VkRect2D scissor = VkTools::Initializer::Rect2D(g_iDesktopWidth, g_iDesktopHeight, 0, 0);
-		vkCmdSetScissor(m_pWRenderer->m_DrawCmdBuffers[i], 0, 1, &scissor);
+	VkRect2D scissor = VkTools::Initializer::Rect2D(g_iDesktopWidth, g_iDesktopHeight, 0, 0);
+	vkCmdSetScissor(m_pWRenderer->m_DrawCmdBuffers[i], 0, 1, &scissor);
 
-		VkDeviceSize offsets[1] = { 0 };
+	VkDeviceSize offsets[1] = { 0 };
 
-		
-		// Final composition as full screen quad
-		if(!imguiData.bNormalDebugOn)
-		{
-			vkCmdBindPipeline(m_pWRenderer->m_DrawCmdBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
-			vkCmdBindDescriptorSets(m_pWRenderer->m_DrawCmdBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &defferedModelDescriptorSet, 0, NULL);
-			vkCmdDraw(m_pWRenderer->m_DrawCmdBuffers[i], 3, 1, 0, 0);
-		}
-		
-		if (imguiData.bDebugFrameBuffers)
+	
+	// Final composition as full screen quad
+	if(!imguiData.bNormalDebugOn && set != GBUFF_NO_SET)
+	{
+		vkCmdBindPipeline(m_pWRenderer->m_DrawCmdBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+		vkCmdBindDescriptorSets(m_pWRenderer->m_DrawCmdBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &defferedModelDescriptorSet[set], 1, &lightsOffset);
+		vkCmdDraw(m_pWRenderer->m_DrawCmdBuffers[i], 3, 1, 0, 0);
+	}
+	
+	if (imguiData.bDebugFrameBuffers && set != GBUFF_NO_SET)
+	{
+		//quad debug
 		{
-			//quad debug
-			{
-				vkCmdBindPipeline(m_pWRenderer->m_DrawCmdBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, quadPipeline);
-				vkCmdBindDescriptorSets(m_pWRenderer->m_DrawCmdBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, quadPipelineLayout, 0, 1, &quadDescriptorSet, 0, NULL);
-				vkCmdBindVertexBuffers(m_pWRenderer->m_DrawCmdBuffers[i], VERTEX_BUFFER_BIND_ID, 1, &quadMesh.vertex.buffer, offsets);
-				vkCmdBindIndexBuffer(m_pWRenderer->m_DrawCmdBuffers[i], quadMesh.index.buffer, 0, VK_INDEX_TYPE_UINT32);
-				vkCmdDrawIndexed(m_pWRenderer->m_DrawCmdBuffers[i], quadMesh.numIndexes, 1, 0, 0, 1);
-
-				//			viewport.x = viewport.width * 0.5f;
-				//			viewport.y = viewport.height * 0.5f;
-				//			vkCmdSetViewport(m_pWRenderer->m_DrawCmdBuffers[i], 0, 1, &viewport);
-			}
+			vkCmdBindPipeline(m_pWRenderer->m_DrawCmdBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, quadPipeline);
+			vkCmdBindDescriptorSets(m_pWRenderer->m_DrawCmdBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, quadPipelineLayout, 0, 1, &quadDescriptorSet[set], 0, NULL);
+			vkCmdBindVertexBuffers(m_pWRenderer->m_DrawCmdBuffers[i], VERTEX_BUFFER_BIND_ID, 1, &quadMesh.vertex.buffer, offsets);
+			vkCmdBindIndexBuffer(m_pWRenderer->m_DrawCmdBuffers[i], quadMesh.index.buffer, 0, VK_INDEX_TYPE_UINT32);
+			vkCmdDrawIndexed(m_pWRenderer->m_DrawCmdBuffers[i], quadMesh.numIndexes, 1, 0, 0, 1);
+
+			//			viewport.x = viewport.width * 0.5f;
+			//			viewport.y = viewport.height * 0.5f;
+			//			vkCmdSetViewport(m_pWRenderer->m_DrawCmdBuffers[i], 0, 1, &viewport);
 		}
+	}
 
 
-		//Normal debug -> Uncomment and comment out first one in order to see normals. Still working to get working properly
-		if(imguiData.bNormalDebugOn)
-		{
-			//viewport.x = viewport.width * 0.5f;
-			//viewport.y = viewport.height * 0.5f;
-			//vkCmdSetViewport(m_pWRenderer->m_DrawCmdBuffers[i], 0, 1, &viewport);
+	//Normal debug -> Uncomment and comment out first one in order to see normals. Still working to get working properly
+	if(imguiData.bNormalDebugOn)
+	{
+		//viewport.x = viewport.width * 0.5f;
+		//viewport.y = viewport.height * 0.5f;
+		//vkCmdSetViewport(m_pWRenderer->m_DrawCmdBuffers[i], 0, 1, &viewport);
 
-			vkCmdBindPipeline(m_pWRenderer->m_DrawCmdBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, debugNormalsPipeline);
+		vkCmdBindPipeline(m_pWRenderer->m_DrawCmdBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, debugNormalsPipeline);
 
-			// Bind descriptor sets describing shader binding points
-			vkCmdBindDescriptorSets(m_pWRenderer->m_DrawCmdBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, debugNormalsPipelineLayout, 0, 1, &debugNormalDescriptor, 0, NULL);
+		// Bind descriptor sets describing shader binding points
+		vkCmdBindDescriptorSets(m_pWRenderer->m_DrawCmdBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, debugNormalsPipelineLayout, 0, 1, &debugNormalDescriptor, 1, &meshOffset);
 
-			// Bind triangle vertex buffer (contains position and colors)
-			VkDeviceSize offsets[1] = { 0 };
-			for (int j = 0; j < listLocalBuffersVerts.size(); j++)
-			{
-				//Bind Buffer
-				vkCmdBindVertexBuffers(m_pWRenderer->m_DrawCmdBuffers[i], VERTEX_BUFFER_BIND_ID, 1, &listLocalBuffersVerts[j].buffer, offsets);
-				vkCmdBindIndexBuffer(m_pWRenderer->m_DrawCmdBuffers[i], listLocalBuffersIndexes[j].buffer, 0, VK_INDEX_TYPE_UINT32);
+		// All surfaces share one vertex and index buffer
+		staticModel.BindBuffers(m_pWRenderer->m_DrawCmdBuffers[i], VERTEX_BUFFER_BIND_ID);
+		for (int j = 0; j < staticModel.m_Entries.size(); j++)
+		{
+			const modelSurface_t& surf = staticModel.m_Entries[j];
 
-				//Draw
-				vkCmdDrawIndexed(m_pWRenderer->m_DrawCmdBuffers[i], meshSize[j], 1, 0, 0, 1);
-			}
+			//Draw
+			vkCmdDrawIndexed(m_pWRenderer->m_DrawCmdBuffers[i], surf.indexCount, 1, surf.firstIndex, surf.vertexOffset, 1);
 		}
-
-		vkCmdEndRenderPass(m_pWRenderer->m_DrawCmdBuffers[i]);
-		VK_CHECK_RESULT(vkEndCommandBuffer(m_pWRenderer->m_DrawCmdBuffers[i]));
 	}
+
+	vkCmdEndRenderPass(m_pWRenderer->m_DrawCmdBuffers[i]);
+	m_pGpuProfiler->EndScope(m_pWRenderer->m_DrawCmdBuffers[i]);
+	VK_CHECK_RESULT(vkEndCommandBuffer(m_pWRenderer->m_DrawCmdBuffers[i]));
 }
 
-void Renderer::PrepareFramebufferCommands()
+void Renderer::RecordFramebufferCommands(VkCommandBuffer cmdBuffer, uint32_t set)
 {
-	if (GBufferScreenCmdBuffer == VK_NULL_HANDLE)
-	{
-		VkCommandBufferAllocateInfo cmdBufAllocateInfo =
-			VkTools::Initializer::CommandBufferAllocateInfo(
-				m_pWRenderer->m_CmdPool,
-				VK_COMMAND_BUFFER_LEVEL_PRIMARY,
-				1);
-
-		VK_CHECK_RESULT(vkAllocateCommandBuffers(m_pWRenderer->m_SwapChain.device, &cmdBufAllocateInfo, &GBufferScreenCmdBuffer));
-	}
-
-	VkCommandBufferBeginInfo cmdBufInfo = VkTools::Initializer::CommandBufferBeginInfo();
-
-	std::array<VkClearValue, 5> clearValues;
-	clearValues[0].color = { { 0.0f, 0.0f, 0.0f, 0.0f } };
-	clearValues[1].color = { { 0.0f, 0.0f, 0.0f, 0.0f } };
-	clearValues[2].color = { { 0.0f, 0.0f, 0.0f, 0.0f } };
-	clearValues[3].color = { { 0.0f, 0.0f, 0.0f, 0.0f } };
-	clearValues[4].depthStencil = { 1.0f, 0 };
+	const uint32_t meshOffset = static_cast<uint32_t>(meshHandle.offset);
+	VulkanRenderGraph* pRenderGraph = m_pRenderGraphs[set];
 
-	VkRenderPassBeginInfo renderPassBeginInfo = VkTools::Initializer::RenderPassBeginInfo();
-	renderPassBeginInfo.renderPass = offScreenFrameBuf.renderPass;
-	renderPassBeginInfo.framebuffer = offScreenFrameBuf.frameBuffer;
-	renderPassBeginInfo.renderArea.offset.x = 0;
-	renderPassBeginInfo.renderArea.offset.y = 0;
-	renderPassBeginInfo.renderArea.extent.width = offScreenFrameBuf.width;
-	renderPassBeginInfo.renderArea.extent.height = offScreenFrameBuf.height;
-	renderPassBeginInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
-	renderPassBeginInfo.pClearValues = clearValues.data();
-
-	VK_CHECK_RESULT(vkBeginCommandBuffer(GBufferScreenCmdBuffer, &cmdBufInfo));
-
-
-	VkViewport viewport = VkTools::Initializer::Viewport((float)offScreenFrameBuf.width, (float)offScreenFrameBuf.height, 0.0f, 1.0f);
-	vkCmdSetViewport(GBufferScreenCmdBuffer, 0, 1, &viewport);
-
-	VkRect2D scissor = VkTools::Initializer::Rect2D(offScreenFrameBuf.width, offScreenFrameBuf.height, 0, 0);
-	vkCmdSetScissor(GBufferScreenCmdBuffer, 0, 1, &scissor);
+	const VkExtent2D extent = pRenderGraph->GetExtent(graphPasses.gbuffer);
+	VkViewport viewport = VkTools::Initializer::Viewport((float)extent.width, (float)extent.height, 0.0f, 1.0f);
+	vkCmdSetViewport(cmdBuffer, 0, 1, &viewport);
 
+	VkRect2D scissor = VkTools::Initializer::Rect2D(extent.width, extent.height, 0, 0);
+	vkCmdSetScissor(cmdBuffer, 0, 1, &scissor);
 
-	vkCmdBeginRenderPass(GBufferScreenCmdBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
-	vkCmdBindPipeline(GBufferScreenCmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, frameBufferPipeline);
 
-	// Bind triangle vertex buffer (contains position and colors)
-	VkDeviceSize offsets[1] = { 0 };
-	for (int j = 0; j < listLocalBuffersVerts.size(); j++)
+	//First use barriers of the set wait for the composite that sampled it two frames ago
+	m_pGpuProfiler->BeginScope(cmdBuffer, "G-Buffer");
+	if (pRenderGraph->BeginPass(cmdBuffer, graphPasses.gbuffer))
 	{
-		// Bind descriptor sets describing shader binding points
-		vkCmdBindDescriptorSets(GBufferScreenCmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, frameBufferPipelineLayout, 0, 1, &listDescriptros[j], 0, NULL);
-
-		//Bind Buffer
-		vkCmdBindVertexBuffers(GBufferScreenCmdBuffer, VERTEX_BUFFER_BIND_ID, 1, &listLocalBuffersVerts[j].buffer, offsets);
-		vkCmdBindIndexBuffer(GBufferScreenCmdBuffer, listLocalBuffersIndexes[j].buffer, 0, VK_INDEX_TYPE_UINT32);
-
-		//Draw
-		vkCmdDrawIndexed(GBufferScreenCmdBuffer, meshSize[j], 1, 0, 0, 1);
-		//vkCmdDrawIndirect(GBufferScreenCmdBuffer, nullptr , 0, 3, 0);
-		//vkCmdDraw(GBufferScreenCmdBuffer, meshSize[j], 3, 0, 0);
-	}
-
-
-
-	vkCmdEndRenderPass(GBufferScreenCmdBuffer);
-	VK_CHECK_RESULT(vkEndCommandBuffer(GBufferScreenCmdBuffer));
-}
+		vkCmdBindPipeline(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, frameBufferPipeline);
 
+		// All surfaces share one vertex and index buffer
+		staticModel.BindBuffers(cmdBuffer, VERTEX_BUFFER_BIND_ID);
+		for (int j = 0; j < staticModel.m_Entries.size(); j++)
+		{
+			const modelSurface_t& surf = staticModel.m_Entries[j];
 
+			// Bind descriptor sets describing shader binding points
+			vkCmdBindDescriptorSets(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, frameBufferPipelineLayout, 0, 1, &listDescriptros[j], 1, &meshOffset);
 
-void Renderer::CreateAttachement(
-	VkFormat format,
-	VkImageUsageFlagBits usage,
-	FrameBufferAttachment *attachment,
-	VkCommandBuffer layoutCmd)
-{
-	VkImageAspectFlags aspectMask = 0;
-	VkImageLayout imageLayout;
-	attachment->format = format;
+			//Draw
+			vkCmdDrawIndexed(cmdBuffer, surf.indexCount, 1, surf.firstIndex, surf.vertexOffset, 1);
+		}
 
-	if (usage & VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT)
-	{
-		aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-		imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-	}
-	if (usage & VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT)
-	{
-		aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT;
-		imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+		pRenderGraph->EndPass(cmdBuffer, graphPasses.gbuffer);
 	}
-
-
-	assert(aspectMask > 0);
-
-	VkImageCreateInfo image = VkTools::Initializer::ImageCreateInfo();
-	image.imageType = VK_IMAGE_TYPE_2D;
-	image.format = format;
-	image.extent.width = offScreenFrameBuf.width;
-	image.extent.height = offScreenFrameBuf.height;
-	image.extent.depth = 1;
-	image.mipLevels = 1;
-	image.arrayLayers = 1;
-	image.samples = VK_SAMPLE_COUNT_1_BIT;
-	image.tiling = VK_IMAGE_TILING_OPTIMAL;
-	image.usage = usage | VK_IMAGE_USAGE_SAMPLED_BIT;
-
-	VkMemoryAllocateInfo memAlloc = VkTools::Initializer::MemoryAllocateInfo();
-	VkMemoryRequirements memReqs;
-
-	VK_CHECK_RESULT(vkCreateImage(m_pWRenderer->m_SwapChain.device, &image, nullptr, &attachment->image));
-	vkGetImageMemoryRequirements(m_pWRenderer->m_SwapChain.device, attachment->image, &memReqs);
-	memAlloc.allocationSize = memReqs.size;
-	memAlloc.memoryTypeIndex = VkTools::GetMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_pWRenderer->m_DeviceMemoryProperties);
-
-	VK_CHECK_RESULT(vkAllocateMemory(m_pWRenderer->m_SwapChain.device, &memAlloc, nullptr, &attachment->mem));
-	VK_CHECK_RESULT(vkBindImageMemory(m_pWRenderer->m_SwapChain.device, attachment->image, attachment->mem, 0));
-
-	VkImageViewCreateInfo imageView = VkTools::Initializer::ImageViewCreateInfo();
-	imageView.viewType = VK_IMAGE_VIEW_TYPE_2D;
-	imageView.format = format;
-	imageView.subresourceRange = {};
-	imageView.subresourceRange.aspectMask = aspectMask;
-	imageView.subresourceRange.baseMipLevel = 0;
-	imageView.subresourceRange.levelCount = 1;
-	imageView.subresourceRange.baseArrayLayer = 0;
-	imageView.subresourceRange.layerCount = 1;
-	imageView.image = attachment->image;
-	VK_CHECK_RESULT(vkCreateImageView(m_pWRenderer->m_SwapChain.device, &imageView, nullptr, &attachment->view));
+	m_pGpuProfiler->EndScope(cmdBuffer);
 }
 
 
+
 void Renderer::CreateFrameBuffer()
 {
-
-	//Create command buffer
-	VkCommandBuffer layoutCmd;
-	VkCommandBufferAllocateInfo cmdBufAllocateInfo =
-		VkTools::Initializer::CommandBufferAllocateInfo(
-			m_pWRenderer->m_CmdPool,
-			VK_COMMAND_BUFFER_LEVEL_PRIMARY,
-			1);
-
-	VK_CHECK_RESULT(vkAllocateCommandBuffers(m_pWRenderer->m_SwapChain.device, &cmdBufAllocateInfo, &layoutCmd));
-
-	VkCommandBufferBeginInfo cmdBufInfo = VkTools::Initializer::CommandBufferBeginInfo();
-
-	//Command buffer created and started
-	VK_CHECK_RESULT(vkBeginCommandBuffer(layoutCmd, &cmdBufInfo));
-
-	//Set framebuffer sizes
-	offScreenFrameBuf.width = GBUFF_DIM;
-	offScreenFrameBuf.height = GBUFF_DIM;
-
-	frameBuffersSSAO.ssao.width = GBUFF_DIM;
-	frameBuffersSSAO.ssao.height = GBUFF_DIM;
-
-	frameBuffersSSAO.ssaoBlur.width = GBUFF_DIM;
-	frameBuffersSSAO.ssaoBlur.height = GBUFF_DIM;
-
-	//Position
-	CreateAttachement(VK_FORMAT_R32G32B32A32_SFLOAT,
-		VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
-		&offScreenFrameBuf.position,
-		layoutCmd);
-
-
-	//Specular
-	CreateAttachement(VK_FORMAT_R32G32B32A32_SFLOAT,
-		VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
-		&offScreenFrameBuf.specular,
-		layoutCmd);
-
-	//Normal, Diffuse - Packed
-	CreateAttachement(VK_FORMAT_R32G32B32A32_UINT,
-		VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
-		&offScreenFrameBuf.nm,
-		layoutCmd);
-
-	//Normal, Depth
-	CreateAttachement(VK_FORMAT_R32G32B32A32_SFLOAT,
-		VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
-		&offScreenFrameBuf.modeNormal,
-		layoutCmd);
-
-	//SSAO
-	CreateAttachement(VK_FORMAT_R8_UNORM,
-		VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
-		&frameBuffersSSAO.ssao.attachement,
-		layoutCmd);
-
-	//SSAO Blur
-	CreateAttachement(VK_FORMAT_R8_UNORM,
-		VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
-		&frameBuffersSSAO.ssaoBlur.attachement,
-		layoutCmd);
-
+	const VkClearColorValue clearColor = { { 0.0f, 0.0f, 0.0f, 0.0f } };
+	const VkClearDepthStencilValue clearDepth = { 1.0f, 0 };
 
 	// Find a suitable depth format
 	VkFormat attDepthFormat;
 	VkBool32 validDepthFormat = VkTools::GetSupportedDepthFormat(m_pWRenderer->m_SwapChain.physicalDevice, attDepthFormat);
 	assert(validDepthFormat);
 
-	//Depth
-	CreateAttachement(attDepthFormat,
-		VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
-		&offScreenFrameBuf.depth,
-		layoutCmd);
+	//Same images and passes in every set, handles are the same too
+	for (uint32_t set = 0; set < GBUFF_SETS; set++)
+	{
+		VulkanRenderGraph* pRenderGraph = TYW_NEW VulkanRenderGraph(m_pWRenderer->m_SwapChain.device, m_pWRenderer->m_graphicsQueueIndex);
 
-	//Free command buffer
-	VK_CHECK_RESULT(vkEndCommandBuffer(layoutCmd));
-	VkSubmitInfo submitInfo = {};
-	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-	submitInfo.commandBufferCount = 1;
-	submitInfo.pCommandBuffers = &layoutCmd;
+		//G-Buffer
+		graphImages.position = pRenderGraph->CreateImage("Position", VK_FORMAT_R32G32B32A32_SFLOAT, GBUFF_DIM, GBUFF_DIM);
+		graphImages.specular = pRenderGraph->CreateImage("Specular", VK_FORMAT_R32G32B32A32_SFLOAT, GBUFF_DIM, GBUFF_DIM);
+		graphImages.nm = pRenderGraph->CreateImage("Normal Diffuse", VK_FORMAT_R32G32B32A32_UINT, GBUFF_DIM, GBUFF_DIM);
+		graphImages.modeNormal = pRenderGraph->CreateImage("Model Normal", VK_FORMAT_R32G32B32A32_SFLOAT, GBUFF_DIM, GBUFF_DIM);
+		graphImages.depth = pRenderGraph->CreateImage("Depth", attDepthFormat, GBUFF_DIM, GBUFF_DIM);
 
-	VK_CHECK_RESULT(vkQueueSubmit(m_pWRenderer->m_Queue, 1, &submitInfo, VK_NULL_HANDLE));
-	VK_CHECK_RESULT(vkQueueWaitIdle(m_pWRenderer->m_Queue));
-	vkFreeCommandBuffers(m_pWRenderer->m_SwapChain.device, m_pWRenderer->m_CmdPool, 1, &layoutCmd);
+		graphPasses.gbuffer = pRenderGraph->AddPass("G-Buffer");
+		pRenderGraph->WriteColor(graphPasses.gbuffer, graphImages.position, clearColor);
+		pRenderGraph->WriteColor(graphPasses.gbuffer, graphImages.specular, clearColor);
+		pRenderGraph->WriteColor(graphPasses.gbuffer, graphImages.nm, clearColor);
+		pRenderGraph->WriteColor(graphPasses.gbuffer, graphImages.modeNormal, clearColor);
+		pRenderGraph->WriteDepth(graphPasses.gbuffer, graphImages.depth, clearDepth);
 
-	//Deffered FrameBuffer
-	{
-		std::array<VkAttachmentDescription, 5> attachmentDescs = {};
+		//Storage images need a format every device can write from compute shaders
+		const VkFormat ssaoFormat = m_bComputeSSAO ? VK_FORMAT_R32_SFLOAT : VK_FORMAT_R8_UNORM;
 
-		// Init attachment properties
-		for (uint32_t i = 0; i < attachmentDescs.size(); ++i)
+		//SSAO
+		graphImages.ssao = pRenderGraph->CreateImage("SSAO", ssaoFormat, GBUFF_DIM, GBUFF_DIM);
+		if (m_bComputeSSAO)
 		{
-			attachmentDescs[i].samples = VK_SAMPLE_COUNT_1_BIT;
-			attachmentDescs[i].loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-			attachmentDescs[i].storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-			attachmentDescs[i].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-			attachmentDescs[i].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-
-			//depth buffer == 4
-			attachmentDescs[i].initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-			attachmentDescs[i].finalLayout = (i == 4) ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL : VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+			graphPasses.ssao = pRenderGraph->AddComputePass("SSAO", m_pWRenderer->m_computeQueueIndex);
+			pRenderGraph->ReadTexture(graphPasses.ssao, graphImages.position);
+			pRenderGraph->ReadTexture(graphPasses.ssao, graphImages.modeNormal);
+			pRenderGraph->WriteStorage(graphPasses.ssao, graphImages.ssao);
+		}
+		else
+		{
+			graphPasses.ssao = pRenderGraph->AddPass("SSAO");
+			pRenderGraph->ReadTexture(graphPasses.ssao, graphImages.position);
+			pRenderGraph->ReadTexture(graphPasses.ssao, graphImages.modeNormal);
+			pRenderGraph->WriteColor(graphPasses.ssao, graphImages.ssao, clearColor);
 		}
 
-		// Formats
-		attachmentDescs[0].format = offScreenFrameBuf.position.format;
-		attachmentDescs[1].format = offScreenFrameBuf.specular.format;
-		attachmentDescs[2].format = offScreenFrameBuf.nm.format;
-		attachmentDescs[3].format = offScreenFrameBuf.modeNormal.format;
-		attachmentDescs[4].format = offScreenFrameBuf.depth.format;
-
-		std::vector<VkAttachmentReference> colorReferences;
-		colorReferences.push_back({ 0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL });
-		colorReferences.push_back({ 1, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL });
-		colorReferences.push_back({ 2, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL });
-		colorReferences.push_back({ 3, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL });
-
-		VkAttachmentReference depthReference = {};
-		depthReference.attachment = 4;
-		depthReference.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
-
-		VkSubpassDescription subpass = {};
-		subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
-		subpass.pColorAttachments = colorReferences.data();
-		subpass.colorAttachmentCount = static_cast<uint32_t>(colorReferences.size());
-		subpass.pDepthStencilAttachment = &depthReference;
-
-		// Use subpass dependencies for attachment layput transitions
-		std::array<VkSubpassDependency, 2> dependencies;
-
-		dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
-		dependencies[0].dstSubpass = 0;
-		dependencies[0].srcStageMask = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
-		dependencies[0].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-		dependencies[0].srcAccessMask = VK_ACCESS_MEMORY_READ_BIT;
-		dependencies[0].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-		dependencies[0].dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
-
-		dependencies[1].srcSubpass = 0;
-		dependencies[1].dstSubpass = VK_SUBPASS_EXTERNAL;
-		dependencies[1].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-		dependencies[1].dstStageMask = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
-		dependencies[1].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-		dependencies[1].dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
-		dependencies[1].dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
-
-
-		VkRenderPassCreateInfo renderPassInfo = {};
-		renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-		renderPassInfo.pAttachments = attachmentDescs.data();
-		renderPassInfo.attachmentCount = static_cast<uint32_t>(attachmentDescs.size());
-		renderPassInfo.subpassCount = 1;
-		renderPassInfo.pSubpasses = &subpass;
-		renderPassInfo.dependencyCount = 2;
-		renderPassInfo.pDependencies = dependencies.data();
-
-		VK_CHECK_RESULT(vkCreateRenderPass(m_pWRenderer->m_SwapChain.device, &renderPassInfo, nullptr, &offScreenFrameBuf.renderPass));
-
-		std::array<VkImageView, 5> attachments;
-		attachments[0] = offScreenFrameBuf.position.view;
-		attachments[1] = offScreenFrameBuf.specular.view;
-		attachments[2] = offScreenFrameBuf.nm.view;
-		attachments[3] = offScreenFrameBuf.modeNormal.view;
-		attachments[4] = offScreenFrameBuf.depth.view;
-
-		VkFramebufferCreateInfo fbufCreateInfo = {};
-		fbufCreateInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-		fbufCreateInfo.pNext = NULL;
-		fbufCreateInfo.renderPass = offScreenFrameBuf.renderPass;
-		fbufCreateInfo.pAttachments = attachments.data();
-		fbufCreateInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
-		fbufCreateInfo.width = offScreenFrameBuf.width;
-		fbufCreateInfo.height = offScreenFrameBuf.height;
-		fbufCreateInfo.layers = 1;
-		VK_CHECK_RESULT(vkCreateFramebuffer(m_pWRenderer->m_SwapChain.device, &fbufCreateInfo, nullptr, &offScreenFrameBuf.frameBuffer));
-	}
+		//SSAO Blur
+		graphImages.ssaoBlur = pRenderGraph->CreateImage("SSAO Blur", ssaoFormat, GBUFF_DIM, GBUFF_DIM);
+		if (m_bComputeSSAO)
+		{
+			graphPasses.ssaoBlur = pRenderGraph->AddComputePass("SSAO Blur", m_pWRenderer->m_computeQueueIndex);
+			pRenderGraph->ReadTexture(graphPasses.ssaoBlur, graphImages.ssao);
+			pRenderGraph->WriteStorage(graphPasses.ssaoBlur, graphImages.ssaoBlur);
+		}
+		else
+		{
+			graphPasses.ssaoBlur = pRenderGraph->AddPass("SSAO Blur");
+			pRenderGraph->ReadTexture(graphPasses.ssaoBlur, graphImages.ssao);
+			pRenderGraph->WriteColor(graphPasses.ssaoBlur, graphImages.ssaoBlur, clearColor);
+		}
 
-	//SSAO
-	{
-		VkAttachmentDescription attachmentDescription{};
-		attachmentDescription.format = frameBuffersSSAO.ssao.attachement.format;
-		attachmentDescription.samples = VK_SAMPLE_COUNT_1_BIT;
-		attachmentDescription.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-		attachmentDescription.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-		attachmentDescription.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-		attachmentDescription.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-		attachmentDescription.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-		attachmentDescription.finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-
-		VkAttachmentReference colorReference = { 0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL };
-
-		VkSubpassDescription subpass = {};
-		subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
-		subpass.pColorAttachments = &colorReference;
-		subpass.colorAttachmentCount = 1;
-
-		// Use subpass dependencies for attachment layput transitions
-		std::array<VkSubpassDependency, 2> dependencies;
-
-		dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
-		dependencies[0].dstSubpass = 0;
-		dependencies[0].srcStageMask = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
-		dependencies[0].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-		dependencies[0].srcAccessMask = VK_ACCESS_MEMORY_READ_BIT;
-		dependencies[0].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-		dependencies[0].dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
-
-		dependencies[1].srcSubpass = 0;
-		dependencies[1].dstSubpass = VK_SUBPASS_EXTERNAL;
-		dependencies[1].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-		dependencies[1].dstStageMask = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
-		dependencies[1].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-		dependencies[1].dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
-		dependencies[1].dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
-
-
-		VkRenderPassCreateInfo renderPassInfo = {};
-		renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-		renderPassInfo.pAttachments = &attachmentDescription;
-		renderPassInfo.attachmentCount = 1;
-		renderPassInfo.subpassCount = 1;
-		renderPassInfo.pSubpasses = &subpass;
-		renderPassInfo.dependencyCount = 2;
-		renderPassInfo.pDependencies = dependencies.data();
-
-		VK_CHECK_RESULT(vkCreateRenderPass(m_pWRenderer->m_SwapChain.device, &renderPassInfo, nullptr, &frameBuffersSSAO.ssao.renderPass));
-
-		VkFramebufferCreateInfo fbufCreateInfo = {};
-		fbufCreateInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-		fbufCreateInfo.pNext = NULL;
-		fbufCreateInfo.renderPass = frameBuffersSSAO.ssao.renderPass;
-		fbufCreateInfo.pAttachments = &frameBuffersSSAO.ssao.attachement.view;
-		fbufCreateInfo.attachmentCount = 1;
-		fbufCreateInfo.width = frameBuffersSSAO.ssao.width;
-		fbufCreateInfo.height = frameBuffersSSAO.ssao.height;
-		fbufCreateInfo.layers = 1;
-		VK_CHECK_RESULT(vkCreateFramebuffer(m_pWRenderer->m_SwapChain.device, &fbufCreateInfo, nullptr, &frameBuffersSSAO.ssao.frameBuffer));
-	}
+		//Composition and debug quads sample these after the graph
+		pRenderGraph->Export(graphImages.position);
+		pRenderGraph->Export(graphImages.specular);
+		pRenderGraph->Export(graphImages.nm);
+		pRenderGraph->Export(graphImages.modeNormal);
+		pRenderGraph->Export(graphImages.ssao);
+		pRenderGraph->Export(graphImages.ssaoBlur);
 
-	//SSAO Blur
-	{
-		VkAttachmentDescription attachmentDescription{};
-		attachmentDescription.format = frameBuffersSSAO.ssaoBlur.attachement.format;
-		attachmentDescription.samples = VK_SAMPLE_COUNT_1_BIT;
-		attachmentDescription.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-		attachmentDescription.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-		attachmentDescription.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-		attachmentDescription.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-		attachmentDescription.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-		attachmentDescription.finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-
-		VkAttachmentReference colorReference = { 0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL };
-
-		VkSubpassDescription subpass = {};
-		subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
-		subpass.pColorAttachments = &colorReference;
-		subpass.colorAttachmentCount = 1;
-
-		// Use subpass dependencies for attachment layput transitions
-		std::array<VkSubpassDependency, 2> dependencies;
-
-		dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
-		dependencies[0].dstSubpass = 0;
-		dependencies[0].srcStageMask = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
-		dependencies[0].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-		dependencies[0].srcAccessMask = VK_ACCESS_MEMORY_READ_BIT;
-		dependencies[0].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-		dependencies[0].dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
-
-		dependencies[1].srcSubpass = 0;
-		dependencies[1].dstSubpass = VK_SUBPASS_EXTERNAL;
-		dependencies[1].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-		dependencies[1].dstStageMask = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
-		dependencies[1].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-		dependencies[1].dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
-		dependencies[1].dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
-
-
-		VkRenderPassCreateInfo renderPassInfo = {};
-		renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-		renderPassInfo.pAttachments = &attachmentDescription;
-		renderPassInfo.attachmentCount = 1;
-		renderPassInfo.subpassCount = 1;
-		renderPassInfo.pSubpasses = &subpass;
-		renderPassInfo.dependencyCount = 2;
-		renderPassInfo.pDependencies = dependencies.data();
-
-		VK_CHECK_RESULT(vkCreateRenderPass(m_pWRenderer->m_SwapChain.device, &renderPassInfo, nullptr, &frameBuffersSSAO.ssaoBlur.renderPass));
-
-		VkFramebufferCreateInfo fbufCreateInfo = {};
-		fbufCreateInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-		fbufCreateInfo.pNext = NULL;
-		fbufCreateInfo.renderPass = frameBuffersSSAO.ssaoBlur.renderPass;
-		fbufCreateInfo.pAttachments = &frameBuffersSSAO.ssaoBlur.attachement.view;
-		fbufCreateInfo.attachmentCount = 1;
-		fbufCreateInfo.width = frameBuffersSSAO.ssaoBlur.width;
-		fbufCreateInfo.height = frameBuffersSSAO.ssaoBlur.height;
-		fbufCreateInfo.layers = 1;
-		VK_CHECK_RESULT(vkCreateFramebuffer(m_pWRenderer->m_SwapChain.device, &fbufCreateInfo, nullptr, &frameBuffersSSAO.ssaoBlur.frameBuffer));
+		pRenderGraph->Compile();
+		m_pRenderGraphs[set] = pRenderGraph;
 	}
 
+
 	// Create sampler to sample from the color attachments
 	VkSamplerCreateInfo sampler = VkTools::Initializer::SamplerCreateInfo();
 	sampler.magFilter = VK_FILTER_LINEAR;
@@ -1798,20 +1411,23 @@ void Renderer::BeginTextUpdate()
 
 void Renderer::BuildCommandBuffers()
 {
-	VkCommandBufferAllocateInfo cmdBufAllocateInfo = VkTools::Initializer::CommandBufferAllocateInfo(m_pWRenderer->m_CmdPool, VK_COMMAND_BUFFER_LEVEL_PRIMARY, 1);
-	VK_CHECK_RESULT(vkAllocateCommandBuffers(m_pWRenderer->m_SwapChain.device, &cmdBufAllocateInfo, &cmdGui));
-
-	//Prepare FrameBuffer Commands
-	PrepareFramebufferCommands();
-
-	//Prepare SSAO Commands
-	PrepareSSAOCommands();
+	//G-Buffer, SSAO, composite and GUI commands are recorded every frame in StartFrame.
+	//Graphics ones go to frame manager command buffers, compute ones to one buffer per set
+	if (!m_bComputeSSAO || m_ComputeCmdBuffers[0] != VK_NULL_HANDLE)
+	{
+		return;
+	}
 
-	//Prepare Blur commands
-	PrepareSSAOBlurCommands();
+	VkCommandBufferAllocateInfo cmdBufAllocateInfo = VkTools::Initializer::CommandBufferAllocateInfo(m_ComputeCmdPool, VK_COMMAND_BUFFER_LEVEL_PRIMARY, GBUFF_SETS);
+	VK_CHECK_RESULT(vkAllocateCommandBuffers(m_pWRenderer->m_SwapChain.device, &cmdBufAllocateInfo, m_ComputeCmdBuffers));
 
-	//Main Rendere Commands
-	PrepareMainRendererCommands();
+	//Signaled, the first wait of a set returns at once
+	VkFenceCreateInfo fenceCreateInfo = VkTools::Initializer::FenceCreateInfo(VK_FENCE_CREATE_SIGNALED_BIT);
+	for (uint32_t i = 0; i < GBUFF_SETS; i++)
+	{
+		m_pGpuProfiler->SetQueue(m_ComputeCmdBuffers[i], m_ComputeProfilerQueue);
+		VK_CHECK_RESULT(vkCreateFence(m_pWRenderer->m_SwapChain.device, &fenceCreateInfo, nullptr, &m_ComputeFences[i]));
+	}
 }
 
 void Renderer::UpdateUniformBuffers()
@@ -1834,46 +1450,22 @@ void Renderer::UpdateUniformBuffers()
 	//m_uboVS.modelMatrix = glm::mat4();
 	m_uboVS.modelMatrix = glm::scale(glm::mat4(), glm::vec3(0.2, 0.2, 0.2));
 	//m_uboVS.modelMatrix = glm::scale(m_uboVS.modelMatrix, glm::vec3(0.2, 0.2, 0.2));
-	{
-		// Map uniform buffer and update it
-		uint8_t *pData;
-		VK_CHECK_RESULT(vkMapMemory(m_pWRenderer->m_SwapChain.device, uniformData.mesh.memory, 0, sizeof(m_uboVS), 0, (void **)&pData));
-		memcpy(pData, &m_uboVS, sizeof(m_uboVS));
-		vkUnmapMemory(m_pWRenderer->m_SwapChain.device, uniformData.mesh.memory);
-	}
+	//Copied to a new uniform offset every frame in StartFrame
 
 	//FullScreen
 	uboFullScreen.projection = glm::ortho(0.0f, 1.0f, 0.0f, 1.0f, -1.0f, 1.0f);
 	uboFullScreen.model = glm::mat4();
 	{
-		uint8_t *pData;
-		VK_CHECK_RESULT(vkMapMemory(m_pWRenderer->m_SwapChain.device, uniformData.vsFullScreen.memory, 0, sizeof(uboFullScreen), 0, (void **)&pData));
-		memcpy(pData, &uboFullScreen, sizeof(uboFullScreen));
-		vkUnmapMemory(m_pWRenderer->m_SwapChain.device, uniformData.vsFullScreen.memory);
+		memcpy(uniformData.vsFullScreen.mapped, &uboFullScreen, sizeof(uboFullScreen));
 	}
 
-	//SSAO
+	//SSAO. Copied to the uniform buffer of the set in StartFrame, once the set is free
 	uboSSAOProjection.projection = m_Camera.matrices.perspective;
 	uboSSAOProjection.view = m_Camera.matrices.view;
-	{
-		void * pData;
-		VK_CHECK_RESULT(vkMapMemory(m_pWRenderer->m_SwapChain.device, uniformData.ssaoprojection.memory, 0, sizeof(uboSSAOProjection), 0, (void **)&pData));
-		memcpy(pData, &uboSSAOProjection, sizeof(uboSSAOProjection));
-		vkUnmapMemory(m_pWRenderer->m_SwapChain.device, uniformData.ssaoprojection.memory);
-	}
 }
 
 void Renderer::PrepareUniformBuffers()
 {
-	//Mesh uniform buffer
-	CreateUniformBuffer(
-		VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-		sizeof(m_uboVS),
-		uniformData.mesh,
-		&m_uboVS);
-
-
 	//prepare quad
 	CreateUniformBuffer(
 		VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
@@ -1882,14 +1474,6 @@ void Renderer::PrepareUniformBuffers()
 		uniformData.quad,
 		&quadUniformData);
 
-	//prepare light
-	CreateUniformBuffer(
-		VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-		sizeof(uboFragmentLights),
-		uniformData.fsLights,
-		&uboFragmentLights);
-
 	//prepare fullscreen
 	CreateUniformBuffer(
 		VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
@@ -1906,13 +1490,16 @@ void Renderer::PrepareUniformBuffers()
 		uniformData.ssaokernel,
 		&uboSSAOKernel);
 
-	//ssao projection
-	CreateUniformBuffer(
-		VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-		sizeof(uboSSAOProjection),
-		uniformData.ssaoprojection,
-		&uboSSAOProjection);
+	//ssao projection, one per set
+	for (uint32_t i = 0; i < GBUFF_SETS; i++)
+	{
+		CreateUniformBuffer(
+			VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+			sizeof(uboSSAOProjection),
+			uniformData.ssaoprojection[i],
+			&uboSSAOProjection);
+	}
 
 
 	//Deffered debug
@@ -1950,17 +1537,6 @@ void Renderer::PrepareVertices(bool useStagingBuffers)
 
 	staticModel.InitFromFile("Geometry/Sponza/sponza.dae", GetAssetPath());
 
-	std::vector<VkBufferObject_s> listStagingBuffersVertices;
-	std::vector<VkBufferObject_s> listStagingBuffersIndexes;
-
-	//Local buffers
-	listLocalBuffersVerts.resize(staticModel.m_Entries.size());
-	listLocalBuffersIndexes.resize(staticModel.m_Entries.size());
-
-	//Stagging buffers
-	listStagingBuffersVertices.resize(staticModel.m_Entries.size());
-	listStagingBuffersIndexes.resize(staticModel.m_Entries.size());
-
 	//Descriptor buffer
 	listDescriptros.resize(staticModel.m_Entries.size());
 
@@ -1968,133 +1544,169 @@ void Renderer::PrepareVertices(bool useStagingBuffers)
 	SetupDescriptorPool();
 	
 
-	VkDescriptorImageInfo PositionImage =
-		VkTools::Initializer::DescriptorImageInfo(
-			colorSampler,
-			offScreenFrameBuf.position.view,
-			VK_IMAGE_LAYOUT_GENERAL);
+	//Lights and mesh matrices, offset is given when binding
+	VkDescriptorBufferInfo lightsDescriptor = vertexCache.UniformDescriptor(sizeof(uboFragmentLights));
+	VkDescriptorBufferInfo meshDescriptor = vertexCache.UniformDescriptor(sizeof(m_uboVS));
+
+	//Noise generated texture 
+	VkDescriptorImageInfo noiseImage = VkTools::Initializer::DescriptorImageInfo(m_NoiseGeneratedTexture.sampler, m_NoiseGeneratedTexture.view, VK_IMAGE_LAYOUT_GENERAL);
 
+	for (uint32_t set = 0; set < GBUFF_SETS; set++)
+	{
+		VulkanRenderGraph* pRenderGraph = m_pRenderGraphs[set];
 
-	// Image descriptor for the color attachement
-	VkDescriptorImageInfo SpecularImage =
-		VkTools::Initializer::DescriptorImageInfo(
-			colorSampler,
-			offScreenFrameBuf.specular.view,
-			VK_IMAGE_LAYOUT_GENERAL);
+		VkDescriptorImageInfo PositionImage =
+			VkTools::Initializer::DescriptorImageInfo(
+				colorSampler,
+				pRenderGraph->GetImageView(graphImages.position),
+				VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
 
-	//Normal, Diffuse and Specular packed texture
-	VkDescriptorImageInfo GBufferNM =
-		VkTools::Initializer::DescriptorImageInfo(
-			colorSampler,
-			offScreenFrameBuf.nm.view,
-			VK_IMAGE_LAYOUT_GENERAL);
 
+		// Image descriptor for the color attachement
+		VkDescriptorImageInfo SpecularImage =
+			VkTools::Initializer::DescriptorImageInfo(
+				colorSampler,
+				pRenderGraph->GetImageView(graphImages.specular),
+				VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
 
-	//Model normal
-	VkDescriptorImageInfo modelNormal =
-		VkTools::Initializer::DescriptorImageInfo(
-			colorSampler,
-			offScreenFrameBuf.modeNormal.view,
-			VK_IMAGE_LAYOUT_GENERAL);
+		//Normal, Diffuse and Specular packed texture
+		VkDescriptorImageInfo GBufferNM =
+			VkTools::Initializer::DescriptorImageInfo(
+				colorSampler,
+				pRenderGraph->GetImageView(graphImages.nm),
+				VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
 
-	//ssao
-	VkDescriptorImageInfo ssaoImage =
-		VkTools::Initializer::DescriptorImageInfo(
-			colorSampler,
-			frameBuffersSSAO.ssao.attachement.view,
-			VK_IMAGE_LAYOUT_GENERAL);
 
-	VkDescriptorImageInfo ssaoBlurImage =
-		VkTools::Initializer::DescriptorImageInfo(
-			colorSampler,
-			frameBuffersSSAO.ssaoBlur.attachement.view,
-			VK_IMAGE_LAYOUT_GENERAL);
+		//Model normal
+		VkDescriptorImageInfo modelNormal =
+			VkTools::Initializer::DescriptorImageInfo(
+				colorSampler,
+				pRenderGraph->GetImageView(graphImages.modeNormal),
+				VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
 
+		//ssao
+		VkDescriptorImageInfo ssaoImage =
+			VkTools::Initializer::DescriptorImageInfo(
+				colorSampler,
+				pRenderGraph->GetImageView(graphImages.ssao),
+				VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
 
+		VkDescriptorImageInfo ssaoBlurImage =
+			VkTools::Initializer::DescriptorImageInfo(
+				colorSampler,
+				pRenderGraph->GetImageView(graphImages.ssaoBlur),
+				VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
 
-	// Debug Descriptor
-	{
-		VkDescriptorSetAllocateInfo quadDebugallocInfo = VkTools::Initializer::DescriptorSetAllocateInfo(m_pWRenderer->m_DescriptorPool, &quadDescriptorSetLayout, 1);
-		VK_CHECK_RESULT(vkAllocateDescriptorSets(m_pWRenderer->m_SwapChain.device, &quadDebugallocInfo, &quadDescriptorSet));
-		std::vector<VkWriteDescriptorSet> quadWriteDescriptorSets =
+
+
+		// Debug Descriptor
 		{
-			// Binding 0 : Vertex shader uniform buffer
-			VkTools::Initializer::WriteDescriptorSet(quadDescriptorSet,VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,0, &uniformData.quad.descriptor),
+			VkDescriptorSetAllocateInfo quadDebugallocInfo = VkTools::Initializer::DescriptorSetAllocateInfo(m_pWRenderer->m_DescriptorPool, &quadDescriptorSetLayout, 1);
+			VK_CHECK_RESULT(vkAllocateDescriptorSets(m_pWRenderer->m_SwapChain.device, &quadDebugallocInfo, &quadDescriptorSet[set]));
+			std::vector<VkWriteDescriptorSet> quadWriteDescriptorSets =
+			{
+				// Binding 0 : Vertex shader uniform buffer
+				VkTools::Initializer::WriteDescriptorSet(quadDescriptorSet[set],VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,0, &uniformData.quad.descriptor),
 
-			// Binding 1: Image descriptor
-			VkTools::Initializer::WriteDescriptorSet(quadDescriptorSet,VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,1, &PositionImage),
+				// Binding 1: Image descriptor
+				VkTools::Initializer::WriteDescriptorSet(quadDescriptorSet[set],VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,1, &PositionImage),
 
-			// Binding 2: Image descriptor
-			VkTools::Initializer::WriteDescriptorSet(quadDescriptorSet,VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,2, &SpecularImage),
+				// Binding 2: Image descriptor
+				VkTools::Initializer::WriteDescriptorSet(quadDescriptorSet[set],VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,2, &SpecularImage),
 
-			// Binding 3: Image descriptor
-			VkTools::Initializer::WriteDescriptorSet(quadDescriptorSet,VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,3, &GBufferNM),
+				// Binding 3: Image descriptor
+				VkTools::Initializer::WriteDescriptorSet(quadDescriptorSet[set],VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,3, &GBufferNM),
 
-			//Binding 4: SSAO image
-			VkTools::Initializer::WriteDescriptorSet(quadDescriptorSet,VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,4, &ssaoImage),
+				//Binding 4: SSAO image
+				VkTools::Initializer::WriteDescriptorSet(quadDescriptorSet[set],VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,4, &ssaoImage),
 
-			//Normal depth
-			VkTools::Initializer::WriteDescriptorSet(quadDescriptorSet,VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 5, &modelNormal)
+				//Normal depth
+				VkTools::Initializer::WriteDescriptorSet(quadDescriptorSet[set],VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 5, &modelNormal)
 
-		};
-		vkUpdateDescriptorSets(m_pWRenderer->m_SwapChain.device, quadWriteDescriptorSets.size(), quadWriteDescriptorSets.data(), 0, NULL);
-	}
+			};
+			vkUpdateDescriptorSets(m_pWRenderer->m_SwapChain.device, quadWriteDescriptorSets.size(), quadWriteDescriptorSets.data(), 0, NULL);
+		}
 
-	// FullScreen Descriptor
-	{
-		VkDescriptorSetAllocateInfo allocInfoFullScreen = VkTools::Initializer::DescriptorSetAllocateInfo(m_pWRenderer->m_DescriptorPool, &descriptorSetLayout, 1);
-		VK_CHECK_RESULT(vkAllocateDescriptorSets(m_pWRenderer->m_SwapChain.device, &allocInfoFullScreen, &defferedModelDescriptorSet));
-		std::vector<VkWriteDescriptorSet> defferedWriteModelDescriptorSet =
+		// FullScreen Descriptor
 		{
-			// Binding 1: Image descriptor
-			VkTools::Initializer::WriteDescriptorSet(defferedModelDescriptorSet,VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,1, &PositionImage),
+			VkDescriptorSetAllocateInfo allocInfoFullScreen = VkTools::Initializer::DescriptorSetAllocateInfo(m_pWRenderer->m_DescriptorPool, &descriptorSetLayout, 1);
+			VK_CHECK_RESULT(vkAllocateDescriptorSets(m_pWRenderer->m_SwapChain.device, &allocInfoFullScreen, &defferedModelDescriptorSet[set]));
+			std::vector<VkWriteDescriptorSet> defferedWriteModelDescriptorSet =
+			{
+				// Binding 1: Image descriptor
+				VkTools::Initializer::WriteDescriptorSet(defferedModelDescriptorSet[set],VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,1, &PositionImage),
 
-			// Binding 2: Image descriptor
-			VkTools::Initializer::WriteDescriptorSet(defferedModelDescriptorSet,VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,2, &SpecularImage),
+				// Binding 2: Image descriptor
+				VkTools::Initializer::WriteDescriptorSet(defferedModelDescriptorSet[set],VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,2, &SpecularImage),
 
-			// Binding 3: Image descriptor
-			VkTools::Initializer::WriteDescriptorSet(defferedModelDescriptorSet,VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,3, &GBufferNM),
+				// Binding 3: Image descriptor
+				VkTools::Initializer::WriteDescriptorSet(defferedModelDescriptorSet[set],VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,3, &GBufferNM),
 
-			//Binding 4: Image descriptor
-			VkTools::Initializer::WriteDescriptorSet(defferedModelDescriptorSet,VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,4, &ssaoBlurImage),
+				//Binding 4: Image descriptor
+				VkTools::Initializer::WriteDescriptorSet(defferedModelDescriptorSet[set],VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,4, &ssaoBlurImage),
 
-			//Binding 5: Image descriptor
-			VkTools::Initializer::WriteDescriptorSet(defferedModelDescriptorSet,VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,5, &ssaoImage),
+				//Binding 5: Image descriptor
+				VkTools::Initializer::WriteDescriptorSet(defferedModelDescriptorSet[set],VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,5, &ssaoImage),
 
-			//Binding 6
-			VkTools::Initializer::WriteDescriptorSet(defferedModelDescriptorSet,VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 6, &uniformData.fsLights.descriptor),
+				//Binding 6
+				VkTools::Initializer::WriteDescriptorSet(defferedModelDescriptorSet[set],VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 6, &lightsDescriptor),
 
-			//Binding 7
-			VkTools::Initializer::WriteDescriptorSet(defferedModelDescriptorSet,VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 7, &uniformData.defferedDebugOption.descriptor),
-		};
-		vkUpdateDescriptorSets(m_pWRenderer->m_SwapChain.device, defferedWriteModelDescriptorSet.size(), defferedWriteModelDescriptorSet.data(), 0, NULL);
-	}
-
-	//Noise generated texture 
-	VkDescriptorImageInfo noiseImage = VkTools::Initializer::DescriptorImageInfo(m_NoiseGeneratedTexture.sampler, m_NoiseGeneratedTexture.view, VK_IMAGE_LAYOUT_GENERAL);
+				//Binding 7
+				VkTools::Initializer::WriteDescriptorSet(defferedModelDescriptorSet[set],VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 7, &uniformData.defferedDebugOption.descriptor),
+			};
+			vkUpdateDescriptorSets(m_pWRenderer->m_SwapChain.device, defferedWriteModelDescriptorSet.size(), defferedWriteModelDescriptorSet.data(), 0, NULL);
+		}
 
-	//SSAO descriptors
-	{
-		VkDescriptorSetAllocateInfo ssaoallocInfo = VkTools::Initializer::DescriptorSetAllocateInfo(m_pWRenderer->m_DescriptorPool, &ssaoDescriptorSetLayout, 1);
-		VK_CHECK_RESULT(vkAllocateDescriptorSets(m_pWRenderer->m_SwapChain.device, &ssaoallocInfo, &ssaoDescriptorSet));
-		std::vector<VkWriteDescriptorSet> ssaoWriteModelDescriptorSet =
+		//SSAO descriptors
 		{
-			// Binding 1: Image descriptor
-			VkTools::Initializer::WriteDescriptorSet(ssaoDescriptorSet,VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,1, &PositionImage),
+			VkDescriptorSetAllocateInfo ssaoallocInfo = VkTools::Initializer::DescriptorSetAllocateInfo(m_pWRenderer->m_DescriptorPool, &ssaoDescriptorSetLayout, 1);
+			VK_CHECK_RESULT(vkAllocateDescriptorSets(m_pWRenderer->m_SwapChain.device, &ssaoallocInfo, &ssaoDescriptorSet[set]));
+			std::vector<VkWriteDescriptorSet> ssaoWriteModelDescriptorSet =
+			{
+				// Binding 1: Image descriptor
+				VkTools::Initializer::WriteDescriptorSet(ssaoDescriptorSet[set],VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,1, &PositionImage),
 
-			// Binding 2: Image descriptor
-			VkTools::Initializer::WriteDescriptorSet(ssaoDescriptorSet,VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,2, &modelNormal),
+				// Binding 2: Image descriptor
+				VkTools::Initializer::WriteDescriptorSet(ssaoDescriptorSet[set],VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,2, &modelNormal),
 
-			// Binding 3: Image descriptor
-			VkTools::Initializer::WriteDescriptorSet(ssaoDescriptorSet,VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,3, &noiseImage),
+				// Binding 3: Image descriptor
+				VkTools::Initializer::WriteDescriptorSet(ssaoDescriptorSet[set],VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,3, &noiseImage),
 
-			// Binding 4 : Fragment uniform buffer - Kernel
-			VkTools::Initializer::WriteDescriptorSet(ssaoDescriptorSet,VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 4, &uniformData.ssaokernel.descriptor),
+				// Binding 4 : Fragment uniform buffer - Kernel
+				VkTools::Initializer::WriteDescriptorSet(ssaoDescriptorSet[set],VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 4, &uniformData.ssaokernel.descriptor),
 
-			// Binding 5 : Fragment uniform buffer - Projection
-			VkTools::Initializer::WriteDescriptorSet(ssaoDescriptorSet,VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 5, &uniformData.ssaoprojection.descriptor),
-		};
-		vkUpdateDescriptorSets(m_pWRenderer->m_SwapChain.device, ssaoWriteModelDescriptorSet.size(), ssaoWriteModelDescriptorSet.data(), 0, NULL);
+				// Binding 5 : Fragment uniform buffer - Projection
+				VkTools::Initializer::WriteDescriptorSet(ssaoDescriptorSet[set],VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 5, &uniformData.ssaoprojection[set].descriptor),
+			};
+
+			// Binding 0 : Compute shader output
+			VkDescriptorImageInfo ssaoStorageImage = VkTools::Initializer::DescriptorImageInfo(VK_NULL_HANDLE, pRenderGraph->GetImageView(graphImages.ssao), VK_IMAGE_LAYOUT_GENERAL);
+			if (m_bComputeSSAO)
+			{
+				ssaoWriteModelDescriptorSet.push_back(VkTools::Initializer::WriteDescriptorSet(ssaoDescriptorSet[set], VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 0, &ssaoStorageImage));
+			}
+			vkUpdateDescriptorSets(m_pWRenderer->m_SwapChain.device, ssaoWriteModelDescriptorSet.size(), ssaoWriteModelDescriptorSet.data(), 0, NULL);
+		}
+
+
+		//SSAO Blur
+		{
+			VkDescriptorSetAllocateInfo debugNormalllocInfo = VkTools::Initializer::DescriptorSetAllocateInfo(m_pWRenderer->m_DescriptorPool, &blurDescriptorSetLayout, 1);
+			VK_CHECK_RESULT(vkAllocateDescriptorSets(m_pWRenderer->m_SwapChain.device, &debugNormalllocInfo, &blurDescriptorSet[set]));
+			std::vector<VkWriteDescriptorSet> blurWriteModelDescriptorSet =
+			{
+				// Binding 0
+				VkTools::Initializer::WriteDescriptorSet(blurDescriptorSet[set],VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, &ssaoImage),
+			};
+
+			// Binding 0 : Compute shader output
+			VkDescriptorImageInfo blurStorageImage = VkTools::Initializer::DescriptorImageInfo(VK_NULL_HANDLE, pRenderGraph->GetImageView(graphImages.ssaoBlur), VK_IMAGE_LAYOUT_GENERAL);
+			if (m_bComputeSSAO)
+			{
+				blurWriteModelDescriptorSet.push_back(VkTools::Initializer::WriteDescriptorSet(blurDescriptorSet[set], VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 0, &blurStorageImage));
+			}
+			vkUpdateDescriptorSets(m_pWRenderer->m_SwapChain.device, blurWriteModelDescriptorSet.size(), blurWriteModelDescriptorSet.data(), 0, NULL);
+		}
 	}
 
 
@@ -2105,24 +1717,12 @@ void Renderer::PrepareVertices(bool useStagingBuffers)
 		std::vector<VkWriteDescriptorSet> debugNormalWriteModelDescriptorSet =
 		{
 			// Binding 0
-			VkTools::Initializer::WriteDescriptorSet(debugNormalDescriptor,VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 0, &uniformData.mesh.descriptor),
+			VkTools::Initializer::WriteDescriptorSet(debugNormalDescriptor,VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 0, &meshDescriptor),
 			
 		};
 		vkUpdateDescriptorSets(m_pWRenderer->m_SwapChain.device, debugNormalWriteModelDescriptorSet.size(), debugNormalWriteModelDescriptorSet.data(), 0, NULL);
 	}
 
-	//SSAO Blur
-	{
-		VkDescriptorSetAllocateInfo debugNormalllocInfo = VkTools::Initializer::DescriptorSetAllocateInfo(m_pWRenderer->m_DescriptorPool, &blurDescriptorSetLayout, 1);
-		VK_CHECK_RESULT(vkAllocateDescriptorSets(m_pWRenderer->m_SwapChain.device, &debugNormalllocInfo, &blurDescriptorSet));
-		std::vector<VkWriteDescriptorSet> blurWriteModelDescriptorSet =
-		{
-			// Binding 0
-			VkTools::Initializer::WriteDescriptorSet(blurDescriptorSet,VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, &ssaoImage),
-		};
-		vkUpdateDescriptorSets(m_pWRenderer->m_SwapChain.device, blurWriteModelDescriptorSet.size(), blurWriteModelDescriptorSet.data(), 0, NULL);
-	}
-
 
 	VkDescriptorSetAllocateInfo allocInfoMRT = VkTools::Initializer::DescriptorSetAllocateInfo(m_pWRenderer->m_DescriptorPool, &frameBufferDescriptorSetLayout, 1);
 	for (uint32_t i = 0; i < staticModel.m_Entries.size(); i++)
@@ -2137,7 +1737,7 @@ void Renderer::PrepareVertices(bool useStagingBuffers)
 		std::vector<VkWriteDescriptorSet> writeDescriptorSets =
 		{
 			//uniform descriptor
-			VkTools::Initializer::WriteDescriptorSet(listDescriptros[i],VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,	0,&uniformData.mesh.descriptor)
+			VkTools::Initializer::WriteDescriptorSet(listDescriptros[i],VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,	0,&meshDescriptor)
 		};
 
 		//We need this because descriptorset will take pointer to vkDescriptorImageInfo.
@@ -2159,90 +1759,24 @@ void Renderer::PrepareVertices(bool useStagingBuffers)
 		vkUpdateDescriptorSets(m_pWRenderer->m_SwapChain.device, writeDescriptorSets.size(), writeDescriptorSets.data(), 0, NULL);
 
 
-		//Create stagging buffer for vertices
-		VkBufferObject::CreateBuffer(
-			m_pWRenderer->m_SwapChain,
-			m_pWRenderer->m_DeviceMemoryProperties,
-			VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT,
-			static_cast<uint32_t>(sizeof(drawVert) * tr->numVerts),
-			listStagingBuffersVertices[i],
-			tr->verts);
-
-		//Create Local Copy for vertices
-		VkBufferObject::CreateBuffer(
-			m_pWRenderer->m_SwapChain,
-			m_pWRenderer->m_DeviceMemoryProperties,
-			VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-			static_cast<uint32_t>(sizeof(drawVert) * tr->numVerts),
-			listLocalBuffersVerts[i]);
-
-
-		//Create stagging buffer for faces
-		VkBufferObject::CreateBuffer(
-			m_pWRenderer->m_SwapChain,
-			m_pWRenderer->m_DeviceMemoryProperties,
-			VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT,
-			(sizeof(uint32_t) * tr->numIndexes),
-			listStagingBuffersIndexes[i],
-			tr->indexes);
-
-		//Create Local Copy for faces
-		VkBufferObject::CreateBuffer(
-			m_pWRenderer->m_SwapChain,
-			m_pWRenderer->m_DeviceMemoryProperties,
-			VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-			(sizeof(uint32_t) * tr->numIndexes),
-			listLocalBuffersIndexes[i]);
-
-
-		/*
-			SUBMITTING VERTICES
-		*/
-		{
-			//Create new command buffer
-			VkCommandBuffer copyCmd = GetCommandBuffer(true);
-
-			//Submit vertices to queue
-			VkBufferObject::SubmitBufferObjects(
-				copyCmd,
-				m_pWRenderer->m_Queue,
-				*m_pWRenderer,
-				static_cast<uint32_t>(sizeof(drawVert) * tr->numVerts),
-				listStagingBuffersVertices[i],
-				listLocalBuffersVerts[i], (drawVertFlags::Vertex | drawVertFlags::Normal | drawVertFlags::Uv | drawVertFlags::Tangent | drawVertFlags::Binormal));
-		}
-
-		/*
-			SUBMITTING INDEXES
-		*/
-		{
-			//Create new command buffer
-			VkCommandBuffer copyCmd = GetCommandBuffer(true);
-
-			VkBufferObject::SubmitBufferObjects(
-				copyCmd,
-				m_pWRenderer->m_Queue,
-				*m_pWRenderer,
-				(sizeof(uint32_t) * tr->numIndexes),
-				listStagingBuffersIndexes[i],
-				listLocalBuffersIndexes[i], drawVertFlags::None);
-		}
-
-		meshSize.push_back(tr->numIndexes);
 
 		numVerts += tr->numVerts;
 		numUvs += tr->numVerts;
 		numNormals += tr->numVerts;
 	}
+
+	//One vertex and one index buffer for the whole model
+	staticModel.CreateBuffers(m_pWRenderer->m_SwapChain, m_pWRenderer->m_DeviceMemoryProperties);
 }
 
 
 void Renderer::PreparePipeline()
 {
+	//Pipelines do not depend on each other, they are compiled together on worker threads
+	VulkanPipelineBuilder pipelineBuilder(m_pWRenderer->m_SwapChain.device, m_pWRenderer->m_PipelineCache);
+
+	//Render passes of the G-Buffer sets are identical, pipelines of the first set are compatible with both
+
 	VkPipelineInputAssemblyStateCreateInfo inputAssemblyState =
 		VkTools::Initializer::PipelineInputAssemblyStateCreateInfo(
 			VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST,
@@ -2326,7 +1860,7 @@ void Renderer::PreparePipeline()
 	pipelineCreateInfo.pDynamicState = &dynamicState;
 
 	// Create rendering pipeline
-	VK_CHECK_RESULT(vkCreateGraphicsPipelines(m_pWRenderer->m_SwapChain.device, m_pWRenderer->m_PipelineCache, 1, &pipelineCreateInfo, nullptr, &pipeline));
+	pipelineBuilder.Add(pipelineCreateInfo, &pipeline);
 
 	//Debug Quad Pipeline
 	{
@@ -2334,7 +1868,7 @@ void Renderer::PreparePipeline()
 		shaderStages[1] = LoadShader(GetAssetPath() + "Shaders/SSAO/DebugQuad.frag.spv", VK_SHADER_STAGE_FRAGMENT_BIT);
 		pipelineCreateInfo.layout = quadPipelineLayout;
 		pipelineCreateInfo.pVertexInputState = &quadMesh.vertex.inputState;
-		VK_CHECK_RESULT(vkCreateGraphicsPipelines(m_pWRenderer->m_SwapChain.device, m_pWRenderer->m_PipelineCache, 1, &pipelineCreateInfo, nullptr, &quadPipeline));
+		pipelineBuilder.Add(pipelineCreateInfo, &quadPipeline);
 	}
 
 
@@ -2348,33 +1882,49 @@ void Renderer::PreparePipeline()
 		pipelineCreateInfo.stageCount = static_cast<uint32_t>(debugNormalShaderStages.size());
 		pipelineCreateInfo.pStages = debugNormalShaderStages.data();
 		pipelineCreateInfo.layout = debugNormalsPipelineLayout;
-		pipelineCreateInfo.pVertexInputState = &listLocalBuffersVerts[0].inputState;
-		VK_CHECK_RESULT(vkCreateGraphicsPipelines(m_pWRenderer->m_SwapChain.device, m_pWRenderer->m_PipelineCache, 1, &pipelineCreateInfo, nullptr, &debugNormalsPipeline));
+		pipelineCreateInfo.pVertexInputState = &staticModel.vertexBuffer.inputState;
+		pipelineBuilder.Add(pipelineCreateInfo, &debugNormalsPipeline);
 	}
 
 	//Point back to old shaderstages
 	pipelineCreateInfo.stageCount = static_cast<uint32_t>(shaderStages.size());
 	pipelineCreateInfo.pStages = shaderStages.data();
 
+	//Compute SSAO and blur have no render pass, the builder only takes graphics pipelines
+	if (m_bComputeSSAO)
+	{
+		VkComputePipelineCreateInfo computePipelineCreateInfo = {};
+		computePipelineCreateInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+		computePipelineCreateInfo.stage = LoadShader(GetAssetPath() + "Shaders/SSAO/SSAO.comp.spv", VK_SHADER_STAGE_COMPUTE_BIT);
+		computePipelineCreateInfo.layout = ssaoPipelineLayout;
+		VK_CHECK_RESULT(vkCreateComputePipelines(m_pWRenderer->m_SwapChain.device, m_pWRenderer->m_PipelineCache, 1, &computePipelineCreateInfo, nullptr, &ssaoPipeline));
+
+		computePipelineCreateInfo.stage = LoadShader(GetAssetPath() + "Shaders/SSAO/Blur.comp.spv", VK_SHADER_STAGE_COMPUTE_BIT);
+		computePipelineCreateInfo.layout = blurPipelineLayout;
+		VK_CHECK_RESULT(vkCreateComputePipelines(m_pWRenderer->m_SwapChain.device, m_pWRenderer->m_PipelineCache, 1, &computePipelineCreateInfo, nullptr, &blurPipeline));
+	}
+
 	//Blur pipeline. Use same renderpass as SSAO
+	else
 	{
 		shaderStages[0] = LoadShader(GetAssetPath() + "Shaders/SSAO/Fullscreen.vert.spv", VK_SHADER_STAGE_VERTEX_BIT);
 		shaderStages[1] = LoadShader(GetAssetPath() + "Shaders/SSAO/Blur.frag.spv", VK_SHADER_STAGE_FRAGMENT_BIT);
 		pipelineCreateInfo.pVertexInputState = &emptyInputState;
-		pipelineCreateInfo.renderPass = frameBuffersSSAO.ssaoBlur.renderPass;
+		pipelineCreateInfo.renderPass = m_pRenderGraphs[0]->GetRenderPass(graphPasses.ssaoBlur);
 		pipelineCreateInfo.layout = blurPipelineLayout;
-		VK_CHECK_RESULT(vkCreateGraphicsPipelines(m_pWRenderer->m_SwapChain.device, m_pWRenderer->m_PipelineCache, 1, &pipelineCreateInfo, nullptr, &blurPipeline));
+		pipelineBuilder.Add(pipelineCreateInfo, &blurPipeline);
 	}
 
 	//SSAO Pipeline
 	//Seperate render pass for ssao
+	if (!m_bComputeSSAO)
 	{
 		shaderStages[0] = LoadShader(GetAssetPath() + "Shaders/SSAO/Fullscreen.vert.spv", VK_SHADER_STAGE_VERTEX_BIT);
 		shaderStages[1] = LoadShader(GetAssetPath() + "Shaders/SSAO/SSAO.frag.spv", VK_SHADER_STAGE_FRAGMENT_BIT);
 		pipelineCreateInfo.pVertexInputState = &emptyInputState;
 		pipelineCreateInfo.layout = ssaoPipelineLayout;
-		pipelineCreateInfo.renderPass = frameBuffersSSAO.ssao.renderPass;
-		VK_CHECK_RESULT(vkCreateGraphicsPipelines(m_pWRenderer->m_SwapChain.device, m_pWRenderer->m_PipelineCache, 1, &pipelineCreateInfo, nullptr, &ssaoPipeline));
+		pipelineCreateInfo.renderPass = m_pRenderGraphs[0]->GetRenderPass(graphPasses.ssao);
+		pipelineBuilder.Add(pipelineCreateInfo, &ssaoPipeline);
 	}
 
 
@@ -2382,7 +1932,7 @@ void Renderer::PreparePipeline()
 	{
 		shaderStages[0] = LoadShader(GetAssetPath() + "Shaders/SSAO/DefferedMRT.vert.spv", VK_SHADER_STAGE_VERTEX_BIT);
 		shaderStages[1] = LoadShader(GetAssetPath() + "Shaders/SSAO/DefferedMRT.frag.spv", VK_SHADER_STAGE_FRAGMENT_BIT);
-		pipelineCreateInfo.renderPass = offScreenFrameBuf.renderPass;
+		pipelineCreateInfo.renderPass = m_pRenderGraphs[0]->GetRenderPass(graphPasses.gbuffer);
 		pipelineCreateInfo.layout = frameBufferPipelineLayout;
 
 		// Blend attachment states required for all color attachments
@@ -2397,9 +1947,11 @@ void Renderer::PreparePipeline()
 		};
 		colorBlendState.attachmentCount = static_cast<uint32_t>(blendAttachmentStates.size());
 		colorBlendState.pAttachments = blendAttachmentStates.data();
-		pipelineCreateInfo.pVertexInputState = &listLocalBuffersVerts[0].inputState;
-		VK_CHECK_RESULT(vkCreateGraphicsPipelines(m_pWRenderer->m_SwapChain.device, m_pWRenderer->m_PipelineCache, 1, &pipelineCreateInfo, nullptr, &frameBufferPipeline));
+		pipelineCreateInfo.pVertexInputState = &staticModel.vertexBuffer.inputState;
+		pipelineBuilder.Add(pipelineCreateInfo, &frameBufferPipeline);
 	}
+
+	BuildPipelines(pipelineBuilder);
 }
 
 
@@ -2433,8 +1985,8 @@ void Renderer::SetupDescriptorSetLayout()
 			//Binding 5
 			VkTools::Initializer::DescriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,VK_SHADER_STAGE_FRAGMENT_BIT,5),
 
-			// Binding 6 : Fragment shader uniform buffer
-			VkTools::Initializer::DescriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,VK_SHADER_STAGE_FRAGMENT_BIT,6),
+			// Binding 6 : Fragment shader uniform buffer, lights move to a new offset every frame
+			VkTools::Initializer::DescriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,VK_SHADER_STAGE_FRAGMENT_BIT,6),
 
 			// Binding 7 : Fragment shader uniform buffer
 			VkTools::Initializer::DescriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,VK_SHADER_STAGE_FRAGMENT_BIT,7)
@@ -2452,8 +2004,8 @@ void Renderer::SetupDescriptorSetLayout()
 	{
 		std::vector<VkDescriptorSetLayoutBinding> setLayoutBindings =
 		{
-			// Binding 0 : Vertex shader uniform buffer
-			VkTools::Initializer::DescriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,VK_SHADER_STAGE_VERTEX_BIT,0),
+			// Binding 0 : Vertex shader uniform buffer, new offset every frame
+			VkTools::Initializer::DescriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,VK_SHADER_STAGE_VERTEX_BIT,0),
 
 			// Binding 1 : Fragment shader image sampler
 			VkTools::Initializer::DescriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,VK_SHADER_STAGE_FRAGMENT_BIT,1),
@@ -2506,8 +2058,8 @@ void Renderer::SetupDescriptorSetLayout()
 	{
 		std::vector<VkDescriptorSetLayoutBinding> setLayoutBindings =
 		{
-			// Binding 0 : Fragment shader image sampler
-			VkTools::Initializer::DescriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_GEOMETRY_BIT,0),
+			// Binding 0 : Geometry shader uniform buffer, same as the G-Buffer one
+			VkTools::Initializer::DescriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, VK_SHADER_STAGE_GEOMETRY_BIT,0),
 		};
 
 		VkDescriptorSetLayoutCreateInfo descriptorLayout = VkTools::Initializer::DescriptorSetLayoutCreateInfo(setLayoutBindings.data(), setLayoutBindings.size());
@@ -2517,25 +2069,32 @@ void Renderer::SetupDescriptorSetLayout()
 		VK_CHECK_RESULT(vkCreatePipelineLayout(m_pWRenderer->m_SwapChain.device, &pPipelineLayoutCreateInfo, nullptr, &debugNormalsPipelineLayout));
 	}
 
+	//SSAO and blur compute shaders use the same bindings, output is a storage image at binding 0
+	const VkShaderStageFlags ssaoStage = m_bComputeSSAO ? VK_SHADER_STAGE_COMPUTE_BIT : VK_SHADER_STAGE_FRAGMENT_BIT;
+
 	//SSAO
 	{
 		std::vector<VkDescriptorSetLayoutBinding> setLayoutBindings =
 		{
 			// Binding 1 : Fragment shader image sampler
-			VkTools::Initializer::DescriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,VK_SHADER_STAGE_FRAGMENT_BIT,1),
+			VkTools::Initializer::DescriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,ssaoStage,1),
 
 			// Binding 2 : Fragment shader image sampler
-			VkTools::Initializer::DescriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,VK_SHADER_STAGE_FRAGMENT_BIT,2),
+			VkTools::Initializer::DescriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,ssaoStage,2),
 
 			//Binding 3 : Fragment shader uniform buffer
-			VkTools::Initializer::DescriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,VK_SHADER_STAGE_FRAGMENT_BIT,3),
+			VkTools::Initializer::DescriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,ssaoStage,3),
 
 			// Binding 4 : Fragment Uniform Kernel
-			VkTools::Initializer::DescriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,VK_SHADER_STAGE_FRAGMENT_BIT, 4),
+			VkTools::Initializer::DescriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,ssaoStage, 4),
 
 			// Binding 5 : Fragment Uniform Projection
-			VkTools::Initializer::DescriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,VK_SHADER_STAGE_FRAGMENT_BIT, 5),
+			VkTools::Initializer::DescriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,ssaoStage, 5),
 		};
+		if (m_bComputeSSAO)
+		{
+			setLayoutBindings.push_back(VkTools::Initializer::DescriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, ssaoStage, 0));
+		}
 
 		VkDescriptorSetLayoutCreateInfo descriptorLayout = VkTools::Initializer::DescriptorSetLayoutCreateInfo(setLayoutBindings.data(), setLayoutBindings.size());
 		VK_CHECK_RESULT(vkCreateDescriptorSetLayout(m_pWRenderer->m_SwapChain.device, &descriptorLayout, nullptr, &ssaoDescriptorSetLayout));
@@ -2549,8 +2108,12 @@ void Renderer::SetupDescriptorSetLayout()
 		std::vector<VkDescriptorSetLayoutBinding> setLayoutBindings =
 		{
 			// Binding 1 : Fragment shader image sampler
-			VkTools::Initializer::DescriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,VK_SHADER_STAGE_FRAGMENT_BIT,1),
+			VkTools::Initializer::DescriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,ssaoStage,1),
 		};
+		if (m_bComputeSSAO)
+		{
+			setLayoutBindings.push_back(VkTools::Initializer::DescriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, ssaoStage, 0));
+		}
 		VkDescriptorSetLayoutCreateInfo descriptorLayout = VkTools::Initializer::DescriptorSetLayoutCreateInfo(setLayoutBindings.data(), setLayoutBindings.size());
 		VK_CHECK_RESULT(vkCreateDescriptorSetLayout(m_pWRenderer->m_SwapChain.device, &descriptorLayout, nullptr, &blurDescriptorSetLayout));
 
@@ -2565,10 +2128,13 @@ void Renderer::SetupDescriptorPool()
 	std::vector<VkDescriptorPoolSize> poolSizes =
 	{
 		VkTools::Initializer::DescriptorPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 100),
-		VkTools::Initializer::DescriptorPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 100)
+		VkTools::Initializer::DescriptorPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 100),
+		VkTools::Initializer::DescriptorPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 100),
+		VkTools::Initializer::DescriptorPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 2 * GBUFF_SETS)
 	};
 
-	VkDescriptorPoolCreateInfo descriptorPoolInfo = VkTools::Initializer::DescriptorPoolCreateInfo(poolSizes.size(), poolSizes.data(), 35);
+	//Composite, debug quad, SSAO and blur sets are per G-Buffer set
+	VkDescriptorPoolCreateInfo descriptorPoolInfo = VkTools::Initializer::DescriptorPoolCreateInfo(poolSizes.size(), poolSizes.data(), 35 + 4 * (GBUFF_SETS - 1));
 	VK_CHECK_RESULT(vkCreateDescriptorPool(m_pWRenderer->m_SwapChain.device, &descriptorPoolInfo, nullptr, &m_pWRenderer->m_DescriptorPool));
 }
 
@@ -2580,98 +2146,160 @@ void Renderer::SetupDescriptorSet()
 
 void Renderer::StartFrame()
 {
+	TYW_PROFILE_FUNCTION();
+	const uint32_t set = m_CurrentSet;
+
+	// Get next image in the swap chain (back/front buffer).
+	// Waits only if a frame still in flight rendered to the same image
+	VK_CHECK_RESULT(frameManager->AcquireImage(m_pWRenderer->m_SwapChain, &m_pWRenderer->m_currentBuffer));
+
+	//Mesh matrices of this frame, the G-Buffer and normal debug read them
+	meshHandle = vertexCache.AllocUniform(&m_uboVS, sizeof(m_uboVS));
 
+	VkPipelineStageFlags submitPipelineStages = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+	VkPipelineStageFlags stageFlags = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+	VkCommandBufferBeginInfo cmdBufInfo = VkTools::Initializer::CommandBufferBeginInfo();
+
+	//G-Buffer of this frame. Without compute SSAO the SSAO passes follow in the same command buffer
+	VkCommandBuffer gbufferCmd = frameManager->GetCommandBuffer();
+	VK_CHECK_RESULT(vkBeginCommandBuffer(gbufferCmd, &cmdBufInfo));
+	RecordFramebufferCommands(gbufferCmd, set);
+	if (!m_bComputeSSAO)
 	{
-		// Get next image in the swap chain (back/front buffer)
-		VK_CHECK_RESULT(m_pWRenderer->m_SwapChain.GetNextImage(Semaphores.presentComplete, &m_pWRenderer->m_currentBuffer));
+		memcpy(uniformData.ssaoprojection[set].mapped, &uboSSAOProjection, sizeof(uboSSAOProjection));
+		RecordSSAOCommands(gbufferCmd, set);
+		RecordSSAOBlurCommands(gbufferCmd, set);
+	}
+	VK_CHECK_RESULT(vkEndCommandBuffer(gbufferCmd));
 
-		// Submit the post present image barrier to transform the image back to a color attachment
-		// that can be used to write to by our render pass
+	{
+		//Start Deffered Pass. Does not touch the swap chain image, so it does not wait for it
+		VkCommandBuffer gbufferCmds[] = { frameManager->BeginFrameTimer(), gbufferCmd };
 		VkSubmitInfo submitInfo = VkTools::Initializer::SubmitInfo();
-		submitInfo.commandBufferCount = 1;
-		submitInfo.pCommandBuffers = &m_pWRenderer->m_PostPresentCmdBuffers[m_pWRenderer->m_currentBuffer];
-
+		submitInfo.commandBufferCount = 2;
+		submitInfo.pCommandBuffers = gbufferCmds;
+		submitInfo.signalSemaphoreCount = m_bComputeSSAO ? 1 : 0;
+		submitInfo.pSignalSemaphores = &Semaphores.defferedSemaphore[set];
 		VK_CHECK_RESULT(vkQueueSubmit(m_pWRenderer->m_Queue, 1, &submitInfo, VK_NULL_HANDLE));
+	}
 
-		// Make sure that the image barrier command submitted to the queue 
-		// has finished executing
-		VK_CHECK_RESULT(vkQueueWaitIdle(m_pWRenderer->m_Queue));
+	//Compute SSAO is composited one frame later. Graphics queue renders the G-Buffer of this frame and
+	//the composite of the last one while the compute queue runs SSAO of this frame, nothing waits for it this frame
+	uint32_t compositeSet = set;
+	if (m_bComputeSSAO)
+	{
+		//Command buffer and projection uniforms of the set are free once its last compute submit has finished
+		VK_CHECK_RESULT(vkWaitForFences(m_pWRenderer->m_SwapChain.device, 1, &m_ComputeFences[set], VK_TRUE, UINT64_MAX));
+		VK_CHECK_RESULT(vkResetFences(m_pWRenderer->m_SwapChain.device, 1, &m_ComputeFences[set]));
+		memcpy(uniformData.ssaoprojection[set].mapped, &uboSSAOProjection, sizeof(uboSSAOProjection));
+
+		VkCommandBuffer computeCmd = m_ComputeCmdBuffers[set];
+		VK_CHECK_RESULT(vkBeginCommandBuffer(computeCmd, &cmdBufInfo));
+		RecordSSAOCommands(computeCmd, set);
+		RecordSSAOBlurCommands(computeCmd, set);
+		VK_CHECK_RESULT(vkEndCommandBuffer(computeCmd));
+
+		//SSAO and blur in one submit on the compute queue, after the G-Buffer of the set
+		VkPipelineStageFlags computeWaitStages = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+		VkSubmitInfo computeSubmitInfo = VkTools::Initializer::SubmitInfo();
+		computeSubmitInfo.waitSemaphoreCount = 1;
+		computeSubmitInfo.pWaitSemaphores = &Semaphores.defferedSemaphore[set];
+		computeSubmitInfo.pWaitDstStageMask = &computeWaitStages;
+		computeSubmitInfo.commandBufferCount = 1;
+		computeSubmitInfo.pCommandBuffers = &computeCmd;
+		computeSubmitInfo.signalSemaphoreCount = 1;
+		computeSubmitInfo.pSignalSemaphores = &Semaphores.blurSemaphore[set];
+		VK_CHECK_RESULT(vkQueueSubmit(m_pWRenderer->m_ComputeQueue, 1, &computeSubmitInfo, m_ComputeFences[set]));
+
+		//Very first frame has no finished set yet and only clears
+		compositeSet = m_CompositeSet;
+		m_CompositeSet = set;
 	}
 
+	//Lights were written to a new uniform offset this frame.
+	//Per image command buffer is free again, its last frame has finished
+	BuildMainRendererCommandBuffer(m_pWRenderer->m_currentBuffer, compositeSet);
 
+	VkCommandBuffer guiCmd = frameManager->GetCommandBuffer();
+	ImGui_ImplGlfwVulkan_Render(guiCmd, m_pWRenderer->m_currentBuffer);
 
 	{
-		//Submit model
-		VkPipelineStageFlags submitPipelineStages = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
-		VkPipelineStageFlags stageFlags = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
 		VkSubmitInfo submitInfo = VkTools::Initializer::SubmitInfo();
 
-		//Base info
-		submitInfo.pWaitDstStageMask = &submitPipelineStages;
-		submitInfo.commandBufferCount = 1;
+		//Start Main Pass (Combines all images and does calculation for all lights)
+		//Post present barrier transforms the image back to a color attachment once it is acquired.
+		//Acquire barriers of the compute results start at the fragment shader stage the submit waits at
+		VkSemaphore mainWaitSemaphores[] = { frameManager->ImageAcquiredSemaphore(), VK_NULL_HANDLE };
+		VkPipelineStageFlags mainWaitStages[] = { VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT };
 		submitInfo.waitSemaphoreCount = 1;
+		if (m_bComputeSSAO && compositeSet != GBUFF_NO_SET)
+		{
+			mainWaitSemaphores[1] = Semaphores.blurSemaphore[compositeSet];
+			submitInfo.waitSemaphoreCount = 2;
+		}
+		VkCommandBuffer mainCmds[] = { m_pWRenderer->m_PostPresentCmdBuffers[m_pWRenderer->m_currentBuffer], m_pWRenderer->m_DrawCmdBuffers[m_pWRenderer->m_currentBuffer] };
+		submitInfo.pWaitSemaphores = mainWaitSemaphores;
+		submitInfo.pWaitDstStageMask = mainWaitStages;
+		submitInfo.commandBufferCount = 2;
+		submitInfo.pCommandBuffers = mainCmds;
 		submitInfo.signalSemaphoreCount = 1;
-
-		//Start Deffered Pass
-		submitInfo.pCommandBuffers = &GBufferScreenCmdBuffer;
-		submitInfo.pWaitSemaphores = &Semaphores.presentComplete;
-		submitInfo.pSignalSemaphores = &Semaphores.defferedSemaphore;
-		VK_CHECK_RESULT(vkQueueSubmit(m_pWRenderer->m_Queue, 1, &submitInfo, VK_NULL_HANDLE));
-
-		
-		//Start SSAO Pass
-		submitInfo.pWaitSemaphores = &Semaphores.defferedSemaphore;
-		submitInfo.pSignalSemaphores = &Semaphores.ssaoSemaphore;
-		submitInfo.pCommandBuffers = &ssaoCmdBuffer;
-		VK_CHECK_RESULT(vkQueueSubmit(m_pWRenderer->m_Queue, 1, &submitInfo, VK_NULL_HANDLE));
-
-		//Start Blur pass
-		submitInfo.pWaitSemaphores = &Semaphores.ssaoSemaphore;
-		submitInfo.pSignalSemaphores = &Semaphores.blurSemaphore;
-		submitInfo.pCommandBuffers = &blurCmdBuffer;
-		VK_CHECK_RESULT(vkQueueSubmit(m_pWRenderer->m_Queue, 1, &submitInfo, VK_NULL_HANDLE));
-
-
-		//Start Main Pass (Combines all images and does calculation for all lights)
-		submitInfo.pWaitSemaphores = &Semaphores.blurSemaphore;
 		submitInfo.pSignalSemaphores = &Semaphores.renderComplete;
-		submitInfo.pCommandBuffers = &m_pWRenderer->m_DrawCmdBuffers[m_pWRenderer->m_currentBuffer];
 		VK_CHECK_RESULT(vkQueueSubmit(m_pWRenderer->m_Queue, 1, &submitInfo, VK_NULL_HANDLE));
 
 
-		//Wait for color output before rendering text
-		//submitInfo.pWaitDstStageMask = &stageFlags;
-
-		//ImGUI Render
-		ImGui_ImplGlfwVulkan_Render(cmdGui, m_pWRenderer->m_currentBuffer);
+		//ImGUI Render. Wait for color output before rendering text
+		submitInfo.waitSemaphoreCount = 1;
 		submitInfo.pWaitSemaphores = &Semaphores.renderComplete;
+		submitInfo.pWaitDstStageMask = &stageFlags;
+		submitInfo.commandBufferCount = 1;
+		submitInfo.pCommandBuffers = &guiCmd;
 		submitInfo.pSignalSemaphores = &Semaphores.textOverlayComplete;
-		submitInfo.pCommandBuffers = &cmdGui;
 		VK_CHECK_RESULT(vkQueueSubmit(m_pWRenderer->m_Queue, 1, &submitInfo, VK_NULL_HANDLE));
-		
-	}
 
-	{
+
 		// Submit pre present image barrier to transform the image from color attachment to present(khr) for presenting to the swap chain
-		VkSubmitInfo submitInfo = VkTools::Initializer::SubmitInfo();
-		submitInfo.commandBufferCount = 1;
+		VkSemaphore renderComplete = frameManager->RenderCompleteSemaphore();
+		submitInfo.pWaitSemaphores = &Semaphores.textOverlayComplete;
+		submitInfo.pWaitDstStageMask = &submitPipelineStages;
 		submitInfo.pCommandBuffers = &m_pWRenderer->m_PrePresentCmdBuffers[m_pWRenderer->m_currentBuffer];
+		submitInfo.pSignalSemaphores = &renderComplete;
 		VK_CHECK_RESULT(vkQueueSubmit(m_pWRenderer->m_Queue, 1, &submitInfo, VK_NULL_HANDLE));
 
-
-		// Present the current buffer to the swap chain
-		// We pass the signal semaphore from the submit info
-		// to ensure that the image is not rendered until
-		// all commands have been submitted
-		VK_CHECK_RESULT(m_pWRenderer->m_SwapChain.QueuePresent(m_pWRenderer->m_Queue, m_pWRenderer->m_currentBuffer, Semaphores.textOverlayComplete));
+		// Present the current buffer to the swap chain once the whole frame has been rendered.
+		// EndFrame fences the frame, there is no wait for the queue here
+		VK_CHECK_RESULT(m_pWRenderer->m_SwapChain.QueuePresent(m_pWRenderer->m_Queue, m_pWRenderer->m_currentBuffer, renderComplete));
 	}
+
+	//Next frame renders to the other set
+	m_CurrentSet = (set + 1) % GBUFF_SETS;
 }
 
 
 
 void Renderer::LoadAssets()
 {
-	
+	//Compute SSAO needs its SPIR-V (generate-spirv.bat), TYW_SSAO_COMPUTE=0 keeps the fragment passes to compare against
+	const char* pComputeSSAO = getenv("TYW_SSAO_COMPUTE");
+	m_bComputeSSAO = !(pComputeSSAO && strcmp(pComputeSSAO, "0") == 0) &&
+		m_pShaderRegistry->Load(GetAssetPath() + "Shaders/SSAO/SSAO.comp.spv") != VK_NULL_HANDLE &&
+		m_pShaderRegistry->Load(GetAssetPath() + "Shaders/SSAO/Blur.comp.spv") != VK_NULL_HANDLE;
+	if (!m_bComputeSSAO)
+	{
+		return;
+	}
+
+	const uint32_t computeFamily = m_pWRenderer->m_computeQueueIndex;
+	VkCommandPoolCreateInfo cmdPoolInfo = {};
+	cmdPoolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	cmdPoolInfo.queueFamilyIndex = computeFamily;
+	cmdPoolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+	VK_CHECK_RESULT(vkCreateCommandPool(m_pWRenderer->m_SwapChain.device, &cmdPoolInfo, nullptr, &m_ComputeCmdPool));
+
+	//Own trace row and overlap time for the compute queue, without one both share the graphics queue
+	if (computeFamily != m_pWRenderer->m_graphicsQueueIndex)
+	{
+		m_ComputeProfilerQueue = m_pGpuProfiler->AddQueue("Compute", m_pWRenderer->m_QueueFamilyProperties[computeFamily].timestampValidBits);
+	}
 }
 
 
@@ -2680,17 +2308,32 @@ Renderer g_Renderer;
 
 int main()
 {
+#if defined(_WIN32)
 	g_bPrepared = g_Renderer.VInitRenderer(720, 1280, false, HandleWindowMessages);
+#else
+	//No window on other platforms, needs TYW_HEADLESS=<frames>. Size is what WM_SIZE reports on Windows
+	g_iDesktopWidth = 1280;
+	g_iDesktopHeight = 720;
+	g_bPrepared = g_Renderer.VInitRenderer(g_iDesktopHeight, g_iDesktopWidth, false, nullptr);
+#endif
+	if (!g_bPrepared)
+	{
+		return 1;
+	}
 	ImGui_ImplGlfwVulkan_MouseOnWinodws(true); //for now will work. Should test against windows rect
 
-#if defined(_WIN32)
 	MSG msg;
-#endif
 
 	while (TRUE)
 	{
 		if (!GenerateEvents(msg))break;
 
+		//Fixed time step and recorded camera path while benchmarking
+		if (g_Renderer.UpdateBenchmark(&g_Renderer.m_Camera))
+		{
+			g_Renderer.m_bViewUpdated = true;
+		}
+
 		auto tStart = std::chrono::high_resolution_clock::now();
 		ImGui_ImplGlfwVulkan_NewFrame(g_Renderer.frameTimer);
 		g_Renderer.ImguiRender();
@@ -2733,6 +2376,7 @@ int main()
 }
 
 
+#if defined(_WIN32)
 LRESULT CALLBACK HandleWindowMessages(HWND hWnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
 {
 	switch (uMsg)
@@ -2868,10 +2512,24 @@ LRESULT CALLBACK HandleWindowMessages(HWND hWnd, UINT uMsg, WPARAM wParam, LPARA
 	}
 	return DefWindowProc(hWnd, uMsg, wParam, lParam);
 }
+#endif
 
 
 bool GenerateEvents(MSG& msg)
 {
+	//Benchmark ends with its camera path, the report is written by then
+	if (g_Renderer.IsBenchmarkFinished())
+	{
+		return false;
+	}
+
+	//No window to pump messages for, the run ends after its frame count
+	if (g_Renderer.IsHeadless())
+	{
+		return !g_Renderer.IsHeadlessFinished();
+	}
+
+#if defined(_WIN32)
 	if (PeekMessage(&msg, NULL, 0, 0, PM_REMOVE))
 	{
 		if (msg.message == WM_QUIT)
@@ -2885,9 +2543,13 @@ bool GenerateEvents(MSG& msg)
 		}
 	}
 	return true;
+#else
+	return false;
+#endif
 }
 
 
+#if defined(_WIN32)
 void WIN_Sizing(WORD side, RECT *rect)
 {
 	// restrict to a standard aspect ratio
@@ -2902,4 +2564,5 @@ void WIN_Sizing(WORD side, RECT *rect)
 
 	g_iDesktopWidth -= decoWidth;
 	g_iDesktopHeight -= decoHeight;
-}
\ No newline at end of file
+}
+#endif
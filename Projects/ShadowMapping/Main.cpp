@@ -4,37 +4,42 @@
 *	This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
 */
 
-#include <RendererPch\stdafx.h>
+#include <RendererPch/stdafx.h>
 #include <iomanip>
 
 //Triangle Includes
 #include "Main.h"
+#if defined(_WIN32)
 #include <conio.h>
+#endif
 
 //Renderer Includes
-#include <Renderer\VKRenderer.h>
-#include <Renderer\Vulkan\VulkanTools.h>
-#include <Renderer\Vulkan\VulkanTextureLoader.h>
+#include <Renderer/VKRenderer.h>
+#include <Renderer/VertexCache.h>
+#include <Renderer/Vulkan/VulkanTools.h>
+#include <Renderer/Vulkan/VulkanTextureLoader.h>
 
 //Model Loader Includes
-#include <Renderer\MeshLoader\Model_local.h>
-#include <Renderer\MeshLoader\ImageManager.h>
-#include <Renderer\MeshLoader\Material.h>
+#include <Renderer/MeshLoader/Model_local.h>
+#include <Renderer/MeshLoader/ImageManager.h>
+#include <Renderer/MeshLoader/Material.h>
 
 //Vulkan Includes
-#include <Renderer\Vulkan\VkBufferObject.h>
-#include <Renderer\Vulkan\VulkanSwapChain.h>
+#include <Renderer/Vulkan/VkBufferObject.h>
+#include <Renderer/Vulkan/VulkanSwapChain.h>
+#include <Renderer/Vulkan/VulkanGpuProfiler.h>
+#include <Renderer/Vulkan/VulkanFrameManager.h>
 
 
 //Font Rendering
-#include <Renderer\ThirdParty\FreeType\VkFont.h>
+#include <Renderer/ThirdParty/FreeType/VkFont.h>
 
 
 //math
-#include <External\glm\glm\gtc\matrix_inverse.hpp>
+#include <External/glm/glm/gtc/matrix_inverse.hpp>
 
 //Camera
-#include <Renderer\Camera.h>
+#include <Renderer/Camera.h>
 
 
 //Global variables
@@ -149,8 +154,10 @@ VkClearColorValue g_DefaultClearColor = { { 0.5f, 0.5f, 0.5f, 1.0f } };
 //====================================================================================
 
 bool GenerateEvents(MSG& msg);
+#if defined(_WIN32)
 void WIN_Sizing(WORD side, RECT *rect);
 LRESULT CALLBACK HandleWindowMessages(HWND hWnd, UINT uMsg, WPARAM wParam, LPARAM lParam);
+#endif
 
 //====================================================================================
 
@@ -200,11 +207,10 @@ private:
 	// Synchronization semaphores
 	// Semaphores are used to synchronize dependencies between command buffers
 	// We use them to ensure that we e.g. don't present to the swap chain
-	// until all rendering has completed
+	// until all rendering has completed.
+	// Swap chain acquire and present semaphores belong to frameManager, one pair per frame in flight
 	struct
 	{
-		// Swap chain image presentation
-		VkSemaphore presentComplete;
 		// Command buffer submission and execution
 		VkSemaphore renderComplete;
 		// Text overlay submission and execution
@@ -257,22 +263,22 @@ private:
 	} planeUniformData;
 
 
+	//Uniform blocks copied to the vertex cache for the frame that is being recorded,
+	//selected with a dynamic offset on binding 0
 	struct {
-		VkTools::UniformData offscreenModel;
-		VkTools::UniformData offscreenPlane;
-		VkTools::UniformData quad;
-		VkTools::UniformData plane;
-		VkTools::UniformData model;
-	}  uniformData;
+		vertCacheHandle_t offscreenModel;
+		vertCacheHandle_t offscreenPlane;
+		vertCacheHandle_t quad;
+		vertCacheHandle_t plane;
+		vertCacheHandle_t model;
+	}  uniformHandles;
 
 
 	uint32_t numVerts = 0;
 	uint32_t numUvs = 0;
 	uint32_t numNormals = 0;
 
-	std::vector<VkBufferObject_s>	listLocalBuffers;
 	std::vector<VkDescriptorSet>	listDescriptros;
-	std::vector<uint32_t>			meshSize;
 
 	VkBufferObject_s				quadVbo;
 	VkBufferObject_s				quadIndexVbo;
@@ -299,12 +305,13 @@ public:
 	void ChangeLodBias(float delta);
 	void BeginTextUpdate();
 
-	void BuildMainCommandBuffer();
+	void BuildMainCommandBuffers();
+	void BuildMainCommandBuffer(uint32_t i);
 
 	//Offscreen renderpass for depth pass
 	void PrepareOffscreenRenderPass();
 	void PrepareOffscreenFrameBuffer();
-	void BuildOffscreenCommandBuffer();
+	void RecordOffscreenCommands(VkCommandBuffer cmdBuffer);
 	void UpdateOffscreenUniformBuffers();
 	void UpdateLight();
 	void GenerateQuad();
@@ -314,6 +321,7 @@ public:
 	{
 		VkImage image;
 		VkDeviceMemory mem;
+		VulkanAllocation allocation;
 		VkImageView view;
 	};
 
@@ -331,7 +339,6 @@ public:
 	VkDescriptorSet offscreenDescriptorSet;
 	VkDescriptorSet offscreenPlaneDescriptorSet;
 
-	VkCommandBuffer offScreenCmdBuffer = VK_NULL_HANDLE;
 	// Semaphore used to synchronize offscreen rendering before using it's texture target for sampling
 	VkSemaphore offscreenSemaphore = VK_NULL_HANDLE;
 
@@ -380,17 +387,6 @@ Renderer::~Renderer()
 	//Destroy mesh data
 	VkBufferObject::FreeMeshBufferResources(m_pWRenderer->m_SwapChain.device, quadVbo);
 	VkBufferObject::FreeMeshBufferResources(m_pWRenderer->m_SwapChain.device, quadIndexVbo);
-	for (auto& rs : listLocalBuffers)
-	{
-		VkBufferObject::FreeMeshBufferResources(m_pWRenderer->m_SwapChain.device, rs);
-	}
-
-	// Uniform buffers
-	VkTools::DestroyUniformData(m_pWRenderer->m_SwapChain.device, uniformData.offscreenModel);
-	VkTools::DestroyUniformData(m_pWRenderer->m_SwapChain.device, uniformData.offscreenPlane);
-	VkTools::DestroyUniformData(m_pWRenderer->m_SwapChain.device, uniformData.quad);
-	VkTools::DestroyUniformData(m_pWRenderer->m_SwapChain.device, uniformData.plane);
-	VkTools::DestroyUniformData(m_pWRenderer->m_SwapChain.device, uniformData.model);
 
 	//Delete model
 	staticModel.Clear(m_pWRenderer->m_SwapChain.device);
@@ -402,12 +398,12 @@ Renderer::~Renderer()
 	// Color attachment
 	vkDestroyImageView(m_pWRenderer->m_SwapChain.device, offScreenFrameBuf.color.view, nullptr);
 	vkDestroyImage(m_pWRenderer->m_SwapChain.device, offScreenFrameBuf.color.image, nullptr);
-	vkFreeMemory(m_pWRenderer->m_SwapChain.device, offScreenFrameBuf.color.mem, nullptr);
+	memoryAllocator->Free(offScreenFrameBuf.color.allocation);
 
 	// Depth attachment
 	vkDestroyImageView(m_pWRenderer->m_SwapChain.device, offScreenFrameBuf.depth.view, nullptr);
 	vkDestroyImage(m_pWRenderer->m_SwapChain.device, offScreenFrameBuf.depth.image, nullptr);
-	vkFreeMemory(m_pWRenderer->m_SwapChain.device, offScreenFrameBuf.depth.mem, nullptr);
+	memoryAllocator->Free(offScreenFrameBuf.depth.allocation);
 
 	vkDestroyFramebuffer(m_pWRenderer->m_SwapChain.device, offScreenFrameBuf.frameBuffer, nullptr);
 	vkDestroyRenderPass(m_pWRenderer->m_SwapChain.device, offScreenFrameBuf.renderPass, nullptr);
@@ -421,7 +417,6 @@ Renderer::~Renderer()
 	
 
 	//Destroy Semaphores
-	vkFreeCommandBuffers(m_pWRenderer->m_SwapChain.device, m_pWRenderer->m_CmdPool, 1, &offScreenCmdBuffer);
 	vkDestroySemaphore(m_pWRenderer->m_SwapChain.device, offscreenSemaphore, nullptr);
 
 
@@ -432,14 +427,8 @@ Renderer::~Renderer()
 
 
 
-	//Destroy Shader Module
-	for (int i = 0; i < m_ShaderModules.size(); i++)
-	{
-		vkDestroyShaderModule(m_pWRenderer->m_SwapChain.device, m_ShaderModules[i], nullptr);
-	}
 
 	//Release semaphores
-	vkDestroySemaphore(m_pWRenderer->m_SwapChain.device, Semaphores.presentComplete, nullptr);
 	vkDestroySemaphore(m_pWRenderer->m_SwapChain.device, Semaphores.renderComplete, nullptr);
 	vkDestroySemaphore(m_pWRenderer->m_SwapChain.device, Semaphores.textOverlayComplete, nullptr);
 
@@ -456,10 +445,6 @@ void Renderer::PrepareSemaphore()
 	semaphoreCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
 	semaphoreCreateInfo.pNext = NULL;
 
-	// This semaphore ensures that the image is complete
-	// before starting to submit again
-	VK_CHECK_RESULT(vkCreateSemaphore(m_pWRenderer->m_SwapChain.device, &semaphoreCreateInfo, nullptr, &Semaphores.presentComplete));
-
 	// This semaphore ensures that all commands submitted
 	// have been finished before submitting the image to the queue
 	VK_CHECK_RESULT(vkCreateSemaphore(m_pWRenderer->m_SwapChain.device, &semaphoreCreateInfo, nullptr, &Semaphores.renderComplete));
@@ -468,6 +453,9 @@ void Renderer::PrepareSemaphore()
 	// This semaphore ensures that all commands submitted
 	// have been finished before submitting the image to the queue
 	VK_CHECK_RESULT(vkCreateSemaphore(m_pWRenderer->m_SwapChain.device, &semaphoreCreateInfo, nullptr, &Semaphores.textOverlayComplete));
+
+	// Synchronizes offscreen rendering and usage of the shadow map
+	VK_CHECK_RESULT(vkCreateSemaphore(m_pWRenderer->m_SwapChain.device, &semaphoreCreateInfo, nullptr, &offscreenSemaphore));
 }
 
 
@@ -481,11 +469,7 @@ void Renderer::UpdateQuadUniformData()
 	modelMatrix = glm::translate(modelMatrix, glm::vec3(1, 1, 0));
 	quadUniformData.mvp = perspective  * modelMatrix;
 
-	// Map uniform buffer and update it
-	uint8_t *pData;
-	VK_CHECK_RESULT(vkMapMemory(m_pWRenderer->m_SwapChain.device, uniformData.quad.memory, 0, sizeof(quadUniformData), 0, (void **)&pData));
-	memcpy(pData, &quadUniformData, sizeof(quadUniformData));
-	vkUnmapMemory(m_pWRenderer->m_SwapChain.device, uniformData.quad.memory);
+	uniformHandles.quad = vertexCache.AllocUniform(&quadUniformData, sizeof(quadUniformData));
 }
 
 
@@ -551,25 +535,14 @@ void Renderer::GenerateQuad()
 		quadIndexVbo);
 
 
-	//Create new command buffer
-	VkCommandBuffer copyCmd = GetCommandBuffer(true);
-
-
 	//Submit info to the queue
 	VkBufferObject::SubmitBufferObjects(
-		copyCmd,
-		m_pWRenderer->m_Queue,
-		*m_pWRenderer,
 		static_cast<uint32_t>(sizeof(drawVert) * vertData.size()),
 		staggingBufferVbo,
 		quadVbo, (drawVertFlags::Vertex | drawVertFlags::Uv | drawVertFlags::Normal));
 
 
-	copyCmd = GetCommandBuffer(true);
 	VkBufferObject::SubmitBufferObjects(
-		copyCmd,
-		m_pWRenderer->m_Queue,
-		*m_pWRenderer,
 		static_cast<uint32_t>(sizeof(uint32_t) * indexBuffer.size()),
 		staggingIndexBufferVbo,
 		quadIndexVbo, drawVertFlags::None);
@@ -680,9 +653,6 @@ void Renderer::PrepareOffscreenFrameBuffer()
 	// Image of the framebuffer is blit source
 	image.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
 
-	VkMemoryAllocateInfo memAlloc = VkTools::Initializer::MemoryAllocateInfo();
-	VkMemoryRequirements memReqs;
-
 	VkImageViewCreateInfo colorImageView = VkTools::Initializer::ImageViewCreateInfo();
 	colorImageView.viewType = VK_IMAGE_VIEW_TYPE_2D;
 	colorImageView.format = fbColorFormat;
@@ -694,11 +664,8 @@ void Renderer::PrepareOffscreenFrameBuffer()
 	colorImageView.subresourceRange.layerCount = 1;
 	VK_CHECK_RESULT(vkCreateImage(m_pWRenderer->m_SwapChain.device, &image, nullptr, &offScreenFrameBuf.color.image));
 
-	vkGetImageMemoryRequirements(m_pWRenderer->m_SwapChain.device, offScreenFrameBuf.color.image, &memReqs);
-	memAlloc.allocationSize = memReqs.size;
-	memAlloc.memoryTypeIndex = VkTools::GetMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_pWRenderer->m_DeviceMemoryProperties);
-	VK_CHECK_RESULT(vkAllocateMemory(m_pWRenderer->m_SwapChain.device, &memAlloc, nullptr, &offScreenFrameBuf.color.mem));
-	VK_CHECK_RESULT(vkBindImageMemory(m_pWRenderer->m_SwapChain.device, offScreenFrameBuf.color.image, offScreenFrameBuf.color.mem, 0));
+	VK_CHECK_RESULT(memoryAllocator->AllocateImage(offScreenFrameBuf.color.image, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, VK_IMAGE_TILING_OPTIMAL, true, offScreenFrameBuf.color.allocation));
+	offScreenFrameBuf.color.mem = VK_NULL_HANDLE;
 
 
 	//Create command buffer
@@ -742,11 +709,8 @@ void Renderer::PrepareOffscreenFrameBuffer()
 	depthStencilView.subresourceRange.layerCount = 1;
 	VK_CHECK_RESULT(vkCreateImage(m_pWRenderer->m_SwapChain.device, &image, nullptr, &offScreenFrameBuf.depth.image));
 
-	vkGetImageMemoryRequirements(m_pWRenderer->m_SwapChain.device, offScreenFrameBuf.depth.image, &memReqs);
-	memAlloc.allocationSize = memReqs.size;
-	memAlloc.memoryTypeIndex = VkTools::GetMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_pWRenderer->m_DeviceMemoryProperties);
-	VK_CHECK_RESULT(vkAllocateMemory(m_pWRenderer->m_SwapChain.device, &memAlloc, nullptr, &offScreenFrameBuf.depth.mem));
-	VK_CHECK_RESULT(vkBindImageMemory(m_pWRenderer->m_SwapChain.device, offScreenFrameBuf.depth.image, offScreenFrameBuf.depth.mem, 0));
+	VK_CHECK_RESULT(memoryAllocator->AllocateImage(offScreenFrameBuf.depth.image, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, VK_IMAGE_TILING_OPTIMAL, true, offScreenFrameBuf.depth.allocation));
+	offScreenFrameBuf.depth.mem = VK_NULL_HANDLE;
 
 	// Set the initial layout to shader read instead of attachment 
 	// This is done as the render loop does the actualy image layout transitions
@@ -809,23 +773,8 @@ void Renderer::PrepareOffscreenFrameBuffer()
 	VK_CHECK_RESULT(vkCreateFramebuffer(m_pWRenderer->m_SwapChain.device, &fbufCreateInfo, nullptr, &offScreenFrameBuf.frameBuffer));
 }
 
-void Renderer::BuildOffscreenCommandBuffer()
+void Renderer::RecordOffscreenCommands(VkCommandBuffer cmdBuffer)
 {
-	if (offScreenCmdBuffer == VK_NULL_HANDLE)
-	{
-		VkCommandBufferAllocateInfo cmdBufAllocateInfo =
-			VkTools::Initializer::CommandBufferAllocateInfo(
-				m_pWRenderer->m_CmdPool,
-				VK_COMMAND_BUFFER_LEVEL_PRIMARY,
-				1);
-
-		VK_CHECK_RESULT(vkAllocateCommandBuffers(m_pWRenderer->m_SwapChain.device, &cmdBufAllocateInfo, &offScreenCmdBuffer));
-	}
-
-	// Create a semaphore used to synchronize offscreen rendering and usage
-	VkSemaphoreCreateInfo semaphoreCreateInfo = VkTools::Initializer::SemaphoreCreateInfo();
-	VK_CHECK_RESULT(vkCreateSemaphore(m_pWRenderer->m_SwapChain.device, &semaphoreCreateInfo, nullptr, &offscreenSemaphore));
-
 	VkCommandBufferBeginInfo cmdBufInfo = VkTools::Initializer::CommandBufferBeginInfo();
 
 	VkClearValue clearValues[2];
@@ -842,75 +791,88 @@ void Renderer::BuildOffscreenCommandBuffer()
 	renderPassBeginInfo.clearValueCount = 2;
 	renderPassBeginInfo.pClearValues = clearValues;
 
-	VK_CHECK_RESULT(vkBeginCommandBuffer(offScreenCmdBuffer, &cmdBufInfo));
-
-	// Change back layout of the depth attachment after sampling in the fragment shader
-	VkTools::SetImageLayout(
-		offScreenCmdBuffer,
-		offScreenFrameBuf.depth.image,
-		VK_IMAGE_ASPECT_DEPTH_BIT,
-		VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-		VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL);
+	VK_CHECK_RESULT(vkBeginCommandBuffer(cmdBuffer, &cmdBufInfo));
+
+	// Change back layout of the depth attachment after sampling in the fragment shader.
+	// The previous frame may still be sampling it, depth is written once its fragment shaders are done
+	VkImageMemoryBarrier shadowMapBarrier = VkTools::Initializer::ImageMemoryBarrier();
+	shadowMapBarrier.srcAccessMask = VK_ACCESS_SHADER_READ_BIT;
+	shadowMapBarrier.dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+	shadowMapBarrier.oldLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	shadowMapBarrier.newLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+	shadowMapBarrier.image = offScreenFrameBuf.depth.image;
+	shadowMapBarrier.subresourceRange = { VK_IMAGE_ASPECT_DEPTH_BIT, 0, 1, 0, 1 };
+	vkCmdPipelineBarrier(
+		cmdBuffer,
+		VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+		VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+		0,
+		0, nullptr,
+		0, nullptr,
+		1, &shadowMapBarrier);
 
 	VkViewport viewport = VkTools::Initializer::Viewport((float)offScreenFrameBuf.width, (float)offScreenFrameBuf.height, 0.0f, 1.0f);
-	vkCmdSetViewport(offScreenCmdBuffer, 0, 1, &viewport);
+	vkCmdSetViewport(cmdBuffer, 0, 1, &viewport);
 
 	VkRect2D scissor = VkTools::Initializer::Rect2D(offScreenFrameBuf.width, offScreenFrameBuf.height, 0, 0);
-	vkCmdSetScissor(offScreenCmdBuffer, 0, 1, &scissor);
+	vkCmdSetScissor(cmdBuffer, 0, 1, &scissor);
 
 	// Set depth bias (aka "Polygon offset")
 	// Required to avoid shadow mapping artefacts
 	vkCmdSetDepthBias(
-		offScreenCmdBuffer,
+		cmdBuffer,
 		depthBiasConstant,
 		0.0f,
 		depthBiasSlope);
 
-	vkCmdBeginRenderPass(offScreenCmdBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
+	m_pGpuProfiler->BeginScope(cmdBuffer, "Shadow Map");
+	vkCmdBeginRenderPass(cmdBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
 
-	vkCmdBindPipeline(offScreenCmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, offscreenPipeline);
-	vkCmdBindDescriptorSets(offScreenCmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, offscreenPipelineLayout, 0, 1, &offscreenDescriptorSet, 0, NULL);
+	vkCmdBindPipeline(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, offscreenPipeline);
+	const uint32_t offscreenModelOffset = static_cast<uint32_t>(uniformHandles.offscreenModel.offset);
+	vkCmdBindDescriptorSets(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, offscreenPipelineLayout, 0, 1, &offscreenDescriptorSet, 1, &offscreenModelOffset);
 
 	// Bind triangle vertex buffer (contains position and colors)
 	VkDeviceSize offsets[1] = { 0 };
 
 
-	for (int j = 0; j < listLocalBuffers.size(); j++)
+	// All surfaces share one vertex and index buffer
+	staticModel.BindBuffers(cmdBuffer, VERTEX_BUFFER_BIND_ID);
+	for (int j = 0; j < staticModel.surfaces.size(); j++)
 	{
 		// Bind descriptor sets describing shader binding points
-		//vkCmdBindDescriptorSets(offScreenCmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &listDescriptros[j], 0, NULL);
-
-		//Bind Buffer
-		vkCmdBindVertexBuffers(offScreenCmdBuffer, VERTEX_BUFFER_BIND_ID, 1, &listLocalBuffers[j].buffer, offsets);
+		//vkCmdBindDescriptorSets(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &listDescriptros[j], 0, NULL);
 
 		//Draw
-		vkCmdDraw(offScreenCmdBuffer, meshSize[j], 3, 0, 0);
+		vkCmdDrawIndexed(cmdBuffer, staticModel.surfaces[j].indexCount, 3, staticModel.surfaces[j].firstIndex, staticModel.surfaces[j].vertexOffset, 0);
 	}
 
 
 	//Render Plane
 	{
-		//vkCmdBindPipeline(offScreenCmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, planePipeline);
-		vkCmdBindDescriptorSets(offScreenCmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, quadPipelineLayout, 0, 1, &offscreenPlaneDescriptorSet, 0, NULL);
-		vkCmdBindVertexBuffers(offScreenCmdBuffer, VERTEX_BUFFER_BIND_ID, 1, &quadVbo.buffer, offsets);
-		vkCmdBindIndexBuffer(offScreenCmdBuffer, quadIndexVbo.buffer, 0, VK_INDEX_TYPE_UINT32);
-		vkCmdDrawIndexed(offScreenCmdBuffer, 6, 1, 0, 0, 0);
+		//vkCmdBindPipeline(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, planePipeline);
+		const uint32_t offscreenPlaneOffset = static_cast<uint32_t>(uniformHandles.offscreenPlane.offset);
+		vkCmdBindDescriptorSets(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, quadPipelineLayout, 0, 1, &offscreenPlaneDescriptorSet, 1, &offscreenPlaneOffset);
+		vkCmdBindVertexBuffers(cmdBuffer, VERTEX_BUFFER_BIND_ID, 1, &quadVbo.buffer, offsets);
+		vkCmdBindIndexBuffer(cmdBuffer, quadIndexVbo.buffer, 0, VK_INDEX_TYPE_UINT32);
+		vkCmdDrawIndexed(cmdBuffer, 6, 1, 0, 0, 0);
 	}
 
 
 
 
-	vkCmdEndRenderPass(offScreenCmdBuffer);
+	vkCmdEndRenderPass(cmdBuffer);
+	m_pGpuProfiler->EndScope(cmdBuffer);
 
 	// Change layout of the depth attachment for sampling in the fragment shader
 	VkTools::SetImageLayout(
-		offScreenCmdBuffer,
+		cmdBuffer,
 		offScreenFrameBuf.depth.image,
 		VK_IMAGE_ASPECT_DEPTH_BIT,
 		VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
 		VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
 
-	VK_CHECK_RESULT(vkEndCommandBuffer(offScreenCmdBuffer));
+	VK_CHECK_RESULT(vkEndCommandBuffer(cmdBuffer));
 }
 
 void Renderer::UpdateOffscreenUniformBuffers()
@@ -925,23 +887,13 @@ void Renderer::UpdateOffscreenUniformBuffers()
 
 	modelUniformData.depthBiasMVP = projectionViewMatrix;
 	planeUniformData.shadowCoord = projectionViewMatrix;
-	{
-		//mesh offscreen data
-		uint8_t *pData;
-		VK_CHECK_RESULT(vkMapMemory(m_pWRenderer->m_SwapChain.device, uniformData.offscreenModel.memory, 0, sizeof(meshOffscreenUniformData), 0, (void **)&pData));
-		memcpy(pData, &meshOffscreenUniformData, sizeof(meshOffscreenUniformData));
-		vkUnmapMemory(m_pWRenderer->m_SwapChain.device, uniformData.offscreenModel.memory);
-	}
+	//mesh offscreen data
+	uniformHandles.offscreenModel = vertexCache.AllocUniform(&meshOffscreenUniformData, sizeof(meshOffscreenUniformData));
 
 
 	meshOffscreenUniformData.depthMVP = projectionViewMatrix * planeUniformData.modelMatrix;
-	{
-		//Plane offscreen data
-		uint8_t *pData;
-		VK_CHECK_RESULT(vkMapMemory(m_pWRenderer->m_SwapChain.device, uniformData.offscreenPlane.memory, 0, sizeof(meshOffscreenUniformData), 0, (void **)&pData));
-		memcpy(pData, &meshOffscreenUniformData, sizeof(meshOffscreenUniformData));
-		vkUnmapMemory(m_pWRenderer->m_SwapChain.device, uniformData.offscreenPlane.memory);
-	}
+	//Plane offscreen data
+	uniformHandles.offscreenPlane = vertexCache.AllocUniform(&meshOffscreenUniformData, sizeof(meshOffscreenUniformData));
 }
 
 
@@ -953,6 +905,9 @@ void Renderer::ChangeLodBias(float delta)
 
 void Renderer::BeginTextUpdate()
 {
+	//Text rewrites its vertex buffer and records every per image command buffer again,
+	//none of them may be in use by a frame in flight
+	frameManager->WaitIdle();
 	m_VkFont->BeginTextUpdate();
 
 	std::stringstream ss;
@@ -965,14 +920,26 @@ void Renderer::BeginTextUpdate()
 
 void Renderer::BuildCommandBuffers()
 {
-	//Build Offscreen Command Buffers
-	BuildOffscreenCommandBuffer();
-	BuildMainCommandBuffer();
+	//Shadow map commands are recorded every frame into frame manager command buffers
+	BuildMainCommandBuffers();
 }
 
 
-void Renderer::BuildMainCommandBuffer()
+void Renderer::BuildMainCommandBuffers()
 {
+	for (uint32_t i = 0; i < m_pWRenderer->m_DrawCmdBuffers.size(); ++i)
+	{
+		BuildMainCommandBuffer(i);
+	}
+}
+
+//Records swap chain image i. Redone every frame, the uniform blocks move to new offsets each frame
+void Renderer::BuildMainCommandBuffer(uint32_t i)
+{
+	const uint32_t quadOffset = static_cast<uint32_t>(uniformHandles.quad.offset);
+	const uint32_t planeOffset = static_cast<uint32_t>(uniformHandles.plane.offset);
+	const uint32_t modelOffset = static_cast<uint32_t>(uniformHandles.model.offset);
+
 	VkCommandBufferBeginInfo cmdBufInfo = {};
 	cmdBufInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
 	cmdBufInfo.pNext = NULL;
@@ -995,73 +962,69 @@ void Renderer::BuildMainCommandBuffer()
 	renderPassBeginInfo.clearValueCount = 2;
 	renderPassBeginInfo.pClearValues = clearValues;
 
-	for (int32_t i = 0; i < m_pWRenderer->m_DrawCmdBuffers.size(); ++i)
-	{
+	// Set target frame buffer
+	renderPassBeginInfo.framebuffer = m_pWRenderer->m_FrameBuffers[i];
 
-		// Set target frame buffer
-		renderPassBeginInfo.framebuffer = m_pWRenderer->m_FrameBuffers[i];
+	VK_CHECK_RESULT(vkBeginCommandBuffer(m_pWRenderer->m_DrawCmdBuffers[i], &cmdBufInfo));
 
-		VK_CHECK_RESULT(vkBeginCommandBuffer(m_pWRenderer->m_DrawCmdBuffers[i], &cmdBufInfo));
+	// Start the first sub pass specified in our default render pass setup by the base class
+	// This will clear the color and depth attachment
+	m_pGpuProfiler->BeginScope(m_pWRenderer->m_DrawCmdBuffers[i], "Scene");
+	vkCmdBeginRenderPass(m_pWRenderer->m_DrawCmdBuffers[i], &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
 
-		// Start the first sub pass specified in our default render pass setup by the base class
-		// This will clear the color and depth attachment
-		vkCmdBeginRenderPass(m_pWRenderer->m_DrawCmdBuffers[i], &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
+	// Update dynamic viewport state
+	VkViewport viewport = {};
+	viewport.height = (float)g_iDesktopHeight;
+	viewport.width = (float)g_iDesktopWidth;
+	viewport.minDepth = 0.0f;
+	viewport.maxDepth = 1.0f;
+	vkCmdSetViewport(m_pWRenderer->m_DrawCmdBuffers[i], 0, 1, &viewport);
 
-		// Update dynamic viewport state
-		VkViewport viewport = {};
-		viewport.height = (float)g_iDesktopHeight;
-		viewport.width = (float)g_iDesktopWidth;
-		viewport.minDepth = 0.0f;
-		viewport.maxDepth = 1.0f;
-		vkCmdSetViewport(m_pWRenderer->m_DrawCmdBuffers[i], 0, 1, &viewport);
-
-		// Update dynamic scissor state
-		VkRect2D scissor = {};
-		scissor.extent.width = g_iDesktopWidth;
-		scissor.extent.height = g_iDesktopHeight;
-		scissor.offset.x = 0;
-		scissor.offset.y = 0;
-		vkCmdSetScissor(m_pWRenderer->m_DrawCmdBuffers[i], 0, 1, &scissor);
-
-		VkDeviceSize offsets[1] = { 0 };
-
-		//shadow map display
-		{
-			vkCmdBindPipeline(m_pWRenderer->m_DrawCmdBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, quadPipeline);
-			vkCmdBindDescriptorSets(m_pWRenderer->m_DrawCmdBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, quadPipelineLayout, 0, 1, &quadDescriptorSet, 0, NULL);
-			vkCmdBindVertexBuffers(m_pWRenderer->m_DrawCmdBuffers[i], VERTEX_BUFFER_BIND_ID, 1, &quadVbo.buffer, offsets);
-			vkCmdBindIndexBuffer(m_pWRenderer->m_DrawCmdBuffers[i], quadIndexVbo.buffer, 0, VK_INDEX_TYPE_UINT32);
-			vkCmdDrawIndexed(m_pWRenderer->m_DrawCmdBuffers[i], 6, 1, 0, 0, 0);
-		}
+	// Update dynamic scissor state
+	VkRect2D scissor = {};
+	scissor.extent.width = g_iDesktopWidth;
+	scissor.extent.height = g_iDesktopHeight;
+	scissor.offset.x = 0;
+	scissor.offset.y = 0;
+	vkCmdSetScissor(m_pWRenderer->m_DrawCmdBuffers[i], 0, 1, &scissor);
 
-		//Test
-		{
-			vkCmdBindPipeline(m_pWRenderer->m_DrawCmdBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, planePipeline);
-			vkCmdBindDescriptorSets(m_pWRenderer->m_DrawCmdBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, quadPipelineLayout, 0, 1, &planeDescriptorSet, 0, NULL);
-			vkCmdBindVertexBuffers(m_pWRenderer->m_DrawCmdBuffers[i], VERTEX_BUFFER_BIND_ID, 1, &quadVbo.buffer, offsets);
-			vkCmdBindIndexBuffer(m_pWRenderer->m_DrawCmdBuffers[i], quadIndexVbo.buffer, 0, VK_INDEX_TYPE_UINT32);
-			vkCmdDrawIndexed(m_pWRenderer->m_DrawCmdBuffers[i], 6, 1, 0, 0, 0);
-		}
+	VkDeviceSize offsets[1] = { 0 };
 
-		//3D SCENE
-		vkCmdBindPipeline(m_pWRenderer->m_DrawCmdBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
-		for (int j = 0; j < listLocalBuffers.size(); j++)
-		{
-			// Bind descriptor sets describing shader binding points
-			vkCmdBindDescriptorSets(m_pWRenderer->m_DrawCmdBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &listDescriptros[j], 0, NULL);
+	//shadow map display
+	{
+		vkCmdBindPipeline(m_pWRenderer->m_DrawCmdBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, quadPipeline);
+		vkCmdBindDescriptorSets(m_pWRenderer->m_DrawCmdBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, quadPipelineLayout, 0, 1, &quadDescriptorSet, 1, &quadOffset);
+		vkCmdBindVertexBuffers(m_pWRenderer->m_DrawCmdBuffers[i], VERTEX_BUFFER_BIND_ID, 1, &quadVbo.buffer, offsets);
+		vkCmdBindIndexBuffer(m_pWRenderer->m_DrawCmdBuffers[i], quadIndexVbo.buffer, 0, VK_INDEX_TYPE_UINT32);
+		vkCmdDrawIndexed(m_pWRenderer->m_DrawCmdBuffers[i], 6, 1, 0, 0, 0);
+	}
 
-			//Bind Buffer
-			vkCmdBindVertexBuffers(m_pWRenderer->m_DrawCmdBuffers[i], VERTEX_BUFFER_BIND_ID, 1, &listLocalBuffers[j].buffer, offsets);
+	//Test
+	{
+		vkCmdBindPipeline(m_pWRenderer->m_DrawCmdBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, planePipeline);
+		vkCmdBindDescriptorSets(m_pWRenderer->m_DrawCmdBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, quadPipelineLayout, 0, 1, &planeDescriptorSet, 1, &planeOffset);
+		vkCmdBindVertexBuffers(m_pWRenderer->m_DrawCmdBuffers[i], VERTEX_BUFFER_BIND_ID, 1, &quadVbo.buffer, offsets);
+		vkCmdBindIndexBuffer(m_pWRenderer->m_DrawCmdBuffers[i], quadIndexVbo.buffer, 0, VK_INDEX_TYPE_UINT32);
+		vkCmdDrawIndexed(m_pWRenderer->m_DrawCmdBuffers[i], 6, 1, 0, 0, 0);
+	}
 
-			//Draw
-			vkCmdDraw(m_pWRenderer->m_DrawCmdBuffers[i], meshSize[j], 3, 0, 0);
-		}
+	//3D SCENE
+	vkCmdBindPipeline(m_pWRenderer->m_DrawCmdBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+	// All surfaces share one vertex and index buffer
+	staticModel.BindBuffers(m_pWRenderer->m_DrawCmdBuffers[i], VERTEX_BUFFER_BIND_ID);
+	for (int j = 0; j < staticModel.surfaces.size(); j++)
+	{
+		// Bind descriptor sets describing shader binding points
+		vkCmdBindDescriptorSets(m_pWRenderer->m_DrawCmdBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &listDescriptros[j], 1, &modelOffset);
 
+		//Draw
+		vkCmdDrawIndexed(m_pWRenderer->m_DrawCmdBuffers[i], staticModel.surfaces[j].indexCount, 3, staticModel.surfaces[j].firstIndex, staticModel.surfaces[j].vertexOffset, 0);
+	}
 
-		vkCmdEndRenderPass(m_pWRenderer->m_DrawCmdBuffers[i]);
-		VK_CHECK_RESULT(vkEndCommandBuffer(m_pWRenderer->m_DrawCmdBuffers[i]));
 
-	}
+	vkCmdEndRenderPass(m_pWRenderer->m_DrawCmdBuffers[i]);
+	m_pGpuProfiler->EndScope(m_pWRenderer->m_DrawCmdBuffers[i]);
+	VK_CHECK_RESULT(vkEndCommandBuffer(m_pWRenderer->m_DrawCmdBuffers[i]));
 }
 
 void Renderer::UpdateUniformBuffers()
@@ -1081,235 +1044,19 @@ void Renderer::UpdateUniformBuffers()
 	modelUniformData.modelMatrix = glm::translate(glm::mat4(), glm::vec3(0.0f, 0.0f, 0.0f));
 	modelUniformData.modelMatrix = glm::scale(modelUniformData.modelMatrix, glm::vec3(0.2, 0.2, 0.2));
 	modelUniformData.normal = glm::inverseTranspose(modelUniformData.modelMatrix);
-	{
-		// Map uniform buffer and update it
-		uint8_t *pData;
-		VK_CHECK_RESULT(vkMapMemory(m_pWRenderer->m_SwapChain.device, uniformData.model.memory, 0, sizeof(modelUniformData), 0, (void **)&pData));
-		memcpy(pData, &modelUniformData, sizeof(modelUniformData));
-		vkUnmapMemory(m_pWRenderer->m_SwapChain.device, uniformData.model.memory);
-	}
+	uniformHandles.model = vertexCache.AllocUniform(&modelUniformData, sizeof(modelUniformData));
 
 
 	//Plane uniform data
 	planeUniformData.modelMatrix = glm::scale(glm::mat4(1.0f), glm::vec3(50.0f, 50.0f, 50.0f));
 	planeUniformData.modelMatrix = rotatePlane * glm::translate(planeUniformData.modelMatrix, glm::vec3(0.0f, 0.0f, -0.05f));
 	planeUniformData.mvp = modelUniformData.projectionMatrix * modelUniformData.viewMatrix * planeUniformData.modelMatrix;
-	{
-		// Map uniform buffer and update it
-		uint8_t *pData;
-		VK_CHECK_RESULT(vkMapMemory(m_pWRenderer->m_SwapChain.device, uniformData.plane.memory, 0, sizeof(planeUniformData), 0, (void **)&pData));
-		memcpy(pData, &planeUniformData, sizeof(planeUniformData));
-		vkUnmapMemory(m_pWRenderer->m_SwapChain.device, uniformData.plane.memory);
-	}
+	uniformHandles.plane = vertexCache.AllocUniform(&planeUniformData, sizeof(planeUniformData));
 }
 
 void Renderer::PrepareUniformBuffers()
 {
-
-	//Create model uniform buffers
-	{
-		VkMemoryRequirements memReqs;
-
-		// Vertex shader uniform buffer block
-		VkBufferCreateInfo bufferInfo = {};
-		VkMemoryAllocateInfo allocInfo = {};
-		allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-		allocInfo.pNext = NULL;
-		allocInfo.allocationSize = 0;
-		allocInfo.memoryTypeIndex = 0;
-
-		bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-		bufferInfo.size = sizeof(modelUniformData);
-		bufferInfo.usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT;
-
-		// Create a new buffer
-		VK_CHECK_RESULT(vkCreateBuffer(m_pWRenderer->m_SwapChain.device, &bufferInfo, nullptr, &uniformData.model.buffer));
-		// Get memory requirements including size, alignment and memory type 
-		vkGetBufferMemoryRequirements(m_pWRenderer->m_SwapChain.device, uniformData.model.buffer, &memReqs);
-		allocInfo.allocationSize = memReqs.size;
-		// Get the memory type index that supports host visibile memory access
-		// Most implementations offer multiple memory tpyes and selecting the 
-		// correct one to allocate memory from is important
-		// We also want the buffer to be host coherent so we don't have to flush 
-		// after every update. 
-		// Note that this may affect performance so you might not want to do this 
-		// in a real world application that updates buffers on a regular base
-		allocInfo.memoryTypeIndex = VkTools::GetMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, m_pWRenderer->m_DeviceMemoryProperties);
-		// Allocate memory for the uniform buffer
-		VK_CHECK_RESULT(vkAllocateMemory(m_pWRenderer->m_SwapChain.device, &allocInfo, nullptr, &(uniformData.model.memory)));
-		// Bind memory to buffer
-		VK_CHECK_RESULT(vkBindBufferMemory(m_pWRenderer->m_SwapChain.device, uniformData.model.buffer, uniformData.model.memory, 0));
-
-		// Store information in the uniform's descriptor
-		uniformData.model.descriptor.buffer = uniformData.model.buffer;
-		uniformData.model.descriptor.offset = 0;
-		uniformData.model.descriptor.range = sizeof(modelUniformData);
-	}
-
-
-	//Prepare Offscreen buffers
-	//Create model uniform buffers
-	{
-		VkMemoryRequirements memReqs;
-
-		// Vertex shader uniform buffer block
-		VkBufferCreateInfo bufferInfo = {};
-		VkMemoryAllocateInfo allocInfo = {};
-		allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-		allocInfo.pNext = NULL;
-		allocInfo.allocationSize = 0;
-		allocInfo.memoryTypeIndex = 0;
-
-		bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-		bufferInfo.size = sizeof(meshOffscreenUniformData);
-		bufferInfo.usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT;
-
-		// Create a new buffer
-		VK_CHECK_RESULT(vkCreateBuffer(m_pWRenderer->m_SwapChain.device, &bufferInfo, nullptr, &uniformData.offscreenModel.buffer));
-		// Get memory requirements including size, alignment and memory type 
-		vkGetBufferMemoryRequirements(m_pWRenderer->m_SwapChain.device, uniformData.offscreenModel.buffer, &memReqs);
-		allocInfo.allocationSize = memReqs.size;
-		// Get the memory type index that supports host visibile memory access
-		// Most implementations offer multiple memory tpyes and selecting the 
-		// correct one to allocate memory from is important
-		// We also want the buffer to be host coherent so we don't have to flush 
-		// after every update. 
-		// Note that this may affect performance so you might not want to do this 
-		// in a real world application that updates buffers on a regular base
-		allocInfo.memoryTypeIndex = VkTools::GetMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, m_pWRenderer->m_DeviceMemoryProperties);
-		// Allocate memory for the uniform buffer
-		VK_CHECK_RESULT(vkAllocateMemory(m_pWRenderer->m_SwapChain.device, &allocInfo, nullptr, &(uniformData.offscreenModel.memory)));
-		// Bind memory to buffer
-		VK_CHECK_RESULT(vkBindBufferMemory(m_pWRenderer->m_SwapChain.device, uniformData.offscreenModel.buffer, uniformData.offscreenModel.memory, 0));
-
-		// Store information in the uniform's descriptor
-		uniformData.offscreenModel.descriptor.buffer = uniformData.offscreenModel.buffer;
-		uniformData.offscreenModel.descriptor.offset = 0;
-		uniformData.offscreenModel.descriptor.range = sizeof(meshOffscreenUniformData);
-	}
-
-
-	//prepare quad
-	{
-		VkMemoryRequirements memReqs;
-
-		// Vertex shader uniform buffer block
-		VkBufferCreateInfo bufferInfo = {};
-		VkMemoryAllocateInfo allocInfo = {};
-		allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-		allocInfo.pNext = NULL;
-		allocInfo.allocationSize = 0;
-		allocInfo.memoryTypeIndex = 0;
-
-		bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-		bufferInfo.size = sizeof(quadUniformData);
-		bufferInfo.usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT;
-
-		// Create a new buffer
-		VK_CHECK_RESULT(vkCreateBuffer(m_pWRenderer->m_SwapChain.device, &bufferInfo, nullptr, &uniformData.quad.buffer));
-		// Get memory requirements including size, alignment and memory type 
-		vkGetBufferMemoryRequirements(m_pWRenderer->m_SwapChain.device, uniformData.quad.buffer, &memReqs);
-		allocInfo.allocationSize = memReqs.size;
-		// Get the memory type index that supports host visibile memory access
-		// Most implementations offer multiple memory tpyes and selecting the 
-		// correct one to allocate memory from is important
-		// We also want the buffer to be host coherent so we don't have to flush 
-		// after every update. 
-		// Note that this may affect performance so you might not want to do this 
-		// in a real world application that updates buffers on a regular base
-		allocInfo.memoryTypeIndex = VkTools::GetMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, m_pWRenderer->m_DeviceMemoryProperties);
-		// Allocate memory for the uniform buffer
-		VK_CHECK_RESULT(vkAllocateMemory(m_pWRenderer->m_SwapChain.device, &allocInfo, nullptr, &(uniformData.quad.memory)));
-		// Bind memory to buffer
-		VK_CHECK_RESULT(vkBindBufferMemory(m_pWRenderer->m_SwapChain.device, uniformData.quad.buffer, uniformData.quad.memory, 0));
-
-		// Store information in the uniform's descriptor
-		uniformData.quad.descriptor.buffer = uniformData.quad.buffer;
-		uniformData.quad.descriptor.offset = 0;
-		uniformData.quad.descriptor.range = sizeof(quadUniformData);
-	}
-
-
-	//prepare test quad
-	{
-		VkMemoryRequirements memReqs;
-
-		// Vertex shader uniform buffer block
-		VkBufferCreateInfo bufferInfo = {};
-		VkMemoryAllocateInfo allocInfo = {};
-		allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-		allocInfo.pNext = NULL;
-		allocInfo.allocationSize = 0;
-		allocInfo.memoryTypeIndex = 0;
-
-		bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-		bufferInfo.size = sizeof(planeUniformData);
-		bufferInfo.usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT;
-
-		// Create a new buffer
-		VK_CHECK_RESULT(vkCreateBuffer(m_pWRenderer->m_SwapChain.device, &bufferInfo, nullptr, &uniformData.plane.buffer));
-		// Get memory requirements including size, alignment and memory type 
-		vkGetBufferMemoryRequirements(m_pWRenderer->m_SwapChain.device, uniformData.plane.buffer, &memReqs);
-		allocInfo.allocationSize = memReqs.size;
-		// Get the memory type index that supports host visibile memory access
-		// Most implementations offer multiple memory tpyes and selecting the 
-		// correct one to allocate memory from is important
-		// We also want the buffer to be host coherent so we don't have to flush 
-		// after every update. 
-		// Note that this may affect performance so you might not want to do this 
-		// in a real world application that updates buffers on a regular base
-		allocInfo.memoryTypeIndex = VkTools::GetMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, m_pWRenderer->m_DeviceMemoryProperties);
-		// Allocate memory for the uniform buffer
-		VK_CHECK_RESULT(vkAllocateMemory(m_pWRenderer->m_SwapChain.device, &allocInfo, nullptr, &(uniformData.plane.memory)));
-		// Bind memory to buffer
-		VK_CHECK_RESULT(vkBindBufferMemory(m_pWRenderer->m_SwapChain.device, uniformData.plane.buffer, uniformData.plane.memory, 0));
-
-		// Store information in the uniform's descriptor
-		uniformData.plane.descriptor.buffer = uniformData.plane.buffer;
-		uniformData.plane.descriptor.offset = 0;
-		uniformData.plane.descriptor.range = sizeof(planeUniformData);
-	}
-
-
-	//offscreen plane
-	{
-		VkMemoryRequirements memReqs;
-
-		// Vertex shader uniform buffer block
-		VkBufferCreateInfo bufferInfo = {};
-		VkMemoryAllocateInfo allocInfo = {};
-		allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-		allocInfo.pNext = NULL;
-		allocInfo.allocationSize = 0;
-		allocInfo.memoryTypeIndex = 0;
-
-		bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-		bufferInfo.size = sizeof(meshOffscreenUniformData);
-		bufferInfo.usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT;
-
-		// Create a new buffer
-		VK_CHECK_RESULT(vkCreateBuffer(m_pWRenderer->m_SwapChain.device, &bufferInfo, nullptr, &uniformData.offscreenPlane.buffer));
-		// Get memory requirements including size, alignment and memory type 
-		vkGetBufferMemoryRequirements(m_pWRenderer->m_SwapChain.device, uniformData.offscreenPlane.buffer, &memReqs);
-		allocInfo.allocationSize = memReqs.size;
-		// Get the memory type index that supports host visibile memory access
-		// Most implementations offer multiple memory tpyes and selecting the 
-		// correct one to allocate memory from is important
-		// We also want the buffer to be host coherent so we don't have to flush 
-		// after every update. 
-		// Note that this may affect performance so you might not want to do this 
-		// in a real world application that updates buffers on a regular base
-		allocInfo.memoryTypeIndex = VkTools::GetMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, m_pWRenderer->m_DeviceMemoryProperties);
-		// Allocate memory for the uniform buffer
-		VK_CHECK_RESULT(vkAllocateMemory(m_pWRenderer->m_SwapChain.device, &allocInfo, nullptr, &(uniformData.offscreenPlane.memory)));
-		// Bind memory to buffer
-		VK_CHECK_RESULT(vkBindBufferMemory(m_pWRenderer->m_SwapChain.device, uniformData.offscreenPlane.buffer, uniformData.offscreenPlane.memory, 0));
-
-		// Store information in the uniform's descriptor
-		uniformData.offscreenPlane.descriptor.buffer = uniformData.offscreenPlane.buffer;
-		uniformData.offscreenPlane.descriptor.offset = 0;
-		uniformData.offscreenPlane.descriptor.range = sizeof(meshOffscreenUniformData);
-	}
+	//Uniform blocks live in vertex cache uniform memory, every update copies them to a new offset
 	UpdateLight();
 	UpdateUniformBuffers();
 	UpdateOffscreenUniformBuffers();
@@ -1337,6 +1084,12 @@ void Renderer::PrepareVertices(bool useStagingBuffers)
 			&descriptorSetLayout,
 			1);
 
+	// Uniform blocks, offsets are given when binding
+	VkDescriptorBufferInfo quadUniformDescriptor = vertexCache.UniformDescriptor(sizeof(quadUniformData));
+	VkDescriptorBufferInfo planeUniformDescriptor = vertexCache.UniformDescriptor(sizeof(planeUniformData));
+	VkDescriptorBufferInfo offscreenUniformDescriptor = vertexCache.UniformDescriptor(sizeof(meshOffscreenUniformData));
+	VkDescriptorBufferInfo modelUniformDescriptor = vertexCache.UniformDescriptor(sizeof(modelUniformData));
+
 	// Image descriptor for the shadow map attachment
 	VkDescriptorImageInfo offscreenDescriptor =
 		VkTools::Initializer::DescriptorImageInfo(
@@ -1350,7 +1103,7 @@ void Renderer::PrepareVertices(bool useStagingBuffers)
 		std::vector<VkWriteDescriptorSet> quadWriteDescriptorSets =
 		{
 			// Binding 0 : Vertex shader uniform buffer
-			VkTools::Initializer::WriteDescriptorSet(quadDescriptorSet,VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,0, &uniformData.quad.descriptor),
+			VkTools::Initializer::WriteDescriptorSet(quadDescriptorSet,VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,0, &quadUniformDescriptor),
 
 			// Binding 1: Image descriptor
 			VkTools::Initializer::WriteDescriptorSet(quadDescriptorSet,VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,1, &offscreenDescriptor)
@@ -1363,7 +1116,7 @@ void Renderer::PrepareVertices(bool useStagingBuffers)
 		std::vector<VkWriteDescriptorSet> testquadWriteDescriptorSets =
 		{
 			// Binding 0 : Vertex shader uniform buffer
-			VkTools::Initializer::WriteDescriptorSet(planeDescriptorSet,VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,0, &uniformData.plane.descriptor),
+			VkTools::Initializer::WriteDescriptorSet(planeDescriptorSet,VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,0, &planeUniformDescriptor),
 
 			// Binding 1 : Image descriptor
 			VkTools::Initializer::WriteDescriptorSet(planeDescriptorSet,VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,1, &offscreenDescriptor)
@@ -1377,7 +1130,7 @@ void Renderer::PrepareVertices(bool useStagingBuffers)
 		std::vector<VkWriteDescriptorSet> offscreenWriteDescriptorSets =
 		{
 			// Binding 0 : Vertex shader uniform buffer
-			VkTools::Initializer::WriteDescriptorSet(offscreenDescriptorSet,VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,0, &uniformData.offscreenModel.descriptor),
+			VkTools::Initializer::WriteDescriptorSet(offscreenDescriptorSet,VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,0, &offscreenUniformDescriptor),
 
 			// Binding 1: Image descriptor
 			VkTools::Initializer::WriteDescriptorSet(quadDescriptorSet,VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,1, &offscreenDescriptor)
@@ -1391,7 +1144,7 @@ void Renderer::PrepareVertices(bool useStagingBuffers)
 		std::vector<VkWriteDescriptorSet> offscreenWriteDescriptorSets =
 		{
 			// Binding 0 : Vertex shader uniform buffer
-			VkTools::Initializer::WriteDescriptorSet(offscreenPlaneDescriptorSet,VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,0, &uniformData.offscreenPlane.descriptor),
+			VkTools::Initializer::WriteDescriptorSet(offscreenPlaneDescriptorSet,VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,0, &offscreenUniformDescriptor),
 
 			// Binding 1: Image descriptor
 			VkTools::Initializer::WriteDescriptorSet(quadDescriptorSet,VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,1, &offscreenDescriptor)
@@ -1403,7 +1156,6 @@ void Renderer::PrepareVertices(bool useStagingBuffers)
 	//Create font pipeline
 	m_VkFont->CreateFontVk((GetAssetPath() + "Textures/freetype/AmazDooMLeft.ttf"), 64, 96);
 
-	m_VkFont->SetupDescriptorPool();
 	m_VkFont->SetupDescriptorSetLayout();
 	m_VkFont->PrepareUniformBuffers();
 	m_VkFont->InitializeChars("qwertyuiopasdfghjklzxcvbnmQWERTYUIOPASDFGHJKLZXCVBNM-:.@1234567890", *m_pTextureLoader);
@@ -1415,9 +1167,6 @@ void Renderer::PrepareVertices(bool useStagingBuffers)
 	staticModel.InitFromFile("Geometry/nanosuit/nanosuit2.obj", GetAssetPath());
 
 
-	std::vector<VkBufferObject_s> listStagingBuffers;
-	listLocalBuffers.resize(staticModel.surfaces.size());
-	listStagingBuffers.resize(staticModel.surfaces.size());
 	listDescriptros.resize(staticModel.surfaces.size());
 	for (int i = 0; i < staticModel.surfaces.size(); i++) 
 	{
@@ -1429,7 +1178,7 @@ void Renderer::PrepareVertices(bool useStagingBuffers)
 		std::vector<VkWriteDescriptorSet> writeDescriptorSets =
 		{
 			//uniform descriptor
-			VkTools::Initializer::WriteDescriptorSet(listDescriptros[i],VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,	0,&uniformData.model.descriptor)
+			VkTools::Initializer::WriteDescriptorSet(listDescriptros[i],VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,	0,&modelUniformDescriptor)
 		};
 		
 		//We need this because descriptorset will take pointer to vkDescriptorImageInfo.
@@ -1453,50 +1202,21 @@ void Renderer::PrepareVertices(bool useStagingBuffers)
 		vkUpdateDescriptorSets(m_pWRenderer->m_SwapChain.device, writeDescriptorSets.size(), writeDescriptorSets.data(), 0, NULL);
 
 
-		//Create stagging buffer first
-		VkBufferObject::CreateBuffer(
-			m_pWRenderer->m_SwapChain,
-			m_pWRenderer->m_DeviceMemoryProperties,
-			VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT,
-			static_cast<uint32_t>(sizeof(drawVert) * tr->numVerts),
-			listStagingBuffers[i],
-			tr->verts);
-
-		//Create Local Copy
-		VkBufferObject::CreateBuffer(
-			m_pWRenderer->m_SwapChain,
-			m_pWRenderer->m_DeviceMemoryProperties,
-			VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-			static_cast<uint32_t>(sizeof(drawVert) * tr->numVerts),
-			listLocalBuffers[i]);
-
-
-		//Create new command buffer
-		VkCommandBuffer copyCmd = GetCommandBuffer(true);
-
-
-		//Submit info to the queue
-		VkBufferObject::SubmitBufferObjects(
-			copyCmd,
-			m_pWRenderer->m_Queue,
-			*m_pWRenderer,
-			static_cast<uint32_t>(sizeof(drawVert) * tr->numVerts),
-				listStagingBuffers[i],
-				listLocalBuffers[i], (drawVertFlags::Vertex | drawVertFlags::Normal | drawVertFlags::Uv | drawVertFlags::Tangent | drawVertFlags::Binormal));
-
-		meshSize.push_back(tr->numVerts);
 
 		numVerts += tr->numVerts;
 		numUvs += tr->numVerts;
 		numNormals += tr->numVerts;
 	}
+
+	//One vertex and one index buffer for the whole model
+	staticModel.CreateBuffers(m_pWRenderer->m_SwapChain, m_pWRenderer->m_DeviceMemoryProperties);
 }
 
 
 void Renderer::PreparePipeline()
 {
+	//Pipelines do not depend on each other, they are compiled together on worker threads
+	VulkanPipelineBuilder pipelineBuilder(m_pWRenderer->m_SwapChain.device, m_pWRenderer->m_PipelineCache);
 
 	// Create our rendering pipeline used in this example
 	// Vulkan uses the concept of rendering pipelines to encapsulate
@@ -1609,7 +1329,7 @@ void Renderer::PreparePipeline()
 	// Create Pipeline state VI-IA-VS-VP-RS-FS-CB
 	pipelineCreateInfo.stageCount = static_cast<uint32_t>(shaderStages.size());
 	pipelineCreateInfo.pStages = shaderStages.data();
-	pipelineCreateInfo.pVertexInputState = &listLocalBuffers[0].inputState;
+	pipelineCreateInfo.pVertexInputState = &staticModel.vertexBuffer.inputState;
 	pipelineCreateInfo.pInputAssemblyState = &inputAssemblyState;
 	pipelineCreateInfo.pRasterizationState = &rasterizationState;
 	pipelineCreateInfo.pColorBlendState = &colorBlendState;
@@ -1620,7 +1340,7 @@ void Renderer::PreparePipeline()
 	pipelineCreateInfo.pDynamicState = &dynamicState;
 
 	// Create rendering pipeline
-	VK_CHECK_RESULT(vkCreateGraphicsPipelines(m_pWRenderer->m_SwapChain.device, m_pWRenderer->m_PipelineCache, 1, &pipelineCreateInfo, nullptr, &pipeline));
+	pipelineBuilder.Add(pipelineCreateInfo, &pipeline);
 
 
 	// quad pipeline
@@ -1629,14 +1349,14 @@ void Renderer::PreparePipeline()
 
 	pipelineCreateInfo.layout = quadPipelineLayout;
 	pipelineCreateInfo.pVertexInputState = &quadVbo.inputState;
-	VK_CHECK_RESULT(vkCreateGraphicsPipelines(m_pWRenderer->m_SwapChain.device, m_pWRenderer->m_PipelineCache, 1, &pipelineCreateInfo, nullptr, &quadPipeline));
+	pipelineBuilder.Add(pipelineCreateInfo, &quadPipeline);
 
 
 
 	//plane pipeline
 	shaderStages[0] = LoadShader(GetAssetPath() + "Shaders/ShadowMapping/plane.vert.spv", VK_SHADER_STAGE_VERTEX_BIT);
 	shaderStages[1] = LoadShader(GetAssetPath() + "Shaders/ShadowMapping/plane.frag.spv", VK_SHADER_STAGE_FRAGMENT_BIT);
-	VK_CHECK_RESULT(vkCreateGraphicsPipelines(m_pWRenderer->m_SwapChain.device, m_pWRenderer->m_PipelineCache, 1, &pipelineCreateInfo, nullptr, &planePipeline));
+	pipelineBuilder.Add(pipelineCreateInfo, &planePipeline);
 
 
 	// Offscreen pipeline
@@ -1657,7 +1377,9 @@ void Renderer::PreparePipeline()
 
 	pipelineCreateInfo.layout = offscreenPipelineLayout;
 	pipelineCreateInfo.renderPass = offScreenFrameBuf.renderPass;
-	VK_CHECK_RESULT(vkCreateGraphicsPipelines(m_pWRenderer->m_SwapChain.device, m_pWRenderer->m_PipelineCache, 1, &pipelineCreateInfo, nullptr, &offscreenPipeline));
+	pipelineBuilder.Add(pipelineCreateInfo, &offscreenPipeline);
+
+	BuildPipelines(pipelineBuilder);
 }
 
 
@@ -1673,8 +1395,8 @@ void Renderer::SetupDescriptorSetLayout()
 	{
 		std::vector<VkDescriptorSetLayoutBinding> setLayoutBindings =
 		{
-			// Binding 0 : Vertex shader uniform buffer
-			VkTools::Initializer::DescriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,VK_SHADER_STAGE_VERTEX_BIT,0),
+			// Binding 0 : Vertex shader uniform buffer, from vertexCache uniform memory
+			VkTools::Initializer::DescriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,VK_SHADER_STAGE_VERTEX_BIT,0),
 
 			// Binding 1 : Fragment shader image sampler
 			VkTools::Initializer::DescriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,VK_SHADER_STAGE_FRAGMENT_BIT,1),
@@ -1713,7 +1435,7 @@ void Renderer::SetupDescriptorPool()
 	// Example uses one ubo and one image sampler
 	std::vector<VkDescriptorPoolSize> poolSizes =
 	{
-		VkTools::Initializer::DescriptorPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, (11)),
+		VkTools::Initializer::DescriptorPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, (11)),
 		VkTools::Initializer::DescriptorPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, (44))
 	};
 
@@ -1729,43 +1451,27 @@ void Renderer::SetupDescriptorSet()
 
 void Renderer::StartFrame()
 {
+	// Get next image in the swap chain (back/front buffer).
+	// Waits only if a frame still in flight rendered to the same image
+	VK_CHECK_RESULT(frameManager->AcquireImage(m_pWRenderer->m_SwapChain, &m_pWRenderer->m_currentBuffer));
 
-	{
-		// Get next image in the swap chain (back/front buffer)
-		VK_CHECK_RESULT(m_pWRenderer->m_SwapChain.GetNextImage(Semaphores.presentComplete, &m_pWRenderer->m_currentBuffer));
-
-		// Submit the post present image barrier to transform the image back to a color attachment
-		// that can be used to write to by our render pass
-		VkSubmitInfo submitInfo = VkTools::Initializer::SubmitInfo();
-		submitInfo.commandBufferCount = 1;
-		submitInfo.pCommandBuffers = &m_pWRenderer->m_PostPresentCmdBuffers[m_pWRenderer->m_currentBuffer];
-
-		VK_CHECK_RESULT(vkQueueSubmit(m_pWRenderer->m_Queue, 1, &submitInfo, VK_NULL_HANDLE));
-
-		// Make sure that the image barrier command submitted to the queue 
-		// has finished executing
-		VK_CHECK_RESULT(vkQueueWaitIdle(m_pWRenderer->m_Queue));
-	}
-
+	//Uniform blocks were written to new offsets this frame.
+	//Per image command buffer is free again, its last frame has finished
+	BuildMainCommandBuffer(m_pWRenderer->m_currentBuffer);
 
+	//Per frame command buffer, recycled once this frame has finished on gpu
+	VkCommandBuffer offscreenCmd = frameManager->GetCommandBuffer();
+	RecordOffscreenCommands(offscreenCmd);
 
 	{
-
-		//Submit model
-		VkPipelineStageFlags submitPipelineStages = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
 		VkPipelineStageFlags stageFlags = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
 		VkSubmitInfo submitInfo = VkTools::Initializer::SubmitInfo();
 
-
-		submitInfo.pWaitDstStageMask = &submitPipelineStages;
-		
 		{
-			submitInfo.commandBufferCount = 1;
-			submitInfo.pCommandBuffers = &offScreenCmdBuffer;
-
-			// Wait for swap chain presentation to finish
-			submitInfo.waitSemaphoreCount = 1;
-			submitInfo.pWaitSemaphores = &Semaphores.presentComplete;
+			//Shadow map does not touch the swap chain image, so it does not wait for it
+			VkCommandBuffer offscreenCmds[] = { frameManager->BeginFrameTimer(), offscreenCmd };
+			submitInfo.commandBufferCount = 2;
+			submitInfo.pCommandBuffers = offscreenCmds;
 
 			//Signal ready for model render to complete
 			submitInfo.signalSemaphoreCount = 1;
@@ -1774,19 +1480,26 @@ void Renderer::StartFrame()
 		}
 
 		{
-			// Wait offscreen rendering to finnish
-			submitInfo.pWaitSemaphores = &offscreenSemaphore;
+			// Wait offscreen rendering to finnish before sampling the shadow map.
+			// Post present barrier transforms the image back to a color attachment once it is acquired
+			VkSemaphore mainWaitSemaphores[] = { offscreenSemaphore, frameManager->ImageAcquiredSemaphore() };
+			VkPipelineStageFlags mainWaitStages[] = { VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT };
+			VkCommandBuffer mainCmds[] = { m_pWRenderer->m_PostPresentCmdBuffers[m_pWRenderer->m_currentBuffer], m_pWRenderer->m_DrawCmdBuffers[m_pWRenderer->m_currentBuffer] };
+			submitInfo.waitSemaphoreCount = 2;
+			submitInfo.pWaitSemaphores = mainWaitSemaphores;
+			submitInfo.pWaitDstStageMask = mainWaitStages;
+			submitInfo.commandBufferCount = 2;
+			submitInfo.pCommandBuffers = mainCmds;
 
 			//Signal ready for model rendering
 			submitInfo.pSignalSemaphores = &Semaphores.renderComplete;
-
-			submitInfo.pCommandBuffers = &m_pWRenderer->m_DrawCmdBuffers[m_pWRenderer->m_currentBuffer];
 			VK_CHECK_RESULT(vkQueueSubmit(m_pWRenderer->m_Queue, 1, &submitInfo, VK_NULL_HANDLE));
 		}
 
 
 		{
 			//Wait for color output before rendering text
+			submitInfo.waitSemaphoreCount = 1;
 			submitInfo.pWaitDstStageMask = &stageFlags;
 
 			// Wait model rendering to finnish
@@ -1794,36 +1507,21 @@ void Renderer::StartFrame()
 			//Signal ready for text to completeS
 			submitInfo.pSignalSemaphores = &Semaphores.textOverlayComplete;
 
+			submitInfo.commandBufferCount = 1;
 			submitInfo.pCommandBuffers = &m_VkFont->cmdBuffers[m_pWRenderer->m_currentBuffer];
 			VK_CHECK_RESULT(vkQueueSubmit(m_pWRenderer->m_Queue, 1, &submitInfo, VK_NULL_HANDLE));
 		}
 
-
-		// Reset stage mask
-		submitInfo.pWaitDstStageMask = &submitPipelineStages;
-		// Reset wait and signal semaphores for rendering next frame
-		// Wait for swap chain presentation to finish
-		submitInfo.waitSemaphoreCount = 1;
-		submitInfo.pWaitSemaphores = &Semaphores.presentComplete;
-		// Signal ready with offscreen semaphore
-		submitInfo.signalSemaphoreCount = 1;
-		submitInfo.pSignalSemaphores = &Semaphores.renderComplete;
-
-	}
-
-	{
 		// Submit pre present image barrier to transform the image from color attachment to present(khr) for presenting to the swap chain
-		VkSubmitInfo submitInfo = VkTools::Initializer::SubmitInfo();
-		submitInfo.commandBufferCount = 1;
+		VkSemaphore renderComplete = frameManager->RenderCompleteSemaphore();
+		submitInfo.pWaitSemaphores = &Semaphores.textOverlayComplete;
 		submitInfo.pCommandBuffers = &m_pWRenderer->m_PrePresentCmdBuffers[m_pWRenderer->m_currentBuffer];
+		submitInfo.pSignalSemaphores = &renderComplete;
 		VK_CHECK_RESULT(vkQueueSubmit(m_pWRenderer->m_Queue, 1, &submitInfo, VK_NULL_HANDLE));
 
-
-		// Present the current buffer to the swap chain
-		// We pass the signal semaphore from the submit info
-		// to ensure that the image is not rendered until
-		// all commands have been submitted
-		VK_CHECK_RESULT(m_pWRenderer->m_SwapChain.QueuePresent(m_pWRenderer->m_Queue, m_pWRenderer->m_currentBuffer, Semaphores.textOverlayComplete));
+		// Present the current buffer to the swap chain once the whole frame has been rendered.
+		// EndFrame fences the frame, there is no wait for the queue here
+		VK_CHECK_RESULT(m_pWRenderer->m_SwapChain.QueuePresent(m_pWRenderer->m_Queue, m_pWRenderer->m_currentBuffer, renderComplete));
 	}
 }
 
@@ -1841,16 +1539,31 @@ Renderer g_Renderer;
 int main()
 {
 	//Initialize Renderer
+#if defined(_WIN32)
 	g_bPrepared = g_Renderer.VInitRenderer(720, 1280, false, HandleWindowMessages);
+#else
+	//No window on other platforms, needs TYW_HEADLESS=<frames>. Size is what WM_SIZE reports on Windows
+	g_iDesktopWidth = 1280;
+	g_iDesktopHeight = 720;
+	g_bPrepared = g_Renderer.VInitRenderer(g_iDesktopHeight, g_iDesktopWidth, false, nullptr);
+#endif
+	if (!g_bPrepared)
+	{
+		return 1;
+	}
 	
-#if defined(_WIN32)
 	MSG msg;
-#endif
 
 	while (TRUE)
 	{
 		if (!GenerateEvents(msg))break;
 
+		//Fixed time step and recorded camera path while benchmarking
+		if (g_Renderer.UpdateBenchmark(&g_Renderer.m_Camera))
+		{
+			g_Renderer.m_bViewUpdated = true;
+		}
+
 		//Start timer
 		auto tStart = std::chrono::high_resolution_clock::now();
 
@@ -1893,6 +1606,7 @@ int main()
 }
 
 
+#if defined(_WIN32)
 LRESULT CALLBACK HandleWindowMessages(HWND hWnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
 {
 	switch (uMsg)
@@ -2020,10 +1734,24 @@ LRESULT CALLBACK HandleWindowMessages(HWND hWnd, UINT uMsg, WPARAM wParam, LPARA
 	}
 	return DefWindowProc(hWnd, uMsg, wParam, lParam);
 }
+#endif
 
 
 bool GenerateEvents(MSG& msg)
 {
+	//Benchmark ends with its camera path, the report is written by then
+	if (g_Renderer.IsBenchmarkFinished())
+	{
+		return false;
+	}
+
+	//No window to pump messages for, the run ends after its frame count
+	if (g_Renderer.IsHeadless())
+	{
+		return !g_Renderer.IsHeadlessFinished();
+	}
+
+#if defined(_WIN32)
 	if (PeekMessage(&msg, NULL, 0, 0, PM_REMOVE))
 	{
 		if (msg.message == WM_QUIT)
@@ -2037,9 +1765,13 @@ bool GenerateEvents(MSG& msg)
 		}
 	}
 	return true;
+#else
+	return false;
+#endif
 }
 
 
+#if defined(_WIN32)
 void WIN_Sizing(WORD side, RECT *rect)
 {
 	// restrict to a standard aspect ratio
@@ -2054,4 +1786,5 @@ void WIN_Sizing(WORD side, RECT *rect)
 
 	g_iDesktopWidth -= decoWidth;
 	g_iDesktopHeight -= decoHeight;
-}
\ No newline at end of file
+}
+#endif
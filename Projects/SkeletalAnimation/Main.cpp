@@ -5,31 +5,33 @@
 */
 
 
-#include <RendererPch\stdafx.h>
+#include <RendererPch/stdafx.h>
 
 //Triangle Includes
 #include "Main.h"
 #include <conio.h>
 
 //Renderer Includes
-#include <Renderer\VKRenderer.h>
-#include <Renderer\Vulkan\VulkanTools.h>
-#include <Renderer\Vulkan\VulkanTextureLoader.h>
+#include <Renderer/VKRenderer.h>
+#include <Renderer/VertexCache.h>
+#include <Renderer/Vulkan/VulkanTools.h>
+#include <Renderer/Vulkan/VulkanTextureLoader.h>
 
 //Model Loader Includes
-#include <Renderer\MeshLoader\Model_local.h>
-#include <Renderer\MeshLoader\ImageManager.h>
-#include <Renderer\MeshLoader\Material.h>
-#include <Renderer\AnimationManager\MD5Anim\MD5Anim.h>
+#include <Renderer/MeshLoader/Model_local.h>
+#include <Renderer/MeshLoader/ImageManager.h>
+#include <Renderer/MeshLoader/Material.h>
+#include <Renderer/AnimationManager/MD5Anim/MD5Anim.h>
 
 
 //Vulkan Includes
-#include <Renderer\Vulkan\VkBufferObject.h>
-#include <Renderer\Vulkan\VulkanSwapChain.h>
+#include <Renderer/Vulkan/VkBufferObject.h>
+#include <Renderer/Vulkan/VulkanSwapChain.h>
+#include <Renderer/Vulkan/VulkanFrameManager.h>
 
 
 //Font Rendering
-#include <Renderer\ThirdParty\FreeType\VkFont.h>
+#include <Renderer/ThirdParty/FreeType/VkFont.h>
 
 
 
@@ -125,23 +127,18 @@ private:
 	// Synchronization semaphores
 	// Semaphores are used to synchronize dependencies between command buffers
 	// We use them to ensure that we e.g. don't present to the swap chain
-	// until all rendering has completed
+	// until all rendering has completed.
+	// Swap chain acquire and present semaphores belong to frameManager, one pair per frame in flight
 	struct 
 	{
-		// Swap chain image presentation
-		VkSemaphore presentComplete;
 		// Command buffer submission and execution
 		VkSemaphore renderComplete;
 		// Text overlay submission and execution
 		VkSemaphore textOverlayComplete;
 	} Semaphores;
 
-	struct 
-	{
-		VkBuffer buffer;
-		VkDeviceMemory memory;
-		VkDescriptorBufferInfo descriptor;
-	}  uniformDataVS;
+	//m_uboVS copy of the current frame in vertexCache uniform memory, bound with a dynamic offset
+	vertCacheHandle_t uboHandle;
 
 	struct 
 	{
@@ -162,13 +159,7 @@ private:
 	float		m_fDeltaTime;
 	frameBlend_t frame;
 
-	std::vector<VkBufferObject_s> listLocalBuffers;
-	std::vector<VkBufferObject_s> listLocalIndexBuffers;
-	std::vector<VkBufferObject_s> listStagingBuffersVerts;
-
-
 	std::vector<VkDescriptorSet>   listDescriptros;
-	std::vector<uint32_t>		   meshSize;
 
 	//Model loading
 	RenderModelMD5 md5Model;
@@ -178,6 +169,7 @@ public:
 	~Renderer();
 
 	void BuildCommandBuffers() override;
+	void BuildDrawCommandBuffer(uint32_t i);
 	void UpdateUniformBuffers() override;
 	void PrepareUniformBuffers() override;
 	void PrepareVertices(bool useStagingBuffers) override;
@@ -207,34 +199,12 @@ Renderer::~Renderer()
 {
 	SAFE_DELETE(m_VkFont);
 
-	//Delete memory
-	for (int i = 0; i < listLocalBuffers.size(); i++)
-	{
-		VkBufferObject::DeleteBufferMemory(m_pWRenderer->m_SwapChain.device, listLocalBuffers[i], nullptr);
-	}
-
-	for (int i = 0; i < listLocalIndexBuffers.size(); i++)
-	{
-		VkBufferObject::DeleteBufferMemory(m_pWRenderer->m_SwapChain.device, listLocalIndexBuffers[i], nullptr);
-	}
-
 	//Delete data from static model
 	md5Model.Clear(m_pWRenderer->m_SwapChain.device);
 
 
-	//Delete uniform data
-	vkDestroyBuffer(m_pWRenderer->m_SwapChain.device, uniformDataVS.buffer, nullptr);
-	vkFreeMemory(m_pWRenderer->m_SwapChain.device, uniformDataVS.memory, nullptr);
-	
-
-	//Destroy Shader Module
-	for (int i = 0; i < m_ShaderModules.size(); i++)
-	{
-		vkDestroyShaderModule(m_pWRenderer->m_SwapChain.device, m_ShaderModules[i], nullptr);
-	}
 
 	//Release semaphores
-	vkDestroySemaphore(m_pWRenderer->m_SwapChain.device, Semaphores.presentComplete, nullptr);
 	vkDestroySemaphore(m_pWRenderer->m_SwapChain.device, Semaphores.renderComplete, nullptr);
 	vkDestroySemaphore(m_pWRenderer->m_SwapChain.device, Semaphores.textOverlayComplete, nullptr);
 
@@ -250,10 +220,6 @@ void Renderer::PrepareSemaphore()
 	semaphoreCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
 	semaphoreCreateInfo.pNext = NULL;
 
-	// This semaphore ensures that the image is complete
-	// before starting to submit again
-	VK_CHECK_RESULT(vkCreateSemaphore(m_pWRenderer->m_SwapChain.device, &semaphoreCreateInfo, nullptr, &Semaphores.presentComplete));
-
 	// This semaphore ensures that all commands submitted
 	// have been finished before submitting the image to the queue
 	VK_CHECK_RESULT(vkCreateSemaphore(m_pWRenderer->m_SwapChain.device, &semaphoreCreateInfo, nullptr, &Semaphores.renderComplete));
@@ -274,20 +240,13 @@ void Renderer::ChangeLodBias(float delta)
 void Renderer::StartFrame()
 {
 	{
-		// Get next image in the swap chain (back/front buffer)
-		VK_CHECK_RESULT(m_pWRenderer->m_SwapChain.GetNextImage(Semaphores.presentComplete, &m_pWRenderer->m_currentBuffer));
-
-		// Submit the post present image barrier to transform the image back to a color attachment
-		// that can be used to write to by our render pass
-		VkSubmitInfo submitInfo = VkTools::Initializer::SubmitInfo();
-		submitInfo.commandBufferCount = 1;
-		submitInfo.pCommandBuffers = &m_pWRenderer->m_PostPresentCmdBuffers[m_pWRenderer->m_currentBuffer];
+		// Get next image in the swap chain (back/front buffer).
+		// Waits only if a frame still in flight rendered to the same image
+		VK_CHECK_RESULT(frameManager->AcquireImage(m_pWRenderer->m_SwapChain, &m_pWRenderer->m_currentBuffer));
 
-		VK_CHECK_RESULT(vkQueueSubmit(m_pWRenderer->m_Queue, 1, &submitInfo, VK_NULL_HANDLE));
-
-		// Make sure that the image barrier command submitted to the queue 
-		// has finished executing
-		VK_CHECK_RESULT(vkQueueWaitIdle(m_pWRenderer->m_Queue));
+		//Bones and matrices of this frame go to a new uniform offset, record it into the draw
+		uboHandle = vertexCache.AllocUniform(&m_uboVS, sizeof(m_uboVS));
+		BuildDrawCommandBuffer(m_pWRenderer->m_currentBuffer);
 	}
 
 
@@ -297,17 +256,19 @@ void Renderer::StartFrame()
 		//Submit model
 		VkPipelineStageFlags submitPipelineStages = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
 		VkPipelineStageFlags stageFlags = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+		VkPipelineStageFlags acquireStageFlags = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
 		VkSubmitInfo submitInfo = VkTools::Initializer::SubmitInfo();
 
-
-		submitInfo.pWaitDstStageMask = &submitPipelineStages;
-
-		submitInfo.commandBufferCount = 1;
-		submitInfo.pCommandBuffers = &m_pWRenderer->m_DrawCmdBuffers[m_pWRenderer->m_currentBuffer];
+		// Post present barrier transforms the image back to a color attachment once it is acquired
+		VkSemaphore imageAcquired = frameManager->ImageAcquiredSemaphore();
+		VkCommandBuffer drawCmds[] = { frameManager->BeginFrameTimer(), m_pWRenderer->m_PostPresentCmdBuffers[m_pWRenderer->m_currentBuffer], m_pWRenderer->m_DrawCmdBuffers[m_pWRenderer->m_currentBuffer] };
+		submitInfo.pWaitDstStageMask = &acquireStageFlags;
+		submitInfo.commandBufferCount = 3;
+		submitInfo.pCommandBuffers = drawCmds;
 
 		// Wait for swap chain presentation to finish
 		submitInfo.waitSemaphoreCount = 1;
-		submitInfo.pWaitSemaphores = &Semaphores.presentComplete;
+		submitInfo.pWaitSemaphores = &imageAcquired;
 
 		//Signal ready for model render to complete
 		submitInfo.signalSemaphoreCount = 1;
@@ -323,40 +284,39 @@ void Renderer::StartFrame()
 		//Signal ready for text to completeS
 		submitInfo.pSignalSemaphores = &Semaphores.textOverlayComplete;
 
+		submitInfo.commandBufferCount = 1;
 		submitInfo.pCommandBuffers = &m_VkFont->cmdBuffers[m_pWRenderer->m_currentBuffer];
 		VK_CHECK_RESULT(vkQueueSubmit(m_pWRenderer->m_Queue, 1, &submitInfo, VK_NULL_HANDLE));
 
 
-		// Reset stage mask
-		submitInfo.pWaitDstStageMask = &submitPipelineStages;
-		// Reset wait and signal semaphores for rendering next frame
-		// Wait for swap chain presentation to finish
-		submitInfo.waitSemaphoreCount = 1;
-		submitInfo.pWaitSemaphores = &Semaphores.presentComplete;
-		// Signal ready with offscreen semaphore
-		submitInfo.signalSemaphoreCount = 1;
-		submitInfo.pSignalSemaphores = &Semaphores.renderComplete;
-
-	}
-
-	{
 		// Submit pre present image barrier to transform the image from color attachment to present(khr) for presenting to the swap chain
-		VkSubmitInfo submitInfo = VkTools::Initializer::SubmitInfo();
-		submitInfo.commandBufferCount = 1;
+		VkSemaphore renderComplete = frameManager->RenderCompleteSemaphore();
+		submitInfo.pWaitDstStageMask = &submitPipelineStages;
+		submitInfo.pWaitSemaphores = &Semaphores.textOverlayComplete;
+		submitInfo.pSignalSemaphores = &renderComplete;
 		submitInfo.pCommandBuffers = &m_pWRenderer->m_PrePresentCmdBuffers[m_pWRenderer->m_currentBuffer];
 		VK_CHECK_RESULT(vkQueueSubmit(m_pWRenderer->m_Queue, 1, &submitInfo, VK_NULL_HANDLE));
 
-		// Present the current buffer to the swap chain
-		// We pass the signal semaphore from the submit info
-		// to ensure that the image is not rendered until
-		// all commands have been submitted
-		VK_CHECK_RESULT(m_pWRenderer->m_SwapChain.QueuePresent(m_pWRenderer->m_Queue, m_pWRenderer->m_currentBuffer, Semaphores.textOverlayComplete));
+		// Present the current buffer to the swap chain once the whole frame has been rendered.
+		// EndFrame fences the frame, there is no wait for the queue here
+		VK_CHECK_RESULT(m_pWRenderer->m_SwapChain.QueuePresent(m_pWRenderer->m_Queue, m_pWRenderer->m_currentBuffer, renderComplete));
 	}
 }
 
 
 void Renderer::BuildCommandBuffers()
 {
+	for (uint32_t i = 0; i < m_pWRenderer->m_DrawCmdBuffers.size(); ++i)
+	{
+		BuildDrawCommandBuffer(i);
+	}
+}
+
+//Records draw for swap chain image i. StartFrame records it again each frame with the new uniform offset
+void Renderer::BuildDrawCommandBuffer(uint32_t i)
+{
+	const uint32_t uboOffset = static_cast<uint32_t>(uboHandle.offset);
+
 	VkCommandBufferBeginInfo cmdBufInfo = {};
 	cmdBufInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
 	cmdBufInfo.pNext = NULL;
@@ -379,70 +339,63 @@ void Renderer::BuildCommandBuffers()
 	renderPassBeginInfo.clearValueCount = 2;
 	renderPassBeginInfo.pClearValues = clearValues;
 
-	for (int32_t i = 0; i < m_pWRenderer->m_DrawCmdBuffers.size(); ++i)
-	{
-
-		// Set target frame buffer
-		renderPassBeginInfo.framebuffer = m_pWRenderer->m_FrameBuffers[i];
-
-		VK_CHECK_RESULT(vkBeginCommandBuffer(m_pWRenderer->m_DrawCmdBuffers[i], &cmdBufInfo));
-
-		// Start the first sub pass specified in our default render pass setup by the base class
-		// This will clear the color and depth attachment
-		vkCmdBeginRenderPass(m_pWRenderer->m_DrawCmdBuffers[i], &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
+	// Set target frame buffer
+	renderPassBeginInfo.framebuffer = m_pWRenderer->m_FrameBuffers[i];
 
-		// Update dynamic viewport state
-		VkViewport viewport = {};
-		viewport.height = (float)g_iDesktopHeight;
-		viewport.width = (float)g_iDesktopWidth;
-		viewport.minDepth = 0.0f;
-		viewport.maxDepth = 1.0f;
-		vkCmdSetViewport(m_pWRenderer->m_DrawCmdBuffers[i], 0, 1, &viewport);
+	VK_CHECK_RESULT(vkBeginCommandBuffer(m_pWRenderer->m_DrawCmdBuffers[i], &cmdBufInfo));
 
-		// Update dynamic scissor state
-		VkRect2D scissor = {};
-		scissor.extent.width = g_iDesktopWidth;
-		scissor.extent.height = g_iDesktopHeight;
-		scissor.offset.x = 0;
-		scissor.offset.y = 0;
-		vkCmdSetScissor(m_pWRenderer->m_DrawCmdBuffers[i], 0, 1, &scissor);
+	// Start the first sub pass specified in our default render pass setup by the base class
+	// This will clear the color and depth attachment
+	vkCmdBeginRenderPass(m_pWRenderer->m_DrawCmdBuffers[i], &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
 
+	// Update dynamic viewport state
+	VkViewport viewport = {};
+	viewport.height = (float)g_iDesktopHeight;
+	viewport.width = (float)g_iDesktopWidth;
+	viewport.minDepth = 0.0f;
+	viewport.maxDepth = 1.0f;
+	vkCmdSetViewport(m_pWRenderer->m_DrawCmdBuffers[i], 0, 1, &viewport);
 
-		// Bind the rendering pipeline
-		// The pipeline (state object) contains all states of the rendering pipeline
-		// So once we bind a pipeline all states that were set upon creation of that
-		// pipeline will be set
-		vkCmdBindPipeline(m_pWRenderer->m_DrawCmdBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+	// Update dynamic scissor state
+	VkRect2D scissor = {};
+	scissor.extent.width = g_iDesktopWidth;
+	scissor.extent.height = g_iDesktopHeight;
+	scissor.offset.x = 0;
+	scissor.offset.y = 0;
+	vkCmdSetScissor(m_pWRenderer->m_DrawCmdBuffers[i], 0, 1, &scissor);
 
 
-		// Bind triangle vertex buffer (contains position and colors)
-		VkDeviceSize offsets[1] = { 0 };
+	// Bind the rendering pipeline
+	// The pipeline (state object) contains all states of the rendering pipeline
+	// So once we bind a pipeline all states that were set upon creation of that
+	// pipeline will be set
+	vkCmdBindPipeline(m_pWRenderer->m_DrawCmdBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
 
-		for (int j = 0; j < listLocalBuffers.size(); j++)
-		{
-			// Bind descriptor sets describing shader binding points
-			vkCmdBindDescriptorSets(m_pWRenderer->m_DrawCmdBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &listDescriptros[j], 0, NULL);
-
-			//Bind Buffer
-			vkCmdBindVertexBuffers(m_pWRenderer->m_DrawCmdBuffers[i], VERTEX_BUFFER_BIND_ID, 1, &listLocalBuffers[j].buffer, offsets);
 
-			//Bind mesh index buffers
-			vkCmdBindIndexBuffer(m_pWRenderer->m_DrawCmdBuffers[i], listLocalIndexBuffers[j].buffer, 0, VK_INDEX_TYPE_UINT32);
+	// All meshes share one vertex and index buffer
+	md5Model.BindBuffers(m_pWRenderer->m_DrawCmdBuffers[i], VERTEX_BUFFER_BIND_ID);
+	for (int j = 0; j < md5Model.surfaces.size(); j++)
+	{
+		const modelSurface_t& surf = md5Model.surfaces[j];
 
-			//Draw
-			vkCmdDrawIndexed(m_pWRenderer->m_DrawCmdBuffers[i], meshSize[j], 1, 0, 0, 0);
-		}
+		// Bind descriptor sets describing shader binding points
+		vkCmdBindDescriptorSets(m_pWRenderer->m_DrawCmdBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &listDescriptros[j], 1, &uboOffset);
 
+		//Draw
+		vkCmdDrawIndexed(m_pWRenderer->m_DrawCmdBuffers[i], surf.indexCount, 1, surf.firstIndex, surf.vertexOffset, 0);
+	}
 
-		vkCmdEndRenderPass(m_pWRenderer->m_DrawCmdBuffers[i]);
-		VK_CHECK_RESULT(vkEndCommandBuffer(m_pWRenderer->m_DrawCmdBuffers[i]));
 
-	}
+	vkCmdEndRenderPass(m_pWRenderer->m_DrawCmdBuffers[i]);
+	VK_CHECK_RESULT(vkEndCommandBuffer(m_pWRenderer->m_DrawCmdBuffers[i]));
 }
 
 
 void Renderer::BeginTextUpdate()
 {
+	//Text rewrites its vertex buffer and records every per image command buffer again,
+	//none of them may be in use by a frame in flight
+	frameManager->WaitIdle();
 	m_VkFont->BeginTextUpdate();
 
 	std::stringstream ss;
@@ -486,57 +439,12 @@ void Renderer::UpdateUniformBuffers()
 		m_uboVS.bones[i] = matrix[i] * md5Model.inverseBindPose[i];
 	}
 
-
-
-	// Map uniform buffer and update it
-	uint8_t *pData;
-	VK_CHECK_RESULT(vkMapMemory(m_pWRenderer->m_SwapChain.device, uniformDataVS.memory, 0, sizeof(m_uboVS), 0, (void **)&pData));
-	memcpy(pData, &m_uboVS, sizeof(m_uboVS));
-	vkUnmapMemory(m_pWRenderer->m_SwapChain.device, uniformDataVS.memory);
+	//Copied to vertexCache uniform memory by StartFrame
 }
 
 void Renderer::PrepareUniformBuffers()
 {
-	// Prepare and initialize a uniform buffer block containing shader uniforms
-	// In Vulkan there are no more single uniforms like in GL
-	// All shader uniforms are passed as uniform buffer blocks 
-	VkMemoryRequirements memReqs;
-
-	// Vertex shader uniform buffer block
-	VkBufferCreateInfo bufferInfo = {};
-	VkMemoryAllocateInfo allocInfo = {};
-	allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-	allocInfo.pNext = NULL;
-	allocInfo.allocationSize = 0;
-	allocInfo.memoryTypeIndex = 0;
-
-	bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-	bufferInfo.size = sizeof(m_uboVS);
-	bufferInfo.usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT;
-
-	// Create a new buffer
-	VK_CHECK_RESULT(vkCreateBuffer(m_pWRenderer->m_SwapChain.device, &bufferInfo, nullptr, &uniformDataVS.buffer));
-	// Get memory requirements including size, alignment and memory type 
-	vkGetBufferMemoryRequirements(m_pWRenderer->m_SwapChain.device, uniformDataVS.buffer, &memReqs);
-	allocInfo.allocationSize = memReqs.size;
-	// Get the memory type index that supports host visibile memory access
-	// Most implementations offer multiple memory tpyes and selecting the 
-	// correct one to allocate memory from is important
-	// We also want the buffer to be host coherent so we don't have to flush 
-	// after every update. 
-	// Note that this may affect performance so you might not want to do this 
-	// in a real world application that updates buffers on a regular base
-	allocInfo.memoryTypeIndex = VkTools::GetMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, m_pWRenderer->m_DeviceMemoryProperties);
-	// Allocate memory for the uniform buffer
-	VK_CHECK_RESULT(vkAllocateMemory(m_pWRenderer->m_SwapChain.device, &allocInfo, nullptr, &(uniformDataVS.memory)));
-	// Bind memory to buffer
-	VK_CHECK_RESULT(vkBindBufferMemory(m_pWRenderer->m_SwapChain.device, uniformDataVS.buffer, uniformDataVS.memory, 0));
-
-	// Store information in the uniform's descriptor
-	uniformDataVS.descriptor.buffer = uniformDataVS.buffer;
-	uniformDataVS.descriptor.offset = 0;
-	uniformDataVS.descriptor.range = sizeof(m_uboVS);
-
+	//No dedicated buffer, each frame allocates from vertexCache uniform memory
 	UpdateUniformBuffers();
 }
 
@@ -545,48 +453,24 @@ void Renderer::PrepareVertices(bool useStagingBuffers)
 	//Create font pipeline
 	m_VkFont->CreateFontVk((GetAssetPath() + "Textures/freetype/AmazDooMLeft.ttf"), 64, 96);
 
-	m_VkFont->SetupDescriptorPool();
 	m_VkFont->SetupDescriptorSetLayout();
 	m_VkFont->PrepareUniformBuffers();
 	m_VkFont->InitializeChars("qwertyuiopasdfghjklzxcvbnmQWERTYUIOPASDFGHJKLZXCVBNM-:.@1234567890", *m_pTextureLoader);
 	m_VkFont->PrepareResources(g_iDesktopWidth, g_iDesktopHeight);
 	BeginTextUpdate();
 
-	std::vector<VkBufferObject_s> listStagingBuffersIndex;
-
-	//Verts
-	listStagingBuffersVerts.resize(md5Model.meshes.size());
-	listStagingBuffersVerts.resize(md5Model.meshes.size());
-	listStagingBuffersVerts.resize(md5Model.meshes.size());
-
-
-	//Indexes
-	listStagingBuffersIndex.resize(md5Model.meshes.size());
-	listStagingBuffersIndex.resize(md5Model.meshes.size());
-	listStagingBuffersIndex.resize(md5Model.meshes.size());
-
-
-	listLocalBuffers.resize(md5Model.meshes.size());
-	listLocalIndexBuffers.resize(md5Model.meshes.size());
-	listDescriptros.resize(md5Model.meshes.size());
-
 	listDescriptros.resize(md5Model.meshes.size());
 	m_pWRenderer->m_DescriptorPool = VK_NULL_HANDLE;
 	SetupDescriptorPool();
 	VkDescriptorSetAllocateInfo allocInfo = VkTools::Initializer::DescriptorSetAllocateInfo(m_pWRenderer->m_DescriptorPool, &descriptorSetLayout, 1);
 
+	//Whole uniform buffer, block is selected by dynamic offset
+	VkDescriptorBufferInfo uboDescriptor = vertexCache.UniformDescriptor(sizeof(m_uboVS));
+
 
 
 	for (int i = 0; i < md5Model.meshes.size(); i++)
 	{
-		//Get triangles
-		//deformInfo_t* tr = md5Model.meshes[i].deformInfo;
-
-		std::vector<MD5Mesh::meshStructure>&	 deformInfosVec = md5Model.meshes[i].deformInfosVec;
-		std::vector<uint32_t>& indexes = md5Model.meshes[i].indexes;
-		uint32_t numVerts = md5Model.meshes[i].verts.size();
-
-
 		VkTools::VulkanTexture* vkDiffuseTexture = md5Model.meshes[i].shader->getTexture();
 		/*
 			=================================================================================================================
@@ -602,7 +486,7 @@ void Renderer::PrepareVertices(bool useStagingBuffers)
 		std::vector<VkWriteDescriptorSet> writeDescriptorSets =
 		{
 			// Binding 0 : Vertex shader uniform buffer
-			VkTools::Initializer::WriteDescriptorSet(listDescriptros[i],VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,	0,&uniformDataVS.descriptor),
+			VkTools::Initializer::WriteDescriptorSet(listDescriptros[i],VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,	0,&uboDescriptor),
 
 			// Binding 1 : Fragment shader texture sampler
 			VkTools::Initializer::WriteDescriptorSet(listDescriptros[i],VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1,&texDescriptorDiffuse),
@@ -617,162 +501,83 @@ void Renderer::PrepareVertices(bool useStagingBuffers)
 		END SETUP DESCRIPTOR SET
 		=================================================================================================================
 		*/
-
-		//Create stagign buffer
-		//Verts
-		VkBufferObject::CreateBuffer(
-			m_pWRenderer->m_SwapChain,
-			m_pWRenderer->m_DeviceMemoryProperties,
-			VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT,
-			static_cast<uint32_t>(sizeof(MD5Mesh::meshStructure) * numVerts),
-			listStagingBuffersVerts[i],
-			deformInfosVec.data());
-
-		//Index
-		VkBufferObject::CreateBuffer(
-			m_pWRenderer->m_SwapChain,
-			m_pWRenderer->m_DeviceMemoryProperties,
-			VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT,
-			static_cast<uint32_t>(sizeof(uint32_t) * indexes.size()),
-			listStagingBuffersIndex[i],
-			indexes.data());
-
-
-		//Create Local Copy
-		//Verts
-		VkBufferObject::CreateBuffer(
-			m_pWRenderer->m_SwapChain,
-			m_pWRenderer->m_DeviceMemoryProperties,
-			VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-			static_cast<uint32_t>(sizeof(MD5Mesh::meshStructure) * numVerts),
-			listLocalBuffers[i]);
-
-		//Index
-		VkBufferObject::CreateBuffer(
-			m_pWRenderer->m_SwapChain,
-			m_pWRenderer->m_DeviceMemoryProperties,
-			VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-			static_cast<uint32_t>(sizeof(uint32_t) * indexes.size()),
-			listLocalIndexBuffers[i]);
-
-
-		//Create new command buffer
-		VkCommandBuffer copyCmd = GetCommandBuffer(true);
-
-
-		//Submit info to the queue
-		VkBufferObject::SubmitBufferObjects(
-			copyCmd,
-			m_pWRenderer->m_Queue,
-			*m_pWRenderer,
-			static_cast<uint32_t>(sizeof(MD5Mesh::meshStructure) * numVerts),
-				listStagingBuffersVerts[i],
-				listLocalBuffers[i], drawVertFlags::None);
-
-
-
-		// Binding description
-		listLocalBuffers[i].bindingDescriptions.resize(1);
-		listLocalBuffers[i].bindingDescriptions[0].binding = 0;
-		listLocalBuffers[i].bindingDescriptions[0].stride = sizeof(MD5Mesh::meshStructure);
-		listLocalBuffers[i].bindingDescriptions[0].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
-
-		// Attribute descriptions
-		// Describes memory layout and shader attribute locations
-		listLocalBuffers[i].attributeDescriptions.resize(9);
-
-		// Location 0 : Position
-		listLocalBuffers[i].attributeDescriptions[0].binding = 0;
-		listLocalBuffers[i].attributeDescriptions[0].location = 0;
-		listLocalBuffers[i].attributeDescriptions[0].format = VK_FORMAT_R32G32B32_SFLOAT;
-		listLocalBuffers[i].attributeDescriptions[0].offset = offsetof(MD5Mesh::meshStructure, vertex);
-
-		// Location 1 : Normal
-		listLocalBuffers[i].attributeDescriptions[1].binding = 0;
-		listLocalBuffers[i].attributeDescriptions[1].location = 1;
-		listLocalBuffers[i].attributeDescriptions[1].format = VK_FORMAT_R32G32B32_SFLOAT;
-		listLocalBuffers[i].attributeDescriptions[1].offset = offsetof(MD5Mesh::meshStructure, normal);
-
-
-		// Location 2 : Tangent
-		listLocalBuffers[i].attributeDescriptions[2].binding = 0;
-		listLocalBuffers[i].attributeDescriptions[2].location = 2;
-		listLocalBuffers[i].attributeDescriptions[2].format = VK_FORMAT_R32G32B32_SFLOAT;
-		listLocalBuffers[i].attributeDescriptions[2].offset = offsetof(MD5Mesh::meshStructure, tangent);
-
-
-		// Location 3 : Binormal
-		listLocalBuffers[i].attributeDescriptions[3].binding = 0;
-		listLocalBuffers[i].attributeDescriptions[3].location = 3;
-		listLocalBuffers[i].attributeDescriptions[3].format = VK_FORMAT_R32G32B32_SFLOAT;
-		listLocalBuffers[i].attributeDescriptions[3].offset = offsetof(MD5Mesh::meshStructure, binormal);
-
-
-		// Location 4 : Uv
-		listLocalBuffers[i].attributeDescriptions[4].binding = 0;
-		listLocalBuffers[i].attributeDescriptions[4].location = 4;
-		listLocalBuffers[i].attributeDescriptions[4].format = VK_FORMAT_R32G32_SFLOAT;
-		listLocalBuffers[i].attributeDescriptions[4].offset = offsetof(MD5Mesh::meshStructure, tex);
-
-		// Location 5 : BoneWeight 1
-		listLocalBuffers[i].attributeDescriptions[5].binding = 0;
-		listLocalBuffers[i].attributeDescriptions[5].location = 5;
-		listLocalBuffers[i].attributeDescriptions[5].format = VK_FORMAT_R32G32B32A32_SFLOAT;
-		listLocalBuffers[i].attributeDescriptions[5].offset = offsetof(MD5Mesh::meshStructure, boneWeight1);
-
-		
-		// Location 6 : BoneWeight 2
-		listLocalBuffers[i].attributeDescriptions[6].binding = 0;
-		listLocalBuffers[i].attributeDescriptions[6].location = 6;
-		listLocalBuffers[i].attributeDescriptions[6].format = VK_FORMAT_R32G32B32A32_SFLOAT;
-		listLocalBuffers[i].attributeDescriptions[6].offset = offsetof(MD5Mesh::meshStructure, boneWeight2);
-		
-
-
-		// Location 7 : jointId 1
-		listLocalBuffers[i].attributeDescriptions[7].binding = 0;
-		listLocalBuffers[i].attributeDescriptions[7].location = 7;
-		listLocalBuffers[i].attributeDescriptions[7].format = VK_FORMAT_R32G32B32A32_SINT;
-		listLocalBuffers[i].attributeDescriptions[7].offset = offsetof(MD5Mesh::meshStructure, boneId1);
-
-		
-		// Location 8 : jointId 2
-		listLocalBuffers[i].attributeDescriptions[8].binding = 0;
-		listLocalBuffers[i].attributeDescriptions[8].location = 8;
-		listLocalBuffers[i].attributeDescriptions[8].format = VK_FORMAT_R32G32B32A32_SINT;
-		listLocalBuffers[i].attributeDescriptions[8].offset = offsetof(MD5Mesh::meshStructure, boneId2);
-		
-
-
-
-
-		// Assign to vertex input state
-		listLocalBuffers[i].inputState.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-		listLocalBuffers[i].inputState.pNext = NULL;
-		listLocalBuffers[i].inputState.flags = VK_FLAGS_NONE;
-		listLocalBuffers[i].inputState.vertexBindingDescriptionCount = static_cast<uint32_t>(listLocalBuffers[i].bindingDescriptions.size());
-		listLocalBuffers[i].inputState.pVertexBindingDescriptions = listLocalBuffers[i].bindingDescriptions.data();
-		listLocalBuffers[i].inputState.vertexAttributeDescriptionCount = static_cast<uint32_t>(listLocalBuffers[i].attributeDescriptions.size());
-		listLocalBuffers[i].inputState.pVertexAttributeDescriptions = listLocalBuffers[i].attributeDescriptions.data();
-
-
-
-		copyCmd = GetCommandBuffer(true);
-		VkBufferObject::SubmitBufferObjects(
-			copyCmd,
-			m_pWRenderer->m_Queue,
-			*m_pWRenderer,
-			static_cast<uint32_t>(sizeof(uint32_t) * indexes.size()),
-			listStagingBuffersIndex[i],
-			listLocalIndexBuffers[i], drawVertFlags::None);
-
-
-		meshSize.push_back(indexes.size());
 	}
+
+	//One vertex and one index buffer for all meshes, vertices stay in MD5Mesh::meshStructure layout
+	md5Model.CreateBuffers(m_pWRenderer->m_SwapChain, m_pWRenderer->m_DeviceMemoryProperties);
+
+	// Binding description
+	md5Model.vertexBuffer.bindingDescriptions.resize(1);
+	md5Model.vertexBuffer.bindingDescriptions[0].binding = 0;
+	md5Model.vertexBuffer.bindingDescriptions[0].stride = sizeof(MD5Mesh::meshStructure);
+	md5Model.vertexBuffer.bindingDescriptions[0].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+
+	// Attribute descriptions
+	// Describes memory layout and shader attribute locations
+	md5Model.vertexBuffer.attributeDescriptions.resize(9);
+
+	// Location 0 : Position
+	md5Model.vertexBuffer.attributeDescriptions[0].binding = 0;
+	md5Model.vertexBuffer.attributeDescriptions[0].location = 0;
+	md5Model.vertexBuffer.attributeDescriptions[0].format = VK_FORMAT_R32G32B32_SFLOAT;
+	md5Model.vertexBuffer.attributeDescriptions[0].offset = offsetof(MD5Mesh::meshStructure, vertex);
+
+	// Location 1 : Normal
+	md5Model.vertexBuffer.attributeDescriptions[1].binding = 0;
+	md5Model.vertexBuffer.attributeDescriptions[1].location = 1;
+	md5Model.vertexBuffer.attributeDescriptions[1].format = VK_FORMAT_R32G32B32_SFLOAT;
+	md5Model.vertexBuffer.attributeDescriptions[1].offset = offsetof(MD5Mesh::meshStructure, normal);
+
+	// Location 2 : Tangent
+	md5Model.vertexBuffer.attributeDescriptions[2].binding = 0;
+	md5Model.vertexBuffer.attributeDescriptions[2].location = 2;
+	md5Model.vertexBuffer.attributeDescriptions[2].format = VK_FORMAT_R32G32B32_SFLOAT;
+	md5Model.vertexBuffer.attributeDescriptions[2].offset = offsetof(MD5Mesh::meshStructure, tangent);
+
+	// Location 3 : Binormal
+	md5Model.vertexBuffer.attributeDescriptions[3].binding = 0;
+	md5Model.vertexBuffer.attributeDescriptions[3].location = 3;
+	md5Model.vertexBuffer.attributeDescriptions[3].format = VK_FORMAT_R32G32B32_SFLOAT;
+	md5Model.vertexBuffer.attributeDescriptions[3].offset = offsetof(MD5Mesh::meshStructure, binormal);
+
+	// Location 4 : Uv
+	md5Model.vertexBuffer.attributeDescriptions[4].binding = 0;
+	md5Model.vertexBuffer.attributeDescriptions[4].location = 4;
+	md5Model.vertexBuffer.attributeDescriptions[4].format = VK_FORMAT_R32G32_SFLOAT;
+	md5Model.vertexBuffer.attributeDescriptions[4].offset = offsetof(MD5Mesh::meshStructure, tex);
+
+	// Location 5 : BoneWeight 1
+	md5Model.vertexBuffer.attributeDescriptions[5].binding = 0;
+	md5Model.vertexBuffer.attributeDescriptions[5].location = 5;
+	md5Model.vertexBuffer.attributeDescriptions[5].format = VK_FORMAT_R32G32B32A32_SFLOAT;
+	md5Model.vertexBuffer.attributeDescriptions[5].offset = offsetof(MD5Mesh::meshStructure, boneWeight1);
+
+	// Location 6 : BoneWeight 2
+	md5Model.vertexBuffer.attributeDescriptions[6].binding = 0;
+	md5Model.vertexBuffer.attributeDescriptions[6].location = 6;
+	md5Model.vertexBuffer.attributeDescriptions[6].format = VK_FORMAT_R32G32B32A32_SFLOAT;
+	md5Model.vertexBuffer.attributeDescriptions[6].offset = offsetof(MD5Mesh::meshStructure, boneWeight2);
+
+	// Location 7 : jointId 1
+	md5Model.vertexBuffer.attributeDescriptions[7].binding = 0;
+	md5Model.vertexBuffer.attributeDescriptions[7].location = 7;
+	md5Model.vertexBuffer.attributeDescriptions[7].format = VK_FORMAT_R32G32B32A32_SINT;
+	md5Model.vertexBuffer.attributeDescriptions[7].offset = offsetof(MD5Mesh::meshStructure, boneId1);
+
+	// Location 8 : jointId 2
+	md5Model.vertexBuffer.attributeDescriptions[8].binding = 0;
+	md5Model.vertexBuffer.attributeDescriptions[8].location = 8;
+	md5Model.vertexBuffer.attributeDescriptions[8].format = VK_FORMAT_R32G32B32A32_SINT;
+	md5Model.vertexBuffer.attributeDescriptions[8].offset = offsetof(MD5Mesh::meshStructure, boneId2);
+
+	// Assign to vertex input state
+	md5Model.vertexBuffer.inputState.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+	md5Model.vertexBuffer.inputState.pNext = NULL;
+	md5Model.vertexBuffer.inputState.flags = VK_FLAGS_NONE;
+	md5Model.vertexBuffer.inputState.vertexBindingDescriptionCount = static_cast<uint32_t>(md5Model.vertexBuffer.bindingDescriptions.size());
+	md5Model.vertexBuffer.inputState.pVertexBindingDescriptions = md5Model.vertexBuffer.bindingDescriptions.data();
+	md5Model.vertexBuffer.inputState.vertexAttributeDescriptionCount = static_cast<uint32_t>(md5Model.vertexBuffer.attributeDescriptions.size());
+	md5Model.vertexBuffer.inputState.pVertexAttributeDescriptions = md5Model.vertexBuffer.attributeDescriptions.data();
 }
 
 
@@ -890,7 +695,7 @@ void Renderer::PreparePipeline()
 	// Create Pipeline state VI-IA-VS-VP-RS-FS-CB
 	pipelineCreateInfo.stageCount = static_cast<uint32_t>(shaderStages.size());
 	pipelineCreateInfo.pStages = shaderStages.data();
-	pipelineCreateInfo.pVertexInputState = &listLocalBuffers[0].inputState;
+	pipelineCreateInfo.pVertexInputState = &md5Model.vertexBuffer.inputState;
 	pipelineCreateInfo.pInputAssemblyState = &inputAssemblyState;
 	pipelineCreateInfo.pRasterizationState = &rasterizationState;
 	pipelineCreateInfo.pColorBlendState = &colorBlendState;
@@ -916,8 +721,8 @@ void Renderer::SetupDescriptorSetLayout()
 {
 	std::vector<VkDescriptorSetLayoutBinding> setLayoutBindings =
 	{
-		// Binding 0 : Vertex shader uniform buffer
-		VkTools::Initializer::DescriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,VK_SHADER_STAGE_VERTEX_BIT,0),
+		// Binding 0 : Vertex shader uniform buffer, dynamic offset into vertexCache uniform memory
+		VkTools::Initializer::DescriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,VK_SHADER_STAGE_VERTEX_BIT,0),
 
 		// Binding 1 : Fragment shader image sampler
 		VkTools::Initializer::DescriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,VK_SHADER_STAGE_FRAGMENT_BIT,1),
@@ -935,7 +740,7 @@ void Renderer::SetupDescriptorPool()
 	// Example uses one ubo and one image sampler
 	std::vector<VkDescriptorPoolSize> poolSizes =
 	{
-		VkTools::Initializer::DescriptorPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 7),
+		VkTools::Initializer::DescriptorPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 7),
 		VkTools::Initializer::DescriptorPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 7*2)
 	};
 
@@ -993,6 +798,9 @@ int main()
 	{
 		if (!GenerateEvents(msg))break;
 
+		//Fixed time step while benchmarking
+		g_Renderer.UpdateBenchmark(nullptr);
+
 		auto tStart = std::chrono::high_resolution_clock::now();
 		g_Renderer.StartFrame();
 		g_Renderer.UpdateUniformBuffers();
@@ -1178,6 +986,18 @@ LRESULT CALLBACK HandleWindowMessages(HWND hWnd, UINT uMsg, WPARAM wParam, LPARA
 
 bool GenerateEvents(MSG& msg)
 {
+	//Benchmark ends with its camera path, the report is written by then
+	if (g_Renderer.IsBenchmarkFinished())
+	{
+		return false;
+	}
+
+	//No window to pump messages for, the run ends after its frame count
+	if (g_Renderer.IsHeadless())
+	{
+		return !g_Renderer.IsHeadlessFinished();
+	}
+
 	if (PeekMessage(&msg, NULL, 0, 0, PM_REMOVE))
 	{
 		if (msg.message == WM_QUIT)
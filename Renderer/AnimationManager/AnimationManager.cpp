@@ -3,10 +3,10 @@
 *	GitHub repository - https://github.com/TywyllSoftware/TywRenderer
 *	This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
 */
-#include <RendererPch\stdafx.h>
-#include "Geometry\JointTransform.h"
+#include <RendererPch/stdafx.h>
+#include "Geometry/JointTransform.h"
 
-#include "MD5Anim\MD5Anim.h"
+#include "MD5Anim/MD5Anim.h"
 #include "AnimationManager.h"
 
 
@@ -3,16 +3,19 @@
 *	GitHub repository - https://github.com/TywyllSoftware/TywRenderer
 *	This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
 */
-#include <RendererPch\stdafx.h>
+#include <RendererPch/stdafx.h>
 
 
-#include "Geometry\JointTransform.h"
-#include "AnimationManager\AnimationMacro.h"
+#include "Geometry/JointTransform.h"
+#include "AnimationManager/AnimationMacro.h"
 
 #include "MD5Anim.h"
 #include <iostream>
 
-#include <External\glm\glm\gtx\compatibility.hpp>
+#include <External/glm/glm/gtx/compatibility.hpp>
+
+//Profiler Includes
+#include "Profiler/CpuProfiler.h"
 
 
 
@@ -64,6 +67,7 @@ int inline MD5Anim::GetAnimLength() const
 bool	MD5Anim::LoadAnim(std::string fileName, std::string filePath)
 //=============================================================================
 {
+	TYW_PROFILE_FUNCTION();
 	std::string fileStr(filePath + fileName);
 	std::fstream file(fileStr.c_str());
 
@@ -373,6 +377,7 @@ int MD5Anim::DecodeInterpolatedFrames(std::vector<JointQuat>& joints, std::vecto
 	const float * frame1, const float * frame2, const std::vector<jointAnimInfo_t> & jointInfo, const int * index, const int numIndexes)
 //===============================================================================================================================
 {
+	TYW_PROFILE_FUNCTION();
 	int numLerpJoints = 0;
 	for (int i = 0; i < numIndexes; i++)
 	{
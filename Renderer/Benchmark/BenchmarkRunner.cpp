@@ -0,0 +1,266 @@
+/*
+*	Copyright 2015-2016 Tomas Mikalauskas. All rights reserved.
+*	GitHub repository - https://github.com/TywyllSoftware/TywRenderer
+*	This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+#include <RendererPch/stdafx.h>
+
+//Benchmark Includes
+#include "BenchmarkRunner.h"
+
+//Renderer Includes
+#include <Renderer/Camera.h>
+
+
+static const float		BENCHMARK_DEFAULT_TIMESTEP = 1.0f / 60.0f;
+static const uint32_t	BENCHMARK_DEFAULT_WARMUP = 60;
+
+
+static double ElapsedMilliSec(std::chrono::high_resolution_clock::time_point start, std::chrono::high_resolution_clock::time_point end)
+{
+	return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+
+BenchmarkRunner::BenchmarkRunner():
+	m_TimeStep(BENCHMARK_DEFAULT_TIMESTEP),
+	m_WarmupFrames(BENCHMARK_DEFAULT_WARMUP),
+	m_NumFrames(0),
+	m_FrameNum(0),
+	m_FirstGpuFrameNum(UINT64_MAX),
+	m_LastGpuFrameNum(UINT64_MAX)
+{
+	memset(&m_MemoryPeaks, 0, sizeof(m_MemoryPeaks));
+}
+
+
+bool BenchmarkRunner::Load(const std::string& fileName)
+{
+	FILE* pFile = fopen(fileName.c_str(), "r");
+	if (!pFile)
+	{
+		printf("Could not open benchmark file %s\n", fileName.c_str());
+		return false;
+	}
+
+	char line[256];
+	uint32_t lineNum = 0;
+	while (fgets(line, sizeof(line), pFile))
+	{
+		lineNum++;
+
+		char entry[32];
+		if (sscanf(line, " %31s", entry) != 1 || entry[0] == '#')
+		{
+			continue;
+		}
+
+		CameraKey key;
+		if (strcmp(entry, "timestep") == 0 && sscanf(line, " %*s %f", &m_TimeStep) == 1 && m_TimeStep > 0.0f)
+		{
+			continue;
+		}
+		if (strcmp(entry, "warmup") == 0 && sscanf(line, " %*s %u", &m_WarmupFrames) == 1)
+		{
+			continue;
+		}
+		if (strcmp(entry, "key") == 0 && sscanf(line, " %*s %f %f %f %f %f %f %f", &key.time,
+			&key.position.x, &key.position.y, &key.position.z, &key.rotation.x, &key.rotation.y, &key.rotation.z) == 7)
+		{
+			m_Path.AddKey(key);
+			continue;
+		}
+
+		printf("%s(%u): unknown benchmark entry %s", fileName.c_str(), lineNum, line);
+	}
+	fclose(pFile);
+
+	if (m_Path.IsEmpty())
+	{
+		printf("Benchmark file %s has no camera keys\n", fileName.c_str());
+		return false;
+	}
+
+	m_FileName = fileName;
+	m_NumFrames = static_cast<uint32_t>(m_Path.GetDuration() / m_TimeStep) + 1;
+	m_CpuFrameMilliSec.reserve(m_NumFrames);
+	m_GpuFrameMilliSec.reserve(m_NumFrames);
+	return true;
+}
+
+
+bool BenchmarkRunner::BeginFrame(Camera* pCamera)
+{
+	if (!pCamera || IsFinished())
+	{
+		return false;
+	}
+
+	//Warm up frames stay at the first key
+	const uint32_t pathFrame = IsMeasuring() ? m_FrameNum - m_WarmupFrames : 0;
+
+	glm::vec3 position;
+	glm::vec3 rotation;
+	m_Path.Evaluate(static_cast<float>(pathFrame) * m_TimeStep, position, rotation);
+	pCamera->setTranslation(position);
+	pCamera->setRotation(rotation);
+	return true;
+}
+
+
+void BenchmarkRunner::EndFrame(const VulkanFrameStats& frameStats, const std::vector<VulkanGpuScopeResult>& passes, const VulkanMemoryStats& memoryStats)
+{
+	if (IsFinished())
+	{
+		return;
+	}
+
+	//Wall time between two EndFrame calls, everything the sample does in a frame
+	const auto now = std::chrono::high_resolution_clock::now();
+	if (IsMeasuring() && m_FrameNum > 0)
+	{
+		m_CpuFrameMilliSec.push_back(ElapsedMilliSec(m_LastFrameEnd, now));
+	}
+	m_LastFrameEnd = now;
+
+	//GPU times arrive frames in flight later, frame manager numbers tell which frame they belong to
+	if (m_FirstGpuFrameNum == UINT64_MAX)
+	{
+		m_FirstGpuFrameNum = frameStats.frameNum - 1 + m_WarmupFrames;
+	}
+	if (frameStats.bGpuTimeValid && frameStats.gpuFrameNum != m_LastGpuFrameNum && frameStats.gpuFrameNum >= m_FirstGpuFrameNum)
+	{
+		m_GpuFrameMilliSec.push_back(static_cast<double>(frameStats.gpuMicroSec) / 1000.0);
+	}
+	m_LastGpuFrameNum = frameStats.gpuFrameNum;
+
+	//A pass has a new sample whenever its resolved count moved
+	for (const auto& pass : passes)
+	{
+		auto it = m_PassIndices.find(pass.name);
+		if (it == m_PassIndices.end())
+		{
+			it = m_PassIndices.emplace(pass.name, static_cast<uint32_t>(m_Passes.size())).first;
+			m_Passes.push_back(PassSamples{ pass.name, pass.depth, 0, std::vector<double>() });
+		}
+
+		PassSamples& samples = m_Passes[it->second];
+		if (pass.numSamples != samples.lastNumSamples && IsMeasuring())
+		{
+			samples.milliSec.push_back(pass.gpuMilliSec);
+		}
+		samples.lastNumSamples = pass.numSamples;
+	}
+
+	//Loading and warm up count as well, assets stay resident for the whole run
+	m_MemoryPeaks.numDeviceAllocations = std::max(m_MemoryPeaks.numDeviceAllocations, memoryStats.numDeviceAllocations);
+	m_MemoryPeaks.numAllocations = std::max(m_MemoryPeaks.numAllocations, memoryStats.numAllocations);
+	m_MemoryPeaks.deviceBytes = std::max(m_MemoryPeaks.deviceBytes, memoryStats.blockBytes + memoryStats.dedicatedBytes);
+	m_MemoryPeaks.usedBytes = std::max(m_MemoryPeaks.usedBytes, memoryStats.usedBytes + memoryStats.dedicatedBytes);
+	m_MemoryPeaks.numHeaps = memoryStats.numHeaps;
+	for (uint32_t i = 0; i < memoryStats.numHeaps; i++)
+	{
+		m_MemoryPeaks.heapUsage[i] = std::max(m_MemoryPeaks.heapUsage[i], memoryStats.heaps[i].usage);
+	}
+
+	m_FrameNum++;
+}
+
+
+BenchmarkPercentiles BenchmarkRunner::ComputePercentiles(const std::vector<double>& samples)
+{
+	BenchmarkPercentiles result;
+	memset(&result, 0, sizeof(result));
+	if (samples.empty())
+	{
+		return result;
+	}
+
+	std::vector<double> sorted(samples);
+	std::sort(sorted.begin(), sorted.end());
+
+	//Nearest rank, p99 of 100 frames is the 99th slowest frame and not an interpolation
+	auto rank = [&sorted](double percentile)
+	{
+		const size_t index = static_cast<size_t>(std::ceil(percentile / 100.0 * sorted.size()));
+		return sorted[std::max<size_t>(index, 1) - 1];
+	};
+
+	double sum = 0.0;
+	for (double sample : sorted)
+	{
+		sum += sample;
+	}
+
+	result.numSamples = static_cast<uint32_t>(sorted.size());
+	result.minMilliSec = sorted.front();
+	result.avgMilliSec = sum / sorted.size();
+	result.p50MilliSec = rank(50.0);
+	result.p95MilliSec = rank(95.0);
+	result.p99MilliSec = rank(99.0);
+	result.maxMilliSec = sorted.back();
+	return result;
+}
+
+
+static void WritePercentiles(FILE* pFile, const BenchmarkPercentiles& percentiles)
+{
+	if (percentiles.numSamples == 0)
+	{
+		fprintf(pFile, "null");
+		return;
+	}
+
+	fprintf(pFile, "{\"samples\":%u,\"min\":%.4f,\"avg\":%.4f,\"p50\":%.4f,\"p95\":%.4f,\"p99\":%.4f,\"max\":%.4f}",
+		percentiles.numSamples, percentiles.minMilliSec, percentiles.avgMilliSec, percentiles.p50MilliSec,
+		percentiles.p95MilliSec, percentiles.p99MilliSec, percentiles.maxMilliSec);
+}
+
+
+bool BenchmarkRunner::WriteReport(const std::string& fileName, const VkPhysicalDeviceProperties& deviceProperties, uint32_t width, uint32_t height) const
+{
+	FILE* pFile = fopen(fileName.c_str(), "w");
+	if (!pFile)
+	{
+		printf("Could not write benchmark report %s\n", fileName.c_str());
+		return false;
+	}
+
+	//Forward slashes keep windows paths valid JSON strings without escaping
+	std::string benchmarkFile = m_FileName;
+	std::replace(benchmarkFile.begin(), benchmarkFile.end(), '\\', '/');
+
+	fprintf(pFile, "{\n");
+	fprintf(pFile, "\"benchmark\":\"%s\",\n", benchmarkFile.c_str());
+	fprintf(pFile, "\"device\":\"%s\",\n", deviceProperties.deviceName);
+	fprintf(pFile, "\"driverVersion\":%u,\n", deviceProperties.driverVersion);
+	fprintf(pFile, "\"width\":%u,\n\"height\":%u,\n", width, height);
+	fprintf(pFile, "\"timestep\":%.6f,\n\"warmupFrames\":%u,\n\"frames\":%u,\n", m_TimeStep, m_WarmupFrames, m_NumFrames);
+
+	fprintf(pFile, "\"cpuFrameMs\":");
+	WritePercentiles(pFile, GetCpuFrameTimes());
+	fprintf(pFile, ",\n\"gpuFrameMs\":");
+	WritePercentiles(pFile, GetGpuFrameTimes());
+
+	fprintf(pFile, ",\n\"passes\":[");
+	for (size_t i = 0; i < m_Passes.size(); i++)
+	{
+		fprintf(pFile, "%s\n\t{\"name\":\"%s\",\"depth\":%u,\"gpuMs\":", (i > 0) ? "," : "", m_Passes[i].name.c_str(), m_Passes[i].depth);
+		WritePercentiles(pFile, ComputePercentiles(m_Passes[i].milliSec));
+		fprintf(pFile, "}");
+	}
+	fprintf(pFile, "\n],\n");
+
+	fprintf(pFile, "\"memoryPeak\":{\"deviceAllocations\":%u,\"allocations\":%u,\"deviceBytes\":%llu,\"usedBytes\":%llu,\"heapBytes\":[",
+		m_MemoryPeaks.numDeviceAllocations, m_MemoryPeaks.numAllocations,
+		static_cast<unsigned long long>(m_MemoryPeaks.deviceBytes), static_cast<unsigned long long>(m_MemoryPeaks.usedBytes));
+	for (uint32_t i = 0; i < m_MemoryPeaks.numHeaps; i++)
+	{
+		fprintf(pFile, "%s%llu", (i > 0) ? "," : "", static_cast<unsigned long long>(m_MemoryPeaks.heapUsage[i]));
+	}
+	fprintf(pFile, "]}\n}\n");
+
+	const bool bWritten = !ferror(pFile);
+	fclose(pFile);
+	return bWritten;
+}
@@ -0,0 +1,138 @@
+/*
+*	Copyright 2015-2016 Tomas Mikalauskas. All rights reserved.
+*	GitHub repository - https://github.com/TywyllSoftware/TywRenderer
+*	This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+#pragma once
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <chrono>
+#include <External/vulkan/vulkan.h>
+
+//Benchmark Includes
+#include "CameraPath.h"
+
+//Vulkan Includes
+#include "Vulkan/VulkanFrameManager.h"
+#include "Vulkan/VulkanGpuProfiler.h"
+#include "Vulkan/VulkanMemoryAllocator.h"
+
+
+class Camera;
+
+
+struct BenchmarkPercentiles
+{
+	uint32_t		numSamples;
+	double			minMilliSec;
+	double			avgMilliSec;
+	double			p50MilliSec;
+	double			p95MilliSec;
+	double			p99MilliSec;
+	double			maxMilliSec;
+};
+
+
+struct BenchmarkMemoryPeaks
+{
+	uint32_t		numDeviceAllocations;
+	uint32_t		numAllocations;
+	VkDeviceSize	deviceBytes;			// blocks and dedicated allocations
+	VkDeviceSize	usedBytes;				// sub-allocated and dedicated
+	uint32_t		numHeaps;
+	VkDeviceSize	heapUsage[VK_MAX_MEMORY_HEAPS];
+};
+
+
+/*
+	BenchmarkRunner
+	Replays a recorded camera path with a fixed time step, so every run renders
+	the same frame sequence. Frames after the warm up are measured, the report
+	has frame time percentiles, per pass GPU timings and memory high-water marks.
+
+	Benchmark file, one entry per line, # starts a comment:
+		timestep <seconds>			default 1/60
+		warmup <frames>				default 60, rendered at the first key and not measured
+		key <time> <px> <py> <pz> <rx> <ry> <rz>	camera position and euler rotation in degrees
+*/
+class BenchmarkRunner
+{
+public:
+	BenchmarkRunner();
+
+	/*
+		@param: const std::string& fileName
+		@return: bool - false if the file could not be read or has no keys
+	*/
+	bool Load(const std::string& fileName);
+
+	/*
+		Moves the camera to the path position of the current frame
+
+		@param: Camera* pCamera - nullptr for samples without a camera
+		@return: bool - true if the camera was moved
+	*/
+	bool BeginFrame(Camera* pCamera);
+
+	/*
+		Call once per frame, after the GPU profiler was updated
+
+		@param: const VulkanFrameStats& frameStats
+		@param: const std::vector<VulkanGpuScopeResult>& passes
+		@param: const VulkanMemoryStats& memoryStats
+	*/
+	void EndFrame(const VulkanFrameStats& frameStats, const std::vector<VulkanGpuScopeResult>& passes, const VulkanMemoryStats& memoryStats);
+
+	/*
+		@param: const std::string& fileName
+		@param: const VkPhysicalDeviceProperties& deviceProperties
+		@param: uint32_t width
+		@param: uint32_t height
+		@return: bool - false if the file could not be written
+	*/
+	bool WriteReport(const std::string& fileName, const VkPhysicalDeviceProperties& deviceProperties, uint32_t width, uint32_t height) const;
+
+	// Time step samples use instead of the measured frame time
+	float GetTimeStep() const { return m_TimeStep; }
+
+	bool IsFinished() const { return m_FrameNum >= m_WarmupFrames + m_NumFrames; }
+
+	BenchmarkPercentiles GetCpuFrameTimes() const { return ComputePercentiles(m_CpuFrameMilliSec); }
+	BenchmarkPercentiles GetGpuFrameTimes() const { return ComputePercentiles(m_GpuFrameMilliSec); }
+	const BenchmarkMemoryPeaks& GetMemoryPeaks() const { return m_MemoryPeaks; }
+
+private:
+	BenchmarkRunner(const BenchmarkRunner&) = delete;
+	BenchmarkRunner& operator=(const BenchmarkRunner&) = delete;
+
+	struct PassSamples
+	{
+		std::string				name;
+		uint32_t				depth;
+		uint64_t				lastNumSamples;
+		std::vector<double>		milliSec;
+	};
+
+	static BenchmarkPercentiles ComputePercentiles(const std::vector<double>& samples);
+
+	bool IsMeasuring() const { return m_FrameNum >= m_WarmupFrames; }
+
+private:
+	std::string						m_FileName;
+	CameraPath						m_Path;
+	float							m_TimeStep;
+	uint32_t						m_WarmupFrames;
+	uint32_t						m_NumFrames;		// measured frames, the whole path
+	uint32_t						m_FrameNum;			// frames rendered so far, warm up included
+
+	std::chrono::high_resolution_clock::time_point	m_LastFrameEnd;
+	uint64_t						m_FirstGpuFrameNum;	// frame manager number of the first measured frame
+	uint64_t						m_LastGpuFrameNum;
+
+	std::vector<double>				m_CpuFrameMilliSec;
+	std::vector<double>				m_GpuFrameMilliSec;
+	std::vector<PassSamples>		m_Passes;			// in order of first appearance
+	std::unordered_map<std::string, uint32_t>	m_PassIndices;
+	BenchmarkMemoryPeaks			m_MemoryPeaks;
+};
@@ -0,0 +1,59 @@
+/*
+*	Copyright 2015-2016 Tomas Mikalauskas. All rights reserved.
+*	GitHub repository - https://github.com/TywyllSoftware/TywRenderer
+*	This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+#include <RendererPch/stdafx.h>
+
+//Benchmark Includes
+#include "CameraPath.h"
+
+
+static glm::vec3 CatmullRom(const glm::vec3& p0, const glm::vec3& p1, const glm::vec3& p2, const glm::vec3& p3, float t)
+{
+	const float t2 = t * t;
+	const float t3 = t2 * t;
+	return 0.5f * ((2.0f * p1) + (p2 - p0) * t + (2.0f * p0 - 5.0f * p1 + 4.0f * p2 - p3) * t2 + (3.0f * p1 - p0 - 3.0f * p2 + p3) * t3);
+}
+
+
+void CameraPath::AddKey(const CameraKey& key)
+{
+	auto it = std::upper_bound(m_Keys.begin(), m_Keys.end(), key.time, [](float time, const CameraKey& other) { return time < other.time; });
+	m_Keys.insert(it, key);
+}
+
+
+void CameraPath::Evaluate(float time, glm::vec3& position, glm::vec3& rotation) const
+{
+	if (m_Keys.empty())
+	{
+		return;
+	}
+
+	time += m_Keys.front().time;
+	if (time <= m_Keys.front().time || m_Keys.size() == 1)
+	{
+		position = m_Keys.front().position;
+		rotation = m_Keys.front().rotation;
+		return;
+	}
+	if (time >= m_Keys.back().time)
+	{
+		position = m_Keys.back().position;
+		rotation = m_Keys.back().rotation;
+		return;
+	}
+
+	//Segment p1-p2 that contains time, end points are repeated as their own neighbours
+	const size_t i2 = std::upper_bound(m_Keys.begin(), m_Keys.end(), time, [](float time, const CameraKey& key) { return time < key.time; }) - m_Keys.begin();
+	const size_t i1 = i2 - 1;
+	const size_t i0 = (i1 > 0) ? i1 - 1 : i1;
+	const size_t i3 = std::min(i2 + 1, m_Keys.size() - 1);
+
+	const float segment = m_Keys[i2].time - m_Keys[i1].time;
+	const float t = (segment > 0.0f) ? (time - m_Keys[i1].time) / segment : 0.0f;
+
+	position = CatmullRom(m_Keys[i0].position, m_Keys[i1].position, m_Keys[i2].position, m_Keys[i3].position, t);
+	rotation = CatmullRom(m_Keys[i0].rotation, m_Keys[i1].rotation, m_Keys[i2].rotation, m_Keys[i3].rotation, t);
+}
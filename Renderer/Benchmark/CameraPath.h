@@ -0,0 +1,50 @@
+/*
+*	Copyright 2015-2016 Tomas Mikalauskas. All rights reserved.
+*	GitHub repository - https://github.com/TywyllSoftware/TywRenderer
+*	This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+#pragma once
+#include <vector>
+
+
+struct CameraKey
+{
+	float			time;		// seconds from the start of the path
+	glm::vec3		position;
+	glm::vec3		rotation;	// euler angles in degrees, same as Camera::rotation
+};
+
+
+/*
+	CameraPath
+	Catmull-Rom spline through camera keyframes. Keys are sorted by time,
+	before the first and after the last key the path holds still.
+*/
+class CameraPath
+{
+public:
+	CameraPath() {}
+
+	/*
+		@param: const CameraKey& key
+	*/
+	void AddKey(const CameraKey& key);
+
+	/*
+		@param: float time - seconds since the first key
+		@param: glm::vec3& position
+		@param: glm::vec3& rotation
+	*/
+	void Evaluate(float time, glm::vec3& position, glm::vec3& rotation) const;
+
+	float GetDuration() const { return m_Keys.empty() ? 0.0f : m_Keys.back().time - m_Keys.front().time; }
+
+	bool IsEmpty() const { return m_Keys.empty(); }
+
+private:
+	CameraPath(const CameraPath&) = delete;
+	CameraPath& operator=(const CameraPath&) = delete;
+
+private:
+	std::vector<CameraKey>	m_Keys;
+};
@@ -1,5 +1,5 @@
 
-#include <RendererPch\stdafx.h>
+#include <RendererPch/stdafx.h>
 #include "Camera.h"
 
 
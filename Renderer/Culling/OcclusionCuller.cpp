@@ -0,0 +1,346 @@
+/*
+*	Copyright 2015-2016 Tomas Mikalauskas. All rights reserved.
+*	GitHub repository - https://github.com/TywyllSoftware/TywRenderer
+*	This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+#include <RendererPch/stdafx.h>
+
+//Renderer Includes
+#include <Renderer/Geometry/VertData.h>
+
+//JobSystem Includes
+#include <Renderer/JobSystem/JobSystem.h>
+
+//Culling Includes
+#include "OcclusionCuller.h"
+
+//Profiler Includes
+#include <Renderer/Profiler/CpuProfiler.h>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE__)
+#define OCCLUSION_SSE
+#include <xmmintrin.h>
+#endif
+
+
+static const uint32_t TILE_WIDTH = 8;
+static const uint32_t TILE_HEIGHT = 4;
+static const uint32_t TILE_FULL_MASK = 0xFFFFFFFFu;
+
+//Vertices closer than this are treated as crossing the near plane
+static const float NEAR_CLIP_W = 1e-5f;
+
+//Occludee depth is pulled this much (relative to depth) towards the camera. A surface that is
+//also an occluder covers tiles with its own depth, which must not hide it after rounding
+static const float OCCLUDEE_DEPTH_BIAS = 1e-5f;
+
+//Occluder vertices are transformed on the job system in batches of at least this size
+static const uint32_t TRANSFORM_VERTS_PER_JOB = 2048;
+
+
+OcclusionCuller::OcclusionCuller(uint32_t width, uint32_t height)
+{
+	m_TilesX = std::max(1u, (width + TILE_WIDTH - 1) / TILE_WIDTH);
+	m_TilesY = std::max(1u, (height + TILE_HEIGHT - 1) / TILE_HEIGHT);
+	m_Width = m_TilesX * TILE_WIDTH;
+	m_Height = m_TilesY * TILE_HEIGHT;
+
+	const size_t numTiles = m_TilesX * m_TilesY;
+	m_TileZMax0.resize(numTiles, FLT_MAX);
+	m_TileZMax1.resize(numTiles, -FLT_MAX);
+	m_TileMask.resize(numTiles, 0);
+
+	memset(&m_Stats, 0, sizeof(m_Stats));
+}
+
+
+void OcclusionCuller::BeginFrame(const glm::mat4x4& viewProjection)
+{
+	TYW_PROFILE_FUNCTION();
+	m_ViewProjection = viewProjection;
+
+	std::fill(m_TileZMax0.begin(), m_TileZMax0.end(), FLT_MAX);
+	std::fill(m_TileZMax1.begin(), m_TileZMax1.end(), -FLT_MAX);
+	std::fill(m_TileMask.begin(), m_TileMask.end(), 0);
+
+	memset(&m_Stats, 0, sizeof(m_Stats));
+}
+
+
+void OcclusionCuller::RenderOccluder(const drawVert* verts, uint32_t numVerts, const uint32_t* indexes, uint32_t numIndexes, const glm::mat4x4& world)
+{
+	TYW_PROFILE_FUNCTION();
+	auto tStart = std::chrono::high_resolution_clock::now();
+
+	const glm::mat4x4 mvp = m_ViewProjection * world;
+	m_ClipVerts.resize(numVerts);
+	ParallelFor(numVerts, TRANSFORM_VERTS_PER_JOB, [&](uint32_t first, uint32_t last)
+	{
+		for (uint32_t i = first; i < last; i++)
+		{
+			m_ClipVerts[i] = mvp * glm::vec4(verts[i].vertex, 1.0f);
+		}
+	});
+
+	const uint32_t count = indexes ? numIndexes : numVerts;
+	for (uint32_t i = 0; i + 2 < count; i += 3)
+	{
+		if (indexes)
+		{
+			RasterizeTriangle(m_ClipVerts[indexes[i]], m_ClipVerts[indexes[i + 1]], m_ClipVerts[indexes[i + 2]]);
+		}
+		else
+		{
+			RasterizeTriangle(m_ClipVerts[i], m_ClipVerts[i + 1], m_ClipVerts[i + 2]);
+		}
+	}
+	m_Stats.numOccluderTriangles += count / 3;
+
+	auto tEnd = std::chrono::high_resolution_clock::now();
+	m_Stats.rasterMilliSec += std::chrono::duration<double, std::milli>(tEnd - tStart).count();
+}
+
+
+void OcclusionCuller::RasterizeTriangle(const glm::vec4& v0, const glm::vec4& v1, const glm::vec4& v2)
+{
+	if (v0.w <= NEAR_CLIP_W || v1.w <= NEAR_CLIP_W || v2.w <= NEAR_CLIP_W)
+		return;
+
+	//Screen space
+	const float halfW = 0.5f * m_Width;
+	const float halfH = 0.5f * m_Height;
+	float x[3] = { (v0.x / v0.w + 1.0f) * halfW, (v1.x / v1.w + 1.0f) * halfW, (v2.x / v2.w + 1.0f) * halfW };
+	float y[3] = { (v0.y / v0.w + 1.0f) * halfH, (v1.y / v1.w + 1.0f) * halfH, (v2.y / v2.w + 1.0f) * halfH };
+	const float triangleMaxZ = std::max(v0.z / v0.w, std::max(v1.z / v1.w, v2.z / v2.w));
+
+	//Make winding counter clockwise so inside is where all edge functions are positive
+	const float area = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+	if (std::fabs(area) < 1e-8f)
+		return;
+	if (area < 0.0f)
+	{
+		std::swap(x[1], x[2]);
+		std::swap(y[1], y[2]);
+	}
+
+	//Pixel bounds. Pixel centers are at +0.5
+	const float minX = std::min(x[0], std::min(x[1], x[2]));
+	const float maxX = std::max(x[0], std::max(x[1], x[2]));
+	const float minY = std::min(y[0], std::min(y[1], y[2]));
+	const float maxY = std::max(y[0], std::max(y[1], y[2]));
+	if (maxX < 0.0f || maxY < 0.0f || minX >= m_Width || minY >= m_Height)
+		return;
+
+	const uint32_t pixelX0 = static_cast<uint32_t>(std::max(0.0f, minX));
+	const uint32_t pixelY0 = static_cast<uint32_t>(std::max(0.0f, minY));
+	const uint32_t pixelX1 = static_cast<uint32_t>(std::min(static_cast<float>(m_Width - 1), maxX));
+	const uint32_t pixelY1 = static_cast<uint32_t>(std::min(static_cast<float>(m_Height - 1), maxY));
+
+	//E(px, py) = A * px + B * py + C for edges 0-1, 1-2, 2-0
+	float edgeA[3], edgeB[3], edgeC[3];
+	for (uint32_t e = 0; e < 3; e++)
+	{
+		const uint32_t a = e;
+		const uint32_t b = (e + 1) % 3;
+		edgeA[e] = y[a] - y[b];
+		edgeB[e] = x[b] - x[a];
+		edgeC[e] = -(edgeA[e] * x[a] + edgeB[e] * y[a]);
+	}
+
+	bool bTouched = false;
+	for (uint32_t tileY = pixelY0 / TILE_HEIGHT; tileY <= pixelY1 / TILE_HEIGHT; tileY++)
+	{
+		for (uint32_t tileX = pixelX0 / TILE_WIDTH; tileX <= pixelX1 / TILE_WIDTH; tileX++)
+		{
+			const uint32_t tileIndex = tileY * m_TilesX + tileX;
+
+			//Tile is already hidden by something nearer
+			if (triangleMaxZ >= m_TileZMax0[tileIndex])
+				continue;
+
+			const uint32_t mask = ComputeTileMask(tileX, tileY, edgeA, edgeB, edgeC);
+			if (mask)
+			{
+				UpdateTile(tileIndex, mask, triangleMaxZ);
+				bTouched = true;
+			}
+		}
+	}
+
+	if (bTouched)
+	{
+		m_Stats.numRasterizedTriangles++;
+	}
+}
+
+
+//
+// OcclusionCuller::ComputeTileMask
+//
+//	Bit (row * 8 + column) is set when pixel center is inside the triangle.
+//
+uint32_t OcclusionCuller::ComputeTileMask(uint32_t tileX, uint32_t tileY, const float edgeA[3], const float edgeB[3], const float edgeC[3]) const
+{
+	const float baseX = static_cast<float>(tileX * TILE_WIDTH) + 0.5f;
+	const float baseY = static_cast<float>(tileY * TILE_HEIGHT) + 0.5f;
+
+	uint32_t mask = 0;
+#ifdef OCCLUSION_SSE
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 columnsLo = _mm_add_ps(_mm_set1_ps(baseX), _mm_set_ps(3.0f, 2.0f, 1.0f, 0.0f));
+	const __m128 columnsHi = _mm_add_ps(columnsLo, _mm_set1_ps(4.0f));
+
+	__m128 stepLo[3], stepHi[3];
+	for (uint32_t e = 0; e < 3; e++)
+	{
+		const __m128 a = _mm_set1_ps(edgeA[e]);
+		stepLo[e] = _mm_mul_ps(a, columnsLo);
+		stepHi[e] = _mm_mul_ps(a, columnsHi);
+	}
+
+	for (uint32_t row = 0; row < TILE_HEIGHT; row++)
+	{
+		const float py = baseY + row;
+		__m128 insideLo = _mm_cmpeq_ps(zero, zero);
+		__m128 insideHi = insideLo;
+		for (uint32_t e = 0; e < 3; e++)
+		{
+			const __m128 rowValue = _mm_set1_ps(edgeB[e] * py + edgeC[e]);
+			insideLo = _mm_and_ps(insideLo, _mm_cmpge_ps(_mm_add_ps(stepLo[e], rowValue), zero));
+			insideHi = _mm_and_ps(insideHi, _mm_cmpge_ps(_mm_add_ps(stepHi[e], rowValue), zero));
+		}
+
+		const uint32_t rowMask = static_cast<uint32_t>(_mm_movemask_ps(insideLo)) | (static_cast<uint32_t>(_mm_movemask_ps(insideHi)) << 4);
+		mask |= rowMask << (row * TILE_WIDTH);
+	}
+#else
+	for (uint32_t row = 0; row < TILE_HEIGHT; row++)
+	{
+		const float py = baseY + row;
+		for (uint32_t column = 0; column < TILE_WIDTH; column++)
+		{
+			const float px = baseX + column;
+			if (edgeA[0] * px + edgeB[0] * py + edgeC[0] >= 0.0f &&
+				edgeA[1] * px + edgeB[1] * py + edgeC[1] >= 0.0f &&
+				edgeA[2] * px + edgeB[2] * py + edgeC[2] >= 0.0f)
+			{
+				mask |= 1u << (row * TILE_WIDTH + column);
+			}
+		}
+	}
+#endif
+	return mask;
+}
+
+
+//
+// OcclusionCuller::UpdateTile
+//
+//	Triangles only add to the working layer. When the working layer covers
+//	the whole tile its farthest depth becomes the occluded depth and the
+//	layer starts over.
+//
+void OcclusionCuller::UpdateTile(uint32_t tileIndex, uint32_t mask, float triangleMaxZ)
+{
+	m_TileMask[tileIndex] |= mask;
+	m_TileZMax1[tileIndex] = std::max(m_TileZMax1[tileIndex], triangleMaxZ);
+
+	if (m_TileMask[tileIndex] == TILE_FULL_MASK)
+	{
+		m_TileZMax0[tileIndex] = std::min(m_TileZMax0[tileIndex], m_TileZMax1[tileIndex]);
+		m_TileZMax1[tileIndex] = -FLT_MAX;
+		m_TileMask[tileIndex] = 0;
+	}
+}
+
+
+bool OcclusionCuller::TestAABB(const glm::vec3& boundsMin, const glm::vec3& boundsMax, const glm::mat4x4& world)
+{
+	auto tStart = std::chrono::high_resolution_clock::now();
+	m_Stats.numOccludeesTested++;
+
+	const glm::mat4x4 mvp = m_ViewProjection * world;
+
+	float minX = FLT_MAX, minY = FLT_MAX, minZ = FLT_MAX;
+	float maxX = -FLT_MAX, maxY = -FLT_MAX;
+	bool bVisible = false;
+	for (uint32_t i = 0; i < 8; i++)
+	{
+		const glm::vec4 corner(
+			(i & 1) ? boundsMax.x : boundsMin.x,
+			(i & 2) ? boundsMax.y : boundsMin.y,
+			(i & 4) ? boundsMax.z : boundsMin.z,
+			1.0f);
+		const glm::vec4 clip = mvp * corner;
+
+		//Box crosses near plane, camera may be inside
+		if (clip.w <= NEAR_CLIP_W)
+		{
+			bVisible = true;
+			break;
+		}
+
+		const float invW = 1.0f / clip.w;
+		minX = std::min(minX, clip.x * invW);
+		maxX = std::max(maxX, clip.x * invW);
+		minY = std::min(minY, clip.y * invW);
+		maxY = std::max(maxY, clip.y * invW);
+		minZ = std::min(minZ, clip.z * invW);
+	}
+
+	if (!bVisible)
+	{
+		//Round outwards so every touched pixel is tested
+		const float halfW = 0.5f * m_Width;
+		const float halfH = 0.5f * m_Height;
+		const int32_t pixelX0 = std::max(0, static_cast<int32_t>(std::floor((minX + 1.0f) * halfW)));
+		const int32_t pixelY0 = std::max(0, static_cast<int32_t>(std::floor((minY + 1.0f) * halfH)));
+		const int32_t pixelX1 = std::min(static_cast<int32_t>(m_Width) - 1, static_cast<int32_t>(std::ceil((maxX + 1.0f) * halfW)) - 1);
+		const int32_t pixelY1 = std::min(static_cast<int32_t>(m_Height) - 1, static_cast<int32_t>(std::ceil((maxY + 1.0f) * halfH)) - 1);
+
+		if (pixelX0 > pixelX1 || pixelY0 > pixelY1)
+		{
+			m_Stats.numOccludeesOutside++;
+			auto tEnd = std::chrono::high_resolution_clock::now();
+			m_Stats.testMilliSec += std::chrono::duration<double, std::milli>(tEnd - tStart).count();
+			return false;
+		}
+
+		const uint32_t tileX0 = pixelX0 / TILE_WIDTH;
+		const uint32_t tileX1 = pixelX1 / TILE_WIDTH;
+		const uint32_t tileY0 = pixelY0 / TILE_HEIGHT;
+		const uint32_t tileY1 = pixelY1 / TILE_HEIGHT;
+
+		//Box touching occluder depth is visible
+		const float testZ = minZ - std::max(1.0f, std::fabs(minZ)) * OCCLUDEE_DEPTH_BIAS;
+		for (uint32_t tileY = tileY0; tileY <= tileY1 && !bVisible; tileY++)
+		{
+			const float* rowDepth = &m_TileZMax0[tileY * m_TilesX];
+			uint32_t tileX = tileX0;
+#ifdef OCCLUSION_SSE
+			const __m128 boxZ = _mm_set1_ps(testZ);
+			for (; tileX + 3 <= tileX1; tileX += 4)
+			{
+				if (_mm_movemask_ps(_mm_cmple_ps(boxZ, _mm_loadu_ps(rowDepth + tileX))))
+				{
+					bVisible = true;
+					break;
+				}
+			}
+#endif
+			for (; tileX <= tileX1 && !bVisible; tileX++)
+			{
+				bVisible = testZ <= rowDepth[tileX];
+			}
+		}
+	}
+
+	if (!bVisible)
+	{
+		m_Stats.numOccludeesCulled++;
+	}
+
+	auto tEnd = std::chrono::high_resolution_clock::now();
+	m_Stats.testMilliSec += std::chrono::duration<double, std::milli>(tEnd - tStart).count();
+	return bVisible;
+}
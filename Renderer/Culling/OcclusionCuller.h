@@ -0,0 +1,118 @@
+/*
+*	Copyright 2015-2016 Tomas Mikalauskas. All rights reserved.
+*	GitHub repository - https://github.com/TywyllSoftware/TywRenderer
+*	This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+#pragma once
+
+
+//forward declaration
+class drawVert;
+
+
+/*
+	Counters of the current frame. Reset by OcclusionCuller::BeginFrame
+*/
+struct OcclusionStats
+{
+	uint32_t	numOccluderTriangles;	// triangles submitted as occluders
+	uint32_t	numRasterizedTriangles;	// triangles that touched at least one tile
+	uint32_t	numOccludeesTested;
+	uint32_t	numOccludeesCulled;		// hidden behind occluders
+	uint32_t	numOccludeesOutside;	// projected outside of the depth buffer
+	double		rasterMilliSec;
+	double		testMilliSec;
+
+	float GetOcclusionRate() const { return numOccludeesTested ? static_cast<float>(numOccludeesCulled) / numOccludeesTested : 0.0f; }
+};
+
+
+/*
+	OcclusionCuller
+	CPU occlusion culling on a low resolution depth buffer. Needs no GPU, so it
+	can run and be tested headless.
+
+	The buffer is split into 8x4 pixel tiles. Each tile stores a coverage mask
+	of 32 bits and two depth values:
+		zMax0 - tile is fully covered by occluders that are nearer than zMax0
+		zMax1 - farthest depth of the partly covered working layer
+	Occluder triangles are rasterized with SSE, four pixels per edge test. Once
+	the working layer covers the whole tile it becomes the new zMax0.
+
+	Occludees are tested as bounding boxes. A box is hidden when its nearest
+	point is strictly farther than zMax0 of every tile its screen rectangle
+	touches, with a small bias so surfaces are never hidden by themselves.
+	The tile grid acts as the coarse level of the hierarchy. Four tiles are
+	tested per SSE compare.
+
+	Depth is clip z / w of the projection passed to BeginFrame. Smaller is nearer.
+*/
+class OcclusionCuller
+{
+public:
+	/*
+		Width is rounded up to a multiple of 8 and height to a multiple of 4
+
+		@param: uint32_t width
+		@param: uint32_t height
+	*/
+	OcclusionCuller(uint32_t width = 256, uint32_t height = 128);
+
+	/*
+		Clears depth buffer and stats
+
+		@param: const glm::mat4x4& viewProjection
+	*/
+	void BeginFrame(const glm::mat4x4& viewProjection);
+
+	/*
+		Rasterizes occluder mesh. Triangles that cross the near plane are skipped,
+		which only makes culling less aggressive.
+
+		@param: const drawVert* verts
+		@param: uint32_t numVerts
+		@param: const uint32_t* indexes - nullptr for non indexed triangle list
+		@param: uint32_t numIndexes
+		@param: const glm::mat4x4& world
+	*/
+	void RenderOccluder(const drawVert* verts, uint32_t numVerts, const uint32_t* indexes, uint32_t numIndexes, const glm::mat4x4& world);
+
+	/*
+		@param: const glm::vec3& boundsMin - local space box
+		@param: const glm::vec3& boundsMax
+		@param: const glm::mat4x4& world
+		@return: true when any part of the box may be visible
+	*/
+	bool TestAABB(const glm::vec3& boundsMin, const glm::vec3& boundsMax, const glm::mat4x4& world);
+
+	const OcclusionStats& GetStats() const { return m_Stats; }
+
+	uint32_t GetWidth() const { return m_Width; }
+	uint32_t GetHeight() const { return m_Height; }
+
+	// Debug access. FLT_MAX means tile is not occluded
+	float GetTileDepth(uint32_t tileX, uint32_t tileY) const { return m_TileZMax0[tileY * m_TilesX + tileX]; }
+
+private:
+	void RasterizeTriangle(const glm::vec4& v0, const glm::vec4& v1, const glm::vec4& v2);
+	uint32_t ComputeTileMask(uint32_t tileX, uint32_t tileY, const float edgeA[3], const float edgeB[3], const float edgeC[3]) const;
+	void UpdateTile(uint32_t tileIndex, uint32_t mask, float triangleMaxZ);
+
+private:
+	uint32_t					m_Width;
+	uint32_t					m_Height;
+	uint32_t					m_TilesX;
+	uint32_t					m_TilesY;
+
+	glm::mat4x4					m_ViewProjection;
+
+	//Tile data split per field so zMax0 of neighbouring tiles can be loaded in one SSE register
+	std::vector<float>			m_TileZMax0;
+	std::vector<float>			m_TileZMax1;
+	std::vector<uint32_t>		m_TileMask;
+
+	//Clip space vertices of the current occluder. Kept between calls to avoid reallocation
+	std::vector<glm::vec4>		m_ClipVerts;
+
+	OcclusionStats				m_Stats;
+};
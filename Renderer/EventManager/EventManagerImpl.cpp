@@ -1,12 +1,26 @@
-#include  <RendererPch\stdafx.h>
+#include  <RendererPch/stdafx.h>
 #include "EventManagerImpl.h"
+#include "EventRecorder.h"
 
+//Profiler Includes
+#include "Profiler/CpuProfiler.h"
 
 
-EventManager::EventManager():
-	m_activeQueue(0)
-{
 
+EventManager::EventManager(uint32_t realtimeQueueSize):
+	m_activeQueue(0),
+	m_dispatchDepth(0),
+	m_bRemovedDuringDispatch(false),
+	m_realtimeEventQueue(realtimeQueueSize),
+	m_stats(),
+	m_numCoalesced(0),
+	m_pRecorder(nullptr)
+{
+	for (int i = 0; i < EVENTMANAGER_NUM_QUEUES; i++)
+	{
+		m_coalesceTables[i].generation = 1;
+		m_coalesceTables[i].count = 0;
+	}
 }
 
 EventManager::~EventManager()
@@ -15,20 +29,68 @@ EventManager::~EventManager()
 }
 
 
+uint32_t EventManager::FindTypeIndex(const EventType& type) const
+{
+	auto findIt = m_typeIndices.find(type);
+	return (findIt != m_typeIndices.end()) ? findIt->second : UINT32_MAX;
+}
+
+
 bool EventManager::VAddListener(const EventListenerDelegate& eventDelegate, const EventType& type)
 {
 	//Engine::getInstance().Sys_Printf(stdout, "Events: Attempting to add delegate function for event type %ul\n", type);
 
-	EventListenerList & eventListenerList =  m_eventListeners[type];  // this will find or create the entry
+	if (m_dispatchDepth > 0)
+	{
+		for (auto& pending : m_pendingListeners)
+		{
+			if (pending.type == type && pending.delegate.target_type() == eventDelegate.target_type())
+				return false;
+		}
+
+		PendingListener pending;
+		pending.delegate = eventDelegate;
+		pending.type = type;
+		m_pendingListeners.push_back(pending);
+		return true;
+	}
+
+	return AddListener(eventDelegate, type);
+}
+
+
+uint32_t EventManager::GetOrCreateTypeIndex(const EventType& type)
+{
+	uint32_t typeIndex = FindTypeIndex(type);
+	if (typeIndex == UINT32_MAX)
+	{
+		typeIndex = static_cast<uint32_t>(m_eventListeners.size());
+		m_typeIndices[type] = typeIndex;
+		m_eventListeners.push_back(EventListenerList());
+		m_coalesceTypes.push_back(0);
+	}
+	return typeIndex;
+}
+
+
+bool EventManager::AddListener(const EventListenerDelegate& eventDelegate, const EventType& type)
+{
+	const uint32_t typeIndex = GetOrCreateTypeIndex(type);
+
+	EventListenerList& eventListenerList = m_eventListeners[typeIndex];
 	for (auto& eventListener: eventListenerList)
 	{
-		if (eventDelegate.target_type() == eventListener.target_type())
+		if (!eventListener.bRemoved && eventDelegate.target_type() == eventListener.delegate.target_type())
 		{
 			//Engine::getInstance().Sys_Printf(stdout, "Events: Attempting to double-register a delegate \n");
 			return false;
 		}
 	}
-	eventListenerList.push_back(eventDelegate);
+
+	EventListener listener;
+	listener.delegate = eventDelegate;
+	listener.bRemoved = false;
+	eventListenerList.push_back(listener);
 	//Engine::getInstance().Sys_Printf(stdout, "Events: Successfully added delegate for event type: %ul \n", type);
 
 	return true;
@@ -38,46 +100,98 @@ bool EventManager::VAddListener(const EventListenerDelegate& eventDelegate, cons
 bool EventManager::VRemoveListener(const EventListenerDelegate& eventDelegate, const EventType& type)
 {
 	//Engine::getInstance().Sys_Printf(stdout, "Events: Attempting to remove delegate function from event type: %ul \n", type);
-	bool success = false;
 
-	auto findIt = m_eventListeners.find(type);
-	if (findIt != m_eventListeners.end())
+	for (auto it = m_pendingListeners.begin(); it != m_pendingListeners.end(); ++it)
 	{
-		EventListenerList& listeners = findIt->second;
-		for (auto it = listeners.begin(); it != listeners.end(); ++it)
+		if (it->type == type && it->delegate.target_type() == eventDelegate.target_type())
 		{
-			if (eventDelegate.target_type() == (*it).target_type())
-			{
-				listeners.erase(it);
-				//Engine::getInstance().Sys_Printf(stdout, "Events: Successfully removed delegate function from event type: %ul \n", type);
-				success = true;
-				break;  // we don't need to continue because it should be impossible for the same delegate function to be registered for the same event more than once
-			}
+			m_pendingListeners.erase(it);
+			return true;
 		}
 	}
-	return success;
+
+	const uint32_t typeIndex = FindTypeIndex(type);
+	if (typeIndex == UINT32_MAX)
+		return false;
+
+	EventListenerList& listeners = m_eventListeners[typeIndex];
+	for (auto it = listeners.begin(); it != listeners.end(); ++it)
+	{
+		if (it->bRemoved || eventDelegate.target_type() != it->delegate.target_type())
+			continue;
+
+		if (m_dispatchDepth > 0)
+		{
+			// The delegate may be the one running right now, so it is only flagged
+			it->bRemoved = true;
+			m_bRemovedDuringDispatch = true;
+		}
+		else
+		{
+			listeners.erase(it);
+		}
+		//Engine::getInstance().Sys_Printf(stdout, "Events: Successfully removed delegate function from event type: %ul \n", type);
+		return true;  // it should be impossible for the same delegate function to be registered for the same event more than once
+	}
+	return false;
 }
 
 
-bool EventManager::VTriggerEvent(const IEventDataPtr& pEvent)
+bool EventManager::Dispatch(const IEventDataPtr& pEvent, uint32_t typeIndex)
 {
-	//Engine::getInstance().Sys_Printf(stdout, "Events: Attempting to trigger event %s \n", pEvent->GetName());
 	bool processed = false;
 
-	auto findIt = m_eventListeners.find(pEvent->VGetEventType());
-	if (findIt != m_eventListeners.end())
+	m_dispatchDepth++;
+	const EventListenerList& eventListenerList = m_eventListeners[typeIndex];
+	for (size_t i = 0; i < eventListenerList.size(); i++)
+	{
+		const EventListener& listener = eventListenerList[i];
+		if (listener.bRemoved)
+			continue;
+
+		//Engine::getInstance().Sys_Printf(stdout, "Events: Sending Event %s to delegate \n", pEvent->GetName());
+		listener.delegate(pEvent);  // call the delegate
+		processed = true;
+	}
+	m_dispatchDepth--;
+
+	if (m_dispatchDepth == 0)
+	{
+		FlushPendingListeners();
+	}
+
+	return processed;
+}
+
+
+void EventManager::FlushPendingListeners()
+{
+	if (m_bRemovedDuringDispatch)
 	{
-		const EventListenerList& eventListenerList = findIt->second;
-		for (EventListenerList::const_iterator it = eventListenerList.begin(); it != eventListenerList.end(); ++it)
+		for (auto& listeners : m_eventListeners)
 		{
-			EventListenerDelegate listener = (*it);
-			//Engine::getInstance().Sys_Printf(stdout, "Events: Sending Event %s to delegate \n", pEvent->GetName());
-			listener(pEvent);  // call the delegate
-			processed = true;
+			listeners.erase(std::remove_if(listeners.begin(), listeners.end(), [](const EventListener& listener) { return listener.bRemoved; }), listeners.end());
 		}
+		m_bRemovedDuringDispatch = false;
 	}
 
-	return processed;
+	for (auto& pending : m_pendingListeners)
+	{
+		AddListener(pending.delegate, pending.type);
+	}
+	m_pendingListeners.clear();
+}
+
+
+bool EventManager::VTriggerEvent(const IEventDataPtr& pEvent)
+{
+	TYW_PROFILE_FUNCTION();
+	//Engine::getInstance().Sys_Printf(stdout, "Events: Attempting to trigger event %s \n", pEvent->GetName());
+	const uint32_t typeIndex = FindTypeIndex(pEvent->VGetEventType());
+	if (typeIndex == UINT32_MAX)
+		return false;
+
+	return Dispatch(pEvent, typeIndex);
 }
 
 
@@ -95,112 +209,219 @@ bool EventManager::VQueueEvent(const IEventDataPtr& pEvent)
 
 	//Engine::getInstance().Sys_Printf(stdout, "Events: Attempting to queue event: %s", pEvent->GetName());
 
-	auto findIt = m_eventListeners.find(pEvent->VGetEventType());
-	if (findIt != m_eventListeners.end())
-	{
-		m_queues[m_activeQueue].push_back(pEvent);
-		//Engine::getInstance().Sys_Printf(stdout, "Events: Successfully queued event: %s", pEvent->GetName());
-		return true;
-	}
-	else
+	const uint32_t typeIndex = FindTypeIndex(pEvent->VGetEventType());
+	if (typeIndex == UINT32_MAX)
 	{
 		//Engine::getInstance().Sys_Printf(stdout, "Events: Skipping event since there are no delegates registered to receive it: %s", pEvent->GetName());
 		return false;
 	}
+
+	QueuedEvent queued;
+	queued.pEvent = pEvent;
+	queued.typeIndex = typeIndex;
+	m_queues[m_activeQueue].PushBack(std::move(queued));
+	if (m_coalesceTypes[typeIndex])
+	{
+		Coalesce(m_activeQueue, m_queues[m_activeQueue].Size() - 1);
+	}
+	//Engine::getInstance().Sys_Printf(stdout, "Events: Successfully queued event: %s", pEvent->GetName());
 	return true;
 }
 
 
+bool EventManager::VThreadSafeQueueEvent(const IEventDataPtr& pEvent)
+{
+	if (!pEvent)
+	{
+		return false;
+	}
+
+	// Listener lookup is not thread safe, it happens once the event is drained in VUpdate()
+	return m_realtimeEventQueue.TryPush(pEvent);
+}
+
+
 bool EventManager::VAbortEvent(const EventType& inType, bool allOfType)
 {
 	assert(m_activeQueue >= 0);
 	assert(m_activeQueue < EVENTMANAGER_NUM_QUEUES);
 
+	const uint32_t typeIndex = FindTypeIndex(inType);
+	if (typeIndex == UINT32_MAX)
+		return false;
+
+	// Aborted events are cleared in place and skipped by VUpdate(), the ring is never compacted
 	bool success = false;
-	EventListenerMap::iterator findIt = m_eventListeners.find(inType);
+	EventQueue& eventQueue = m_queues[m_activeQueue];
+	for (uint32_t i = 0; i < eventQueue.Size(); i++)
+	{
+		QueuedEvent& queued = eventQueue[i];
+		if (queued.pEvent && queued.typeIndex == typeIndex)
+		{
+			queued.pEvent.reset();
+			success = true;
+			if (!allOfType)
+				break;
+		}
+	}
 
-	if (findIt != m_eventListeners.end())
+	return success;
+}
+
+
+void EventManager::VSetCoalescing(const EventType& type, bool bEnable)
+{
+	// Creating a type index may grow the listener table
+	assert(m_dispatchDepth == 0);
+
+	m_coalesceTypes[GetOrCreateTypeIndex(type)] = bEnable ? 1 : 0;
+}
+
+
+void EventManager::Coalesce(int queue, uint32_t position)
+{
+	QueuedEvent& queued = m_queues[queue][position];
+
+	uint64_t key;
+	if (!queued.pEvent || !queued.pEvent->VGetCoalesceKey(key))
+		return;
+
+	const uint32_t previous = UpdateCoalesceEntry(m_coalesceTables[queue], queued.typeIndex, key, position);
+	if (previous != UINT32_MAX && m_queues[queue][previous].pEvent)
+	{
+		m_queues[queue][previous].pEvent.reset();
+		m_numCoalesced++;
+	}
+}
+
+
+uint32_t EventManager::UpdateCoalesceEntry(CoalesceTable& table, uint32_t typeIndex, uint64_t key, uint32_t position)
+{
+	// Keep load factor under one half
+	if ((table.count + 1) * 2 > table.entries.size())
 	{
-		EventQueue& eventQueue = m_queues[m_activeQueue];
-		auto it = eventQueue.begin();
-		while (it != eventQueue.end())
+		std::vector<CoalesceEntry> oldEntries;
+		oldEntries.swap(table.entries);
+		table.entries.resize(std::max<size_t>(64, oldEntries.size() * 2));
+		for (auto& entry : table.entries)
 		{
-			// Removing an item from the queue will invalidate the iterator, so have it point to the next member.  All
-			// work inside this loop will be done using thisIt.
-			auto thisIt = it;
-			++it;
+			entry.generation = 0;
+		}
 
-			if ((*thisIt)->VGetEventType() == inType)
+		table.count = 0;
+		for (auto& entry : oldEntries)
+		{
+			if (entry.generation == table.generation)
 			{
-				eventQueue.erase(thisIt);
-				success = true;
-				if (!allOfType)
-					break;
+				UpdateCoalesceEntry(table, entry.typeIndex, entry.key, entry.position);
 			}
 		}
 	}
 
-	return success;
+	const uint32_t mask = static_cast<uint32_t>(table.entries.size()) - 1;
+	const uint64_t hash = (key ^ (static_cast<uint64_t>(typeIndex) << 32)) * 0x9E3779B97F4A7C15ull;
+	uint32_t slot = static_cast<uint32_t>(hash >> 32) & mask;
+	for (;;)
+	{
+		CoalesceEntry& entry = table.entries[slot];
+		if (entry.generation != table.generation)
+		{
+			entry.key = key;
+			entry.typeIndex = typeIndex;
+			entry.position = position;
+			entry.generation = table.generation;
+			table.count++;
+			return UINT32_MAX;
+		}
+
+		if (entry.key == key && entry.typeIndex == typeIndex)
+		{
+			const uint32_t previous = entry.position;
+			entry.position = position;
+			return previous;
+		}
+
+		slot = (slot + 1) & mask;
+	}
+}
+
+
+void EventManager::ClearCoalesceTable(int queue)
+{
+	CoalesceTable& table = m_coalesceTables[queue];
+	table.count = 0;
+	table.generation++;
+	if (table.generation == 0)
+	{
+		for (auto& entry : table.entries)
+		{
+			entry.generation = 0;
+		}
+		table.generation = 1;
+	}
 }
 
 
-bool EventManager::VUpdate(unsigned long maxMillis)
+bool EventManager::VUpdate(uint64_t maxMicroSec)
 {
-	unsigned long currMs = GetTickCount();
-	unsigned long maxMs = ((maxMillis == IEventManager::kINFINITE) ? (IEventManager::kINFINITE) : (currMs + maxMillis));
+	TYW_PROFILE_FUNCTION();
+	typedef std::chrono::steady_clock Clock;
+
+	const Clock::time_point startTime = Clock::now();
+	const bool bInfinite = (maxMicroSec == IEventManager::kINFINITE);
+	const Clock::time_point endTime = startTime + std::chrono::microseconds(bInfinite ? 0 : maxMicroSec);
+
+	m_stats = EventManagerStats();
+	if (m_pRecorder)
+	{
+		m_pRecorder->BeginUpdate();
+	}
 
-	// This section added to handle events from other threads.  Check out Chapter 20.
+	// Move events posted by other threads into the active queue, so they are processed this update
 	IEventDataPtr pRealtimeEvent;
-	while (m_realtimeEventQueue.try_pop(pRealtimeEvent))
+	while (m_realtimeEventQueue.TryPop(pRealtimeEvent))
 	{
 		VQueueEvent(pRealtimeEvent);
+		m_stats.numRealtime++;
+	}
+	pRealtimeEvent.reset();
 
-		currMs = GetTickCount();
-		if (maxMillis != IEventManager::kINFINITE)
-		{
-			if (currMs >= maxMs)
-			{
-				//Engine::getInstance().Sys_Printf(stdout, "A realtime process is spamming the event manager!");
-			}
-		}
+	if (!bInfinite && Clock::now() >= endTime)
+	{
+		//Engine::getInstance().Sys_Printf(stdout, "A realtime process is spamming the event manager!");
 	}
 
+	m_stats.numCoalesced = m_numCoalesced;
+	m_numCoalesced = 0;
+
 	// swap active queues and clear the new queue after the swap
 	int queueToProcess = m_activeQueue;
 	m_activeQueue = (m_activeQueue + 1) % EVENTMANAGER_NUM_QUEUES;
-	m_queues[m_activeQueue].clear();
+	m_queues[m_activeQueue].Clear();
+	ClearCoalesceTable(m_activeQueue);
 
 	//Engine::getInstance().Sys_Printf(stdout, "EventLoop: Processing Event Queue %i; %i event to process", queueToProcess, m_queues[queueToProcess].size());
 
 	// Process the queue
-	while (!m_queues[queueToProcess].empty())
+	QueuedEvent queued;
+	while (!m_queues[queueToProcess].Empty())
 	{
 		// pop the front of the queue
-		IEventDataPtr pEvent = m_queues[queueToProcess].front();
-		m_queues[queueToProcess].pop_front();
-		//Engine::getInstance().Sys_Printf(stdout, "EventLoop: Processing Event %s", pEvent->GetName());
+		m_queues[queueToProcess].PopFront(queued);
+		if (!queued.pEvent)
+			continue;
 
-		const EventType& eventType = pEvent->VGetEventType();
-
-		// find all the delegate functions registered for this event
-		auto findIt = m_eventListeners.find(eventType);
-		if (findIt != m_eventListeners.end())
+		//Engine::getInstance().Sys_Printf(stdout, "EventLoop: Processing Event %s", queued.pEvent->GetName());
+		if (m_pRecorder)
 		{
-			const EventListenerList& eventListeners = findIt->second;
-			//Engine::getInstance().Sys_Printf(stdout, "EventLoop: Found %i delegates", eventListeners.size());
-
-			// call each listener
-			for (auto it = eventListeners.begin(); it != eventListeners.end(); ++it)
-			{
-				EventListenerDelegate listener = (*it);
-				//Engine::getInstance().Sys_Printf(stdout, "EventLoop: Sending event %s to delegate", pEvent->GetName());
-				listener(pEvent);
-			}
+			m_pRecorder->Record(*queued.pEvent);
 		}
+		Dispatch(queued.pEvent, queued.typeIndex);
+		queued.pEvent.reset();
+		m_stats.numProcessed++;
 
 		// check to see if time ran out
-		currMs = GetTickCount();
-		if (maxMillis != IEventManager::kINFINITE && currMs >= maxMs)
+		if (!bInfinite && Clock::now() >= endTime)
 		{
 			//Engine::getInstance().Sys_Printf(stdout, "EventLoop: Aborting event processing; time ran out");
 			break;
@@ -209,16 +430,33 @@ bool EventManager::VUpdate(unsigned long maxMillis)
 
 	// If we couldn't process all of the events, push the remaining events to the new active queue.
 	// Note: To preserve sequencing, go back-to-front, inserting them at the head of the active queue
-	bool queueFlushed = (m_queues[queueToProcess].empty());
+	bool queueFlushed = (m_queues[queueToProcess].Empty());
 	if (!queueFlushed)
 	{
-		while (!m_queues[queueToProcess].empty())
+		while (!m_queues[queueToProcess].Empty())
 		{
-			IEventDataPtr pEvent = m_queues[queueToProcess].back();
-			m_queues[queueToProcess].pop_back();
-			m_queues[m_activeQueue].push_front(pEvent);
+			m_queues[queueToProcess].PopBack(queued);
+			if (!queued.pEvent)
+				continue;
+
+			m_queues[m_activeQueue].PushFront(std::move(queued));
+			m_stats.numDeferred++;
+		}
+
+		// Positions in the active queue moved, rebuild its coalescing table. Deferred events
+		// may also be replaced by newer ones queued by listeners this update.
+		ClearCoalesceTable(m_activeQueue);
+		EventQueue& activeQueue = m_queues[m_activeQueue];
+		for (uint32_t i = 0; i < activeQueue.Size(); i++)
+		{
+			if (activeQueue[i].pEvent && m_coalesceTypes[activeQueue[i].typeIndex])
+			{
+				Coalesce(m_activeQueue, i);
+			}
 		}
 	}
+	ClearCoalesceTable(queueToProcess);
 
+	m_stats.updateMicroSec = std::chrono::duration<double, std::micro>(Clock::now() - startTime).count();
 	return queueFlushed;
-}
\ No newline at end of file
+}
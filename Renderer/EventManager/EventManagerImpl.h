@@ -1,25 +1,95 @@
 #pragma once
 #include "IEventManager.h"
+#include "RingBuffer.h"
+
+
+//forward declaration
+class EventRecorder;
 
 const unsigned int EVENTMANAGER_NUM_QUEUES = 2;
+const unsigned int EVENTMANAGER_REALTIME_QUEUE_SIZE = 4096;
+
 
-class TYWENGINE_API EventManager: public IEventManager
+/*
+	Statistics of the last EventManager::VUpdate
+*/
+struct EventManagerStats
+{
+	uint32_t	numProcessed;		// events dispatched
+	uint32_t	numDeferred;		// left in the queue when the budget ran out
+	uint32_t	numCoalesced;		// replaced by a newer event since the previous update
+	uint32_t	numRealtime;		// drained from the thread safe queue
+	double		updateMicroSec;
+};
+
+
+class EventManager: public IEventManager
 {
 private:
 
-	typedef std::list<EventListenerDelegate> EventListenerList;
-	typedef std::map<EventType, EventListenerList> EventListenerMap;
-	typedef std::list<IEventDataPtr> EventQueue;
+	struct EventListener
+	{
+		EventListenerDelegate	delegate;
+		bool					bRemoved;	// removed while dispatching, erased afterwards
+	};
+
+	struct QueuedEvent
+	{
+		IEventDataPtr	pEvent;			// null once aborted
+		uint32_t		typeIndex;
+	};
+
+	struct PendingListener
+	{
+		EventListenerDelegate	delegate;
+		EventType				type;
+	};
+
+	// Open addressing table of coalescable events in one queue. Entries of older generations are empty
+	struct CoalesceEntry
+	{
+		uint64_t	key;
+		uint32_t	typeIndex;
+		uint32_t	position;		// index in the queue, 0 is the front
+		uint32_t	generation;
+	};
+
+	struct CoalesceTable
+	{
+		std::vector<CoalesceEntry>	entries;
+		uint32_t					generation;
+		uint32_t					count;
+	};
+
+	typedef std::vector<EventListener> EventListenerList;
+	typedef RingBuffer<QueuedEvent> EventQueue;
 
 	int m_activeQueue;  // index of actively processing queue; events enque to the opposing queue
-	EventListenerMap m_eventListeners;
+
+	// Event types are mapped to dense indices when the first listener is added. Listener lists
+	// are indexed by it and queued events carry it, so dispatch does no map lookups.
+	std::unordered_map<EventType, uint32_t> m_typeIndices;
+	std::vector<EventListenerList> m_eventListeners;
+	std::vector<uint8_t> m_coalesceTypes;	// by type index
+
+	// Listener lists must not reallocate while a delegate runs, so listeners added during dispatch wait here
+	std::vector<PendingListener> m_pendingListeners;
+	uint32_t m_dispatchDepth;
+	bool m_bRemovedDuringDispatch;
+
 	EventQueue m_queues[EVENTMANAGER_NUM_QUEUES];
+	CoalesceTable m_coalesceTables[EVENTMANAGER_NUM_QUEUES];
 	ThreadSafeEventQueue m_realtimeEventQueue;
+
+	EventManagerStats m_stats;
+	uint32_t m_numCoalesced;	// since the previous update
+
+	EventRecorder* m_pRecorder;
 public:
-	EventManager();
+	explicit EventManager(uint32_t realtimeQueueSize = EVENTMANAGER_REALTIME_QUEUE_SIZE);
 	~EventManager();
-	
-	
+
+
 	bool VAddListener(const EventListenerDelegate& eventDelegate, const EventType& type);
 	bool VRemoveListener(const EventListenerDelegate& eventDelegate, const EventType& type);
 
@@ -28,10 +98,62 @@ public:
 
 
 	bool VQueueEvent(const IEventDataPtr& pEvent);
+	bool VThreadSafeQueueEvent(const IEventDataPtr& pEvent);
 
 
 	bool VAbortEvent(const EventType& type, bool allOfType = false);
+	void VSetCoalescing(const EventType& type, bool bEnable);
+
+
+	bool VUpdate(uint64_t maxMicroSec = kINFINITE);
+
+
+	const EventManagerStats& GetStats() const { return m_stats; }
+
+
+	// Every dispatched queued event is passed to the recorder. nullptr stops capturing
+	void SetRecorder(EventRecorder* pRecorder) { m_pRecorder = pRecorder; }
+
+
+	// Push/pop counters of the thread safe queue. Producer throughput is numPushed over wall time.
+	MPSCQueueStats GetRealtimeQueueStats() const { return m_realtimeEventQueue.GetStats(); }
+
+private:
+	/*
+		@param: const EventType& type
+		@return: dense index or UINT32_MAX if the type has no listeners and no coalescing set
+	*/
+	uint32_t FindTypeIndex(const EventType& type) const;
+
+	uint32_t GetOrCreateTypeIndex(const EventType& type);
+	bool AddListener(const EventListenerDelegate& eventDelegate, const EventType& type);
+
+	/*
+		Drops the older event with the same coalesce key as the event at position.
+		The dropped event stays in the queue as an empty entry
+
+		@param: int queue
+		@param: uint32_t position
+	*/
+	void Coalesce(int queue, uint32_t position);
+
+	/*
+		Inserts or updates (typeIndex, key) and returns the position it had before
+
+		@return: previous position or UINT32_MAX
+	*/
+	uint32_t UpdateCoalesceEntry(CoalesceTable& table, uint32_t typeIndex, uint64_t key, uint32_t position);
+	void ClearCoalesceTable(int queue);
+
+	/*
+		Calls every listener of the type. Delegates are called in place, not copied
 
+		@param: const IEventDataPtr& pEvent
+		@param: uint32_t typeIndex
+		@return: true if at least one listener was called
+	*/
+	bool Dispatch(const IEventDataPtr& pEvent, uint32_t typeIndex);
 
-	bool VUpdate(unsigned long maxMillis = 0xffffffff);
+	// Applies listener changes made while dispatching
+	void FlushPendingListeners();
 };
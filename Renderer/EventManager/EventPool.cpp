@@ -0,0 +1,115 @@
+#include  <RendererPch/stdafx.h>
+#include "EventPool.h"
+
+
+
+EventPool& EventPool::Get()
+{
+	static EventPool pool;
+	return pool;
+}
+
+
+EventPool::EventPool():
+	m_NumAllocations(0),
+	m_NumChunkAllocations(0),
+	m_NumLargeAllocations(0),
+	m_NumBlocksInUse(0)
+{
+	for (int i = 0; i < NUM_SIZE_CLASSES; i++)
+	{
+		m_SizeClasses[i].pFreeList = nullptr;
+		m_SizeClasses[i].blockSize = static_cast<size_t>(MIN_BLOCK_SIZE) << i;
+	}
+}
+
+
+EventPool::~EventPool()
+{
+	for (int i = 0; i < NUM_SIZE_CLASSES; i++)
+	{
+		for (void* pChunk : m_SizeClasses[i].chunks)
+		{
+			::operator delete(pChunk);
+		}
+	}
+}
+
+
+int EventPool::GetSizeClass(size_t size)
+{
+	size_t blockSize = MIN_BLOCK_SIZE;
+	for (int i = 0; i < NUM_SIZE_CLASSES; i++, blockSize <<= 1)
+	{
+		if (size <= blockSize)
+			return i;
+	}
+	return -1;
+}
+
+
+void* EventPool::Allocate(size_t size)
+{
+	m_NumAllocations.fetch_add(1, std::memory_order_relaxed);
+
+	const int sizeClass = GetSizeClass(size);
+	if (sizeClass < 0)
+	{
+		m_NumLargeAllocations.fetch_add(1, std::memory_order_relaxed);
+		return ::operator new(size);
+	}
+
+	SizeClass& sc = m_SizeClasses[sizeClass];
+	std::lock_guard<std::mutex> lock(sc.lock);
+	if (!sc.pFreeList)
+	{
+		//Carve a new chunk into blocks
+		char* pChunk = static_cast<char*>(::operator new(sc.blockSize * BLOCKS_PER_CHUNK));
+		sc.chunks.push_back(pChunk);
+		m_NumChunkAllocations.fetch_add(1, std::memory_order_relaxed);
+
+		for (int i = BLOCKS_PER_CHUNK - 1; i >= 0; i--)
+		{
+			FreeBlock* pBlock = reinterpret_cast<FreeBlock*>(pChunk + i * sc.blockSize);
+			pBlock->pNext = sc.pFreeList;
+			sc.pFreeList = pBlock;
+		}
+	}
+
+	FreeBlock* pBlock = sc.pFreeList;
+	sc.pFreeList = pBlock->pNext;
+	m_NumBlocksInUse.fetch_add(1, std::memory_order_relaxed);
+	return pBlock;
+}
+
+
+void EventPool::Free(void* pBlock, size_t size)
+{
+	if (!pBlock)
+		return;
+
+	const int sizeClass = GetSizeClass(size);
+	if (sizeClass < 0)
+	{
+		::operator delete(pBlock);
+		return;
+	}
+
+	SizeClass& sc = m_SizeClasses[sizeClass];
+	std::lock_guard<std::mutex> lock(sc.lock);
+	FreeBlock* pFree = static_cast<FreeBlock*>(pBlock);
+	pFree->pNext = sc.pFreeList;
+	sc.pFreeList = pFree;
+	m_NumBlocksInUse.fetch_sub(1, std::memory_order_relaxed);
+}
+
+
+EventPoolStats EventPool::GetStats() const
+{
+	EventPoolStats stats;
+	stats.numAllocations = m_NumAllocations.load(std::memory_order_relaxed);
+	stats.numChunkAllocations = m_NumChunkAllocations.load(std::memory_order_relaxed);
+	stats.numLargeAllocations = m_NumLargeAllocations.load(std::memory_order_relaxed);
+	stats.numBlocksInUse = static_cast<uint32_t>(m_NumBlocksInUse.load(std::memory_order_relaxed));
+	return stats;
+}
@@ -0,0 +1,120 @@
+#pragma once
+
+
+/*
+	Counters of the event pool. Once the game has warmed up
+	numChunkAllocations stops growing, so dispatching events does no heap work.
+*/
+struct EventPoolStats
+{
+	uint64_t	numAllocations;			// blocks handed out since start
+	uint64_t	numChunkAllocations;	// heap allocations done by the pool itself
+	uint64_t	numLargeAllocations;	// blocks too big for any size class, served by the heap
+	uint32_t	numBlocksInUse;
+};
+
+
+/*
+	EventPool
+	Fixed size block allocator used for events and their shared_ptr control blocks.
+
+	Blocks are grouped in size classes of 64, 128, 256 and 512 bytes. Each class keeps
+	a free list threaded through the free blocks and grows by whole chunks, which are
+	only returned when the pool is destroyed. Events are created by loader and worker
+	threads too, so every class has its own lock.
+*/
+class EventPool
+{
+public:
+	static EventPool& Get();
+
+	~EventPool();
+
+	/*
+		@param: size_t size
+		@return: void*
+	*/
+	void* Allocate(size_t size);
+
+	/*
+		@param: void* pBlock
+		@param: size_t size - same size that was passed to Allocate
+	*/
+	void Free(void* pBlock, size_t size);
+
+	EventPoolStats GetStats() const;
+
+private:
+	EventPool();
+	EventPool(const EventPool&) = delete;
+	EventPool& operator=(const EventPool&) = delete;
+
+	enum
+	{
+		NUM_SIZE_CLASSES = 4,
+		MIN_BLOCK_SIZE = 64,
+		BLOCKS_PER_CHUNK = 64
+	};
+
+	struct FreeBlock
+	{
+		FreeBlock* pNext;
+	};
+
+	struct SizeClass
+	{
+		std::mutex				lock;
+		FreeBlock*				pFreeList;
+		std::vector<void*>		chunks;
+		size_t					blockSize;
+	};
+
+	static int GetSizeClass(size_t size);
+
+private:
+	SizeClass					m_SizeClasses[NUM_SIZE_CLASSES];
+
+	std::atomic<uint64_t>		m_NumAllocations;
+	std::atomic<uint64_t>		m_NumChunkAllocations;
+	std::atomic<uint64_t>		m_NumLargeAllocations;
+	std::atomic<int32_t>		m_NumBlocksInUse;
+};
+
+
+/*
+	Standard allocator on top of EventPool. Used with std::allocate_shared,
+	so the event and its reference counts end up in one pooled block.
+*/
+template<class T>
+class EventAllocator
+{
+public:
+	typedef T value_type;
+
+	template<class U>
+	struct rebind
+	{
+		typedef EventAllocator<U> other;
+	};
+
+	EventAllocator() {}
+
+	template<class U>
+	EventAllocator(const EventAllocator<U>&) {}
+
+	T* allocate(size_t n)
+	{
+		return static_cast<T*>(EventPool::Get().Allocate(n * sizeof(T)));
+	}
+
+	void deallocate(T* p, size_t n)
+	{
+		EventPool::Get().Free(p, n * sizeof(T));
+	}
+};
+
+template<class T, class U>
+bool operator==(const EventAllocator<T>&, const EventAllocator<U>&) { return true; }
+
+template<class T, class U>
+bool operator!=(const EventAllocator<T>&, const EventAllocator<U>&) { return false; }
@@ -0,0 +1,170 @@
+#include  <RendererPch/stdafx.h>
+#include "EventRecorder.h"
+
+
+//Size of uint32 eventType, uint32 update, uint64 timeMicroSec and uint32 payloadSize
+static const size_t EVENT_RECORD_HEADER_SIZE = 20;
+static const size_t EVENT_CAPTURE_HEADER_SIZE = 8;
+
+
+
+EventRecorder::EventRecorder():
+	m_Update(0),
+	m_NumEvents(0),
+	m_bRecording(false)
+{
+
+}
+
+
+void EventRecorder::Start()
+{
+	m_Capture.Clear();
+	m_Capture.WriteUInt32(EVENT_CAPTURE_MAGIC);
+	m_Capture.WriteUInt32(EVENT_CAPTURE_VERSION);
+
+	m_StartTime = std::chrono::steady_clock::now();
+	m_Update = UINT32_MAX;	// first BeginUpdate wraps it to 0
+	m_NumEvents = 0;
+	m_bRecording = true;
+}
+
+
+void EventRecorder::Stop()
+{
+	m_bRecording = false;
+}
+
+
+void EventRecorder::BeginUpdate()
+{
+	if (m_bRecording)
+	{
+		m_Update++;
+	}
+}
+
+
+void EventRecorder::Record(const IEventData& event)
+{
+	if (!m_bRecording || !g_eventFactory.IsRegistered(event.VGetEventType()))
+		return;
+
+	const uint64_t timeMicroSec = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - m_StartTime).count();
+
+	m_Capture.WriteUInt32(static_cast<uint32_t>(event.VGetEventType()));
+	m_Capture.WriteUInt32(m_Update);
+	m_Capture.WriteUInt64(timeMicroSec);
+
+	const size_t sizeOffset = m_Capture.GetSize();
+	m_Capture.WriteUInt32(0);
+	event.VSerialize(m_Capture);
+	m_Capture.PatchUInt32(sizeOffset, static_cast<uint32_t>(m_Capture.GetSize() - sizeOffset - 4));
+
+	m_NumEvents++;
+}
+
+
+bool EventRecorder::Save(const std::string& fileName) const
+{
+	std::ofstream file(fileName, std::ios::binary | std::ios::trunc);
+	if (!file.is_open())
+	{
+		return false;
+	}
+
+	file.write(reinterpret_cast<const char*>(m_Capture.GetData()), m_Capture.GetSize());
+	return file.good();
+}
+
+
+
+EventReplayer::EventReplayer():
+	m_Offset(0),
+	m_Update(0)
+{
+
+}
+
+
+bool EventReplayer::Load(const std::string& fileName)
+{
+	std::ifstream file(fileName, std::ios::binary | std::ios::ate);
+	if (!file.is_open())
+	{
+		return false;
+	}
+
+	const size_t size = static_cast<size_t>(file.tellg());
+	std::vector<uint8_t> data(size);
+	file.seekg(0, std::ios::beg);
+	file.read(reinterpret_cast<char*>(data.data()), size);
+	if (!file.good())
+	{
+		return false;
+	}
+
+	return Load(data.data(), data.size());
+}
+
+
+bool EventReplayer::Load(const uint8_t* pData, size_t size)
+{
+	EventReader reader(pData, size);
+	if (reader.ReadUInt32() != EVENT_CAPTURE_MAGIC || reader.ReadUInt32() != EVENT_CAPTURE_VERSION)
+	{
+		m_Capture.clear();
+		Rewind();
+		return false;
+	}
+
+	m_Capture.assign(pData, pData + size);
+	Rewind();
+	return true;
+}
+
+
+void EventReplayer::Rewind()
+{
+	m_Offset = std::min(EVENT_CAPTURE_HEADER_SIZE, m_Capture.size());
+	m_Update = 0;
+}
+
+
+uint32_t EventReplayer::QueueNextUpdate(IEventManager* pEventManager)
+{
+	uint32_t numQueued = 0;
+	while (!IsFinished())
+	{
+		EventReader reader(m_Capture.data() + m_Offset, m_Capture.size() - m_Offset);
+		const EventType eventType = reader.ReadUInt32();
+		const uint32_t update = reader.ReadUInt32();
+		reader.ReadUInt64();
+		const uint32_t payloadSize = reader.ReadUInt32();
+		if (!reader.IsValid() || payloadSize > reader.GetRemaining())
+		{
+			//Truncated capture
+			m_Offset = m_Capture.size();
+			break;
+		}
+
+		if (update > m_Update)
+			break;
+
+		IEventDataPtr pEvent = CREATE_EVENT(eventType);
+		if (pEvent)
+		{
+			EventReader payload(m_Capture.data() + m_Offset + EVENT_RECORD_HEADER_SIZE, payloadSize);
+			pEvent->VDeserialize(payload);
+			if (payload.IsValid() && pEventManager->VQueueEvent(pEvent))
+			{
+				numQueued++;
+			}
+		}
+
+		m_Offset += EVENT_RECORD_HEADER_SIZE + payloadSize;
+	}
+
+	m_Update++;
+	return numQueued;
+}
@@ -0,0 +1,105 @@
+#pragma once
+#include "IEventManager.h"
+
+
+/*
+	Capture layout, all values little endian
+
+	header:
+		uint32	magic			EVENT_CAPTURE_MAGIC
+		uint32	version			EVENT_CAPTURE_VERSION
+	records until end of file:
+		uint32	eventType
+		uint32	update			index of the EventManager::VUpdate that dispatched the event
+		uint64	timeMicroSec	since EventRecorder::Start
+		uint32	payloadSize
+		uint8	payload[payloadSize]	IEventData::VSerialize
+*/
+const uint32_t EVENT_CAPTURE_MAGIC = 0x45575954;		// "TYWE"
+const uint32_t EVENT_CAPTURE_VERSION = 1;
+
+
+/*
+	EventRecorder
+	Captures every queued event in the order EventManager dispatches it.
+	Only types registered in g_eventFactory are captured, the rest can not be read back.
+*/
+class EventRecorder
+{
+public:
+	EventRecorder();
+
+	// Drops the previous capture
+	void Start();
+	void Stop();
+	bool IsRecording() const { return m_bRecording; }
+
+	// Called by EventManager at the start of every VUpdate
+	void BeginUpdate();
+
+	/*
+		@param: const IEventData& event
+	*/
+	void Record(const IEventData& event);
+
+	/*
+		@param: const std::string& fileName
+		@return: false if the file could not be written
+	*/
+	bool Save(const std::string& fileName) const;
+
+	const EventWriter& GetCapture() const { return m_Capture; }
+	uint32_t GetNumEvents() const { return m_NumEvents; }
+	uint32_t GetNumUpdates() const { return m_Update + 1; }
+
+private:
+	EventWriter										m_Capture;
+	std::chrono::steady_clock::time_point			m_StartTime;
+	uint32_t										m_Update;
+	uint32_t										m_NumEvents;
+	bool											m_bRecording;
+};
+
+
+/*
+	EventReplayer
+	Feeds a capture back through an event manager. Events recorded in update N are
+	queued before update N of the replay, so they are dispatched in the recorded order.
+*/
+class EventReplayer
+{
+public:
+	EventReplayer();
+
+	/*
+		@param: const std::string& fileName
+		@return: false if the file is missing or not a capture
+	*/
+	bool Load(const std::string& fileName);
+
+	/*
+		@param: const uint8_t* pData - copied
+		@param: size_t size
+		@return: false if the data is not a capture
+	*/
+	bool Load(const uint8_t* pData, size_t size);
+
+	// Back to the first update of the capture
+	void Rewind();
+
+	/*
+		Queues every event of the next update. Call once before each VUpdate
+
+		@param: IEventManager* pEventManager
+		@return: uint32_t number of queued events
+	*/
+	uint32_t QueueNextUpdate(IEventManager* pEventManager);
+
+	bool IsFinished() const { return m_Offset >= m_Capture.size(); }
+	uint32_t GetUpdate() const { return m_Update; }
+
+private:
+	std::vector<uint8_t>	m_Capture;
+	size_t					m_Offset;
+	uint32_t				m_Update;
+};
@@ -0,0 +1,192 @@
+#include  <RendererPch/stdafx.h>
+#include "EventStream.h"
+
+
+
+void EventWriter::WriteUInt8(uint8_t value)
+{
+	m_Buffer.push_back(value);
+}
+
+
+void EventWriter::WriteUInt32(uint32_t value)
+{
+	const uint8_t bytes[4] =
+	{
+		static_cast<uint8_t>(value),
+		static_cast<uint8_t>(value >> 8),
+		static_cast<uint8_t>(value >> 16),
+		static_cast<uint8_t>(value >> 24)
+	};
+	m_Buffer.insert(m_Buffer.end(), bytes, bytes + 4);
+}
+
+
+void EventWriter::WriteUInt64(uint64_t value)
+{
+	WriteUInt32(static_cast<uint32_t>(value));
+	WriteUInt32(static_cast<uint32_t>(value >> 32));
+}
+
+
+void EventWriter::WriteFloat(float value)
+{
+	uint32_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+	WriteUInt32(bits);
+}
+
+
+void EventWriter::WriteDouble(double value)
+{
+	uint64_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+	WriteUInt64(bits);
+}
+
+
+void EventWriter::WriteString(const std::string& value)
+{
+	WriteUInt32(static_cast<uint32_t>(value.size()));
+	WriteBytes(value.data(), value.size());
+}
+
+
+void EventWriter::WriteMatrix(const glm::mat4x4& value)
+{
+	for (int i = 0; i < 4; ++i)
+	{
+		for (int j = 0; j < 4; ++j)
+		{
+			WriteFloat(value[i][j]);
+		}
+	}
+}
+
+
+void EventWriter::WriteBytes(const void* pData, size_t size)
+{
+	const uint8_t* pBytes = static_cast<const uint8_t*>(pData);
+	m_Buffer.insert(m_Buffer.end(), pBytes, pBytes + size);
+}
+
+
+void EventWriter::PatchUInt32(size_t offset, uint32_t value)
+{
+	assert(offset + 4 <= m_Buffer.size());
+	m_Buffer[offset + 0] = static_cast<uint8_t>(value);
+	m_Buffer[offset + 1] = static_cast<uint8_t>(value >> 8);
+	m_Buffer[offset + 2] = static_cast<uint8_t>(value >> 16);
+	m_Buffer[offset + 3] = static_cast<uint8_t>(value >> 24);
+}
+
+
+
+EventReader::EventReader(const uint8_t* pData, size_t size):
+	m_pData(pData),
+	m_Size(size),
+	m_Offset(0),
+	m_bValid(true)
+{
+
+}
+
+
+bool EventReader::ReadBytes(void* pData, size_t size)
+{
+	if (!m_bValid || size > m_Size - m_Offset)
+	{
+		m_bValid = false;
+		memset(pData, 0, size);
+		return false;
+	}
+
+	memcpy(pData, m_pData + m_Offset, size);
+	m_Offset += size;
+	return true;
+}
+
+
+bool EventReader::Skip(size_t size)
+{
+	if (!m_bValid || size > m_Size - m_Offset)
+	{
+		m_bValid = false;
+		return false;
+	}
+
+	m_Offset += size;
+	return true;
+}
+
+
+uint8_t EventReader::ReadUInt8()
+{
+	uint8_t value;
+	ReadBytes(&value, 1);
+	return value;
+}
+
+
+uint32_t EventReader::ReadUInt32()
+{
+	uint8_t bytes[4];
+	ReadBytes(bytes, 4);
+	return static_cast<uint32_t>(bytes[0]) | (static_cast<uint32_t>(bytes[1]) << 8) |
+		(static_cast<uint32_t>(bytes[2]) << 16) | (static_cast<uint32_t>(bytes[3]) << 24);
+}
+
+
+uint64_t EventReader::ReadUInt64()
+{
+	const uint64_t low = ReadUInt32();
+	const uint64_t high = ReadUInt32();
+	return low | (high << 32);
+}
+
+
+float EventReader::ReadFloat()
+{
+	const uint32_t bits = ReadUInt32();
+	float value;
+	memcpy(&value, &bits, sizeof(value));
+	return value;
+}
+
+
+double EventReader::ReadDouble()
+{
+	const uint64_t bits = ReadUInt64();
+	double value;
+	memcpy(&value, &bits, sizeof(value));
+	return value;
+}
+
+
+std::string EventReader::ReadString()
+{
+	const uint32_t length = ReadUInt32();
+	if (!m_bValid || length > m_Size - m_Offset)
+	{
+		m_bValid = false;
+		return std::string();
+	}
+
+	std::string value(reinterpret_cast<const char*>(m_pData + m_Offset), length);
+	m_Offset += length;
+	return value;
+}
+
+
+glm::mat4x4 EventReader::ReadMatrix()
+{
+	glm::mat4x4 value;
+	for (int i = 0; i < 4; ++i)
+	{
+		for (int j = 0; j < 4; ++j)
+		{
+			value[i][j] = ReadFloat();
+		}
+	}
+	return value;
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+
+/*
+	EventWriter
+	Appends fixed layout little endian values to a growable byte buffer.
+	Byte order does not depend on the host, so captures can be replayed on any machine.
+*/
+class EventWriter
+{
+public:
+	void WriteUInt8(uint8_t value);
+	void WriteUInt32(uint32_t value);
+	void WriteUInt64(uint64_t value);
+	void WriteInt32(int32_t value) { WriteUInt32(static_cast<uint32_t>(value)); }
+	void WriteBool(bool value) { WriteUInt8(value ? 1 : 0); }
+	void WriteFloat(float value);
+	void WriteDouble(double value);
+
+	// u32 length followed by the characters
+	void WriteString(const std::string& value);
+
+	// 16 floats, column major
+	void WriteMatrix(const glm::mat4x4& value);
+
+	void WriteBytes(const void* pData, size_t size);
+
+	/*
+		Overwrites a value written earlier. Used for sizes that are known only afterwards
+
+		@param: size_t offset
+		@param: uint32_t value
+	*/
+	void PatchUInt32(size_t offset, uint32_t value);
+
+	void Clear() { m_Buffer.clear(); }
+	void Reserve(size_t size) { m_Buffer.reserve(size); }
+
+	const uint8_t* GetData() const { return m_Buffer.data(); }
+	size_t GetSize() const { return m_Buffer.size(); }
+
+private:
+	std::vector<uint8_t> m_Buffer;
+};
+
+
+/*
+	EventReader
+	Reads values written by EventWriter. Reading past the end returns zeros
+	and makes IsValid() false, so a truncated capture can not crash the replay.
+*/
+class EventReader
+{
+public:
+	/*
+		@param: const uint8_t* pData - not copied, must outlive the reader
+		@param: size_t size
+	*/
+	EventReader(const uint8_t* pData, size_t size);
+
+	uint8_t ReadUInt8();
+	uint32_t ReadUInt32();
+	uint64_t ReadUInt64();
+	int32_t ReadInt32() { return static_cast<int32_t>(ReadUInt32()); }
+	bool ReadBool() { return ReadUInt8() != 0; }
+	float ReadFloat();
+	double ReadDouble();
+	std::string ReadString();
+	glm::mat4x4 ReadMatrix();
+
+	bool ReadBytes(void* pData, size_t size);
+	bool Skip(size_t size);
+
+	bool IsValid() const { return m_bValid; }
+	size_t GetOffset() const { return m_Offset; }
+	size_t GetRemaining() const { return m_Size - m_Offset; }
+
+private:
+	const uint8_t*	m_pData;
+	size_t			m_Size;
+	size_t			m_Offset;
+	bool			m_bValid;
+};
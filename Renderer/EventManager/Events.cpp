@@ -1,4 +1,4 @@
-#include  <RendererPch\stdafx.h>
+#include  <RendererPch/stdafx.h>
 
 //Engine Includes
 #include "Events.h"
@@ -32,6 +32,21 @@ const EventType EvtData_Request_New_Actor::sk_EventType(0x40378c64);
 
 
 
+void RegisterEngineEvents(void)
+{
+	REGISTER_EVENT(EvtData_Environment_Loaded);
+	REGISTER_EVENT(EvtData_Remote_Environment_Loaded);
+	REGISTER_EVENT(EvtData_New_Actor);
+	REGISTER_EVENT(EvtData_Move_Actor);
+	REGISTER_EVENT(EvtData_Destroy_Actor);
+	REGISTER_EVENT(EvtData_Modified_Render_Component);
+	REGISTER_EVENT(EvtData_Request_Start_Game);
+	REGISTER_EVENT(EvtData_Remote_Client);
+	REGISTER_EVENT(EvtData_Network_Player_Actor_Assignment);
+	REGISTER_EVENT(EvtData_Request_New_Actor);
+}
+
+
 void RegisterEngineScriptEvents(void)
 {
 	//REGISTER_SCRIPT_EVENT(EvtData_Request_Destroy_Actor, EvtData_Request_Destroy_Actor::sk_EventType);
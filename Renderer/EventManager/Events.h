@@ -8,13 +8,16 @@
 class SceneNode;
 
 
-TYWRENDERER_API void RegisterEngineScriptEvents(void);
+void RegisterEngineScriptEvents(void);
+
+// Registers events that can be serialized with g_eventFactory
+void RegisterEngineEvents(void);
 
 
 //---------------------------------------------------------------------------------------------------------------------
 // EvtData_New_Actor - This event is sent out when an actor is *actually* created.
 //---------------------------------------------------------------------------------------------------------------------
-class TYWRENDERER_API EvtData_New_Actor : public BaseEventData
+class EvtData_New_Actor : public BaseEventData
 {
 	unsigned int m_actorId;
 	unsigned int m_viewId;
@@ -34,10 +37,10 @@ public:
 	{
 	}
 
-	virtual void VDeserialize(std::istrstream& in)
+	virtual void VDeserialize(EventReader& in)
 	{
-		in >> m_actorId;
-		in >> m_viewId;
+		m_actorId = in.ReadUInt32();
+		m_viewId = in.ReadUInt32();
 	}
 
 	virtual const EventType& VGetEventType(void) const
@@ -47,13 +50,13 @@ public:
 
 	virtual IEventDataPtr VCopy(void) const
 	{
-		return IEventDataPtr(TYW_NEW EvtData_New_Actor(m_actorId, m_viewId));
+		return MakeEvent<EvtData_New_Actor>(m_actorId, m_viewId);
 	}
 
-	virtual void VSerialize(std::ostrstream& out) const
+	virtual void VSerialize(EventWriter& out) const
 	{
-		out << m_actorId << " ";
-		out << m_viewId << " ";
+		out.WriteUInt32(m_actorId);
+		out.WriteUInt32(m_viewId);
 	}
 
 
@@ -78,7 +81,7 @@ public:
 //---------------------------------------------------------------------------------------------------------------------
 // EvtData_Destroy_Actor - sent when actors are destroyed	
 //---------------------------------------------------------------------------------------------------------------------
-class TYWRENDERER_API EvtData_Destroy_Actor : public BaseEventData
+class EvtData_Destroy_Actor : public BaseEventData
 {
 	unsigned int m_id;
 
@@ -98,17 +101,17 @@ public:
 
 	virtual IEventDataPtr VCopy(void) const
 	{
-		return IEventDataPtr(TYW_NEW EvtData_Destroy_Actor(m_id));
+		return MakeEvent<EvtData_Destroy_Actor>(m_id);
 	}
 
-	virtual void VSerialize(std::ostrstream &out) const
+	virtual void VSerialize(EventWriter& out) const
 	{
-		out << m_id;
+		out.WriteUInt32(m_id);
 	}
 
-	virtual void VDeserialize(std::istrstream& in)
+	virtual void VDeserialize(EventReader& in)
 	{
-		in >> m_id;
+		m_id = in.ReadUInt32();
 	}
 
 	virtual const char* GetName(void) const
@@ -123,7 +126,7 @@ public:
 //---------------------------------------------------------------------------------------------------------------------
 // EvtData_Move_Actor - sent when actors are moved
 //---------------------------------------------------------------------------------------------------------------------
-class TYWRENDERER_API EvtData_Move_Actor : public BaseEventData
+class EvtData_Move_Actor : public BaseEventData
 {
 	unsigned int m_id;
 	glm::mat4 m_matrix;
@@ -147,33 +150,21 @@ public:
 		//
 	}
 
-	virtual void VSerialize(std::ostrstream &out) const
+	virtual void VSerialize(EventWriter& out) const
 	{
-		out << m_id << " ";
-		for (int i = 0; i<4; ++i)
-		{
-			for (int j = 0; j<4; ++j)
-			{
-				out << m_matrix[i][j] << " ";
-			}
-		}
+		out.WriteUInt32(m_id);
+		out.WriteMatrix(m_matrix);
 	}
 
-	virtual void VDeserialize(std::istrstream& in)
+	virtual void VDeserialize(EventReader& in)
 	{
-		in >> m_id;
-		for (int i = 0; i<4; ++i)
-		{
-			for (int j = 0; j<4; ++j)
-			{
-				in >> m_matrix[i][j];
-			}
-		}
+		m_id = in.ReadUInt32();
+		m_matrix = in.ReadMatrix();
 	}
 
 	virtual IEventDataPtr VCopy() const
 	{
-		return IEventDataPtr(TYW_NEW EvtData_Move_Actor(m_id, m_matrix));
+		return MakeEvent<EvtData_Move_Actor>(m_id, m_matrix);
 	}
 
 	virtual const char* GetName(void) const
@@ -181,6 +172,13 @@ public:
 		return "EvtData_Move_Actor";
 	}
 
+	// Only the latest move of an actor matters
+	virtual bool VGetCoalesceKey(uint64_t& key) const
+	{
+		key = m_id;
+		return true;
+	}
+
 	unsigned int GetId(void) const
 	{
 		return m_id;
@@ -215,12 +213,12 @@ public:
 	{
 	}
 
-	virtual void VSerialize(std::ostrstream& out) const
+	virtual void VSerialize(EventWriter& out) const
 	{
 		//GCC_ERROR(GetName() + std::string(" should not be serialzied!"));
 	}
 
-	virtual void VDeserialize(std::istrstream& in)
+	virtual void VDeserialize(EventReader& in)
 	{
 		//GCC_ERROR(GetName() + std::string(" should not be serialzied!"));
 	}
@@ -232,7 +230,7 @@ public:
 
 	virtual IEventDataPtr VCopy(void) const
 	{
-		return IEventDataPtr(TYW_NEW EvtData_New_Render_Component(m_actorId, m_pSceneNode));
+		return MakeEvent<EvtData_New_Render_Component>(m_actorId, m_pSceneNode);
 	}
 
 	virtual const char* GetName(void) const
@@ -256,7 +254,7 @@ public:
 // EvtData_Modified_Render_Component - This event is sent out when a render component is changed
 //   NOTE: This class is not described in the book!
 //---------------------------------------------------------------------------------------------------------------------
-class TYWRENDERER_API EvtData_Modified_Render_Component : public BaseEventData
+class EvtData_Modified_Render_Component : public BaseEventData
 {
 	unsigned int m_id;
 
@@ -278,19 +276,19 @@ public:
 	{
 	}
 
-	virtual void VSerialize(std::ostrstream &out) const
+	virtual void VSerialize(EventWriter& out) const
 	{
-		out << m_id;
+		out.WriteUInt32(m_id);
 	}
 
-	virtual void VDeserialize(std::istrstream& in)
+	virtual void VDeserialize(EventReader& in)
 	{
-		in >> m_id;
+		m_id = in.ReadUInt32();
 	}
 
 	virtual IEventDataPtr VCopy() const
 	{
-		return IEventDataPtr(TYW_NEW EvtData_Modified_Render_Component(m_id));
+		return MakeEvent<EvtData_Modified_Render_Component>(m_id);
 	}
 
 	virtual const char* GetName(void) const
@@ -309,7 +307,7 @@ public:
 //---------------------------------------------------------------------------------------------------------------------
 // EvtData_Environment_Loaded - this event is sent when a new game is started
 //---------------------------------------------------------------------------------------------------------------------
-class TYWRENDERER_API EvtData_Environment_Loaded : public BaseEventData
+class EvtData_Environment_Loaded : public BaseEventData
 {
 public:
 	static const EventType sk_EventType;
@@ -318,7 +316,7 @@ public:
 	virtual const EventType& VGetEventType(void) const { return sk_EventType; }
 	virtual IEventDataPtr VCopy(void) const
 	{
-		return IEventDataPtr(TYW_NEW EvtData_Environment_Loaded());
+		return MakeEvent<EvtData_Environment_Loaded>();
 	}
 	virtual const char* GetName(void) const { return "EvtData_Environment_Loaded"; }
 };
@@ -334,7 +332,7 @@ public:
 // FUTURE_WORK: It would be an interesting idea to add a "Private" type of event that is addressed only to a specific 
 //              listener. Of course, that might be a really dumb idea too - someone will have to try it!
 //---------------------------------------------------------------------------------------------------------------------
-class TYWRENDERER_API EvtData_Remote_Environment_Loaded : public BaseEventData
+class EvtData_Remote_Environment_Loaded : public BaseEventData
 {
 public:
 	static const EventType sk_EventType;
@@ -343,7 +341,7 @@ public:
 	virtual const EventType& VGetEventType(void) const { return sk_EventType; }
 	virtual IEventDataPtr VCopy(void) const
 	{
-		return IEventDataPtr(TYW_NEW EvtData_Remote_Environment_Loaded());
+		return MakeEvent<EvtData_Remote_Environment_Loaded>();
 	}
 	virtual const char* GetName(void) const { return "EvtData_Remote_Environment_Loaded"; }
 };
@@ -352,7 +350,7 @@ public:
 //---------------------------------------------------------------------------------------------------------------------
 // EvtData_Request_Start_Game - this is sent by the authoritative game logic to all views so they will load a game level.
 //---------------------------------------------------------------------------------------------------------------------
-class TYWRENDERER_API EvtData_Request_Start_Game : public BaseEventData
+class EvtData_Request_Start_Game : public BaseEventData
 {
 
 public:
@@ -367,7 +365,7 @@ public:
 
 	virtual IEventDataPtr VCopy() const
 	{
-		return IEventDataPtr(TYW_NEW EvtData_Request_Start_Game());
+		return MakeEvent<EvtData_Request_Start_Game>();
 	}
 
 	virtual const char* GetName(void) const
@@ -409,19 +407,16 @@ virtual IEventDataPtr VCopy() const
 return IEventDataPtr( GCC_NEW EvtData_Game_State( m_gameState, m_parameter ) );
 }
 
-virtual void VSerialize(std::ostrstream &out) const
+virtual void VSerialize(EventWriter& out) const
 {
-const int tempVal = static_cast< int >( m_gameState );
-out << tempVal << " ";
-out << m_parameter;
+out.WriteInt32(static_cast< int >( m_gameState ));
+out.WriteString(m_parameter);
 }
 
-virtual void VDeserialize(std::istrstream &in)
+virtual void VDeserialize(EventReader& in)
 {
-int tempVal;
-in >> tempVal;
-m_gameState = static_cast<BaseGameState>( tempVal );
-in >> m_parameter;
+m_gameState = static_cast<BaseGameState>( in.ReadInt32() );
+m_parameter = in.ReadString();
 }
 
 virtual const char* GetName(void) const
@@ -447,7 +442,7 @@ return m_parameter;
 // 
 //   Sent whenever a new client attaches to a game logic acting as a server				
 //---------------------------------------------------------------------------------------------------------------------
-class TYWRENDERER_API EvtData_Remote_Client : public BaseEventData
+class EvtData_Remote_Client : public BaseEventData
 {
 	int m_socketId;
 	int m_ipAddress;
@@ -473,7 +468,7 @@ public:
 
 	virtual IEventDataPtr VCopy() const
 	{
-		return IEventDataPtr(TYW_NEW EvtData_Remote_Client(m_socketId, m_ipAddress));
+		return MakeEvent<EvtData_Remote_Client>(m_socketId, m_ipAddress);
 	}
 
 	virtual const char* GetName(void) const
@@ -481,16 +476,16 @@ public:
 		return "EvtData_Remote_Client";
 	}
 
-	virtual void VSerialize(std::ostrstream &out) const
+	virtual void VSerialize(EventWriter& out) const
 	{
-		out << m_socketId << " ";
-		out << m_ipAddress;
+		out.WriteInt32(m_socketId);
+		out.WriteInt32(m_ipAddress);
 	}
 
-	virtual void VDeserialize(std::istrstream &in)
+	virtual void VDeserialize(EventReader& in)
 	{
-		in >> m_socketId;
-		in >> m_ipAddress;
+		m_socketId = in.ReadInt32();
+		m_ipAddress = in.ReadInt32();
 	}
 
 	int GetSocketId(void) const
@@ -508,7 +503,7 @@ public:
 //---------------------------------------------------------------------------------------------------------------------
 // EvtData_Update_Tick - sent by the game logic each game tick
 //---------------------------------------------------------------------------------------------------------------------
-class TYWRENDERER_API EvtData_Update_Tick : public BaseEventData
+class EvtData_Update_Tick : public BaseEventData
 {
 	int m_DeltaMilliseconds;
 
@@ -527,10 +522,10 @@ public:
 
 	virtual IEventDataPtr VCopy() const
 	{
-		return IEventDataPtr(TYW_NEW EvtData_Update_Tick(m_DeltaMilliseconds));
+		return MakeEvent<EvtData_Update_Tick>(m_DeltaMilliseconds);
 	}
 
-	virtual void VSerialize(std::ostrstream & out)
+	virtual void VSerialize(EventWriter& out) const
 	{
 		//GCC_ERROR("You should not be serializing update ticks!");
 	}
@@ -545,7 +540,7 @@ public:
 //---------------------------------------------------------------------------------------------------------------------
 // EvtData_Network_Player_Actor_Assignment - sent by the server to the clients when a network view is assigned a player number
 //---------------------------------------------------------------------------------------------------------------------
-class TYWRENDERER_API EvtData_Network_Player_Actor_Assignment : public BaseEventData
+class EvtData_Network_Player_Actor_Assignment : public BaseEventData
 {
 	unsigned int m_ActorId;
 	int m_SocketId;
@@ -572,7 +567,7 @@ public:
 
 	virtual IEventDataPtr VCopy() const
 	{
-		return IEventDataPtr(TYW_NEW EvtData_Network_Player_Actor_Assignment(m_ActorId, m_SocketId));
+		return MakeEvent<EvtData_Network_Player_Actor_Assignment>(m_ActorId, m_SocketId);
 	}
 
 	virtual const char* GetName(void) const
@@ -581,16 +576,16 @@ public:
 	}
 
 
-	virtual void VSerialize(std::ostrstream &out) const
+	virtual void VSerialize(EventWriter& out) const
 	{
-		out << m_ActorId << " ";
-		out << m_SocketId;
+		out.WriteUInt32(m_ActorId);
+		out.WriteInt32(m_SocketId);
 	}
 
-	virtual void VDeserialize(std::istrstream &in)
+	virtual void VDeserialize(EventReader& in)
 	{
-		in >> m_ActorId;
-		in >> m_SocketId;
+		m_ActorId = in.ReadUInt32();
+		m_SocketId = in.ReadInt32();
 	}
 
 	unsigned int GetActorId(void) const
@@ -608,7 +603,7 @@ public:
 //---------------------------------------------------------------------------------------------------------------------
 // EvtData_Decompress_Request - sent to a multithreaded game event listener to decompress something in the resource file
 //---------------------------------------------------------------------------------------------------------------------
-class TYWRENDERER_API EvtData_Decompress_Request : public BaseEventData
+class EvtData_Decompress_Request : public BaseEventData
 {
 	std::wstring m_zipFileName;
 	std::string m_fileName;
@@ -629,10 +624,10 @@ public:
 
 	virtual IEventDataPtr VCopy() const
 	{
-		return IEventDataPtr(TYW_NEW EvtData_Decompress_Request(m_zipFileName, m_fileName));
+		return MakeEvent<EvtData_Decompress_Request>(m_zipFileName, m_fileName);
 	}
 
-	virtual void VSerialize(std::ostrstream & out)
+	virtual void VSerialize(EventWriter& out) const
 	{
 		//GCC_ERROR("You should not be serializing decompression requests!");
 	}
@@ -656,7 +651,7 @@ public:
 //---------------------------------------------------------------------------------------------------------------------
 // EvtData_Decompression_Progress - sent by the decompression thread to report progress
 //---------------------------------------------------------------------------------------------------------------------
-class TYWRENDERER_API EvtData_Decompression_Progress : public BaseEventData
+class EvtData_Decompression_Progress : public BaseEventData
 {
 	int m_progress;
 	std::wstring m_zipFileName;
@@ -681,10 +676,10 @@ public:
 
 	virtual IEventDataPtr VCopy() const
 	{
-		return IEventDataPtr(TYW_NEW EvtData_Decompression_Progress(m_progress, m_zipFileName, m_fileName, m_buffer));
+		return MakeEvent<EvtData_Decompression_Progress>(m_progress, m_zipFileName, m_fileName, m_buffer);
 	}
 
-	virtual void VSerialize(std::ostrstream & out)
+	virtual void VSerialize(EventWriter& out) const
 	{
 		//GCC_ERROR("You should not be serializing decompression progress events!");
 	}
@@ -703,7 +698,7 @@ public:
 // It can be sent from script or via code.
 // This event is also sent from the server game logic to client logics AFTER it has created a new actor. The logics will allow follow suit to stay in sync.
 //---------------------------------------------------------------------------------------------------------------------
-class TYWRENDERER_API EvtData_Request_New_Actor : public BaseEventData
+class EvtData_Request_New_Actor : public BaseEventData
 {
 	std::string m_actorResource;
 	bool m_hasInitialTransform;
@@ -743,45 +738,33 @@ public:
 		return sk_EventType;
 	}
 
-	virtual void VDeserialize(std::istrstream & in)
+	virtual void VDeserialize(EventReader& in)
 	{
-		in >> m_actorResource;
-		in >> m_hasInitialTransform;
+		m_actorResource = in.ReadString();
+		m_hasInitialTransform = in.ReadBool();
 		if (m_hasInitialTransform)
 		{
-			for (int i = 0; i<4; ++i)
-			{
-				for (int j = 0; j<4; ++j)
-				{
-					in >> m_initialTransform[i][j];
-				}
-			}
+			m_initialTransform = in.ReadMatrix();
 		}
-		in >> m_serverActorId;
-		in >> m_viewId;
+		m_serverActorId = in.ReadUInt32();
+		m_viewId = in.ReadUInt32();
 	}
 
 	virtual IEventDataPtr VCopy() const
 	{
-		return IEventDataPtr(TYW_NEW EvtData_Request_New_Actor(m_actorResource, (m_hasInitialTransform) ? &m_initialTransform : NULL, m_serverActorId, m_viewId));
+		return MakeEvent<EvtData_Request_New_Actor>(m_actorResource, (m_hasInitialTransform) ? &m_initialTransform : NULL, m_serverActorId, m_viewId);
 	}
 
-	virtual void VSerialize(std::ostrstream & out) const
+	virtual void VSerialize(EventWriter& out) const
 	{
-		out << m_actorResource << " ";
-		out << m_hasInitialTransform << " ";
+		out.WriteString(m_actorResource);
+		out.WriteBool(m_hasInitialTransform);
 		if (m_hasInitialTransform)
 		{
-			for (int i = 0; i<4; ++i)
-			{
-				for (int j = 0; j<4; ++j)
-				{
-					out << m_initialTransform[i][j] << " ";
-				}
-			}
+			out.WriteMatrix(m_initialTransform);
 		}
-		out << m_serverActorId << " ";
-		out << m_viewId << " ";
+		out.WriteUInt32(m_serverActorId);
+		out.WriteUInt32(m_viewId);
 	}
 
 	virtual const char* GetName(void) const { return "EvtData_Request_New_Actor"; }
@@ -806,70 +789,70 @@ namespace Event
 {
 
 
-	TYWRENDERER_API inline const EventType Get_EvtData_Environment_Loaded()
+	inline const EventType Get_EvtData_Environment_Loaded()
 	{
 		return EvtData_Environment_Loaded::sk_EventType;
 	}
 
-	TYWRENDERER_API inline const EventType Get_EvtData_Remote_Environment_Loaded()
+	inline const EventType Get_EvtData_Remote_Environment_Loaded()
 	{
 		return EvtData_Remote_Environment_Loaded::sk_EventType;
 	}
 
 
-	TYWRENDERER_API inline const EventType& Get_EvtData_New_Actor()
+	inline const EventType& Get_EvtData_New_Actor()
 	{
 		return EvtData_New_Actor::sk_EventType;
 	}
 
-	TYWRENDERER_API inline const EventType Get_EvtData_Move_Actor()
+	inline const EventType Get_EvtData_Move_Actor()
 	{
 		return EvtData_Move_Actor::sk_EventType;
 	}
 
 
-	TYWRENDERER_API inline const EventType Get_EvtData_Destroy_Actor()
+	inline const EventType Get_EvtData_Destroy_Actor()
 	{
 		return EvtData_Destroy_Actor::sk_EventType;
 	}
 
-	TYWRENDERER_API inline const EventType Get_EvtData_New_Render_Component()
+	inline const EventType Get_EvtData_New_Render_Component()
 	{
 		return EvtData_New_Render_Component::sk_EventType;
 	}
 
 
-	TYWRENDERER_API inline const EventType Get_EvtData_Modified_Render_Component()
+	inline const EventType Get_EvtData_Modified_Render_Component()
 	{
 		return EvtData_Modified_Render_Component::sk_EventType;
 	}
 
-	TYWRENDERER_API inline const EventType Get_EvtData_Request_Start_Game()
+	inline const EventType Get_EvtData_Request_Start_Game()
 	{
 		return EvtData_Request_Start_Game::sk_EventType;
 	}
 
-	TYWRENDERER_API inline const EventType Get_EvtData_Remote_Client()
+	inline const EventType Get_EvtData_Remote_Client()
 	{
 		return EvtData_Remote_Client::sk_EventType;
 	}
 
-	TYWRENDERER_API inline const EventType Get_EvtData_Update_Tick()
+	inline const EventType Get_EvtData_Update_Tick()
 	{
 		return EvtData_Update_Tick::sk_EventType;
 	}
 
-	TYWRENDERER_API inline const EventType Get_EvtData_Decompress_Request()
+	inline const EventType Get_EvtData_Decompress_Request()
 	{
 		return EvtData_Decompress_Request::sk_EventType;
 	}
 
-	TYWRENDERER_API inline const EventType Get_EvtData_Decompression_Progress()
+	inline const EventType Get_EvtData_Decompression_Progress()
 	{
 		return EvtData_Decompression_Progress::sk_EventType;
 	}
 
-	TYWRENDERER_API inline const EventType Get_EvtData_Request_New_Actor()
+	inline const EventType Get_EvtData_Request_New_Actor()
 	{
 		return EvtData_Request_New_Actor::sk_EventType;
 	}
@@ -1,7 +1,9 @@
-#include  <RendererPch\stdafx.h>
+#include  <RendererPch/stdafx.h>
 #include "IEventManager.h"
 
 
+EventFactory g_eventFactory;
+
 
 
 IEventManager::IEventManager()
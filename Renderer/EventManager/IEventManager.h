@@ -1,20 +1,15 @@
 #pragma once
+#include "MPSCQueue.h"
+#include "EventPool.h"
+#include "EventStream.h"
 
 
 class IEventData;
 
 typedef unsigned long EventType;
 typedef std::shared_ptr<IEventData> IEventDataPtr;
-typedef std::function<void (IEventDataPtr)> EventListenerDelegate;
-typedef concurrent_queue<IEventDataPtr> ThreadSafeEventQueue;
-
-//---------------------------------------------------------------------------------------------------------------------
-// Macro for event registration
-//---------------------------------------------------------------------------------------------------------------------
-extern TYWRENDERER_API GenericObjectFactory<IEventData, EventType> g_eventFactory;
-#define REGISTER_EVENT(eventClass) g_eventFactory.Register<eventClass>(eventClass::sk_EventType)
-#define CREATE_EVENT(eventType) g_eventFactory.Create(eventType)
-
+typedef std::function<void (const IEventDataPtr&)> EventListenerDelegate;
+typedef MPSCQueue<IEventDataPtr> ThreadSafeEventQueue;
 
 class IEventData
 {
@@ -22,14 +17,76 @@ public:
 	virtual ~IEventData(void) {}
 	virtual const EventType& VGetEventType(void) const = 0;
 	virtual float GetTimeStamp(void) const = 0;
-	virtual void VSerialize(std::ostrstream& out) const = 0;
-	virtual void VDeserialize(std::istrstream& in) = 0;
+	virtual void VSerialize(EventWriter& out) const = 0;
+	virtual void VDeserialize(EventReader& in) = 0;
 	virtual IEventDataPtr VCopy(void) const = 0;
 	virtual const char* GetName(void) const = 0;
 
+	// Events of a coalescing type that return the same key replace each other in the queue,
+	// only the latest one is dispatched (see IEventManager::VSetCoalescing)
+	virtual bool VGetCoalesceKey(uint64_t& key) const { return false; }
+
 	//GCC_MEMORY_WATCHER_DECLARATION();
 };
 
+
+/*
+	Creates an event in the EventPool. Event and reference counts share one pooled block,
+	so no heap allocation happens once the pool has warmed up.
+
+	@param: Args&&... args - event constructor arguments
+	@return: IEventDataPtr
+*/
+template<class T, class... Args>
+IEventDataPtr MakeEvent(Args&&... args)
+{
+	return std::allocate_shared<T>(EventAllocator<T>(), std::forward<Args>(args)...);
+}
+
+
+/*
+	EventFactory
+	Creates default constructed events from their type. Used to read events back
+	from a binary stream, so only events that can be serialized are registered.
+*/
+class EventFactory
+{
+public:
+	template<class T>
+	bool Register(const EventType& type)
+	{
+		return m_Creators.insert(std::make_pair(type, &EventFactory::Construct<T>)).second;
+	}
+
+	/*
+		@param: const EventType& type
+		@return: new event or empty pointer if the type is not registered
+	*/
+	IEventDataPtr Create(const EventType& type) const
+	{
+		auto findIt = m_Creators.find(type);
+		return (findIt != m_Creators.end()) ? findIt->second() : IEventDataPtr();
+	}
+
+	bool IsRegistered(const EventType& type) const { return m_Creators.find(type) != m_Creators.end(); }
+
+private:
+	template<class T>
+	static IEventDataPtr Construct() { return MakeEvent<T>(); }
+
+	typedef IEventDataPtr (*CreateEventFn)();
+	std::unordered_map<EventType, CreateEventFn> m_Creators;
+};
+
+
+//---------------------------------------------------------------------------------------------------------------------
+// Macro for event registration
+//---------------------------------------------------------------------------------------------------------------------
+extern EventFactory g_eventFactory;
+#define REGISTER_EVENT(eventClass) g_eventFactory.Register<eventClass>(eventClass::sk_EventType)
+#define CREATE_EVENT(eventType) g_eventFactory.Create(eventType)
+
+
 class BaseEventData : public IEventData
 {
 	const float m_timeStamp;
@@ -42,16 +99,17 @@ public:
 
 	float GetTimeStamp(void) const { return m_timeStamp; }
 
-	// Serializing for network input / output
-	virtual void VSerialize(std::ostrstream &out) const { }
-	virtual void VDeserialize(std::istrstream& in) { }
+	// Serializing for network input / output and event captures
+	virtual void VSerialize(EventWriter& out) const { }
+	virtual void VDeserialize(EventReader& in) { }
 };
 
 
 class IEventManager
 {
 public:
-	enum eConstants { kINFINITE = 0xffffffff };
+	// VUpdate budget that processes every queued event
+	static const uint64_t kINFINITE = UINT64_MAX;
 
 	IEventManager();
 	virtual ~IEventManager();
@@ -71,10 +129,19 @@ public:
 	// there's enough time.
 	virtual bool VQueueEvent(const IEventDataPtr& pEvent) = 0;
 
+	// Same as VQueueEvent but may be called from any thread (loaders, workers, audio). The event is moved into
+	// the active queue at the start of the next VUpdate(). Returns false if the thread safe queue is full.
+	virtual bool VThreadSafeQueueEvent(const IEventDataPtr& pEvent) = 0;
+
 	// returns true if the event was found and removed, false otherwise
 	virtual bool VAbortEvent(const EventType& type, bool allOfType = false) = 0;
 
+	// When enabled, queuing an event whose VGetCoalesceKey() matches one already queued drops the older event.
+	// Call during initialization, not from inside a listener.
+	virtual void VSetCoalescing(const EventType& type, bool bEnable) = 0;
+
 
 	// returns true if all messages ready for processing were completed, false otherwise (e.g. timeout )
-	virtual bool VUpdate(unsigned long maxMillis = 0xffffffff) = 0;
+	// Budget is in microseconds, kINFINITE processes everything.
+	virtual bool VUpdate(uint64_t maxMicroSec = kINFINITE) = 0;
 };
\ No newline at end of file
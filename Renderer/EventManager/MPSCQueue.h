@@ -0,0 +1,161 @@
+#pragma once
+
+
+/*
+	Counters of a MPSCQueue. Pushed and popped are derived from the ring positions,
+	so producers pay nothing extra for them.
+*/
+struct MPSCQueueStats
+{
+	uint64_t	numPushed;
+	uint64_t	numPopped;
+	uint64_t	numFailedPushes;	// queue was full
+	uint32_t	maxOccupancy;		// highest number of waiting items seen by the consumer
+	uint32_t	capacity;
+};
+
+
+/*
+	MPSCQueue
+	Bounded lock-free ring buffer for many producers and a single consumer.
+
+	Every slot carries a sequence number. A producer claims a position with one
+	CAS on the enqueue position, writes the value and publishes it by storing
+	position + 1 into the slot sequence. The consumer reads the slot once the
+	sequence says it is published and hands it back by storing position + capacity.
+	Producers never wait for each other; a full queue makes TryPush fail instead of blocking.
+
+	Capacity is rounded up to a power of two.
+*/
+template<class T>
+class MPSCQueue
+{
+public:
+	/*
+		@param: uint32_t capacity
+	*/
+	explicit MPSCQueue(uint32_t capacity = 4096):
+		m_pSlots(nullptr),
+		m_Mask(0),
+		m_EnqueuePos(0),
+		m_FailedPushes(0),
+		m_DequeuePos(0),
+		m_MaxOccupancy(0)
+	{
+		uint32_t size = 2;
+		while (size < capacity)
+		{
+			size <<= 1;
+		}
+
+		m_Mask = size - 1;
+		m_pSlots = TYW_NEW Slot[size];
+		for (uint32_t i = 0; i < size; i++)
+		{
+			m_pSlots[i].sequence.store(i, std::memory_order_relaxed);
+		}
+	}
+
+	~MPSCQueue()
+	{
+		SAFE_DELETE_ARRAY(m_pSlots);
+	}
+
+	/*
+		Safe to call from any thread
+
+		@param: const T& value
+		@return: false if the queue is full
+	*/
+	bool TryPush(const T& value)
+	{
+		uint64_t pos = m_EnqueuePos.load(std::memory_order_relaxed);
+		Slot* pSlot;
+		for (;;)
+		{
+			pSlot = &m_pSlots[pos & m_Mask];
+			const uint64_t sequence = pSlot->sequence.load(std::memory_order_acquire);
+			const int64_t diff = static_cast<int64_t>(sequence) - static_cast<int64_t>(pos);
+			if (diff == 0)
+			{
+				if (m_EnqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+					break;
+			}
+			else if (diff < 0)
+			{
+				//Consumer has not released this slot yet
+				m_FailedPushes.fetch_add(1, std::memory_order_relaxed);
+				return false;
+			}
+			else
+			{
+				//Another producer took this position
+				pos = m_EnqueuePos.load(std::memory_order_relaxed);
+			}
+		}
+
+		pSlot->value = value;
+		pSlot->sequence.store(pos + 1, std::memory_order_release);
+		return true;
+	}
+
+	/*
+		Consumer thread only
+
+		@param: T& value
+		@return: false if nothing is published
+	*/
+	bool TryPop(T& value)
+	{
+		Slot* pSlot = &m_pSlots[m_DequeuePos & m_Mask];
+		if (pSlot->sequence.load(std::memory_order_acquire) != m_DequeuePos + 1)
+			return false;
+
+		const uint32_t occupancy = static_cast<uint32_t>(m_EnqueuePos.load(std::memory_order_relaxed) - m_DequeuePos);
+		m_MaxOccupancy = std::max(m_MaxOccupancy, occupancy);
+
+		value = std::move(pSlot->value);
+		pSlot->value = T();
+		pSlot->sequence.store(m_DequeuePos + m_Mask + 1, std::memory_order_release);
+		m_DequeuePos++;
+		return true;
+	}
+
+	// Consumer thread only
+	MPSCQueueStats GetStats() const
+	{
+		MPSCQueueStats stats;
+		stats.numPushed = m_EnqueuePos.load(std::memory_order_relaxed);
+		stats.numPopped = m_DequeuePos;
+		stats.numFailedPushes = m_FailedPushes.load(std::memory_order_relaxed);
+		stats.maxOccupancy = m_MaxOccupancy;
+		stats.capacity = m_Mask + 1;
+		return stats;
+	}
+
+	uint32_t GetCapacity() const { return m_Mask + 1; }
+
+private:
+	MPSCQueue(const MPSCQueue&) = delete;
+	MPSCQueue& operator=(const MPSCQueue&) = delete;
+
+	struct Slot
+	{
+		std::atomic<uint64_t>	sequence;
+		T						value;
+	};
+
+	//Producer and consumer fields live on separate cache lines
+	enum { CACHE_LINE_SIZE = 64 };
+
+	Slot*					m_pSlots;
+	uint32_t				m_Mask;
+	char					m_Pad0[CACHE_LINE_SIZE];
+
+	std::atomic<uint64_t>	m_EnqueuePos;
+	std::atomic<uint64_t>	m_FailedPushes;
+	char					m_Pad1[CACHE_LINE_SIZE];
+
+	uint64_t				m_DequeuePos;
+	uint32_t				m_MaxOccupancy;
+};
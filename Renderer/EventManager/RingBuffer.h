@@ -0,0 +1,99 @@
+#pragma once
+
+
+/*
+	RingBuffer
+	Growable double ended queue stored in one contiguous array.
+	Capacity is a power of two and only grows, so once it is big
+	enough for a frame worth of items pushing and popping never allocates.
+*/
+template<class T>
+class RingBuffer
+{
+public:
+	explicit RingBuffer(uint32_t capacity = 64):
+		m_Head(0),
+		m_Count(0)
+	{
+		uint32_t size = 2;
+		while (size < capacity)
+		{
+			size <<= 1;
+		}
+		m_Items.resize(size);
+	}
+
+	void PushBack(T&& item)
+	{
+		Reserve(m_Count + 1);
+		m_Items[(m_Head + m_Count) & Mask()] = std::move(item);
+		m_Count++;
+	}
+
+	void PushFront(T&& item)
+	{
+		Reserve(m_Count + 1);
+		m_Head = (m_Head - 1) & Mask();
+		m_Items[m_Head] = std::move(item);
+		m_Count++;
+	}
+
+	void PopFront(T& item)
+	{
+		assert(m_Count > 0);
+		item = std::move(m_Items[m_Head]);
+		m_Items[m_Head] = T();
+		m_Head = (m_Head + 1) & Mask();
+		m_Count--;
+	}
+
+	void PopBack(T& item)
+	{
+		assert(m_Count > 0);
+		const uint32_t index = (m_Head + m_Count - 1) & Mask();
+		item = std::move(m_Items[index]);
+		m_Items[index] = T();
+		m_Count--;
+	}
+
+	// Releases held items but keeps the storage
+	void Clear()
+	{
+		for (uint32_t i = 0; i < m_Count; i++)
+		{
+			m_Items[(m_Head + i) & Mask()] = T();
+		}
+		m_Head = 0;
+		m_Count = 0;
+	}
+
+	// Index 0 is the front
+	T& operator[](uint32_t index) { return m_Items[(m_Head + index) & Mask()]; }
+	const T& operator[](uint32_t index) const { return m_Items[(m_Head + index) & Mask()]; }
+
+	uint32_t Size() const { return m_Count; }
+	bool Empty() const { return m_Count == 0; }
+	uint32_t Capacity() const { return static_cast<uint32_t>(m_Items.size()); }
+
+private:
+	uint32_t Mask() const { return static_cast<uint32_t>(m_Items.size()) - 1; }
+
+	void Reserve(uint32_t count)
+	{
+		if (count <= m_Items.size())
+			return;
+
+		std::vector<T> items(m_Items.size() * 2);
+		for (uint32_t i = 0; i < m_Count; i++)
+		{
+			items[i] = std::move(m_Items[(m_Head + i) & Mask()]);
+		}
+		m_Items.swap(items);
+		m_Head = 0;
+	}
+
+private:
+	std::vector<T>	m_Items;
+	uint32_t		m_Head;
+	uint32_t		m_Count;
+};
@@ -10,7 +10,7 @@
 	Descriptors enum for drawVer
 	If you have vert,norm, and uv. Then use for VkBufferObject when subimiting (Vertex | Normal | Uv) etc....
 */
-enum drawVertFlags
+enum drawVertFlags : int
 {
 	Vertex		= 1 << 1,
 	Normal		= 1 << 2,
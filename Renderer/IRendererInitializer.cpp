@@ -3,7 +3,7 @@
 *	GitHub repository - https://github.com/TywyllSoftware/TywRenderer
 *	This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
 */
-#include <RendererPch\stdafx.h>
+#include <RendererPch/stdafx.h>
 
 
 //Renderer Includes
@@ -0,0 +1,346 @@
+/*
+*	Copyright 2015-2016 Tomas Mikalauskas. All rights reserved.
+*	GitHub repository - https://github.com/TywyllSoftware/TywRenderer
+*	This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+#include <RendererPch/stdafx.h>
+
+//JobSystem Includes
+#include "JobSystem.h"
+
+//Profiler Includes
+#include "Profiler/CpuProfiler.h"
+
+
+JobSystem* jobSystem = nullptr;
+
+
+//Worker of the thread that is currently running. Jobs submitted from
+//a worker go to its own deque, everyone else uses the injection queue
+static thread_local JobSystem*	t_pJobSystem = nullptr;
+static thread_local uint32_t	t_WorkerIndex = 0;
+
+static const uint32_t PARALLEL_FOR_BATCHES_PER_THREAD = 4;
+
+
+JobSystem::JobSystem(uint32_t numThreads):
+	m_PendingJobs(0),
+	m_NumSleeping(0),
+	m_NumContinuations(0),
+	m_NumForeignExecuted(0),
+	m_NextVictim(0),
+	m_bRunning(true)
+{
+	if (numThreads == 0)
+	{
+		numThreads = std::max(1u, std::thread::hardware_concurrency());
+	}
+
+	//All deques must exist before the first worker starts stealing
+	m_Workers.reserve(numThreads);
+	for (uint32_t i = 0; i < numThreads; i++)
+	{
+		m_Workers.emplace_back(TYW_NEW Worker);
+	}
+
+	t_pJobSystem = this;
+	t_WorkerIndex = 0;
+
+	for (uint32_t i = 1; i < numThreads; i++)
+	{
+		m_Workers[i]->thread = std::thread(&JobSystem::WorkerThread, this, i);
+	}
+}
+
+
+JobSystem::~JobSystem()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_WakeLock);
+		m_bRunning = false;
+	}
+	m_WakeCondition.notify_all();
+
+	for (auto& worker : m_Workers)
+	{
+		if (worker->thread.joinable())
+		{
+			worker->thread.join();
+		}
+	}
+
+	if (t_pJobSystem == this)
+	{
+		t_pJobSystem = nullptr;
+	}
+}
+
+
+uint32_t JobSystem::GetWorkerIndex() const
+{
+	return (t_pJobSystem == this) ? t_WorkerIndex : UINT32_MAX;
+}
+
+
+void JobSystem::Submit(const JobFunction& job, JobCounter* counter)
+{
+	if (counter)
+	{
+		counter->value.fetch_add(1);
+	}
+
+	Push(TYW_NEW Job{ job, counter });
+}
+
+
+void JobSystem::SubmitAfter(JobCounter* dependency, const JobFunction& job, JobCounter* counter)
+{
+	if (counter)
+	{
+		counter->value.fetch_add(1);
+	}
+
+	{
+		//Same lock the last finishing job of the dependency takes, so the continuation is either parked or pushed here
+		std::lock_guard<std::mutex> lock(dependency->lock);
+		if (dependency->value.load() > 0)
+		{
+			dependency->continuations.emplace_back(job, counter);
+			m_NumContinuations.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+	}
+
+	Push(TYW_NEW Job{ job, counter });
+}
+
+
+void JobSystem::Push(Job* pJob)
+{
+	const uint32_t workerIndex = GetWorkerIndex();
+	if (workerIndex != UINT32_MAX)
+	{
+		Worker& worker = *m_Workers[workerIndex];
+		if (!worker.deque.Push(pJob))
+		{
+			worker.numInline.fetch_add(1, std::memory_order_relaxed);
+			Execute(pJob, workerIndex);
+			return;
+		}
+	}
+	else
+	{
+		std::lock_guard<std::mutex> lock(m_InjectLock);
+		m_InjectedJobs.push_back(pJob);
+	}
+
+	//Sleeping workers check m_PendingJobs under the wake lock after they registered in m_NumSleeping,
+	//so either they see this job or this thread sees them and wakes one up
+	m_PendingJobs.fetch_add(1);
+	if (m_NumSleeping.load() > 0)
+	{
+		std::lock_guard<std::mutex> lock(m_WakeLock);
+		m_WakeCondition.notify_one();
+	}
+}
+
+
+void JobSystem::Wait(JobCounter* counter)
+{
+	const uint32_t workerIndex = GetWorkerIndex();
+
+	while (counter->value.load() > 0)
+	{
+		if (Job* pJob = FindJob(workerIndex))
+		{
+			Execute(pJob, workerIndex);
+		}
+		else
+		{
+			//Remaining jobs are running on other threads
+			std::this_thread::yield();
+		}
+	}
+
+	//The job that brought the counter to zero may still hold its lock
+	std::lock_guard<std::mutex> lock(counter->lock);
+}
+
+
+void JobSystem::ParallelFor(uint32_t count, uint32_t minBatchSize, const ParallelForFunction& function)
+{
+	if (count == 0)
+		return;
+
+	const uint32_t numBatches = GetThreadCount() * PARALLEL_FOR_BATCHES_PER_THREAD;
+	const uint32_t batchSize = std::max(std::max(1u, minBatchSize), (count + numBatches - 1) / numBatches);
+	if (GetThreadCount() == 1 || batchSize >= count)
+	{
+		function(0, count);
+		return;
+	}
+
+	JobCounter counter;
+	for (uint32_t first = 0; first < count; first += batchSize)
+	{
+		const uint32_t last = std::min(first + batchSize, count);
+		Submit([&function, first, last]()
+		{
+			function(first, last);
+		}, &counter);
+	}
+	Wait(&counter);
+}
+
+
+void JobSystem::WorkerThread(uint32_t workerIndex)
+{
+	t_pJobSystem = this;
+	t_WorkerIndex = workerIndex;
+
+	while (m_bRunning)
+	{
+		if (Job* pJob = FindJob(workerIndex))
+		{
+			Execute(pJob, workerIndex);
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(m_WakeLock);
+		m_NumSleeping.fetch_add(1);
+		m_WakeCondition.wait(lock, [this] { return !m_bRunning || m_PendingJobs.load() > 0; });
+		m_NumSleeping.fetch_sub(1);
+	}
+}
+
+
+JobSystem::Job* JobSystem::FindJob(uint32_t workerIndex)
+{
+	Job* pJob = nullptr;
+
+	//Newest job of our own deque first. Its data is most likely still in cache
+	if (workerIndex != UINT32_MAX)
+	{
+		pJob = m_Workers[workerIndex]->deque.Pop();
+	}
+
+	if (!pJob)
+	{
+		std::lock_guard<std::mutex> lock(m_InjectLock);
+		if (!m_InjectedJobs.empty())
+		{
+			pJob = m_InjectedJobs.front();
+			m_InjectedJobs.pop_front();
+		}
+	}
+
+	//Oldest job of another deque. Usually the biggest chunk of work
+	if (!pJob)
+	{
+		const uint32_t count = GetThreadCount();
+		const uint32_t start = m_NextVictim.fetch_add(1, std::memory_order_relaxed);
+		for (uint32_t i = 0; i < count && !pJob; i++)
+		{
+			const uint32_t victim = (start + i) % count;
+			if (victim != workerIndex)
+			{
+				pJob = m_Workers[victim]->deque.Steal();
+			}
+		}
+
+		if (pJob && workerIndex != UINT32_MAX)
+		{
+			m_Workers[workerIndex]->numStolen.fetch_add(1, std::memory_order_relaxed);
+		}
+	}
+
+	if (pJob)
+	{
+		m_PendingJobs.fetch_sub(1);
+	}
+	return pJob;
+}
+
+
+void JobSystem::Execute(Job* pJob, uint32_t workerIndex)
+{
+	{
+		TYW_PROFILE_SCOPE("Job");
+		pJob->function();
+	}
+
+	JobCounter* counter = pJob->counter;
+	SAFE_DELETE(pJob);
+
+	if (workerIndex != UINT32_MAX)
+	{
+		m_Workers[workerIndex]->numExecuted.fetch_add(1, std::memory_order_relaxed);
+	}
+	else
+	{
+		m_NumForeignExecuted.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	if (!counter)
+		return;
+
+	//Decrements that do not reach zero need no lock. The last one takes the lock,
+	//so SubmitAfter and Wait never see the counter halfway through releasing
+	int32_t value = counter->value.load();
+	while (value > 1)
+	{
+		if (counter->value.compare_exchange_weak(value, value - 1))
+			return;
+	}
+	ReleaseContinuations(counter);
+}
+
+
+void JobSystem::ReleaseContinuations(JobCounter* counter)
+{
+	std::vector<std::pair<JobFunction, JobCounter*>> continuations;
+	{
+		std::lock_guard<std::mutex> lock(counter->lock);
+		if (counter->value.fetch_sub(1) == 1)
+		{
+			continuations.swap(counter->continuations);
+		}
+	}
+
+	//Counter may be gone by now, only the local copy is used
+	for (auto& continuation : continuations)
+	{
+		Push(TYW_NEW Job{ continuation.first, continuation.second });
+	}
+}
+
+
+JobSystemStats JobSystem::GetStats() const
+{
+	JobSystemStats stats;
+	stats.numExecuted = m_NumForeignExecuted.load(std::memory_order_relaxed);
+	stats.numStolen = 0;
+	stats.numInline = 0;
+	for (auto& worker : m_Workers)
+	{
+		stats.numExecuted += worker->numExecuted.load(std::memory_order_relaxed);
+		stats.numStolen += worker->numStolen.load(std::memory_order_relaxed);
+		stats.numInline += worker->numInline.load(std::memory_order_relaxed);
+	}
+	stats.numContinuations = m_NumContinuations.load(std::memory_order_relaxed);
+	stats.numThreads = GetThreadCount();
+	return stats;
+}
+
+
+void ParallelFor(uint32_t count, uint32_t minBatchSize, const ParallelForFunction& function)
+{
+	if (jobSystem)
+	{
+		jobSystem->ParallelFor(count, minBatchSize, function);
+	}
+	else if (count > 0)
+	{
+		function(0, count);
+	}
+}
@@ -0,0 +1,172 @@
+/*
+*	Copyright 2015-2016 Tomas Mikalauskas. All rights reserved.
+*	GitHub repository - https://github.com/TywyllSoftware/TywRenderer
+*	This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+#pragma once
+#include "WorkStealingDeque.h"
+
+
+typedef std::function<void()> JobFunction;
+
+// Called with a [first, last) range of indices
+typedef std::function<void(uint32_t first, uint32_t last)> ParallelForFunction;
+
+
+/*
+	JobCounter
+	Every submitted job decrements its counter once it finished.
+	Waiting on a counter is the fork/join barrier.
+
+	Jobs submitted with JobSystem::SubmitAfter are parked on the counter
+	and released by the job that brings it to zero.
+*/
+struct JobCounter
+{
+	JobCounter() : value(0) {}
+	std::atomic<int32_t> value;
+
+	std::mutex										lock;
+	std::vector<std::pair<JobFunction, JobCounter*>>	continuations;
+};
+
+
+/*
+	Totals since the job system was created
+*/
+struct JobSystemStats
+{
+	uint64_t	numExecuted;
+	uint64_t	numStolen;			// taken from another thread's deque
+	uint64_t	numInline;			// deque was full, ran on the submitting thread
+	uint64_t	numContinuations;
+	uint32_t	numThreads;
+};
+
+
+/*
+	JobSystem
+	Fixed pool of worker threads. Every worker owns a Chase-Lev deque. A worker
+	pops jobs from the bottom of its own deque and, when it runs dry, steals from
+	the top of the other deques. The thread that created the job system owns
+	deque 0. Threads outside the pool submit through a locked injection queue.
+
+	The thread that waits on a counter helps executing jobs, so JobSystem(1)
+	runs everything inline on the caller.
+*/
+class JobSystem
+{
+public:
+	/*
+		@param: uint32_t numThreads - total threads including the calling thread.
+				0 picks std::thread::hardware_concurrency()
+	*/
+	explicit JobSystem(uint32_t numThreads = 0);
+	~JobSystem();
+
+	/*
+		Queues a job. The counter is incremented right away and
+		decremented once the job finished
+
+		@param: const JobFunction& job
+		@param: JobCounter* counter
+	*/
+	void Submit(const JobFunction& job, JobCounter* counter);
+
+	/*
+		Queues a job once dependency reaches zero, without blocking the caller.
+		counter is incremented right away, so waiting on it covers the continuation
+
+		@param: JobCounter* dependency
+		@param: const JobFunction& job
+		@param: JobCounter* counter
+	*/
+	void SubmitAfter(JobCounter* dependency, const JobFunction& job, JobCounter* counter);
+
+	/*
+		Blocks until counter reaches zero. The calling thread executes
+		queued jobs while it waits
+
+		@param: JobCounter* counter
+	*/
+	void Wait(JobCounter* counter);
+
+	/*
+		Splits [0, count) into batches of at least minBatchSize indices,
+		runs them as jobs and waits for all of them
+
+		@param: uint32_t count
+		@param: uint32_t minBatchSize
+		@param: const ParallelForFunction& function
+	*/
+	void ParallelFor(uint32_t count, uint32_t minBatchSize, const ParallelForFunction& function);
+
+	// Worker threads + calling thread
+	uint32_t GetThreadCount() const { return static_cast<uint32_t>(m_Workers.size()); }
+
+	JobSystemStats GetStats() const;
+
+	// Index of the calling thread's worker in [0, GetThreadCount()) or UINT32_MAX for threads outside the pool
+	uint32_t GetWorkerIndex() const;
+
+private:
+	struct Job
+	{
+		JobFunction		function;
+		JobCounter*		counter;
+	};
+
+	struct Worker
+	{
+		Worker() : numExecuted(0), numStolen(0), numInline(0) {}
+
+		WorkStealingDeque<Job>		deque;
+		std::thread					thread;
+		std::atomic<uint64_t>		numExecuted;
+		std::atomic<uint64_t>		numStolen;
+		std::atomic<uint64_t>		numInline;
+	};
+
+	void WorkerThread(uint32_t workerIndex);
+
+	void Push(Job* pJob);
+
+	/*
+		@param: uint32_t workerIndex - UINT32_MAX for threads outside the pool
+		@return: Job* or nullptr
+	*/
+	Job* FindJob(uint32_t workerIndex);
+	void Execute(Job* pJob, uint32_t workerIndex);
+	void ReleaseContinuations(JobCounter* counter);
+
+private:
+	// Worker 0 belongs to the creating (main) thread and has no std::thread
+	std::vector<std::unique_ptr<Worker>>	m_Workers;
+
+	std::mutex								m_InjectLock;
+	std::deque<Job*>						m_InjectedJobs;
+
+	std::mutex								m_WakeLock;
+	std::condition_variable					m_WakeCondition;
+	std::atomic<int32_t>					m_PendingJobs;
+	std::atomic<int32_t>					m_NumSleeping;
+	std::atomic<uint64_t>					m_NumContinuations;
+	std::atomic<uint64_t>					m_NumForeignExecuted;
+	std::atomic<uint32_t>					m_NextVictim;
+	std::atomic<bool>						m_bRunning;
+};
+
+
+// Engine wide job system, created by the application. Nullptr runs everything serially
+extern JobSystem* jobSystem;
+
+
+/*
+	Runs function over [0, count) on the engine job system,
+	or inline on the caller when there is none
+
+	@param: uint32_t count
+	@param: uint32_t minBatchSize
+	@param: const ParallelForFunction& function
+*/
+void ParallelFor(uint32_t count, uint32_t minBatchSize, const ParallelForFunction& function);
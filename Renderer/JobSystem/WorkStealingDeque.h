@@ -0,0 +1,139 @@
+/*
+*	Copyright 2015-2016 Tomas Mikalauskas. All rights reserved.
+*	GitHub repository - https://github.com/TywyllSoftware/TywRenderer
+*	This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+#pragma once
+
+
+/*
+	WorkStealingDeque
+	Chase-Lev deque of pointers with a fixed power of two capacity.
+
+	The owning thread pushes and pops at the bottom without locks. Any other
+	thread steals from the top with a single CAS on top. The only contended
+	case is the last item, where pop and steal race on the same CAS.
+*/
+template<class T>
+class WorkStealingDeque
+{
+public:
+	/*
+		@param: uint32_t capacity - rounded up to a power of two
+	*/
+	explicit WorkStealingDeque(uint32_t capacity = 4096):
+		m_pItems(nullptr),
+		m_Mask(0),
+		m_Top(0),
+		m_Bottom(0)
+	{
+		uint32_t size = 2;
+		while (size < capacity)
+		{
+			size <<= 1;
+		}
+
+		m_Mask = size - 1;
+		m_pItems = TYW_NEW std::atomic<T*>[size];
+		for (uint32_t i = 0; i < size; i++)
+		{
+			m_pItems[i].store(nullptr, std::memory_order_relaxed);
+		}
+	}
+
+	~WorkStealingDeque()
+	{
+		SAFE_DELETE_ARRAY(m_pItems);
+	}
+
+	/*
+		Owner thread only
+
+		@param: T* pItem
+		@return: false if the deque is full
+	*/
+	bool Push(T* pItem)
+	{
+		const int64_t bottom = m_Bottom.load(std::memory_order_relaxed);
+		const int64_t top = m_Top.load(std::memory_order_acquire);
+		if (bottom - top > static_cast<int64_t>(m_Mask))
+			return false;
+
+		m_pItems[bottom & m_Mask].store(pItem, std::memory_order_relaxed);
+		m_Bottom.store(bottom + 1, std::memory_order_release);
+		return true;
+	}
+
+	/*
+		Owner thread only. Newest item first
+
+		@return: nullptr if empty
+	*/
+	T* Pop()
+	{
+		const int64_t bottom = m_Bottom.load(std::memory_order_relaxed) - 1;
+		m_Bottom.store(bottom, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		int64_t top = m_Top.load(std::memory_order_relaxed);
+
+		if (top > bottom)
+		{
+			//Empty, restore bottom
+			m_Bottom.store(bottom + 1, std::memory_order_relaxed);
+			return nullptr;
+		}
+
+		T* pItem = m_pItems[bottom & m_Mask].load(std::memory_order_relaxed);
+		if (top == bottom)
+		{
+			//Last item, a thief may take it at the same time
+			if (!m_Top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+			{
+				pItem = nullptr;
+			}
+			m_Bottom.store(bottom + 1, std::memory_order_relaxed);
+		}
+		return pItem;
+	}
+
+	/*
+		Any thread. Oldest item first
+
+		@return: nullptr if empty or another thread won the race
+	*/
+	T* Steal()
+	{
+		int64_t top = m_Top.load(std::memory_order_acquire);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		const int64_t bottom = m_Bottom.load(std::memory_order_acquire);
+		if (top >= bottom)
+			return nullptr;
+
+		T* pItem = m_pItems[top & m_Mask].load(std::memory_order_relaxed);
+		if (!m_Top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+			return nullptr;
+
+		return pItem;
+	}
+
+	// Approximate when called from other threads
+	bool Empty() const
+	{
+		return m_Bottom.load(std::memory_order_relaxed) <= m_Top.load(std::memory_order_relaxed);
+	}
+
+private:
+	WorkStealingDeque(const WorkStealingDeque&) = delete;
+	WorkStealingDeque& operator=(const WorkStealingDeque&) = delete;
+
+	enum { CACHE_LINE_SIZE = 64 };
+
+	std::atomic<T*>*		m_pItems;
+	uint32_t				m_Mask;
+	char					m_Pad0[CACHE_LINE_SIZE];
+
+	std::atomic<int64_t>	m_Top;			// thieves
+	char					m_Pad1[CACHE_LINE_SIZE];
+
+	std::atomic<int64_t>	m_Bottom;		// owner
+};
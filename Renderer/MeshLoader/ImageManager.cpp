@@ -3,13 +3,16 @@
 *	GitHub repository - https://github.com/TywyllSoftware/TywRenderer
 *	This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
 */
-#include <RendererPch\stdafx.h>
+#include <RendererPch/stdafx.h>
 
 
 //Renderer Includes
-#include "Vulkan\VulkanTextureLoader.h"
+#include "Vulkan/VulkanTextureLoader.h"
 #include "ImageManager.h"
 
+//Profiler Includes
+#include "Profiler/CpuProfiler.h"
+
 
 ImageManager* globalImage(nullptr);
 
@@ -35,6 +38,7 @@ ImageManager::~ImageManager()
 
 VkTools::VulkanTexture* ImageManager::GetImage(const std::string& name, const std::string& path, VkFormat format)
 {
+	TYW_PROFILE_FUNCTION();
 	//find image by name
 	m_it = m_images.find(name);
 
@@ -4,7 +4,7 @@
 *	This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
 */
 #pragma once
-#include <External\vulkan\vulkan.h>
+#include <External/vulkan/vulkan.h>
 
 //forward declared
 namespace VkTools
@@ -3,13 +3,13 @@
 *	GitHub repository - https://github.com/TywyllSoftware/TywRenderer
 *	This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
 */
-#include <RendererPch\stdafx.h>
+#include <RendererPch/stdafx.h>
 
 //Vulkan Includes
-#include <External\vulkan\vulkan.h>
+#include <External/vulkan/vulkan.h>
 
 //Renderer Includes
-#include "Vulkan\VulkanTextureLoader.h"
+#include "Vulkan/VulkanTextureLoader.h"
 #include "Material.h"
 
 
@@ -95,7 +95,7 @@ void Material::Clear(VkDevice device)
 	//Delete texture data from gpu
 	vkDestroyImageView(device, m_texture->view, nullptr);
 	vkDestroyImage(device, m_texture->image, nullptr);
-	vkFreeMemory(device, m_texture->deviceMemory, nullptr);
+	memoryAllocator->Free(m_texture->allocation);
 	vkDestroySampler(device, m_texture->sampler, nullptr);
 
 	//Delete 
@@ -3,10 +3,10 @@
 *	GitHub repository - https://github.com/TywyllSoftware/TywRenderer
 *	This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
 */
-#include <RendererPch\stdafx.h>
+#include <RendererPch/stdafx.h>
 
 //Vulkan Includes
-#include <External\vulkan\vulkan.h>
+#include <External/vulkan/vulkan.h>
 
 //Renderer Includes
 #include "Model_local.h"
@@ -16,11 +16,115 @@
 #include "VKRenderer.h"
 
 //Geometry data
-#include "Geometry\VertData.h"
+#include "Geometry/VertData.h"
 
 //Vulkan Includes
-#include "Vulkan\VulkanTextureLoader.h"
+#include "Vulkan/VulkanTextureLoader.h"
+#include "Vulkan/VkBufferObject.h"
 
+//Profiler Includes
+#include "Profiler/CpuProfiler.h"
+
+
+
+/*
+=========================
+RenderModel
+=========================
+*/
+
+/*
+=========================
+BindBuffers
+=========================
+*/
+void RenderModel::BindBuffers(VkCommandBuffer cmdBuffer, uint32_t binding) const {
+	VkDeviceSize offsets[1] = { 0 };
+	vkCmdBindVertexBuffers(cmdBuffer, binding, 1, &vertexBuffer.buffer, offsets);
+	vkCmdBindIndexBuffer(cmdBuffer, indexBuffer.buffer, 0, VK_INDEX_TYPE_UINT32);
+}
+
+/*
+=========================
+DestroyBuffers
+=========================
+*/
+void RenderModel::DestroyBuffers(VkDevice device) {
+	VkBufferObject::DeleteBufferMemory(device, vertexBuffer, nullptr);
+	VkBufferObject::DeleteBufferMemory(device, indexBuffer, nullptr);
+}
+
+/*
+=========================
+PackSurfaces
+=========================
+*/
+void RenderModel::PackSurfaces(std::vector<modelSurface_t>& surfaces, const VulkanSwapChain& swapChain, VkPhysicalDeviceMemoryProperties& memoryProperties) {
+	uint32_t numVerts = 0;
+	uint32_t numIndexes = 0;
+	for (const modelSurface_t& surf : surfaces)
+	{
+		numVerts += surf.geometry->numVerts;
+		numIndexes += surf.geometry->numIndexes > 0 ? surf.geometry->numIndexes : surf.geometry->numVerts;
+	}
+	if (numVerts == 0)
+		return;
+
+	std::vector<drawVert> verts;
+	std::vector<uint32_t> indexes;
+	verts.reserve(numVerts);
+	indexes.reserve(numIndexes);
+
+	for (modelSurface_t& surf : surfaces)
+	{
+		const srfTriangles_t* tri = surf.geometry;
+		surf.firstIndex = static_cast<uint32_t>(indexes.size());
+		surf.vertexOffset = static_cast<int32_t>(verts.size());
+
+		verts.insert(verts.end(), tri->verts, tri->verts + tri->numVerts);
+		if (tri->numIndexes > 0)
+		{
+			indexes.insert(indexes.end(), tri->indexes, tri->indexes + tri->numIndexes);
+		}
+		else
+		{
+			//OBJ surfaces are plain triangle lists
+			for (int i = 0; i < tri->numVerts; i++)
+			{
+				indexes.push_back(static_cast<uint32_t>(i));
+			}
+		}
+		surf.indexCount = static_cast<uint32_t>(indexes.size()) - surf.firstIndex;
+	}
+
+	UploadBuffers(swapChain, memoryProperties, verts.data(), sizeof(drawVert), numVerts, indexes.data(), numIndexes,
+		(drawVertFlags::Vertex | drawVertFlags::Normal | drawVertFlags::Uv | drawVertFlags::Tangent | drawVertFlags::Binormal));
+}
+
+/*
+=========================
+UploadBuffers
+=========================
+*/
+void RenderModel::UploadBuffers(const VulkanSwapChain& swapChain, VkPhysicalDeviceMemoryProperties& memoryProperties, const void* pVerts, uint32_t vertexStride, uint32_t numVerts, const uint32_t* pIndexes, uint32_t numIndexes, drawVertFlags vertexFlags) {
+	const VkDeviceSize vertexBytes = static_cast<VkDeviceSize>(vertexStride) * numVerts;
+	const VkDeviceSize indexBytes = sizeof(uint32_t) * static_cast<VkDeviceSize>(numIndexes);
+
+	//Staging buffers are handed over to uploadManager, it destroys them once copies are done
+	VkBufferObject_s stagingVerts;
+	VK_CHECK_RESULT(VkBufferObject::CreateBuffer(swapChain, memoryProperties, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, vertexBytes, stagingVerts, const_cast<void*>(pVerts)));
+	VK_CHECK_RESULT(VkBufferObject::CreateBuffer(swapChain, memoryProperties, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, vertexBytes, vertexBuffer));
+	VkBufferObject::SubmitBufferObjects(vertexBytes, stagingVerts, vertexBuffer, vertexFlags);
+
+	VkBufferObject_s stagingIndexes;
+	VK_CHECK_RESULT(VkBufferObject::CreateBuffer(swapChain, memoryProperties, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, indexBytes, stagingIndexes, const_cast<uint32_t*>(pIndexes)));
+	VK_CHECK_RESULT(VkBufferObject::CreateBuffer(swapChain, memoryProperties, VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, indexBytes, indexBuffer));
+	VkBufferObject::SubmitBufferObjects(indexBytes, stagingIndexes, indexBuffer, drawVertFlags::None);
+}
 
 
 /*
@@ -38,6 +142,7 @@ InitFromFile
 =========================
 */
 void RenderModelStatic::InitFromFile(std::string fileName, std::string filePath) {
+	TYW_PROFILE_FUNCTION();
 	bool loaded = false;
 
 	loaded = OBJLoad(fileName, filePath);
@@ -327,6 +432,7 @@ void RenderModelStatic::Clear(VkDevice device)
 		FreeSurfaceTriangles(m_it->geometry);
 	}
 	surfaces.clear();
+	DestroyBuffers(device);
 
 	std::unordered_map<std::string, uint32_t>::iterator msizes_it = materialSizes.begin();
 	for (auto& material: m_material)
@@ -346,6 +452,16 @@ void RenderModelStatic::Clear(VkDevice device)
 }
 
 
+/*
+=========================
+CreateBuffers
+=========================
+*/
+void RenderModelStatic::CreateBuffers(const VulkanSwapChain& swapChain, VkPhysicalDeviceMemoryProperties& memoryProperties) {
+	PackSurfaces(surfaces, swapChain, memoryProperties);
+}
+
+
 /*
 =========================
 setMaterial
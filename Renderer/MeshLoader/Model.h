@@ -4,14 +4,16 @@
 *	This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
 */
 #pragma once
-#include <External\vulkan\vulkan.h>
-#include <Renderer\Geometry\VertData.h>
-#include <Renderer\Geometry\JointTransform.h>
+#include <External/vulkan/vulkan.h>
+#include <Renderer/Geometry/VertData.h>
+#include <Renderer/Geometry/JointTransform.h>
+#include <Renderer/Vulkan/VkBufferObject.h>
 
 
 
 //forwad declared
 class Material;
+class VulkanSwapChain;
 
 
 // our only drawing geometry type
@@ -26,10 +28,18 @@ struct  srfTriangles_t
 
 struct  modelSurface_t 
 {
+	modelSurface_t(): id(0), numMaterials(0), material(nullptr), geometry(nullptr), firstIndex(0), indexCount(0), vertexOffset(0) {}
+
 	int					id;
 	uint32_t			numMaterials;
 	Material*			material;
-	srfTriangles_t*		geometry;
+	srfTriangles_t*		geometry;		// cpu copy, nullptr for models that keep their own vertex format
+
+	// location inside the model vertex and index buffers, filled by RenderModel::CreateBuffers
+	// draw with vkCmdDrawIndexed(indexCount, instances, firstIndex, vertexOffset, 0)
+	uint32_t			firstIndex;
+	uint32_t			indexCount;
+	int32_t				vertexOffset;
 };
 
 struct  MD5Joint {
@@ -92,4 +102,24 @@ public:
 	//Deletes any data that was stored in class. 
 	//Each derived class can have different clearing implementation
 	virtual void				Clear(VkDevice device) = 0;
+
+	// Lays out all surfaces into one vertex and one index buffer and fills
+	// firstIndex, indexCount and vertexOffset of every surface. Copies are queued on uploadManager
+	virtual void				CreateBuffers(const VulkanSwapChain& swapChain, VkPhysicalDeviceMemoryProperties& memoryProperties) {}
+
+	// Binds buffers shared by all surfaces. One bind per model
+	void						BindBuffers(VkCommandBuffer cmdBuffer, uint32_t binding) const;
+
+	// Destroys buffers made by CreateBuffers
+	void						DestroyBuffers(VkDevice device);
+
+protected:
+	// Packs drawVert surfaces, unindexed surfaces get sequential indexes
+	void						PackSurfaces(std::vector<modelSurface_t>& surfaces, const VulkanSwapChain& swapChain, VkPhysicalDeviceMemoryProperties& memoryProperties);
+
+	void						UploadBuffers(const VulkanSwapChain& swapChain, VkPhysicalDeviceMemoryProperties& memoryProperties, const void* pVerts, uint32_t vertexStride, uint32_t numVerts, const uint32_t* pIndexes, uint32_t numIndexes, drawVertFlags vertexFlags);
+
+public:
+	VkBufferObject_s			vertexBuffer;	// vertex input state for pipelines lives here too
+	VkBufferObject_s			indexBuffer;
 };
\ No newline at end of file
@@ -3,29 +3,38 @@
 *	GitHub repository - https://github.com/TywyllSoftware/TywRenderer
 *	This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
 */
-#include <RendererPch\stdafx.h>
+#include <RendererPch/stdafx.h>
 
 
 //MeshLoader Includes
 #include "Model_local.h"
 #include "Material.h"
-#include "MeshLoader\ImageManager.h"
+#include "MeshLoader/ImageManager.h"
 
 
 //Vulkan Includes
-#include "Vulkan\VulkanTextureLoader.h"
+#include "Vulkan/VulkanTextureLoader.h"
+
+
+//JobSystem Includes
+#include "JobSystem/JobSystem.h"
+
+//Profiler Includes
+#include "Profiler/CpuProfiler.h"
 
 
 //Assimp Includes
-#include <External\assimp\include\assimp\Importer.hpp> 
-#include <External\assimp\include\assimp\scene.h>     
-#include <External\assimp\include\assimp\postprocess.h>
-#include <External\assimp\include\assimp\cimport.h>
-#include <External\assimp\include\assimp\DefaultLogger.hpp>
-#include <External\assimp\include\assimp\LogStream.hpp>
+#include <External/assimp/include/assimp/Importer.hpp> 
+#include <External/assimp/include/assimp/scene.h>     
+#include <External/assimp/include/assimp/postprocess.h>
+#include <External/assimp/include/assimp/cimport.h>
+#include <External/assimp/include/assimp/DefaultLogger.hpp>
+#include <External/assimp/include/assimp/LogStream.hpp>
 
 
 
+//Smallest batch of vertices worth a job when converting meshes
+static const uint32_t ASSIMP_VERTS_PER_JOB = 1024;
 
 //Fucntions declared
 bool InitFromScene(const aiScene* pScene, const std::string& Filename, std::vector<modelSurface_t>& entries, RenderModelAssimp::MaterialMap& materialMap);
@@ -46,6 +55,7 @@ RenderModelAssimp::~RenderModelAssimp()
 
 void RenderModelAssimp::InitFromFile(std::string fileName, std::string filePath)
 {
+	TYW_PROFILE_FUNCTION();
 	std::string file = filePath + fileName;
 
 	// Change this line to normal if you not want to analyse the import process
@@ -152,6 +162,7 @@ void RenderModelAssimp::Clear(VkDevice device)
 		}
 		SAFE_DELETE(mesh.geometry);
 	}
+	DestroyBuffers(device);
 
 	for (auto& material : m_material)
 	{
@@ -161,6 +172,12 @@ void RenderModelAssimp::Clear(VkDevice device)
 }
 
 
+void RenderModelAssimp::CreateBuffers(const VulkanSwapChain& swapChain, VkPhysicalDeviceMemoryProperties& memoryProperties)
+{
+	PackSurfaces(m_Entries, swapChain, memoryProperties);
+}
+
+
 bool InitFromScene(const aiScene* pScene, const std::string& Filename, std::vector<modelSurface_t>& entries, RenderModelAssimp::MaterialMap& materialMap)
 {
 	uint32_t numVertices = 0;
@@ -239,42 +256,45 @@ void InitMesh(const aiMesh* paiMesh, const aiScene* pScene, modelSurface_t& entr
 	aiColor3D pColor(0.f, 0.f, 0.f);
 	pScene->mMaterials[paiMesh->mMaterialIndex]->Get(AI_MATKEY_COLOR_DIFFUSE, pColor);
 
-	aiVector3D Zero3D(0.0f, 0.0f, 0.0f);
-	for (uint32_t i = 0; i < paiMesh->mNumVertices; i++) 
+	const aiVector3D Zero3D(0.0f, 0.0f, 0.0f);
+	ParallelFor(paiMesh->mNumVertices, ASSIMP_VERTS_PER_JOB, [&](uint32_t first, uint32_t last)
 	{
-		aiVector3D* pPos = &(paiMesh->mVertices[i]);
-		aiVector3D* pNormal = &(paiMesh->mNormals[i]);
-		aiVector3D *pTexCoord;
-		if (paiMesh->HasTextureCoords(0))
-		{
-			pTexCoord = &(paiMesh->mTextureCoords[0][i]);
-		}
-		else 
+		for (uint32_t i = first; i < last; i++)
 		{
-			pTexCoord = &Zero3D;
-		}
+			const aiVector3D* pPos = &(paiMesh->mVertices[i]);
+			const aiVector3D* pNormal = &(paiMesh->mNormals[i]);
+			const aiVector3D* pTexCoord;
+			if (paiMesh->HasTextureCoords(0))
+			{
+				pTexCoord = &(paiMesh->mTextureCoords[0][i]);
+			}
+			else 
+			{
+				pTexCoord = &Zero3D;
+			}
 
-		aiVector3D* pTangent = (paiMesh->HasTangentsAndBitangents()) ? &(paiMesh->mTangents[i]) : &Zero3D;
-		aiVector3D* pBiTangent = (paiMesh->HasTangentsAndBitangents()) ? &(paiMesh->mBitangents[i]) : &Zero3D;
+			const aiVector3D* pTangent = (paiMesh->HasTangentsAndBitangents()) ? &(paiMesh->mTangents[i]) : &Zero3D;
+			const aiVector3D* pBiTangent = (paiMesh->HasTangentsAndBitangents()) ? &(paiMesh->mBitangents[i]) : &Zero3D;
 
-		drawVert v(glm::vec3(pPos->x, -pPos->y, pPos->z),
-				   glm::vec3(pNormal->x, pNormal->y, pNormal->z),
-				   glm::vec3(pTangent->x, pTangent->y, pTangent->z),
-				   glm::vec3(pBiTangent->x, pBiTangent->y, pBiTangent->z),
-				   glm::vec3(pColor.r, pColor.g, pColor.b),
-				   glm::vec2(pTexCoord->x, pTexCoord->y));
+			drawVert v(glm::vec3(pPos->x, -pPos->y, pPos->z),
+					   glm::vec3(pNormal->x, pNormal->y, pNormal->z),
+					   glm::vec3(pTangent->x, pTangent->y, pTangent->z),
+					   glm::vec3(pBiTangent->x, pBiTangent->y, pBiTangent->z),
+					   glm::vec3(pColor.r, pColor.g, pColor.b),
+					   glm::vec2(pTexCoord->x, pTexCoord->y));
 
 
-		//dim.max.x = fmax(pPos->x, dim.max.x);
-		//dim.max.y = fmax(pPos->y, dim.max.y);
-		//dim.max.z = fmax(pPos->z, dim.max.z);
+			//dim.max.x = fmax(pPos->x, dim.max.x);
+			//dim.max.y = fmax(pPos->y, dim.max.y);
+			//dim.max.z = fmax(pPos->z, dim.max.z);
 
-		//dim.min.x = fmin(pPos->x, dim.min.x);
-		//dim.min.y = fmin(pPos->y, dim.min.y);
-		//dim.min.z = fmin(pPos->z, dim.min.z);
+			//dim.min.x = fmin(pPos->x, dim.min.x);
+			//dim.min.y = fmin(pPos->y, dim.min.y);
+			//dim.min.z = fmin(pPos->z, dim.min.z);
 
-		entry.geometry->verts[i] = v;
-	}
+			entry.geometry->verts[i] = v;
+		}
+	});
 	//dim.size = dim.max - dim.min;
 
 	entry.geometry->indexes = TYW_NEW uint32_t[paiMesh->mNumFaces*3];
@@ -32,6 +32,7 @@ public:
 	bool						ConvertOBJToModelSurfaces(const struct objModel_a* obj);
 
 	virtual void				Clear(VkDevice device);
+	virtual void				CreateBuffers(const VulkanSwapChain& swapChain, VkPhysicalDeviceMemoryProperties& memoryProperties);
 	virtual const char	*		getName() const;
 	virtual int					getSize() const;
 	void						setName(std::string name);
@@ -134,6 +135,7 @@ class  RenderModelMD5 final: public RenderModelStatic
 public:
 	void				InitFromFile(std::string fileName, std::string filePath);
 	void				Clear(VkDevice device) override;
+	void				CreateBuffers(const VulkanSwapChain& swapChain, VkPhysicalDeviceMemoryProperties& memoryProperties) override;
 	//virtual bool				LoadBinaryModel(idFile * file, const ID_TIME_T sourceTimeStamp);
 	//virtual void				WriteBinaryModel(idFile * file, ID_TIME_T *_timeStamp = NULL) const;
 	//virtual dynamicModel_t	IsDynamicModel() const;
@@ -203,6 +205,7 @@ public:
 	const char	*		getName() const override;
 	int				    getSize() const override;
 	void				Clear(VkDevice device) override;
+	void				CreateBuffers(const VulkanSwapChain& swapChain, VkPhysicalDeviceMemoryProperties& memoryProperties) override;
 
 public:
 	typedef std::unordered_map<std::string, Material*> MaterialMap;
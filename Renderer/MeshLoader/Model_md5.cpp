@@ -3,21 +3,31 @@
 *	GitHub repository - https://github.com/TywyllSoftware/TywRenderer
 *	This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
 */
-#include <RendererPch\stdafx.h>
+#include <RendererPch/stdafx.h>
 
 
 //MeshLoader Includes
 #include "Model_local.h"
 #include "Material.h"
-#include "MeshLoader\ImageManager.h"
+#include "MeshLoader/ImageManager.h"
 
 
 //Vulkan Includes
-#include "Vulkan\VulkanTextureLoader.h"
+#include "Vulkan/VulkanTextureLoader.h"
+
+
+//JobSystem Includes
+#include "JobSystem/JobSystem.h"
+
+//Profiler Includes
+#include "Profiler/CpuProfiler.h"
 
 
 
 #define MD5VERSION 10
+
+//Smallest batch of vertices worth a job when skinning
+static const uint32_t MD5_VERTS_PER_JOB = 256;
 static uint32_t	 c_numVerts = 0;
 static uint32_t	 c_numWeights = 0;
 static uint32_t	 c_numWeightJoints = 0;
@@ -171,47 +181,46 @@ void MD5Mesh::ParseMesh(FILE* ptrFile, int numJoints, std::vector<JointQuat>& jo
 	duplicateVertices.resize(verts.size());
 	deformInfosVec.resize(verts.size());
 
-	int b = 0;
-	for (auto& i : verts)
+	//Vertices are independent, split them across the job system
+	ParallelFor(static_cast<uint32_t>(verts.size()), MD5_VERTS_PER_JOB, [&](uint32_t first, uint32_t last)
 	{
+		for (uint32_t b = first; b < last; b++)
+		{
+			const vertIndex_t& i = verts[b];
 
-		glm::mat3 boneWeight(0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f);
-		glm::mat3 boneId(0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f);
-		glm::vec3 v(0.0f, 0.0f, 0.0f);
-		drawVert		 pose;
+			glm::mat3 boneWeight(0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f);
+			glm::mat3 boneId(0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f);
+			glm::vec3 v(0.0f, 0.0f, 0.0f);
 
-		float* pBoneIndices = &boneId[0][0];
-		float* pBoneWeights = &boneWeight[0][0];
-		for (int j = 0; j < i.numWeightsForVertex; j++)
-		{
-			//MD5 have usually les than 9 bones per vertex. But usually in industry they use 4 bones per vertex
-			//cant have more than 9 bones
-			assert(j < 9);
+			float* pBoneIndices = &boneId[0][0];
+			float* pBoneWeights = &boneWeight[0][0];
+			for (int j = 0; j < i.numWeightsForVertex; j++)
+			{
+				//MD5 have usually les than 9 bones per vertex. But usually in industry they use 4 bones per vertex
+				//cant have more than 9 bones
+				assert(j < 9);
 
-			//Engine::getInstance().Sys_Printf("tempWeight i = %i \n", i.firstWeightForVertex + j);
-			vertexWeight_t& tempWeight = weight[i.firstWeightForVertex + j];
-			
-			//JointMat& joint = joints[tempWeight.jointId];
-			JointQuat& joint = joints[tempWeight.jointId];
+				const vertexWeight_t& tempWeight = weight[i.firstWeightForVertex + j];
+				const JointQuat& joint = joints[tempWeight.jointId];
+
+				// Convert the weight position from Joint local space to object space
+				glm::vec3 rotPos = joint.q * tempWeight.pos;
 
-			// Convert the weight position from Joint local space to object space
-			glm::vec3 rotPos = joint.q * tempWeight.pos;
+				v += (joint.t + rotPos)  * tempWeight.jointWeight;
 
-			v += (joint.t + rotPos)  * tempWeight.jointWeight;
 
+				pBoneWeights[j] = tempWeight.jointWeight;
+				pBoneIndices[j] = static_cast<float>(tempWeight.jointId);
+			}
+			deformInfosVec[b].vertex = v;
+			deformInfosVec[b].tex = glm::vec2(i.texCoord.x, i.texCoord.y);
 
-			pBoneWeights[j] = tempWeight.jointWeight;
-			pBoneIndices[j] = static_cast<float>(tempWeight.jointId);
+			deformInfosVec[b].boneWeight1 = glm::vec4(pBoneWeights[0], pBoneWeights[1], pBoneWeights[2], pBoneWeights[3]);
+			deformInfosVec[b].boneWeight2 = glm::vec4(pBoneWeights[4], pBoneWeights[5], pBoneWeights[6], pBoneWeights[7]);
+			deformInfosVec[b].boneId1     =	glm::ivec4(pBoneIndices[0], pBoneIndices[1], pBoneIndices[2], pBoneIndices[3]);
+			deformInfosVec[b].boneId2     = glm::ivec4(pBoneIndices[4], pBoneIndices[5], pBoneIndices[6], pBoneIndices[7]);
 		}
-		deformInfosVec[b].vertex = v;
-		deformInfosVec[b].tex = glm::vec2(i.texCoord.x, i.texCoord.y);
-		
-		deformInfosVec[b].boneWeight1 = glm::vec4(pBoneWeights[0], pBoneWeights[1], pBoneWeights[2], pBoneWeights[3]);
-		deformInfosVec[b].boneWeight2 = glm::vec4(pBoneWeights[4], pBoneWeights[5], pBoneWeights[6], pBoneWeights[7]);
-		deformInfosVec[b].boneId1     =	glm::ivec4(pBoneIndices[0], pBoneIndices[1], pBoneIndices[2], pBoneIndices[3]);
-		deformInfosVec[b].boneId2     = glm::ivec4(pBoneIndices[4], pBoneIndices[5], pBoneIndices[6], pBoneIndices[7]);
-		b++;
-	}
+	});
 	
 
 	
@@ -373,6 +382,7 @@ glm::vec3 CalculateSmoothNormalsMD5(const std::vector<uint32_t>& vertexIndices,
 }
 
 void RenderModelMD5::InitFromFile(std::string fileName, std::string filePath) {
+	TYW_PROFILE_FUNCTION();
 	FILE* file = fopen((filePath + fileName).c_str(), "r");
 	if (!file) {
 		//Engine::getInstance().Sys_Printf("ERROR: Could not find %s", fileName.c_str());
@@ -458,78 +468,81 @@ void RenderModelMD5::InitFromFile(std::string fileName, std::string filePath) {
 
 void MD5Mesh::UpdateMesh(const MD5Mesh *mesh,  std::vector<JointQuat>& joints, const JointMat *entJointsInverted, deformInfo_t *surf)
 {
-	int b = 0;
-	for (auto& i : verts)
+	//CPU skinning, every vertex only reads joints and writes its own output
+	ParallelFor(static_cast<uint32_t>(verts.size()), MD5_VERTS_PER_JOB, [&](uint32_t first, uint32_t last)
 	{
-
-		glm::vec3 v(0.0f, 0.0f, 0.0f);
-		for (int j = 0; j < i.numWeightsForVertex; j++)
+		for (uint32_t b = first; b < last; b++)
 		{
-			//Engine::getInstance().Sys_Printf("tempWeight i = %i \n", i.firstWeightForVertex + j);
-			vertexWeight_t& tempWeight = weight[i.firstWeightForVertex + j];
-			JointQuat& joint = joints[tempWeight.jointId];
+			const vertIndex_t& i = verts[b];
+
+			glm::vec3 v(0.0f, 0.0f, 0.0f);
+			for (int j = 0; j < i.numWeightsForVertex; j++)
+			{
+				//Engine::getInstance().Sys_Printf("tempWeight i = %i \n", i.firstWeightForVertex + j);
+				vertexWeight_t& tempWeight = weight[i.firstWeightForVertex + j];
+				const JointQuat& joint = joints[tempWeight.jointId];
 
-			JointMat mat;
+				JointMat mat;
 
 
-			/*Convert quat to mat4*/
-			glm::mat4x4 quatMat4;
-			float	wx, wy, wz;
-			float	xx, yy, yz;
-			float	xy, xz, zz;
-			float	x2, y2, z2;
+				/*Convert quat to mat4*/
+				glm::mat4x4 quatMat4;
+				float	wx, wy, wz;
+				float	xx, yy, yz;
+				float	xy, xz, zz;
+				float	x2, y2, z2;
 
-			x2 = joint.q.x + joint.q.x;
-			y2 = joint.q.y + joint.q.y;
-			z2 = joint.q.z + joint.q.z;
+				x2 = joint.q.x + joint.q.x;
+				y2 = joint.q.y + joint.q.y;
+				z2 = joint.q.z + joint.q.z;
 
-			xx = joint.q.x * x2;
-			xy = joint.q.x * y2;
-			xz = joint.q.x * z2;
+				xx = joint.q.x * x2;
+				xy = joint.q.x * y2;
+				xz = joint.q.x * z2;
 
-			yy = joint.q.y * y2;
-			yz = joint.q.y * z2;
-			zz = joint.q.z * z2;
+				yy = joint.q.y * y2;
+				yz = joint.q.y * z2;
+				zz = joint.q.z * z2;
 
-			wx = joint.q.w * x2;
-			wy = joint.q.w * y2;
-			wz = joint.q.w * z2;
+				wx = joint.q.w * x2;
+				wy = joint.q.w * y2;
+				wz = joint.q.w * z2;
 
-			quatMat4[0][0] = 1.0f - (yy + zz);
-			quatMat4[0][1] = xy - wz;
-			quatMat4[0][2] = xz + wy;
-			quatMat4[0][3] = 0.0f;
+				quatMat4[0][0] = 1.0f - (yy + zz);
+				quatMat4[0][1] = xy - wz;
+				quatMat4[0][2] = xz + wy;
+				quatMat4[0][3] = 0.0f;
 
-			quatMat4[1][0] = xy + wz;
-			quatMat4[1][1] = 1.0f - (xx + zz);
-			quatMat4[1][2] = yz - wx;
-			quatMat4[1][3] = 0.0f;
+				quatMat4[1][0] = xy + wz;
+				quatMat4[1][1] = 1.0f - (xx + zz);
+				quatMat4[1][2] = yz - wx;
+				quatMat4[1][3] = 0.0f;
 
-			quatMat4[2][0] = xz - wy;
-			quatMat4[2][1] = yz + wx;
-			quatMat4[2][2] = 1.0f - (xx + yy);
-			quatMat4[2][3] = 0.0f;
+				quatMat4[2][0] = xz - wy;
+				quatMat4[2][1] = yz + wx;
+				quatMat4[2][2] = 1.0f - (xx + yy);
+				quatMat4[2][3] = 0.0f;
 
-			quatMat4[3][0] = 0.0f;
-			quatMat4[3][1] = 0.0f;
-			quatMat4[3][2] = 0.0f;
-			quatMat4[3][3] = 1.0f;
-			/*Convert end*/
+				quatMat4[3][0] = 0.0f;
+				quatMat4[3][1] = 0.0f;
+				quatMat4[3][2] = 0.0f;
+				quatMat4[3][3] = 1.0f;
+				/*Convert end*/
 
 
-			mat.SetRotation(quatMat4);
-			mat.SetTranslation(joint.t);
+				mat.SetRotation(quatMat4);
+				mat.SetTranslation(joint.t);
 
-			// Convert the weight position from Joint local space to object space
-			glm::vec3 rotPos = mat * tempWeight.pos;
+				// Convert the weight position from Joint local space to object space
+				glm::vec3 rotPos = mat * tempWeight.pos;
 
-			v += (mat.GetTranslation() + rotPos)  * tempWeight.jointWeight;
+				v += (mat.GetTranslation() + rotPos)  * tempWeight.jointWeight;
+			}
+			deformInfo->verts[b].Clear();
+			deformInfo->verts[b].vertex = v;
+			deformInfo->verts[b].SetTexCoords(i.texCoord.x, i.texCoord.y);
 		}
-		deformInfo->verts[b].Clear();
-		deformInfo->verts[b].vertex = v;
-		deformInfo->verts[b].SetTexCoords(i.texCoord.x, i.texCoord.y);
-		b++;
-	}
+	});
 
 	/*
 	for (int i = 0; i < tri.size(); i++)
@@ -558,4 +571,46 @@ void RenderModelMD5::Clear(VkDevice device)
 		}
 		//SAFE_DELETE_ARRAY(mesh.shader);
 	}
+	surfaces.clear();
+	DestroyBuffers(device);
+}
+
+
+void RenderModelMD5::CreateBuffers(const VulkanSwapChain& swapChain, VkPhysicalDeviceMemoryProperties& memoryProperties)
+{
+	//Skinning data stays in meshStructure layout, one surface per mesh without cpu geometry
+	uint32_t numVerts = 0;
+	uint32_t numIndexes = 0;
+	for (const MD5Mesh& mesh : meshes)
+	{
+		numVerts += static_cast<uint32_t>(mesh.deformInfosVec.size());
+		numIndexes += static_cast<uint32_t>(mesh.indexes.size());
+	}
+	if (numVerts == 0)
+		return;
+
+	std::vector<MD5Mesh::meshStructure> verts;
+	std::vector<uint32_t> indexes;
+	verts.reserve(numVerts);
+	indexes.reserve(numIndexes);
+
+	surfaces.clear();
+	surfaces.resize(meshes.size());
+	for (uint32_t i = 0; i < meshes.size(); i++)
+	{
+		MD5Mesh& mesh = meshes[i];
+		modelSurface_t& surf = surfaces[i];
+		surf.id = static_cast<int>(i);
+		surf.material = mesh.shader;
+		surf.numMaterials = mesh.numMaterials;
+		surf.firstIndex = static_cast<uint32_t>(indexes.size());
+		surf.indexCount = static_cast<uint32_t>(mesh.indexes.size());
+		surf.vertexOffset = static_cast<int32_t>(verts.size());
+		mesh.surfaceNum = i;
+
+		verts.insert(verts.end(), mesh.deformInfosVec.begin(), mesh.deformInfosVec.end());
+		indexes.insert(indexes.end(), mesh.indexes.begin(), mesh.indexes.end());
+	}
+
+	UploadBuffers(swapChain, memoryProperties, verts.data(), sizeof(MD5Mesh::meshStructure), numVerts, indexes.data(), numIndexes, drawVertFlags::None);
 }
\ No newline at end of file
@@ -3,13 +3,13 @@
 *	GitHub repository - https://github.com/TywyllSoftware/TywRenderer
 *	This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
 */
-#include <RendererPch\stdafx.h>
+#include <RendererPch/stdafx.h>
 
 //Renderer Includes
 #include "Model_obj.h"
 
 //Geometry Includes
-#include "Geometry\TangentAndBinormalCalculator.hpp"
+#include "Geometry/TangentAndBinormalCalculator.hpp"
 
 typedef struct {
 	objModel_t	*model;
@@ -0,0 +1,361 @@
+/*
+*	Copyright 2015-2016 Tomas Mikalauskas. All rights reserved.
+*	GitHub repository - https://github.com/TywyllSoftware/TywRenderer
+*	This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+#include <RendererPch/stdafx.h>
+
+//Profiler Includes
+#include "CpuProfiler.h"
+
+//ImGui Includes
+#include "ThirdParty/ImGui/imgui.h"
+
+
+CpuProfiler* cpuProfiler = nullptr;
+
+thread_local CpuProfiler::ThreadSlot CpuProfiler::s_ThreadSlot = { 0, nullptr };
+std::atomic<uint32_t> CpuProfiler::s_NextId(1);
+
+//How often the writer drains the thread buffers
+static const uint32_t CPU_PROFILER_WRITE_INTERVAL_MS = 10;
+
+//Shortest time between creation and Start for the tick calibration
+static const uint32_t CPU_PROFILER_CALIBRATION_MS = 10;
+
+//Events recorded by Start to measure the marker overhead
+static const uint32_t CPU_PROFILER_OVERHEAD_SAMPLES = 1000;
+
+
+template<class T>
+static size_t WriteValue(FILE* pFile, const T& value)
+{
+	return fwrite(&value, 1, sizeof(T), pFile);
+}
+
+
+CpuProfiler::CpuProfiler():
+	m_Id(s_NextId.fetch_add(1)),
+	m_bCapturing(false),
+	m_FrameNum(0),
+	m_CreateTick(Now()),
+	m_CreateTime(std::chrono::high_resolution_clock::now()),
+	m_TicksPerMicroSec(1.0),
+	m_StartTick(0),
+	m_bStopWriter(false),
+	m_pFile(nullptr),
+	m_Format(CPU_TRACE_JSON),
+	m_bFirstJsonEvent(true),
+	m_BytesWritten(0)
+{
+	memset(&m_Stats, 0, sizeof(m_Stats));
+}
+
+
+CpuProfiler::~CpuProfiler()
+{
+	if (IsCapturing())
+	{
+		Stop();
+	}
+
+	//Threads still holding a slot see a different profiler id and register again
+	for (ThreadBuffer* pBuffer : m_Threads)
+	{
+		SAFE_DELETE(pBuffer);
+	}
+}
+
+
+CpuProfiler::ThreadBuffer* CpuProfiler::RegisterThread()
+{
+	std::lock_guard<std::mutex> lock(m_ThreadLock);
+
+	ThreadBuffer* pBuffer = TYW_NEW ThreadBuffer;
+	pBuffer->write.store(0);
+	pBuffer->read.store(0);
+	pBuffer->numDropped.store(0);
+	pBuffer->threadIndex = static_cast<uint16_t>(m_Threads.size());
+
+	//Touch every page now instead of on the recording path
+	memset(pBuffer->events, 0, sizeof(pBuffer->events));
+	m_Threads.push_back(pBuffer);
+
+	s_ThreadSlot.profilerId = m_Id;
+	s_ThreadSlot.pBuffer = pBuffer;
+	return pBuffer;
+}
+
+
+bool CpuProfiler::Start(const std::string& fileName, CpuTraceFormat format)
+{
+	if (IsCapturing())
+	{
+		return false;
+	}
+
+	m_pFile = fopen(fileName.c_str(), format == CPU_TRACE_JSON ? "w" : "wb");
+	if (m_pFile == nullptr)
+	{
+		printf("CpuProfiler: could not open %s\n", fileName.c_str());
+		return false;
+	}
+
+	//Ticks per microsecond, from the time since creation
+	auto elapsed = std::chrono::high_resolution_clock::now() - m_CreateTime;
+	if (elapsed < std::chrono::milliseconds(CPU_PROFILER_CALIBRATION_MS))
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(CPU_PROFILER_CALIBRATION_MS) - elapsed);
+	}
+	const uint64_t tick = Now();
+	elapsed = std::chrono::high_resolution_clock::now() - m_CreateTime;
+	m_TicksPerMicroSec = (tick - m_CreateTick) / static_cast<double>(std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count());
+
+	//Writer is not running, leftovers of the last capture can be dropped from the consumer side
+	{
+		std::lock_guard<std::mutex> lock(m_ThreadLock);
+		for (ThreadBuffer* pBuffer : m_Threads)
+		{
+			pBuffer->read.store(pBuffer->write.load(std::memory_order_acquire), std::memory_order_release);
+			pBuffer->numDropped.store(0);
+		}
+		memset(&m_Stats, 0, sizeof(m_Stats));
+	}
+
+	m_Format = format;
+	m_bFirstJsonEvent = true;
+	m_BytesWritten = 0;
+	m_NameIds.clear();
+	m_StartTick = Now();
+
+	if (m_Format == CPU_TRACE_JSON)
+	{
+		m_BytesWritten += fprintf(m_pFile, "{\"traceEvents\":[\n");
+	}
+	else
+	{
+		m_BytesWritten += fwrite("TYWCPU01", 1, 8, m_pFile);
+		m_BytesWritten += WriteValue(m_pFile, m_TicksPerMicroSec);
+		m_BytesWritten += WriteValue(m_pFile, m_StartTick);
+	}
+
+	m_bCapturing.store(true);
+
+	//Cost of one scope, then drop the samples again. Registration is not part of it
+	if (s_ThreadSlot.profilerId != m_Id)
+	{
+		RegisterThread();
+	}
+	const uint64_t overheadStart = Now();
+	for (uint32_t i = 0; i < CPU_PROFILER_OVERHEAD_SAMPLES; i++)
+	{
+		PushEvent(CPU_EVENT_SCOPE, "CpuProfiler overhead", Now(), Now());
+	}
+	const uint64_t overheadEnd = Now();
+	s_ThreadSlot.pBuffer->read.store(s_ThreadSlot.pBuffer->write.load());
+	{
+		std::lock_guard<std::mutex> lock(m_ThreadLock);
+		m_Stats.scopeOverheadNanoSec = (overheadEnd - overheadStart) * 1000.0 / (m_TicksPerMicroSec * CPU_PROFILER_OVERHEAD_SAMPLES);
+	}
+
+	m_bStopWriter = false;
+	m_Writer = std::thread(&CpuProfiler::WriterThread, this);
+	return true;
+}
+
+
+bool CpuProfiler::Stop()
+{
+	if (!IsCapturing())
+	{
+		return false;
+	}
+
+	m_bCapturing.store(false);
+	{
+		std::lock_guard<std::mutex> lock(m_WriterLock);
+		m_bStopWriter = true;
+	}
+	m_WriterWake.notify_one();
+	m_Writer.join();
+
+	Flush();
+
+	if (m_Format == CPU_TRACE_JSON)
+	{
+		std::lock_guard<std::mutex> lock(m_ThreadLock);
+		for (const ThreadBuffer* pBuffer : m_Threads)
+		{
+			m_BytesWritten += fprintf(m_pFile, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":%u,\"args\":{\"name\":\"Thread %u\"}}",
+				m_bFirstJsonEvent ? "" : ",\n", pBuffer->threadIndex, pBuffer->threadIndex);
+			m_bFirstJsonEvent = false;
+		}
+		m_BytesWritten += fprintf(m_pFile, "\n],\"displayTimeUnit\":\"ms\"}\n");
+		m_Stats.bytesWritten = m_BytesWritten;
+	}
+
+	const bool bWritten = ferror(m_pFile) == 0;
+	fclose(m_pFile);
+	m_pFile = nullptr;
+
+	CpuProfilerStats stats = GetStats();
+	printf("CpuProfiler: %llu events, %llu dropped, %llu bytes\n", static_cast<unsigned long long>(stats.numEvents),
+		static_cast<unsigned long long>(stats.numDropped), static_cast<unsigned long long>(stats.bytesWritten));
+	return bWritten;
+}
+
+
+void CpuProfiler::Counter(const char* name, int64_t value)
+{
+	PushEvent(CPU_EVENT_COUNTER, name, Now(), static_cast<uint64_t>(value));
+}
+
+
+void CpuProfiler::FrameMarker()
+{
+	PushEvent(CPU_EVENT_FRAME, "Frame", Now(), m_FrameNum.fetch_add(1, std::memory_order_relaxed));
+}
+
+
+CpuProfilerStats CpuProfiler::GetStats() const
+{
+	std::lock_guard<std::mutex> lock(m_ThreadLock);
+
+	CpuProfilerStats stats = m_Stats;
+	stats.numThreads = static_cast<uint32_t>(m_Threads.size());
+	stats.numDropped = 0;
+	for (const ThreadBuffer* pBuffer : m_Threads)
+	{
+		stats.numDropped += pBuffer->numDropped.load(std::memory_order_relaxed);
+	}
+	return stats;
+}
+
+
+void CpuProfiler::DrawImGui()
+{
+	if (!IsCapturing())
+	{
+		if (ImGui::Button("Capture CPU trace"))
+		{
+			Start("CpuTrace.json", CPU_TRACE_JSON);
+		}
+	}
+	else if (ImGui::Button("Save CpuTrace.json"))
+	{
+		Stop();
+	}
+
+	CpuProfilerStats stats = GetStats();
+	ImGui::Text("CPU trace: %llu events, %llu dropped, %.1f ns/scope", static_cast<unsigned long long>(stats.numEvents),
+		static_cast<unsigned long long>(stats.numDropped), stats.scopeOverheadNanoSec);
+}
+
+
+void CpuProfiler::WriterThread()
+{
+	std::unique_lock<std::mutex> lock(m_WriterLock);
+	while (!m_bStopWriter)
+	{
+		m_WriterWake.wait_for(lock, std::chrono::milliseconds(CPU_PROFILER_WRITE_INTERVAL_MS));
+		if (m_bStopWriter)
+		{
+			break;
+		}
+
+		lock.unlock();
+		Flush();
+		lock.lock();
+	}
+}
+
+
+void CpuProfiler::Flush()
+{
+	std::vector<ThreadBuffer*> threads;
+	{
+		std::lock_guard<std::mutex> lock(m_ThreadLock);
+		threads = m_Threads;
+	}
+
+	uint64_t numEvents = 0;
+	for (ThreadBuffer* pBuffer : threads)
+	{
+		uint32_t read = pBuffer->read.load(std::memory_order_relaxed);
+		const uint32_t write = pBuffer->write.load(std::memory_order_acquire);
+		for (; read != write; read++)
+		{
+			const Event& event = pBuffer->events[read & (THREAD_EVENTS - 1)];
+			if (m_Format == CPU_TRACE_JSON)
+			{
+				WriteJson(event, pBuffer->threadIndex);
+			}
+			else
+			{
+				WriteBinary(event, pBuffer->threadIndex);
+			}
+			numEvents++;
+		}
+
+		//Recording thread may reuse the slots from here on
+		pBuffer->read.store(read, std::memory_order_release);
+	}
+
+	std::lock_guard<std::mutex> lock(m_ThreadLock);
+	m_Stats.numEvents += numEvents;
+	m_Stats.bytesWritten = m_BytesWritten;
+}
+
+
+double CpuProfiler::ToMicroSec(uint64_t tick) const
+{
+	return static_cast<int64_t>(tick - m_StartTick) / m_TicksPerMicroSec;
+}
+
+
+void CpuProfiler::WriteJson(const Event& event, uint16_t threadIndex)
+{
+	const char* pSeparator = m_bFirstJsonEvent ? "" : ",\n";
+	m_bFirstJsonEvent = false;
+
+	int written = 0;
+	switch (event.type)
+	{
+	case CPU_EVENT_SCOPE:
+		written = fprintf(m_pFile, "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":0,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}", pSeparator,
+			event.name, threadIndex, ToMicroSec(event.start), (event.value - event.start) / m_TicksPerMicroSec);
+		break;
+	case CPU_EVENT_COUNTER:
+		written = fprintf(m_pFile, "%s{\"name\":\"%s\",\"ph\":\"C\",\"pid\":0,\"tid\":%u,\"ts\":%.3f,\"args\":{\"value\":%lld}}", pSeparator,
+			event.name, threadIndex, ToMicroSec(event.start), static_cast<long long>(event.value));
+		break;
+	case CPU_EVENT_FRAME:
+		written = fprintf(m_pFile, "%s{\"name\":\"%s\",\"ph\":\"i\",\"s\":\"g\",\"pid\":0,\"tid\":%u,\"ts\":%.3f,\"args\":{\"frame\":%llu}}", pSeparator,
+			event.name, threadIndex, ToMicroSec(event.start), static_cast<unsigned long long>(event.value));
+		break;
+	}
+	m_BytesWritten += std::max(written, 0);
+}
+
+
+void CpuProfiler::WriteBinary(const Event& event, uint16_t threadIndex)
+{
+	//Names go out once, before their first use
+	auto it = m_NameIds.find(event.name);
+	if (it == m_NameIds.end())
+	{
+		const uint32_t id = static_cast<uint32_t>(m_NameIds.size());
+		const uint16_t length = static_cast<uint16_t>(std::min<size_t>(strlen(event.name), UINT16_MAX));
+		m_BytesWritten += WriteValue(m_pFile, static_cast<uint8_t>(CPU_EVENT_NAME));
+		m_BytesWritten += WriteValue(m_pFile, id);
+		m_BytesWritten += WriteValue(m_pFile, length);
+		m_BytesWritten += fwrite(event.name, 1, length, m_pFile);
+		it = m_NameIds.insert(std::make_pair(event.name, id)).first;
+	}
+
+	m_BytesWritten += WriteValue(m_pFile, static_cast<uint8_t>(event.type));
+	m_BytesWritten += WriteValue(m_pFile, it->second);
+	m_BytesWritten += WriteValue(m_pFile, threadIndex);
+	m_BytesWritten += WriteValue(m_pFile, event.start);
+	m_BytesWritten += WriteValue(m_pFile, event.value);
+}
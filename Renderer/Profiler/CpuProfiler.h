@@ -0,0 +1,272 @@
+/*
+*	Copyright 2015-2016 Tomas Mikalauskas. All rights reserved.
+*	GitHub repository - https://github.com/TywyllSoftware/TywRenderer
+*	This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+#pragma once
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <chrono>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+
+// Set to 0 to compile all TYW_PROFILE_* markers out
+#ifndef TYW_CPU_PROFILER
+#define TYW_CPU_PROFILER 1
+#endif
+
+
+enum CpuTraceFormat
+{
+	CPU_TRACE_JSON,		// Chrome trace events, open in chrome://tracing
+	CPU_TRACE_BINARY	// see CpuProfiler::WriteBinary
+};
+
+
+struct CpuProfilerStats
+{
+	uint64_t		numEvents;				// written by the current or last capture
+	uint64_t		numDropped;				// thread buffer was full
+	uint64_t		bytesWritten;
+	uint32_t		numThreads;				// threads that recorded at least one event
+	double			scopeOverheadNanoSec;	// measured by Start, begin and end of one scope
+};
+
+
+/*
+	CpuProfiler
+	Every thread records into its own fixed ring of events. The recording thread is
+	the only producer and the writer thread the only consumer of a ring, so recording
+	is two TSC reads and one store, without locks or allocations. A thread takes the
+	registration lock once, on its first event.
+
+	While capturing, a background thread drains the rings every few milliseconds and
+	streams them to the trace file. Markers are ignored while not capturing.
+	Names are kept by pointer, pass string literals.
+*/
+class CpuProfiler
+{
+public:
+	CpuProfiler();
+	~CpuProfiler();
+
+	/*
+		@param: const std::string& fileName
+		@param: CpuTraceFormat format
+		@return: bool - false if the file could not be opened
+	*/
+	bool Start(const std::string& fileName, CpuTraceFormat format);
+
+	/*
+		Writes remaining events and closes the file
+
+		@return: bool - false if not capturing or writing failed
+	*/
+	bool Stop();
+
+	bool IsCapturing() const { return m_bCapturing.load(std::memory_order_relaxed); }
+
+	/*
+		@param: const char* name
+		@param: int64_t value
+	*/
+	void Counter(const char* name, int64_t value);
+
+	//Marks the start of a new frame
+	void FrameMarker();
+
+	CpuProfilerStats GetStats() const;
+
+	//ImGui capture button and stats. Call inside an ImGui window
+	void DrawImGui();
+
+	/*
+		Records a finished scope, used by CpuProfileScope
+
+		@param: const char* name
+		@param: uint64_t start
+		@param: uint64_t end
+	*/
+	void Scope(const char* name, uint64_t start, uint64_t end) { PushEvent(CPU_EVENT_SCOPE, name, start, end); }
+
+	//TSC ticks, or high resolution clock ticks where there is no TSC
+	static uint64_t Now()
+	{
+#if defined(_MSC_VER) || defined(__x86_64__) || defined(__i386__)
+		return __rdtsc();
+#else
+		return static_cast<uint64_t>(std::chrono::high_resolution_clock::now().time_since_epoch().count());
+#endif
+	}
+
+private:
+	CpuProfiler(const CpuProfiler&) = delete;
+	CpuProfiler& operator=(const CpuProfiler&) = delete;
+
+	enum EventType
+	{
+		CPU_EVENT_NAME,			// binary files only
+		CPU_EVENT_SCOPE,		// value is the end tick
+		CPU_EVENT_COUNTER,		// value is the counter
+		CPU_EVENT_FRAME			// value is the frame number
+	};
+
+	struct Event
+	{
+		const char*		name;
+		uint64_t		start;
+		uint64_t		value;
+		uint32_t		type;
+	};
+
+	static const uint32_t THREAD_EVENTS = 1 << 16;
+
+	struct ThreadBuffer
+	{
+		std::atomic<uint32_t>	write;		// recording thread
+		std::atomic<uint32_t>	read;		// writer thread
+		std::atomic<uint64_t>	numDropped;
+		uint16_t				threadIndex;
+		Event					events[THREAD_EVENTS];
+	};
+
+	struct ThreadSlot
+	{
+		uint32_t		profilerId;
+		ThreadBuffer*	pBuffer;
+	};
+
+	void PushEvent(uint32_t type, const char* name, uint64_t start, uint64_t value)
+	{
+		if (!IsCapturing())
+		{
+			return;
+		}
+
+		ThreadBuffer* pBuffer = (s_ThreadSlot.profilerId == m_Id) ? s_ThreadSlot.pBuffer : RegisterThread();
+		const uint32_t write = pBuffer->write.load(std::memory_order_relaxed);
+		if (write - pBuffer->read.load(std::memory_order_acquire) >= THREAD_EVENTS)
+		{
+			pBuffer->numDropped.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+
+		Event& event = pBuffer->events[write & (THREAD_EVENTS - 1)];
+		event.name = name;
+		event.start = start;
+		event.value = value;
+		event.type = type;
+		pBuffer->write.store(write + 1, std::memory_order_release);
+	}
+
+	ThreadBuffer* RegisterThread();
+
+	void WriterThread();
+
+	//Drains all thread buffers into the file
+	void Flush();
+
+	void WriteJson(const Event& event, uint16_t threadIndex);
+
+	/*
+		Little endian records after the header
+		header:  char[8] "TYWCPU01", double ticksPerMicroSec, uint64_t startTick
+		name:    uint8_t 0, uint32_t id, uint16_t length, char[length]
+		scope:   uint8_t 1, uint32_t nameId, uint16_t thread, uint64_t start, uint64_t end
+		counter: uint8_t 2, uint32_t nameId, uint16_t thread, uint64_t tick, int64_t value
+		frame:   uint8_t 3, uint32_t nameId, uint16_t thread, uint64_t tick, uint64_t frameNum
+		Ticks are raw, ticksPerMicroSec converts them
+	*/
+	void WriteBinary(const Event& event, uint16_t threadIndex);
+
+	double ToMicroSec(uint64_t tick) const;
+
+private:
+	static thread_local ThreadSlot	s_ThreadSlot;
+	static std::atomic<uint32_t>	s_NextId;
+
+	uint32_t						m_Id;				// tells buffers of a deleted profiler apart
+	std::atomic<bool>				m_bCapturing;
+	std::atomic<uint64_t>			m_FrameNum;
+
+	mutable std::mutex				m_ThreadLock;
+	std::vector<ThreadBuffer*>		m_Threads;
+
+	//Calibration of ticks to wall time
+	uint64_t						m_CreateTick;
+	std::chrono::high_resolution_clock::time_point	m_CreateTime;
+	double							m_TicksPerMicroSec;
+	uint64_t						m_StartTick;
+
+	//Writer thread state
+	std::thread						m_Writer;
+	std::mutex						m_WriterLock;
+	std::condition_variable			m_WriterWake;
+	bool							m_bStopWriter;
+	FILE*							m_pFile;
+	CpuTraceFormat					m_Format;
+	bool							m_bFirstJsonEvent;
+	std::unordered_map<const char*, uint32_t>	m_NameIds;
+	uint64_t						m_BytesWritten;
+
+	CpuProfilerStats				m_Stats;
+};
+
+
+// Engine wide profiler, owned by the renderer. Markers do nothing while it is nullptr
+extern CpuProfiler* cpuProfiler;
+
+
+/*
+	CpuProfileScope
+	Records the lifetime of the object as one complete trace event
+*/
+class CpuProfileScope
+{
+public:
+	explicit CpuProfileScope(const char* name):
+		m_pName(name),
+		m_Start((cpuProfiler != nullptr && cpuProfiler->IsCapturing()) ? CpuProfiler::Now() : 0)
+	{
+	}
+
+	~CpuProfileScope()
+	{
+		if (m_Start != 0)
+		{
+			cpuProfiler->Scope(m_pName, m_Start, CpuProfiler::Now());
+		}
+	}
+
+private:
+	CpuProfileScope(const CpuProfileScope&) = delete;
+	CpuProfileScope& operator=(const CpuProfileScope&) = delete;
+
+	const char*		m_pName;
+	uint64_t		m_Start;
+};
+
+
+#if TYW_CPU_PROFILER
+#define TYW_PROFILE_CONCAT_INNER(a, b) a##b
+#define TYW_PROFILE_CONCAT(a, b) TYW_PROFILE_CONCAT_INNER(a, b)
+#define TYW_PROFILE_SCOPE(name) CpuProfileScope TYW_PROFILE_CONCAT(cpuProfileScope, __LINE__)(name)
+#define TYW_PROFILE_FUNCTION() TYW_PROFILE_SCOPE(__FUNCTION__)
+#define TYW_PROFILE_COUNTER(name, value) do { if (cpuProfiler) { cpuProfiler->Counter(name, static_cast<int64_t>(value)); } } while (0)
+#define TYW_PROFILE_FRAME() do { if (cpuProfiler) { cpuProfiler->FrameMarker(); } } while (0)
+#else
+#define TYW_PROFILE_SCOPE(name)
+#define TYW_PROFILE_FUNCTION()
+#define TYW_PROFILE_COUNTER(name, value)
+#define TYW_PROFILE_FRAME()
+#endif
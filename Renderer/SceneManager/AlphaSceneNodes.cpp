@@ -0,0 +1,138 @@
+#include <RendererPch/stdafx.h>
+
+
+//SceneManager Includes
+#include "AlphaSceneNodes.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE__)
+#define ALPHA_DEPTH_SSE
+#include <xmmintrin.h>
+#endif
+
+
+void AlphaSceneNodes::Clear()
+{
+	//clear() keeps capacity
+	m_Nodes.clear();
+	m_WorldMatrices.clear();
+	m_PosX.clear();
+	m_PosY.clear();
+	m_PosZ.clear();
+}
+
+
+void AlphaSceneNodes::Add(ISceneNode* pNode, const glm::mat4x4& worldMatrix)
+{
+	m_Nodes.push_back(pNode);
+	m_WorldMatrices.push_back(worldMatrix);
+
+	//Translation is the last column
+	m_PosX.push_back(worldMatrix[3][0]);
+	m_PosY.push_back(worldMatrix[3][1]);
+	m_PosZ.push_back(worldMatrix[3][2]);
+}
+
+
+void AlphaSceneNodes::Sort(const glm::mat4x4& view)
+{
+	ComputeViewDepth(view);
+	RadixSort();
+}
+
+
+//
+// AlphaSceneNodes::ComputeViewDepth
+//
+//	Camera looks down -Z, so distance from the camera plane is
+//	-(view * pos).z. Only the z row of the view matrix is needed.
+//
+void AlphaSceneNodes::ComputeViewDepth(const glm::mat4x4& view)
+{
+	const size_t count = m_Nodes.size();
+	m_Depth.resize(count);
+
+	const float rx = -view[0][2];
+	const float ry = -view[1][2];
+	const float rz = -view[2][2];
+	const float rw = -view[3][2];
+
+	size_t i = 0;
+#ifdef ALPHA_DEPTH_SSE
+	const __m128 vx = _mm_set1_ps(rx);
+	const __m128 vy = _mm_set1_ps(ry);
+	const __m128 vz = _mm_set1_ps(rz);
+	const __m128 vw = _mm_set1_ps(rw);
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128 depth = _mm_add_ps(vw, _mm_mul_ps(vx, _mm_loadu_ps(&m_PosX[i])));
+		depth = _mm_add_ps(depth, _mm_mul_ps(vy, _mm_loadu_ps(&m_PosY[i])));
+		depth = _mm_add_ps(depth, _mm_mul_ps(vz, _mm_loadu_ps(&m_PosZ[i])));
+		_mm_storeu_ps(&m_Depth[i], depth);
+	}
+#endif
+	for (; i < count; i++)
+	{
+		m_Depth[i] = rw + rx * m_PosX[i] + ry * m_PosY[i] + rz * m_PosZ[i];
+	}
+}
+
+
+//
+// AlphaSceneNodes::RadixSort
+//
+//	Float bits are remapped so unsigned order matches float order, then
+//	inverted so the farthest node gets the smallest key. Four 8 bit LSD
+//	passes keep equal keys in insertion order.
+//
+void AlphaSceneNodes::RadixSort()
+{
+	const uint32_t count = static_cast<uint32_t>(m_Nodes.size());
+	m_Keys.resize(count);
+	m_KeysTemp.resize(count);
+	m_SortedIndices.resize(count);
+	m_IndicesTemp.resize(count);
+
+	for (uint32_t i = 0; i < count; i++)
+	{
+		uint32_t bits;
+		memcpy(&bits, &m_Depth[i], sizeof(bits));
+		bits ^= (bits & 0x80000000u) ? 0xFFFFFFFFu : 0x80000000u;
+
+		m_Keys[i] = ~bits;
+		m_SortedIndices[i] = i;
+	}
+
+	uint32_t* keysIn = m_Keys.data();
+	uint32_t* keysOut = m_KeysTemp.data();
+	uint32_t* indicesIn = m_SortedIndices.data();
+	uint32_t* indicesOut = m_IndicesTemp.data();
+
+	for (uint32_t shift = 0; shift < 32; shift += 8)
+	{
+		uint32_t offsets[256] = { 0 };
+		for (uint32_t i = 0; i < count; i++)
+		{
+			offsets[(keysIn[i] >> shift) & 0xFF]++;
+		}
+
+		uint32_t sum = 0;
+		for (uint32_t b = 0; b < 256; b++)
+		{
+			const uint32_t bucketSize = offsets[b];
+			offsets[b] = sum;
+			sum += bucketSize;
+		}
+
+		for (uint32_t i = 0; i < count; i++)
+		{
+			const uint32_t dst = offsets[(keysIn[i] >> shift) & 0xFF]++;
+			keysOut[dst] = keysIn[i];
+			indicesOut[dst] = indicesIn[i];
+		}
+
+		std::swap(keysIn, keysOut);
+		std::swap(indicesIn, indicesOut);
+	}
+
+	//Even number of passes, result is back in m_Keys/m_SortedIndices
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+
+//forward declaration
+class ISceneNode;
+
+
+/*
+	AlphaSceneNodes
+	Translucent nodes collected during scene traversal. They are drawn after
+	all opaque geometry, sorted back to front.
+
+	Data is stored as flat arrays that are cleared, not freed, every frame.
+	Once capacity reached the scene's peak there are no allocations per frame.
+	View depth is computed four nodes at a time and sorted with LSD radix sort,
+	which is stable. Nodes at equal depth keep the order they were added in,
+	so the result is the same every frame.
+*/
+class AlphaSceneNodes
+{
+public:
+	void Clear();
+
+	/*
+		@param: ISceneNode* pNode
+		@param: const glm::mat4x4& worldMatrix - concatenated transform used for rendering and depth
+	*/
+	void Add(ISceneNode* pNode, const glm::mat4x4& worldMatrix);
+
+	/*
+		Computes view space distance of every node and orders them back to front
+
+		@param: const glm::mat4x4& view
+	*/
+	void Sort(const glm::mat4x4& view);
+
+	size_t Size() const { return m_Nodes.size(); }
+	bool Empty() const { return m_Nodes.empty(); }
+
+	// Valid after Sort(). Index 0 is the farthest node
+	ISceneNode* GetSortedNode(size_t i) const { return m_Nodes[m_SortedIndices[i]]; }
+	const glm::mat4x4& GetSortedWorldMatrix(size_t i) const { return m_WorldMatrices[m_SortedIndices[i]]; }
+	float GetSortedDepth(size_t i) const { return m_Depth[m_SortedIndices[i]]; }
+
+private:
+	void ComputeViewDepth(const glm::mat4x4& view);
+	void RadixSort();
+
+private:
+	std::vector<ISceneNode*>	m_Nodes;
+	std::vector<glm::mat4x4>	m_WorldMatrices;
+
+	//World position split per axis so depth can be computed four at a time
+	std::vector<float>			m_PosX;
+	std::vector<float>			m_PosY;
+	std::vector<float>			m_PosZ;
+	std::vector<float>			m_Depth;
+
+	std::vector<uint32_t>		m_Keys;
+	std::vector<uint32_t>		m_KeysTemp;
+	std::vector<uint32_t>		m_SortedIndices;
+	std::vector<uint32_t>		m_IndicesTemp;
+};
@@ -1,4 +1,4 @@
-#include <RendererPch\stdafx.h>
+#include <RendererPch/stdafx.h>
 
 
 //SceneManager Includes
@@ -6,14 +6,22 @@
 #include "SceneManager.h"
 #include "RootNode.h"
 
+//JobSystem Includes
+#include <Renderer/JobSystem/JobSystem.h>
 
 
+//Every thread gets few batches so work stealing can even out uneven subtrees
+static const size_t UPDATE_BATCHES_PER_THREAD = 4;
 
 
-SceneManager::SceneManager(std::shared_ptr<IRenderer> renderer)
+
+
+SceneManager::SceneManager(std::shared_ptr<IRenderer> renderer):
+	m_pJobSystem(jobSystem)
 {
 	m_Root.reset(TYW_NEW RootNode());
 	m_Renderer = renderer;
+	memset(&m_UpdateStats, 0, sizeof(m_UpdateStats));
 
 	//D3DXCreateMatrixStack(0, &m_MatrixStack);
 
@@ -59,6 +67,7 @@ HRESULT SceneManager::OnRender()
 		// matrix
 
 		m_Camera->SetViewTransform(this);
+		m_AlphaSceneNodes.Clear();
 
 		//	m_LightManager->CalcLighting(this);
 		if (m_Root->VPreRender(this) == S_OK)
@@ -137,19 +146,83 @@ bool SceneManager::RemoveChild(uint32_t id)
 //
 // Scene::OnUpdate					- Chapter 16, page 540
 //
+//	Update phase runs VOnUpdate of independent subtrees in parallel.
+//	Barrier is passed before transforms are propagated, so propagation and
+//	culling always see the final state of every node no matter how jobs were scheduled.
+//
 HRESULT SceneManager::OnUpdate(const int deltaMilliseconds)
 {
 	if (!m_Root)
 		return S_OK;
 
-	//	static DWORD lastTime = timeGetTime();
-	//	DWORD elapsedTime = 0;
-	//	DWORD now = timeGetTime();
+	const DWORD elapsedMs = static_cast<DWORD>(deltaMilliseconds);
+	auto tStart = std::chrono::high_resolution_clock::now();
+
+	GatherUpdateRoots();
+	m_UpdateStats.numSubtrees = static_cast<uint32_t>(m_UpdateRoots.size());
+
+	if (m_pJobSystem && m_pJobSystem->GetThreadCount() > 1)
+	{
+		const size_t numRoots = m_UpdateRoots.size();
+		const size_t numBatches = m_pJobSystem->GetThreadCount() * UPDATE_BATCHES_PER_THREAD;
+		const size_t batchSize = std::max<size_t>(1, (numRoots + numBatches - 1) / numBatches);
+
+		JobCounter counter;
+		m_UpdateStats.numBatches = 0;
+		for (size_t first = 0; first < numRoots; first += batchSize)
+		{
+			const size_t last = std::min(first + batchSize, numRoots);
+			m_pJobSystem->Submit([this, first, last, elapsedMs]()
+			{
+				for (size_t i = first; i < last; i++)
+				{
+					m_UpdateRoots[i]->VOnUpdate(this, elapsedMs);
+				}
+			}, &counter);
+			m_UpdateStats.numBatches++;
+		}
 
-	//	elapsedTime = now - lastTime;
-	//	lastTime = now;
+		//Barrier
+		m_pJobSystem->Wait(&counter);
+		m_UpdateStats.numThreads = m_pJobSystem->GetThreadCount();
+	}
+	else
+	{
+		m_Root->VOnUpdate(this, elapsedMs);
+		m_UpdateStats.numBatches = 1;
+		m_UpdateStats.numThreads = 1;
+	}
+	auto tUpdate = std::chrono::high_resolution_clock::now();
+
+	m_Root->PropagateTransform(glm::mat4x4());
+	auto tEnd = std::chrono::high_resolution_clock::now();
 
-	return m_Root->VOnUpdate(this, 0);
+	m_UpdateStats.updateMilliSec = std::chrono::duration<double, std::milli>(tUpdate - tStart).count();
+	m_UpdateStats.transformMilliSec = std::chrono::duration<double, std::milli>(tEnd - tUpdate).count();
+	return S_OK;
+}
+
+
+//
+// SceneManager::GatherUpdateRoots
+//
+//	Root node children are render pass groups. Every child of a group is a
+//	subtree that does not share nodes with any other subtree.
+//	Order follows the scene graph so batches are always built the same way.
+//
+void SceneManager::GatherUpdateRoots()
+{
+	m_UpdateRoots.clear();
+
+	const SceneNodeList& groups = m_Root->GetChildren();
+	for (SceneNodeList::const_iterator group = groups.begin(); group != groups.end(); ++group)
+	{
+		const SceneNodeList& subtrees = static_cast<SceneNode*>(group->get())->GetChildren();
+		for (SceneNodeList::const_iterator i = subtrees.begin(); i != subtrees.end(); ++i)
+		{
+			m_UpdateRoots.push_back(static_cast<SceneNode*>(i->get()));
+		}
+	}
 }
 
 //
@@ -172,18 +245,16 @@ std::shared_ptr<ISceneNode> SceneManager::FindActor(uint32_t id)
 //
 void SceneManager::RenderAlphaPass()
 {
-	/*
-	std::shared_ptr<IRenderState> alphaPass = m_Renderer->VPrepareAlphaPass();
+	//std::shared_ptr<IRenderState> alphaPass = m_Renderer->VPrepareAlphaPass();
+	if (m_AlphaSceneNodes.Empty())
+		return;
 
-	m_AlphaSceneNodes.sort();
-	while (!m_AlphaSceneNodes.empty())
+	m_AlphaSceneNodes.Sort(m_Camera->GetView());
+	for (size_t i = 0; i < m_AlphaSceneNodes.Size(); i++)
 	{
-	AlphaSceneNodes::reverse_iterator i = m_AlphaSceneNodes.rbegin();
-	PushAndSetMatrix((*i)->m_Concat);
-	(*i)->m_pNode->VRender(this);
-	delete (*i);
-	PopMatrix();
-	m_AlphaSceneNodes.pop_back();
+		PushAndSetMatrix(m_AlphaSceneNodes.GetSortedWorldMatrix(i));
+		m_AlphaSceneNodes.GetSortedNode(i)->VRender(this);
+		PopMatrix();
 	}
-	*/
-}
\ No newline at end of file
+	m_AlphaSceneNodes.Clear();
+}
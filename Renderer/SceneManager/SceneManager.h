@@ -1,10 +1,25 @@
 #pragma once
+#include "AlphaSceneNodes.h"
 
 
 //forward declaration
 class SceneNode;
 class CameraNode;
 class IRenderer;
+class JobSystem;
+
+
+/*
+	Timings of the last SceneManager::OnUpdate call
+*/
+struct SceneUpdateStats
+{
+	uint32_t	numThreads;			// threads that took part in update phase
+	uint32_t	numSubtrees;		// independent subtrees found under render pass groups
+	uint32_t	numBatches;			// jobs the subtrees were packed into
+	double		updateMilliSec;		// VOnUpdate phase including the barrier
+	double		transformMilliSec;	// world transform propagation
+};
 
 
 /*
@@ -18,11 +33,18 @@ protected:
 	std::shared_ptr<CameraNode> 	m_Camera;
 	std::shared_ptr<IRenderer>		m_Renderer;
 
-	//AlphaSceneNodes 				m_AlphaSceneNodes;
+	AlphaSceneNodes 				m_AlphaSceneNodes;
 	SceneActorMap 					m_ActorMap;
 	//LightManager					*m_LightManager;
 	void RenderAlphaPass();
 
+	JobSystem*						m_pJobSystem;
+	SceneUpdateStats				m_UpdateStats;
+
+	//Roots of independent subtrees. Kept between frames to avoid reallocation
+	std::vector<SceneNode*>			m_UpdateRoots;
+	void GatherUpdateRoots();
+
 public:
 	SceneManager(std::shared_ptr<IRenderer> renderer = nullptr);
 	virtual ~SceneManager();
@@ -36,6 +58,16 @@ public:
 	bool RemoveChild(uint32_t id);
 
 
+	/*
+		Defaults to the engine job system. When set, OnUpdate runs VOnUpdate of every top level subtree on the job system.
+		VOnUpdate may only modify its own node and descendants. Reading siblings
+		or other subtrees during update phase is a data race.
+
+		@param: JobSystem* pJobSystem - nullptr for serial update
+	*/
+	void SetJobSystem(JobSystem* pJobSystem) { m_pJobSystem = pJobSystem; }
+	const SceneUpdateStats& GetUpdateStats() const { return m_UpdateStats; }
+
 	void SetCamera(std::shared_ptr<CameraNode> camera) { m_Camera = camera; }
 	const std::shared_ptr<CameraNode> GetCamera() const { return m_Camera; }
 
@@ -70,7 +102,7 @@ public:
 	}
 
 	///LightManager *GetLightManager() { return m_LightManager; }
-	//void AddAlphaSceneNode(AlphaSceneNode *asn) { m_AlphaSceneNodes.push_back(asn); }
+	void AddAlphaSceneNode(ISceneNode* pNode, const glm::mat4x4& worldMatrix) { m_AlphaSceneNodes.Add(pNode, worldMatrix); }
 
 	HRESULT Pick(RayCast *pRayCast) { return m_Root->VPick(this, pRayCast); }
 	std::shared_ptr<IRenderer> GetRenderer() { return m_Renderer; }
@@ -1,4 +1,4 @@
-#include <RendererPch\stdafx.h>
+#include <RendererPch/stdafx.h>
 
 //SceneManager Includes
 #include "CameraNode.h"
@@ -158,6 +158,18 @@ bool SceneNode::VOnUpdate(SceneManager *pScene, DWORD const elapsedMs)
 }
 
 
+//
+// SceneNode::PropagateTransform
+void SceneNode::PropagateTransform(const glm::mat4x4& parentWorld)
+{
+	m_Props.m_WorldMatrix = parentWorld * m_Props.m_ToWorld;
+
+	for (SceneNodeList::const_iterator i = m_Children.begin(); i != m_Children.end(); ++i)
+	{
+		static_cast<SceneNode*>(i->get())->PropagateTransform(m_Props.m_WorldMatrix);
+	}
+}
+
 
 glm::vec3 SceneNode::GetDirection() const
 {
@@ -241,33 +253,16 @@ bool SceneNode::VRenderChildren(SceneManager *pScene)
 			// Don't render this node if you can't see it
 			//if ((*i)->VIsVisible(pScene))
 			//{
-			float alpha = 0.0f;
-			(*i)->VRender(pScene);
-
-			if (alpha == 1.0f)
+			if ((*i)->VGet()->HasAlpha())
 			{
-
+				// The object isn't totally opaque. It is drawn
+				// back to front after all opaque geometry
+				pScene->AddAlphaSceneNode(i->get(), (*i)->VGet()->WorldMatrix());
 			}
-			/*
-			else if (alpha != 1.0f)
+			else
 			{
-			// The object isn't totally transparent...
-			AlphaSceneNode *asn = TYW_NEW AlphaSceneNode;
-			assert(asn);
-			asn->m_pNode = *i;
-			asn->m_Concat = pScene->GetTopMatrix();
-
-			glx::vec4<float> worldPos(asn->m_Concat.GetPosition());
-
-			glx::mat4<float> fromWorld = pScene->GetCamera()->VGet()->FromWorld();
-
-			glx::vec4<float> screenPos;// = fromWorld.Xform(worldPos);
-
-			asn->m_ScreenZ = screenPos.z;
-
-			pScene->AddAlphaSceneNode(asn);
+				(*i)->VRender(pScene);
 			}
-			*/
 
 			// [mrmike] see comment just below...
 			(*i)->VRenderChildren(pScene);
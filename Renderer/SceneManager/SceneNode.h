@@ -72,7 +72,7 @@ public:
 	virtual bool VPick(SceneManager *pScene, RayCast *pRayCast);
 
 	void SetAlpha(float alpha);
-	float GetAlpha() const { return 0; }
+	float GetAlpha() const { return m_Props.Alpha(); }
 
 	glm::vec3 GetPosition() const;
 	void SetPosition(const glm::vec3 &pos) {  }
@@ -82,6 +82,16 @@ public:
 	glm::vec3 GetDirection() const;
 
 	void SetRadius(const float radius) { m_Props.m_Radius = radius; }
-//	void SetMaterial(const Material &mat) { m_Props.m_Material = mat; }
+
+	const SceneNodeList& GetChildren() const { return m_Children; }
+
+	/*
+		Concatenates parent world matrix with this node ToWorld and
+		pushes the result down to children. Runs after update phase.
+
+		@param: const glm::mat4x4& parentWorld
+	*/
+	void PropagateTransform(const glm::mat4x4& parentWorld);
+	void SetMaterial(const Material* pMaterial) { m_Props.m_pMaterial = pMaterial; }
 };
 
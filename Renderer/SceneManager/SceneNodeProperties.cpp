@@ -1,16 +1,23 @@
-#include <RendererPch\stdafx.h>
+#include <RendererPch/stdafx.h>
 
 
 //SceneManager Includes
 #include "SceneNode.h"
 #include "SceneNodeProperties.h"
 
+//Renderer Includes
+#include <External/vulkan/vulkan.h>
+#include <Renderer/MeshLoader/Material.h>
+
 
 SceneNodeProperties::SceneNodeProperties(void)
 {
 	m_ActorId = static_cast<uint32_t>(RenderPass::RenderPass_0);
 	m_Radius = 0;
 	m_RenderPass = RenderPass::RenderPass_0;
+	m_pMaterial = nullptr;
+	m_AlphaType = AlphaOpaque;
+	m_Alpha = 1.0f;
 }
 
 
@@ -23,4 +30,26 @@ void SceneNodeProperties::Transform(glm::mat4x4 *toWorld, glm::mat4x4 *fromWorld
 
 	if (fromWorld)
 		*fromWorld = m_FromWorld;
-}
\ No newline at end of file
+}
+
+
+//
+// SceneNodeProperties::HasAlpha
+bool SceneNodeProperties::HasAlpha() const
+{
+	if (m_AlphaType != AlphaOpaque)
+		return true;
+
+	return m_pMaterial && m_pMaterial->HasAlpha();
+}
+
+
+//
+// SceneNodeProperties::Alpha
+float SceneNodeProperties::Alpha() const
+{
+	if (m_AlphaType == AlphaMaterial || !m_pMaterial)
+		return m_Alpha;
+
+	return m_pMaterial->GetAlpha();
+}
@@ -3,6 +3,20 @@
 
 //forward declaration
 enum class RenderPass: uint32_t;
+class Material;
+
+
+/*
+	Source of node translucency. Anything but AlphaOpaque
+	sends the node to the sorted alpha pass.
+*/
+enum AlphaType
+{
+	AlphaOpaque,
+	AlphaTexture,
+	AlphaMaterial,
+	AlphaVertex
+};
 
 /*
 	class SceneNodeProperties
@@ -18,14 +32,17 @@ protected:
 	uint32_t                m_ActorId;
 	std::string				m_Name;
 	glm::mat4x4		        m_ToWorld, m_FromWorld;
+	glm::mat4x4				m_WorldMatrix;			// m_ToWorld concatenated with all ancestors
 	float					m_Radius;
-	RenderPass				m_RenderPass;
-	//Material				m_Material;
-	//AlphaType				m_AlphaType;
+	::RenderPass			m_RenderPass;
+	const Material*			m_pMaterial;			// not owned. Shared with render model
+	::AlphaType				m_AlphaType;
+	float					m_Alpha;				// node override, used when m_AlphaType is AlphaMaterial
 
 	void SetAlpha(const float alpha)
 	{
-		//m_AlphaType = AlphaMaterial; m_Material.SetAlpha(alpha);
+		m_Alpha = alpha;
+		m_AlphaType = (alpha != 1.0f) ? AlphaMaterial : AlphaOpaque;
 	}
 
 public:
@@ -33,15 +50,16 @@ public:
 	const uint32_t &ActorId() const { return m_ActorId; }
 	glm::mat4x4 const &ToWorld() const { return m_ToWorld; }
 	glm::mat4x4 const &FromWorld() const { return m_FromWorld; }
+	glm::mat4x4 const &WorldMatrix() const { return m_WorldMatrix; }
 	void Transform(glm::mat4x4 *toWorld, glm::mat4x4 *fromWorld) const;
 
 	const char * Name() const { return m_Name.c_str(); }
 
-	//bool HasAlpha() const { return m_Material.HasAlpha(); }
-	//float Alpha() const { return m_Material.GetAlpha(); }
-	//AlphaType AlphaType() const { return m_AlphaType; }
+	bool HasAlpha() const;
+	float Alpha() const;
+	::AlphaType AlphaType() const { return m_AlphaType; }
 
-	RenderPass RenderPass() const { return m_RenderPass; }
+	::RenderPass RenderPass() const { return m_RenderPass; }
 	float Radius() const { return m_Radius; }
-	//Material GetMaterial() const { return m_Material; }
+	const Material* GetMaterial() const { return m_pMaterial; }
 };
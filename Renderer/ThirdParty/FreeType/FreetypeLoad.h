@@ -12,7 +12,7 @@
 	//#define FT_BASE(x) __declspec(import) x
 #endif
 
-#include <External\freetype\include\ft2build.h>
+#include <External/freetype/include/ft2build.h>
 #include FT_FREETYPE_H //Include main FREETYPE2 API
 
 
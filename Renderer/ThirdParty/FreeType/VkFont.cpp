@@ -3,27 +3,28 @@
 *	GitHub repository - https://github.com/TywyllSoftware/TywRenderer
 *	This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
 */
-#include <RendererPch\stdafx.h>
+#include <RendererPch/stdafx.h>
 
 
-#include "Geometry\VertData.h"
-#include "Geometry\JointTransform.h"
+#include "Geometry/VertData.h"
+#include "Geometry/JointTransform.h"
 
 //Renderer Includes
-#include "Vulkan\VulkanTools.h"
-#include "Vulkan\VkBufferObject.h"
-#include "Vulkan\VulkanTextureLoader.h"
-#include "Vulkan\VkTexture2D.h"
+#include "Vulkan/VulkanTools.h"
+#include "Vulkan/VkBufferObject.h"
+#include "Vulkan/VulkanTextureLoader.h"
+#include "Vulkan/VkTexture2D.h"
+#include "Vulkan/VulkanDescriptorAllocator.h"
 
 //Main Renderer
 #include "VKRenderer.h"
 
-#include "ThirdParty\FreeType\FreetypeLoad.h"
+#include "ThirdParty/FreeType/FreetypeLoad.h"
 #include "VkFont.h"
 
 
 //math
-#include <External\glm\glm\gtc\matrix_inverse.hpp>
+#include <External/glm/glm/gtc/matrix_inverse.hpp>
 
 
 /*
@@ -85,9 +86,7 @@ void VkFont::InitializeChars(char* source, VkTools::VulkanTextureLoader& pTextur
 		printf("ERROR: VkFont::InitializeChars: returned false \n");
 	}
 	
-	//SetupDescriptorPool();
 	//SetupDescriptorSetLayout();
-	VkDescriptorSetAllocateInfo allocInfo = VkTools::Initializer::DescriptorSetAllocateInfo(descriptorPool, &descriptorSetLayout, 1);
 
 	size_t size = strlen(source);
 	for (int i = 0; i < size; i++) 
@@ -102,8 +101,8 @@ void VkFont::InitializeChars(char* source, VkTools::VulkanTextureLoader& pTextur
 
 
 
-			VkDescriptorSet set;
-			VK_CHECK_RESULT(vkAllocateDescriptorSets(device, &allocInfo, &set));
+			//One set per glyph, shared allocator grows with the number of chars
+			VkDescriptorSet set = descriptorAllocator->Allocate(descriptorSetLayout);
 			VkDescriptorImageInfo texDescriptorDiffuse = VkTools::Initializer::DescriptorImageInfo(texture->sampler, texture->view, VK_IMAGE_LAYOUT_GENERAL);
 			std::vector<VkWriteDescriptorSet> writeDescriptorSets =
 			{
@@ -220,7 +219,7 @@ VkFont::~VkFont()
 
 		vkDestroyImageView(device, pTexture->view, nullptr);
 		vkDestroyImage(device, pTexture->image, nullptr);
-		vkFreeMemory(device, pTexture->deviceMemory, nullptr);
+		memoryAllocator->Free(pTexture->allocation);
 		vkDestroySampler(device, pTexture->sampler, nullptr);
 	}
 
@@ -258,7 +257,6 @@ VkFont::~VkFont()
 	//Destroy cache and pool
 	vkDestroyPipelineCache(device, pipelineCache, nullptr);
 	vkDestroyCommandPool(device, commandPool, nullptr);
-	vkDestroyDescriptorPool(device, descriptorPool, nullptr);
 }
 
 
@@ -281,20 +279,6 @@ void VkFont::SetupDescriptorSetLayout()
 }
 
 
-void VkFont::SetupDescriptorPool()
-{
-	// Example uses one ubo and one image sampler
-	std::vector<VkDescriptorPoolSize> poolSizes =
-	{
-		VkTools::Initializer::DescriptorPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 256),
-		VkTools::Initializer::DescriptorPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 256)
-	};
-
-	VkDescriptorPoolCreateInfo descriptorPoolInfo = VkTools::Initializer::DescriptorPoolCreateInfo(poolSizes.size(), poolSizes.data(), 66);
-	VK_CHECK_RESULT(vkCreateDescriptorPool(device, &descriptorPoolInfo, nullptr, &descriptorPool));
-}
-
-
 void VkFont::PrepareRenderPass()
 {
 	VkAttachmentDescription attachments[2] = {};
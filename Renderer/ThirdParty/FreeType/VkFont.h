@@ -46,7 +46,6 @@ public:
 	void PrepareRenderPass();
 	void PreparePipeline();
 	void SetupDescriptorSetLayout();
-	void SetupDescriptorPool();
 
 	void UpdateUniformBuffers(uint32_t windowWidth, uint32_t windowHeight, float zoom);
 	void PrepareUniformBuffers();
@@ -54,13 +53,12 @@ public:
 	//Add Text
 	void AddText(float x, float y, float ws, float hs, const std::string& text);
 private:
-	VkPipelineShaderStageCreateInfo VkFont::LoadShader(const std::string& fileName, VkShaderStageFlagBits stage);
+	VkPipelineShaderStageCreateInfo LoadShader(const std::string& fileName, VkShaderStageFlagBits stage);
 
 public:
 	VkDevice					device;
 	VkPipelineLayout			pipelineLayout;
 	VkDescriptorSetLayout		descriptorSetLayout;
-	VkDescriptorPool			descriptorPool;
 	VkRenderPass				renderPass;
 	VkPipelineCache				pipelineCache;
 	VkPipeline					pipeline;
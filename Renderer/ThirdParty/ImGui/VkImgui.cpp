@@ -3,16 +3,16 @@
 *	GitHub repository - https://github.com/TywyllSoftware/TywRenderer
 *	This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
 */
-#include <RendererPch\stdafx.h>
+#include <RendererPch/stdafx.h>
 
-#include "Geometry\VertData.h"
-#include "Geometry\JointTransform.h"
+#include "Geometry/VertData.h"
+#include "Geometry/JointTransform.h"
 
 //Renderer Includes
-#include "Vulkan\VulkanTools.h"
-#include "Vulkan\VkBufferObject.h"
-#include "Vulkan\VulkanTextureLoader.h"
-#include "Vulkan\VkTexture2D.h"
+#include "Vulkan/VulkanTools.h"
+#include "Vulkan/VkBufferObject.h"
+#include "Vulkan/VulkanTextureLoader.h"
+#include "Vulkan/VkTexture2D.h"
 
 //Main Renderer
 #include "VKRenderer.h"
@@ -22,7 +22,7 @@
 
 
 //math
-#include <External\glm\glm\gtc\matrix_inverse.hpp>
+#include <External/glm/glm/gtc/matrix_inverse.hpp>
 
 #define IMGUI_VK_QUEUED_FRAMES 2
 
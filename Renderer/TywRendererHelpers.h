@@ -4,7 +4,7 @@
 *	This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
 */
 #pragma once
-#include <RendererPch\macro.h>
+#include <RendererPch/macro.h>
 
 #include <cstdarg> //http://www.cplusplus.com/reference/cstdarg/va_start/
 #include <cstdint> //http://en.cppreference.com/w/cpp/header/cstdint
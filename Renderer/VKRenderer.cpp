@@ -3,22 +3,37 @@
 *	GitHub repository - https://github.com/TywyllSoftware/TywRenderer
 *	This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
 */
-#include <RendererPch\stdafx.h>
+#include <RendererPch/stdafx.h>
 
 //Renderer Includes
 #include "VKRenderer.h"
+#include "VertexCache.h"
 
 //Vulkan Includes
-#include "Vulkan\VulkanTextureLoader.h"
+#include "Vulkan/VulkanTextureLoader.h"
+#include "Vulkan/VulkanUploadManager.h"
+#include "Vulkan/VulkanFrameManager.h"
+#include "Vulkan/VulkanShaderRegistry.h"
+#include "Vulkan/VulkanCommandRecorder.h"
+#include "Vulkan/VulkanGpuProfiler.h"
+
+//Profiler Includes
+#include "Profiler/CpuProfiler.h"
+
+//JobSystem Includes
+#include "JobSystem/JobSystem.h"
+
+//Benchmark Includes
+#include "Benchmark/BenchmarkRunner.h"
 
 //MeshLoader Includes
-#include "MeshLoader\ImageManager.h"
+#include "MeshLoader/ImageManager.h"
 
 
 //Font Incldues
-#include "Geometry\VertData.h"
-#include "Vulkan\VkBufferObject.h"
-#include "ThirdParty\FreeType\VkFont.h"
+#include "Geometry/VertData.h"
+#include "Vulkan/VkBufferObject.h"
+#include "ThirdParty/FreeType/VkFont.h"
 
 
 #define VERTEX_BUFFER_BIND_ID 0
@@ -32,8 +47,9 @@
 #define USE_STAGING true
 
 
-VKRenderer::VKRenderer(): m_pWRenderer(nullptr), m_bIsOpenglRunning(false)
+VKRenderer::VKRenderer(): m_pWRenderer(nullptr), m_bIsOpenglRunning(false), m_pShaderRegistry(nullptr), m_pCommandRecorder(nullptr), m_pGpuProfiler(nullptr), m_pBenchmark(nullptr), m_HeadlessFrames(0), m_HeadlessFramesDone(0)
 {
+	memset(&m_PipelineBuildStats, 0, sizeof(m_PipelineBuildStats));
 #ifdef _DEBUG
 	m_bLogRenderer = true;
 #endif
@@ -49,7 +65,18 @@ VKRenderer::~VKRenderer()
 void VKRenderer::VShutdown()
 {
 	ImGui_ImplGlfwVulkan_Shutdown();
+	vertexCache.Shutdown();
+	SAFE_DELETE(m_pShaderRegistry);
+	SAFE_DELETE(m_pCommandRecorder);
+	SAFE_DELETE(m_pGpuProfiler);
+	SAFE_DELETE(m_pBenchmark);
 	m_pWRenderer->DestroyRendererScreen();
+
+	//Workers are joined, free ParallelFor runs inline again
+	SAFE_DELETE(jobSystem);
+
+	//Writes out a capture that is still running
+	SAFE_DELETE(cpuProfiler);
 }
 
 
@@ -62,8 +89,36 @@ bool VKRenderer::VInitRenderer(uint32_t height, uint32_t width, bool isFullscree
 	//Initialize Logging
 	VSetLogPath();
 
+	//CPU markers. TYW_CPU_TRACE=<file> captures from startup, loading included
+	cpuProfiler = TYW_NEW CpuProfiler;
+	if (const char* pTraceFile = getenv("TYW_CPU_TRACE"))
+	{
+		cpuProfiler->Start(pTraceFile, CPU_TRACE_JSON);
+	}
+
+	//Pipeline builds, command recording and scene updates run on it. TYW_JOB_THREADS=1 runs everything on the main thread
+	const char* pJobThreads = getenv("TYW_JOB_THREADS");
+	jobSystem = TYW_NEW JobSystem(pJobThreads ? static_cast<uint32_t>(std::max(0, atoi(pJobThreads))) : 0);
+
 	m_pWRenderer = TYW_NEW VulkanRendererInitializer;
 
+	//Unattended runs without window, e.g. TYW_HEADLESS=1000 on a software driver
+	if (const char* pHeadlessFrames = getenv("TYW_HEADLESS"))
+	{
+		m_HeadlessFrames = static_cast<uint32_t>(std::max(0, atoi(pHeadlessFrames)));
+		m_pWRenderer->m_bHeadless = m_HeadlessFrames > 0;
+	}
+
+	//Deterministic runs along a recorded camera path, see BenchmarkRunner for the file format
+	if (const char* pBenchmarkFile = getenv("TYW_BENCHMARK"))
+	{
+		m_pBenchmark = TYW_NEW BenchmarkRunner;
+		if (!m_pBenchmark->Load(pBenchmarkFile))
+		{
+			SAFE_DELETE(m_pBenchmark);
+		}
+	}
+
 	//Create Screen
 	if (!m_pWRenderer->CreateRendererScreen(height, width, isFullscreen, MainWindowProc))
 	{
@@ -76,6 +131,19 @@ bool VKRenderer::VInitRenderer(uint32_t height, uint32_t width, bool isFullscree
 	m_pTextureLoader = TYW_NEW VkTools::VulkanTextureLoader(m_pWRenderer->m_SwapChain.physicalDevice, m_pWRenderer->m_SwapChain.device, m_pWRenderer->m_Queue, m_pWRenderer->m_CmdPool);
 	globalImage = TYW_NEW ImageManager(m_pWRenderer->m_SwapChain.physicalDevice, m_pWRenderer->m_SwapChain.device, m_pWRenderer->m_Queue, m_pWRenderer->m_CmdPool);
 
+	//Static and per frame geometry buffers
+	vertexCache.Init(m_pWRenderer);
+
+	//Shader modules shared by all pipelines
+	m_pShaderRegistry = TYW_NEW VulkanShaderRegistry(m_pWRenderer->m_SwapChain.device);
+
+	//Per thread command pools for multithreaded recording
+	m_pCommandRecorder = TYW_NEW VulkanCommandRecorder(m_pWRenderer->m_SwapChain.device, m_pWRenderer->m_graphicsQueueIndex);
+
+	//GPU scopes, pipeline statistics only if the device has them enabled
+	m_pGpuProfiler = TYW_NEW VulkanGpuProfiler(m_pWRenderer->m_SwapChain.device, m_pWRenderer->m_QueueFamilyProperties[m_pWRenderer->m_graphicsQueueIndex].timestampValidBits,
+		m_pWRenderer->m_DeviceProperties.limits.timestampPeriod, m_pWRenderer->m_DeviceFeatures.pipelineStatisticsQuery == VK_TRUE);
+
 	//Load all needed assets. Overrided
 	//Models, textures and so on
 	LoadAssets();
@@ -116,7 +184,29 @@ bool VKRenderer::VInitRenderer(uint32_t height, uint32_t width, bool isFullscree
 	//pipeline changes much faster than having to set dozens of 
 	//states
 	//Each GLSL shader pass will have pipeline
+	//Compile time shows how much the pipeline cache loaded from disk saved
+	auto pipelineStart = std::chrono::high_resolution_clock::now();
 	PreparePipeline();
+	uint64_t pipelineMicroSec = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - pipelineStart).count();
+	m_pWRenderer->m_PipelineCacheFile.SetPipelineCreateTime(pipelineMicroSec);
+
+	VulkanPipelineCacheStats cacheStats = m_pWRenderer->m_PipelineCacheFile.GetStats();
+	printf("Pipeline cache: %s (%s), %llu bytes loaded, pipelines created in %.2f ms \r\n",
+		cacheStats.bWarm ? "warm" : "cold", cacheStats.bWarm ? "hit" : cacheStats.missReason,
+		static_cast<unsigned long long>(cacheStats.loadedBytes), pipelineMicroSec / 1000.0);
+
+	VulkanShaderRegistryStats shaderStats = m_pShaderRegistry->GetStats();
+	printf("Shaders: %u modules for %u loads (%u same path, %u same SPIR-V), %llu bytes mapped in %.2f ms \r\n",
+		shaderStats.numModules, shaderStats.numRequests, shaderStats.numPathHits, shaderStats.numContentHits,
+		static_cast<unsigned long long>(shaderStats.bytesMapped), shaderStats.createMicroSec / 1000.0);
+
+	if (m_PipelineBuildStats.numPipelines > 0)
+	{
+		const uint64_t savedMicroSec = m_PipelineBuildStats.serialMicroSec > m_PipelineBuildStats.wallMicroSec ? m_PipelineBuildStats.serialMicroSec - m_PipelineBuildStats.wallMicroSec : 0;
+		printf("Pipelines: %u built on %u threads in %.2f ms, %.2f ms serial, %.2f ms saved \r\n",
+			m_PipelineBuildStats.numPipelines, m_PipelineBuildStats.numThreads, m_PipelineBuildStats.wallMicroSec / 1000.0,
+			m_PipelineBuildStats.serialMicroSec / 1000.0, savedMicroSec / 1000.0);
+	}
 	
 	//Create RenderPass
 	//Build Commands for Rendering
@@ -128,6 +218,10 @@ bool VKRenderer::VInitRenderer(uint32_t height, uint32_t width, bool isFullscree
 	//Load GUI
 	LoadGUI();
 
+	//Everything loaded above only queued its copies. Submit them as one batch,
+	//first frame submit is ordered after it on the graphics queue
+	uploadManager->Flush();
+
 	m_bIsOpenglRunning = true;
 	return true;
 }
@@ -150,7 +244,62 @@ void VKRenderer::StartFrame()
 
 void VKRenderer::EndFrame(uint64_t* gpuMicroSec)
 {
-	VK_CHECK_RESULT(vkQueueWaitIdle(m_pWRenderer->m_Queue));
+	TYW_PROFILE_FUNCTION();
+
+	//Fences the frame instead of draining the queue. Blocks only when the CPU is
+	//VULKAN_FRAMES_IN_FLIGHT frames ahead, vertex cache then finds its oldest set free as well
+	frameManager->EndFrame(m_pWRenderer->m_Queue);
+	vertexCache.EndFrame(m_pWRenderer->m_Queue);
+
+	if (gpuMicroSec != nullptr)
+	{
+		VulkanFrameStats frameStats = frameManager->GetStats();
+		*gpuMicroSec = frameStats.bGpuTimeValid ? frameStats.gpuMicroSec : 0;
+		TYW_PROFILE_COUNTER("GPU frame us", *gpuMicroSec);
+	}
+
+	//Scopes of frames the GPU finished since the last call
+	m_pGpuProfiler->Update();
+
+	if (m_pBenchmark && !m_pBenchmark->IsFinished())
+	{
+		m_pBenchmark->EndFrame(frameManager->GetStats(), m_pGpuProfiler->GetResults(), memoryAllocator->GetStats());
+		if (m_pBenchmark->IsFinished())
+		{
+			const char* pReportFile = getenv("TYW_BENCHMARK_REPORT");
+			m_pBenchmark->WriteReport(pReportFile ? pReportFile : "benchmark.json", m_pWRenderer->m_DeviceProperties, m_WindowWidth, m_WindowHeight);
+		}
+	}
+
+	//Uploads queued during the frame, and staging memory of finished batches back to the ring
+	uploadManager->Flush();
+	uploadManager->Update();
+
+	if (IsHeadless())
+	{
+		m_HeadlessFramesDone++;
+	}
+
+	TYW_PROFILE_FRAME();
+}
+
+
+bool VKRenderer::UpdateBenchmark(Camera* pCamera)
+{
+	if (!m_pBenchmark)
+	{
+		return false;
+	}
+
+	//Animations advance by the same amount every frame, however long the frame took
+	frameTimer = m_pBenchmark->GetTimeStep();
+	return m_pBenchmark->BeginFrame(pCamera);
+}
+
+
+bool VKRenderer::IsBenchmarkFinished() const
+{
+	return m_pBenchmark && m_pBenchmark->IsFinished();
 }
 
 
@@ -253,15 +402,24 @@ VkPipelineShaderStageCreateInfo VKRenderer::LoadShader(std::string fileName, VkS
 #if defined(__ANDROID__)
 	shaderStage.module = vkTools::loadShader(androidApp->activity->assetManager, fileName.c_str(), device, stage);
 #else
-	shaderStage.module = VkTools::LoadShader(fileName.c_str(), m_pWRenderer->m_SwapChain.device, stage);
+	shaderStage.module = m_pShaderRegistry->Load(fileName);
 #endif
 	shaderStage.pName = "main"; // todo : make param
 	assert(shaderStage.module != NULL);
-	m_ShaderModules.push_back(shaderStage.module);
 	return shaderStage;
 }
 
 
+void VKRenderer::BuildPipelines(VulkanPipelineBuilder& builder)
+{
+	VulkanPipelineBuildStats stats = builder.Build();
+	m_PipelineBuildStats.numPipelines += stats.numPipelines;
+	m_PipelineBuildStats.numThreads = stats.numThreads;
+	m_PipelineBuildStats.wallMicroSec += stats.wallMicroSec;
+	m_PipelineBuildStats.serialMicroSec += stats.serialMicroSec;
+}
+
+
 void VKRenderer::SetupDescriptorSetLayout()
 {
 	//overriden
@@ -364,6 +522,8 @@ void VKRenderer::VWindowResize(uint32_t iHeight, uint32_t iWidth)
 	m_WindowHeight = iHeight;
 	m_WindowWidth = iWidth;
 
+	//Swapchain images are recreated, nothing in flight may still use them
+	frameManager->WaitIdle();
 	m_pWRenderer->WindowResize(iWidth, iHeight);
 
 	BuildCommandBuffers();
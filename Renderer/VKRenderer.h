@@ -17,9 +17,14 @@ struct glconfig_st;
 struct gl_params;
 class  ImageManager;
 class VkFont;
+class VulkanShaderRegistry;
+class VulkanCommandRecorder;
+class VulkanGpuProfiler;
+class BenchmarkRunner;
+class Camera;
 
 
-#include <External\vulkan\vulkan.h>
+#include <External/vulkan/vulkan.h>
 #include "IRenderer.h"
 
 
@@ -80,6 +85,7 @@ struct gl_params
 #pragma pack(pop)
 
 #include "VulkanRendererInitializer.h"
+#include "Vulkan/VulkanPipelineBuilder.h"
 
 class  VKRenderer: public IRenderer
 {
@@ -143,6 +149,30 @@ public:
 
 	virtual void StartFrame();
 	virtual void EndFrame(uint64_t* gpuMicroSec);
+
+	/*
+		Headless runs are started with TYW_HEADLESS=<frames>. There is no window,
+		frames go to offscreen images and the run ends after that many frames
+
+		@return: bool
+	*/
+	bool IsHeadless() const { return m_HeadlessFrames > 0; }
+
+	//True once a headless run rendered all of its frames
+	bool IsHeadlessFinished() const { return m_HeadlessFramesDone >= m_HeadlessFrames; }
+
+	/*
+		Benchmark runs are started with TYW_BENCHMARK=<benchmark file>. Replaces frameTimer
+		with the fixed time step and moves the camera along the recorded path.
+		Call at the start of the frame, before uniform buffers are updated
+
+		@param: Camera* pCamera - nullptr for samples without a camera
+		@return: bool - true if the camera was moved
+	*/
+	bool UpdateBenchmark(Camera* pCamera);
+
+	//True once the camera path is done and the report written
+	bool IsBenchmarkFinished() const;
 public:
 	//Log Renderer
 	void   Logv(const char* format, ...);
@@ -177,6 +207,14 @@ public:
 	*/
 	VkPipelineShaderStageCreateInfo LoadShader(std::string fileName, VkShaderStageFlagBits stage);
 
+	/*
+		Creates all pipelines added to builder on the job system
+		and adds build timings to m_PipelineBuildStats
+
+		@param: VulkanPipelineBuilder& builder
+	*/
+	void BuildPipelines(VulkanPipelineBuilder& builder);
+
 	//overridable
 	virtual void LoadAssets();
 
@@ -243,8 +281,24 @@ protected:
 	ImageManager						*m_pImageManager;
 
 protected:
-	// List of shader modules created (stored for cleanup)
-	std::vector<VkShaderModule> m_ShaderModules;
+	// Owns all shader modules, every file is loaded once
+	VulkanShaderRegistry				*m_pShaderRegistry;
+
+	// Records draws into secondary command buffers on the job system
+	VulkanCommandRecorder				*m_pCommandRecorder;
+
+	// Named GPU timestamp scopes, resolved in EndFrame
+	VulkanGpuProfiler					*m_pGpuProfiler;
+
+	// Timings of all BuildPipelines calls
+	VulkanPipelineBuildStats			m_PipelineBuildStats;
+
+	// Camera path replay and report, nullptr unless benchmarking
+	BenchmarkRunner						*m_pBenchmark;
+
+	// Frames to render without a window, 0 for a windowed run
+	uint32_t							m_HeadlessFrames;
+	uint32_t							m_HeadlessFramesDone;
 
 	VkClearColorValue defaultClearColor = { { 0.5f, 0.5f, 0.5f, 1.0f } };
 
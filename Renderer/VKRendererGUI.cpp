@@ -3,11 +3,11 @@
 *	GitHub repository - https://github.com/TywyllSoftware/TywRenderer
 *	This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
 */
-#include <RendererPch\stdafx.h>
+#include <RendererPch/stdafx.h>
 
 //Renderer Includes
 #include "VKRenderer.h"
-#include "ThirdParty\ImGui\imgui.h"
+#include "ThirdParty/ImGui/imgui.h"
 
 
 
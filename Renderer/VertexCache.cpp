@@ -3,11 +3,16 @@
 *	GitHub repository - https://github.com/TywyllSoftware/TywRenderer
 *	This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
 */
-#include <RendererPch\stdafx.h>
+#include <RendererPch/stdafx.h>
 
 
 //Renderer Includes
 #include "VertexCache.h"
+#include "VulkanRendererInitializer.h"
+
+//Vulkan Includes
+#include "Vulkan/VulkanTools.h"
+#include "Vulkan/VulkanUploadManager.h"
 
 
 VertexCache vertexCache;
@@ -18,7 +23,38 @@ ClearGeoBufferSet
 ==============
 */
 static void ClearGeoBufferSet(geoBufferSet_t &gbs) {
-	gbs.allocations = 0;
+	gbs.indexMemUsed.store(0, std::memory_order_relaxed);
+	gbs.vertexMemUsed.store(0, std::memory_order_relaxed);
+	gbs.uniformMemUsed.store(0, std::memory_order_relaxed);
+	gbs.allocations.store(0, std::memory_order_relaxed);
+	gbs.failedAllocations.store(0, std::memory_order_relaxed);
+}
+
+
+VertexCache::VertexCache():
+	currentFrame(0),
+	listNum(0),
+	drawListNum(0),
+	m_pRendInit(nullptr),
+	m_UniformAlignment(VERTCACHE_ALIGNMENT)
+{
+	geoBufferSet_t* sets[VERTCACHE_NUM_FRAMES + 1] = { &staticData };
+	for (int i = 0; i < VERTCACHE_NUM_FRAMES; i++)
+	{
+		sets[i + 1] = &frameData[i];
+	}
+
+	for (geoBufferSet_t* gbs : sets)
+	{
+		gbs->pMappedIndex = nullptr;
+		gbs->pMappedVertex = nullptr;
+		gbs->indexMemSize = 0;
+		gbs->vertexMemSize = 0;
+		gbs->uniformMemSize = 0;
+		gbs->uniformBase = 0;
+		gbs->fence = VK_NULL_HANDLE;
+		ClearGeoBufferSet(*gbs);
+	}
 }
 
 /*
@@ -26,24 +62,75 @@ static void ClearGeoBufferSet(geoBufferSet_t &gbs) {
 AllocGeoBufferSet
 ==============
 */
-static void AllocGeoBufferSet(geoBufferSet_t &gbs, const size_t vertexBytes,const size_t indexByes) {
-	//gbs.vertexBuffer.AllocateBufferObject(nullptr, vertexBytes, 0);
-    //gbs.indexBuffer.AllocateBufferObject(nullptr, indexByes, 1);
+void VertexCache::AllocGeoBufferSet(geoBufferSet_t &gbs, const size_t vertexBytes, const size_t indexBytes, VkMemoryPropertyFlags properties) {
+	VkBufferUsageFlags transferUsage = (properties & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT) ? VK_BUFFER_USAGE_TRANSFER_DST_BIT : 0;
+
+	VK_CHECK_RESULT(VkBufferObject::CreateBuffer(m_pRendInit->m_SwapChain, m_pRendInit->m_DeviceMemoryProperties,
+		VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | transferUsage, properties, vertexBytes, gbs.vertexBuffer));
+	VK_CHECK_RESULT(VkBufferObject::CreateBuffer(m_pRendInit->m_SwapChain, m_pRendInit->m_DeviceMemoryProperties,
+		VK_BUFFER_USAGE_INDEX_BUFFER_BIT | transferUsage, properties, indexBytes, gbs.indexBuffer));
+
+	gbs.pMappedVertex = static_cast<uint8_t*>(gbs.vertexBuffer.allocation.pMapped);
+	gbs.pMappedIndex = static_cast<uint8_t*>(gbs.indexBuffer.allocation.pMapped);
+	gbs.vertexMemSize = static_cast<int32_t>(vertexBytes);
+	gbs.indexMemSize = static_cast<int32_t>(indexBytes);
+	ClearGeoBufferSet(gbs);
+}
+
+/*
+==============
+FreeGeoBufferSet
+==============
+*/
+void VertexCache::FreeGeoBufferSet(geoBufferSet_t &gbs) {
+	VkBufferObject::DeleteBufferMemory(m_pRendInit->m_SwapChain.device, gbs.vertexBuffer, nullptr);
+	VkBufferObject::DeleteBufferMemory(m_pRendInit->m_SwapChain.device, gbs.indexBuffer, nullptr);
+
+	if (gbs.fence != VK_NULL_HANDLE)
+	{
+		vkDestroyFence(m_pRendInit->m_SwapChain.device, gbs.fence, nullptr);
+		gbs.fence = VK_NULL_HANDLE;
+	}
+
+	gbs.pMappedVertex = nullptr;
+	gbs.pMappedIndex = nullptr;
+	gbs.vertexMemSize = 0;
+	gbs.indexMemSize = 0;
+	ClearGeoBufferSet(gbs);
 }
 
 
 
-void VertexCache::Init() 
+void VertexCache::Init(VulkanRendererInitializer* pRendInit)
 {
+	assert(pRendInit);
+	m_pRendInit = pRendInit;
+
 	currentFrame = 0;
 	drawListNum = 0;
 	listNum = 0;
 
-	for (int i = 0; i < VERTCACHE_NUM_FRAMES; i++) 
+	//Frame sets are created signaled, the first wait on each of them returns at once
+	VkFenceCreateInfo fenceCreateInfo = VkTools::Initializer::FenceCreateInfo(VK_FENCE_CREATE_SIGNALED_BIT);
+	for (int i = 0; i < VERTCACHE_NUM_FRAMES; i++)
 	{
-		AllocGeoBufferSet(frameData[i], VERTCACHE_VERTEX_MEMORY_PER_FRAME, VERTCACHE_INDEX_MEMORY_PER_FRAME);
+		AllocGeoBufferSet(frameData[i], VERTCACHE_VERTEX_MEMORY_PER_FRAME, VERTCACHE_INDEX_MEMORY_PER_FRAME, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+		VK_CHECK_RESULT(vkCreateFence(m_pRendInit->m_SwapChain.device, &fenceCreateInfo, nullptr, &frameData[i].fence));
 	}
-	AllocGeoBufferSet(staticData, STATIC_VERTEX_MEMORY, STATIC_INDEX_MEMORY);
+	AllocGeoBufferSet(staticData, STATIC_VERTEX_MEMORY, STATIC_INDEX_MEMORY, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+	//One uniform buffer for all frame sets, so descriptors written once stay valid for every frame
+	m_UniformAlignment = std::max(static_cast<uint32_t>(VERTCACHE_ALIGNMENT), static_cast<uint32_t>(m_pRendInit->m_DeviceProperties.limits.minUniformBufferOffsetAlignment));
+	VK_CHECK_RESULT(VkBufferObject::CreateBuffer(m_pRendInit->m_SwapChain, m_pRendInit->m_DeviceMemoryProperties,
+		VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+		VERTCACHE_UNIFORM_MEMORY_PER_FRAME * VERTCACHE_NUM_FRAMES, uniformBuffer));
+	for (int i = 0; i < VERTCACHE_NUM_FRAMES; i++)
+	{
+		frameData[i].uniformBase = static_cast<VkDeviceSize>(i) * VERTCACHE_UNIFORM_MEMORY_PER_FRAME;
+		frameData[i].uniformMemSize = VERTCACHE_UNIFORM_MEMORY_PER_FRAME;
+	}
+
+	VK_CHECK_RESULT(vkResetFences(m_pRendInit->m_SwapChain.device, 1, &frameData[listNum].fence));
 }
 
 /*
@@ -51,26 +138,169 @@ void VertexCache::Init()
 ActuallyAlloc
 ==============
 */
-void VertexCache::ActuallyAlloc(geoBufferSet_t & vcs, const void * data, size_t bytes, cacheType_t type) {
+vertCacheHandle_t VertexCache::ActuallyAlloc(geoBufferSet_t & vcs, const void * data, size_t bytes, cacheType_t type) {
+	vertCacheHandle_t handle;
+	if (bytes == 0) {
+		return handle;
+	}
+
+	//uniform offsets must be multiples of minUniformBufferOffsetAlignment, which is a power of two
+	const size_t alignment = (type == cacheType_t::CACHE_UNIFORM) ? m_UniformAlignment : VERTCACHE_ALIGNMENT;
+	const int32_t alignedBytes = static_cast<int32_t>((bytes + alignment - 1) & ~(alignment - 1));
+
+	VkBufferObject_s* pBuffer = nullptr;
+	uint8_t* pMapped = nullptr;
+	int32_t endPos = 0;
+	int32_t memSize = 0;
+	VkDeviceSize base = 0;
+
+	//Bump allocation. Safe to call from any thread
+	if (type == cacheType_t::CACHE_VERTEX) {
+		endPos = vcs.vertexMemUsed.fetch_add(alignedBytes, std::memory_order_relaxed) + alignedBytes;
+		memSize = vcs.vertexMemSize;
+		pBuffer = &vcs.vertexBuffer;
+		pMapped = vcs.pMappedVertex;
+	}
+	else if (type == cacheType_t::CACHE_INDEX) {
+		endPos = vcs.indexMemUsed.fetch_add(alignedBytes, std::memory_order_relaxed) + alignedBytes;
+		memSize = vcs.indexMemSize;
+		pBuffer = &vcs.indexBuffer;
+		pMapped = vcs.pMappedIndex;
+	}
+	else if (type == cacheType_t::CACHE_UNIFORM) {
+		endPos = vcs.uniformMemUsed.fetch_add(alignedBytes, std::memory_order_relaxed) + alignedBytes;
+		memSize = vcs.uniformMemSize;
+		pBuffer = &uniformBuffer;
+		//offsets are relative to the whole buffer, the set owns [uniformBase, uniformBase + uniformMemSize)
+		pMapped = static_cast<uint8_t*>(uniformBuffer.allocation.pMapped);
+		base = vcs.uniformBase;
+	}
+
+	//Reported once per frame in EndFrame, allocation paths stay free of io
+	if (endPos > memSize) {
+		vcs.failedAllocations.fetch_add(1, std::memory_order_relaxed);
+		return handle;
+	}
+
+	handle.buffer = pBuffer->buffer;
+	handle.offset = base + static_cast<VkDeviceSize>(endPos - alignedBytes);
+	handle.size = static_cast<uint32_t>(bytes);
+	handle.frameNum = static_cast<uint32_t>(currentFrame);
+	handle.bStatic = (&vcs == &staticData);
+
 	//data transfer to GPU
 	if (data != nullptr) {
-		if (type == cacheType_t::CACHE_VERTEX) {
-		//	vcs.vertexBuffer.AllocateBufferObject(data, bytes, 0);
+		if (pMapped != nullptr) {
+			memcpy(pMapped + handle.offset, data, bytes);
 		}
-		else if (type == cacheType_t::CACHE_INDEX) {
-			//vcs.vertexBuffer.AllocateBufferObject(data, bytes, 1);
+		else {
+			UploadStatic(handle.buffer, handle.offset, data, bytes);
 		}
-		vcs.allocations++;
 	}
-	else {
-		if (type == cacheType_t::CACHE_VERTEX) {
-			//vcs.vertexBuffer.AllocateBufferObject(data, bytes, 0);
-		}
-		else if (type == cacheType_t::CACHE_INDEX) {
-			//vcs.vertexBuffer.AllocateBufferObject(data, bytes, 1);
-		}
-		//vcs.vertexBuffer.AllocateBufferObject(data, bytes, 0);
+	vcs.allocations.fetch_add(1, std::memory_order_relaxed);
+	return handle;
+}
+
+/*
+==============
+UploadStatic
+==============
+*/
+void VertexCache::UploadStatic(VkBuffer dstBuffer, VkDeviceSize offset, const void * data, size_t bytes) {
+	//Batched with all other loading time uploads, lands on gpu with next uploadManager->Flush()
+	VK_CHECK_RESULT(uploadManager->UploadBuffer(dstBuffer, offset, data, bytes));
+}
+
+
+vertCacheHandle_t VertexCache::AllocStaticVertex(const void * data, int bytes)
+{
+	return ActuallyAlloc(staticData, data, bytes, cacheType_t::CACHE_VERTEX);
+}
+
+
+vertCacheHandle_t VertexCache::AllocStaticIndex(const void * data, int bytes)
+{
+	return ActuallyAlloc(staticData, data, bytes, cacheType_t::CACHE_INDEX);
+}
+
+
+vertCacheHandle_t VertexCache::AllocVertex(const void * data, int bytes)
+{
+	return ActuallyAlloc(frameData[listNum], data, bytes, cacheType_t::CACHE_VERTEX);
+}
+
+
+vertCacheHandle_t VertexCache::AllocIndex(const void * data, int bytes)
+{
+	return ActuallyAlloc(frameData[listNum], data, bytes, cacheType_t::CACHE_INDEX);
+}
+
+
+vertCacheHandle_t VertexCache::AllocUniform(const void * data, int bytes)
+{
+	return ActuallyAlloc(frameData[listNum], data, bytes, cacheType_t::CACHE_UNIFORM);
+}
+
+
+VkDescriptorBufferInfo VertexCache::UniformDescriptor(VkDeviceSize range) const
+{
+	VkDescriptorBufferInfo descriptor = {};
+	descriptor.buffer = uniformBuffer.buffer;
+	descriptor.offset = 0;
+	descriptor.range = range;
+	return descriptor;
+}
+
+
+void* VertexCache::MappedPointer(const vertCacheHandle_t& handle) const
+{
+	if (!handle.IsValid() || handle.bStatic)
+		return nullptr;
+
+	assert(CacheIsCurrent(handle));
+	const geoBufferSet_t& gbs = frameData[listNum];
+	if (handle.buffer == uniformBuffer.buffer)
+		return static_cast<uint8_t*>(uniformBuffer.allocation.pMapped) + handle.offset;
+
+	uint8_t* pMapped = (handle.buffer == gbs.vertexBuffer.buffer) ? gbs.pMappedVertex : gbs.pMappedIndex;
+	return pMapped + handle.offset;
+}
+
+
+bool VertexCache::CacheIsCurrent(const vertCacheHandle_t& handle) const
+{
+	return handle.bStatic || handle.frameNum == static_cast<uint32_t>(currentFrame);
+}
+
+
+void VertexCache::FreeStaticData()
+{
+	//Any frame in flight may still read static data, and queued uploads may still write it
+	uploadManager->WaitIdle();
+	VK_CHECK_RESULT(vkDeviceWaitIdle(m_pRendInit->m_SwapChain.device));
+	ClearGeoBufferSet(staticData);
+}
+
+
+void VertexCache::EndFrame(VkQueue queue)
+{
+	//Empty submit, fence signals once all work submitted before it has finished
+	VK_CHECK_RESULT(vkQueueSubmit(queue, 0, nullptr, frameData[listNum].fence));
+
+	const int numFailed = frameData[listNum].failedAllocations.load(std::memory_order_relaxed);
+	if (numFailed > 0) {
+		fprintf(stdout, "VertexCache: frame %d ran out of frame memory, %d allocations failed\n", currentFrame, numFailed);
 	}
+
+	drawListNum = listNum;
+	currentFrame++;
+	listNum = currentFrame % VERTCACHE_NUM_FRAMES;
+
+	//Gpu may still read set from VERTCACHE_NUM_FRAMES frames ago
+	geoBufferSet_t& gbs = frameData[listNum];
+	VK_CHECK_RESULT(vkWaitForFences(m_pRendInit->m_SwapChain.device, 1, &gbs.fence, VK_TRUE, UINT64_MAX));
+	VK_CHECK_RESULT(vkResetFences(m_pRendInit->m_SwapChain.device, 1, &gbs.fence));
+	ClearGeoBufferSet(gbs);
 }
 
 /*
@@ -79,6 +309,20 @@ Shutdown
 ====================
 */
 void VertexCache::Shutdown() {
-	//This is not finished
-	//staticData.vertexBuffer.FreeBufferObject();
-}
\ No newline at end of file
+	if (m_pRendInit == nullptr)
+		return;
+
+	VK_CHECK_RESULT(vkDeviceWaitIdle(m_pRendInit->m_SwapChain.device));
+
+	for (int i = 0; i < VERTCACHE_NUM_FRAMES; i++)
+	{
+		FreeGeoBufferSet(frameData[i]);
+	}
+	FreeGeoBufferSet(staticData);
+	VkBufferObject::DeleteBufferMemory(m_pRendInit->m_SwapChain.device, uniformBuffer, nullptr);
+	for (int i = 0; i < VERTCACHE_NUM_FRAMES; i++)
+	{
+		frameData[i].uniformMemSize = 0;
+	}
+	m_pRendInit = nullptr;
+}
@@ -5,57 +5,159 @@
 */
 #ifndef _VERTEX_CACHE_H_
 #define _VERTEX_CACHE_H_
+#include "Vulkan/VkBufferObject.h"
 
 //forward declared
-class IndexBuffer;
-class VertexBuffer;
+class VulkanRendererInitializer;
 
 
 const int VERTCACHE_INDEX_MEMORY_PER_FRAME = 31 * 1024 * 1024;
 const int VERTCACHE_VERTEX_MEMORY_PER_FRAME = 31 * 1024 * 1024;
 
+const int VERTCACHE_UNIFORM_MEMORY_PER_FRAME = 2 * 1024 * 1024;
+
 const int STATIC_INDEX_MEMORY = 31 * 1024 * 1024;
 const int STATIC_VERTEX_MEMORY = 31 * 1024 * 1024;
 
 const int VERTCACHE_NUM_FRAMES = 2;
 
+//every allocation starts on this boundary, enough for any vertex attribute and 32 bit indices
+const int VERTCACHE_ALIGNMENT = 16;
+
 
 enum class cacheType_t {
 	CACHE_VERTEX,
-	CACHE_INDEX
+	CACHE_INDEX,
+	CACHE_UNIFORM
 };
 
 
-struct  geoBufferSet_t
+/*
+	Location of cached data. buffer and offset can be passed straight to
+	vkCmdBindVertexBuffers or vkCmdBindIndexBuffer. For uniform data offset
+	is the dynamic offset to pass to vkCmdBindDescriptorSets.
+	Frame handles are valid only until the next EndFrame
+*/
+struct vertCacheHandle_t
 {
+	vertCacheHandle_t(): buffer(VK_NULL_HANDLE), offset(0), size(0), frameNum(0), bStatic(false) {}
+	bool IsValid() const { return buffer != VK_NULL_HANDLE; }
+
+	VkBuffer		buffer;
+	VkDeviceSize	offset;
+	uint32_t		size;
+	uint32_t		frameNum;	// VertexCache::currentFrame at allocation time
+	bool			bStatic;
+};
+
 
-//	IndexBuffer	 indexBuffer;
-//	VertexBuffer vertexBuffer;
-	int32_t		 indexMemUsed;
-	int32_t		 vertexMemUsed;
-	int			 allocations; //number of vertexBuffers
+struct  geoBufferSet_t
+{
+	VkBufferObject_s		indexBuffer;
+	VkBufferObject_s		vertexBuffer;
+	uint8_t*				pMappedIndex;	// nullptr for static set, it lives in device local memory
+	uint8_t*				pMappedVertex;
+	std::atomic<int32_t>	indexMemUsed;
+	std::atomic<int32_t>	vertexMemUsed;
+	std::atomic<int32_t>	uniformMemUsed;
+	std::atomic<int>		allocations; //number of sub allocations
+	std::atomic<int>		failedAllocations; //sub allocations that did not fit, handle is left invalid
+	int32_t					indexMemSize;
+	int32_t					vertexMemSize;
+	int32_t					uniformMemSize;
+	VkDeviceSize			uniformBase;	// start of the set region in VertexCache::uniformBuffer
+	VkFence					fence;			// frame sets only. Signaled when gpu is done with the set
 };
 
 
+/*
+	VertexCache
+	One device local static set for level geometry and VERTCACHE_NUM_FRAMES
+	host visible sets for data that changes every frame (skinned meshes, text, debug lines).
+	Frame sets stay mapped, allocations are a bump of an atomic offset so any thread can allocate.
+	A frame set is reused only after the fence submitted at its EndFrame has signaled.
+
+	Per frame uniform data (per pass and per object constants) lives in one mapped buffer
+	split into a region per frame set. Descriptors point at the whole buffer once, as
+	VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, and each draw selects its block with a dynamic offset.
+*/
 class  VertexCache
 {
 public:
-	void			Init();
+	VertexCache();
+
+	/*
+		@param: VulkanRendererInitializer* pRendInit
+	*/
+	void			Init(VulkanRendererInitializer* pRendInit);
 	void			Shutdown();
 
-	//data is going to be available till next map load
-	void			AllocStaticVertex(const void * data, int bytes);
+	//data is going to be available till next FreeStaticData. Copy is queued on uploadManager, Flush before drawing
+	vertCacheHandle_t	AllocStaticVertex(const void * data, int bytes);
+	vertCacheHandle_t	AllocStaticIndex(const void * data, int bytes);
+
+	//Waits for gpu and releases all static data
+	void			FreeStaticData();
+
+	//data is going to be available till next EndFrame. Pass nullptr and write through MappedPointer
+	vertCacheHandle_t	AllocVertex(const void * data, int bytes);
+	vertCacheHandle_t	AllocIndex(const void * data, int bytes);
+
+	//data is going to be available till next EndFrame. Offset is aligned to minUniformBufferOffsetAlignment
+	vertCacheHandle_t	AllocUniform(const void * data, int bytes);
+
+	/*
+		Descriptor for a VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC binding.
+		Write it once, select the block per bind with handle.offset
+
+		@param: VkDeviceSize range - size of the uniform block in the shader
+		@return: VkDescriptorBufferInfo
+	*/
+	VkDescriptorBufferInfo	UniformDescriptor(VkDeviceSize range) const;
+
+	/*
+		@param: const vertCacheHandle_t& handle
+		@return: void* - pointer to write frame data to, nullptr for static data
+	*/
+	void*			MappedPointer(const vertCacheHandle_t& handle) const;
+
+	/*
+		@param: const vertCacheHandle_t& handle
+		@return: bool - false if frame handle belongs to an already finished frame
+	*/
+	bool			CacheIsCurrent(const vertCacheHandle_t& handle) const;
+
+	/*
+		Call after the last submit of the frame. Fences the current frame set
+		and waits until the oldest frame set is free to be filled again
+
+		@param: VkQueue queue - queue that consumed frame data
+	*/
+	void			EndFrame(VkQueue queue);
 
 public:
 	int				currentFrame;	// for determining the active buffers
 	int				listNum;		// currentFrame % VERTCACHE_NUM_FRAMES
 	int				drawListNum;	// (currentFrame-1) % VERTCACHE_NUM_FRAMES
-	
+
 	geoBufferSet_t	staticData;
 	geoBufferSet_t	frameData[VERTCACHE_NUM_FRAMES];
+	VkBufferObject_s	uniformBuffer;	// VERTCACHE_NUM_FRAMES regions of VERTCACHE_UNIFORM_MEMORY_PER_FRAME
+
+	vertCacheHandle_t	ActuallyAlloc(geoBufferSet_t & vcs, const void * data, size_t bytes, cacheType_t type);
+
+private:
+	VertexCache(const VertexCache&) = delete;
+	VertexCache& operator=(const VertexCache&) = delete;
+
+	void			AllocGeoBufferSet(geoBufferSet_t &gbs, const size_t vertexBytes, const size_t indexBytes, VkMemoryPropertyFlags properties);
+	void			FreeGeoBufferSet(geoBufferSet_t &gbs);
+	void			UploadStatic(VkBuffer dstBuffer, VkDeviceSize offset, const void * data, size_t bytes);
 
-	void			ActuallyAlloc(geoBufferSet_t & vcs, const void * data, size_t bytes, cacheType_t type);
+private:
+	VulkanRendererInitializer*	m_pRendInit;
+	uint32_t					m_UniformAlignment;
 };
 
 extern	 VertexCache	vertexCache;
-#endif
\ No newline at end of file
+#endif
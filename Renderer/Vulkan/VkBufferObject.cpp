@@ -3,107 +3,76 @@
 *	GitHub repository - https://github.com/TywyllSoftware/TywRenderer
 *	This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
 */
-#include <RendererPch\stdafx.h>
+#include <RendererPch/stdafx.h>
 
 
 #include "VkBufferObject.h"
 #include "VulkanTools.h"
 #include "VulkanSwapChain.h"
-#include <Geometry\VertData.h>
+#include <Geometry/VertData.h>
 #include "VulkanRendererInitializer.h"
+#include "VulkanUploadManager.h"
 #include "VKRenderer.h"
 
 
 
 namespace VkBufferObject
 {
-	VkResult VkBufferObject::CreateBuffer(const VulkanSwapChain& pSwapChain, VkPhysicalDeviceMemoryProperties& memoryProperties, VkBufferUsageFlags usageFlags, VkMemoryPropertyFlags memoryPropertyFlags, VkDeviceSize size, VkBufferObject_s& bufferObject, void *data)
+	VkResult CreateBuffer(const VulkanSwapChain& pSwapChain, VkPhysicalDeviceMemoryProperties& memoryProperties, VkBufferUsageFlags usageFlags, VkMemoryPropertyFlags memoryPropertyFlags, VkDeviceSize size, VkBufferObject_s& bufferObject, void *data)
 	{
 		// Create the buffer handle
 		VkBufferCreateInfo bufferCreateInfo = VkTools::Initializer::BufferCreateInfo(usageFlags, size);
 		VK_CHECK_RESULT(vkCreateBuffer(pSwapChain.device, &bufferCreateInfo, nullptr, &bufferObject.buffer));
 
-		// Create the memory backing up the buffer handle
-		VkMemoryRequirements memReqs;
-		VkMemoryAllocateInfo memAlloc = VkTools::Initializer::MemoryAllocateInfo();
-		vkGetBufferMemoryRequirements(pSwapChain.device, bufferObject.buffer, &memReqs);
-		memAlloc.allocationSize = memReqs.size;
-
-		// Find a memory type index that fits the properties of the buffer
-		memAlloc.memoryTypeIndex = VkTools::GetMemoryType(memReqs.memoryTypeBits, memoryPropertyFlags, memoryProperties);
-		VK_CHECK_RESULT(vkAllocateMemory(pSwapChain.device, &memAlloc, nullptr, &bufferObject.memory));
+		// Sub-allocate the memory backing up the buffer handle and attach it
+		VkResult result = memoryAllocator->AllocateBuffer(bufferObject.buffer, memoryPropertyFlags, bufferObject.allocation);
+		if (result != VK_SUCCESS)
+		{
+			vkDestroyBuffer(pSwapChain.device, bufferObject.buffer, nullptr);
+			bufferObject.buffer = VK_NULL_HANDLE;
+			return result;
+		}
+		bufferObject.memory = VK_NULL_HANDLE;
 
-		// If a pointer to the buffer data has been passed, map the buffer and copy over the data
+		// If a pointer to the buffer data has been passed, copy it over. Host visible memory stays mapped
 		if (data != nullptr)
 		{
-			void *mapped;
-			VK_CHECK_RESULT(vkMapMemory(pSwapChain.device, bufferObject.memory, 0, size, 0, &mapped));
-			memcpy(mapped, data, size);
-			vkUnmapMemory(pSwapChain.device, bufferObject.memory);
+			assert(bufferObject.allocation.pMapped);
+			memcpy(bufferObject.allocation.pMapped, data, size);
 		}
-
-		// Attach the memory to the buffer object
-		VK_CHECK_RESULT(vkBindBufferMemory(pSwapChain.device, bufferObject.buffer, bufferObject.memory, 0));
 		return VK_SUCCESS;
 	}
 
-	VkResult VkBufferObject::CreateBuffer(const VulkanSwapChain& pSwapChain, VkPhysicalDeviceMemoryProperties& memoryProperties, VkBufferUsageFlags usageFlags, VkMemoryPropertyFlags memoryPropertyFlags, VkDeviceSize size, VkTools::UniformData& uniformData, void *data)
+	VkResult CreateBuffer(const VulkanSwapChain& pSwapChain, VkPhysicalDeviceMemoryProperties& memoryProperties, VkBufferUsageFlags usageFlags, VkMemoryPropertyFlags memoryPropertyFlags, VkDeviceSize size, VkTools::UniformData& uniformData, void *data)
 	{
 		// Create the buffer handle
 		VkBufferCreateInfo bufferCreateInfo = VkTools::Initializer::BufferCreateInfo(usageFlags, size);
 		VK_CHECK_RESULT(vkCreateBuffer(pSwapChain.device, &bufferCreateInfo, nullptr, &uniformData.buffer));
 
-		// Create the memory backing up the buffer handle
-		VkMemoryRequirements memReqs;
-		VkMemoryAllocateInfo memAlloc = VkTools::Initializer::MemoryAllocateInfo();
-		vkGetBufferMemoryRequirements(pSwapChain.device, uniformData.buffer, &memReqs);
-		memAlloc.allocationSize = memReqs.size;
-
-		// Find a memory type index that fits the properties of the buffer
-		memAlloc.memoryTypeIndex = VkTools::GetMemoryType(memReqs.memoryTypeBits, memoryPropertyFlags, memoryProperties);
-		VK_CHECK_RESULT(vkAllocateMemory(pSwapChain.device, &memAlloc, nullptr, &uniformData.memory));
+		// Sub-allocate the memory backing up the buffer handle and attach it
+		VkResult result = memoryAllocator->AllocateBuffer(uniformData.buffer, memoryPropertyFlags, uniformData.allocation);
+		if (result != VK_SUCCESS)
+		{
+			vkDestroyBuffer(pSwapChain.device, uniformData.buffer, nullptr);
+			uniformData.buffer = VK_NULL_HANDLE;
+			return result;
+		}
+		uniformData.memory = VK_NULL_HANDLE;
+		uniformData.mapped = uniformData.allocation.pMapped;
 
-		// If a pointer to the buffer data has been passed, map the buffer and copy over the data
+		// If a pointer to the buffer data has been passed, copy it over. Host visible memory stays mapped
 		if (data != nullptr)
 		{
-			void *mapped;
-			VK_CHECK_RESULT(vkMapMemory(pSwapChain.device, uniformData.memory, 0, size, 0, &mapped));
-			memcpy(mapped, data, size);
-			vkUnmapMemory(pSwapChain.device, uniformData.memory);
+			assert(uniformData.allocation.pMapped);
+			memcpy(uniformData.allocation.pMapped, data, size);
 		}
-
-		// Attach the memory to the buffer object
-		VK_CHECK_RESULT(vkBindBufferMemory(pSwapChain.device, uniformData.buffer, uniformData.memory, 0));
 		return VK_SUCCESS;
 	}
 
-	VkResult VkBufferObject::SubmitBufferObjects(const VkCommandBuffer& copyCmd, const VkQueue& copyQueue, const VulkanRendererInitializer& pRendInit, VkDeviceSize size, VkBufferObject_s& stagingBuffer, VkBufferObject_s& localBuffer, drawVertFlags enumDrawDescriptors)
+	VkResult SubmitBufferObjects(VkDeviceSize size, VkBufferObject_s& stagingBuffer, VkBufferObject_s& localBuffer, drawVertFlags enumDrawDescriptors)
 	{
-		VkBufferCopy copyRegion = {};
-
-		copyRegion.size = size;
-		vkCmdCopyBuffer(
-			copyCmd,
-			stagingBuffer.buffer, //stagging buffer
-			localBuffer.buffer, //non stagging buffer
-			1,
-			&copyRegion);
-
-		VK_CHECK_RESULT(vkEndCommandBuffer(copyCmd));
-
-		VkSubmitInfo submitInfo = {};
-		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-		submitInfo.commandBufferCount = 1;
-		submitInfo.pCommandBuffers = &copyCmd;
-
-		VK_CHECK_RESULT(vkQueueSubmit(copyQueue, 1, &submitInfo, VK_NULL_HANDLE));
-		VK_CHECK_RESULT(vkQueueWaitIdle(copyQueue));
-		vkFreeCommandBuffers(pRendInit.m_SwapChain.device, pRendInit.m_CmdPool, 1, &copyCmd);
-
-
-		vkDestroyBuffer(pRendInit.m_SwapChain.device, stagingBuffer.buffer, nullptr);
-		vkFreeMemory(pRendInit.m_SwapChain.device, stagingBuffer.memory, nullptr);
-
+		//Copy goes into the current upload batch, staging buffer is destroyed once the batch has finished
+		uploadManager->CopyBuffer(stagingBuffer.buffer, stagingBuffer.allocation, localBuffer.buffer, size);
 
 		if (enumDrawDescriptors == (drawVertFlags::Vertex | drawVertFlags::Normal | drawVertFlags::Uv))
 		{
@@ -116,7 +85,7 @@ namespace VkBufferObject
 		return VK_SUCCESS;
 	}
 
-	VkResult VkBufferObject::SubmitCommandBuffer(const VkQueue& copyQueue, const VkCommandBuffer& copyCmd, const VulkanRendererInitializer& pRendInit)
+	VkResult SubmitCommandBuffer(const VkQueue& copyQueue, const VkCommandBuffer& copyCmd, const VulkanRendererInitializer& pRendInit)
 	{
 		VK_CHECK_RESULT(vkEndCommandBuffer(copyCmd));
 
@@ -132,17 +101,27 @@ namespace VkBufferObject
 		return VK_SUCCESS;
 	}
 
-	void VkBufferObject::DeleteBufferMemory(VkDevice device, VkBufferObject_s& buffer, const VkAllocationCallbacks* pAllocator)
+	void DeleteBufferMemory(VkDevice device, VkBufferObject_s& buffer, const VkAllocationCallbacks* pAllocator)
 	{
 		if (buffer.buffer != VK_NULL_HANDLE)
 		{
 			vkDestroyBuffer(device, buffer.buffer, nullptr);
-			vkFreeMemory(device, buffer.memory, nullptr);
+			buffer.buffer = VK_NULL_HANDLE;
+		}
+
+		if (buffer.allocation.IsValid())
+		{
+			memoryAllocator->Free(buffer.allocation);
+		}
+		else if (buffer.memory != VK_NULL_HANDLE)
+		{
+			vkFreeMemory(device, buffer.memory, pAllocator);
+			buffer.memory = VK_NULL_HANDLE;
 		}
 	}
 
 
-	void VkBufferObject::BindVertexDescriptor(VkBufferObject_s& localBuffer)
+	void BindVertexDescriptor(VkBufferObject_s& localBuffer)
 	{
 		// Binding description
 		localBuffer.bindingDescriptions.resize(1);
@@ -171,7 +150,7 @@ namespace VkBufferObject
 	}
 
 
-	void VkBufferObject::BindNormalDescriptor(VkBufferObject_s& localBuffer)
+	void BindNormalDescriptor(VkBufferObject_s& localBuffer)
 	{
 		// Binding description
 		localBuffer.bindingDescriptions.resize(1);
@@ -201,7 +180,7 @@ namespace VkBufferObject
 	}
 
 
-	void VkBufferObject::BindUvDescriptor(VkBufferObject_s& localBuffer)
+	void BindUvDescriptor(VkBufferObject_s& localBuffer)
 	{
 		// Binding description
 		localBuffer.bindingDescriptions.resize(1);
@@ -230,7 +209,7 @@ namespace VkBufferObject
 	}
 
 
-	void VkBufferObject::BindVertexUvDescriptor(VkBufferObject_s& localBuffer)
+	void BindVertexUvDescriptor(VkBufferObject_s& localBuffer)
 	{
 		// Binding description
 		localBuffer.bindingDescriptions.resize(1);
@@ -265,12 +244,12 @@ namespace VkBufferObject
 	}
 
 
-	void VkBufferObject::BindVertexNormalDescriptor(VkBufferObject_s& localBuffer)
+	void BindVertexNormalDescriptor(VkBufferObject_s& localBuffer)
 	{
 
 	}
 
-	void VkBufferObject::BindVertexNormalUvDescriptor(VkBufferObject_s& localBuffer)
+	void BindVertexNormalUvDescriptor(VkBufferObject_s& localBuffer)
 	{
 		// Binding description
 		localBuffer.bindingDescriptions.resize(1);
@@ -310,7 +289,7 @@ namespace VkBufferObject
 		localBuffer.inputState.pVertexAttributeDescriptions = localBuffer.attributeDescriptions.data();
 	}
 
-	void VkBufferObject::BindVertexNormalUvTangentBinormalDescriptor(VkBufferObject_s& localBuffer)
+	void BindVertexNormalUvTangentBinormalDescriptor(VkBufferObject_s& localBuffer)
 	{
 		// Binding description
 		localBuffer.bindingDescriptions.resize(1);
@@ -366,17 +345,14 @@ namespace VkBufferObject
 
 
 
-	void VkBufferObject::BindVertUvBoneWeightBoneId(VkBufferObject_s& localBuffer)
+	void BindVertUvBoneWeightBoneId(VkBufferObject_s& localBuffer)
 	{
 
 	}
 
 
-
-
-	void VkBufferObject::FreeMeshBufferResources(VkDevice& device, VkBufferObject_s& meshBuffer)
+	void FreeMeshBufferResources(VkDevice& device, VkBufferObject_s& meshBuffer)
 	{
-		vkDestroyBuffer(device, meshBuffer.buffer, nullptr);
-		vkFreeMemory(device, meshBuffer.memory, nullptr);
+		DeleteBufferMemory(device, meshBuffer, nullptr);
 	}
 }
\ No newline at end of file
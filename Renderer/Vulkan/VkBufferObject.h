@@ -4,12 +4,13 @@
 *	This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
 */
 #pragma once
-#include <External\vulkan\vulkan.h>
+#include <External/vulkan/vulkan.h>
+#include "VulkanMemoryAllocator.h"
 
 //forward declaration
 class VulkanSwapChain;
 class VulkanRendererInitializer;
-enum drawVertFlags;
+enum drawVertFlags : int;
 
 namespace VkTools
 {
@@ -26,7 +27,8 @@ struct  VkBufferObject_s
 	std::vector<VkVertexInputAttributeDescription> attributeDescriptions;
 
 	VkBuffer buffer;
-	VkDeviceMemory memory;
+	VkDeviceMemory memory;			// only set when buffer owns its memory
+	VulkanAllocation allocation;	// set when created through CreateBuffer
 };
 
 /*
@@ -37,7 +39,8 @@ namespace VkBufferObject
 	 VkResult CreateBuffer(const VulkanSwapChain& pSwapChain, VkPhysicalDeviceMemoryProperties& memoryProperties, VkBufferUsageFlags usageFlags, VkMemoryPropertyFlags memoryPropertyFlags, VkDeviceSize size, VkBufferObject_s& bufferObject, void *data = nullptr);
 	 VkResult CreateBuffer(const VulkanSwapChain& pSwapChain, VkPhysicalDeviceMemoryProperties& memoryProperties, VkBufferUsageFlags usageFlags, VkMemoryPropertyFlags memoryPropertyFlags, VkDeviceSize size, VkTools::UniformData& uniformData, void *data = nullptr);
 
-	 VkResult SubmitBufferObjects(const VkCommandBuffer& copyCmd, const VkQueue& copyQueue, const VulkanRendererInitializer& pRendInit, VkDeviceSize size, VkBufferObject_s& stagingBuffer, VkBufferObject_s& localBuffer, drawVertFlags enumDrawDescriptors);
+	//Queues staging to local copy on uploadManager, which owns stagingBuffer afterwards. Visible after uploadManager->Flush()
+	 VkResult SubmitBufferObjects(VkDeviceSize size, VkBufferObject_s& stagingBuffer, VkBufferObject_s& localBuffer, drawVertFlags enumDrawDescriptors);
 
 	//You can use this function if command buffer was not submitted
 	 VkResult SubmitCommandBuffer(const VkQueue& copyQueue,const VkCommandBuffer& copyCmd, const VulkanRendererInitializer& pRendInit);
@@ -1,5 +1,5 @@
 //Copyright 2015-2016 Tomas Mikalauskas. All rights reserved.
-#include <RendererPch\stdafx.h>
+#include <RendererPch/stdafx.h>
 
 //Renderer Vulkan Includes
 #include "VkTexture2D.h"
@@ -1,6 +1,6 @@
 //Copyright 2015-2016 Tomas Mikalauskas. All rights reserved.
 #pragma once
-#include <External\vulkan\vulkan.h>
+#include <External/vulkan/vulkan.h>
 
 
 
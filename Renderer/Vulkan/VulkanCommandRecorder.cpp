@@ -0,0 +1,155 @@
+/*
+*	Copyright 2015-2016 Tomas Mikalauskas. All rights reserved.
+*	GitHub repository - https://github.com/TywyllSoftware/TywRenderer
+*	This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+#include <RendererPch/stdafx.h>
+
+//Vulkan Includes
+#include "VulkanCommandRecorder.h"
+#include "VulkanTools.h"
+
+//JobSystem Includes
+#include "JobSystem/JobSystem.h"
+
+//Profiler Includes
+#include "Profiler/CpuProfiler.h"
+
+
+VulkanCommandRecorder::VulkanCommandRecorder(VkDevice device, uint32_t graphicsFamily):
+	m_Device(device),
+	m_NumSlots((jobSystem ? jobSystem->GetThreadCount() : 1) + 1)
+{
+	memset(&m_Stats, 0, sizeof(m_Stats));
+
+	VkCommandPoolCreateInfo cmdPoolInfo = {};
+	cmdPoolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	cmdPoolInfo.queueFamilyIndex = graphicsFamily;
+	cmdPoolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+
+	for (uint32_t i = 0; i < VULKAN_FRAMES_IN_FLIGHT; i++)
+	{
+		m_PoolFrameNum[i] = UINT64_MAX;
+		m_Pools[i].resize(m_NumSlots);
+		for (ThreadPool& pool : m_Pools[i])
+		{
+			VK_CHECK_RESULT(vkCreateCommandPool(m_Device, &cmdPoolInfo, nullptr, &pool.cmdPool));
+			pool.numCmdBuffersUsed = 0;
+			pool.bUsed = false;
+		}
+	}
+}
+
+
+VulkanCommandRecorder::~VulkanCommandRecorder()
+{
+	//Secondaries may still be referenced by frames in flight
+	VK_CHECK_RESULT(vkDeviceWaitIdle(m_Device));
+
+	for (uint32_t i = 0; i < VULKAN_FRAMES_IN_FLIGHT; i++)
+	{
+		for (ThreadPool& pool : m_Pools[i])
+		{
+			//Destroying pools frees their command buffers
+			vkDestroyCommandPool(m_Device, pool.cmdPool, nullptr);
+		}
+	}
+}
+
+
+VkCommandBuffer VulkanCommandRecorder::GetCommandBuffer(ThreadPool& pool)
+{
+	if (pool.numCmdBuffersUsed == pool.cmdBuffers.size())
+	{
+		VkCommandBuffer cmdBuffer;
+		VkCommandBufferAllocateInfo cmdBufAllocateInfo = VkTools::Initializer::CommandBufferAllocateInfo(pool.cmdPool, VK_COMMAND_BUFFER_LEVEL_SECONDARY, 1);
+		VK_CHECK_RESULT(vkAllocateCommandBuffers(m_Device, &cmdBufAllocateInfo, &cmdBuffer));
+		pool.cmdBuffers.push_back(cmdBuffer);
+	}
+	pool.bUsed = true;
+	return pool.cmdBuffers[pool.numCmdBuffersUsed++];
+}
+
+
+void VulkanCommandRecorder::Record(VkCommandBuffer primary, VkRenderPass renderPass, uint32_t subpass, VkFramebuffer framebuffer,
+	uint32_t drawCount, uint32_t drawsPerChunk, const RecordDrawsFunction& record)
+{
+	TYW_PROFILE_FUNCTION();
+	auto start = std::chrono::high_resolution_clock::now();
+
+	//Frame manager waited for this frame context before it handed it out again, its secondaries are done
+	const uint64_t frameNum = frameManager->FrameNum();
+	std::vector<ThreadPool>& pools = m_Pools[frameNum % VULKAN_FRAMES_IN_FLIGHT];
+	if (m_PoolFrameNum[frameNum % VULKAN_FRAMES_IN_FLIGHT] != frameNum)
+	{
+		for (ThreadPool& pool : pools)
+		{
+			VK_CHECK_RESULT(vkResetCommandPool(m_Device, pool.cmdPool, 0));
+			pool.numCmdBuffersUsed = 0;
+		}
+		m_PoolFrameNum[frameNum % VULKAN_FRAMES_IN_FLIGHT] = frameNum;
+	}
+	for (ThreadPool& pool : pools)
+	{
+		pool.bUsed = false;
+	}
+
+	drawsPerChunk = std::max(drawsPerChunk, 1u);
+	const uint32_t numChunks = (drawCount + drawsPerChunk - 1) / drawsPerChunk;
+	std::vector<VkCommandBuffer> chunkCmdBuffers(numChunks);
+
+	VkCommandBufferInheritanceInfo inheritanceInfo = {};
+	inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+	inheritanceInfo.renderPass = renderPass;
+	inheritanceInfo.subpass = subpass;
+	inheritanceInfo.framebuffer = framebuffer;
+
+	VkCommandBufferBeginInfo cmdBufInfo = VkTools::Initializer::CommandBufferBeginInfo();
+	cmdBufInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT | VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	cmdBufInfo.pInheritanceInfo = &inheritanceInfo;
+
+	ParallelFor(numChunks, 1, [&](uint32_t firstChunk, uint32_t lastChunk)
+	{
+		uint32_t slot = jobSystem ? jobSystem->GetWorkerIndex() : 0;
+		const bool bForeign = slot >= m_NumSlots - 1;
+		if (bForeign)
+		{
+			slot = m_NumSlots - 1;
+		}
+
+		std::unique_lock<std::mutex> lock(m_ForeignLock, std::defer_lock);
+		if (bForeign)
+		{
+			lock.lock();
+		}
+
+		ThreadPool& pool = pools[slot];
+		for (uint32_t chunk = firstChunk; chunk < lastChunk; chunk++)
+		{
+			TYW_PROFILE_SCOPE("Record chunk");
+			VkCommandBuffer cmdBuffer = GetCommandBuffer(pool);
+			VK_CHECK_RESULT(vkBeginCommandBuffer(cmdBuffer, &cmdBufInfo));
+
+			const uint32_t first = chunk * drawsPerChunk;
+			record(cmdBuffer, first, std::min(first + drawsPerChunk, drawCount));
+
+			VK_CHECK_RESULT(vkEndCommandBuffer(cmdBuffer));
+			chunkCmdBuffers[chunk] = cmdBuffer;
+		}
+	});
+
+	if (numChunks > 0)
+	{
+		vkCmdExecuteCommands(primary, numChunks, chunkCmdBuffers.data());
+	}
+
+	TYW_PROFILE_COUNTER("Recorded draws", drawCount);
+	m_Stats.numDraws = drawCount;
+	m_Stats.numChunks = numChunks;
+	m_Stats.numThreads = 0;
+	for (const ThreadPool& pool : pools)
+	{
+		m_Stats.numThreads += pool.bUsed ? 1 : 0;
+	}
+	m_Stats.recordMicroSec = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - start).count();
+}
@@ -0,0 +1,94 @@
+/*
+*	Copyright 2015-2016 Tomas Mikalauskas. All rights reserved.
+*	GitHub repository - https://github.com/TywyllSoftware/TywRenderer
+*	This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+#pragma once
+#include <vector>
+#include <mutex>
+#include <functional>
+#include <External/vulkan/vulkan.h>
+#include "VulkanFrameManager.h"
+
+
+// Records draws [first, last) into a secondary command buffer that continues a render pass
+typedef std::function<void(VkCommandBuffer cmdBuffer, uint32_t first, uint32_t last)> RecordDrawsFunction;
+
+
+struct VulkanCommandRecorderStats
+{
+	uint32_t		numDraws;			// last Record call
+	uint32_t		numChunks;			// secondary command buffers executed by last Record call
+	uint32_t		numThreads;			// threads that recorded at least one chunk
+	uint64_t		recordMicroSec;		// wall time of last Record call
+};
+
+
+/*
+	VulkanCommandRecorder
+	Splits draws of one subpass into chunks and records every chunk into a
+	secondary command buffer on the job system. The primary executes the
+	secondaries in chunk order, so the result matches serial recording.
+
+	Command pools are externally synchronized, so every job system thread gets its own
+	pool for every frame in flight. Pools of a frame are reset on the first Record call
+	after VulkanFrameManager recycled that frame, secondaries live for one frame only.
+	Threads outside the job system share one locked pool.
+*/
+class VulkanCommandRecorder
+{
+public:
+	/*
+		Sizes thread pools for the current jobSystem
+
+		@param: VkDevice device
+		@param: uint32_t graphicsFamily
+	*/
+	VulkanCommandRecorder(VkDevice device, uint32_t graphicsFamily);
+	~VulkanCommandRecorder();
+
+	/*
+		Secondaries do not inherit state, record must bind pipeline, buffers
+		and set dynamic state in every chunk
+
+		@param: VkCommandBuffer primary - inside a render pass begun with VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS
+		@param: VkRenderPass renderPass
+		@param: uint32_t subpass
+		@param: VkFramebuffer framebuffer
+		@param: uint32_t drawCount
+		@param: uint32_t drawsPerChunk
+		@param: const RecordDrawsFunction& record - called from worker threads
+	*/
+	void Record(VkCommandBuffer primary, VkRenderPass renderPass, uint32_t subpass, VkFramebuffer framebuffer,
+		uint32_t drawCount, uint32_t drawsPerChunk, const RecordDrawsFunction& record);
+
+	VulkanCommandRecorderStats GetStats() const { return m_Stats; }
+
+private:
+	VulkanCommandRecorder(const VulkanCommandRecorder&) = delete;
+	VulkanCommandRecorder& operator=(const VulkanCommandRecorder&) = delete;
+
+	struct ThreadPool
+	{
+		VkCommandPool					cmdPool;
+		std::vector<VkCommandBuffer>	cmdBuffers;		// recycled on pool reset
+		uint32_t						numCmdBuffersUsed;
+		bool							bUsed;			// by the current Record call
+	};
+
+	/*
+		@param: ThreadPool& pool
+		@return: VkCommandBuffer - secondary, not begun
+	*/
+	VkCommandBuffer GetCommandBuffer(ThreadPool& pool);
+
+private:
+	VkDevice						m_Device;
+	uint32_t						m_NumSlots;			// job system threads + one shared slot for foreign threads
+
+	std::vector<ThreadPool>			m_Pools[VULKAN_FRAMES_IN_FLIGHT];
+	uint64_t						m_PoolFrameNum[VULKAN_FRAMES_IN_FLIGHT];	// frame the pools were last reset for
+	std::mutex						m_ForeignLock;
+
+	VulkanCommandRecorderStats		m_Stats;
+};
@@ -8,10 +8,7 @@
 * This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
 */
 
-#include "Vulkan\VulkanDebug.h"
-#include <iostream>
-
-#include "vulkandebug.h"
+#include "Vulkan/VulkanDebug.h"
 #include <iostream>
 
 namespace vkDebug
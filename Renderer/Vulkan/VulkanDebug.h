@@ -12,13 +12,13 @@
 #include <io.h>
 #endif
 #ifdef __ANDROID__
-#include "Vulkan\VulkanAndroid.h"
+#include "Vulkan/VulkanAndroid.h"
 #else
-#include <External\vulkan\vulkan.h>
+#include <External/vulkan/vulkan.h>
 #endif
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
-#include <External\glm\glm\glm.hpp>
+#include <External/glm/glm/glm.hpp>
 
 
 namespace vkDebug
@@ -0,0 +1,119 @@
+/*
+*	Copyright 2015-2016 Tomas Mikalauskas. All rights reserved.
+*	GitHub repository - https://github.com/TywyllSoftware/TywRenderer
+*	This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+#include <RendererPch/stdafx.h>
+
+//Vulkan Includes
+#include "VulkanDescriptorAllocator.h"
+#include "VulkanTools.h"
+
+
+VulkanDescriptorAllocator* descriptorAllocator = nullptr;
+
+
+//Descriptors per set in every pool. A sample set has up to two uniform buffers, one dynamic uniform buffer and four samplers
+static const struct
+{
+	VkDescriptorType	type;
+	float				perSet;
+} POOL_RATIOS[] =
+{
+	{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,			2.0f },
+	{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,	1.0f },
+	{ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,	4.0f },
+	{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,			0.5f },
+	{ VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,				0.5f },
+};
+
+
+VulkanDescriptorAllocator::VulkanDescriptorAllocator(VkDevice device, uint32_t setsPerPool):
+	m_Device(device),
+	m_SetsPerPool(setsPerPool),
+	m_CurrentPool(VK_NULL_HANDLE)
+{
+	memset(&m_Stats, 0, sizeof(m_Stats));
+}
+
+
+VulkanDescriptorAllocator::~VulkanDescriptorAllocator()
+{
+	for (VkDescriptorPool pool : m_UsedPools)
+	{
+		vkDestroyDescriptorPool(m_Device, pool, nullptr);
+	}
+	for (VkDescriptorPool pool : m_FreePools)
+	{
+		vkDestroyDescriptorPool(m_Device, pool, nullptr);
+	}
+}
+
+
+VkDescriptorPool VulkanDescriptorAllocator::GrabPool()
+{
+	VkDescriptorPool pool = VK_NULL_HANDLE;
+	if (!m_FreePools.empty())
+	{
+		pool = m_FreePools.back();
+		m_FreePools.pop_back();
+	}
+	else
+	{
+		std::vector<VkDescriptorPoolSize> poolSizes;
+		for (const auto& ratio : POOL_RATIOS)
+		{
+			uint32_t count = static_cast<uint32_t>(ratio.perSet * m_SetsPerPool);
+			poolSizes.push_back(VkTools::Initializer::DescriptorPoolSize(ratio.type, count > 0 ? count : 1));
+		}
+
+		VkDescriptorPoolCreateInfo descriptorPoolInfo = VkTools::Initializer::DescriptorPoolCreateInfo(static_cast<uint32_t>(poolSizes.size()), poolSizes.data(), m_SetsPerPool);
+		VK_CHECK_RESULT(vkCreateDescriptorPool(m_Device, &descriptorPoolInfo, nullptr, &pool));
+		m_Stats.numPools++;
+	}
+
+	m_UsedPools.push_back(pool);
+	m_Stats.numPoolsInUse++;
+	return pool;
+}
+
+
+VkDescriptorSet VulkanDescriptorAllocator::Allocate(VkDescriptorSetLayout layout)
+{
+	if (m_CurrentPool == VK_NULL_HANDLE)
+	{
+		m_CurrentPool = GrabPool();
+	}
+
+	VkDescriptorSet set = VK_NULL_HANDLE;
+	VkDescriptorSetAllocateInfo allocInfo = VkTools::Initializer::DescriptorSetAllocateInfo(m_CurrentPool, &layout, 1);
+	VkResult result = vkAllocateDescriptorSets(m_Device, &allocInfo, &set);
+
+	//Pool ran out of sets or descriptors, retry once with an empty pool
+	if (result == VK_ERROR_OUT_OF_POOL_MEMORY_KHR || result == VK_ERROR_FRAGMENTED_POOL || result == VK_ERROR_OUT_OF_DEVICE_MEMORY)
+	{
+		m_CurrentPool = GrabPool();
+		allocInfo.descriptorPool = m_CurrentPool;
+		result = vkAllocateDescriptorSets(m_Device, &allocInfo, &set);
+	}
+	VK_CHECK_RESULT(result);
+
+	m_Stats.numSets++;
+	return set;
+}
+
+
+void VulkanDescriptorAllocator::Reset()
+{
+	for (VkDescriptorPool pool : m_UsedPools)
+	{
+		VK_CHECK_RESULT(vkResetDescriptorPool(m_Device, pool, 0));
+		m_FreePools.push_back(pool);
+	}
+	m_UsedPools.clear();
+	m_CurrentPool = VK_NULL_HANDLE;
+
+	m_Stats.numPoolsInUse = 0;
+	m_Stats.numSets = 0;
+	m_Stats.numResets++;
+}
@@ -0,0 +1,68 @@
+/*
+*	Copyright 2015-2016 Tomas Mikalauskas. All rights reserved.
+*	GitHub repository - https://github.com/TywyllSoftware/TywRenderer
+*	This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+#pragma once
+#include <vector>
+#include <External/vulkan/vulkan.h>
+
+
+struct VulkanDescriptorAllocatorStats
+{
+	uint32_t		numPools;			// pools created so far
+	uint32_t		numPoolsInUse;		// pools holding sets since last Reset
+	uint32_t		numSets;			// sets allocated since last Reset
+	uint32_t		numResets;
+};
+
+
+/*
+	VulkanDescriptorAllocator
+	Hands out descriptor sets from a list of pools. When the current pool is full
+	another one is taken from the free list or created, so callers never size pools
+	up front. Sets are never freed one by one, Reset returns every pool at once.
+
+	Each pool holds setsPerPool sets with a fixed mix of descriptor types that fits
+	the layouts used by the samples. Layouts with large arrays need their own
+	pool. Not thread safe.
+*/
+class VulkanDescriptorAllocator
+{
+public:
+	/*
+		@param: VkDevice device
+		@param: uint32_t setsPerPool
+	*/
+	VulkanDescriptorAllocator(VkDevice device, uint32_t setsPerPool = 128);
+	~VulkanDescriptorAllocator();
+
+	/*
+		@param: VkDescriptorSetLayout layout
+		@return: VkDescriptorSet - valid until Reset
+	*/
+	VkDescriptorSet Allocate(VkDescriptorSetLayout layout);
+
+	//Frees all sets. No set may be in use by the GPU
+	void Reset();
+
+	VulkanDescriptorAllocatorStats GetStats() const { return m_Stats; }
+
+private:
+	VulkanDescriptorAllocator(const VulkanDescriptorAllocator&) = delete;
+	VulkanDescriptorAllocator& operator=(const VulkanDescriptorAllocator&) = delete;
+
+	VkDescriptorPool GrabPool();
+
+private:
+	VkDevice								m_Device;
+	uint32_t								m_SetsPerPool;
+
+	VkDescriptorPool						m_CurrentPool;
+	std::vector<VkDescriptorPool>			m_UsedPools;		// full pools and m_CurrentPool
+	std::vector<VkDescriptorPool>			m_FreePools;		// reset, ready to be reused
+
+	VulkanDescriptorAllocatorStats			m_Stats;
+};
+
+extern VulkanDescriptorAllocator* descriptorAllocator;
@@ -0,0 +1,285 @@
+/*
+*	Copyright 2015-2016 Tomas Mikalauskas. All rights reserved.
+*	GitHub repository - https://github.com/TywyllSoftware/TywRenderer
+*	This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+#include <RendererPch/stdafx.h>
+
+//Vulkan Includes
+#include "VulkanFrameManager.h"
+#include "VulkanSwapChain.h"
+#include "VulkanDescriptorAllocator.h"
+#include "VulkanTools.h"
+
+//Renderer Includes
+#include "VertexCache.h"
+
+
+VulkanFrameManager* frameManager = nullptr;
+
+static_assert(VULKAN_FRAMES_IN_FLIGHT == VERTCACHE_NUM_FRAMES, "VertexCache frame sets are the uniform slices of frames in flight");
+
+
+static inline uint64_t ElapsedMicroSec(const std::chrono::high_resolution_clock::time_point& start)
+{
+	return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+
+VulkanFrameManager::VulkanFrameManager(VkDevice device, uint32_t graphicsFamily, uint32_t timestampValidBits, float timestampPeriod):
+	m_Device(device),
+	m_TimerCmdPool(VK_NULL_HANDLE),
+	m_QueryPool(VK_NULL_HANDLE),
+	m_TimestampPeriod(timestampPeriod),
+	m_TimestampMask(timestampValidBits >= 64 ? ~0ULL : ((1ULL << timestampValidBits) - 1)),
+	m_FrameIndex(0),
+	m_FrameNum(0)
+{
+	memset(&m_Stats, 0, sizeof(m_Stats));
+
+	if (timestampValidBits > 0)
+	{
+		VkQueryPoolCreateInfo queryPoolInfo = {};
+		queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+		queryPoolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+		queryPoolInfo.queryCount = VULKAN_FRAMES_IN_FLIGHT * 2;
+		VK_CHECK_RESULT(vkCreateQueryPool(m_Device, &queryPoolInfo, nullptr, &m_QueryPool));
+	}
+
+	VkCommandPoolCreateInfo cmdPoolInfo = {};
+	cmdPoolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	cmdPoolInfo.queueFamilyIndex = graphicsFamily;
+	VK_CHECK_RESULT(vkCreateCommandPool(m_Device, &cmdPoolInfo, nullptr, &m_TimerCmdPool));
+
+	VkSemaphoreCreateInfo semaphoreCreateInfo = VkTools::Initializer::SemaphoreCreateInfo();
+	VkFenceCreateInfo fenceCreateInfo = VkTools::Initializer::FenceCreateInfo(VK_FLAGS_NONE);
+	VkCommandBufferBeginInfo cmdBufInfo = VkTools::Initializer::CommandBufferBeginInfo();
+
+	for (uint32_t i = 0; i < VULKAN_FRAMES_IN_FLIGHT; i++)
+	{
+		FrameContext& frame = m_Frames[i];
+		frame.numCmdBuffersUsed = 0;
+		frame.descriptors = TYW_NEW VulkanDescriptorAllocator(m_Device, 64);
+		frame.frameNum = 0;
+		frame.bTimerStarted = false;
+		frame.bSubmitted = false;
+
+		//Whole pool is reset once the frame is done, command buffers do not need the reset bit
+		cmdPoolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+		VK_CHECK_RESULT(vkCreateCommandPool(m_Device, &cmdPoolInfo, nullptr, &frame.cmdPool));
+
+		VK_CHECK_RESULT(vkCreateFence(m_Device, &fenceCreateInfo, nullptr, &frame.fence));
+		VK_CHECK_RESULT(vkCreateSemaphore(m_Device, &semaphoreCreateInfo, nullptr, &frame.imageAcquired));
+		VK_CHECK_RESULT(vkCreateSemaphore(m_Device, &semaphoreCreateInfo, nullptr, &frame.renderComplete));
+
+		//Timer command buffers never change. Without timestamp support they are empty, so callers do not need to check
+		VkCommandBuffer timerCmdBuffers[2];
+		VkCommandBufferAllocateInfo cmdBufAllocateInfo = VkTools::Initializer::CommandBufferAllocateInfo(m_TimerCmdPool, VK_COMMAND_BUFFER_LEVEL_PRIMARY, 2);
+		VK_CHECK_RESULT(vkAllocateCommandBuffers(m_Device, &cmdBufAllocateInfo, timerCmdBuffers));
+		frame.timerBeginCmdBuffer = timerCmdBuffers[0];
+		frame.timerEndCmdBuffer = timerCmdBuffers[1];
+
+		VK_CHECK_RESULT(vkBeginCommandBuffer(frame.timerBeginCmdBuffer, &cmdBufInfo));
+		if (m_QueryPool != VK_NULL_HANDLE)
+		{
+			vkCmdResetQueryPool(frame.timerBeginCmdBuffer, m_QueryPool, i * 2, 2);
+			vkCmdWriteTimestamp(frame.timerBeginCmdBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, m_QueryPool, i * 2);
+		}
+		VK_CHECK_RESULT(vkEndCommandBuffer(frame.timerBeginCmdBuffer));
+
+		VK_CHECK_RESULT(vkBeginCommandBuffer(frame.timerEndCmdBuffer, &cmdBufInfo));
+		if (m_QueryPool != VK_NULL_HANDLE)
+		{
+			vkCmdWriteTimestamp(frame.timerEndCmdBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_QueryPool, i * 2 + 1);
+		}
+		VK_CHECK_RESULT(vkEndCommandBuffer(frame.timerEndCmdBuffer));
+	}
+}
+
+
+VulkanFrameManager::~VulkanFrameManager()
+{
+	//Current frame may have been submitted without EndFrame
+	VK_CHECK_RESULT(vkDeviceWaitIdle(m_Device));
+
+	for (uint32_t i = 0; i < VULKAN_FRAMES_IN_FLIGHT; i++)
+	{
+		FrameContext& frame = m_Frames[i];
+		for (auto& destroy : frame.deferredDestroys)
+		{
+			destroy();
+		}
+
+		//Destroying pools frees their command buffers
+		vkDestroyCommandPool(m_Device, frame.cmdPool, nullptr);
+		SAFE_DELETE(frame.descriptors);
+		vkDestroyFence(m_Device, frame.fence, nullptr);
+		vkDestroySemaphore(m_Device, frame.imageAcquired, nullptr);
+		vkDestroySemaphore(m_Device, frame.renderComplete, nullptr);
+	}
+
+	vkDestroyCommandPool(m_Device, m_TimerCmdPool, nullptr);
+	if (m_QueryPool != VK_NULL_HANDLE)
+	{
+		vkDestroyQueryPool(m_Device, m_QueryPool, nullptr);
+	}
+}
+
+
+VkResult VulkanFrameManager::AcquireImage(VulkanSwapChain& swapChain, uint32_t* pImageIndex)
+{
+	FrameContext& frame = m_Frames[m_FrameIndex];
+
+	VkResult result = swapChain.GetNextImage(frame.imageAcquired, pImageIndex);
+	if (result < VK_SUCCESS)
+	{
+		return result;
+	}
+
+	if (*pImageIndex >= m_ImageFences.size())
+	{
+		m_ImageFences.resize(*pImageIndex + 1, VK_NULL_HANDLE);
+	}
+
+	//Current frame fence is reset and not submitted yet, waiting on it would never return.
+	//Every older use of it was already waited on by EndFrame
+	VkFence imageFence = m_ImageFences[*pImageIndex];
+	if (imageFence != VK_NULL_HANDLE && imageFence != frame.fence)
+	{
+		auto start = std::chrono::high_resolution_clock::now();
+		VK_CHECK_RESULT(vkWaitForFences(m_Device, 1, &imageFence, VK_TRUE, UINT64_MAX));
+		m_Stats.cpuWaitMicroSec += ElapsedMicroSec(start);
+	}
+	m_ImageFences[*pImageIndex] = frame.fence;
+
+	return result;
+}
+
+
+VkCommandBuffer VulkanFrameManager::GetCommandBuffer()
+{
+	FrameContext& frame = m_Frames[m_FrameIndex];
+	if (frame.numCmdBuffersUsed == frame.cmdBuffers.size())
+	{
+		VkCommandBuffer cmdBuffer = VK_NULL_HANDLE;
+		VkCommandBufferAllocateInfo cmdBufAllocateInfo = VkTools::Initializer::CommandBufferAllocateInfo(frame.cmdPool, VK_COMMAND_BUFFER_LEVEL_PRIMARY, 1);
+		VK_CHECK_RESULT(vkAllocateCommandBuffers(m_Device, &cmdBufAllocateInfo, &cmdBuffer));
+		frame.cmdBuffers.push_back(cmdBuffer);
+	}
+	return frame.cmdBuffers[frame.numCmdBuffersUsed++];
+}
+
+
+VkDescriptorSet VulkanFrameManager::AllocateDescriptorSet(VkDescriptorSetLayout layout)
+{
+	return m_Frames[m_FrameIndex].descriptors->Allocate(layout);
+}
+
+
+VkCommandBuffer VulkanFrameManager::BeginFrameTimer()
+{
+	FrameContext& frame = m_Frames[m_FrameIndex];
+	frame.bTimerStarted = true;
+	return frame.timerBeginCmdBuffer;
+}
+
+
+void VulkanFrameManager::DeferDestroy(std::function<void()> destroy)
+{
+	m_Frames[m_FrameIndex].deferredDestroys.push_back(std::move(destroy));
+}
+
+
+void VulkanFrameManager::EndFrame(VkQueue queue)
+{
+	FrameContext& frame = m_Frames[m_FrameIndex];
+
+	//End timestamp is only valid together with the reset in the begin command buffer
+	VkSubmitInfo submitInfo = VkTools::Initializer::SubmitInfo();
+	if (frame.bTimerStarted)
+	{
+		submitInfo.commandBufferCount = 1;
+		submitInfo.pCommandBuffers = &frame.timerEndCmdBuffer;
+	}
+	VK_CHECK_RESULT(vkQueueSubmit(queue, 1, &submitInfo, frame.fence));
+	frame.frameNum = m_FrameNum;
+	frame.bSubmitted = true;
+
+	m_FrameNum++;
+	m_FrameIndex = m_FrameNum % VULKAN_FRAMES_IN_FLIGHT;
+
+	//Only blocks when the CPU is VULKAN_FRAMES_IN_FLIGHT frames ahead
+	auto start = std::chrono::high_resolution_clock::now();
+	WaitFrame(m_Frames[m_FrameIndex]);
+
+	m_Stats.frameNum = m_FrameNum;
+	m_Stats.cpuWaitMicroSec = ElapsedMicroSec(start);
+}
+
+
+void VulkanFrameManager::WaitIdle()
+{
+	//Current frame is not submitted yet and may be recording, leave its command buffers and destructions alone
+	for (uint32_t i = 0; i < VULKAN_FRAMES_IN_FLIGHT; i++)
+	{
+		if (i != m_FrameIndex)
+		{
+			WaitFrame(m_Frames[i]);
+		}
+	}
+
+	//Swapchain images may be recreated, forget which frame used them
+	m_ImageFences.clear();
+}
+
+
+void VulkanFrameManager::WaitFrame(FrameContext& frame)
+{
+	if (frame.bSubmitted)
+	{
+		VK_CHECK_RESULT(vkWaitForFences(m_Device, 1, &frame.fence, VK_TRUE, UINT64_MAX));
+		VK_CHECK_RESULT(vkResetFences(m_Device, 1, &frame.fence));
+		frame.bSubmitted = false;
+
+		ReadFrameTimer(frame);
+	}
+
+	for (auto& destroy : frame.deferredDestroys)
+	{
+		destroy();
+	}
+	frame.deferredDestroys.clear();
+
+	VK_CHECK_RESULT(vkResetCommandPool(m_Device, frame.cmdPool, 0));
+	frame.numCmdBuffersUsed = 0;
+	frame.descriptors->Reset();
+}
+
+
+void VulkanFrameManager::ReadFrameTimer(FrameContext& frame)
+{
+	if (!frame.bTimerStarted)
+	{
+		return;
+	}
+	frame.bTimerStarted = false;
+
+	if (m_QueryPool == VK_NULL_HANDLE)
+	{
+		return;
+	}
+
+	//Fence has signaled, results are available without waiting
+	uint64_t timestamps[2] = {};
+	uint32_t firstQuery = static_cast<uint32_t>(&frame - m_Frames) * 2;
+	VkResult result = vkGetQueryPoolResults(m_Device, m_QueryPool, firstQuery, 2, sizeof(timestamps), timestamps, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+	if (result != VK_SUCCESS)
+	{
+		return;
+	}
+
+	uint64_t ticks = (timestamps[1] - timestamps[0]) & m_TimestampMask;
+	m_Stats.gpuFrameNum = frame.frameNum;
+	m_Stats.gpuMicroSec = static_cast<uint64_t>(static_cast<double>(ticks) * m_TimestampPeriod / 1000.0);
+	m_Stats.bGpuTimeValid = true;
+}
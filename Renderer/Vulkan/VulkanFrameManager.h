@@ -0,0 +1,158 @@
+/*
+*	Copyright 2015-2016 Tomas Mikalauskas. All rights reserved.
+*	GitHub repository - https://github.com/TywyllSoftware/TywRenderer
+*	This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+#pragma once
+#include <vector>
+#include <functional>
+#include <External/vulkan/vulkan.h>
+
+//forward declared
+class VulkanSwapChain;
+class VulkanDescriptorAllocator;
+
+
+//Frames the CPU may record ahead of the GPU. VertexCache keeps one uniform/geometry slice per frame, so both must match
+const uint32_t VULKAN_FRAMES_IN_FLIGHT = 2;
+
+
+struct VulkanFrameStats
+{
+	uint64_t		frameNum;			// frame that is being recorded now
+	uint64_t		cpuWaitMicroSec;	// time CPU blocked on fences before it could record frameNum
+	uint64_t		gpuFrameNum;		// latest finished frame with a frame timer
+	uint64_t		gpuMicroSec;		// gpu time between the frame timer timestamps of gpuFrameNum
+	bool			bGpuTimeValid;		// false until a frame submitted BeginFrameTimer, or timestamps are unsupported
+};
+
+
+/*
+	VulkanFrameManager
+	Lets the CPU record frame N+1 while the GPU still renders frame N, instead of
+	waiting for the whole queue to drain every frame.
+
+	Every frame in flight owns a command pool, a descriptor allocator, a fence, the swapchain acquire and
+	present semaphores, a timestamp query pair and a list of deferred destructions.
+	EndFrame fences the frame and moves to the next context, blocking only until
+	the GPU has finished the frame that used that context VULKAN_FRAMES_IN_FLIGHT frames ago.
+
+	Command buffers and descriptor sets taken from the frame are valid for the current frame only.
+	Resources that may still be read by frames in flight are destroyed through DeferDestroy.
+*/
+class VulkanFrameManager
+{
+public:
+	/*
+		@param: VkDevice device
+		@param: uint32_t graphicsFamily
+		@param: uint32_t timestampValidBits - of graphicsFamily, 0 disables gpu timing
+		@param: float timestampPeriod - nanoseconds per timestamp tick
+	*/
+	VulkanFrameManager(VkDevice device, uint32_t graphicsFamily, uint32_t timestampValidBits, float timestampPeriod);
+	~VulkanFrameManager();
+
+	/*
+		Acquires next swapchain image with the frame acquire semaphore. If a frame still
+		in flight rendered to the same image, waits for it, so per image command buffers
+		can be submitted or re-recorded
+
+		@param: VulkanSwapChain& swapChain
+		@param: uint32_t* pImageIndex
+		@return: VkResult
+	*/
+	VkResult AcquireImage(VulkanSwapChain& swapChain, uint32_t* pImageIndex);
+
+	//Signaled by AcquireImage. First submit of the frame waits on it
+	VkSemaphore ImageAcquiredSemaphore() const { return m_Frames[m_FrameIndex].imageAcquired; }
+
+	//Last submit of the frame signals it, present waits on it
+	VkSemaphore RenderCompleteSemaphore() const { return m_Frames[m_FrameIndex].renderComplete; }
+
+	/*
+		Primary command buffer owned by the current frame. It is not begun.
+		Recycled when the context is reused, never free it
+
+		@return: VkCommandBuffer
+	*/
+	VkCommandBuffer GetCommandBuffer();
+
+	/*
+		Descriptor set owned by the current frame, for data that changes every frame.
+		Freed together with all other sets of the frame when the context is reused
+
+		@param: VkDescriptorSetLayout layout
+		@return: VkDescriptorSet
+	*/
+	VkDescriptorSet AllocateDescriptorSet(VkDescriptorSetLayout layout);
+
+	/*
+		Prerecorded command buffer that resets the frame queries and writes the start timestamp.
+		Put it first in the first submit of the frame, EndFrame writes the end timestamp
+
+		@return: VkCommandBuffer
+	*/
+	VkCommandBuffer BeginFrameTimer();
+
+	/*
+		Runs destroy once the GPU has finished the current frame
+
+		@param: std::function<void()> destroy
+	*/
+	void DeferDestroy(std::function<void()> destroy);
+
+	/*
+		Call after the last submit of the frame. Submits the frame fence (and the end timestamp),
+		then waits until the next frame context is free and recycles it
+
+		@param: VkQueue queue - graphics queue
+	*/
+	void EndFrame(VkQueue queue);
+
+	//Waits for all previous frames still in flight and runs their deferred destructions. Use before swapchain recreation
+	void WaitIdle();
+
+	VulkanFrameStats GetStats() const { return m_Stats; }
+	uint64_t FrameNum() const { return m_FrameNum; }
+
+private:
+	VulkanFrameManager(const VulkanFrameManager&) = delete;
+	VulkanFrameManager& operator=(const VulkanFrameManager&) = delete;
+
+	struct FrameContext
+	{
+		VkCommandPool							cmdPool;
+		std::vector<VkCommandBuffer>			cmdBuffers;		// recycled on pool reset
+		uint32_t								numCmdBuffersUsed;
+		VulkanDescriptorAllocator*				descriptors;	// reset together with cmdPool
+		VkCommandBuffer							timerBeginCmdBuffer;
+		VkCommandBuffer							timerEndCmdBuffer;
+		VkFence									fence;
+		VkSemaphore								imageAcquired;
+		VkSemaphore								renderComplete;
+		std::vector<std::function<void()>>		deferredDestroys;
+		uint64_t								frameNum;		// frame that last used the context
+		bool									bTimerStarted;
+		bool									bSubmitted;		// fence belongs to a submit that has not been waited on
+	};
+
+	void WaitFrame(FrameContext& frame);
+	void ReadFrameTimer(FrameContext& frame);
+
+private:
+	VkDevice					m_Device;
+	VkCommandPool				m_TimerCmdPool;		// prerecorded timer command buffers, never reset
+	VkQueryPool					m_QueryPool;		// two timestamps per frame context
+	float						m_TimestampPeriod;
+	uint64_t					m_TimestampMask;
+
+	FrameContext				m_Frames[VULKAN_FRAMES_IN_FLIGHT];
+	uint32_t					m_FrameIndex;
+	uint64_t					m_FrameNum;
+
+	std::vector<VkFence>		m_ImageFences;		// fence of the frame that last rendered to swapchain image
+
+	VulkanFrameStats			m_Stats;
+};
+
+extern VulkanFrameManager* frameManager;
@@ -0,0 +1,399 @@
+/*
+*	Copyright 2015-2016 Tomas Mikalauskas. All rights reserved.
+*	GitHub repository - https://github.com/TywyllSoftware/TywRenderer
+*	This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+#include <RendererPch/stdafx.h>
+
+//Vulkan Includes
+#include "VulkanGpuProfiler.h"
+#include "VulkanTools.h"
+
+//ImGui Includes
+#include "ThirdParty/ImGui/imgui.h"
+
+
+static const uint32_t GPU_PROFILER_MAX_SCOPES = 256;
+static const uint32_t GPU_PROFILER_MAX_TRACE_EVENTS = 1 << 18;
+
+//Weight of the newest execution in the moving average
+static const double GPU_PROFILER_AVG_WEIGHT = 0.1;
+
+static const VkQueryPipelineStatisticFlags GPU_PROFILER_STATISTICS =
+	VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_VERTICES_BIT |
+	VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_PRIMITIVES_BIT |
+	VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT |
+	VK_QUERY_PIPELINE_STATISTIC_CLIPPING_PRIMITIVES_BIT |
+	VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT |
+	VK_QUERY_PIPELINE_STATISTIC_COMPUTE_SHADER_INVOCATIONS_BIT;
+
+
+VulkanGpuProfiler::VulkanGpuProfiler(VkDevice device, uint32_t timestampValidBits, float timestampPeriod, bool bPipelineStatistics):
+	m_Device(device),
+	m_TimestampPool(VK_NULL_HANDLE),
+	m_StatisticsPool(VK_NULL_HANDLE),
+	m_TimestampPeriod(timestampPeriod),
+	m_bCapturing(false)
+{
+	m_TimestampMasks.push_back(GetTimestampMask(timestampValidBits));
+	m_QueueResults.push_back(VulkanGpuQueueResult{ "Graphics", 0.0, 0.0 });
+
+	if (timestampValidBits == 0)
+	{
+		return;
+	}
+
+	VkQueryPoolCreateInfo queryPoolInfo = {};
+	queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+	queryPoolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+	queryPoolInfo.queryCount = GPU_PROFILER_MAX_SCOPES * 2;
+	VK_CHECK_RESULT(vkCreateQueryPool(m_Device, &queryPoolInfo, nullptr, &m_TimestampPool));
+
+	if (bPipelineStatistics)
+	{
+		queryPoolInfo.queryType = VK_QUERY_TYPE_PIPELINE_STATISTICS;
+		queryPoolInfo.queryCount = GPU_PROFILER_MAX_SCOPES;
+		queryPoolInfo.pipelineStatistics = GPU_PROFILER_STATISTICS;
+		VK_CHECK_RESULT(vkCreateQueryPool(m_Device, &queryPoolInfo, nullptr, &m_StatisticsPool));
+	}
+}
+
+
+VulkanGpuProfiler::~VulkanGpuProfiler()
+{
+	//Recorded command buffers may still write the queries
+	VK_CHECK_RESULT(vkDeviceWaitIdle(m_Device));
+
+	if (m_TimestampPool != VK_NULL_HANDLE)
+	{
+		vkDestroyQueryPool(m_Device, m_TimestampPool, nullptr);
+	}
+	if (m_StatisticsPool != VK_NULL_HANDLE)
+	{
+		vkDestroyQueryPool(m_Device, m_StatisticsPool, nullptr);
+	}
+}
+
+
+uint64_t VulkanGpuProfiler::GetTimestampMask(uint32_t timestampValidBits)
+{
+	return timestampValidBits >= 64 ? ~0ULL : ((1ULL << timestampValidBits) - 1);
+}
+
+
+uint32_t VulkanGpuProfiler::AddQueue(const char* name, uint32_t timestampValidBits)
+{
+	std::lock_guard<std::mutex> lock(m_Lock);
+	m_TimestampMasks.push_back(GetTimestampMask(timestampValidBits));
+	m_QueueResults.push_back(VulkanGpuQueueResult{ name, 0.0, 0.0 });
+	return static_cast<uint32_t>(m_QueueResults.size() - 1);
+}
+
+
+void VulkanGpuProfiler::SetQueue(VkCommandBuffer cmdBuffer, uint32_t queue)
+{
+	std::lock_guard<std::mutex> lock(m_Lock);
+	assert(queue < m_QueueResults.size());
+	m_CommandBufferQueues[cmdBuffer] = queue;
+}
+
+
+void VulkanGpuProfiler::BeginScope(VkCommandBuffer cmdBuffer, const char* name)
+{
+	if (!IsEnabled())
+	{
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(m_Lock);
+	std::vector<uint32_t>& openScopes = m_OpenScopes[cmdBuffer];
+
+	auto queueIt = m_CommandBufferQueues.find(cmdBuffer);
+	const uint32_t queue = (queueIt != m_CommandBufferQueues.end()) ? queueIt->second : 0;
+
+	//Graphics statistics can not be queried on compute only queues
+	const bool bPipelineStats = (m_StatisticsPool != VK_NULL_HANDLE) && openScopes.empty() && queue == 0;
+
+	//Find the innermost open scope that got a slot, it names the path
+	uint32_t parent = UINT32_MAX;
+	for (auto it = openScopes.rbegin(); it != openScopes.rend() && parent == UINT32_MAX; ++it)
+	{
+		parent = *it;
+	}
+	const std::string path = (parent == UINT32_MAX) ? std::string(name) : m_Results[m_Scopes[parent].resultIndex].name + "/" + name;
+
+	//Recording the same command buffer again reuses its queries
+	uint32_t slot;
+	auto slotIt = m_ScopeSlots.find(std::make_pair(cmdBuffer, path));
+	if (slotIt != m_ScopeSlots.end())
+	{
+		slot = slotIt->second;
+	}
+	else if (m_Scopes.size() < GPU_PROFILER_MAX_SCOPES && m_TimestampMasks[queue] != 0)
+	{
+		auto resultIt = m_ResultIndices.find(path);
+		if (resultIt == m_ResultIndices.end())
+		{
+			VulkanGpuScopeResult result = {};
+			result.name = path;
+			result.depth = static_cast<uint32_t>(std::count(path.begin(), path.end(), '/'));
+			result.queue = queue;
+			result.bPipelineStats = bPipelineStats;
+			resultIt = m_ResultIndices.insert(std::make_pair(path, static_cast<uint32_t>(m_Results.size()))).first;
+			m_Results.push_back(result);
+		}
+
+		Scope scope;
+		scope.resultIndex = resultIt->second;
+		scope.queue = queue;
+		scope.bPipelineStats = bPipelineStats;
+		scope.lastBegin = 0;
+		scope.lastEnd = 0;
+
+		slot = static_cast<uint32_t>(m_Scopes.size());
+		m_Scopes.push_back(scope);
+		m_ScopeSlots[std::make_pair(cmdBuffer, path)] = slot;
+	}
+	else
+	{
+		//Out of queries or no timestamps on the queue, EndScope has to skip this scope too
+		openScopes.push_back(UINT32_MAX);
+		return;
+	}
+
+	vkCmdResetQueryPool(cmdBuffer, m_TimestampPool, slot * 2, 2);
+	if (m_Scopes[slot].bPipelineStats)
+	{
+		vkCmdResetQueryPool(cmdBuffer, m_StatisticsPool, slot, 1);
+		vkCmdBeginQuery(cmdBuffer, m_StatisticsPool, slot, 0);
+	}
+	vkCmdWriteTimestamp(cmdBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, m_TimestampPool, slot * 2);
+
+	openScopes.push_back(slot);
+}
+
+
+void VulkanGpuProfiler::EndScope(VkCommandBuffer cmdBuffer)
+{
+	if (!IsEnabled())
+	{
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(m_Lock);
+	std::vector<uint32_t>& openScopes = m_OpenScopes[cmdBuffer];
+	assert(!openScopes.empty() && "EndScope without BeginScope");
+
+	const uint32_t slot = openScopes.back();
+	openScopes.pop_back();
+	if (slot == UINT32_MAX)
+	{
+		return;
+	}
+
+	vkCmdWriteTimestamp(cmdBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_TimestampPool, slot * 2 + 1);
+	if (m_Scopes[slot].bPipelineStats)
+	{
+		vkCmdEndQuery(cmdBuffer, m_StatisticsPool, slot);
+	}
+}
+
+
+void VulkanGpuProfiler::Update()
+{
+	if (!IsEnabled())
+	{
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(m_Lock);
+	std::vector<bool> resolvedQueues(m_QueueResults.size(), false);
+	for (uint32_t slot = 0; slot < m_Scopes.size(); slot++)
+	{
+		Scope& scope = m_Scopes[slot];
+
+		//Value and availability of begin and end query. VK_NOT_READY only means one of them has not finished
+		uint64_t timestamps[4] = {};
+		VkResult result = vkGetQueryPoolResults(m_Device, m_TimestampPool, slot * 2, 2, sizeof(timestamps), timestamps, sizeof(uint64_t) * 2,
+			VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+		if ((result != VK_SUCCESS && result != VK_NOT_READY) || timestamps[1] == 0 || timestamps[3] == 0 || timestamps[0] == scope.lastBegin)
+		{
+			continue;
+		}
+		scope.lastBegin = timestamps[0];
+		scope.lastEnd = timestamps[2];
+
+		VulkanGpuScopeResult& scopeResult = m_Results[scope.resultIndex];
+		const uint64_t ticks = (timestamps[2] - timestamps[0]) & m_TimestampMasks[scope.queue];
+		scopeResult.gpuMilliSec = ticks * static_cast<double>(m_TimestampPeriod) / 1000000.0;
+		scopeResult.avgMilliSec = (scopeResult.numSamples == 0) ? scopeResult.gpuMilliSec :
+			scopeResult.avgMilliSec + (scopeResult.gpuMilliSec - scopeResult.avgMilliSec) * GPU_PROFILER_AVG_WEIGHT;
+		scopeResult.numSamples++;
+
+		if (scope.bPipelineStats)
+		{
+			uint64_t statistics[GPU_STAT_COUNT + 1] = {};
+			result = vkGetQueryPoolResults(m_Device, m_StatisticsPool, slot, 1, sizeof(statistics), statistics, sizeof(statistics),
+				VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+			if (result == VK_SUCCESS && statistics[GPU_STAT_COUNT] != 0)
+			{
+				memcpy(scopeResult.pipelineStats, statistics, sizeof(scopeResult.pipelineStats));
+			}
+		}
+
+		if (m_bCapturing && m_TraceEvents.size() < GPU_PROFILER_MAX_TRACE_EVENTS)
+		{
+			m_TraceEvents.push_back({ scope.resultIndex, scope.queue, timestamps[0], timestamps[2] });
+		}
+
+		if (scopeResult.depth == 0)
+		{
+			resolvedQueues[scope.queue] = true;
+		}
+	}
+
+	if (m_QueueResults.size() > 1)
+	{
+		UpdateQueueResults(resolvedQueues);
+	}
+}
+
+
+void VulkanGpuProfiler::UpdateQueueResults(const std::vector<bool>& resolvedQueues)
+{
+	auto isTopLevel = [this](const Scope& scope, uint32_t queue)
+	{
+		return scope.queue == queue && scope.lastEnd != 0 && m_Results[scope.resultIndex].depth == 0;
+	};
+
+	//Latest execution of every top level scope against the latest ones of queue 0. Scopes of one
+	//queue do not overlap each other, so the intersections add up without counting anything twice
+	const double milliSecPerTick = static_cast<double>(m_TimestampPeriod) / 1000000.0;
+	for (uint32_t queue = 0; queue < m_QueueResults.size(); queue++)
+	{
+		if (!resolvedQueues[queue])
+			continue;
+
+		uint64_t busyTicks = 0;
+		uint64_t overlapTicks = 0;
+		for (const Scope& scope : m_Scopes)
+		{
+			if (!isTopLevel(scope, queue))
+				continue;
+
+			busyTicks += (scope.lastEnd - scope.lastBegin) & m_TimestampMasks[queue];
+			for (const Scope& other : m_Scopes)
+			{
+				if (queue == 0 || !isTopLevel(other, 0))
+					continue;
+
+				const uint64_t begin = std::max(scope.lastBegin, other.lastBegin);
+				const uint64_t end = std::min(scope.lastEnd, other.lastEnd);
+				overlapTicks += (end > begin) ? end - begin : 0;
+			}
+		}
+
+		VulkanGpuQueueResult& queueResult = m_QueueResults[queue];
+		queueResult.busyMilliSec += (busyTicks * milliSecPerTick - queueResult.busyMilliSec) * GPU_PROFILER_AVG_WEIGHT;
+		queueResult.overlapMilliSec += (overlapTicks * milliSecPerTick - queueResult.overlapMilliSec) * GPU_PROFILER_AVG_WEIGHT;
+	}
+}
+
+
+void VulkanGpuProfiler::DrawImGui()
+{
+	if (!IsEnabled())
+	{
+		ImGui::Text("GPU profiler: no timestamp support");
+		return;
+	}
+
+	for (const VulkanGpuScopeResult& result : m_Results)
+	{
+		const size_t leaf = result.name.find_last_of('/');
+		const char* pLeafName = result.name.c_str() + (leaf == std::string::npos ? 0 : leaf + 1);
+		ImGui::Text("%*s%s %.3f ms %s", result.depth * 2, "", pLeafName, result.avgMilliSec, (result.queue != 0) ? m_QueueResults[result.queue].name.c_str() : "");
+
+		if (result.bPipelineStats && result.numSamples > 0)
+		{
+			ImGui::Text("%*s  prims %llu vs %llu fs %llu", result.depth * 2, "",
+				static_cast<unsigned long long>(result.pipelineStats[GPU_STAT_IA_PRIMITIVES]),
+				static_cast<unsigned long long>(result.pipelineStats[GPU_STAT_VS_INVOCATIONS]),
+				static_cast<unsigned long long>(result.pipelineStats[GPU_STAT_FS_INVOCATIONS]));
+		}
+	}
+
+	//Queue 0 has no overlap of its own, only the others are compared with it
+	for (uint32_t queue = 1; queue < m_QueueResults.size(); queue++)
+	{
+		const VulkanGpuQueueResult& queueResult = m_QueueResults[queue];
+		ImGui::Text("%s queue %.3f ms, %.3f ms next to %s", queueResult.name.c_str(), queueResult.busyMilliSec,
+			queueResult.overlapMilliSec, m_QueueResults[0].name.c_str());
+	}
+
+	if (!m_bCapturing)
+	{
+		if (ImGui::Button("Capture GPU trace"))
+		{
+			BeginCapture();
+		}
+	}
+	else if (ImGui::Button("Save GpuTrace.json"))
+	{
+		EndCapture("GpuTrace.json");
+	}
+}
+
+
+void VulkanGpuProfiler::BeginCapture()
+{
+	std::lock_guard<std::mutex> lock(m_Lock);
+	m_TraceEvents.clear();
+	m_bCapturing = true;
+}
+
+
+bool VulkanGpuProfiler::EndCapture(const std::string& fileName)
+{
+	std::lock_guard<std::mutex> lock(m_Lock);
+	m_bCapturing = false;
+
+	FILE* pFile = fopen(fileName.c_str(), "w");
+	if (pFile == nullptr)
+	{
+		return false;
+	}
+
+	//Timestamps are relative to the first captured execution of any queue, in microseconds
+	uint64_t base = m_TraceEvents.empty() ? 0 : m_TraceEvents.front().begin;
+	for (const TraceEvent& event : m_TraceEvents)
+	{
+		base = std::min(base, event.begin);
+	}
+	const double microSecPerTick = m_TimestampPeriod / 1000.0;
+
+	//One row per queue, overlapping work shows up side by side
+	fprintf(pFile, "{\"traceEvents\":[\n");
+	for (uint32_t queue = 0; queue < m_QueueResults.size(); queue++)
+	{
+		fprintf(pFile, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"%s\"}}%s\n",
+			queue + 1, m_QueueResults[queue].name.c_str(), (queue + 1 < m_QueueResults.size() || !m_TraceEvents.empty()) ? "," : "");
+	}
+	for (size_t i = 0; i < m_TraceEvents.size(); i++)
+	{
+		const TraceEvent& event = m_TraceEvents[i];
+		const VulkanGpuScopeResult& result = m_Results[event.resultIndex];
+		const uint64_t mask = m_TimestampMasks[event.queue];
+
+		const double ts = ((event.begin - base) & mask) * microSecPerTick;
+		const double dur = ((event.end - event.begin) & mask) * microSecPerTick;
+		fprintf(pFile, "{\"name\":\"%s\",\"cat\":\"gpu\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}%s\n",
+			result.name.c_str(), event.queue + 1, ts, dur, (i + 1 < m_TraceEvents.size()) ? "," : "");
+	}
+	fprintf(pFile, "],\"displayTimeUnit\":\"ms\"}\n");
+
+	const bool bWritten = ferror(pFile) == 0;
+	fclose(pFile);
+	m_TraceEvents.clear();
+	return bWritten;
+}
@@ -0,0 +1,184 @@
+/*
+*	Copyright 2015-2016 Tomas Mikalauskas. All rights reserved.
+*	GitHub repository - https://github.com/TywyllSoftware/TywRenderer
+*	This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+#pragma once
+#include <string>
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <mutex>
+#include <External/vulkan/vulkan.h>
+
+
+//Pipeline statistics gathered for top level scopes, in this order
+enum VulkanGpuPipelineStat
+{
+	GPU_STAT_IA_VERTICES,
+	GPU_STAT_IA_PRIMITIVES,
+	GPU_STAT_VS_INVOCATIONS,
+	GPU_STAT_CLIPPING_PRIMITIVES,
+	GPU_STAT_FS_INVOCATIONS,
+	GPU_STAT_CS_INVOCATIONS,
+	GPU_STAT_COUNT
+};
+
+
+struct VulkanGpuScopeResult
+{
+	std::string		name;							// path of nested scope names, "Frame/SSAO/Blur"
+	uint32_t		depth;							// nesting level, 0 for top level scopes
+	uint32_t		queue;							// profiler queue of the first execution, 0 is graphics
+	uint64_t		numSamples;						// resolved executions
+	double			gpuMilliSec;					// latest resolved execution
+	double			avgMilliSec;					// moving average
+	bool			bPipelineStats;
+	uint64_t		pipelineStats[GPU_STAT_COUNT];	// latest resolved execution, if bPipelineStats
+};
+
+
+struct VulkanGpuQueueResult
+{
+	std::string		name;
+	double			busyMilliSec;		// top level scopes, moving average
+	double			overlapMilliSec;	// part of busyMilliSec queue 0 was busy as well, moving average
+};
+
+
+/*
+	VulkanGpuProfiler
+	Named, nestable GPU scopes. BeginScope and EndScope write a timestamp pair
+	into the command buffer, top level scopes also run a pipeline statistics query.
+
+	Every scope of a command buffer owns its queries and resets them itself, so
+	scopes work in command buffers that are recorded once and submitted every frame
+	as well as in per frame ones. Update reads whatever finished since the last call
+	with VK_QUERY_RESULT_WITH_AVAILABILITY_BIT and never waits for the GPU.
+
+	Scopes have to be recorded outside render passes (query resets are not allowed
+	inside), so a scope measures one or more whole passes.
+
+	Command buffers of other queues (async compute) are assigned to a queue added
+	with AddQueue. Their scopes get their own trace row, and every queue reports how
+	long its top level scopes ran while queue 0 was busy too. Timestamps of different
+	queues are compared directly, which assumes one device clock for all queues.
+*/
+class VulkanGpuProfiler
+{
+public:
+	/*
+		@param: VkDevice device
+		@param: uint32_t timestampValidBits - of the graphics queue family, 0 disables the profiler
+		@param: float timestampPeriod - nanoseconds per tick
+		@param: bool bPipelineStatistics - device has pipelineStatisticsQuery enabled
+	*/
+	VulkanGpuProfiler(VkDevice device, uint32_t timestampValidBits, float timestampPeriod, bool bPipelineStatistics);
+	~VulkanGpuProfiler();
+
+	/*
+		@param: VkCommandBuffer cmdBuffer
+		@param: const char* name
+	*/
+	void BeginScope(VkCommandBuffer cmdBuffer, const char* name);
+
+	/*
+		Ends the innermost open scope of cmdBuffer
+
+		@param: VkCommandBuffer cmdBuffer
+	*/
+	void EndScope(VkCommandBuffer cmdBuffer);
+
+	/*
+		Queue 0 is the graphics queue the profiler was created for
+
+		@param: const char* name
+		@param: uint32_t timestampValidBits - of the queue family, 0 skips scopes on the queue
+		@return: uint32_t - queue index for SetQueue
+	*/
+	uint32_t AddQueue(const char* name, uint32_t timestampValidBits);
+
+	/*
+		Scopes recorded into cmdBuffer run on queue. Command buffers are on queue 0 by default
+
+		@param: VkCommandBuffer cmdBuffer
+		@param: uint32_t queue
+	*/
+	void SetQueue(VkCommandBuffer cmdBuffer, uint32_t queue);
+
+	//Once per frame. Resolves finished scopes without stalling
+	void Update();
+
+	/*
+		Results in order of first BeginScope. Scopes with the same path in
+		different command buffers share one result
+
+		@return: const std::vector<VulkanGpuScopeResult>&
+	*/
+	const std::vector<VulkanGpuScopeResult>& GetResults() const { return m_Results; }
+
+	// Index is the profiler queue
+	const std::vector<VulkanGpuQueueResult>& GetQueueResults() const { return m_QueueResults; }
+
+	//ImGui lines with scope times and the trace capture button. Call inside an ImGui window
+	void DrawImGui();
+
+	//Keeps every resolved scope execution until EndCapture
+	void BeginCapture();
+
+	/*
+		Writes captured executions as Chrome trace events (chrome://tracing)
+
+		@param: const std::string& fileName
+		@return: bool
+	*/
+	bool EndCapture(const std::string& fileName);
+
+	bool IsCapturing() const { return m_bCapturing; }
+	bool IsEnabled() const { return m_TimestampPool != VK_NULL_HANDLE; }
+
+private:
+	VulkanGpuProfiler(const VulkanGpuProfiler&) = delete;
+	VulkanGpuProfiler& operator=(const VulkanGpuProfiler&) = delete;
+
+	struct Scope
+	{
+		uint32_t		resultIndex;
+		uint32_t		queue;
+		bool			bPipelineStats;
+		uint64_t		lastBegin;		// timestamps of the last resolved execution
+		uint64_t		lastEnd;
+	};
+
+	struct TraceEvent
+	{
+		uint32_t		resultIndex;
+		uint32_t		queue;
+		uint64_t		begin;
+		uint64_t		end;
+	};
+
+	static uint64_t GetTimestampMask(uint32_t timestampValidBits);
+
+	//Busy and overlap time of queues that resolved a top level scope
+	void UpdateQueueResults(const std::vector<bool>& resolvedQueues);
+
+private:
+	VkDevice												m_Device;
+	VkQueryPool												m_TimestampPool;	// two queries per scope
+	VkQueryPool												m_StatisticsPool;	// one query per scope, VK_NULL_HANDLE if unsupported
+	float													m_TimestampPeriod;
+	std::vector<uint64_t>									m_TimestampMasks;	// per queue, 0 if the queue has no timestamps
+
+	std::mutex												m_Lock;				// recording threads
+	std::vector<Scope>										m_Scopes;			// index is the query slot
+	std::map<std::pair<VkCommandBuffer, std::string>, uint32_t>	m_ScopeSlots;
+	std::unordered_map<VkCommandBuffer, std::vector<uint32_t>>	m_OpenScopes;	// per command buffer nesting stack
+	std::unordered_map<VkCommandBuffer, uint32_t>			m_CommandBufferQueues;	// command buffers not on queue 0
+	std::map<std::string, uint32_t>							m_ResultIndices;
+	std::vector<VulkanGpuScopeResult>						m_Results;
+	std::vector<VulkanGpuQueueResult>						m_QueueResults;
+
+	bool													m_bCapturing;
+	std::vector<TraceEvent>									m_TraceEvents;
+};
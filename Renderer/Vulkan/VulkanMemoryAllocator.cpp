@@ -0,0 +1,673 @@
+/*
+*	Copyright 2015-2016 Tomas Mikalauskas. All rights reserved.
+*	GitHub repository - https://github.com/TywyllSoftware/TywRenderer
+*	This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+#include <RendererPch/stdafx.h>
+
+//Vulkan Includes
+#include "VulkanTools.h"
+#include "VulkanMemoryAllocator.h"
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+
+VulkanMemoryAllocator* memoryAllocator = nullptr;
+
+//Preferred size of a block. Small heaps use an eighth of the heap instead
+static const VkDeviceSize VULKAN_MEMORY_BLOCK_SIZE = 64ull * 1024 * 1024;
+
+//Part of a heap we let ourselves use when driver does not report a budget
+static const VkDeviceSize VULKAN_HEAP_BUDGET_PERCENT = 80;
+
+
+
+static uint32_t FindLastSet(uint64_t value)
+{
+#if defined(_MSC_VER)
+	unsigned long index;
+	_BitScanReverse64(&index, value);
+	return static_cast<uint32_t>(index);
+#else
+	return 63 - static_cast<uint32_t>(__builtin_clzll(value));
+#endif
+}
+
+
+static uint32_t FindFirstSet(uint64_t value)
+{
+#if defined(_MSC_VER)
+	unsigned long index;
+	_BitScanForward64(&index, value);
+	return static_cast<uint32_t>(index);
+#else
+	return static_cast<uint32_t>(__builtin_ctzll(value));
+#endif
+}
+
+
+static VkDeviceSize AlignUp(VkDeviceSize value, VkDeviceSize alignment)
+{
+	return (value + alignment - 1) / alignment * alignment;
+}
+
+
+
+VulkanMemoryAllocator::VulkanMemoryAllocator(VkPhysicalDevice physicalDevice, VkDevice device):
+	m_Device(device),
+	m_NumDeviceAllocations(0)
+{
+	vkGetPhysicalDeviceMemoryProperties(physicalDevice, &m_MemoryProperties);
+
+	VkPhysicalDeviceProperties deviceProperties;
+	vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
+	m_BufferImageGranularity = std::max<VkDeviceSize>(1, deviceProperties.limits.bufferImageGranularity);
+	m_MaxDeviceAllocations = deviceProperties.limits.maxMemoryAllocationCount;
+
+	for (uint32_t i = 0; i < VK_MAX_MEMORY_TYPES * RESOURCE_TILING_COUNT; i++)
+	{
+		m_Pools[i].memoryType = i / RESOURCE_TILING_COUNT;
+	}
+
+	for (uint32_t i = 0; i < VK_MAX_MEMORY_HEAPS; i++)
+	{
+		m_HeapUsage[i] = 0;
+	}
+}
+
+
+VulkanMemoryAllocator::~VulkanMemoryAllocator()
+{
+	uint32_t numLeaked = 0;
+	for (MemoryPool& pool : m_Pools)
+	{
+		for (MemoryBlock* pBlock : pool.blocks)
+		{
+			if (!pBlock)
+				continue;
+
+			numLeaked += pBlock->numAllocations;
+			DestroyBlock(pool.memoryType, pBlock);
+		}
+		pool.blocks.clear();
+	}
+
+	for (const DedicatedAllocation& dedicated : m_Dedicated)
+	{
+		if (dedicated.memory == VK_NULL_HANDLE)
+			continue;
+
+		numLeaked++;
+		FreeDeviceMemory(dedicated.memoryType, dedicated.size, dedicated.memory);
+	}
+
+	if (numLeaked > 0)
+	{
+		fprintf(stdout, "VulkanMemoryAllocator: %u allocations were not freed\n", numLeaked);
+	}
+}
+
+
+VkDeviceSize VulkanMemoryAllocator::GetBlockSize(uint32_t memoryType) const
+{
+	const VkDeviceSize heapSize = m_MemoryProperties.memoryHeaps[m_MemoryProperties.memoryTypes[memoryType].heapIndex].size;
+	return std::min(VULKAN_MEMORY_BLOCK_SIZE, AlignUp(heapSize / 8, 1024));
+}
+
+
+uint32_t VulkanMemoryAllocator::FindMemoryType(uint32_t typeBits, VkMemoryPropertyFlags properties) const
+{
+	for (uint32_t i = 0; i < m_MemoryProperties.memoryTypeCount; i++)
+	{
+		if ((typeBits & (1 << i)) && (m_MemoryProperties.memoryTypes[i].propertyFlags & properties) == properties)
+			return i;
+	}
+	return INVALID_NODE;
+}
+
+
+VkResult VulkanMemoryAllocator::AllocateDeviceMemory(uint32_t memoryType, VkDeviceSize size, VkDeviceMemory& memory, uint8_t** ppMapped)
+{
+	if (m_NumDeviceAllocations >= m_MaxDeviceAllocations)
+		return VK_ERROR_TOO_MANY_OBJECTS;
+
+	VkMemoryAllocateInfo memAlloc = VkTools::Initializer::MemoryAllocateInfo();
+	memAlloc.allocationSize = size;
+	memAlloc.memoryTypeIndex = memoryType;
+
+	VkResult result = vkAllocateMemory(m_Device, &memAlloc, nullptr, &memory);
+	if (result != VK_SUCCESS)
+		return result;
+
+	*ppMapped = nullptr;
+	if (m_MemoryProperties.memoryTypes[memoryType].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+	{
+		//Map once, vkMapMemory on memory that is already mapped is not allowed
+		result = vkMapMemory(m_Device, memory, 0, VK_WHOLE_SIZE, 0, reinterpret_cast<void**>(ppMapped));
+		if (result != VK_SUCCESS)
+		{
+			vkFreeMemory(m_Device, memory, nullptr);
+			return result;
+		}
+	}
+
+	m_NumDeviceAllocations++;
+	m_HeapUsage[m_MemoryProperties.memoryTypes[memoryType].heapIndex] += size;
+	return VK_SUCCESS;
+}
+
+
+void VulkanMemoryAllocator::FreeDeviceMemory(uint32_t memoryType, VkDeviceSize size, VkDeviceMemory memory)
+{
+	//Freeing memory implicitly unmaps it
+	vkFreeMemory(m_Device, memory, nullptr);
+
+	m_NumDeviceAllocations--;
+	m_HeapUsage[m_MemoryProperties.memoryTypes[memoryType].heapIndex] -= size;
+}
+
+
+VkResult VulkanMemoryAllocator::AllocateDedicated(uint32_t memoryType, VkDeviceSize size, VulkanAllocation& allocation)
+{
+	DedicatedAllocation dedicated;
+	dedicated.size = size;
+	dedicated.memoryType = memoryType;
+
+	uint8_t* pMapped;
+	VkResult result = AllocateDeviceMemory(memoryType, size, dedicated.memory, &pMapped);
+	if (result != VK_SUCCESS)
+		return result;
+
+	uint32_t index;
+	if (!m_UnusedDedicated.empty())
+	{
+		index = m_UnusedDedicated.back();
+		m_UnusedDedicated.pop_back();
+		m_Dedicated[index] = dedicated;
+	}
+	else
+	{
+		index = static_cast<uint32_t>(m_Dedicated.size());
+		m_Dedicated.push_back(dedicated);
+	}
+
+	allocation.memory = dedicated.memory;
+	allocation.offset = 0;
+	allocation.size = size;
+	allocation.pMapped = pMapped;
+	allocation.pool = memoryType * RESOURCE_TILING_COUNT;
+	allocation.block = VULKAN_DEDICATED_BLOCK;
+	allocation.node = index;
+	return VK_SUCCESS;
+}
+
+
+VkResult VulkanMemoryAllocator::Allocate(const VkMemoryRequirements& memReqs, VkMemoryPropertyFlags properties, VulkanResourceTiling tiling, bool bDedicated, VulkanAllocation& allocation)
+{
+	const uint32_t memoryType = FindMemoryType(memReqs.memoryTypeBits, properties);
+	if (memoryType == INVALID_NODE)
+		return VK_ERROR_FEATURE_NOT_PRESENT;
+
+	std::lock_guard<std::mutex> lock(m_Lock);
+
+	const VkDeviceSize blockSize = GetBlockSize(memoryType);
+	if (bDedicated || memReqs.size > blockSize / 2)
+		return AllocateDedicated(memoryType, memReqs.size, allocation);
+
+	//Without a granularity restriction buffers and images can share blocks
+	const uint32_t tilingIndex = m_BufferImageGranularity > 1 ? tiling : RESOURCE_TILING_LINEAR;
+	const uint32_t poolIndex = memoryType * RESOURCE_TILING_COUNT + tilingIndex;
+	MemoryPool& pool = m_Pools[poolIndex];
+
+	MemoryBlock* pBlock = nullptr;
+	uint32_t blockIndex = 0;
+	uint32_t node = INVALID_NODE;
+	VkDeviceSize offset = 0;
+	for (uint32_t i = 0; i < pool.blocks.size(); i++)
+	{
+		if (pool.blocks[i] && AllocateFromBlock(pool.blocks[i], memReqs.size, memReqs.alignment, node, offset))
+		{
+			pBlock = pool.blocks[i];
+			blockIndex = i;
+			break;
+		}
+	}
+
+	if (!pBlock)
+	{
+		pBlock = CreateBlock(memoryType, blockSize);
+		if (!pBlock)
+		{
+			//Heap may still fit the resource on its own
+			return AllocateDedicated(memoryType, memReqs.size, allocation);
+		}
+
+		//Reuse slot of a released block so indices of live allocations stay valid
+		blockIndex = static_cast<uint32_t>(std::find(pool.blocks.begin(), pool.blocks.end(), nullptr) - pool.blocks.begin());
+		if (blockIndex == pool.blocks.size())
+		{
+			pool.blocks.push_back(pBlock);
+		}
+		else
+		{
+			pool.blocks[blockIndex] = pBlock;
+		}
+
+		const bool bFits = AllocateFromBlock(pBlock, memReqs.size, memReqs.alignment, node, offset);
+		assert(bFits);
+	}
+
+	allocation.memory = pBlock->memory;
+	allocation.offset = offset;
+	allocation.size = memReqs.size;
+	allocation.pMapped = pBlock->pMapped ? pBlock->pMapped + offset : nullptr;
+	allocation.pool = poolIndex;
+	allocation.block = blockIndex;
+	allocation.node = node;
+	return VK_SUCCESS;
+}
+
+
+VkResult VulkanMemoryAllocator::AllocateBuffer(VkBuffer buffer, VkMemoryPropertyFlags properties, VulkanAllocation& allocation)
+{
+	VkMemoryRequirements memReqs;
+	vkGetBufferMemoryRequirements(m_Device, buffer, &memReqs);
+
+	VkResult result = Allocate(memReqs, properties, RESOURCE_TILING_LINEAR, false, allocation);
+	if (result != VK_SUCCESS)
+		return result;
+
+	return vkBindBufferMemory(m_Device, buffer, allocation.memory, allocation.offset);
+}
+
+
+VkResult VulkanMemoryAllocator::AllocateImage(VkImage image, VkMemoryPropertyFlags properties, VkImageTiling tiling, bool bDedicated, VulkanAllocation& allocation)
+{
+	VkMemoryRequirements memReqs;
+	vkGetImageMemoryRequirements(m_Device, image, &memReqs);
+
+	const VulkanResourceTiling resourceTiling = tiling == VK_IMAGE_TILING_LINEAR ? RESOURCE_TILING_LINEAR : RESOURCE_TILING_OPTIMAL;
+	VkResult result = Allocate(memReqs, properties, resourceTiling, bDedicated, allocation);
+	if (result != VK_SUCCESS)
+		return result;
+
+	return vkBindImageMemory(m_Device, image, allocation.memory, allocation.offset);
+}
+
+
+void VulkanMemoryAllocator::Free(VulkanAllocation& allocation)
+{
+	if (!allocation.IsValid())
+		return;
+
+	std::lock_guard<std::mutex> lock(m_Lock);
+
+	if (allocation.block == VULKAN_DEDICATED_BLOCK)
+	{
+		DedicatedAllocation& dedicated = m_Dedicated[allocation.node];
+		FreeDeviceMemory(dedicated.memoryType, dedicated.size, dedicated.memory);
+		dedicated.memory = VK_NULL_HANDLE;
+		m_UnusedDedicated.push_back(allocation.node);
+	}
+	else
+	{
+		MemoryPool& pool = m_Pools[allocation.pool];
+		MemoryBlock* pBlock = pool.blocks[allocation.block];
+		assert(pBlock && pBlock->memory == allocation.memory);
+		FreeToBlock(pBlock, allocation.node);
+
+		//Keep one empty block around so a pool does not thrash the driver
+		if (pBlock->numAllocations == 0)
+		{
+			uint32_t numBlocks = 0;
+			for (MemoryBlock* pOther : pool.blocks)
+			{
+				numBlocks += pOther ? 1 : 0;
+			}
+
+			if (numBlocks > 1)
+			{
+				DestroyBlock(pool.memoryType, pBlock);
+				pool.blocks[allocation.block] = nullptr;
+			}
+		}
+	}
+
+	allocation = VulkanAllocation();
+}
+
+
+VulkanMemoryStats VulkanMemoryAllocator::GetStats() const
+{
+	std::lock_guard<std::mutex> lock(m_Lock);
+
+	VulkanMemoryStats stats = {};
+	stats.numDeviceAllocations = m_NumDeviceAllocations;
+	stats.maxDeviceAllocations = m_MaxDeviceAllocations;
+
+	for (const MemoryPool& pool : m_Pools)
+	{
+		for (const MemoryBlock* pBlock : pool.blocks)
+		{
+			if (!pBlock)
+				continue;
+
+			stats.numBlocks++;
+			stats.numAllocations += pBlock->numAllocations;
+			stats.blockBytes += pBlock->size;
+			stats.usedBytes += pBlock->usedBytes;
+
+			for (const Node& node : pBlock->nodes)
+			{
+				if (!node.bFree)
+					continue;
+
+				stats.freeBytes += node.size;
+				stats.largestFreeRange = std::max(stats.largestFreeRange, node.size);
+			}
+		}
+	}
+
+	for (const DedicatedAllocation& dedicated : m_Dedicated)
+	{
+		if (dedicated.memory == VK_NULL_HANDLE)
+			continue;
+
+		stats.numDedicated++;
+		stats.numAllocations++;
+		stats.dedicatedBytes += dedicated.size;
+	}
+
+	if (stats.freeBytes > 0)
+	{
+		stats.fragmentation = 1.0f - static_cast<float>(static_cast<double>(stats.largestFreeRange) / static_cast<double>(stats.freeBytes));
+	}
+
+	stats.numHeaps = m_MemoryProperties.memoryHeapCount;
+	for (uint32_t i = 0; i < m_MemoryProperties.memoryHeapCount; i++)
+	{
+		stats.heaps[i].size = m_MemoryProperties.memoryHeaps[i].size;
+		stats.heaps[i].budget = m_MemoryProperties.memoryHeaps[i].size / 100 * VULKAN_HEAP_BUDGET_PERCENT;
+		stats.heaps[i].usage = m_HeapUsage[i];
+	}
+	return stats;
+}
+
+
+VulkanMemoryAllocator::MemoryBlock* VulkanMemoryAllocator::CreateBlock(uint32_t memoryType, VkDeviceSize size)
+{
+	VkDeviceMemory memory;
+	uint8_t* pMapped;
+	if (AllocateDeviceMemory(memoryType, size, memory, &pMapped) != VK_SUCCESS)
+		return nullptr;
+
+	MemoryBlock* pBlock = TYW_NEW MemoryBlock;
+	pBlock->memory = memory;
+	pBlock->size = size;
+	pBlock->usedBytes = 0;
+	pBlock->pMapped = pMapped;
+	pBlock->numAllocations = 0;
+	pBlock->flBitmap = 0;
+	for (uint32_t fl = 0; fl < FL_INDEX_COUNT; fl++)
+	{
+		pBlock->slBitmap[fl] = 0;
+		for (uint32_t sl = 0; sl < SL_INDEX_COUNT; sl++)
+		{
+			pBlock->freeHeads[fl][sl] = INVALID_NODE;
+		}
+	}
+
+	//Whole block starts as one free range
+	const uint32_t node = NewNode(pBlock);
+	pBlock->nodes[node].offset = 0;
+	pBlock->nodes[node].size = size;
+	InsertFree(pBlock, node);
+	return pBlock;
+}
+
+
+void VulkanMemoryAllocator::DestroyBlock(uint32_t memoryType, MemoryBlock* pBlock)
+{
+	FreeDeviceMemory(memoryType, pBlock->size, pBlock->memory);
+	SAFE_DELETE(pBlock);
+}
+
+
+void VulkanMemoryAllocator::Mapping(VkDeviceSize size, uint32_t& fl, uint32_t& sl)
+{
+	if (size < SL_INDEX_COUNT)
+	{
+		fl = 0;
+		sl = static_cast<uint32_t>(size);
+		return;
+	}
+
+	const uint32_t lastSet = FindLastSet(size);
+	fl = lastSet - SL_INDEX_COUNT_LOG2 + 1;
+	sl = static_cast<uint32_t>(size >> (lastSet - SL_INDEX_COUNT_LOG2)) ^ SL_INDEX_COUNT;
+}
+
+
+uint32_t VulkanMemoryAllocator::NewNode(MemoryBlock* pBlock)
+{
+	uint32_t node;
+	if (!pBlock->unusedNodes.empty())
+	{
+		node = pBlock->unusedNodes.back();
+		pBlock->unusedNodes.pop_back();
+	}
+	else
+	{
+		node = static_cast<uint32_t>(pBlock->nodes.size());
+		pBlock->nodes.push_back(Node());
+	}
+
+	Node& newNode = pBlock->nodes[node];
+	newNode.offset = 0;
+	newNode.size = 0;
+	newNode.prevPhysical = INVALID_NODE;
+	newNode.nextPhysical = INVALID_NODE;
+	newNode.prevFree = INVALID_NODE;
+	newNode.nextFree = INVALID_NODE;
+	newNode.bFree = false;
+	return node;
+}
+
+
+void VulkanMemoryAllocator::InsertFree(MemoryBlock* pBlock, uint32_t node)
+{
+	uint32_t fl, sl;
+	Mapping(pBlock->nodes[node].size, fl, sl);
+
+	Node& freeNode = pBlock->nodes[node];
+	freeNode.bFree = true;
+	freeNode.prevFree = INVALID_NODE;
+	freeNode.nextFree = pBlock->freeHeads[fl][sl];
+	if (freeNode.nextFree != INVALID_NODE)
+	{
+		pBlock->nodes[freeNode.nextFree].prevFree = node;
+	}
+
+	pBlock->freeHeads[fl][sl] = node;
+	pBlock->flBitmap |= 1ull << fl;
+	pBlock->slBitmap[fl] |= 1u << sl;
+}
+
+
+void VulkanMemoryAllocator::RemoveFree(MemoryBlock* pBlock, uint32_t node)
+{
+	uint32_t fl, sl;
+	Mapping(pBlock->nodes[node].size, fl, sl);
+
+	Node& freeNode = pBlock->nodes[node];
+	if (freeNode.prevFree != INVALID_NODE)
+	{
+		pBlock->nodes[freeNode.prevFree].nextFree = freeNode.nextFree;
+	}
+	if (freeNode.nextFree != INVALID_NODE)
+	{
+		pBlock->nodes[freeNode.nextFree].prevFree = freeNode.prevFree;
+	}
+
+	if (pBlock->freeHeads[fl][sl] == node)
+	{
+		pBlock->freeHeads[fl][sl] = freeNode.nextFree;
+		if (freeNode.nextFree == INVALID_NODE)
+		{
+			pBlock->slBitmap[fl] &= ~(1u << sl);
+			if (pBlock->slBitmap[fl] == 0)
+			{
+				pBlock->flBitmap &= ~(1ull << fl);
+			}
+		}
+	}
+
+	freeNode.bFree = false;
+	freeNode.prevFree = INVALID_NODE;
+	freeNode.nextFree = INVALID_NODE;
+}
+
+
+uint32_t VulkanMemoryAllocator::FindFree(MemoryBlock* pBlock, VkDeviceSize size)
+{
+	//Round up to the next list so any range found there is big enough
+	if (size >= SL_INDEX_COUNT)
+	{
+		size += (1ull << (FindLastSet(size) - SL_INDEX_COUNT_LOG2)) - 1;
+	}
+
+	uint32_t fl, sl;
+	Mapping(size, fl, sl);
+	if (fl >= FL_INDEX_COUNT)
+		return INVALID_NODE;
+
+	uint32_t slMap = pBlock->slBitmap[fl] & (~0u << sl);
+	if (slMap == 0)
+	{
+		const uint64_t flMap = pBlock->flBitmap & (~0ull << (fl + 1));
+		if (flMap == 0)
+			return INVALID_NODE;
+
+		fl = FindFirstSet(flMap);
+		slMap = pBlock->slBitmap[fl];
+	}
+
+	sl = FindFirstSet(slMap);
+	return pBlock->freeHeads[fl][sl];
+}
+
+
+bool VulkanMemoryAllocator::AllocateFromBlock(MemoryBlock* pBlock, VkDeviceSize size, VkDeviceSize alignment, uint32_t& node, VkDeviceSize& offset)
+{
+	alignment = std::max<VkDeviceSize>(1, alignment);
+
+	//Worst case padding is alignment - 1
+	const uint32_t index = FindFree(pBlock, size + alignment - 1);
+	if (index == INVALID_NODE)
+		return false;
+
+	RemoveFree(pBlock, index);
+
+	//Padding in front of the aligned offset goes back as its own free range
+	const VkDeviceSize alignedOffset = AlignUp(pBlock->nodes[index].offset, alignment);
+	const VkDeviceSize padding = alignedOffset - pBlock->nodes[index].offset;
+	if (padding > 0)
+	{
+		const uint32_t front = NewNode(pBlock);
+		Node& frontNode = pBlock->nodes[front];
+		Node& current = pBlock->nodes[index];
+
+		frontNode.offset = current.offset;
+		frontNode.size = padding;
+		frontNode.prevPhysical = current.prevPhysical;
+		frontNode.nextPhysical = index;
+		if (current.prevPhysical != INVALID_NODE)
+		{
+			pBlock->nodes[current.prevPhysical].nextPhysical = front;
+		}
+
+		current.prevPhysical = front;
+		current.offset = alignedOffset;
+		current.size -= padding;
+		InsertFree(pBlock, front);
+	}
+
+	//Split the tail unless it is too small to be worth tracking
+	if (pBlock->nodes[index].size - size >= MIN_SPLIT_SIZE)
+	{
+		const uint32_t back = NewNode(pBlock);
+		Node& backNode = pBlock->nodes[back];
+		Node& current = pBlock->nodes[index];
+
+		backNode.offset = current.offset + size;
+		backNode.size = current.size - size;
+		backNode.prevPhysical = index;
+		backNode.nextPhysical = current.nextPhysical;
+		if (current.nextPhysical != INVALID_NODE)
+		{
+			pBlock->nodes[current.nextPhysical].prevPhysical = back;
+		}
+
+		current.nextPhysical = back;
+		current.size = size;
+		InsertFree(pBlock, back);
+	}
+
+	pBlock->usedBytes += pBlock->nodes[index].size;
+	pBlock->numAllocations++;
+
+	node = index;
+	offset = alignedOffset;
+	return true;
+}
+
+
+void VulkanMemoryAllocator::FreeToBlock(MemoryBlock* pBlock, uint32_t node)
+{
+	assert(!pBlock->nodes[node].bFree);
+	pBlock->usedBytes -= pBlock->nodes[node].size;
+	pBlock->numAllocations--;
+
+	//Merge with the range in front
+	const uint32_t prev = pBlock->nodes[node].prevPhysical;
+	if (prev != INVALID_NODE && pBlock->nodes[prev].bFree)
+	{
+		RemoveFree(pBlock, prev);
+
+		Node& prevNode = pBlock->nodes[prev];
+		Node& current = pBlock->nodes[node];
+		prevNode.size += current.size;
+		prevNode.nextPhysical = current.nextPhysical;
+		if (current.nextPhysical != INVALID_NODE)
+		{
+			pBlock->nodes[current.nextPhysical].prevPhysical = prev;
+		}
+
+		current.size = 0;
+		pBlock->unusedNodes.push_back(node);
+		node = prev;
+	}
+
+	//Merge with the range behind
+	const uint32_t next = pBlock->nodes[node].nextPhysical;
+	if (next != INVALID_NODE && pBlock->nodes[next].bFree)
+	{
+		RemoveFree(pBlock, next);
+
+		Node& nextNode = pBlock->nodes[next];
+		Node& current = pBlock->nodes[node];
+		current.size += nextNode.size;
+		current.nextPhysical = nextNode.nextPhysical;
+		if (nextNode.nextPhysical != INVALID_NODE)
+		{
+			pBlock->nodes[nextNode.nextPhysical].prevPhysical = node;
+		}
+
+		nextNode.size = 0;
+		pBlock->unusedNodes.push_back(next);
+	}
+
+	InsertFree(pBlock, node);
+}
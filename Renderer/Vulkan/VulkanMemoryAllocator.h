@@ -0,0 +1,225 @@
+/*
+*	Copyright 2015-2016 Tomas Mikalauskas. All rights reserved.
+*	GitHub repository - https://github.com/TywyllSoftware/TywRenderer
+*	This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+#pragma once
+#include <vector>
+#include <mutex>
+#include <External/vulkan/vulkan.h>
+
+
+//VulkanAllocation::block of allocations that own their VkDeviceMemory
+static const uint32_t VULKAN_DEDICATED_BLOCK = 0xFFFFFFFF;
+
+
+/*
+	Piece of device memory handed out by VulkanMemoryAllocator.
+	memory is shared with other allocations unless the allocation is dedicated,
+	so always bind and map with offset and never call vkFreeMemory on it.
+*/
+struct VulkanAllocation
+{
+	VulkanAllocation(): memory(VK_NULL_HANDLE), offset(0), size(0), pMapped(nullptr), pool(0), block(0), node(0) {}
+	bool IsValid() const { return memory != VK_NULL_HANDLE; }
+
+	VkDeviceMemory	memory;
+	VkDeviceSize	offset;
+	VkDeviceSize	size;
+	void*			pMapped;	// persistently mapped pointer at offset, nullptr if not host visible
+
+	uint32_t		pool;
+	uint32_t		block;		// VULKAN_DEDICATED_BLOCK for dedicated allocations
+	uint32_t		node;
+};
+
+
+/*
+	Buffers and linear images must not share a bufferImageGranularity page
+	with optimal images, so they are sub-allocated from separate blocks.
+*/
+enum VulkanResourceTiling
+{
+	RESOURCE_TILING_LINEAR = 0,
+	RESOURCE_TILING_OPTIMAL,
+	RESOURCE_TILING_COUNT
+};
+
+
+struct VulkanMemoryHeapStats
+{
+	VkDeviceSize	size;			// heap size reported by the driver
+	VkDeviceSize	budget;			// part of the heap we allow ourselves to use
+	VkDeviceSize	usage;			// bytes allocated from the driver, blocks and dedicated
+};
+
+
+struct VulkanMemoryStats
+{
+	uint32_t		numDeviceAllocations;	// live vkAllocateMemory calls
+	uint32_t		maxDeviceAllocations;	// maxMemoryAllocationCount
+	uint32_t		numBlocks;
+	uint32_t		numDedicated;
+	uint32_t		numAllocations;			// sub-allocations plus dedicated
+
+	VkDeviceSize	blockBytes;
+	VkDeviceSize	usedBytes;				// sub-allocated bytes inside blocks
+	VkDeviceSize	dedicatedBytes;
+	VkDeviceSize	freeBytes;				// unused bytes inside blocks
+	VkDeviceSize	largestFreeRange;
+
+	// 0 when the free space is one range, close to 1 when it is scattered in small ranges
+	float			fragmentation;
+
+	uint32_t				numHeaps;
+	VulkanMemoryHeapStats	heaps[VK_MAX_MEMORY_HEAPS];
+};
+
+
+/*
+	VulkanMemoryAllocator
+	Reserves large VkDeviceMemory blocks per memory type and sub-allocates them
+	with a two level segregated fit (TLSF) allocator. Finding and releasing a range is
+	O(1), neighbour ranges are merged on free. Host visible blocks stay mapped
+	for their whole life.
+
+	Allocations bigger than half a block, or when asked for, get their own
+	VkDeviceMemory. Use it for render targets that are recreated on resize.
+	All functions are thread safe.
+*/
+class VulkanMemoryAllocator
+{
+public:
+	VulkanMemoryAllocator(VkPhysicalDevice physicalDevice, VkDevice device);
+	~VulkanMemoryAllocator();
+
+	/*
+		@param: const VkMemoryRequirements& memReqs
+		@param: VkMemoryPropertyFlags properties
+		@param: VulkanResourceTiling tiling
+		@param: bool bDedicated - give resource its own VkDeviceMemory
+		@param: VulkanAllocation& allocation
+		@return: VkResult
+	*/
+	VkResult Allocate(const VkMemoryRequirements& memReqs, VkMemoryPropertyFlags properties, VulkanResourceTiling tiling, bool bDedicated, VulkanAllocation& allocation);
+
+	/*
+		Allocates and binds memory for a buffer
+
+		@param: VkBuffer buffer
+		@param: VkMemoryPropertyFlags properties
+		@param: VulkanAllocation& allocation
+		@return: VkResult
+	*/
+	VkResult AllocateBuffer(VkBuffer buffer, VkMemoryPropertyFlags properties, VulkanAllocation& allocation);
+
+	/*
+		Allocates and binds memory for an image
+
+		@param: VkImage image
+		@param: VkMemoryPropertyFlags properties
+		@param: VkImageTiling tiling
+		@param: bool bDedicated
+		@param: VulkanAllocation& allocation
+		@return: VkResult
+	*/
+	VkResult AllocateImage(VkImage image, VkMemoryPropertyFlags properties, VkImageTiling tiling, bool bDedicated, VulkanAllocation& allocation);
+
+	/*
+		Returns range to its block. Allocation is reset
+
+		@param: VulkanAllocation& allocation
+	*/
+	void Free(VulkanAllocation& allocation);
+
+	VulkanMemoryStats GetStats() const;
+
+	VkDeviceSize GetBlockSize(uint32_t memoryType) const;
+
+private:
+	VulkanMemoryAllocator(const VulkanMemoryAllocator&) = delete;
+	VulkanMemoryAllocator& operator=(const VulkanMemoryAllocator&) = delete;
+
+	enum
+	{
+		SL_INDEX_COUNT_LOG2 = 4,
+		SL_INDEX_COUNT = 1 << SL_INDEX_COUNT_LOG2,
+		FL_INDEX_COUNT = 64 - SL_INDEX_COUNT_LOG2 + 1,
+		INVALID_NODE = 0xFFFFFFFF,
+		MIN_SPLIT_SIZE = 256
+	};
+
+	// Node is a range of a block, either free or allocated
+	struct Node
+	{
+		VkDeviceSize	offset;
+		VkDeviceSize	size;
+		uint32_t		prevPhysical;
+		uint32_t		nextPhysical;
+		uint32_t		prevFree;
+		uint32_t		nextFree;
+		bool			bFree;
+	};
+
+	struct MemoryBlock
+	{
+		VkDeviceMemory			memory;
+		VkDeviceSize			size;
+		VkDeviceSize			usedBytes;
+		uint8_t*				pMapped;
+		uint32_t				numAllocations;
+
+		std::vector<Node>		nodes;
+		std::vector<uint32_t>	unusedNodes;
+
+		uint64_t				flBitmap;
+		uint32_t				slBitmap[FL_INDEX_COUNT];
+		uint32_t				freeHeads[FL_INDEX_COUNT][SL_INDEX_COUNT];
+	};
+
+	// One pool per memory type and resource tiling
+	struct MemoryPool
+	{
+		uint32_t					memoryType;
+		std::vector<MemoryBlock*>	blocks;
+	};
+
+	struct DedicatedAllocation
+	{
+		VkDeviceMemory	memory;
+		VkDeviceSize	size;
+		uint32_t		memoryType;
+	};
+
+	uint32_t FindMemoryType(uint32_t typeBits, VkMemoryPropertyFlags properties) const;
+	VkResult AllocateDeviceMemory(uint32_t memoryType, VkDeviceSize size, VkDeviceMemory& memory, uint8_t** ppMapped);
+	void FreeDeviceMemory(uint32_t memoryType, VkDeviceSize size, VkDeviceMemory memory);
+	VkResult AllocateDedicated(uint32_t memoryType, VkDeviceSize size, VulkanAllocation& allocation);
+
+	MemoryBlock* CreateBlock(uint32_t memoryType, VkDeviceSize size);
+	void DestroyBlock(uint32_t memoryType, MemoryBlock* pBlock);
+	bool AllocateFromBlock(MemoryBlock* pBlock, VkDeviceSize size, VkDeviceSize alignment, uint32_t& node, VkDeviceSize& offset);
+	void FreeToBlock(MemoryBlock* pBlock, uint32_t node);
+
+	static void Mapping(VkDeviceSize size, uint32_t& fl, uint32_t& sl);
+	static uint32_t NewNode(MemoryBlock* pBlock);
+	static void InsertFree(MemoryBlock* pBlock, uint32_t node);
+	static void RemoveFree(MemoryBlock* pBlock, uint32_t node);
+	static uint32_t FindFree(MemoryBlock* pBlock, VkDeviceSize size);
+
+private:
+	VkDevice							m_Device;
+	VkPhysicalDeviceMemoryProperties	m_MemoryProperties;
+	VkDeviceSize						m_BufferImageGranularity;
+	uint32_t							m_MaxDeviceAllocations;
+
+	mutable std::mutex					m_Lock;
+	MemoryPool							m_Pools[VK_MAX_MEMORY_TYPES * RESOURCE_TILING_COUNT];
+	std::vector<DedicatedAllocation>	m_Dedicated;
+	std::vector<uint32_t>				m_UnusedDedicated;
+
+	uint32_t							m_NumDeviceAllocations;
+	VkDeviceSize						m_HeapUsage[VK_MAX_MEMORY_HEAPS];
+};
+
+extern VulkanMemoryAllocator* memoryAllocator;
@@ -1,4 +1,4 @@
-#include <RendererPch\stdafx.h>
+#include <RendererPch/stdafx.h>
 
 //Renderer Includes
 #include "VulkanMeshLoader.h"
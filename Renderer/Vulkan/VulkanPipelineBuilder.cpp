@@ -0,0 +1,222 @@
+/*
+*	Copyright 2015-2016 Tomas Mikalauskas. All rights reserved.
+*	GitHub repository - https://github.com/TywyllSoftware/TywRenderer
+*	This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+#include <RendererPch/stdafx.h>
+
+//Vulkan Includes
+#include "VulkanPipelineBuilder.h"
+#include "VulkanTools.h"
+
+//JobSystem Includes
+#include "JobSystem/JobSystem.h"
+
+//Profiler Includes
+#include "Profiler/CpuProfiler.h"
+
+
+/*
+	Own copy of a VkGraphicsPipelineCreateInfo. Pointers of createInfo point into this struct.
+	Not copyable, the pointers would dangle
+*/
+struct VulkanPipelineBuilder::PipelineDesc
+{
+	VkGraphicsPipelineCreateInfo						createInfo;
+	VkPipeline*											pPipeline;
+	uint64_t											createMicroSec;
+
+	std::vector<VkPipelineShaderStageCreateInfo>		stages;
+	std::vector<VkSpecializationInfo>					specializations;
+	std::vector<std::vector<VkSpecializationMapEntry>>	specializationEntries;
+	std::vector<std::vector<uint8_t>>					specializationData;
+
+	VkPipelineVertexInputStateCreateInfo				vertexInputState;
+	std::vector<VkVertexInputBindingDescription>		vertexBindings;
+	std::vector<VkVertexInputAttributeDescription>		vertexAttributes;
+
+	VkPipelineInputAssemblyStateCreateInfo				inputAssemblyState;
+	VkPipelineTessellationStateCreateInfo				tessellationState;
+
+	VkPipelineViewportStateCreateInfo					viewportState;
+	std::vector<VkViewport>								viewports;
+	std::vector<VkRect2D>								scissors;
+
+	VkPipelineRasterizationStateCreateInfo				rasterizationState;
+
+	VkPipelineMultisampleStateCreateInfo				multisampleState;
+	std::vector<VkSampleMask>							sampleMask;
+
+	VkPipelineDepthStencilStateCreateInfo				depthStencilState;
+
+	VkPipelineColorBlendStateCreateInfo					colorBlendState;
+	std::vector<VkPipelineColorBlendAttachmentState>	blendAttachments;
+
+	VkPipelineDynamicStateCreateInfo					dynamicState;
+	std::vector<VkDynamicState>							dynamicStates;
+};
+
+
+//Copies count elements behind ptr into storage and points ptr at the copy
+template<typename T>
+static void CopyArray(std::vector<T>& storage, const T*& ptr, uint32_t count)
+{
+	if (ptr == nullptr || count == 0)
+	{
+		return;
+	}
+	storage.assign(ptr, ptr + count);
+	ptr = storage.data();
+}
+
+
+VulkanPipelineBuilder::VulkanPipelineBuilder(VkDevice device, VkPipelineCache pipelineCache):
+	m_Device(device),
+	m_PipelineCache(pipelineCache)
+{
+}
+
+
+VulkanPipelineBuilder::~VulkanPipelineBuilder()
+{
+	assert(m_Pipelines.empty() && "Build was not called");
+}
+
+
+void VulkanPipelineBuilder::Add(const VkGraphicsPipelineCreateInfo& createInfo, VkPipeline* pPipeline)
+{
+	assert(createInfo.pNext == nullptr);
+	assert(pPipeline != nullptr);
+
+	std::unique_ptr<PipelineDesc> desc(TYW_NEW PipelineDesc);
+	PipelineDesc& d = *desc;
+	d.createInfo = createInfo;
+	d.pPipeline = pPipeline;
+	d.createMicroSec = 0;
+
+	//Shader stages and their specialization constants
+	CopyArray(d.stages, d.createInfo.pStages, createInfo.stageCount);
+	d.specializations.reserve(d.stages.size());
+	d.specializationEntries.reserve(d.stages.size());
+	d.specializationData.reserve(d.stages.size());
+	for (VkPipelineShaderStageCreateInfo& stage : d.stages)
+	{
+		assert(stage.pNext == nullptr);
+		if (stage.pSpecializationInfo == nullptr)
+		{
+			continue;
+		}
+
+		const VkSpecializationInfo& src = *stage.pSpecializationInfo;
+		d.specializations.push_back(src);
+		d.specializationEntries.emplace_back();
+		d.specializationData.emplace_back();
+
+		VkSpecializationInfo& dst = d.specializations.back();
+		CopyArray(d.specializationEntries.back(), dst.pMapEntries, src.mapEntryCount);
+		if (src.pData != nullptr && src.dataSize > 0)
+		{
+			const uint8_t* pBytes = static_cast<const uint8_t*>(src.pData);
+			d.specializationData.back().assign(pBytes, pBytes + src.dataSize);
+			dst.pData = d.specializationData.back().data();
+		}
+		stage.pSpecializationInfo = &dst;
+	}
+
+	if (createInfo.pVertexInputState)
+	{
+		d.vertexInputState = *createInfo.pVertexInputState;
+		CopyArray(d.vertexBindings, d.vertexInputState.pVertexBindingDescriptions, d.vertexInputState.vertexBindingDescriptionCount);
+		CopyArray(d.vertexAttributes, d.vertexInputState.pVertexAttributeDescriptions, d.vertexInputState.vertexAttributeDescriptionCount);
+		d.createInfo.pVertexInputState = &d.vertexInputState;
+	}
+
+	if (createInfo.pInputAssemblyState)
+	{
+		d.inputAssemblyState = *createInfo.pInputAssemblyState;
+		d.createInfo.pInputAssemblyState = &d.inputAssemblyState;
+	}
+
+	if (createInfo.pTessellationState)
+	{
+		d.tessellationState = *createInfo.pTessellationState;
+		d.createInfo.pTessellationState = &d.tessellationState;
+	}
+
+	if (createInfo.pViewportState)
+	{
+		d.viewportState = *createInfo.pViewportState;
+		CopyArray(d.viewports, d.viewportState.pViewports, d.viewportState.viewportCount);
+		CopyArray(d.scissors, d.viewportState.pScissors, d.viewportState.scissorCount);
+		d.createInfo.pViewportState = &d.viewportState;
+	}
+
+	if (createInfo.pRasterizationState)
+	{
+		d.rasterizationState = *createInfo.pRasterizationState;
+		d.createInfo.pRasterizationState = &d.rasterizationState;
+	}
+
+	if (createInfo.pMultisampleState)
+	{
+		d.multisampleState = *createInfo.pMultisampleState;
+		CopyArray(d.sampleMask, d.multisampleState.pSampleMask, (static_cast<uint32_t>(d.multisampleState.rasterizationSamples) + 31) / 32);
+		d.createInfo.pMultisampleState = &d.multisampleState;
+	}
+
+	if (createInfo.pDepthStencilState)
+	{
+		d.depthStencilState = *createInfo.pDepthStencilState;
+		d.createInfo.pDepthStencilState = &d.depthStencilState;
+	}
+
+	if (createInfo.pColorBlendState)
+	{
+		d.colorBlendState = *createInfo.pColorBlendState;
+		CopyArray(d.blendAttachments, d.colorBlendState.pAttachments, d.colorBlendState.attachmentCount);
+		d.createInfo.pColorBlendState = &d.colorBlendState;
+	}
+
+	if (createInfo.pDynamicState)
+	{
+		d.dynamicState = *createInfo.pDynamicState;
+		CopyArray(d.dynamicStates, d.dynamicState.pDynamicStates, d.dynamicState.dynamicStateCount);
+		d.createInfo.pDynamicState = &d.dynamicState;
+	}
+
+	m_Pipelines.push_back(std::move(desc));
+}
+
+
+VulkanPipelineBuildStats VulkanPipelineBuilder::Build()
+{
+	TYW_PROFILE_FUNCTION();
+	VulkanPipelineBuildStats stats;
+	memset(&stats, 0, sizeof(stats));
+	stats.numPipelines = static_cast<uint32_t>(m_Pipelines.size());
+	stats.numThreads = jobSystem ? jobSystem->GetThreadCount() : 1;
+
+	auto start = std::chrono::high_resolution_clock::now();
+
+	//One pipeline per job, compile times differ a lot between pipelines
+	ParallelFor(stats.numPipelines, 1, [this](uint32_t first, uint32_t last)
+	{
+		for (uint32_t i = first; i < last; i++)
+		{
+			TYW_PROFILE_SCOPE("vkCreateGraphicsPipelines");
+			PipelineDesc& d = *m_Pipelines[i];
+			auto pipelineStart = std::chrono::high_resolution_clock::now();
+			VK_CHECK_RESULT(vkCreateGraphicsPipelines(m_Device, m_PipelineCache, 1, &d.createInfo, nullptr, d.pPipeline));
+			d.createMicroSec = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - pipelineStart).count();
+		}
+	});
+
+	stats.wallMicroSec = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - start).count();
+	for (const auto& desc : m_Pipelines)
+	{
+		stats.serialMicroSec += desc->createMicroSec;
+	}
+
+	m_Pipelines.clear();
+	return stats;
+}
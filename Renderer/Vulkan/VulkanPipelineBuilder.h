@@ -0,0 +1,64 @@
+/*
+*	Copyright 2015-2016 Tomas Mikalauskas. All rights reserved.
+*	GitHub repository - https://github.com/TywyllSoftware/TywRenderer
+*	This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+#pragma once
+#include <vector>
+#include <memory>
+#include <External/vulkan/vulkan.h>
+
+
+struct VulkanPipelineBuildStats
+{
+	uint32_t		numPipelines;
+	uint32_t		numThreads;
+	uint64_t		wallMicroSec;		// Build call
+	uint64_t		serialMicroSec;		// sum of single pipeline times, what building on one thread would take
+};
+
+
+/*
+	VulkanPipelineBuilder
+	Collects graphics pipeline descriptions and creates them all at once on the
+	job system. Pipelines share one VkPipelineCache, which the driver synchronizes.
+
+	Add copies the create info together with every state it points to, so callers
+	can keep editing the same structs between Add calls, as the samples do for
+	consecutive vkCreateGraphicsPipelines calls. pNext chains are not supported.
+*/
+class VulkanPipelineBuilder
+{
+public:
+	/*
+		@param: VkDevice device
+		@param: VkPipelineCache pipelineCache
+	*/
+	VulkanPipelineBuilder(VkDevice device, VkPipelineCache pipelineCache);
+	~VulkanPipelineBuilder();
+
+	/*
+		@param: const VkGraphicsPipelineCreateInfo& createInfo
+		@param: VkPipeline* pPipeline - written by Build
+	*/
+	void Add(const VkGraphicsPipelineCreateInfo& createInfo, VkPipeline* pPipeline);
+
+	/*
+		Creates every added pipeline, returns when all of them exist.
+		Builder is empty afterwards and may be reused
+
+		@return: VulkanPipelineBuildStats
+	*/
+	VulkanPipelineBuildStats Build();
+
+private:
+	VulkanPipelineBuilder(const VulkanPipelineBuilder&) = delete;
+	VulkanPipelineBuilder& operator=(const VulkanPipelineBuilder&) = delete;
+
+	struct PipelineDesc;
+
+private:
+	VkDevice								m_Device;
+	VkPipelineCache							m_PipelineCache;
+	std::vector<std::unique_ptr<PipelineDesc>>	m_Pipelines;
+};
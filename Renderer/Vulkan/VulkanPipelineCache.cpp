@@ -0,0 +1,207 @@
+/*
+*	Copyright 2015-2016 Tomas Mikalauskas. All rights reserved.
+*	GitHub repository - https://github.com/TywyllSoftware/TywRenderer
+*	This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+#include <RendererPch/stdafx.h>
+
+//Vulkan Includes
+#include "VulkanPipelineCache.h"
+#include "VulkanTools.h"
+
+
+static const uint32_t PIPELINE_CACHE_MAGIC = 0x43505954;	// "TYPC"
+static const uint32_t PIPELINE_CACHE_VERSION = 1;
+
+
+static inline uint64_t ElapsedMicroSec(const std::chrono::high_resolution_clock::time_point& start)
+{
+	return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+
+/*
+=====
+ReplaceFile
+
+Moves src over dst in one step, so readers see either the old or the new file
+=====
+*/
+static bool ReplaceFile(const std::string& src, const std::string& dst)
+{
+#if defined(_WIN32)
+	return MoveFileExA(src.c_str(), dst.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+	return rename(src.c_str(), dst.c_str()) == 0;
+#endif
+}
+
+
+VulkanPipelineCache::VulkanPipelineCache():
+	m_Device(VK_NULL_HANDLE),
+	m_PipelineCache(VK_NULL_HANDLE),
+	m_LoadedHash(0)
+{
+	memset(&m_Properties, 0, sizeof(m_Properties));
+	memset(&m_Stats, 0, sizeof(m_Stats));
+}
+
+
+void VulkanPipelineCache::FillHeader(FileHeader& header) const
+{
+	memset(&header, 0, sizeof(header));
+	header.magic = PIPELINE_CACHE_MAGIC;
+	header.version = PIPELINE_CACHE_VERSION;
+	header.vendorID = m_Properties.vendorID;
+	header.deviceID = m_Properties.deviceID;
+	header.driverVersion = m_Properties.driverVersion;
+	memcpy(header.pipelineCacheUUID, m_Properties.pipelineCacheUUID, VK_UUID_SIZE);
+}
+
+
+VkPipelineCache VulkanPipelineCache::Create(VkDevice device, const VkPhysicalDeviceProperties& properties, const std::string& fileName)
+{
+	m_Device = device;
+	m_Properties = properties;
+	m_FileName = fileName;
+
+	auto start = std::chrono::high_resolution_clock::now();
+
+	std::vector<uint8_t> data;
+	FILE* pFile = fopen(m_FileName.c_str(), "rb");
+	if (pFile == nullptr)
+	{
+		m_Stats.missReason = "no cache file";
+	}
+	else
+	{
+		FileHeader expected;
+		FillHeader(expected);
+
+		//Payload size as stored on disk, a header claiming more is damaged
+		fseek(pFile, 0, SEEK_END);
+		const long fileSize = ftell(pFile);
+		fseek(pFile, 0, SEEK_SET);
+		const uint64_t payloadSize = fileSize > static_cast<long>(sizeof(FileHeader)) ? static_cast<uint64_t>(fileSize) - sizeof(FileHeader) : 0;
+
+		FileHeader header;
+		if (fread(&header, sizeof(header), 1, pFile) != 1 || header.magic != expected.magic || header.version != expected.version)
+		{
+			m_Stats.missReason = "unknown file format";
+		}
+		else if (header.vendorID != expected.vendorID || header.deviceID != expected.deviceID)
+		{
+			m_Stats.missReason = "different device";
+		}
+		else if (header.driverVersion != expected.driverVersion || memcmp(header.pipelineCacheUUID, expected.pipelineCacheUUID, VK_UUID_SIZE) != 0)
+		{
+			m_Stats.missReason = "different driver";
+		}
+		else if (header.dataSize == 0 || header.dataSize > payloadSize)
+		{
+			m_Stats.missReason = "damaged file";
+		}
+		else
+		{
+			data.resize(static_cast<size_t>(header.dataSize));
+			if (data.empty() || fread(data.data(), 1, data.size(), pFile) != data.size() || VkTools::HashBytes(data.data(), data.size()) != header.dataHash)
+			{
+				m_Stats.missReason = "damaged file";
+				data.clear();
+			}
+			else
+			{
+				m_LoadedHash = header.dataHash;
+			}
+		}
+		fclose(pFile);
+	}
+
+	VkPipelineCacheCreateInfo pipelineCacheCreateInfo = {};
+	pipelineCacheCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+	pipelineCacheCreateInfo.initialDataSize = data.size();
+	pipelineCacheCreateInfo.pInitialData = data.empty() ? nullptr : data.data();
+
+	//Driver checks its own header again and ignores data it does not like
+	VkResult result = vkCreatePipelineCache(m_Device, &pipelineCacheCreateInfo, nullptr, &m_PipelineCache);
+	if (result != VK_SUCCESS && !data.empty())
+	{
+		m_Stats.missReason = "rejected by driver";
+		m_LoadedHash = 0;
+		data.clear();
+		pipelineCacheCreateInfo.initialDataSize = 0;
+		pipelineCacheCreateInfo.pInitialData = nullptr;
+		result = vkCreatePipelineCache(m_Device, &pipelineCacheCreateInfo, nullptr, &m_PipelineCache);
+	}
+	VK_CHECK_RESULT(result);
+
+	m_Stats.bWarm = !data.empty();
+	m_Stats.loadedBytes = data.size();
+	m_Stats.loadMicroSec = ElapsedMicroSec(start);
+	return m_PipelineCache;
+}
+
+
+bool VulkanPipelineCache::Save()
+{
+	if (m_PipelineCache == VK_NULL_HANDLE)
+	{
+		return false;
+	}
+
+	auto start = std::chrono::high_resolution_clock::now();
+
+	size_t dataSize = 0;
+	VK_CHECK_RESULT(vkGetPipelineCacheData(m_Device, m_PipelineCache, &dataSize, nullptr));
+	if (dataSize == 0)
+	{
+		return true;
+	}
+
+	std::vector<uint8_t> data(dataSize);
+	VK_CHECK_RESULT(vkGetPipelineCacheData(m_Device, m_PipelineCache, &dataSize, data.data()));
+	data.resize(dataSize);
+
+	FileHeader header;
+	FillHeader(header);
+	header.dataSize = dataSize;
+	header.dataHash = VkTools::HashBytes(data.data(), data.size());
+
+	//Nothing new was compiled
+	if (header.dataHash == m_LoadedHash)
+	{
+		return true;
+	}
+
+	const std::string tempFileName = m_FileName + ".tmp";
+	FILE* pFile = fopen(tempFileName.c_str(), "wb");
+	if (pFile == nullptr)
+	{
+		return false;
+	}
+
+	bool bWritten = fwrite(&header, sizeof(header), 1, pFile) == 1 && fwrite(data.data(), 1, data.size(), pFile) == data.size();
+	bWritten = (fflush(pFile) == 0) && bWritten;
+	fclose(pFile);
+
+	if (!bWritten || !ReplaceFile(tempFileName, m_FileName))
+	{
+		remove(tempFileName.c_str());
+		return false;
+	}
+
+	m_LoadedHash = header.dataHash;
+	m_Stats.savedBytes = dataSize;
+	m_Stats.saveMicroSec = ElapsedMicroSec(start);
+	return true;
+}
+
+
+void VulkanPipelineCache::Destroy()
+{
+	if (m_PipelineCache != VK_NULL_HANDLE)
+	{
+		vkDestroyPipelineCache(m_Device, m_PipelineCache, nullptr);
+		m_PipelineCache = VK_NULL_HANDLE;
+	}
+}
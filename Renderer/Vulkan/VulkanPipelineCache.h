@@ -0,0 +1,85 @@
+/*
+*	Copyright 2015-2016 Tomas Mikalauskas. All rights reserved.
+*	GitHub repository - https://github.com/TywyllSoftware/TywRenderer
+*	This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+#pragma once
+#include <string>
+#include <External/vulkan/vulkan.h>
+
+
+struct VulkanPipelineCacheStats
+{
+	bool			bWarm;					// cache was created from valid data on disk
+	const char*		missReason;				// why the file was not used, nullptr when warm
+	uint64_t		loadedBytes;
+	uint64_t		savedBytes;				// 0 if nothing changed since load
+	uint64_t		loadMicroSec;
+	uint64_t		saveMicroSec;
+	uint64_t		pipelineCreateMicroSec;	// time spent creating pipelines at startup, set by the renderer
+};
+
+
+/*
+	VulkanPipelineCache
+	VkPipelineCache that survives application restarts. Create reads the cache file
+	and uses its data only if it was written by the same device and driver
+	(vendor, device, driver version and pipelineCacheUUID) and its checksum matches.
+	Anything else starts with an empty cache.
+
+	Save writes to a temporary file first and replaces the old file with it,
+	so a crash while saving never leaves a truncated cache behind.
+*/
+class VulkanPipelineCache
+{
+public:
+	VulkanPipelineCache();
+
+	/*
+		@param: VkDevice device
+		@param: const VkPhysicalDeviceProperties& properties
+		@param: const std::string& fileName
+		@return: VkPipelineCache
+	*/
+	VkPipelineCache Create(VkDevice device, const VkPhysicalDeviceProperties& properties, const std::string& fileName);
+
+	/*
+		Writes cache data to disk if it changed since it was loaded
+
+		@return: bool - false if the file could not be written
+	*/
+	bool Save();
+
+	//Destroys VkPipelineCache. Does not save
+	void Destroy();
+
+	void SetPipelineCreateTime(uint64_t microSec) { m_Stats.pipelineCreateMicroSec = microSec; }
+	VulkanPipelineCacheStats GetStats() const { return m_Stats; }
+
+private:
+	VulkanPipelineCache(const VulkanPipelineCache&) = delete;
+	VulkanPipelineCache& operator=(const VulkanPipelineCache&) = delete;
+
+	struct FileHeader
+	{
+		uint32_t	magic;
+		uint32_t	version;
+		uint32_t	vendorID;
+		uint32_t	deviceID;
+		uint32_t	driverVersion;
+		uint8_t		pipelineCacheUUID[VK_UUID_SIZE];
+		uint64_t	dataSize;
+		uint64_t	dataHash;
+	};
+
+	void FillHeader(FileHeader& header) const;
+
+private:
+	VkDevice					m_Device;
+	VkPipelineCache				m_PipelineCache;
+	VkPhysicalDeviceProperties	m_Properties;
+	std::string					m_FileName;
+	uint64_t					m_LoadedHash;
+
+	VulkanPipelineCacheStats	m_Stats;
+};
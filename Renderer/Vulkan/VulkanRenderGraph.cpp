@@ -0,0 +1,741 @@
+/*
+*	Copyright 2015-2016 Tomas Mikalauskas. All rights reserved.
+*	GitHub repository - https://github.com/TywyllSoftware/TywRenderer
+*	This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+#include <RendererPch/stdafx.h>
+
+//Vulkan Includes
+#include "VulkanRenderGraph.h"
+#include "VulkanTools.h"
+
+
+static const uint32_t RENDER_GRAPH_NONE = UINT32_MAX;
+
+
+static VkDeviceSize AlignUp(VkDeviceSize value, VkDeviceSize alignment)
+{
+	return (value + alignment - 1) / alignment * alignment;
+}
+
+
+VulkanRenderGraph::VulkanRenderGraph(VkDevice device, uint32_t queueFamily):
+	m_Device(device),
+	m_QueueFamily(queueFamily),
+	m_LastPass(RENDER_GRAPH_NONE),
+	m_bCompiled(false)
+{
+	memset(&m_Stats, 0, sizeof(m_Stats));
+}
+
+
+VulkanRenderGraph::~VulkanRenderGraph()
+{
+	for (Pass& pass : m_Passes)
+	{
+		if (pass.framebuffer != VK_NULL_HANDLE)
+			vkDestroyFramebuffer(m_Device, pass.framebuffer, nullptr);
+		if (pass.renderPass != VK_NULL_HANDLE)
+			vkDestroyRenderPass(m_Device, pass.renderPass, nullptr);
+	}
+
+	for (Image& image : m_Images)
+	{
+		if (image.view != VK_NULL_HANDLE)
+			vkDestroyImageView(m_Device, image.view, nullptr);
+		if (image.image != VK_NULL_HANDLE)
+			vkDestroyImage(m_Device, image.image, nullptr);
+	}
+
+	for (MemoryGroup& group : m_Groups)
+	{
+		memoryAllocator->Free(group.allocation);
+	}
+}
+
+
+uint32_t VulkanRenderGraph::CreateImage(const std::string& name, VkFormat format, uint32_t width, uint32_t height)
+{
+	assert(!m_bCompiled);
+
+	Image image = {};
+	image.name = name;
+	image.format = format;
+	image.width = width;
+	image.height = height;
+	image.bExported = false;
+	image.firstPass = RENDER_GRAPH_NONE;
+	image.group = RENDER_GRAPH_NONE;
+	image.image = VK_NULL_HANDLE;
+	image.view = VK_NULL_HANDLE;
+	m_Images.push_back(image);
+	return static_cast<uint32_t>(m_Images.size() - 1);
+}
+
+
+uint32_t VulkanRenderGraph::AddPass(const std::string& name)
+{
+	assert(!m_bCompiled);
+
+	Pass pass = {};
+	pass.name = name;
+	pass.bCulled = false;
+	pass.bCompute = false;
+	pass.queueFamily = m_QueueFamily;
+	pass.renderPass = VK_NULL_HANDLE;
+	pass.framebuffer = VK_NULL_HANDLE;
+	m_Passes.push_back(pass);
+	return static_cast<uint32_t>(m_Passes.size() - 1);
+}
+
+
+uint32_t VulkanRenderGraph::AddComputePass(const std::string& name, uint32_t queueFamily)
+{
+	//Ownership transfers need to know the family raster passes run on
+	assert(queueFamily == VK_QUEUE_FAMILY_IGNORED || m_QueueFamily != VK_QUEUE_FAMILY_IGNORED);
+
+	const uint32_t pass = AddPass(name);
+	m_Passes[pass].bCompute = true;
+	if (queueFamily != VK_QUEUE_FAMILY_IGNORED)
+	{
+		m_Passes[pass].queueFamily = queueFamily;
+	}
+	return pass;
+}
+
+
+void VulkanRenderGraph::WriteColor(uint32_t pass, uint32_t image, const VkClearColorValue& clearValue)
+{
+	assert(!m_bCompiled && image < m_Images.size());
+
+	ImageAccess access = { image, IMAGE_USE_COLOR };
+	access.clearValue.color = clearValue;
+	m_Passes[pass].accesses.push_back(access);
+}
+
+
+void VulkanRenderGraph::WriteDepth(uint32_t pass, uint32_t image, const VkClearDepthStencilValue& clearValue)
+{
+	assert(!m_bCompiled && image < m_Images.size());
+
+	ImageAccess access = { image, IMAGE_USE_DEPTH };
+	access.clearValue.depthStencil = clearValue;
+	m_Passes[pass].accesses.push_back(access);
+}
+
+
+void VulkanRenderGraph::WriteStorage(uint32_t pass, uint32_t image)
+{
+	assert(!m_bCompiled && image < m_Images.size() && m_Passes[pass].bCompute);
+
+	ImageAccess access = { image, IMAGE_USE_STORAGE };
+	m_Passes[pass].accesses.push_back(access);
+}
+
+
+void VulkanRenderGraph::ReadTexture(uint32_t pass, uint32_t image)
+{
+	assert(!m_bCompiled && image < m_Images.size());
+
+	ImageAccess access = { image, IMAGE_USE_SAMPLED };
+	m_Passes[pass].accesses.push_back(access);
+}
+
+
+void VulkanRenderGraph::Export(uint32_t image)
+{
+	assert(!m_bCompiled);
+	m_Images[image].bExported = true;
+}
+
+
+void VulkanRenderGraph::Compile()
+{
+	assert(!m_bCompiled);
+	m_bCompiled = true;
+	m_Stats.numPasses = static_cast<uint32_t>(m_Passes.size());
+
+	CullPasses();
+	ComputeLifetimes();
+	CreateImages();
+	AliasImages();
+	CreateRenderPasses();
+	BuildBarriers();
+}
+
+
+bool VulkanRenderGraph::BeginPass(VkCommandBuffer cmdBuffer, uint32_t pass, VkSubpassContents contents)
+{
+	assert(m_bCompiled);
+	const Pass& graphPass = m_Passes[pass];
+	if (graphPass.bCulled)
+	{
+		return false;
+	}
+
+	if (!graphPass.barriers.empty())
+	{
+		vkCmdPipelineBarrier(cmdBuffer, graphPass.srcStages, graphPass.dstStages, 0, 0, nullptr, 0, nullptr,
+			static_cast<uint32_t>(graphPass.barriers.size()), graphPass.barriers.data());
+	}
+
+	if (graphPass.bCompute)
+	{
+		return true;
+	}
+
+	VkRenderPassBeginInfo renderPassBeginInfo = VkTools::Initializer::RenderPassBeginInfo();
+	renderPassBeginInfo.renderPass = graphPass.renderPass;
+	renderPassBeginInfo.framebuffer = graphPass.framebuffer;
+	renderPassBeginInfo.renderArea.offset.x = 0;
+	renderPassBeginInfo.renderArea.offset.y = 0;
+	renderPassBeginInfo.renderArea.extent = graphPass.extent;
+	renderPassBeginInfo.clearValueCount = static_cast<uint32_t>(graphPass.clearValues.size());
+	renderPassBeginInfo.pClearValues = graphPass.clearValues.data();
+	vkCmdBeginRenderPass(cmdBuffer, &renderPassBeginInfo, contents);
+	return true;
+}
+
+
+void VulkanRenderGraph::EndPass(VkCommandBuffer cmdBuffer, uint32_t pass)
+{
+	const Pass& graphPass = m_Passes[pass];
+	if (graphPass.bCulled)
+	{
+		return;
+	}
+
+	if (!graphPass.bCompute)
+	{
+		vkCmdEndRenderPass(cmdBuffer);
+	}
+
+	if (!graphPass.endBarriers.empty())
+	{
+		vkCmdPipelineBarrier(cmdBuffer, graphPass.endSrcStages, graphPass.endDstStages, 0, 0, nullptr, 0, nullptr,
+			static_cast<uint32_t>(graphPass.endBarriers.size()), graphPass.endBarriers.data());
+	}
+}
+
+
+void VulkanRenderGraph::AcquireExports(VkCommandBuffer cmdBuffer)
+{
+	assert(m_bCompiled);
+	if (m_ExportAcquires.empty())
+	{
+		return;
+	}
+
+	//Source stage matches the semaphore wait of the submit, readers are fragment shaders
+	vkCmdPipelineBarrier(cmdBuffer, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr,
+		static_cast<uint32_t>(m_ExportAcquires.size()), m_ExportAcquires.data());
+}
+
+
+void VulkanRenderGraph::CullPasses()
+{
+	//Walk back from exported images, a pass lives if something later reads what it writes
+	std::vector<bool> needed(m_Images.size());
+	for (uint32_t i = 0; i < m_Images.size(); i++)
+	{
+		needed[i] = m_Images[i].bExported;
+	}
+
+	for (uint32_t i = static_cast<uint32_t>(m_Passes.size()); i-- > 0;)
+	{
+		Pass& pass = m_Passes[i];
+		pass.bCulled = true;
+		for (const ImageAccess& access : pass.accesses)
+		{
+			if (access.use != IMAGE_USE_SAMPLED && needed[access.image])
+			{
+				pass.bCulled = false;
+			}
+		}
+
+		if (pass.bCulled)
+		{
+			m_Stats.numCulledPasses++;
+			continue;
+		}
+
+		if (m_LastPass == RENDER_GRAPH_NONE && pass.queueFamily == m_QueueFamily)
+		{
+			m_LastPass = i;
+		}
+		for (const ImageAccess& access : pass.accesses)
+		{
+			if (access.use == IMAGE_USE_SAMPLED)
+			{
+				needed[access.image] = true;
+			}
+		}
+	}
+}
+
+
+void VulkanRenderGraph::ComputeLifetimes()
+{
+	for (uint32_t i = 0; i < m_Passes.size(); i++)
+	{
+		if (m_Passes[i].bCulled)
+			continue;
+
+		for (const ImageAccess& access : m_Passes[i].accesses)
+		{
+			Image& image = m_Images[access.image];
+			if (image.firstPass == RENDER_GRAPH_NONE)
+			{
+				image.firstPass = i;
+			}
+			image.lastPass = i;
+
+			switch (access.use)
+			{
+			case IMAGE_USE_COLOR:	image.usage |= VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT; break;
+			case IMAGE_USE_DEPTH:	image.usage |= VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT; break;
+			case IMAGE_USE_STORAGE:	image.usage |= VK_IMAGE_USAGE_STORAGE_BIT; break;
+			case IMAGE_USE_SAMPLED:	image.usage |= VK_IMAGE_USAGE_SAMPLED_BIT; break;
+			}
+		}
+	}
+
+	//Exported images are read after the last pass
+	for (Image& image : m_Images)
+	{
+		if (image.bExported && image.firstPass != RENDER_GRAPH_NONE)
+		{
+			image.lastPass = static_cast<uint32_t>(m_Passes.size());
+			image.usage |= VK_IMAGE_USAGE_SAMPLED_BIT;
+		}
+	}
+}
+
+
+void VulkanRenderGraph::CreateImages()
+{
+	for (Image& image : m_Images)
+	{
+		if (image.firstPass == RENDER_GRAPH_NONE)
+			continue;
+
+		VkImageCreateInfo imageCreateInfo = VkTools::Initializer::ImageCreateInfo();
+		imageCreateInfo.imageType = VK_IMAGE_TYPE_2D;
+		imageCreateInfo.format = image.format;
+		imageCreateInfo.extent.width = image.width;
+		imageCreateInfo.extent.height = image.height;
+		imageCreateInfo.extent.depth = 1;
+		imageCreateInfo.mipLevels = 1;
+		imageCreateInfo.arrayLayers = 1;
+		imageCreateInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+		imageCreateInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+		imageCreateInfo.usage = image.usage;
+		imageCreateInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		VK_CHECK_RESULT(vkCreateImage(m_Device, &imageCreateInfo, nullptr, &image.image));
+
+		vkGetImageMemoryRequirements(m_Device, image.image, &image.memReqs);
+		m_Stats.numImages++;
+		m_Stats.transientBytes += image.memReqs.size;
+	}
+}
+
+
+void VulkanRenderGraph::AliasImages()
+{
+	//Biggest images first, smaller ones fill the holes between them
+	std::vector<uint32_t> order;
+	for (uint32_t i = 0; i < m_Images.size(); i++)
+	{
+		if (m_Images[i].image != VK_NULL_HANDLE)
+			order.push_back(i);
+	}
+	std::stable_sort(order.begin(), order.end(), [this](uint32_t a, uint32_t b) { return m_Images[a].memReqs.size > m_Images[b].memReqs.size; });
+
+	std::vector<uint32_t> placed;
+	for (uint32_t index : order)
+	{
+		Image& image = m_Images[index];
+
+		//Only images that accept the same memory types share an allocation
+		image.group = RENDER_GRAPH_NONE;
+		for (uint32_t i = 0; i < m_Groups.size(); i++)
+		{
+			if (m_Groups[i].memoryTypeBits == image.memReqs.memoryTypeBits)
+				image.group = i;
+		}
+		if (image.group == RENDER_GRAPH_NONE)
+		{
+			MemoryGroup group;
+			group.memoryTypeBits = image.memReqs.memoryTypeBits;
+			group.size = 0;
+			group.alignment = 1;
+			m_Groups.push_back(group);
+			image.group = static_cast<uint32_t>(m_Groups.size() - 1);
+		}
+
+		//Lowest offset that no image alive at the same time occupies
+		VkDeviceSize offset = 0;
+		bool bMoved = true;
+		while (bMoved)
+		{
+			bMoved = false;
+			for (uint32_t other : placed)
+			{
+				const Image& placedImage = m_Images[other];
+				const bool bSameTime = image.firstPass <= placedImage.lastPass && placedImage.firstPass <= image.lastPass;
+				const bool bSameMemory = offset < placedImage.memoryOffset + placedImage.memReqs.size && placedImage.memoryOffset < offset + image.memReqs.size;
+				if (placedImage.group == image.group && bSameTime && bSameMemory)
+				{
+					offset = AlignUp(placedImage.memoryOffset + placedImage.memReqs.size, image.memReqs.alignment);
+					bMoved = true;
+				}
+			}
+		}
+
+		image.memoryOffset = offset;
+		placed.push_back(index);
+
+		MemoryGroup& group = m_Groups[image.group];
+		group.size = std::max(group.size, offset + image.memReqs.size);
+		group.alignment = std::max(group.alignment, image.memReqs.alignment);
+	}
+
+	for (MemoryGroup& group : m_Groups)
+	{
+		VkMemoryRequirements memReqs;
+		memReqs.size = group.size;
+		memReqs.alignment = group.alignment;
+		memReqs.memoryTypeBits = group.memoryTypeBits;
+		VK_CHECK_RESULT(memoryAllocator->Allocate(memReqs, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, RESOURCE_TILING_OPTIMAL, true, group.allocation));
+		m_Stats.allocatedBytes += group.size;
+	}
+
+	for (uint32_t index : placed)
+	{
+		Image& image = m_Images[index];
+		const MemoryGroup& group = m_Groups[image.group];
+		VK_CHECK_RESULT(vkBindImageMemory(m_Device, image.image, group.allocation.memory, group.allocation.offset + image.memoryOffset));
+
+		VkImageViewCreateInfo imageView = VkTools::Initializer::ImageViewCreateInfo();
+		imageView.viewType = VK_IMAGE_VIEW_TYPE_2D;
+		imageView.format = image.format;
+		imageView.subresourceRange.aspectMask = GetAspectMask(image.format);
+		imageView.subresourceRange.baseMipLevel = 0;
+		imageView.subresourceRange.levelCount = 1;
+		imageView.subresourceRange.baseArrayLayer = 0;
+		imageView.subresourceRange.layerCount = 1;
+		imageView.image = image.image;
+		VK_CHECK_RESULT(vkCreateImageView(m_Device, &imageView, nullptr, &image.view));
+	}
+}
+
+
+void VulkanRenderGraph::CreateRenderPasses()
+{
+	for (uint32_t i = 0; i < m_Passes.size(); i++)
+	{
+		Pass& pass = m_Passes[i];
+		if (pass.bCulled)
+			continue;
+
+		if (pass.bCompute)
+		{
+			for (const ImageAccess& access : pass.accesses)
+			{
+				if (access.use == IMAGE_USE_STORAGE)
+				{
+					pass.extent.width = m_Images[access.image].width;
+					pass.extent.height = m_Images[access.image].height;
+				}
+			}
+			continue;
+		}
+
+		std::vector<VkAttachmentDescription> attachmentDescs;
+		std::vector<VkAttachmentReference> colorReferences;
+		std::vector<VkImageView> attachments;
+		VkAttachmentReference depthReference = { VK_ATTACHMENT_UNUSED, VK_IMAGE_LAYOUT_UNDEFINED };
+		pass.extent.width = 0;
+		pass.extent.height = 0;
+
+		//Colors first, depth is the last attachment. Layout transitions are done by the barriers of the pass
+		for (uint32_t depth = 0; depth < 2; depth++)
+		{
+			for (const ImageAccess& access : pass.accesses)
+			{
+				if (access.use != (depth ? IMAGE_USE_DEPTH : IMAGE_USE_COLOR))
+					continue;
+
+				const Image& image = m_Images[access.image];
+				const VkImageLayout layout = depth ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL : VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+				VkAttachmentDescription attachmentDesc = {};
+				attachmentDesc.format = image.format;
+				attachmentDesc.samples = VK_SAMPLE_COUNT_1_BIT;
+				attachmentDesc.loadOp = (image.firstPass == i) ? VK_ATTACHMENT_LOAD_OP_CLEAR : VK_ATTACHMENT_LOAD_OP_LOAD;
+				attachmentDesc.storeOp = (image.lastPass == i) ? VK_ATTACHMENT_STORE_OP_DONT_CARE : VK_ATTACHMENT_STORE_OP_STORE;
+				attachmentDesc.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+				attachmentDesc.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+				attachmentDesc.initialLayout = layout;
+				attachmentDesc.finalLayout = layout;
+
+				const VkAttachmentReference reference = { static_cast<uint32_t>(attachmentDescs.size()), layout };
+				if (depth)
+				{
+					assert(depthReference.attachment == VK_ATTACHMENT_UNUSED);
+					depthReference = reference;
+				}
+				else
+				{
+					colorReferences.push_back(reference);
+				}
+
+				attachmentDescs.push_back(attachmentDesc);
+				attachments.push_back(image.view);
+				pass.clearValues.push_back(access.clearValue);
+
+				assert(pass.extent.width == 0 || (pass.extent.width == image.width && pass.extent.height == image.height));
+				pass.extent.width = image.width;
+				pass.extent.height = image.height;
+			}
+		}
+		assert(!attachments.empty());
+
+		VkSubpassDescription subpass = {};
+		subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+		subpass.pColorAttachments = colorReferences.data();
+		subpass.colorAttachmentCount = static_cast<uint32_t>(colorReferences.size());
+		subpass.pDepthStencilAttachment = (depthReference.attachment != VK_ATTACHMENT_UNUSED) ? &depthReference : nullptr;
+
+		VkRenderPassCreateInfo renderPassInfo = VkTools::Initializer::RenderPassCreateInfo();
+		renderPassInfo.pAttachments = attachmentDescs.data();
+		renderPassInfo.attachmentCount = static_cast<uint32_t>(attachmentDescs.size());
+		renderPassInfo.subpassCount = 1;
+		renderPassInfo.pSubpasses = &subpass;
+		VK_CHECK_RESULT(vkCreateRenderPass(m_Device, &renderPassInfo, nullptr, &pass.renderPass));
+
+		VkFramebufferCreateInfo fbufCreateInfo = VkTools::Initializer::FramebufferCreateInfo();
+		fbufCreateInfo.renderPass = pass.renderPass;
+		fbufCreateInfo.pAttachments = attachments.data();
+		fbufCreateInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+		fbufCreateInfo.width = pass.extent.width;
+		fbufCreateInfo.height = pass.extent.height;
+		fbufCreateInfo.layers = 1;
+		VK_CHECK_RESULT(vkCreateFramebuffer(m_Device, &fbufCreateInfo, nullptr, &pass.framebuffer));
+	}
+}
+
+
+void VulkanRenderGraph::BuildBarriers()
+{
+	// Last access of every image, stages are all readers since the last write
+	struct ImageState
+	{
+		VkImageLayout			layout;
+		VkPipelineStageFlags	stages;
+		VkAccessFlags			writeAccess;	// not yet made visible
+		uint32_t				queueFamily;	// owner
+		uint32_t				pass;			// last pass that accessed it, releases it to other families
+	};
+	std::vector<ImageState> states(m_Images.size(), ImageState{ VK_IMAGE_LAYOUT_UNDEFINED, 0, 0, VK_QUEUE_FAMILY_IGNORED, RENDER_GRAPH_NONE });
+
+	auto makeBarrier = [this](uint32_t image, VkImageLayout oldLayout, VkImageLayout newLayout, VkAccessFlags srcAccess, VkAccessFlags dstAccess)
+	{
+		VkImageMemoryBarrier barrier = VkTools::Initializer::ImageMemoryBarrier();
+		barrier.srcAccessMask = srcAccess;
+		barrier.dstAccessMask = dstAccess;
+		barrier.oldLayout = oldLayout;
+		barrier.newLayout = newLayout;
+		barrier.image = m_Images[image].image;
+		barrier.subresourceRange = { GetAspectMask(m_Images[image].format), 0, 1, 0, 1 };
+		return barrier;
+	};
+
+	//Release at the end of the last pass on the old family, acquire with the same layouts before the pass
+	//on the new one. The semaphore between the two orders them, source stage of the acquire is its wait stage
+	auto transferOwnership = [this, &makeBarrier](uint32_t image, ImageState& state, VkImageLayout layout, VkAccessFlags dstAccess,
+		VkPipelineStageFlags dstStage, uint32_t dstFamily, std::vector<VkImageMemoryBarrier>& acquires)
+	{
+		Pass& releasePass = m_Passes[state.pass];
+		VkImageMemoryBarrier barrier = makeBarrier(image, state.layout, layout, state.writeAccess, 0);
+		barrier.srcQueueFamilyIndex = state.queueFamily;
+		barrier.dstQueueFamilyIndex = dstFamily;
+		releasePass.endBarriers.push_back(barrier);
+		releasePass.endSrcStages |= state.stages;
+		releasePass.endDstStages |= VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+
+		barrier.srcAccessMask = 0;
+		barrier.dstAccessMask = dstAccess;
+		acquires.push_back(barrier);
+		m_Stats.numOwnershipTransfers++;
+
+		state.layout = layout;
+		state.stages = dstStage;
+		state.writeAccess = 0;
+		state.queueFamily = dstFamily;
+	};
+
+	// Pass and barrier index of first uses, they wait for whoever used the memory before
+	struct FirstUse
+	{
+		uint32_t	pass;
+		uint32_t	barrier;
+		uint32_t	image;
+	};
+	std::vector<FirstUse> firstUses;
+
+	for (uint32_t i = 0; i < m_Passes.size(); i++)
+	{
+		Pass& pass = m_Passes[i];
+		if (pass.bCulled)
+			continue;
+
+		for (const ImageAccess& access : pass.accesses)
+		{
+			const Image& image = m_Images[access.image];
+			const bool bFirstUse = image.firstPass == i && states[access.image].layout == VK_IMAGE_LAYOUT_UNDEFINED;
+
+			VkImageLayout layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+			VkPipelineStageFlags stage = pass.bCompute ? VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT : VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+			VkAccessFlags dstAccess = VK_ACCESS_SHADER_READ_BIT;
+			VkAccessFlags writeAccess = 0;
+			if (access.use == IMAGE_USE_STORAGE)
+			{
+				layout = VK_IMAGE_LAYOUT_GENERAL;
+				writeAccess = VK_ACCESS_SHADER_WRITE_BIT;
+				dstAccess = bFirstUse ? writeAccess : writeAccess | VK_ACCESS_SHADER_READ_BIT;
+			}
+			else if (access.use == IMAGE_USE_COLOR)
+			{
+				layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+				stage = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+				writeAccess = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+				dstAccess = bFirstUse ? writeAccess : writeAccess | VK_ACCESS_COLOR_ATTACHMENT_READ_BIT;
+			}
+			else if (access.use == IMAGE_USE_DEPTH)
+			{
+				layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+				stage = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+				writeAccess = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+				dstAccess = writeAccess | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT;
+			}
+
+			ImageState& state = states[access.image];
+			if (bFirstUse)
+			{
+				//Contents are discarded, source stages are filled in below once every last use is known
+				firstUses.push_back(FirstUse{ i, static_cast<uint32_t>(pass.barriers.size()), access.image });
+				pass.barriers.push_back(makeBarrier(access.image, VK_IMAGE_LAYOUT_UNDEFINED, layout, 0, dstAccess));
+			}
+			else if (state.queueFamily != pass.queueFamily)
+			{
+				transferOwnership(access.image, state, layout, dstAccess, stage, pass.queueFamily, pass.barriers);
+				pass.srcStages |= stage;
+				pass.dstStages |= stage;
+				state.writeAccess = writeAccess;
+				state.pass = i;
+				continue;
+			}
+			else if (state.layout != layout || writeAccess != 0 || state.writeAccess != 0)
+			{
+				pass.barriers.push_back(makeBarrier(access.image, state.layout, layout, state.writeAccess, dstAccess));
+				pass.srcStages |= state.stages;
+			}
+			else
+			{
+				//Read after read in the same layout
+				state.stages |= stage;
+				state.pass = i;
+				continue;
+			}
+
+			pass.dstStages |= stage;
+			state.layout = layout;
+			state.stages = stage;
+			state.writeAccess = writeAccess;
+			state.queueFamily = pass.queueFamily;
+			state.pass = i;
+		}
+	}
+
+	//Exported images are handed over in a readable layout after the last pass, on the graph family
+	for (uint32_t i = 0; i < m_Images.size(); i++)
+	{
+		ImageState& state = states[i];
+		if (!m_Images[i].bExported || m_Images[i].image == VK_NULL_HANDLE)
+			continue;
+
+		if (state.queueFamily != m_QueueFamily)
+		{
+			transferOwnership(i, state, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_ACCESS_SHADER_READ_BIT,
+				VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, m_QueueFamily, m_ExportAcquires);
+			continue;
+		}
+
+		if (m_LastPass != RENDER_GRAPH_NONE)
+		{
+			Pass& lastPass = m_Passes[m_LastPass];
+			if (state.layout != VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL || state.writeAccess != 0)
+			{
+				lastPass.endBarriers.push_back(makeBarrier(i, state.layout, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, state.writeAccess, VK_ACCESS_SHADER_READ_BIT));
+				lastPass.endSrcStages |= state.stages;
+				lastPass.endDstStages |= VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+				state.stages = 0;
+			}
+			state.layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+			state.stages |= VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+			state.writeAccess = 0;
+		}
+	}
+
+	//First use waits for the last use of every image in the same memory, the previous frame included.
+	//Uses on other queue families are ordered by the semaphores between them instead
+	for (const FirstUse& firstUse : firstUses)
+	{
+		Pass& pass = m_Passes[firstUse.pass];
+		VkImageMemoryBarrier& barrier = pass.barriers[firstUse.barrier];
+		const Image& image = m_Images[firstUse.image];
+		for (uint32_t i = 0; i < m_Images.size(); i++)
+		{
+			const Image& other = m_Images[i];
+			if (other.image == VK_NULL_HANDLE || other.group != image.group || states[i].queueFamily != pass.queueFamily)
+				continue;
+
+			if (other.memoryOffset < image.memoryOffset + image.memReqs.size && image.memoryOffset < other.memoryOffset + other.memReqs.size)
+			{
+				pass.srcStages |= states[i].stages;
+				barrier.srcAccessMask |= states[i].writeAccess;
+			}
+		}
+	}
+
+	for (Pass& pass : m_Passes)
+	{
+		if (!pass.barriers.empty() && pass.srcStages == 0)
+			pass.srcStages = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+		if (!pass.endBarriers.empty() && pass.endSrcStages == 0)
+			pass.endSrcStages = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+
+		m_Stats.numBarriers += static_cast<uint32_t>(pass.barriers.size() + pass.endBarriers.size());
+	}
+}
+
+
+VkImageAspectFlags VulkanRenderGraph::GetAspectMask(VkFormat format)
+{
+	switch (format)
+	{
+	case VK_FORMAT_D16_UNORM:
+	case VK_FORMAT_X8_D24_UNORM_PACK32:
+	case VK_FORMAT_D32_SFLOAT:
+		return VK_IMAGE_ASPECT_DEPTH_BIT;
+	case VK_FORMAT_S8_UINT:
+		return VK_IMAGE_ASPECT_STENCIL_BIT;
+	case VK_FORMAT_D16_UNORM_S8_UINT:
+	case VK_FORMAT_D24_UNORM_S8_UINT:
+	case VK_FORMAT_D32_SFLOAT_S8_UINT:
+		return VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT;
+	default:
+		return VK_IMAGE_ASPECT_COLOR_BIT;
+	}
+}
@@ -0,0 +1,254 @@
+/*
+*	Copyright 2015-2016 Tomas Mikalauskas. All rights reserved.
+*	GitHub repository - https://github.com/TywyllSoftware/TywRenderer
+*	This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+#pragma once
+#include <string>
+#include <vector>
+#include <External/vulkan/vulkan.h>
+
+//Vulkan Includes
+#include "VulkanMemoryAllocator.h"
+
+
+struct VulkanRenderGraphStats
+{
+	uint32_t		numPasses;			// declared
+	uint32_t		numCulledPasses;
+	uint32_t		numImages;			// transient images that were created
+	uint32_t		numBarriers;		// image barriers recorded per frame
+	uint32_t		numOwnershipTransfers;	// release and acquire pairs between queue families
+	VkDeviceSize	transientBytes;		// what the images take in allocations of their own
+	VkDeviceSize	allocatedBytes;		// what they take aliased
+
+	VkDeviceSize GetSavedBytes() const { return transientBytes - allocatedBytes; }
+};
+
+
+/*
+	VulkanRenderGraph
+	Frame graph of raster and compute passes over transient images. Passes declare
+	which images they render to, write as storage images and sample, Compile then
+		- culls passes whose results nobody reads and that write no exported image
+		- creates render passes and framebuffers
+		- derives the image barriers and layout transitions between passes
+		- places images whose lifetimes do not overlap in the same memory
+
+	Transient images hold nothing between frames, every first write clears them.
+	Exported images stay alive until the end of the graph and are left in
+	SHADER_READ_ONLY_OPTIMAL, for passes that are recorded outside of it.
+
+	Passes run in the order they were added. Compute passes may run on a queue of
+	another family (async compute), images then get release and acquire barriers
+	whenever they move between families. The caller submits every run of passes of
+	one family on its own and puts a semaphore between them at every family switch.
+	Exports that end on another family are acquired with AcquireExports.
+*/
+class VulkanRenderGraph
+{
+public:
+	/*
+		@param: VkDevice device
+		@param: uint32_t queueFamily - of the queue raster passes are submitted to, only needed with compute passes on other families
+	*/
+	VulkanRenderGraph(VkDevice device, uint32_t queueFamily = VK_QUEUE_FAMILY_IGNORED);
+	~VulkanRenderGraph();
+
+	/*
+		@param: const std::string& name
+		@param: VkFormat format - color or depth format
+		@param: uint32_t width
+		@param: uint32_t height
+		@return: uint32_t - image handle
+	*/
+	uint32_t CreateImage(const std::string& name, VkFormat format, uint32_t width, uint32_t height);
+
+	/*
+		@param: const std::string& name
+		@return: uint32_t - pass handle
+	*/
+	uint32_t AddPass(const std::string& name);
+
+	/*
+		Pass without render pass. Writes storage images, extent is the one of them
+
+		@param: const std::string& name
+		@param: uint32_t queueFamily - VK_QUEUE_FAMILY_IGNORED runs it on the queue family of the graph
+		@return: uint32_t - pass handle
+	*/
+	uint32_t AddComputePass(const std::string& name, uint32_t queueFamily = VK_QUEUE_FAMILY_IGNORED);
+
+	/*
+		Color attachment, in call order. Clear value is used by the first write of a frame
+
+		@param: uint32_t pass
+		@param: uint32_t image
+		@param: const VkClearColorValue& clearValue
+	*/
+	void WriteColor(uint32_t pass, uint32_t image, const VkClearColorValue& clearValue);
+
+	/*
+		@param: uint32_t pass
+		@param: uint32_t image
+		@param: const VkClearDepthStencilValue& clearValue
+	*/
+	void WriteDepth(uint32_t pass, uint32_t image, const VkClearDepthStencilValue& clearValue);
+
+	/*
+		Storage image in GENERAL layout, compute passes only. Nothing is cleared
+
+		@param: uint32_t pass
+		@param: uint32_t image
+	*/
+	void WriteStorage(uint32_t pass, uint32_t image);
+
+	/*
+		Sampled in fragment shader, in compute shader for compute passes. Depth images
+		need a format without stencil
+
+		@param: uint32_t pass
+		@param: uint32_t image
+	*/
+	void ReadTexture(uint32_t pass, uint32_t image);
+
+	/*
+		Image is read after the graph, passes writing it are never culled
+
+		@param: uint32_t image
+	*/
+	void Export(uint32_t image);
+
+	/*
+		Creates images, memory, render passes and framebuffers. Call once,
+		after every pass was declared
+	*/
+	void Compile();
+
+	/*
+		Records barriers of the pass and begins its render pass. Compute passes
+		get the barriers only, dispatches follow
+
+		@param: VkCommandBuffer cmdBuffer - of a queue of the pass family
+		@param: uint32_t pass
+		@param: VkSubpassContents contents
+		@return: bool - false if the pass was culled, record nothing for it then
+	*/
+	bool BeginPass(VkCommandBuffer cmdBuffer, uint32_t pass, VkSubpassContents contents = VK_SUBPASS_CONTENTS_INLINE);
+
+	/*
+		Ends render pass. Exported images are transitioned after the last pass,
+		images moving to another queue family are released
+
+		@param: VkCommandBuffer cmdBuffer
+		@param: uint32_t pass
+	*/
+	void EndPass(VkCommandBuffer cmdBuffer, uint32_t pass);
+
+	/*
+		Acquires exports released by passes of other queue families. Record after the
+		last of those passes ran, on the queue family of the graph, before the exports are read
+
+		@param: VkCommandBuffer cmdBuffer
+	*/
+	void AcquireExports(VkCommandBuffer cmdBuffer);
+
+	bool IsCulled(uint32_t pass) const { return m_Passes[pass].bCulled; }
+
+	// Valid after Compile, VK_NULL_HANDLE for culled passes and unused images
+	VkRenderPass GetRenderPass(uint32_t pass) const { return m_Passes[pass].renderPass; }
+	VkFramebuffer GetFramebuffer(uint32_t pass) const { return m_Passes[pass].framebuffer; }
+	VkExtent2D GetExtent(uint32_t pass) const { return m_Passes[pass].extent; }
+	VkImage GetImage(uint32_t image) const { return m_Images[image].image; }
+	VkImageView GetImageView(uint32_t image) const { return m_Images[image].view; }
+
+	VulkanRenderGraphStats GetStats() const { return m_Stats; }
+
+private:
+	VulkanRenderGraph(const VulkanRenderGraph&) = delete;
+	VulkanRenderGraph& operator=(const VulkanRenderGraph&) = delete;
+
+	enum ImageUse
+	{
+		IMAGE_USE_COLOR = 0,
+		IMAGE_USE_DEPTH,
+		IMAGE_USE_STORAGE,
+		IMAGE_USE_SAMPLED
+	};
+
+	struct ImageAccess
+	{
+		uint32_t		image;
+		ImageUse		use;
+		VkClearValue	clearValue;
+	};
+
+	struct Pass
+	{
+		std::string						name;
+		std::vector<ImageAccess>		accesses;		// declaration order, colors keep theirs as attachment indices
+		bool							bCulled;
+		bool							bCompute;
+		uint32_t						queueFamily;
+
+		VkRenderPass					renderPass;		// VK_NULL_HANDLE for compute passes
+		VkFramebuffer					framebuffer;
+		VkExtent2D						extent;
+		std::vector<VkClearValue>		clearValues;	// per attachment
+
+		VkPipelineStageFlags			srcStages;
+		VkPipelineStageFlags			dstStages;
+		std::vector<VkImageMemoryBarrier>	barriers;		// before render pass
+		VkPipelineStageFlags			endSrcStages;
+		VkPipelineStageFlags			endDstStages;
+		std::vector<VkImageMemoryBarrier>	endBarriers;	// exports and queue family releases
+	};
+
+	struct Image
+	{
+		std::string				name;
+		VkFormat				format;
+		uint32_t				width;
+		uint32_t				height;
+		VkImageUsageFlags		usage;
+		bool					bExported;
+
+		uint32_t				firstPass;		// lifetime in passes that were not culled
+		uint32_t				lastPass;
+		VkDeviceSize			memoryOffset;	// in memory of its group
+		VkMemoryRequirements	memReqs;
+		uint32_t				group;
+
+		VkImage					image;
+		VkImageView				view;
+	};
+
+	// Images sharing one allocation
+	struct MemoryGroup
+	{
+		uint32_t				memoryTypeBits;
+		VkDeviceSize			size;
+		VkDeviceSize			alignment;
+		VulkanAllocation		allocation;
+	};
+
+	void CullPasses();
+	void ComputeLifetimes();
+	void CreateImages();
+	void AliasImages();
+	void CreateRenderPasses();
+	void BuildBarriers();
+
+	static VkImageAspectFlags GetAspectMask(VkFormat format);
+
+private:
+	VkDevice						m_Device;
+	uint32_t						m_QueueFamily;
+	std::vector<Pass>				m_Passes;
+	std::vector<Image>				m_Images;
+	std::vector<MemoryGroup>		m_Groups;
+	uint32_t						m_LastPass;		// last pass of the graph family that was not culled, records export barriers
+	std::vector<VkImageMemoryBarrier>	m_ExportAcquires;	// exports released by other queue families
+	bool							m_bCompiled;
+	VulkanRenderGraphStats			m_Stats;
+};
@@ -0,0 +1,178 @@
+/*
+*	Copyright 2015-2016 Tomas Mikalauskas. All rights reserved.
+*	GitHub repository - https://github.com/TywyllSoftware/TywRenderer
+*	This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+#include <RendererPch/stdafx.h>
+
+#if !defined(_WIN32)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+//Vulkan Includes
+#include "VulkanShaderRegistry.h"
+#include "VulkanTools.h"
+
+
+/*
+	Read only view of a whole file. SPIR-V is handed to the driver straight
+	from the mapping, without a heap copy
+*/
+class MappedFile
+{
+public:
+	MappedFile(): m_pData(nullptr), m_Size(0)
+#if defined(_WIN32)
+		, m_File(INVALID_HANDLE_VALUE), m_Mapping(nullptr)
+#endif
+	{
+	}
+
+	~MappedFile()
+	{
+#if defined(_WIN32)
+		if (m_pData) UnmapViewOfFile(m_pData);
+		if (m_Mapping) CloseHandle(m_Mapping);
+		if (m_File != INVALID_HANDLE_VALUE) CloseHandle(m_File);
+#else
+		if (m_pData) munmap(const_cast<void*>(m_pData), m_Size);
+#endif
+	}
+
+	bool Open(const std::string& fileName)
+	{
+#if defined(_WIN32)
+		m_File = CreateFileA(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (m_File == INVALID_HANDLE_VALUE)
+			return false;
+
+		LARGE_INTEGER size;
+		if (!GetFileSizeEx(m_File, &size) || size.QuadPart == 0)
+			return false;
+
+		m_Mapping = CreateFileMappingA(m_File, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (m_Mapping == nullptr)
+			return false;
+
+		m_pData = MapViewOfFile(m_Mapping, FILE_MAP_READ, 0, 0, 0);
+		m_Size = static_cast<size_t>(size.QuadPart);
+#else
+		int fd = open(fileName.c_str(), O_RDONLY);
+		if (fd < 0)
+			return false;
+
+		struct stat fileStat;
+		if (fstat(fd, &fileStat) != 0 || fileStat.st_size == 0)
+		{
+			close(fd);
+			return false;
+		}
+
+		void* pData = mmap(nullptr, static_cast<size_t>(fileStat.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+		close(fd);
+		if (pData == MAP_FAILED)
+			return false;
+
+		m_pData = pData;
+		m_Size = static_cast<size_t>(fileStat.st_size);
+#endif
+		return m_pData != nullptr;
+	}
+
+	const void*	Data() const { return m_pData; }
+	size_t		Size() const { return m_Size; }
+
+private:
+	const void*	m_pData;
+	size_t		m_Size;
+#if defined(_WIN32)
+	HANDLE		m_File;
+	HANDLE		m_Mapping;
+#endif
+};
+
+
+VulkanShaderRegistry::VulkanShaderRegistry(VkDevice device):
+	m_Device(device)
+{
+	memset(&m_Stats, 0, sizeof(m_Stats));
+}
+
+
+VulkanShaderRegistry::~VulkanShaderRegistry()
+{
+	for (const Module& module : m_Modules)
+	{
+		vkDestroyShaderModule(m_Device, module.module, nullptr);
+	}
+}
+
+
+VkShaderModule VulkanShaderRegistry::Load(const std::string& fileName)
+{
+	std::lock_guard<std::mutex> lock(m_Lock);
+	m_Stats.numRequests++;
+
+	auto pathIt = m_PathToModule.find(fileName);
+	if (pathIt != m_PathToModule.end())
+	{
+		m_Stats.numPathHits++;
+		return m_Modules[pathIt->second].module;
+	}
+
+	auto start = std::chrono::high_resolution_clock::now();
+
+	MappedFile file;
+	if (!file.Open(fileName) || (file.Size() % sizeof(uint32_t)) != 0)
+	{
+		return VK_NULL_HANDLE;
+	}
+	m_Stats.bytesMapped += file.Size();
+
+	//Same bytes under another name, compare contents too so a hash collision can not hand out a wrong shader
+	const uint64_t hash = VkTools::HashBytes(file.Data(), file.Size());
+	auto range = m_HashToModule.equal_range(hash);
+	for (auto it = range.first; it != range.second; ++it)
+	{
+		const Module& candidate = m_Modules[it->second];
+		if (candidate.codeSize == file.Size())
+		{
+			MappedFile other;
+			if (other.Open(candidate.fileName) && other.Size() == file.Size() && memcmp(other.Data(), file.Data(), file.Size()) == 0)
+			{
+				m_Stats.numContentHits++;
+				m_PathToModule[fileName] = it->second;
+				return m_Modules[it->second].module;
+			}
+		}
+	}
+
+	VkShaderModuleCreateInfo moduleCreateInfo = {};
+	moduleCreateInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+	moduleCreateInfo.codeSize = file.Size();
+	moduleCreateInfo.pCode = static_cast<const uint32_t*>(file.Data());
+
+	Module module;
+	module.codeSize = file.Size();
+	module.fileName = fileName;
+	VK_CHECK_RESULT(vkCreateShaderModule(m_Device, &moduleCreateInfo, nullptr, &module.module));
+
+	const uint32_t index = static_cast<uint32_t>(m_Modules.size());
+	m_Modules.push_back(module);
+	m_PathToModule[fileName] = index;
+	m_HashToModule.insert(std::make_pair(hash, index));
+
+	m_Stats.numModules++;
+	m_Stats.createMicroSec += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - start).count();
+	return module.module;
+}
+
+
+VulkanShaderRegistryStats VulkanShaderRegistry::GetStats() const
+{
+	std::lock_guard<std::mutex> lock(m_Lock);
+	return m_Stats;
+}
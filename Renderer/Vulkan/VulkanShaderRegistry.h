@@ -0,0 +1,71 @@
+/*
+*	Copyright 2015-2016 Tomas Mikalauskas. All rights reserved.
+*	GitHub repository - https://github.com/TywyllSoftware/TywRenderer
+*	This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+#pragma once
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <mutex>
+#include <External/vulkan/vulkan.h>
+
+
+struct VulkanShaderRegistryStats
+{
+	uint32_t		numRequests;		// Load calls
+	uint32_t		numPathHits;		// file was loaded before, not opened again
+	uint32_t		numContentHits;		// other file with identical SPIR-V already had a module
+	uint32_t		numModules;			// VkShaderModules created
+	uint64_t		bytesMapped;		// SPIR-V read from disk
+	uint64_t		createMicroSec;		// time spent mapping files and creating modules
+};
+
+
+/*
+	VulkanShaderRegistry
+	Creates every VkShaderModule once. Loading the same path again returns the
+	existing module without touching the file. A new path is memory mapped and
+	its SPIR-V hashed, so copies of a shader under another name share one module.
+
+	Registry owns the modules and destroys them together with itself. Load is locked
+	and may be called from pipeline builder jobs.
+*/
+class VulkanShaderRegistry
+{
+public:
+	/*
+		@param: VkDevice device
+	*/
+	explicit VulkanShaderRegistry(VkDevice device);
+	~VulkanShaderRegistry();
+
+	/*
+		@param: const std::string& fileName - SPIR-V file
+		@return: VkShaderModule - VK_NULL_HANDLE if file could not be read
+	*/
+	VkShaderModule Load(const std::string& fileName);
+
+	VulkanShaderRegistryStats GetStats() const;
+
+private:
+	VulkanShaderRegistry(const VulkanShaderRegistry&) = delete;
+	VulkanShaderRegistry& operator=(const VulkanShaderRegistry&) = delete;
+
+	struct Module
+	{
+		VkShaderModule		module;
+		size_t				codeSize;
+		std::string			fileName;	// file module was created from
+	};
+
+private:
+	VkDevice										m_Device;
+
+	mutable std::mutex								m_Lock;
+	std::vector<Module>								m_Modules;
+	std::unordered_map<std::string, uint32_t>		m_PathToModule;		// index into m_Modules
+	std::unordered_multimap<uint64_t, uint32_t>		m_HashToModule;
+
+	VulkanShaderRegistryStats						m_Stats;
+};
@@ -1,5 +1,5 @@
-#include "Vulkan\VulkanSwapChain.h"
-#include "Vulkan\VulkanTools.h"
+#include "Vulkan/VulkanSwapChain.h"
+#include "Vulkan/VulkanTools.h"
 
 
 
@@ -147,9 +147,91 @@ void VulkanSwapChain::Connect()
 	GET_DEVICE_PROC_ADDR(device, QueuePresentKHR);
 }
 
+// Renders into own images, for machines without a window system or display
+void VulkanSwapChain::InitHeadless(VkQueue queue, uint32_t queueFamilyIndex)
+{
+	headless = true;
+	headlessQueue = queue;
+	queueNodeIndex = queueFamilyIndex;
+	surface = VK_NULL_HANDLE;
+
+	// Same format a window surface usually has, so samples render the same way
+	VkFormatProperties formatProps;
+	vkGetPhysicalDeviceFormatProperties(physicalDevice, VK_FORMAT_B8G8R8A8_UNORM, &formatProps);
+	colorFormat = (formatProps.optimalTilingFeatures & VK_FORMAT_FEATURE_COLOR_ATTACHMENT_BIT) ? VK_FORMAT_B8G8R8A8_UNORM : VK_FORMAT_R8G8B8A8_UNORM;
+	colorSpace = VK_COLOR_SPACE_SRGB_NONLINEAR_KHR;
+}
+
+// Offscreen images in place of the swap chain ones
+static void CreateHeadlessImages(VulkanSwapChain& swapChain, uint32_t width, uint32_t height)
+{
+	VkResult err;
+
+	for (uint32_t i = 0; i < swapChain.images.size(); i++)
+	{
+		vkDestroyImageView(swapChain.device, swapChain.buffers[i].view, nullptr);
+		vkDestroyImage(swapChain.device, swapChain.images[i], nullptr);
+		memoryAllocator->Free(swapChain.headlessAllocations[i]);
+	}
+
+	// As many images as a mailbox swap chain, so frames in flight never wait for one
+	swapChain.imageCount = 3;
+	swapChain.images.resize(swapChain.imageCount);
+	swapChain.buffers.resize(swapChain.imageCount);
+	swapChain.headlessAllocations.resize(swapChain.imageCount);
+	swapChain.headlessImage = 0;
+
+	for (uint32_t i = 0; i < swapChain.imageCount; i++)
+	{
+		VkImageCreateInfo image = {};
+		image.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+		image.imageType = VK_IMAGE_TYPE_2D;
+		image.format = swapChain.colorFormat;
+		image.extent = { width, height, 1 };
+		image.mipLevels = 1;
+		image.arrayLayers = 1;
+		image.samples = VK_SAMPLE_COUNT_1_BIT;
+		image.tiling = VK_IMAGE_TILING_OPTIMAL;
+		image.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+		image.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		image.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+		err = vkCreateImage(swapChain.device, &image, nullptr, &swapChain.images[i]);
+		assert(!err);
+
+		// Recreated on resize like the depth buffer, keep them out of the shared blocks
+		err = memoryAllocator->AllocateImage(swapChain.images[i], VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, VK_IMAGE_TILING_OPTIMAL, true, swapChain.headlessAllocations[i]);
+		assert(!err);
+
+		VkImageViewCreateInfo colorAttachmentView = {};
+		colorAttachmentView.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+		colorAttachmentView.format = swapChain.colorFormat;
+		colorAttachmentView.components = {
+			VK_COMPONENT_SWIZZLE_R,
+			VK_COMPONENT_SWIZZLE_G,
+			VK_COMPONENT_SWIZZLE_B,
+			VK_COMPONENT_SWIZZLE_A
+		};
+		colorAttachmentView.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+		colorAttachmentView.viewType = VK_IMAGE_VIEW_TYPE_2D;
+		colorAttachmentView.image = swapChain.images[i];
+
+		swapChain.buffers[i].image = swapChain.images[i];
+
+		err = vkCreateImageView(swapChain.device, &colorAttachmentView, nullptr, &swapChain.buffers[i].view);
+		assert(!err);
+	}
+}
+
 // Create the swap chain and get images with given width and height
 void VulkanSwapChain::Create(VkCommandBuffer cmdBuffer, uint32_t& width, uint32_t& height, bool vsync)
 {
+	if (headless)
+	{
+		CreateHeadlessImages(*this, width, height);
+		return;
+	}
+
 	VkResult err;
 	VkSwapchainKHR oldSwapchain = swapChain;
 
@@ -303,12 +385,30 @@ void VulkanSwapChain::Create(VkCommandBuffer cmdBuffer, uint32_t& width, uint32_
 // Acquires the next image in the swap chain
 VkResult VulkanSwapChain::GetNextImage(VkSemaphore presentCompleteSemaphore, uint32_t *currentBuffer)
 {
+	if (headless)
+	{
+		// Images are handed out in order, the frame fences guard their reuse.
+		// Signal the semaphore anyway, frame submits wait on it
+		*currentBuffer = headlessImage;
+		headlessImage = (headlessImage + 1) % imageCount;
+
+		VkSubmitInfo submitInfo = {};
+		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		submitInfo.signalSemaphoreCount = (presentCompleteSemaphore != VK_NULL_HANDLE) ? 1 : 0;
+		submitInfo.pSignalSemaphores = &presentCompleteSemaphore;
+		return vkQueueSubmit(headlessQueue, 1, &submitInfo, VK_NULL_HANDLE);
+	}
 	return fpAcquireNextImageKHR(device, swapChain, UINT64_MAX, presentCompleteSemaphore, (VkFence)nullptr, currentBuffer);
 }
 
 // Present the current image to the queue
 VkResult VulkanSwapChain::QueuePresent(VkQueue queue, uint32_t currentBuffer)
 {
+	if (headless)
+	{
+		return VK_SUCCESS;
+	}
+
 	VkPresentInfoKHR presentInfo = {};
 	presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
 	presentInfo.pNext = NULL;
@@ -321,6 +421,23 @@ VkResult VulkanSwapChain::QueuePresent(VkQueue queue, uint32_t currentBuffer)
 // Present the current image to the queue
 VkResult VulkanSwapChain::QueuePresent(VkQueue queue, uint32_t currentBuffer, VkSemaphore waitSemaphore)
 {
+	if (headless)
+	{
+		// Nothing to show, only unsignal the semaphore so it can be signaled again next frame
+		if (waitSemaphore == VK_NULL_HANDLE)
+		{
+			return VK_SUCCESS;
+		}
+
+		VkPipelineStageFlags waitStage = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+		VkSubmitInfo submitInfo = {};
+		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		submitInfo.waitSemaphoreCount = 1;
+		submitInfo.pWaitSemaphores = &waitSemaphore;
+		submitInfo.pWaitDstStageMask = &waitStage;
+		return vkQueueSubmit(queue, 1, &submitInfo, VK_NULL_HANDLE);
+	}
+
 	VkPresentInfoKHR presentInfo = {};
 	presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
 	presentInfo.pNext = NULL;
@@ -343,6 +460,17 @@ void VulkanSwapChain::Cleanup()
 	{
 		vkDestroyImageView(device, buffers[i].view, nullptr);
 	}
+
+	if (headless)
+	{
+		for (uint32_t i = 0; i < imageCount; i++)
+		{
+			vkDestroyImage(device, images[i], nullptr);
+			memoryAllocator->Free(headlessAllocations[i]);
+		}
+		return;
+	}
+
 	fpDestroySwapchainKHR(device, swapChain, nullptr);
 	vkDestroySurfaceKHR(instance, surface, nullptr);
 }
\ No newline at end of file
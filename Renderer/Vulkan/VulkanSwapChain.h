@@ -26,10 +26,11 @@
 #else
 #endif
 
-#include <External\vulkan\vulkan.h>
+#include <External/vulkan/vulkan.h>
+#include "Vulkan/VulkanMemoryAllocator.h"
 
 #ifdef __ANDROID__
-#include "vulkanandroid.h"
+#include "VulkanAndroid.h"
 #endif
 
 // Macro to get a procedure address based on a vulkan instance
@@ -88,6 +89,12 @@ public:
 	// Index of the deteced graphics and presenting device queue
 	uint32_t queueNodeIndex = UINT32_MAX;
 
+	// Offscreen images instead of a surface, see InitHeadless
+	bool headless = false;
+	VkQueue headlessQueue = VK_NULL_HANDLE;
+	uint32_t headlessImage = 0;
+	std::vector<VulkanAllocation> headlessAllocations;
+
 	// Creates an os specific surface
 	// Tries to find a graphics and a present queue
 	void initSurface(
@@ -106,6 +113,10 @@ public:
 	// Connect to the instance und device and get all required function pointers
 	void Connect();
 
+	// Renders into own images, for machines without a window system or display
+	// Acquire and present only pass the semaphores along on the given queue
+	void InitHeadless(VkQueue queue, uint32_t queueFamilyIndex);
+
 	// Create the swap chain and get images with given width and height
 	void Create(VkCommandBuffer cmdBuffer, uint32_t& width, uint32_t& height, bool vsync = false);
 
@@ -1,8 +1,9 @@
-#include <RendererPch\stdafx.h>
+#include <RendererPch/stdafx.h>
 
 //Vulkan Renderer Includes
 #include "VulkanTools.h"
 #include"VulkanTextureLoader.h"
+#include "VulkanUploadManager.h"
 
 VkTools::VulkanTextureLoader::VulkanTextureLoader(VkPhysicalDevice physicalDevice, VkDevice device, VkQueue queue, VkCommandPool cmdPool)
 {
@@ -41,138 +42,56 @@ bool VkTools::VulkanTextureLoader::GenerateTexture(void * pImageData, VulkanText
 	VkFormatProperties formatProperties;
 	vkGetPhysicalDeviceFormatProperties(physicalDevice, format, &formatProperties);
 
-	VkMemoryAllocateInfo memAllocInfo = VkTools::Initializer::MemoryAllocateInfo();
-	VkMemoryRequirements memReqs;
-
-	// Use a separate command buffer for texture loading
-	VkCommandBufferBeginInfo cmdBufInfo = VkTools::Initializer::CommandBufferBeginInfo();
-	VK_CHECK_RESULT(vkBeginCommandBuffer(cmdBuffer, &cmdBufInfo));
-
-		// Create a host-visible staging buffer that contains the raw image data
-		VkBuffer stagingBuffer;
-		VkDeviceMemory stagingMemory;
-
-		VkBufferCreateInfo bufferCreateInfo = VkTools::Initializer::BufferCreateInfo();
-		//bufferCreateInfo.size = sizeof(pngLoader.image_data);
-		bufferCreateInfo.size = width*height;
-
-		// This buffer is used as a transfer source for the buffer copy
-		bufferCreateInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
-		bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-
-		VK_CHECK_RESULT(vkCreateBuffer(device, &bufferCreateInfo, nullptr, &stagingBuffer));
-
-		// Get memory requirements for the staging buffer (alignment, memory type bits)
-		vkGetBufferMemoryRequirements(device, stagingBuffer, &memReqs);
-
-		memAllocInfo.allocationSize = memReqs.size;
-		// Get memory type index for a host visible buffer
-		memAllocInfo.memoryTypeIndex = getMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-
-		VK_CHECK_RESULT(vkAllocateMemory(device, &memAllocInfo, nullptr, &stagingMemory));
-		VK_CHECK_RESULT(vkBindBufferMemory(device, stagingBuffer, stagingMemory, 0));
-
-		// Copy texture data into staging buffer
-		uint8_t *data;
-		VK_CHECK_RESULT(vkMapMemory(device, stagingMemory, 0, memReqs.size, 0, (void **)&data));
-		memcpy(data, pImageData, width*height);
-		//memcpy(data, pngLoader.image_data, sizeof(pngLoader.image_data));
-		vkUnmapMemory(device, stagingMemory);
-
-		// Setup buffer copy regions for each mip level
-		std::vector<VkBufferImageCopy> bufferCopyRegions;
-		uint32_t offset = 0;
-
-
-		VkBufferImageCopy bufferCopyRegion = {};
-		bufferCopyRegion.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-		bufferCopyRegion.imageSubresource.mipLevel = 0;
-		bufferCopyRegion.imageSubresource.baseArrayLayer = 0;
-		bufferCopyRegion.imageSubresource.layerCount = 1;
-		bufferCopyRegion.imageExtent.width = width;
-		bufferCopyRegion.imageExtent.height = height;
-
-
-		bufferCopyRegion.imageExtent.depth = 1;
-		bufferCopyRegion.bufferOffset = offset;
-
-		bufferCopyRegions.push_back(bufferCopyRegion);
-
-
-		// Create optimal tiled target image
-		VkImageCreateInfo imageCreateInfo = VkTools::Initializer::ImageCreateInfo();
-		imageCreateInfo.imageType = VK_IMAGE_TYPE_2D;
-		imageCreateInfo.format = format;
-		imageCreateInfo.mipLevels = 1;
-		imageCreateInfo.arrayLayers = 1;
-		imageCreateInfo.samples = VK_SAMPLE_COUNT_1_BIT;
-		imageCreateInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
-		imageCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-		imageCreateInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-		imageCreateInfo.extent = { texture->width, texture->height, 1 };
-		imageCreateInfo.usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
-
-		VK_CHECK_RESULT(vkCreateImage(device, &imageCreateInfo, nullptr, &texture->image));
-
-		vkGetImageMemoryRequirements(device, texture->image, &memReqs);
-
-		memAllocInfo.allocationSize = memReqs.size;
-
-		memAllocInfo.memoryTypeIndex = getMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-		VK_CHECK_RESULT(vkAllocateMemory(device, &memAllocInfo, nullptr, &texture->deviceMemory));
-		VK_CHECK_RESULT(vkBindImageMemory(device, texture->image, texture->deviceMemory, 0));
-
-
-		// Image barrier for optimal image (target)
-		// Optimal image will be used as destination for the copy
-		VkTools::SetImageLayout(
-			cmdBuffer,
-			texture->image,
-			VK_IMAGE_ASPECT_COLOR_BIT,
-			VK_IMAGE_LAYOUT_UNDEFINED,
-			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+	// Copy regions for each mip level, offsets are relative to pImageData
+	std::vector<VkBufferImageCopy> bufferCopyRegions;
+	uint32_t offset = 0;
 
-		// Copy mip levels from staging buffer
-		vkCmdCopyBufferToImage(
-			cmdBuffer,
-			stagingBuffer,
-			texture->image,
-			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-			static_cast<uint32_t>(bufferCopyRegions.size()),
-			bufferCopyRegions.data()
-		);
 
-		// Change texture image layout to shader read after all mip levels have been copied
-		texture->imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-		SetImageLayout(
-			cmdBuffer,
-			texture->image,
-			VK_IMAGE_ASPECT_COLOR_BIT,
-			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-			texture->imageLayout);
+	VkBufferImageCopy bufferCopyRegion = {};
+	bufferCopyRegion.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	bufferCopyRegion.imageSubresource.mipLevel = 0;
+	bufferCopyRegion.imageSubresource.baseArrayLayer = 0;
+	bufferCopyRegion.imageSubresource.layerCount = 1;
+	bufferCopyRegion.imageExtent.width = width;
+	bufferCopyRegion.imageExtent.height = height;
 
 
-		// Submit command buffer containing copy and image layout commands
-		VK_CHECK_RESULT(vkEndCommandBuffer(cmdBuffer));
+	bufferCopyRegion.imageExtent.depth = 1;
+	bufferCopyRegion.bufferOffset = offset;
 
-		// Create a fence to make sure that the copies have finished before continuing
-		VkFence copyFence;
-		VkFenceCreateInfo fenceCreateInfo = VkTools::Initializer::FenceCreateInfo(VK_FLAGS_NONE);
-		VK_CHECK_RESULT(vkCreateFence(device, &fenceCreateInfo, nullptr, &copyFence));
+	bufferCopyRegions.push_back(bufferCopyRegion);
 
-		VkSubmitInfo submitInfo = VkTools::Initializer::SubmitInfo();
-		submitInfo.commandBufferCount = 1;
-		submitInfo.pCommandBuffers = &cmdBuffer;
 
-		VK_CHECK_RESULT(vkQueueSubmit(queue, 1, &submitInfo, copyFence));
+	// Create optimal tiled target image
+	VkImageCreateInfo imageCreateInfo = VkTools::Initializer::ImageCreateInfo();
+	imageCreateInfo.imageType = VK_IMAGE_TYPE_2D;
+	imageCreateInfo.format = format;
+	imageCreateInfo.mipLevels = 1;
+	imageCreateInfo.arrayLayers = 1;
+	imageCreateInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+	imageCreateInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+	imageCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	imageCreateInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	imageCreateInfo.extent = { texture->width, texture->height, 1 };
+	imageCreateInfo.usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
 
-		VK_CHECK_RESULT(vkWaitForFences(device, 1, &copyFence, VK_TRUE, DEFAULT_FENCE_TIMEOUT));
+	VK_CHECK_RESULT(vkCreateImage(device, &imageCreateInfo, nullptr, &texture->image));
 
-		vkDestroyFence(device, copyFence, nullptr);
+	VK_CHECK_RESULT(memoryAllocator->AllocateImage(texture->image, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, VK_IMAGE_TILING_OPTIMAL, false, texture->allocation));
+	texture->deviceMemory = VK_NULL_HANDLE;
 
-		// Clean up staging resources
-		vkFreeMemory(device, stagingMemory, nullptr);
-		vkDestroyBuffer(device, stagingBuffer, nullptr);
+	// Copy goes through the upload manager staging ring together with other loading time uploads
+	// Image ends up in shader read layout once the batch has executed
+	texture->imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	VkImageSubresourceRange subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+	VK_CHECK_RESULT(uploadManager->UploadImage(
+		texture->image,
+		subresourceRange,
+		pImageData,
+		width*height,
+		bufferCopyRegions.data(),
+		static_cast<uint32_t>(bufferCopyRegions.size()),
+		texture->imageLayout));
 
 	// Create sampler
 	VkSamplerCreateInfo sampler = {};
@@ -320,47 +239,9 @@ bool VkTools::VulkanTextureLoader::LoadTexture(const std::string& filename, VkFo
 	// limited amount of formats and features (mip maps, cubemaps, arrays, etc.)
 	VkBool32 useStaging = !forceLinear;
 
-	VkMemoryAllocateInfo memAllocInfo = VkTools::Initializer::MemoryAllocateInfo();
-	VkMemoryRequirements memReqs;
-
-	// Use a separate command buffer for texture loading
-	VkCommandBufferBeginInfo cmdBufInfo = VkTools::Initializer::CommandBufferBeginInfo();
-	VK_CHECK_RESULT(vkBeginCommandBuffer(cmdBuffer, &cmdBufInfo));
-
 	if (useStaging)
 	{
-		// Create a host-visible staging buffer that contains the raw image data
-		VkBuffer stagingBuffer;
-		VkDeviceMemory stagingMemory;
-
-		VkBufferCreateInfo bufferCreateInfo = VkTools::Initializer::BufferCreateInfo();
-		//bufferCreateInfo.size = sizeof(pngLoader.image_data);
-		bufferCreateInfo.size = tex2D.size();
-
-		// This buffer is used as a transfer source for the buffer copy
-		bufferCreateInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
-		bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-
-		VK_CHECK_RESULT(vkCreateBuffer(device, &bufferCreateInfo, nullptr, &stagingBuffer));
-
-		// Get memory requirements for the staging buffer (alignment, memory type bits)
-		vkGetBufferMemoryRequirements(device, stagingBuffer, &memReqs);
-
-		memAllocInfo.allocationSize = memReqs.size;
-		// Get memory type index for a host visible buffer
-		memAllocInfo.memoryTypeIndex = getMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-
-		VK_CHECK_RESULT(vkAllocateMemory(device, &memAllocInfo, nullptr, &stagingMemory));
-		VK_CHECK_RESULT(vkBindBufferMemory(device, stagingBuffer, stagingMemory, 0));
-
-		// Copy texture data into staging buffer
-		uint8_t *data;
-		VK_CHECK_RESULT(vkMapMemory(device, stagingMemory, 0, memReqs.size, 0, (void **)&data));
-		memcpy(data, tex2D.data(), tex2D.size());
-		//memcpy(data, pngLoader.image_data, sizeof(pngLoader.image_data));
-		vkUnmapMemory(device, stagingMemory);
-
-		// Setup buffer copy regions for each mip level
+		// Setup buffer copy regions for each mip level, offsets are relative to tex2D.data()
 		std::vector<VkBufferImageCopy> bufferCopyRegions;
 		uint32_t offset = 0;
 
@@ -402,13 +283,8 @@ bool VkTools::VulkanTextureLoader::LoadTexture(const std::string& filename, VkFo
 
 		VK_CHECK_RESULT(vkCreateImage(device, &imageCreateInfo, nullptr, &texture->image));
 
-		vkGetImageMemoryRequirements(device, texture->image, &memReqs);
-
-		memAllocInfo.allocationSize = memReqs.size;
-
-		memAllocInfo.memoryTypeIndex = getMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-		VK_CHECK_RESULT(vkAllocateMemory(device, &memAllocInfo, nullptr, &texture->deviceMemory));
-		VK_CHECK_RESULT(vkBindImageMemory(device, texture->image, texture->deviceMemory, 0));
+		VK_CHECK_RESULT(memoryAllocator->AllocateImage(texture->image, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, VK_IMAGE_TILING_OPTIMAL, false, texture->allocation));
+		texture->deviceMemory = VK_NULL_HANDLE;
 
 		VkImageSubresourceRange subresourceRange = {};
 		subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
@@ -416,60 +292,24 @@ bool VkTools::VulkanTextureLoader::LoadTexture(const std::string& filename, VkFo
 		subresourceRange.levelCount = texture->mipLevels;
 		subresourceRange.layerCount = 1;
 
-		// Image barrier for optimal image (target)
-		// Optimal image will be used as destination for the copy
-		SetImageLayout(
-			cmdBuffer,
-			texture->image,
-			VK_IMAGE_ASPECT_COLOR_BIT,
-			VK_IMAGE_LAYOUT_UNDEFINED,
-			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-			subresourceRange);
-
-		// Copy mip levels from staging buffer
-		vkCmdCopyBufferToImage(
-			cmdBuffer,
-			stagingBuffer,
-			texture->image,
-			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-			static_cast<uint32_t>(bufferCopyRegions.size()),
-			bufferCopyRegions.data()
-		);
-
-		// Change texture image layout to shader read after all mip levels have been copied
+		// Queue copy of all mip levels on the upload manager, it batches them
+		// with other loading time uploads and releases the staging memory itself
 		texture->imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-		SetImageLayout(
-			cmdBuffer,
+		VK_CHECK_RESULT(uploadManager->UploadImage(
 			texture->image,
-			VK_IMAGE_ASPECT_COLOR_BIT,
-			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-			texture->imageLayout,
-			subresourceRange);
-
-		// Submit command buffer containing copy and image layout commands
-		VK_CHECK_RESULT(vkEndCommandBuffer(cmdBuffer));
-
-		// Create a fence to make sure that the copies have finished before continuing
-		VkFence copyFence;
-		VkFenceCreateInfo fenceCreateInfo = VkTools::Initializer::FenceCreateInfo(VK_FLAGS_NONE);
-		VK_CHECK_RESULT(vkCreateFence(device, &fenceCreateInfo, nullptr, &copyFence));
-
-		VkSubmitInfo submitInfo = VkTools::Initializer::SubmitInfo();
-		submitInfo.commandBufferCount = 1;
-		submitInfo.pCommandBuffers = &cmdBuffer;
-
-		VK_CHECK_RESULT(vkQueueSubmit(queue, 1, &submitInfo, copyFence));
-
-		VK_CHECK_RESULT(vkWaitForFences(device, 1, &copyFence, VK_TRUE, DEFAULT_FENCE_TIMEOUT));
-
-		vkDestroyFence(device, copyFence, nullptr);
-
-		// Clean up staging resources
-		vkFreeMemory(device, stagingMemory, nullptr);
-		vkDestroyBuffer(device, stagingBuffer, nullptr);
+			subresourceRange,
+			tex2D.data(),
+			tex2D.size(),
+			bufferCopyRegions.data(),
+			static_cast<uint32_t>(bufferCopyRegions.size()),
+			texture->imageLayout));
 	}
 	else
 	{
+		// Use a separate command buffer for texture loading
+		VkCommandBufferBeginInfo cmdBufInfo = VkTools::Initializer::CommandBufferBeginInfo();
+		VK_CHECK_RESULT(vkBeginCommandBuffer(cmdBuffer, &cmdBufInfo));
+
 		// Prefer using optimal tiling, as linear tiling 
 		// may support only a small set of features 
 		// depending on implementation (e.g. no mip maps, only one layer, etc.)
@@ -478,7 +318,7 @@ bool VkTools::VulkanTextureLoader::LoadTexture(const std::string& filename, VkFo
 		assert(formatProperties.linearTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT);
 
 		VkImage mappableImage;
-		VkDeviceMemory mappableMemory;
+		VulkanAllocation mappableAllocation;
 
 		VkImageCreateInfo imageCreateInfo = VkTools::Initializer::ImageCreateInfo();
 		imageCreateInfo.imageType = VK_IMAGE_TYPE_2D;
@@ -495,20 +335,8 @@ bool VkTools::VulkanTextureLoader::LoadTexture(const std::string& filename, VkFo
 		// Load mip map level 0 to linear tiling image
 		VK_CHECK_RESULT(vkCreateImage(device, &imageCreateInfo, nullptr, &mappableImage));
 
-		// Get memory requirements for this image 
-		// like size and alignment
-		vkGetImageMemoryRequirements(device, mappableImage, &memReqs);
-		// Set memory allocation size to required memory size
-		memAllocInfo.allocationSize = memReqs.size;
-
-		// Get memory type that can be mapped to host memory
-		memAllocInfo.memoryTypeIndex = getMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-
-		// Allocate host memory
-		VK_CHECK_RESULT(vkAllocateMemory(device, &memAllocInfo, nullptr, &mappableMemory));
-
-		// Bind allocated image for use
-		VK_CHECK_RESULT(vkBindImageMemory(device, mappableImage, mappableMemory, 0));
+		// Allocate host visible memory and bind it for use
+		VK_CHECK_RESULT(memoryAllocator->AllocateImage(mappableImage, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, VK_IMAGE_TILING_LINEAR, false, mappableAllocation));
 
 		// Get sub resource layout
 		// Mip map count, array layer, etc.
@@ -523,8 +351,8 @@ bool VkTools::VulkanTextureLoader::LoadTexture(const std::string& filename, VkFo
 		// Includes row pitch, size offsets, etc.
 		vkGetImageSubresourceLayout(device, mappableImage, &subRes, &subResLayout);
 
-		// Map image memory
-		VK_CHECK_RESULT(vkMapMemory(device, mappableMemory, 0, memReqs.size, 0, &data));
+		// Image memory stays mapped
+		data = static_cast<uint8_t*>(mappableAllocation.pMapped) + subResLayout.offset;
 
 		// Copy image data into memory
 		memcpy(data, tex2D[subRes.mipLevel].data(), tex2D[subRes.mipLevel].size());
@@ -532,12 +360,12 @@ bool VkTools::VulkanTextureLoader::LoadTexture(const std::string& filename, VkFo
 		//memcpy(data, pngLoader.image_data, sizeof(pngLoader.image_data));
 
 
-		vkUnmapMemory(device, mappableMemory);
 
 		// Linear tiled images don't need to be staged
 		// and can be directly used as textures
 		texture->image = mappableImage;
-		texture->deviceMemory = mappableMemory;
+		texture->deviceMemory = VK_NULL_HANDLE;
+		texture->allocation = mappableAllocation;
 		texture->imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
 
 		// Setup image memory barrier
@@ -617,7 +445,7 @@ void VkTools::VulkanTextureLoader::DestroyTexture(VulkanTexture* pTexture)
 	vkDestroyImageView(device, pTexture->view, nullptr);
 	vkDestroyImage(device, pTexture->image, nullptr);
 	vkDestroySampler(device, pTexture->sampler, nullptr);
-	vkFreeMemory(device, pTexture->deviceMemory, nullptr);
+	memoryAllocator->Free(pTexture->allocation);
 }
 
 
@@ -654,38 +482,7 @@ bool VkTools::VulkanTextureLoader::LoadCubemap(std::string filename, VkFormat fo
 	texture->height = static_cast<uint32_t>(texCube.extent().y);
 	texture->mipLevels = static_cast<uint32_t>(texCube.levels());
 
-	VkMemoryAllocateInfo memAllocInfo = VkTools::Initializer::MemoryAllocateInfo();
-	VkMemoryRequirements memReqs;
-
-	// Create a host-visible staging buffer that contains the raw image data
-	VkBuffer stagingBuffer;
-	VkDeviceMemory stagingMemory;
-
-	VkBufferCreateInfo bufferCreateInfo = VkTools::Initializer::BufferCreateInfo();
-	bufferCreateInfo.size = texCube.size();
-	// This buffer is used as a transfer source for the buffer copy
-	bufferCreateInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
-	bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-
-	VK_CHECK_RESULT(vkCreateBuffer(device, &bufferCreateInfo, nullptr, &stagingBuffer));
-
-	// Get memory requirements for the staging buffer (alignment, memory type bits)
-	vkGetBufferMemoryRequirements(device, stagingBuffer, &memReqs);
-
-	memAllocInfo.allocationSize = memReqs.size;
-	// Get memory type index for a host visible buffer
-	memAllocInfo.memoryTypeIndex = getMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-
-	VK_CHECK_RESULT(vkAllocateMemory(device, &memAllocInfo, nullptr, &stagingMemory));
-	VK_CHECK_RESULT(vkBindBufferMemory(device, stagingBuffer, stagingMemory, 0));
-
-	// Copy texture data into staging buffer
-	uint8_t *data;
-	VK_CHECK_RESULT(vkMapMemory(device, stagingMemory, 0, memReqs.size, 0, (void **)&data));
-	memcpy(data, texCube.data(), texCube.size());
-	vkUnmapMemory(device, stagingMemory);
-
-	// Setup buffer copy regions for each face including all of it's miplevels
+	// Setup buffer copy regions for each face including all of it's miplevels, offsets are relative to texCube.data()
 	std::vector<VkBufferImageCopy> bufferCopyRegions;
 	size_t offset = 0;
 
@@ -729,68 +526,26 @@ bool VkTools::VulkanTextureLoader::LoadCubemap(std::string filename, VkFormat fo
 
 	VK_CHECK_RESULT(vkCreateImage(device, &imageCreateInfo, nullptr, &texture->image));
 
-	vkGetImageMemoryRequirements(device, texture->image, &memReqs);
-
-	memAllocInfo.allocationSize = memReqs.size;
-	memAllocInfo.memoryTypeIndex = getMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-
-	VK_CHECK_RESULT(vkAllocateMemory(device, &memAllocInfo, nullptr, &texture->deviceMemory));
-	VK_CHECK_RESULT(vkBindImageMemory(device, texture->image, texture->deviceMemory, 0));
+	VK_CHECK_RESULT(memoryAllocator->AllocateImage(texture->image, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, VK_IMAGE_TILING_OPTIMAL, false, texture->allocation));
+	texture->deviceMemory = VK_NULL_HANDLE;
 
-	VkCommandBufferBeginInfo cmdBufInfo = VkTools::Initializer::CommandBufferBeginInfo();
-	VK_CHECK_RESULT(vkBeginCommandBuffer(cmdBuffer, &cmdBufInfo));
-
-	// Image barrier for optimal image (target)
-	// Set initial layout for all array layers (faces) of the optimal (target) tiled texture
 	VkImageSubresourceRange subresourceRange = {};
 	subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
 	subresourceRange.baseMipLevel = 0;
 	subresourceRange.levelCount = texture->mipLevels;
 	subresourceRange.layerCount = 6;
 
-	SetImageLayout(
-		cmdBuffer,
-		texture->image,
-		VK_IMAGE_ASPECT_COLOR_BIT,
-		VK_IMAGE_LAYOUT_UNDEFINED,
-		VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-		subresourceRange);
-
-	// Copy the cube map faces from the staging buffer to the optimal tiled image
-	vkCmdCopyBufferToImage(
-		cmdBuffer,
-		stagingBuffer,
-		texture->image,
-		VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-		static_cast<uint32_t>(bufferCopyRegions.size()),
-		bufferCopyRegions.data());
-
-	// Change texture image layout to shader read after all faces have been copied
+	// Queue copy of all layers and mip levels on the upload manager. Image is in
+	// shader read layout once the batch has executed, staging memory is released there
 	texture->imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-	SetImageLayout(
-		cmdBuffer,
+	VK_CHECK_RESULT(uploadManager->UploadImage(
 		texture->image,
-		VK_IMAGE_ASPECT_COLOR_BIT,
-		VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-		texture->imageLayout,
-		subresourceRange);
-
-	VK_CHECK_RESULT(vkEndCommandBuffer(cmdBuffer));
-
-	// Create a fence to make sure that the copies have finished before continuing
-	VkFence copyFence;
-	VkFenceCreateInfo fenceCreateInfo = VkTools::Initializer::FenceCreateInfo(VK_FLAGS_NONE);
-	VK_CHECK_RESULT(vkCreateFence(device, &fenceCreateInfo, nullptr, &copyFence));
-
-	VkSubmitInfo submitInfo = VkTools::Initializer::SubmitInfo();
-	submitInfo.commandBufferCount = 1;
-	submitInfo.pCommandBuffers = &cmdBuffer;
-
-	VK_CHECK_RESULT(vkQueueSubmit(queue, 1, &submitInfo, copyFence));
-
-	VK_CHECK_RESULT(vkWaitForFences(device, 1, &copyFence, VK_TRUE, DEFAULT_FENCE_TIMEOUT));
-
-	vkDestroyFence(device, copyFence, nullptr);
+		subresourceRange,
+		texCube.data(),
+		static_cast<VkDeviceSize>(texCube.size()),
+		bufferCopyRegions.data(),
+		static_cast<uint32_t>(bufferCopyRegions.size()),
+		texture->imageLayout));
 
 	// Create sampler
 	VkSamplerCreateInfo sampler = VkTools::Initializer::SamplerCreateInfo();
@@ -820,10 +575,6 @@ bool VkTools::VulkanTextureLoader::LoadCubemap(std::string filename, VkFormat fo
 	view.image = texture->image;
 	VK_CHECK_RESULT(vkCreateImageView(device, &view, nullptr, &texture->view));
 
-	// Clean up staging resources
-	vkFreeMemory(device, stagingMemory, nullptr);
-	vkDestroyBuffer(device, stagingBuffer, nullptr);
-
 	// Fill descriptor image info that can be used for setting up descriptor sets
 	texture->descriptor.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
 	texture->descriptor.imageView = texture->view;
@@ -866,38 +617,7 @@ bool VkTools::VulkanTextureLoader::LoadTextureArray(std::string filename, VkForm
 	texture->layerCount = static_cast<uint32_t>(tex2DArray.layers());
 	texture->mipLevels = static_cast<uint32_t>(tex2DArray.levels());
 
-	VkMemoryAllocateInfo memAllocInfo = VkTools::Initializer::MemoryAllocateInfo();
-	VkMemoryRequirements memReqs;
-
-	// Create a host-visible staging buffer that contains the raw image data
-	VkBuffer stagingBuffer;
-	VkDeviceMemory stagingMemory;
-
-	VkBufferCreateInfo bufferCreateInfo = VkTools::Initializer::BufferCreateInfo();
-	bufferCreateInfo.size = tex2DArray.size();
-	// This buffer is used as a transfer source for the buffer copy
-	bufferCreateInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
-	bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-
-	VK_CHECK_RESULT(vkCreateBuffer(device, &bufferCreateInfo, nullptr, &stagingBuffer));
-
-	// Get memory requirements for the staging buffer (alignment, memory type bits)
-	vkGetBufferMemoryRequirements(device, stagingBuffer, &memReqs);
-
-	memAllocInfo.allocationSize = memReqs.size;
-	// Get memory type index for a host visible buffer
-	memAllocInfo.memoryTypeIndex = getMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-
-	VK_CHECK_RESULT(vkAllocateMemory(device, &memAllocInfo, nullptr, &stagingMemory));
-	VK_CHECK_RESULT(vkBindBufferMemory(device, stagingBuffer, stagingMemory, 0));
-
-	// Copy texture data into staging buffer
-	uint8_t *data;
-	VK_CHECK_RESULT(vkMapMemory(device, stagingMemory, 0, memReqs.size, 0, (void **)&data));
-	memcpy(data, tex2DArray.data(), static_cast<size_t>(tex2DArray.size()));
-	vkUnmapMemory(device, stagingMemory);
-
-	// Setup buffer copy regions for each layer including all of it's miplevels
+	// Setup buffer copy regions for each layer including all of it's miplevels, offsets are relative to tex2DArray.data()
 	std::vector<VkBufferImageCopy> bufferCopyRegions;
 	size_t offset = 0;
 
@@ -938,68 +658,26 @@ bool VkTools::VulkanTextureLoader::LoadTextureArray(std::string filename, VkForm
 
 	VK_CHECK_RESULT(vkCreateImage(device, &imageCreateInfo, nullptr, &texture->image));
 
-	vkGetImageMemoryRequirements(device, texture->image, &memReqs);
-
-	memAllocInfo.allocationSize = memReqs.size;
-	memAllocInfo.memoryTypeIndex = getMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	VK_CHECK_RESULT(memoryAllocator->AllocateImage(texture->image, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, VK_IMAGE_TILING_OPTIMAL, false, texture->allocation));
+	texture->deviceMemory = VK_NULL_HANDLE;
 
-	VK_CHECK_RESULT(vkAllocateMemory(device, &memAllocInfo, nullptr, &texture->deviceMemory));
-	VK_CHECK_RESULT(vkBindImageMemory(device, texture->image, texture->deviceMemory, 0));
-
-	VkCommandBufferBeginInfo cmdBufInfo = VkTools::Initializer::CommandBufferBeginInfo();
-	VK_CHECK_RESULT(vkBeginCommandBuffer(cmdBuffer, &cmdBufInfo));
-
-	// Image barrier for optimal image (target)
-	// Set initial layout for all array layers (faces) of the optimal (target) tiled texture
 	VkImageSubresourceRange subresourceRange = {};
 	subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
 	subresourceRange.baseMipLevel = 0;
 	subresourceRange.levelCount = texture->mipLevels;
 	subresourceRange.layerCount = texture->layerCount;
 
-	SetImageLayout(
-		cmdBuffer,
-		texture->image,
-		VK_IMAGE_ASPECT_COLOR_BIT,
-		VK_IMAGE_LAYOUT_UNDEFINED,
-		VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-		subresourceRange);
-
-	// Copy the layers and mip levels from the staging buffer to the optimal tiled image
-	vkCmdCopyBufferToImage(
-		cmdBuffer,
-		stagingBuffer,
-		texture->image,
-		VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-		static_cast<uint32_t>(bufferCopyRegions.size()),
-		bufferCopyRegions.data());
-
-	// Change texture image layout to shader read after all faces have been copied
+	// Queue copy of all layers and mip levels on the upload manager. Image is in
+	// shader read layout once the batch has executed, staging memory is released there
 	texture->imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-	SetImageLayout(
-		cmdBuffer,
+	VK_CHECK_RESULT(uploadManager->UploadImage(
 		texture->image,
-		VK_IMAGE_ASPECT_COLOR_BIT,
-		VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-		texture->imageLayout,
-		subresourceRange);
-
-	VK_CHECK_RESULT(vkEndCommandBuffer(cmdBuffer));
-
-	// Create a fence to make sure that the copies have finished before continuing
-	VkFence copyFence;
-	VkFenceCreateInfo fenceCreateInfo = VkTools::Initializer::FenceCreateInfo(VK_FLAGS_NONE);
-	VK_CHECK_RESULT(vkCreateFence(device, &fenceCreateInfo, nullptr, &copyFence));
-
-	VkSubmitInfo submitInfo = VkTools::Initializer::SubmitInfo();
-	submitInfo.commandBufferCount = 1;
-	submitInfo.pCommandBuffers = &cmdBuffer;
-
-	VK_CHECK_RESULT(vkQueueSubmit(queue, 1, &submitInfo, copyFence));
-
-	VK_CHECK_RESULT(vkWaitForFences(device, 1, &copyFence, VK_TRUE, DEFAULT_FENCE_TIMEOUT));
-
-	vkDestroyFence(device, copyFence, nullptr);
+		subresourceRange,
+		tex2DArray.data(),
+		static_cast<VkDeviceSize>(tex2DArray.size()),
+		bufferCopyRegions.data(),
+		static_cast<uint32_t>(bufferCopyRegions.size()),
+		texture->imageLayout));
 
 	// Create sampler
 	VkSamplerCreateInfo sampler = VkTools::Initializer::SamplerCreateInfo();
@@ -1029,10 +707,6 @@ bool VkTools::VulkanTextureLoader::LoadTextureArray(std::string filename, VkForm
 	view.image = texture->image;
 	VK_CHECK_RESULT(vkCreateImageView(device, &view, nullptr, &texture->view));
 
-	// Clean up staging resources
-	vkFreeMemory(device, stagingMemory, nullptr);
-	vkDestroyBuffer(device, stagingBuffer, nullptr);
-
 	// Fill descriptor image info that can be used for setting up descriptor sets
 	texture->descriptor.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
 	texture->descriptor.imageView = texture->view;
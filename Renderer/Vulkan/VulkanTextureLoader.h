@@ -10,7 +10,8 @@
 */
 
 #pragma once
-#include <External\vulkan\vulkan.h>
+#include <External/vulkan/vulkan.h>
+#include "VulkanMemoryAllocator.h"
 
 namespace VkTools
 {
@@ -21,6 +22,7 @@ namespace VkTools
 		VkImage image;
 		VkImageLayout imageLayout;
 		VkDeviceMemory deviceMemory;
+		VulkanAllocation allocation;
 		VkImageView view;
 		uint32_t width, height;
 		uint32_t mipLevels;
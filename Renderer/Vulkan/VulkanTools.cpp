@@ -1,4 +1,4 @@
-#include "Vulkan\VulkanTools.h"
+#include "Vulkan/VulkanTools.h"
 
 
 
@@ -92,16 +92,11 @@ void VkTools::CreateFrameBufferAttachement(
 	image.tiling = VK_IMAGE_TILING_OPTIMAL;
 	image.usage = usage | VK_IMAGE_USAGE_SAMPLED_BIT;
 
-	VkMemoryAllocateInfo memAlloc = VkTools::Initializer::MemoryAllocateInfo();
-	VkMemoryRequirements memReqs;
-
 	VK_CHECK_RESULT(vkCreateImage(device, &image, nullptr, &attachment->image));
-	vkGetImageMemoryRequirements(device, attachment->image, &memReqs);
-	memAlloc.allocationSize = memReqs.size;
-	memAlloc.memoryTypeIndex = VkTools::GetMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, deviceMemoryProperties);
 
-	VK_CHECK_RESULT(vkAllocateMemory(device, &memAlloc, nullptr, &attachment->mem));
-	VK_CHECK_RESULT(vkBindImageMemory(device, attachment->image, attachment->mem, 0));
+	// Render targets are recreated on resize, dedicated memory keeps them out of the shared blocks
+	VK_CHECK_RESULT(memoryAllocator->AllocateImage(attachment->image, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, VK_IMAGE_TILING_OPTIMAL, true, attachment->allocation));
+	attachment->mem = VK_NULL_HANDLE;
 
 	VkImageViewCreateInfo imageView = VkTools::Initializer::ImageViewCreateInfo();
 	imageView.viewType = VK_IMAGE_VIEW_TYPE_2D;
@@ -727,11 +722,20 @@ VkBool32 VkTools::GetSupportedDepthFormat(VkPhysicalDevice physicalDevice, VkFor
 
 void VkTools::DestroyUniformData(VkDevice device, VkTools::UniformData& uniformData)
 {
+	vkDestroyBuffer(device, uniformData.buffer, nullptr);
+
+	// Memory allocator keeps its blocks mapped
+	if (uniformData.allocation.IsValid())
+	{
+		memoryAllocator->Free(uniformData.allocation);
+		uniformData.mapped = nullptr;
+		return;
+	}
+
 	if (uniformData.mapped != nullptr)
 	{
 		vkUnmapMemory(device, uniformData.memory);
 	}
-	vkDestroyBuffer(device, uniformData.buffer, nullptr);
 	vkFreeMemory(device, uniformData.memory, nullptr);
 }
 
@@ -804,4 +808,17 @@ VkShaderModule VkTools::LoadShader(const std::string& fileName, VkDevice device,
 
 
 
-#endif
\ No newline at end of file
+#endif
+
+
+uint64_t VkTools::HashBytes(const void* pData, size_t size)
+{
+	const uint8_t* pBytes = static_cast<const uint8_t*>(pData);
+	uint64_t hash = 14695981039346656037ULL;
+	for (size_t i = 0; i < size; i++)
+	{
+		hash ^= pBytes[i];
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
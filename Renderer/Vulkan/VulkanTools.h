@@ -1,7 +1,8 @@
 #pragma once
 
 #include <cstdint>
-#include <External\vulkan\vulkan.h>
+#include <External/vulkan/vulkan.h>
+#include "VulkanMemoryAllocator.h"
 
 
 
@@ -52,6 +53,7 @@ namespace VkTools
 		VkDescriptorBufferInfo descriptor;
 		uint32_t allocSize;
 		void* mapped = nullptr;
+		VulkanAllocation allocation;	// set instead of memory when created through memoryAllocator
 	};
 
 	struct VkDepthStencil
@@ -59,6 +61,7 @@ namespace VkTools
 		VkImage image;
 		VkDeviceMemory mem;
 		VkImageView view;
+		VulkanAllocation allocation;
 	};
 
 	struct FrameBufferAttachment 
@@ -67,6 +70,7 @@ namespace VkTools
 		VkDeviceMemory mem;
 		VkImageView view;
 		VkFormat format;
+		VulkanAllocation allocation;
 	};
 
 	struct FrameBuffer
@@ -192,6 +196,15 @@ namespace VkTools
 	 VkShaderModule LoadShader(const std::string& fileName, VkDevice device, VkShaderStageFlagBits stage);
 #endif
 
+	/*
+		FNV-1a hash of a memory block. Used for cache keys and file checksums, not security
+
+		@param: const void* pData
+		@param: size_t size
+		@return: uint64_t
+	*/
+	uint64_t HashBytes(const void* pData, size_t size);
+
 	namespace Initializer
 	{
 		/*
@@ -0,0 +1,548 @@
+/*
+*	Copyright 2015-2016 Tomas Mikalauskas. All rights reserved.
+*	GitHub repository - https://github.com/TywyllSoftware/TywRenderer
+*	This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+#include <RendererPch/stdafx.h>
+
+//Vulkan Includes
+#include "VulkanUploadManager.h"
+#include "VulkanTools.h"
+
+
+VulkanUploadManager* uploadManager = nullptr;
+
+//Copy offsets of buffers only need 4 bytes. Images need a multiple of the texel block size,
+//48 is a multiple of every block size up to 16 bytes (1, 2, 3, 4, 6, 8, 12, 16)
+static const VkDeviceSize BUFFER_STAGING_ALIGNMENT = 16;
+static const VkDeviceSize IMAGE_STAGING_ALIGNMENT = 48;
+
+
+static inline VkDeviceSize AlignUp(VkDeviceSize value, VkDeviceSize alignment)
+{
+	return ((value + alignment - 1) / alignment) * alignment;
+}
+
+
+VulkanUploadManager::VulkanUploadManager(VkDevice device, VkQueue graphicsQueue, uint32_t graphicsFamily, VkQueue transferQueue, uint32_t transferFamily, VkDeviceSize ringSize):
+	m_Device(device),
+	m_GraphicsQueue(graphicsQueue),
+	m_TransferQueue(transferQueue),
+	m_GraphicsFamily(graphicsFamily),
+	m_TransferFamily(transferFamily),
+	m_TransferCmdPool(VK_NULL_HANDLE),
+	m_GraphicsCmdPool(VK_NULL_HANDLE),
+	m_RingBuffer(VK_NULL_HANDLE),
+	m_RingSize(ringSize),
+	m_RingHead(0),
+	m_RingTail(0),
+	m_RingUsed(0),
+	m_pOpenBatch(nullptr),
+	m_NextBatchId(1),
+	m_LastFinishedId(0)
+{
+	memset(&m_Stats, 0, sizeof(m_Stats));
+
+	//Command buffers of batches are recycled, so they must be resettable
+	VkCommandPoolCreateInfo cmdPoolInfo = {};
+	cmdPoolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	cmdPoolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT | VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+	cmdPoolInfo.queueFamilyIndex = m_TransferFamily;
+	VK_CHECK_RESULT(vkCreateCommandPool(m_Device, &cmdPoolInfo, nullptr, &m_TransferCmdPool));
+
+	if (HasDedicatedTransfer())
+	{
+		cmdPoolInfo.queueFamilyIndex = m_GraphicsFamily;
+		VK_CHECK_RESULT(vkCreateCommandPool(m_Device, &cmdPoolInfo, nullptr, &m_GraphicsCmdPool));
+	}
+
+	//Staging ring stays mapped for the whole life of the manager
+	VkBufferCreateInfo bufferCreateInfo = VkTools::Initializer::BufferCreateInfo(VK_BUFFER_USAGE_TRANSFER_SRC_BIT, m_RingSize);
+	VK_CHECK_RESULT(vkCreateBuffer(m_Device, &bufferCreateInfo, nullptr, &m_RingBuffer));
+	VK_CHECK_RESULT(memoryAllocator->AllocateBuffer(m_RingBuffer, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, m_RingAllocation));
+	assert(m_RingAllocation.pMapped);
+
+	m_Stats.ringSize = m_RingSize;
+	m_Stats.bDedicatedTransferQueue = HasDedicatedTransfer();
+}
+
+
+VulkanUploadManager::~VulkanUploadManager()
+{
+	WaitIdle();
+
+	for (Batch* pBatch : m_FreeBatches)
+	{
+		if (pBatch->semaphore != VK_NULL_HANDLE)
+		{
+			vkDestroySemaphore(m_Device, pBatch->semaphore, nullptr);
+		}
+		vkDestroyFence(m_Device, pBatch->fence, nullptr);
+		SAFE_DELETE(pBatch);
+	}
+	m_FreeBatches.clear();
+
+	vkDestroyBuffer(m_Device, m_RingBuffer, nullptr);
+	memoryAllocator->Free(m_RingAllocation);
+
+	//Destroying pools frees their command buffers
+	vkDestroyCommandPool(m_Device, m_TransferCmdPool, nullptr);
+	if (m_GraphicsCmdPool != VK_NULL_HANDLE)
+	{
+		vkDestroyCommandPool(m_Device, m_GraphicsCmdPool, nullptr);
+	}
+}
+
+
+VulkanUploadManager::Batch* VulkanUploadManager::AcquireBatch()
+{
+	Batch* pBatch = nullptr;
+	if (!m_FreeBatches.empty())
+	{
+		pBatch = m_FreeBatches.back();
+		m_FreeBatches.pop_back();
+	}
+	else
+	{
+		pBatch = TYW_NEW Batch;
+		pBatch->acquireCmdBuffer = VK_NULL_HANDLE;
+		pBatch->semaphore = VK_NULL_HANDLE;
+
+		VkCommandBufferAllocateInfo cmdBufAllocateInfo = VkTools::Initializer::CommandBufferAllocateInfo(m_TransferCmdPool, VK_COMMAND_BUFFER_LEVEL_PRIMARY, 1);
+		VK_CHECK_RESULT(vkAllocateCommandBuffers(m_Device, &cmdBufAllocateInfo, &pBatch->cmdBuffer));
+
+		if (HasDedicatedTransfer())
+		{
+			cmdBufAllocateInfo.commandPool = m_GraphicsCmdPool;
+			VK_CHECK_RESULT(vkAllocateCommandBuffers(m_Device, &cmdBufAllocateInfo, &pBatch->acquireCmdBuffer));
+
+			VkSemaphoreCreateInfo semaphoreCreateInfo = VkTools::Initializer::SemaphoreCreateInfo();
+			VK_CHECK_RESULT(vkCreateSemaphore(m_Device, &semaphoreCreateInfo, nullptr, &pBatch->semaphore));
+		}
+
+		VkFenceCreateInfo fenceCreateInfo = VkTools::Initializer::FenceCreateInfo(VK_FLAGS_NONE);
+		VK_CHECK_RESULT(vkCreateFence(m_Device, &fenceCreateInfo, nullptr, &pBatch->fence));
+	}
+
+	pBatch->id = m_NextBatchId++;
+	pBatch->ringEnd = 0;
+	pBatch->ringBytes = 0;
+	pBatch->numCopies = 0;
+	return pBatch;
+}
+
+
+VulkanUploadManager::Batch* VulkanUploadManager::GetOpenBatch()
+{
+	if (m_pOpenBatch == nullptr)
+	{
+		m_pOpenBatch = AcquireBatch();
+
+		VkCommandBufferBeginInfo cmdBufInfo = VkTools::Initializer::CommandBufferBeginInfo();
+		cmdBufInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+		VK_CHECK_RESULT(vkBeginCommandBuffer(m_pOpenBatch->cmdBuffer, &cmdBufInfo));
+	}
+	return m_pOpenBatch;
+}
+
+
+bool VulkanUploadManager::AllocateFromRing(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize& offset)
+{
+	if (m_RingUsed == 0)
+	{
+		m_RingHead = 0;
+		m_RingTail = 0;
+	}
+	else if (m_RingHead == m_RingTail)
+	{
+		//Full
+		return false;
+	}
+
+	VkDeviceSize consumed = 0;
+	const VkDeviceSize aligned = AlignUp(m_RingHead, alignment);
+	if (m_RingHead >= m_RingTail)
+	{
+		//Free space is [head, ringSize) and [0, tail)
+		if (aligned + size <= m_RingSize)
+		{
+			offset = aligned;
+			consumed = aligned - m_RingHead + size;
+		}
+		else if (size < m_RingTail)
+		{
+			//Skip the end of the ring
+			offset = 0;
+			consumed = m_RingSize - m_RingHead + size;
+		}
+		else
+		{
+			return false;
+		}
+	}
+	else
+	{
+		//Free space is [head, tail)
+		if (aligned + size >= m_RingTail)
+			return false;
+
+		offset = aligned;
+		consumed = aligned - m_RingHead + size;
+	}
+
+	m_RingHead = offset + size;
+	m_RingUsed += consumed;
+
+	Batch* pBatch = GetOpenBatch();
+	pBatch->ringBytes += consumed;
+	pBatch->ringEnd = m_RingHead;
+	return true;
+}
+
+
+VkResult VulkanUploadManager::AllocateStaging(VkDeviceSize size, VkDeviceSize alignment, VkBuffer& buffer, VkDeviceSize& offset, uint8_t*& pMapped)
+{
+	if (size <= m_RingSize / 2)
+	{
+		bool bAllocated = AllocateFromRing(size, alignment, offset);
+		while (!bAllocated)
+		{
+			//Submit what we have and wait for the oldest batch to give its space back
+			if (m_pOpenBatch != nullptr && m_pOpenBatch->numCopies > 0)
+			{
+				FlushLocked();
+			}
+			if (m_InFlight.empty())
+				break;
+
+			m_Stats.numStalls++;
+			WaitLocked(m_InFlight.front()->id);
+			bAllocated = AllocateFromRing(size, alignment, offset);
+		}
+
+		if (bAllocated)
+		{
+			buffer = m_RingBuffer;
+			pMapped = static_cast<uint8_t*>(m_RingAllocation.pMapped) + offset;
+			return VK_SUCCESS;
+		}
+	}
+
+	//Too big for the ring, give it its own buffer
+	StagingBuffer staging;
+	VkBufferCreateInfo bufferCreateInfo = VkTools::Initializer::BufferCreateInfo(VK_BUFFER_USAGE_TRANSFER_SRC_BIT, size);
+	VK_CHECK_RESULT(vkCreateBuffer(m_Device, &bufferCreateInfo, nullptr, &staging.buffer));
+
+	VkResult result = memoryAllocator->AllocateBuffer(staging.buffer, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, staging.allocation);
+	if (result != VK_SUCCESS)
+	{
+		vkDestroyBuffer(m_Device, staging.buffer, nullptr);
+		return result;
+	}
+
+	GetOpenBatch()->stagingBuffers.push_back(staging);
+	buffer = staging.buffer;
+	offset = 0;
+	pMapped = static_cast<uint8_t*>(staging.allocation.pMapped);
+	return VK_SUCCESS;
+}
+
+
+void VulkanUploadManager::AddBufferRelease(Batch* pBatch, VkBuffer buffer, VkDeviceSize offset, VkDeviceSize size)
+{
+	if (!HasDedicatedTransfer())
+		return;
+
+	//Queue family ownership transfer, half of it recorded on each queue
+	VkBufferMemoryBarrier barrier = {};
+	barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+	barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.dstAccessMask = 0;
+	barrier.srcQueueFamilyIndex = m_TransferFamily;
+	barrier.dstQueueFamilyIndex = m_GraphicsFamily;
+	barrier.buffer = buffer;
+	barrier.offset = offset;
+	barrier.size = size;
+	pBatch->bufferBarriers.push_back(barrier);
+}
+
+
+VkResult VulkanUploadManager::UploadBuffer(VkBuffer dstBuffer, VkDeviceSize dstOffset, const void* pData, VkDeviceSize size)
+{
+	assert(pData && size > 0);
+	std::lock_guard<std::mutex> lock(m_Lock);
+
+	VkBuffer srcBuffer;
+	VkDeviceSize srcOffset;
+	uint8_t* pMapped;
+	VkResult result = AllocateStaging(size, BUFFER_STAGING_ALIGNMENT, srcBuffer, srcOffset, pMapped);
+	if (result != VK_SUCCESS)
+		return result;
+
+	memcpy(pMapped, pData, static_cast<size_t>(size));
+
+	Batch* pBatch = GetOpenBatch();
+	VkBufferCopy copyRegion = {};
+	copyRegion.srcOffset = srcOffset;
+	copyRegion.dstOffset = dstOffset;
+	copyRegion.size = size;
+	vkCmdCopyBuffer(pBatch->cmdBuffer, srcBuffer, dstBuffer, 1, &copyRegion);
+	AddBufferRelease(pBatch, dstBuffer, dstOffset, size);
+
+	pBatch->numCopies++;
+	m_Stats.numBufferCopies++;
+	m_Stats.uploadedBytes += size;
+	return VK_SUCCESS;
+}
+
+
+void VulkanUploadManager::CopyBuffer(VkBuffer& srcBuffer, VulkanAllocation& srcAllocation, VkBuffer dstBuffer, VkDeviceSize size)
+{
+	std::lock_guard<std::mutex> lock(m_Lock);
+
+	Batch* pBatch = GetOpenBatch();
+	VkBufferCopy copyRegion = {};
+	copyRegion.size = size;
+	vkCmdCopyBuffer(pBatch->cmdBuffer, srcBuffer, dstBuffer, 1, &copyRegion);
+	AddBufferRelease(pBatch, dstBuffer, 0, size);
+
+	StagingBuffer staging;
+	staging.buffer = srcBuffer;
+	staging.allocation = srcAllocation;
+	pBatch->stagingBuffers.push_back(staging);
+
+	srcBuffer = VK_NULL_HANDLE;
+	srcAllocation = VulkanAllocation();
+
+	pBatch->numCopies++;
+	m_Stats.numBufferCopies++;
+	m_Stats.uploadedBytes += size;
+}
+
+
+VkResult VulkanUploadManager::UploadImage(VkImage image, const VkImageSubresourceRange& range, const void* pData, VkDeviceSize size, const VkBufferImageCopy* pRegions, uint32_t regionCount, VkImageLayout finalLayout)
+{
+	assert(pData && size > 0 && regionCount > 0);
+	std::lock_guard<std::mutex> lock(m_Lock);
+
+	VkBuffer srcBuffer;
+	VkDeviceSize srcOffset;
+	uint8_t* pMapped;
+	VkResult result = AllocateStaging(size, IMAGE_STAGING_ALIGNMENT, srcBuffer, srcOffset, pMapped);
+	if (result != VK_SUCCESS)
+		return result;
+
+	memcpy(pMapped, pData, static_cast<size_t>(size));
+
+	Batch* pBatch = GetOpenBatch();
+
+	//Previous content is thrown away, no ownership transfer needed for this one
+	VkImageMemoryBarrier barrier = VkTools::Initializer::ImageMemoryBarrier();
+	barrier.srcAccessMask = 0;
+	barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.image = image;
+	barrier.subresourceRange = range;
+	vkCmdPipelineBarrier(pBatch->cmdBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+	std::vector<VkBufferImageCopy> regions(pRegions, pRegions + regionCount);
+	for (VkBufferImageCopy& region : regions)
+	{
+		region.bufferOffset += srcOffset;
+	}
+	vkCmdCopyBufferToImage(pBatch->cmdBuffer, srcBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, regionCount, regions.data());
+
+	//Final layout change, recorded for all images of the batch at once on Flush
+	barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.dstAccessMask = HasDedicatedTransfer() ? 0 : VK_ACCESS_SHADER_READ_BIT;
+	barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	barrier.newLayout = finalLayout;
+	if (HasDedicatedTransfer())
+	{
+		barrier.srcQueueFamilyIndex = m_TransferFamily;
+		barrier.dstQueueFamilyIndex = m_GraphicsFamily;
+	}
+	pBatch->imageBarriers.push_back(barrier);
+
+	pBatch->numCopies++;
+	m_Stats.numImageCopies++;
+	m_Stats.uploadedBytes += size;
+	return VK_SUCCESS;
+}
+
+
+uint64_t VulkanUploadManager::Flush()
+{
+	std::lock_guard<std::mutex> lock(m_Lock);
+	return FlushLocked();
+}
+
+
+uint64_t VulkanUploadManager::FlushLocked()
+{
+	Batch* pBatch = m_pOpenBatch;
+	if (pBatch == nullptr)
+		return 0;
+
+	if (pBatch->numCopies == 0)
+	{
+		//Only possible if staging failed, nothing to submit
+		VK_CHECK_RESULT(vkEndCommandBuffer(pBatch->cmdBuffer));
+		m_pOpenBatch = nullptr;
+		RetireBatch(pBatch);
+		return 0;
+	}
+
+	if (HasDedicatedTransfer())
+	{
+		//Release on transfer queue
+		vkCmdPipelineBarrier(pBatch->cmdBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0,
+			0, nullptr,
+			static_cast<uint32_t>(pBatch->bufferBarriers.size()), pBatch->bufferBarriers.data(),
+			static_cast<uint32_t>(pBatch->imageBarriers.size()), pBatch->imageBarriers.data());
+		VK_CHECK_RESULT(vkEndCommandBuffer(pBatch->cmdBuffer));
+
+		VkSubmitInfo submitInfo = VkTools::Initializer::SubmitInfo();
+		submitInfo.commandBufferCount = 1;
+		submitInfo.pCommandBuffers = &pBatch->cmdBuffer;
+		submitInfo.signalSemaphoreCount = 1;
+		submitInfo.pSignalSemaphores = &pBatch->semaphore;
+		VK_CHECK_RESULT(vkQueueSubmit(m_TransferQueue, 1, &submitInfo, VK_NULL_HANDLE));
+
+		//Acquire on graphics queue, same barriers with the access masks on the other side
+		for (VkBufferMemoryBarrier& barrier : pBatch->bufferBarriers)
+		{
+			barrier.srcAccessMask = 0;
+			barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
+		}
+		for (VkImageMemoryBarrier& barrier : pBatch->imageBarriers)
+		{
+			barrier.srcAccessMask = 0;
+			barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+		}
+
+		VkCommandBufferBeginInfo cmdBufInfo = VkTools::Initializer::CommandBufferBeginInfo();
+		cmdBufInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+		VK_CHECK_RESULT(vkBeginCommandBuffer(pBatch->acquireCmdBuffer, &cmdBufInfo));
+		vkCmdPipelineBarrier(pBatch->acquireCmdBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0,
+			0, nullptr,
+			static_cast<uint32_t>(pBatch->bufferBarriers.size()), pBatch->bufferBarriers.data(),
+			static_cast<uint32_t>(pBatch->imageBarriers.size()), pBatch->imageBarriers.data());
+		VK_CHECK_RESULT(vkEndCommandBuffer(pBatch->acquireCmdBuffer));
+
+		VkPipelineStageFlags waitStage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+		submitInfo.pCommandBuffers = &pBatch->acquireCmdBuffer;
+		submitInfo.signalSemaphoreCount = 0;
+		submitInfo.pSignalSemaphores = nullptr;
+		submitInfo.waitSemaphoreCount = 1;
+		submitInfo.pWaitSemaphores = &pBatch->semaphore;
+		submitInfo.pWaitDstStageMask = &waitStage;
+		VK_CHECK_RESULT(vkQueueSubmit(m_GraphicsQueue, 1, &submitInfo, pBatch->fence));
+	}
+	else
+	{
+		//Same queue, make copies visible to everything submitted after this batch
+		VkMemoryBarrier memoryBarrier = {};
+		memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		memoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		memoryBarrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
+		vkCmdPipelineBarrier(pBatch->cmdBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0,
+			1, &memoryBarrier,
+			0, nullptr,
+			static_cast<uint32_t>(pBatch->imageBarriers.size()), pBatch->imageBarriers.data());
+		VK_CHECK_RESULT(vkEndCommandBuffer(pBatch->cmdBuffer));
+
+		VkSubmitInfo submitInfo = VkTools::Initializer::SubmitInfo();
+		submitInfo.commandBufferCount = 1;
+		submitInfo.pCommandBuffers = &pBatch->cmdBuffer;
+		VK_CHECK_RESULT(vkQueueSubmit(m_TransferQueue, 1, &submitInfo, pBatch->fence));
+	}
+
+	m_InFlight.push_back(pBatch);
+	m_pOpenBatch = nullptr;
+	m_Stats.numBatches++;
+	return pBatch->id;
+}
+
+
+void VulkanUploadManager::RetireBatch(Batch* pBatch)
+{
+	for (StagingBuffer& staging : pBatch->stagingBuffers)
+	{
+		vkDestroyBuffer(m_Device, staging.buffer, nullptr);
+		memoryAllocator->Free(staging.allocation);
+	}
+	pBatch->stagingBuffers.clear();
+	pBatch->bufferBarriers.clear();
+	pBatch->imageBarriers.clear();
+
+	//Batches finish in submit order, so the ring tail only moves forward
+	if (pBatch->ringBytes > 0)
+	{
+		m_RingTail = pBatch->ringEnd;
+		m_RingUsed -= pBatch->ringBytes;
+	}
+
+	m_LastFinishedId = pBatch->id;
+	m_FreeBatches.push_back(pBatch);
+}
+
+
+void VulkanUploadManager::WaitLocked(uint64_t batchId)
+{
+	while (!m_InFlight.empty() && m_InFlight.front()->id <= batchId)
+	{
+		Batch* pBatch = m_InFlight.front();
+		VK_CHECK_RESULT(vkWaitForFences(m_Device, 1, &pBatch->fence, VK_TRUE, UINT64_MAX));
+		VK_CHECK_RESULT(vkResetFences(m_Device, 1, &pBatch->fence));
+
+		m_InFlight.pop_front();
+		RetireBatch(pBatch);
+	}
+}
+
+
+void VulkanUploadManager::Wait(uint64_t batchId)
+{
+	std::lock_guard<std::mutex> lock(m_Lock);
+	if (m_pOpenBatch != nullptr && m_pOpenBatch->id <= batchId)
+	{
+		FlushLocked();
+	}
+	WaitLocked(batchId);
+}
+
+
+void VulkanUploadManager::WaitIdle()
+{
+	std::lock_guard<std::mutex> lock(m_Lock);
+	FlushLocked();
+	WaitLocked(UINT64_MAX);
+}
+
+
+void VulkanUploadManager::Update()
+{
+	std::lock_guard<std::mutex> lock(m_Lock);
+	while (!m_InFlight.empty() && vkGetFenceStatus(m_Device, m_InFlight.front()->fence) == VK_SUCCESS)
+	{
+		Batch* pBatch = m_InFlight.front();
+		VK_CHECK_RESULT(vkResetFences(m_Device, 1, &pBatch->fence));
+
+		m_InFlight.pop_front();
+		RetireBatch(pBatch);
+	}
+}
+
+
+VulkanUploadStats VulkanUploadManager::GetStats() const
+{
+	std::lock_guard<std::mutex> lock(m_Lock);
+	VulkanUploadStats stats = m_Stats;
+	stats.ringUsed = m_RingUsed;
+	stats.numInFlight = static_cast<uint32_t>(m_InFlight.size());
+	return stats;
+}
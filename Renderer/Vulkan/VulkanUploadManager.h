@@ -0,0 +1,186 @@
+/*
+*	Copyright 2015-2016 Tomas Mikalauskas. All rights reserved.
+*	GitHub repository - https://github.com/TywyllSoftware/TywRenderer
+*	This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+#pragma once
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <External/vulkan/vulkan.h>
+#include "VulkanMemoryAllocator.h"
+
+
+struct VulkanUploadStats
+{
+	uint64_t		numBatches;			// submitted batches
+	uint64_t		numBufferCopies;
+	uint64_t		numImageCopies;
+	uint64_t		uploadedBytes;
+	uint64_t		numStalls;			// times an upload had to wait for the gpu to free staging memory
+
+	VkDeviceSize	ringSize;
+	VkDeviceSize	ringUsed;			// staging bytes still owned by pending or in flight batches
+	uint32_t		numInFlight;		// submitted batches whose fence has not signaled yet
+	bool			bDedicatedTransferQueue;
+};
+
+
+/*
+	VulkanUploadManager
+	Gathers buffer and image uploads into one command buffer and submits them
+	together with a fence, instead of one submit and queue wait per resource.
+
+	Data is copied into a persistently mapped staging ring. Ring space of a batch
+	is given back only after its fence has signaled. Uploads larger than the ring
+	get their own staging buffer, released the same way.
+
+	When the device has a transfer only queue family, copies run there and
+	ownership of the destination resources is handed over to the graphics family.
+	The graphics side acquire is submitted right after the copies, so later graphics
+	submits see the data without waiting on the CPU.
+
+	Queued uploads reach the gpu on Flush. Flush before submitting work that reads them.
+	Manager state is locked, but Flush submits to the queues, so it must not run
+	while another thread submits to the same queue.
+*/
+class VulkanUploadManager
+{
+public:
+	/*
+		@param: VkDevice device
+		@param: VkQueue graphicsQueue
+		@param: uint32_t graphicsFamily
+		@param: VkQueue transferQueue - same as graphicsQueue when there is no dedicated transfer queue
+		@param: uint32_t transferFamily
+		@param: VkDeviceSize ringSize
+	*/
+	VulkanUploadManager(VkDevice device, VkQueue graphicsQueue, uint32_t graphicsFamily, VkQueue transferQueue, uint32_t transferFamily, VkDeviceSize ringSize = 32 * 1024 * 1024);
+	~VulkanUploadManager();
+
+	/*
+		Copies data into staging memory and queues copy to dstBuffer
+
+		@param: VkBuffer dstBuffer - created with VK_BUFFER_USAGE_TRANSFER_DST_BIT
+		@param: VkDeviceSize dstOffset
+		@param: const void* pData
+		@param: VkDeviceSize size
+		@return: VkResult
+	*/
+	VkResult UploadBuffer(VkBuffer dstBuffer, VkDeviceSize dstOffset, const void* pData, VkDeviceSize size);
+
+	/*
+		Queues copy from a staging buffer that caller has already filled.
+		Manager takes ownership of the staging buffer and its allocation and destroys
+		them once the copy has finished. Both are reset on return
+
+		@param: VkBuffer& srcBuffer
+		@param: VulkanAllocation& srcAllocation
+		@param: VkBuffer dstBuffer
+		@param: VkDeviceSize size
+	*/
+	void CopyBuffer(VkBuffer& srcBuffer, VulkanAllocation& srcAllocation, VkBuffer dstBuffer, VkDeviceSize size);
+
+	/*
+		Copies data into staging memory and queues copy to image. Image goes from
+		undefined layout to finalLayout. Region bufferOffsets are relative to pData
+
+		@param: VkImage image
+		@param: const VkImageSubresourceRange& range - all subresources written by the regions
+		@param: const void* pData
+		@param: VkDeviceSize size
+		@param: const VkBufferImageCopy* pRegions
+		@param: uint32_t regionCount
+		@param: VkImageLayout finalLayout
+		@return: VkResult
+	*/
+	VkResult UploadImage(VkImage image, const VkImageSubresourceRange& range, const void* pData, VkDeviceSize size, const VkBufferImageCopy* pRegions, uint32_t regionCount, VkImageLayout finalLayout);
+
+	/*
+		Submits all queued uploads
+
+		@return: uint64_t - batch id to wait on, 0 if nothing was queued
+	*/
+	uint64_t Flush();
+
+	/*
+		Blocks until given batch and all batches before it have finished
+
+		@param: uint64_t batchId
+	*/
+	void Wait(uint64_t batchId);
+
+	//Flushes and waits for everything
+	void WaitIdle();
+
+	//Gives back staging memory of finished batches. Cheap, call once per frame
+	void Update();
+
+	VulkanUploadStats GetStats() const;
+
+private:
+	VulkanUploadManager(const VulkanUploadManager&) = delete;
+	VulkanUploadManager& operator=(const VulkanUploadManager&) = delete;
+
+	struct StagingBuffer
+	{
+		VkBuffer			buffer;
+		VulkanAllocation	allocation;
+	};
+
+	struct Batch
+	{
+		uint64_t					id;
+		VkCommandBuffer				cmdBuffer;			// transfer family
+		VkCommandBuffer				acquireCmdBuffer;	// graphics family, only with dedicated transfer queue
+		VkSemaphore					semaphore;
+		VkFence						fence;
+
+		VkDeviceSize				ringEnd;			// ring head after last allocation of batch
+		VkDeviceSize				ringBytes;			// ring bytes consumed, including wrap padding
+		std::vector<StagingBuffer>	stagingBuffers;
+
+		std::vector<VkBufferMemoryBarrier>	bufferBarriers;
+		std::vector<VkImageMemoryBarrier>	imageBarriers;
+		uint32_t					numCopies;
+	};
+
+	Batch* GetOpenBatch();
+	Batch* AcquireBatch();
+	VkResult AllocateStaging(VkDeviceSize size, VkDeviceSize alignment, VkBuffer& buffer, VkDeviceSize& offset, uint8_t*& pMapped);
+	bool AllocateFromRing(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize& offset);
+	uint64_t FlushLocked();
+	void WaitLocked(uint64_t batchId);
+	void RetireBatch(Batch* pBatch);
+	void AddBufferRelease(Batch* pBatch, VkBuffer buffer, VkDeviceSize offset, VkDeviceSize size);
+
+	bool HasDedicatedTransfer() const { return m_GraphicsFamily != m_TransferFamily; }
+
+private:
+	VkDevice				m_Device;
+	VkQueue					m_GraphicsQueue;
+	VkQueue					m_TransferQueue;
+	uint32_t				m_GraphicsFamily;
+	uint32_t				m_TransferFamily;
+
+	VkCommandPool			m_TransferCmdPool;
+	VkCommandPool			m_GraphicsCmdPool;	// acquire barriers, only with dedicated transfer queue
+
+	VkBuffer				m_RingBuffer;
+	VulkanAllocation		m_RingAllocation;
+	VkDeviceSize			m_RingSize;
+	VkDeviceSize			m_RingHead;
+	VkDeviceSize			m_RingTail;
+	VkDeviceSize			m_RingUsed;
+
+	mutable std::mutex		m_Lock;
+	Batch*					m_pOpenBatch;
+	std::deque<Batch*>		m_InFlight;			// oldest first
+	std::vector<Batch*>		m_FreeBatches;
+	uint64_t				m_NextBatchId;
+	uint64_t				m_LastFinishedId;
+
+	VulkanUploadStats		m_Stats;
+};
+
+extern VulkanUploadManager* uploadManager;
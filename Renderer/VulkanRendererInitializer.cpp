@@ -3,16 +3,23 @@
 *	GitHub repository - https://github.com/TywyllSoftware/TywRenderer
 *	This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
 */
-#include <RendererPch\stdafx.h>
+#include <RendererPch/stdafx.h>
 
 
 //Vulkan Includes
-#include "Vulkan\VulkanTools.h"
-#include "Vulkan\VulkanDebug.h"
+#include "Vulkan/VulkanTools.h"
+#include "Vulkan/VulkanDebug.h"
+#include "Vulkan/VulkanUploadManager.h"
+#include "Vulkan/VulkanFrameManager.h"
+#include "Vulkan/VulkanDescriptorAllocator.h"
 
 //Renderer Includes
 #include "VKRenderer.h"
 
+#if defined(__linux__)
+#include <unistd.h>
+#endif
+
 
 
 
@@ -30,8 +37,12 @@ std::string titleName = "Vulkan demo";
 
 
 
-VulkanRendererInitializer::VulkanRendererInitializer(): m_bPrepared(false)
+VulkanRendererInitializer::VulkanRendererInitializer(): m_bPrepared(false), m_bHeadless(false)
 {
+#if defined(__linux__) && !defined(__ANDROID__)
+	connection = nullptr;
+	window = 0;
+#endif
 
 }
 
@@ -66,9 +77,12 @@ VulkanRendererInitializer::~VulkanRendererInitializer()
 
 	vkDestroyImageView(m_SwapChain.device,m_DepthStencil.view, nullptr);
 	vkDestroyImage(m_SwapChain.device, m_DepthStencil.image, nullptr);
-	vkFreeMemory(m_SwapChain.device, m_DepthStencil.mem, nullptr);
+	memoryAllocator->Free(m_DepthStencil.allocation);
 
-	vkDestroyPipelineCache(m_SwapChain.device, m_PipelineCache, nullptr);
+	//Pipelines compiled this run make next startup faster
+	m_PipelineCacheFile.Save();
+	m_PipelineCacheFile.Destroy();
+	m_PipelineCache = VK_NULL_HANDLE;
 	vkDestroyFence(m_SwapChain.device, m_Fence, nullptr);
 	vkDestroyCommandPool(m_SwapChain.device, m_CmdPool, nullptr);
 
@@ -79,6 +93,18 @@ VulkanRendererInitializer::~VulkanRendererInitializer()
 	//Clean swapchain
 	m_SwapChain.Cleanup();
 
+	//Waits for frames in flight and runs their deferred destructions
+	SAFE_DELETE(frameManager);
+
+	//Frees every descriptor set handed out at load time
+	SAFE_DELETE(descriptorAllocator);
+
+	//Waits for pending uploads and returns staging memory
+	SAFE_DELETE(uploadManager);
+
+	//Every allocation has to be returned by now
+	SAFE_DELETE(memoryAllocator);
+
 	vkDestroyDevice(m_SwapChain.device, nullptr);
 	vkDestroyInstance(m_SwapChain.instance, nullptr);
 
@@ -86,8 +112,11 @@ VulkanRendererInitializer::~VulkanRendererInitializer()
 #if defined(__ANDROID__)
 	// todo : android cleanup (if required)
 #else
-	xcb_destroy_window(connection, window);
-	xcb_disconnect(connection);
+	if (!m_bHeadless)
+	{
+		xcb_destroy_window(connection, window);
+		xcb_disconnect(connection);
+	}
 #endif
 #endif
 }
@@ -107,12 +136,19 @@ bool VulkanRendererInitializer::CreateRendererScreen(uint32_t height, uint32_t w
 	}
 
 #if defined (_WIN32)
-	CreateWindows(widht, height, MainWindowProc);
+	if (!m_bHeadless)
+	{
+		CreateWindows(widht, height, MainWindowProc);
+	}
 
 #elif defined (__ANDROID__)
 
 #elif defined (__linux__)
-
+	if (!m_bHeadless)
+	{
+		fprintf(stderr, "No window support on Linux, set TYW_HEADLESS=<frames>\n");
+		return false;
+	}
 #endif
 
 
@@ -156,26 +192,42 @@ bool VulkanRendererInitializer::CreateRendererScreen(uint32_t height, uint32_t w
 
 	// Get the graphics queue
 	vkGetDeviceQueue(m_SwapChain.device, m_graphicsQueueIndex, 0, &m_Queue);
+	vkGetDeviceQueue(m_SwapChain.device, m_transferQueueIndex, 0, &m_TransferQueue);
+	vkGetDeviceQueue(m_SwapChain.device, m_computeQueueIndex, 0, &m_ComputeQueue);
 	vkGetPhysicalDeviceMemoryProperties(m_SwapChain.physicalDevice, &m_DeviceMemoryProperties);
+	vkGetPhysicalDeviceProperties(m_SwapChain.physicalDevice, &m_DeviceProperties);
 	vkGetPhysicalDeviceFeatures(m_SwapChain.physicalDevice, &m_DeviceFeatures);
 
+	memoryAllocator = TYW_NEW VulkanMemoryAllocator(m_SwapChain.physicalDevice, m_SwapChain.device);
+	uploadManager = TYW_NEW VulkanUploadManager(m_SwapChain.device, m_Queue, m_graphicsQueueIndex, m_TransferQueue, m_transferQueueIndex);
+	frameManager = TYW_NEW VulkanFrameManager(m_SwapChain.device, m_graphicsQueueIndex, m_QueueFamilyProperties[m_graphicsQueueIndex].timestampValidBits, m_DeviceProperties.limits.timestampPeriod);
+	descriptorAllocator = TYW_NEW VulkanDescriptorAllocator(m_SwapChain.device);
+
 	// Find a suitable depth format
 	VkBool32 validDepthFormat = VkTools::GetSupportedDepthFormat(m_SwapChain.physicalDevice, m_SwapChain.depthFormat);
 	assert(validDepthFormat);
 
 
-	//Get all functions for swapchain
-	m_SwapChain.Connect();
+	if (m_bHeadless)
+	{
+		//Offscreen images, acquire and present run on the graphics queue
+		m_SwapChain.InitHeadless(m_Queue, m_graphicsQueueIndex);
+	}
+	else
+	{
+		//Get all functions for swapchain
+		m_SwapChain.Connect();
 
 
-	//Create surface
+		//Create surface
 #if defined(_WIN32)
-	m_SwapChain.initSurface(m_hinstance, m_HwndWindows);
+		m_SwapChain.initSurface(m_hinstance, m_HwndWindows);
 #elif defined(__ANDROID__)	
-	m_SwapChain.initSurface(androidApp->window);
+		m_SwapChain.initSurface(androidApp->window);
 #elif defined(__linux__)
-	m_SwapChain.initSurface(connection, window);
+		m_SwapChain.initSurface(connection, window);
 #endif
+	}
 
 
 	// Create synchronization objects
@@ -254,6 +306,7 @@ bool VulkanRendererInitializer::PrepareVulkan(uint32_t width, uint32_t height, b
 
 bool VulkanRendererInitializer::CreateWindows(uint32_t width, uint32_t height, LRESULT(CALLBACK MainWindowProc)(HWND, UINT, WPARAM, LPARAM))
 {
+#if defined(_WIN32)
 	bool fullscreen = false;
 	WNDCLASSEX wndClass;
 
@@ -365,6 +418,11 @@ bool VulkanRendererInitializer::CreateWindows(uint32_t width, uint32_t height, L
 	UpdateWindow(m_HwndWindows);
 	SetForegroundWindow(m_HwndWindows);
 	SetFocus(m_HwndWindows);
+	return true;
+#else
+	//Windowed mode needs a platform layer, other platforms only run headless
+	return false;
+#endif
 }
 
 VkResult VulkanRendererInitializer::CreateVulkanInstance(bool bEnableValidation)
@@ -376,16 +434,25 @@ VkResult VulkanRendererInitializer::CreateVulkanInstance(bool bEnableValidation)
 	appInfo.apiVersion = VK_API_VERSION_1_0;
 
 
-	std::vector<const char*> enabledExtensions = { VK_KHR_SURFACE_EXTENSION_NAME };
+	std::vector<const char*> enabledExtensions;
 
 	// Enable surface extensions depending on os
+	// Headless instances need none, software drivers without a window system work too
+	if (!m_bHeadless)
+	{
+		enabledExtensions.push_back(VK_KHR_SURFACE_EXTENSION_NAME);
 #if defined(_WIN32)
-	enabledExtensions.push_back(VK_KHR_WIN32_SURFACE_EXTENSION_NAME);
+		enabledExtensions.push_back(VK_KHR_WIN32_SURFACE_EXTENSION_NAME);
 #elif defined(__ANDROID__)
-	enabledExtensions.push_back(VK_KHR_ANDROID_SURFACE_EXTENSION_NAME);
+		enabledExtensions.push_back(VK_KHR_ANDROID_SURFACE_EXTENSION_NAME);
 #elif defined(__linux__)
-	enabledExtensions.push_back(VK_KHR_XCB_SURFACE_EXTENSION_NAME);
+		enabledExtensions.push_back(VK_KHR_XCB_SURFACE_EXTENSION_NAME);
 #endif
+	}
+	if (bEnableValidation)
+	{
+		enabledExtensions.push_back(VK_EXT_DEBUG_REPORT_EXTENSION_NAME);
+	}
 
 
 	VkInstanceCreateInfo instanceCreateInfo = {};
@@ -394,10 +461,6 @@ VkResult VulkanRendererInitializer::CreateVulkanInstance(bool bEnableValidation)
 	instanceCreateInfo.pApplicationInfo = &appInfo;
 	if (enabledExtensions.size() > 0)
 	{
-		if (bEnableValidation)
-		{
-			enabledExtensions.push_back(VK_EXT_DEBUG_REPORT_EXTENSION_NAME);
-		}
 		instanceCreateInfo.enabledExtensionCount = (uint32_t)enabledExtensions.size();
 		instanceCreateInfo.ppEnabledExtensionNames = enabledExtensions.data();
 	}
@@ -502,6 +565,30 @@ void VulkanRendererInitializer::GetDeviceQueues()
 			printf("\t\t Sparse Binding\n");
 		}
 	}
+
+	// Transfer only family runs copies next to graphics work (dma engine on discrete gpus)
+	m_transferQueueIndex = m_graphicsQueueIndex;
+	for (uint32_t j = 0; j < queueFamilyCount; j++)
+	{
+		const VkQueueFlags flags = m_QueueFamilyProperties[j].queueFlags;
+		if ((flags & VK_QUEUE_TRANSFER_BIT) && !(flags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT)))
+		{
+			m_transferQueueIndex = j;
+			break;
+		}
+	}
+
+	// Compute family without graphics runs compute passes next to graphics work (async compute)
+	m_computeQueueIndex = m_graphicsQueueIndex;
+	for (uint32_t j = 0; j < queueFamilyCount; j++)
+	{
+		const VkQueueFlags flags = m_QueueFamilyProperties[j].queueFlags;
+		if ((flags & VK_QUEUE_COMPUTE_BIT) && !(flags & VK_QUEUE_GRAPHICS_BIT))
+		{
+			m_computeQueueIndex = j;
+			break;
+		}
+	}
 }
 
 
@@ -509,29 +596,60 @@ VkResult VulkanRendererInitializer::CreateDevice()
 {
 	// Here's where we initialize our queues
 	std::array<float, 1> queuePriorities = { 0.0f };
-	VkDeviceQueueCreateInfo deviceQueueInfo;
-	deviceQueueInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
-	deviceQueueInfo.queueFamilyIndex = m_graphicsQueueIndex;
-	deviceQueueInfo.queueCount = 1;
-	deviceQueueInfo.pQueuePriorities = queuePriorities.data();
-	deviceQueueInfo.pNext = NULL;
-	deviceQueueInfo.flags = 0;
+	std::array<VkDeviceQueueCreateInfo, 3> deviceQueueInfos;
+	deviceQueueInfos[0].sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+	deviceQueueInfos[0].queueFamilyIndex = m_graphicsQueueIndex;
+	deviceQueueInfos[0].queueCount = 1;
+	deviceQueueInfos[0].pQueuePriorities = queuePriorities.data();
+	deviceQueueInfos[0].pNext = NULL;
+	deviceQueueInfos[0].flags = 0;
+
+	// Dedicated transfer queue, if GetDeviceQueues found one
+	uint32_t queueCreateInfoCount = 1;
+	if (m_transferQueueIndex != m_graphicsQueueIndex)
+	{
+		deviceQueueInfos[1] = deviceQueueInfos[0];
+		deviceQueueInfos[1].queueFamilyIndex = m_transferQueueIndex;
+		queueCreateInfoCount++;
+	}
+
+	// Dedicated compute queue, transfer only families never have compute
+	if (m_computeQueueIndex != m_graphicsQueueIndex)
+	{
+		deviceQueueInfos[queueCreateInfoCount] = deviceQueueInfos[0];
+		deviceQueueInfos[queueCreateInfoCount].queueFamilyIndex = m_computeQueueIndex;
+		queueCreateInfoCount++;
+	}
 
 
 
-	std::vector<const char*> enabledExtensions = { VK_KHR_SWAPCHAIN_EXTENSION_NAME };
+	std::vector<const char*> enabledExtensions;
 	VkPhysicalDeviceFeatures enabledFeatures = {};
-	enabledFeatures.tessellationShader = true;
-	enabledFeatures.shaderTessellationAndGeometryPointSize = true;
-	enabledFeatures.geometryShader = true;
-	enabledFeatures.shaderClipDistance = true;
-	enabledFeatures.shaderCullDistance = true;
+
+	// Headless images still end in PRESENT_SRC_KHR layout through the render passes and
+	// pre present barriers, which is only allowed with the extension. Take it if it is there
+	if (!m_bHeadless || VkTools::CheckDeviceExtensionPresent(m_SwapChain.physicalDevice, VK_KHR_SWAPCHAIN_EXTENSION_NAME))
+	{
+		enabledExtensions.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
+	}
+	// Only the SSAO debug normals view needs geometry shaders. Software devices used for
+	// headless runs lack them, take what is supported instead of failing device creation
+	VkPhysicalDeviceFeatures supportedFeatures;
+	vkGetPhysicalDeviceFeatures(m_SwapChain.physicalDevice, &supportedFeatures);
+	enabledFeatures.tessellationShader = supportedFeatures.tessellationShader;
+	enabledFeatures.shaderTessellationAndGeometryPointSize = supportedFeatures.shaderTessellationAndGeometryPointSize;
+	enabledFeatures.geometryShader = supportedFeatures.geometryShader;
+	enabledFeatures.shaderClipDistance = supportedFeatures.shaderClipDistance;
+	enabledFeatures.shaderCullDistance = supportedFeatures.shaderCullDistance;
+
+	// VulkanGpuProfiler adds pipeline statistics to top level scopes
+	enabledFeatures.pipelineStatisticsQuery = supportedFeatures.pipelineStatisticsQuery;
 
 	VkDeviceCreateInfo deviceCreateInfo = {};
 	deviceCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
 	deviceCreateInfo.pNext = NULL;
-	deviceCreateInfo.queueCreateInfoCount = 1;
-	deviceCreateInfo.pQueueCreateInfos = &deviceQueueInfo;
+	deviceCreateInfo.queueCreateInfoCount = queueCreateInfoCount;
+	deviceCreateInfo.pQueueCreateInfos = deviceQueueInfos.data();
 	deviceCreateInfo.pEnabledFeatures = &enabledFeatures;
 
 	// enable the debug marker extension if it is present (likely meaning a debugging tool is present)
@@ -557,7 +675,7 @@ bool VulkanRendererInitializer::CreateSurface()
 	m_SwapChain.fpGetPhysicalDeviceSurfaceFormatsKHR = nullptr;
 	
 	// somewhere in initialization code
-	*(void **)&m_SwapChain.fpGetPhysicalDeviceSurfaceFormatsKHR = vkGetInstanceProcAddr(m_SwapChain.instance, "vkGetPhysicalDeviceSurfaceFormatsKHR");
+	m_SwapChain.fpGetPhysicalDeviceSurfaceFormatsKHR = reinterpret_cast<PFN_vkGetPhysicalDeviceSurfaceFormatsKHR>(vkGetInstanceProcAddr(m_SwapChain.instance, "vkGetPhysicalDeviceSurfaceFormatsKHR"));
 	if (!m_SwapChain.fpGetPhysicalDeviceSurfaceFormatsKHR) {
 		return false;
 	}
@@ -837,12 +955,6 @@ void VulkanRendererInitializer::SetupDepthStencil(uint32_t& width, uint32_t& hei
 	image.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
 	image.flags = 0;
 
-	VkMemoryAllocateInfo mem_alloc = {};
-	mem_alloc.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-	mem_alloc.pNext = NULL;
-	mem_alloc.allocationSize = 0;
-	mem_alloc.memoryTypeIndex = 0;
-
 	VkImageViewCreateInfo depthStencilView = {};
 	depthStencilView.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
 	depthStencilView.pNext = NULL;
@@ -856,15 +968,11 @@ void VulkanRendererInitializer::SetupDepthStencil(uint32_t& width, uint32_t& hei
 	depthStencilView.subresourceRange.baseArrayLayer = 0;
 	depthStencilView.subresourceRange.layerCount = 1;
 
-	VkMemoryRequirements memReqs;
-
 	VK_CHECK_RESULT(vkCreateImage(m_SwapChain.device, &image, nullptr, &m_DepthStencil.image));
-	vkGetImageMemoryRequirements(m_SwapChain.device, m_DepthStencil.image, &memReqs);
-	mem_alloc.allocationSize = memReqs.size;
-	mem_alloc.memoryTypeIndex = VkTools::GetMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_DeviceMemoryProperties);
-	VK_CHECK_RESULT(vkAllocateMemory(m_SwapChain.device, &mem_alloc, nullptr, &m_DepthStencil.mem));
 
-	VK_CHECK_RESULT(vkBindImageMemory(m_SwapChain.device, m_DepthStencil.image, m_DepthStencil.mem, 0));
+	//Recreated on resize, keep it out of the shared blocks
+	VK_CHECK_RESULT(memoryAllocator->AllocateImage(m_DepthStencil.image, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, VK_IMAGE_TILING_OPTIMAL, true, m_DepthStencil.allocation));
+	m_DepthStencil.mem = VK_NULL_HANDLE;
 	VkTools::SetImageLayout(
 		m_SetupCmdBuffer,
 		m_DepthStencil.image,
@@ -936,11 +1044,44 @@ void VulkanRendererInitializer::SetupRenderPass()
 
 
 
+//Executable path with extension replaced, e.g. Bin/SSAO.exe -> Bin/SSAO.pipelinecache.
+//Falls back to the working directory when the path can not be queried
+static std::string GetPipelineCacheFileName()
+{
+	std::string path;
+#if defined(_WIN32)
+	char buffer[MAX_PATH];
+	const DWORD length = GetModuleFileNameA(nullptr, buffer, MAX_PATH);
+	if (length > 0 && length < MAX_PATH)
+	{
+		path.assign(buffer, length);
+	}
+#elif defined(__linux__)
+	char buffer[4096];
+	const ssize_t length = readlink("/proc/self/exe", buffer, sizeof(buffer));
+	if (length > 0 && static_cast<size_t>(length) < sizeof(buffer))
+	{
+		path.assign(buffer, static_cast<size_t>(length));
+	}
+#endif
+	if (path.empty())
+	{
+		return "PipelineCache.bin";
+	}
+
+	const size_t separator = path.find_last_of("\\/");
+	const size_t extension = path.find_last_of('.');
+	if (extension != std::string::npos && (separator == std::string::npos || extension > separator))
+	{
+		path.erase(extension);
+	}
+	return path + ".pipelinecache";
+}
+
 void VulkanRendererInitializer::CreatePipelineCache()
 {
-	VkPipelineCacheCreateInfo pipelineCacheCreateInfo = {};
-	pipelineCacheCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
-	VK_CHECK_RESULT(vkCreatePipelineCache(m_SwapChain.device, &pipelineCacheCreateInfo, nullptr, &m_PipelineCache));
+	//Lives next to the executable, every sample keeps its own
+	m_PipelineCache = m_PipelineCacheFile.Create(m_SwapChain.device, m_DeviceProperties, GetPipelineCacheFileName());
 }
 
 void VulkanRendererInitializer::SetupFrameBuffer(uint32_t& width, uint32_t& height)
@@ -1024,7 +1165,7 @@ void VulkanRendererInitializer::WindowResize(uint32_t width, uint32_t height)
 
 	vkDestroyImageView(m_SwapChain.device, m_DepthStencil.view, nullptr);
 	vkDestroyImage(m_SwapChain.device, m_DepthStencil.image, nullptr);
-	vkFreeMemory(m_SwapChain.device, m_DepthStencil.mem, nullptr);
+	memoryAllocator->Free(m_DepthStencil.allocation);
 	SetupDepthStencil(width, height);
 
 	for (uint32_t i = 0; i < m_FrameBuffers.size(); i++)
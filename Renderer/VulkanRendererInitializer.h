@@ -5,11 +5,14 @@
 */
 #pragma once
 #include "Vulkan/VulkanSwapChain.h"
-#include "Vulkan\VulkanTools.h"
+#include "Vulkan/VulkanTools.h"
+#include "Vulkan/VulkanPipelineCache.h"
 #include "IRendererInitializer.h"
 
 
+#if defined(_WIN32)
 #define	WINDOW_STYLE	(WS_OVERLAPPED|WS_BORDER|WS_CAPTION|WS_VISIBLE | WS_THICKFRAME)
+#endif
 
 
 
@@ -36,7 +39,9 @@ public:
 	*/
 	void RendererSwapBuffers();
 
+#if defined(_WIN32)
 	HWND GetWind32Handle() { return m_HwndWindows; }
+#endif
 public:
 	VkResult CreateVulkanInstance(bool bEnableValidation);
 
@@ -126,6 +131,9 @@ public:
 	// Stores all available memory (type) properties for the physical device
 	VkPhysicalDeviceMemoryProperties		 m_DeviceMemoryProperties;
 
+	// Limits such as buffer offset alignments and timestamp period
+	VkPhysicalDeviceProperties			m_DeviceProperties;
+
 	VkPhysicalDeviceFeatures				m_DeviceFeatures;
 
 	// Global render pass for frame buffer writes
@@ -134,12 +142,21 @@ public:
 	// Pipeline cache object
 	VkPipelineCache							m_PipelineCache;
 
+	// Loads m_PipelineCache from disk at init and saves it at shutdown
+	VulkanPipelineCache						m_PipelineCacheFile;
+
 	// List of available frame buffers (same as number of swap chain images)
 	std::vector<VkFramebuffer>				m_FrameBuffers;
 
 	// Handle to the device graphics queue that command buffers are submitted to
 	VkQueue									m_Queue;
 
+	// Transfer only queue, same as m_Queue when device has none
+	VkQueue									m_TransferQueue;
+
+	// Queue of a compute family without graphics, same as m_Queue when device has none
+	VkQueue									m_ComputeQueue;
+
 	// Descriptor set pool
 	VkDescriptorPool						m_DescriptorPool = VK_NULL_HANDLE;
 
@@ -150,12 +167,20 @@ public:
 	HWND									m_HwndWindows;
 #elif defined(__ANDROID__)
 
-#elif defined(linux)
-
+#elif defined(__linux__)
+	//Stay empty until there is a windowed platform layer, headless runs need no surface
+	xcb_connection_t*						connection;
+	xcb_window_t							window;
 #endif
 
 	//Grapic index
 	uint32_t								m_graphicsQueueIndex;
+
+	//Transfer index, equals m_graphicsQueueIndex if there is no transfer only family
+	uint32_t								m_transferQueueIndex;
+
+	//Async compute index, equals m_graphicsQueueIndex if there is no compute family without graphics
+	uint32_t								m_computeQueueIndex;
 	
 	// Active frame buffer index
 	uint32_t								m_currentBuffer = 0;
@@ -163,6 +188,9 @@ public:
 
 	bool									m_bPrepared;
 
+	// No window or surface, m_SwapChain renders into offscreen images. Set before CreateRendererScreen
+	bool									m_bHeadless;
+
 
 };
 
@@ -37,7 +37,7 @@
 #define NELEMS(x)  (sizeof(x) / sizeof((x)[0]))
 #define _TEXT(x) #x
 
-#if defined (_DEBUG) || defined (DEBUG)
+#if (defined (_DEBUG) || defined (DEBUG)) && defined (_MSC_VER)
 #	define TYW_NEW new(_NORMAL_BLOCK,__FILE__, __LINE__)
 #else
 #	define TYW_NEW new
@@ -3,9 +3,44 @@
 #define _CRTDBG_MAP_ALLOC
 
 
+#if defined(_WIN32)
 #include <Windows.h>
 #include <Windowsx.h>
 #include <mmsystem.h>
+#include <crtdbg.h>
+#include <fileapi.h>
+#else
+#include <unistd.h>
+#include <cstdarg>
+#include <cstdint>
+
+//Win32 types used by the renderer interfaces. Other platforms only pass them through
+typedef void*			HWND;
+typedef void*			HINSTANCE;
+typedef unsigned int	UINT;
+typedef unsigned char	BYTE;
+typedef uint32_t		DWORD;
+typedef uintptr_t		WPARAM;
+typedef intptr_t		LPARAM;
+typedef intptr_t		LRESULT;
+typedef int32_t			HRESULT;
+#define CALLBACK
+#define TRUE			1
+#define FALSE			0
+
+//Samples keep their message loop signature, there are no messages to pump
+struct MSG
+{
+	HWND	hwnd;
+	UINT	message;
+	WPARAM	wParam;
+	LPARAM	lParam;
+};
+#define S_OK			((HRESULT)0)
+#define E_FAIL			((HRESULT)0x80004005L)
+#define SUCCEEDED(hr)	(((HRESULT)(hr)) >= 0)
+#define FAILED(hr)		(((HRESULT)(hr)) < 0)
+#endif
 
 #include <iostream>
 #include <iomanip>
@@ -15,12 +50,12 @@
 #include <cmath>
 #include <string>
 #include <stdlib.h>
-#include <crtdbg.h>
 #include <cstdint>
 #include <cstdio>
+#include <cstring>
+#include <cfloat>
+#include <climits>
 #include <chrono>
-#include <windows.h>
-#include <fileapi.h>
 #include <memory>
 #include <vector>
 #include <algorithm>
@@ -29,10 +64,14 @@
 #include <map>
 #include <unordered_map>
 #include <functional>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
 #include <fstream>
 #include <sstream>
 #include <ostream>
-#include <strstream>
 #include "macro.h"
 
 
@@ -49,4 +88,4 @@
 #include <External/glm/glm/gtx/norm.hpp>
 #include <External/glm/glm/gtx/transform.hpp>
 #include <External/glm/glm/gtx/matrix_operation.hpp>
-#include <External\glm\glm\gtx\orthonormalize.hpp>
\ No newline at end of file
+#include <External/glm/glm/gtx/orthonormalize.hpp>
@@ -0,0 +1,227 @@
+/*
+*	Copyright 2015-2016 Tomas Mikalauskas. All rights reserved.
+*	GitHub repository - https://github.com/TywyllSoftware/TywRenderer
+*	This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+#include <RendererPch/stdafx.h>
+
+//SceneManager Includes
+#include <Renderer/SceneManager/AlphaSceneNodes.h>
+
+//Test Includes
+#include <Tests/TestCommon.h>
+
+
+//Not a multiple of four, the last nodes go through the scalar depth loop
+static const uint32_t NUM_NODES = 10003;
+static const uint32_t MEASURED_FRAMES = 100;
+
+
+//
+// Every heap allocation of the process goes through these, so the test
+// can tell whether sorting allocated anything once warmed up.
+//
+static std::atomic<uint64_t> g_NumHeapAllocations(0);
+
+void* operator new(size_t size)
+{
+	g_NumHeapAllocations.fetch_add(1, std::memory_order_relaxed);
+	if (void* p = malloc(size ? size : 1))
+		return p;
+	throw std::bad_alloc();
+}
+
+void* operator new[](size_t size)
+{
+	return operator new(size);
+}
+
+void operator delete(void* p) noexcept
+{
+	free(p);
+}
+
+void operator delete[](void* p) noexcept
+{
+	free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+	free(p);
+}
+
+void operator delete[](void* p, size_t) noexcept
+{
+	free(p);
+}
+
+
+//Nodes are never dereferenced, their address is an index into this array
+static char g_NodeTags[NUM_NODES];
+
+static ISceneNode* NodeFromIndex(uint32_t index)
+{
+	return reinterpret_cast<ISceneNode*>(&g_NodeTags[index]);
+}
+
+static uint32_t IndexFromNode(ISceneNode* pNode)
+{
+	return static_cast<uint32_t>(reinterpret_cast<char*>(pNode) - g_NodeTags);
+}
+
+
+//Deterministic coordinate in [-500, 500)
+static float RandomCoordinate(uint32_t& seed)
+{
+	seed = seed * 1664525u + 1013904223u;
+	return static_cast<float>(seed >> 8) / 16777216.0f * 1000.0f - 500.0f;
+}
+
+
+static glm::mat4x4 Translation(float x, float y, float z)
+{
+	return glm::translate(glm::mat4x4(1.0f), glm::vec3(x, y, z));
+}
+
+
+//
+// TestBackToFront
+//
+//	Random nodes around a rotated camera, some of them behind it. Sorted
+//	depth never increases, matches the depth the camera sees and every node
+//	shows up exactly once.
+//
+static void TestBackToFront(AlphaSceneNodes& alphaNodes, const glm::mat4x4& view, const std::vector<glm::vec3>& positions)
+{
+	alphaNodes.Clear();
+	for (uint32_t i = 0; i < NUM_NODES; i++)
+	{
+		alphaNodes.Add(NodeFromIndex(i), Translation(positions[i].x, positions[i].y, positions[i].z));
+	}
+	alphaNodes.Sort(view);
+
+	TEST_CHECK(alphaNodes.Size() == NUM_NODES);
+
+	std::vector<uint8_t> seen(NUM_NODES, 0);
+	uint32_t numOutOfOrder = 0;
+	uint32_t numWrongDepth = 0;
+	for (uint32_t i = 0; i < NUM_NODES; i++)
+	{
+		const uint32_t index = IndexFromNode(alphaNodes.GetSortedNode(i));
+		seen[index]++;
+
+		const float expected = -(view * glm::vec4(positions[index], 1.0f)).z;
+		if (fabsf(alphaNodes.GetSortedDepth(i) - expected) > 1e-3f * std::max(1.0f, fabsf(expected)))
+			numWrongDepth++;
+		if (alphaNodes.GetSortedWorldMatrix(i)[3][0] != positions[index].x)
+			numWrongDepth++;
+		if (i > 0 && alphaNodes.GetSortedDepth(i - 1) < alphaNodes.GetSortedDepth(i))
+			numOutOfOrder++;
+	}
+
+	TEST_CHECK(numOutOfOrder == 0);
+	TEST_CHECK(numWrongDepth == 0);
+	TEST_CHECK(static_cast<uint32_t>(std::count(seen.begin(), seen.end(), 1)) == NUM_NODES);
+}
+
+
+//
+// TestNegativeDepths
+//
+//	Camera at the origin looking down -z. Nodes behind the camera have negative
+//	view depth and are drawn last, the most negative one at the very end.
+//
+static void TestNegativeDepths(AlphaSceneNodes& alphaNodes)
+{
+	const float viewZ[] = { 3.0f, -5.0f, 0.25f, -0.5f, 100.0f, -2.0f, 1e-6f, -1e6f };
+	const float expectedDepth[] = { 1e6f, 5.0f, 2.0f, 0.5f, -1e-6f, -0.25f, -3.0f, -100.0f };
+	const uint32_t count = sizeof(viewZ) / sizeof(viewZ[0]);
+
+	alphaNodes.Clear();
+	for (uint32_t i = 0; i < count; i++)
+	{
+		alphaNodes.Add(NodeFromIndex(i), Translation(0.0f, 0.0f, viewZ[i]));
+	}
+	alphaNodes.Sort(glm::mat4x4(1.0f));
+
+	for (uint32_t i = 0; i < count; i++)
+	{
+		TEST_CHECK(alphaNodes.GetSortedDepth(i) == expectedDepth[i]);
+	}
+}
+
+
+//
+// TestStableOrder
+//
+//	Nodes are added round robin over a few depths. Within one depth they
+//	have to come out in the order they were added.
+//
+static void TestStableOrder(AlphaSceneNodes& alphaNodes)
+{
+	const float depths[] = { 4.0f, -1.0f, 16.0f, 4.5f };
+	const uint32_t numDepths = sizeof(depths) / sizeof(depths[0]);
+	const uint32_t count = 1001;
+
+	alphaNodes.Clear();
+	for (uint32_t i = 0; i < count; i++)
+	{
+		alphaNodes.Add(NodeFromIndex(i), Translation(static_cast<float>(i), 0.0f, -depths[i % numDepths]));
+	}
+	alphaNodes.Sort(glm::mat4x4(1.0f));
+
+	uint32_t numUnstable = 0;
+	for (uint32_t i = 1; i < count; i++)
+	{
+		const uint32_t previous = IndexFromNode(alphaNodes.GetSortedNode(i - 1));
+		const uint32_t current = IndexFromNode(alphaNodes.GetSortedNode(i));
+		if (alphaNodes.GetSortedDepth(i - 1) == alphaNodes.GetSortedDepth(i) && previous >= current)
+			numUnstable++;
+	}
+
+	TEST_CHECK(numUnstable == 0);
+	TEST_CHECK(alphaNodes.GetSortedDepth(0) == 16.0f);
+	TEST_CHECK(alphaNodes.GetSortedDepth(count - 1) == -1.0f);
+	TEST_CHECK(IndexFromNode(alphaNodes.GetSortedNode(0)) == 2);
+	TEST_CHECK(IndexFromNode(alphaNodes.GetSortedNode(count - 1)) == 997);
+}
+
+
+int main()
+{
+	uint32_t seed = 1234;
+	std::vector<glm::vec3> positions(NUM_NODES);
+	for (uint32_t i = 0; i < NUM_NODES; i++)
+	{
+		positions[i] = glm::vec3(RandomCoordinate(seed), RandomCoordinate(seed), RandomCoordinate(seed));
+	}
+	const glm::mat4x4 view = glm::lookAt(glm::vec3(20.0f, 35.0f, -10.0f), glm::vec3(-40.0f, 0.0f, 60.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+
+	AlphaSceneNodes alphaNodes;
+	TestNegativeDepths(alphaNodes);
+	TestStableOrder(alphaNodes);
+	TestBackToFront(alphaNodes, view, positions);
+
+	//Capacity reached the peak node count above, refilling and sorting must not allocate
+	const uint64_t allocationsBefore = g_NumHeapAllocations.load();
+	auto tStart = std::chrono::high_resolution_clock::now();
+	for (uint32_t frame = 0; frame < MEASURED_FRAMES; frame++)
+	{
+		alphaNodes.Clear();
+		for (uint32_t i = 0; i < NUM_NODES; i++)
+		{
+			alphaNodes.Add(NodeFromIndex(i), Translation(positions[i].x, positions[i].y, positions[i].z + frame));
+		}
+		alphaNodes.Sort(view);
+	}
+	const double elapsedMs = TestElapsedMs(tStart);
+	const uint64_t numHeapAllocations = g_NumHeapAllocations.load() - allocationsBefore;
+
+	TEST_CHECK(numHeapAllocations == 0);
+
+	printf("%u nodes: %.3f ms per frame to fill and sort, %llu heap allocations after warm-up\n",
+		NUM_NODES, elapsedMs / MEASURED_FRAMES, static_cast<unsigned long long>(numHeapAllocations));
+
+	return TEST_RESULT();
+}
@@ -0,0 +1,472 @@
+/*
+*	Copyright 2015-2016 Tomas Mikalauskas. All rights reserved.
+*	GitHub repository - https://github.com/TywyllSoftware/TywRenderer
+*	This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+#include <RendererPch/stdafx.h>
+
+//Vulkan Includes
+#include <Renderer/Vulkan/VulkanMemoryAllocator.h>
+#include <Renderer/Vulkan/VulkanFrameManager.h>
+#include <Renderer/Vulkan/VulkanCommandRecorder.h>
+#include <Renderer/Vulkan/VulkanTools.h>
+
+//JobSystem Includes
+#include <Renderer/JobSystem/JobSystem.h>
+
+//Test Includes
+#include <Tests/TestCommon.h>
+#include <Tests/VulkanTestCommon.h>
+
+
+static const uint32_t IMAGE_SIZE = 128;
+static const VkDeviceSize IMAGE_BYTES = IMAGE_SIZE * IMAGE_SIZE * 4;
+
+//One triangle per draw, every one with its own color. They overlap, so the
+//image only matches the serial one when chunks are executed in order
+static const uint32_t NUM_DRAWS = 24576;
+static const uint32_t DRAWS_PER_CHUNK = 256;
+static const uint32_t NUM_FRAMES = 4;
+
+static const VkMemoryPropertyFlags HOST_MEMORY = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+
+
+struct TestVertex
+{
+	float	pos[3];
+	float	color[3];
+};
+
+
+/*
+	Offscreen color target, the triangle pipeline and its buffers
+*/
+struct TestScene
+{
+	VkImage					image;
+	VulkanAllocation		imageAllocation;
+	VkImageView				imageView;
+	VkRenderPass			renderPass;
+	VkFramebuffer			framebuffer;
+
+	VkBuffer				vertexBuffer;
+	VulkanAllocation		vertexAllocation;
+	VkBuffer				uniformBuffer;
+	VulkanAllocation		uniformAllocation;
+	VkBuffer				readbackBuffer;
+	VulkanAllocation		readbackAllocation;
+
+	VkDescriptorSetLayout	descriptorSetLayout;
+	VkPipelineLayout		pipelineLayout;
+	VkDescriptorPool		descriptorPool;
+	VkDescriptorSet			descriptorSet;
+	VkPipeline				pipeline;
+};
+
+
+static void CreateTarget(const VulkanTestDevice& testDevice, TestScene& scene)
+{
+	VkImageCreateInfo imageInfo = VkTools::Initializer::ImageCreateInfo();
+	imageInfo.imageType = VK_IMAGE_TYPE_2D;
+	imageInfo.format = VK_FORMAT_R8G8B8A8_UNORM;
+	imageInfo.extent = { IMAGE_SIZE, IMAGE_SIZE, 1 };
+	imageInfo.mipLevels = 1;
+	imageInfo.arrayLayers = 1;
+	imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+	imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+	imageInfo.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+	imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	VK_CHECK_RESULT(vkCreateImage(testDevice.device, &imageInfo, nullptr, &scene.image));
+	VK_CHECK_RESULT(memoryAllocator->AllocateImage(scene.image, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, VK_IMAGE_TILING_OPTIMAL, false, scene.imageAllocation));
+
+	VkImageViewCreateInfo viewInfo = {};
+	viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+	viewInfo.image = scene.image;
+	viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+	viewInfo.format = imageInfo.format;
+	viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	viewInfo.subresourceRange.levelCount = 1;
+	viewInfo.subresourceRange.layerCount = 1;
+	VK_CHECK_RESULT(vkCreateImageView(testDevice.device, &viewInfo, nullptr, &scene.imageView));
+
+	VkAttachmentDescription attachment = {};
+	attachment.format = imageInfo.format;
+	attachment.samples = VK_SAMPLE_COUNT_1_BIT;
+	attachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+	attachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+	attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+	attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+	attachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	attachment.finalLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+
+	VkAttachmentReference colorReference = { 0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL };
+	VkSubpassDescription subpass = {};
+	subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+	subpass.colorAttachmentCount = 1;
+	subpass.pColorAttachments = &colorReference;
+
+	//Previous frame wrote and read back the same image
+	VkSubpassDependency dependencies[2] = {};
+	dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+	dependencies[0].dstSubpass = 0;
+	dependencies[0].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT;
+	dependencies[0].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+	dependencies[0].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+	dependencies[0].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+	dependencies[1].srcSubpass = 0;
+	dependencies[1].dstSubpass = VK_SUBPASS_EXTERNAL;
+	dependencies[1].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+	dependencies[1].dstStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT;
+	dependencies[1].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+	dependencies[1].dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+
+	VkRenderPassCreateInfo renderPassInfo = {};
+	renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+	renderPassInfo.attachmentCount = 1;
+	renderPassInfo.pAttachments = &attachment;
+	renderPassInfo.subpassCount = 1;
+	renderPassInfo.pSubpasses = &subpass;
+	renderPassInfo.dependencyCount = 2;
+	renderPassInfo.pDependencies = dependencies;
+	VK_CHECK_RESULT(vkCreateRenderPass(testDevice.device, &renderPassInfo, nullptr, &scene.renderPass));
+
+	VkFramebufferCreateInfo framebufferInfo = {};
+	framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+	framebufferInfo.renderPass = scene.renderPass;
+	framebufferInfo.attachmentCount = 1;
+	framebufferInfo.pAttachments = &scene.imageView;
+	framebufferInfo.width = IMAGE_SIZE;
+	framebufferInfo.height = IMAGE_SIZE;
+	framebufferInfo.layers = 1;
+	VK_CHECK_RESULT(vkCreateFramebuffer(testDevice.device, &framebufferInfo, nullptr, &scene.framebuffer));
+
+	VkBufferCreateInfo bufferInfo = VkTools::Initializer::BufferCreateInfo(VK_BUFFER_USAGE_TRANSFER_DST_BIT, IMAGE_BYTES);
+	VK_CHECK_RESULT(vkCreateBuffer(testDevice.device, &bufferInfo, nullptr, &scene.readbackBuffer));
+	VK_CHECK_RESULT(memoryAllocator->AllocateBuffer(scene.readbackBuffer, HOST_MEMORY, scene.readbackAllocation));
+}
+
+
+static void CreateBuffers(const VulkanTestDevice& testDevice, TestScene& scene)
+{
+	//Small triangles spread over the target, color encodes the draw index
+	std::vector<TestVertex> vertices(NUM_DRAWS * 3);
+	uint32_t random = 12345;
+	for (uint32_t i = 0; i < NUM_DRAWS; i++)
+	{
+		random = random * 1664525u + 1013904223u;
+		const float x = (random >> 8) / static_cast<float>(1 << 24) * 1.8f - 0.9f;
+		random = random * 1664525u + 1013904223u;
+		const float y = (random >> 8) / static_cast<float>(1 << 24) * 1.8f - 0.9f;
+
+		const float corners[3][2] = { { x - 0.1f, y + 0.1f }, { x + 0.1f, y + 0.1f }, { x, y - 0.1f } };
+		for (uint32_t v = 0; v < 3; v++)
+		{
+			TestVertex& vertex = vertices[i * 3 + v];
+			vertex.pos[0] = corners[v][0];
+			vertex.pos[1] = corners[v][1];
+			vertex.pos[2] = 0.0f;
+			vertex.color[0] = (i & 0xff) / 255.0f;
+			vertex.color[1] = ((i >> 8) & 0xff) / 255.0f;
+			vertex.color[2] = 0.5f;
+		}
+	}
+
+	const VkDeviceSize vertexBytes = vertices.size() * sizeof(TestVertex);
+	VkBufferCreateInfo bufferInfo = VkTools::Initializer::BufferCreateInfo(VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, vertexBytes);
+	VK_CHECK_RESULT(vkCreateBuffer(testDevice.device, &bufferInfo, nullptr, &scene.vertexBuffer));
+	VK_CHECK_RESULT(memoryAllocator->AllocateBuffer(scene.vertexBuffer, HOST_MEMORY, scene.vertexAllocation));
+	memcpy(scene.vertexAllocation.pMapped, vertices.data(), static_cast<size_t>(vertexBytes));
+
+	//Projection, model and view are identity, positions are already in clip space
+	const glm::mat4x4 matrices[3] = { glm::mat4x4(1.0f), glm::mat4x4(1.0f), glm::mat4x4(1.0f) };
+	bufferInfo = VkTools::Initializer::BufferCreateInfo(VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, sizeof(matrices));
+	VK_CHECK_RESULT(vkCreateBuffer(testDevice.device, &bufferInfo, nullptr, &scene.uniformBuffer));
+	VK_CHECK_RESULT(memoryAllocator->AllocateBuffer(scene.uniformBuffer, HOST_MEMORY, scene.uniformAllocation));
+	memcpy(scene.uniformAllocation.pMapped, matrices, sizeof(matrices));
+}
+
+
+static void CreatePipeline(const VulkanTestDevice& testDevice, TestScene& scene)
+{
+	VkDescriptorSetLayoutBinding binding = VkTools::Initializer::DescriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_VERTEX_BIT, 0);
+	VkDescriptorSetLayoutCreateInfo descriptorLayoutInfo = VkTools::Initializer::DescriptorSetLayoutCreateInfo(&binding, 1);
+	VK_CHECK_RESULT(vkCreateDescriptorSetLayout(testDevice.device, &descriptorLayoutInfo, nullptr, &scene.descriptorSetLayout));
+
+	VkPipelineLayoutCreateInfo pipelineLayoutInfo = VkTools::Initializer::PipelineLayoutCreateInfo(&scene.descriptorSetLayout, 1);
+	VK_CHECK_RESULT(vkCreatePipelineLayout(testDevice.device, &pipelineLayoutInfo, nullptr, &scene.pipelineLayout));
+
+	VkDescriptorPoolSize poolSize = VkTools::Initializer::DescriptorPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1);
+	VkDescriptorPoolCreateInfo descriptorPoolInfo = VkTools::Initializer::DescriptorPoolCreateInfo(1, &poolSize, 1);
+	VK_CHECK_RESULT(vkCreateDescriptorPool(testDevice.device, &descriptorPoolInfo, nullptr, &scene.descriptorPool));
+
+	VkDescriptorSetAllocateInfo allocInfo = VkTools::Initializer::DescriptorSetAllocateInfo(scene.descriptorPool, &scene.descriptorSetLayout, 1);
+	VK_CHECK_RESULT(vkAllocateDescriptorSets(testDevice.device, &allocInfo, &scene.descriptorSet));
+
+	VkDescriptorBufferInfo uniformInfo = { scene.uniformBuffer, 0, VK_WHOLE_SIZE };
+	VkWriteDescriptorSet writeDescriptorSet = VkTools::Initializer::WriteDescriptorSet(scene.descriptorSet, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 0, &uniformInfo);
+	vkUpdateDescriptorSets(testDevice.device, 1, &writeDescriptorSet, 0, nullptr);
+
+	VkVertexInputBindingDescription vertexBinding = VkTools::Initializer::VertexInputBindingDescription(0, sizeof(TestVertex), VK_VERTEX_INPUT_RATE_VERTEX);
+	VkVertexInputAttributeDescription vertexAttributes[2] =
+	{
+		VkTools::Initializer::VertexInputAttributeDescription(0, 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(TestVertex, pos)),
+		VkTools::Initializer::VertexInputAttributeDescription(0, 1, VK_FORMAT_R32G32B32_SFLOAT, offsetof(TestVertex, color))
+	};
+	VkPipelineVertexInputStateCreateInfo vertexInputState = {};
+	vertexInputState.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+	vertexInputState.vertexBindingDescriptionCount = 1;
+	vertexInputState.pVertexBindingDescriptions = &vertexBinding;
+	vertexInputState.vertexAttributeDescriptionCount = 2;
+	vertexInputState.pVertexAttributeDescriptions = vertexAttributes;
+
+	VkPipelineInputAssemblyStateCreateInfo inputAssemblyState = VkTools::Initializer::PipelineInputAssemblyStateCreateInfo(VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST, 0, VK_FALSE);
+	VkPipelineRasterizationStateCreateInfo rasterizationState = VkTools::Initializer::PipelineRasterizationStateCreateInfo(VK_POLYGON_MODE_FILL, VK_CULL_MODE_NONE, VK_FRONT_FACE_COUNTER_CLOCKWISE, 0);
+	VkPipelineColorBlendAttachmentState blendAttachmentState = VkTools::Initializer::PipelineColorBlendAttachmentState(0xf, VK_FALSE);
+	VkPipelineColorBlendStateCreateInfo colorBlendState = VkTools::Initializer::PipelineColorBlendStateCreateInfo(1, &blendAttachmentState);
+	VkPipelineDepthStencilStateCreateInfo depthStencilState = VkTools::Initializer::PipelineDepthStencilStateCreateInfo(VK_FALSE, VK_FALSE, VK_COMPARE_OP_ALWAYS);
+	VkPipelineViewportStateCreateInfo viewportState = VkTools::Initializer::PipelineViewportStateCreateInfo(1, 1, 0);
+	VkPipelineMultisampleStateCreateInfo multisampleState = VkTools::Initializer::PipelineMultisampleStateCreateInfo(VK_SAMPLE_COUNT_1_BIT, 0);
+	const VkDynamicState dynamicStates[] = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+	VkPipelineDynamicStateCreateInfo dynamicState = VkTools::Initializer::PipelineDynamicStateCreateInfo(dynamicStates, 2, 0);
+
+	VkPipelineShaderStageCreateInfo shaderStages[2] = {};
+	shaderStages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	shaderStages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+	shaderStages[0].module = VkTools::LoadShader(TEST_ASSET_PATH "Shaders/AsteroidGame/triangle.vert.spv", testDevice.device, VK_SHADER_STAGE_VERTEX_BIT);
+	shaderStages[0].pName = "main";
+	shaderStages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	shaderStages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+	shaderStages[1].module = VkTools::LoadShader(TEST_ASSET_PATH "Shaders/AsteroidGame/triangle.frag.spv", testDevice.device, VK_SHADER_STAGE_FRAGMENT_BIT);
+	shaderStages[1].pName = "main";
+
+	VkGraphicsPipelineCreateInfo pipelineInfo = VkTools::Initializer::PipelineCreateInfo(scene.pipelineLayout, scene.renderPass, 0);
+	pipelineInfo.pVertexInputState = &vertexInputState;
+	pipelineInfo.pInputAssemblyState = &inputAssemblyState;
+	pipelineInfo.pRasterizationState = &rasterizationState;
+	pipelineInfo.pColorBlendState = &colorBlendState;
+	pipelineInfo.pMultisampleState = &multisampleState;
+	pipelineInfo.pViewportState = &viewportState;
+	pipelineInfo.pDepthStencilState = &depthStencilState;
+	pipelineInfo.pDynamicState = &dynamicState;
+	pipelineInfo.stageCount = 2;
+	pipelineInfo.pStages = shaderStages;
+	VK_CHECK_RESULT(vkCreateGraphicsPipelines(testDevice.device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &scene.pipeline));
+
+	vkDestroyShaderModule(testDevice.device, shaderStages[0].module, nullptr);
+	vkDestroyShaderModule(testDevice.device, shaderStages[1].module, nullptr);
+}
+
+
+static void DestroyScene(const VulkanTestDevice& testDevice, TestScene& scene)
+{
+	vkDestroyPipeline(testDevice.device, scene.pipeline, nullptr);
+	vkDestroyDescriptorPool(testDevice.device, scene.descriptorPool, nullptr);
+	vkDestroyPipelineLayout(testDevice.device, scene.pipelineLayout, nullptr);
+	vkDestroyDescriptorSetLayout(testDevice.device, scene.descriptorSetLayout, nullptr);
+
+	vkDestroyBuffer(testDevice.device, scene.readbackBuffer, nullptr);
+	memoryAllocator->Free(scene.readbackAllocation);
+	vkDestroyBuffer(testDevice.device, scene.uniformBuffer, nullptr);
+	memoryAllocator->Free(scene.uniformAllocation);
+	vkDestroyBuffer(testDevice.device, scene.vertexBuffer, nullptr);
+	memoryAllocator->Free(scene.vertexAllocation);
+
+	vkDestroyFramebuffer(testDevice.device, scene.framebuffer, nullptr);
+	vkDestroyRenderPass(testDevice.device, scene.renderPass, nullptr);
+	vkDestroyImageView(testDevice.device, scene.imageView, nullptr);
+	vkDestroyImage(testDevice.device, scene.image, nullptr);
+	memoryAllocator->Free(scene.imageAllocation);
+}
+
+
+//
+// RecordDraws
+//
+//	Draws [first, last). Binds all state first, secondaries inherit none of it
+//
+static void RecordDraws(const TestScene& scene, VkCommandBuffer cmdBuffer, uint32_t first, uint32_t last)
+{
+	vkCmdBindPipeline(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, scene.pipeline);
+	vkCmdBindDescriptorSets(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, scene.pipelineLayout, 0, 1, &scene.descriptorSet, 0, nullptr);
+
+	const VkDeviceSize offset = 0;
+	vkCmdBindVertexBuffers(cmdBuffer, 0, 1, &scene.vertexBuffer, &offset);
+
+	const VkViewport viewport = VkTools::Initializer::Viewport(static_cast<float>(IMAGE_SIZE), static_cast<float>(IMAGE_SIZE), 0.0f, 1.0f);
+	const VkRect2D scissor = VkTools::Initializer::Rect2D(IMAGE_SIZE, IMAGE_SIZE, 0, 0);
+	vkCmdSetViewport(cmdBuffer, 0, 1, &viewport);
+	vkCmdSetScissor(cmdBuffer, 0, 1, &scissor);
+
+	for (uint32_t i = first; i < last; i++)
+	{
+		vkCmdDraw(cmdBuffer, 3, 1, i * 3, 0);
+	}
+}
+
+
+//
+// RenderFrame
+//
+//	Records all draws inline on this thread, the way BuildCommandBuffers does,
+//	or through pRecorder. Returns recording time of the draws
+//
+static double RenderFrame(const VulkanTestDevice& testDevice, const TestScene& scene, VulkanCommandRecorder* pRecorder, bool bReadback)
+{
+	VkCommandBuffer cmdBuffer = frameManager->GetCommandBuffer();
+	VkCommandBufferBeginInfo cmdBufInfo = VkTools::Initializer::CommandBufferBeginInfo();
+	cmdBufInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	VK_CHECK_RESULT(vkBeginCommandBuffer(cmdBuffer, &cmdBufInfo));
+
+	VkClearValue clearValue = {};
+	VkRenderPassBeginInfo renderPassBeginInfo = VkTools::Initializer::RenderPassBeginInfo();
+	renderPassBeginInfo.renderPass = scene.renderPass;
+	renderPassBeginInfo.framebuffer = scene.framebuffer;
+	renderPassBeginInfo.renderArea.extent = { IMAGE_SIZE, IMAGE_SIZE };
+	renderPassBeginInfo.clearValueCount = 1;
+	renderPassBeginInfo.pClearValues = &clearValue;
+	vkCmdBeginRenderPass(cmdBuffer, &renderPassBeginInfo, pRecorder ? VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS : VK_SUBPASS_CONTENTS_INLINE);
+
+	auto tStart = std::chrono::high_resolution_clock::now();
+	if (pRecorder)
+	{
+		pRecorder->Record(cmdBuffer, scene.renderPass, 0, scene.framebuffer, NUM_DRAWS, DRAWS_PER_CHUNK, [&scene](VkCommandBuffer chunkCmdBuffer, uint32_t first, uint32_t last)
+		{
+			RecordDraws(scene, chunkCmdBuffer, first, last);
+		});
+	}
+	else
+	{
+		RecordDraws(scene, cmdBuffer, 0, NUM_DRAWS);
+	}
+	const double recordMs = TestElapsedMs(tStart);
+
+	vkCmdEndRenderPass(cmdBuffer);
+
+	if (bReadback)
+	{
+		VkBufferImageCopy region = {};
+		region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		region.imageSubresource.layerCount = 1;
+		region.imageExtent = { IMAGE_SIZE, IMAGE_SIZE, 1 };
+		vkCmdCopyImageToBuffer(cmdBuffer, scene.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, scene.readbackBuffer, 1, &region);
+
+		VkBufferMemoryBarrier hostBarrier = {};
+		hostBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+		hostBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		hostBarrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+		hostBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		hostBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		hostBarrier.buffer = scene.readbackBuffer;
+		hostBarrier.size = VK_WHOLE_SIZE;
+		vkCmdPipelineBarrier(cmdBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 0, nullptr, 1, &hostBarrier, 0, nullptr);
+	}
+	VK_CHECK_RESULT(vkEndCommandBuffer(cmdBuffer));
+
+	VkSubmitInfo submitInfo = VkTools::Initializer::SubmitInfo();
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &cmdBuffer;
+	VK_CHECK_RESULT(vkQueueSubmit(testDevice.queue, 1, &submitInfo, VK_NULL_HANDLE));
+	frameManager->EndFrame(testDevice.queue);
+	return recordMs;
+}
+
+
+struct RecordRunResult
+{
+	double						recordMilliSec;		// average over frames after the first
+	std::vector<uint8_t>		pixels;				// last frame
+	VulkanCommandRecorderStats	lastStats;
+};
+
+
+//
+// RunFrames
+//
+//	Renders NUM_FRAMES frames. The first one allocates command buffers and is
+//	not timed. Later frames reuse the pools of frames in flight
+//
+static RecordRunResult RunFrames(const VulkanTestDevice& testDevice, const TestScene& scene, VulkanCommandRecorder* pRecorder)
+{
+	RecordRunResult result;
+	result.recordMilliSec = 0.0;
+	for (uint32_t frame = 0; frame < NUM_FRAMES; frame++)
+	{
+		const double recordMs = RenderFrame(testDevice, scene, pRecorder, frame == NUM_FRAMES - 1);
+		result.recordMilliSec += frame > 0 ? recordMs : 0.0;
+	}
+	result.recordMilliSec /= NUM_FRAMES - 1;
+	frameManager->WaitIdle();
+
+	const uint8_t* pPixels = static_cast<const uint8_t*>(scene.readbackAllocation.pMapped);
+	result.pixels.assign(pPixels, pPixels + IMAGE_BYTES);
+
+	memset(&result.lastStats, 0, sizeof(result.lastStats));
+	if (pRecorder)
+	{
+		result.lastStats = pRecorder->GetStats();
+	}
+	return result;
+}
+
+
+int main()
+{
+	VulkanTestDevice testDevice;
+	if (!CreateVulkanTestDevice(testDevice, "CommandRecorderTest"))
+		return TEST_SKIPPED;
+
+	memoryAllocator = TYW_NEW VulkanMemoryAllocator(testDevice.physicalDevice, testDevice.device);
+	frameManager = TYW_NEW VulkanFrameManager(testDevice.device, testDevice.graphicsFamily, 0, 1.0f);
+
+	TestScene scene;
+	CreateTarget(testDevice, scene);
+	CreateBuffers(testDevice, scene);
+	CreatePipeline(testDevice, scene);
+
+	//Serial inline recording is the reference every thread count has to match exactly
+	const RecordRunResult reference = RunFrames(testDevice, scene, nullptr);
+	uint32_t numCovered = 0;
+	for (uint32_t p = 0; p < IMAGE_SIZE * IMAGE_SIZE; p++)
+	{
+		numCovered += reference.pixels[p * 4 + 3] != 0 ? 1 : 0;
+	}
+	TEST_CHECK(numCovered > IMAGE_SIZE * IMAGE_SIZE / 2);
+	printf("%u draws, serial inline: %.3f ms recording, %u of %u pixels covered\n", NUM_DRAWS, reference.recordMilliSec, numCovered, IMAGE_SIZE * IMAGE_SIZE);
+
+	const uint32_t threadCounts[] = { 1, 4, 16 };
+	for (uint32_t numThreads : threadCounts)
+	{
+		JobSystem jobs(numThreads);
+		jobSystem = &jobs;
+
+		RecordRunResult result;
+		{
+			VulkanCommandRecorder recorder(testDevice.device, testDevice.graphicsFamily);
+			result = RunFrames(testDevice, scene, &recorder);
+		}
+		jobSystem = nullptr;
+
+		uint32_t numWrongPixels = 0;
+		for (size_t i = 0; i < result.pixels.size(); i += 4)
+		{
+			numWrongPixels += memcmp(&result.pixels[i], &reference.pixels[i], 4) != 0 ? 1 : 0;
+		}
+
+		TEST_CHECK(numWrongPixels == 0);
+		TEST_CHECK(result.lastStats.numDraws == NUM_DRAWS);
+		TEST_CHECK(result.lastStats.numChunks == NUM_DRAWS / DRAWS_PER_CHUNK);
+		TEST_CHECK(result.lastStats.numThreads >= 1 && result.lastStats.numThreads <= numThreads);
+
+		printf("%2u threads: %.3f ms recording (%.2fx serial), %u chunks on %u threads, %u pixels differ\n",
+			numThreads, result.recordMilliSec, reference.recordMilliSec / std::max(result.recordMilliSec, 0.001),
+			result.lastStats.numChunks, result.lastStats.numThreads, numWrongPixels);
+	}
+
+	DestroyScene(testDevice, scene);
+	SAFE_DELETE(frameManager);
+	SAFE_DELETE(memoryAllocator);
+
+	DestroyVulkanTestDevice(testDevice);
+	return TEST_RESULT();
+}
@@ -0,0 +1,230 @@
+/*
+*	Copyright 2015-2016 Tomas Mikalauskas. All rights reserved.
+*	GitHub repository - https://github.com/TywyllSoftware/TywRenderer
+*	This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+#include <RendererPch/stdafx.h>
+
+//EventManager Includes
+#include <Renderer/EventManager/EventManagerImpl.h>
+#include <Renderer/EventManager/EventRecorder.h>
+#include <Renderer/EventManager/Events.h>
+
+//Test Includes
+#include <Tests/TestCommon.h>
+
+
+static const uint32_t NUM_UPDATES = 32;
+static const uint32_t NUM_ACTORS = 16;
+
+
+//
+// TestStreamRoundTrip
+//
+//	Every EventWriter value reads back bit exact, the layout is little endian
+//	and reading past the end is reported instead of returning garbage.
+//
+static void TestStreamRoundTrip()
+{
+	glm::mat4x4 matrix;
+	for (int i = 0; i < 16; i++)
+	{
+		matrix[i / 4][i % 4] = static_cast<float>(i) * 0.5f - 3.0f;
+	}
+	const uint8_t bytes[5] = { 1, 2, 3, 4, 5 };
+
+	EventWriter out;
+	out.WriteUInt32(0x11223344);
+	out.WriteUInt8(0xab);
+	out.WriteUInt64(0x0102030405060708ull);
+	out.WriteInt32(-12345);
+	out.WriteBool(true);
+	out.WriteFloat(-0.15625f);
+	out.WriteDouble(3.141592653589793);
+	out.WriteString(std::string("capture\0name", 12));
+	out.WriteString("");
+	out.WriteMatrix(matrix);
+	out.WriteBytes(bytes, sizeof(bytes));
+	out.WriteUInt32(0);
+	out.PatchUInt32(out.GetSize() - 4, 0xdeadbeef);
+
+	const uint8_t* pData = out.GetData();
+	TEST_CHECK(pData[0] == 0x44 && pData[1] == 0x33 && pData[2] == 0x22 && pData[3] == 0x11);
+	TEST_CHECK(pData[5] == 0x08 && pData[12] == 0x01);
+
+	EventReader in(out.GetData(), out.GetSize());
+	TEST_CHECK(in.ReadUInt32() == 0x11223344);
+	TEST_CHECK(in.ReadUInt8() == 0xab);
+	TEST_CHECK(in.ReadUInt64() == 0x0102030405060708ull);
+	TEST_CHECK(in.ReadInt32() == -12345);
+	TEST_CHECK(in.ReadBool());
+	TEST_CHECK(in.ReadFloat() == -0.15625f);
+	TEST_CHECK(in.ReadDouble() == 3.141592653589793);
+	TEST_CHECK(in.ReadString() == std::string("capture\0name", 12));
+	TEST_CHECK(in.ReadString().empty());
+	TEST_CHECK(in.ReadMatrix() == matrix);
+
+	uint8_t readBytes[5] = {};
+	TEST_CHECK(in.ReadBytes(readBytes, sizeof(readBytes)));
+	TEST_CHECK(memcmp(readBytes, bytes, sizeof(bytes)) == 0);
+	TEST_CHECK(in.ReadUInt32() == 0xdeadbeef);
+	TEST_CHECK(in.IsValid());
+	TEST_CHECK(in.GetRemaining() == 0);
+
+	//Truncated data
+	TEST_CHECK(in.ReadUInt32() == 0);
+	TEST_CHECK(!in.IsValid());
+
+	EventReader truncated(out.GetData(), 2);
+	TEST_CHECK(truncated.ReadUInt32() == 0);
+	TEST_CHECK(!truncated.IsValid());
+}
+
+
+struct DispatchedEvent
+{
+	EventType	eventType;
+	uint32_t	update;
+	uint32_t	actorId;
+	glm::mat4	matrix;
+
+	bool operator==(const DispatchedEvent& other) const
+	{
+		return eventType == other.eventType && update == other.update && actorId == other.actorId && matrix == other.matrix;
+	}
+};
+
+struct EventTrace
+{
+	std::vector<DispatchedEvent>	events;
+	uint32_t						update;
+};
+
+
+static void AddTraceListeners(EventManager& eventManager, EventTrace* pTrace)
+{
+	eventManager.VAddListener([pTrace](const IEventDataPtr& pEvent)
+	{
+		const EvtData_Move_Actor* pMove = static_cast<const EvtData_Move_Actor*>(pEvent.get());
+		DispatchedEvent dispatched = { EvtData_Move_Actor::sk_EventType, pTrace->update, pMove->GetId(), pMove->GetMatrix() };
+		pTrace->events.push_back(dispatched);
+	}, EvtData_Move_Actor::sk_EventType);
+	eventManager.VAddListener([pTrace](const IEventDataPtr& pEvent)
+	{
+		const EvtData_Destroy_Actor* pDestroy = static_cast<const EvtData_Destroy_Actor*>(pEvent.get());
+		DispatchedEvent dispatched = { EvtData_Destroy_Actor::sk_EventType, pTrace->update, pDestroy->GetId(), glm::mat4(1.0f) };
+		pTrace->events.push_back(dispatched);
+	}, EvtData_Destroy_Actor::sk_EventType);
+	eventManager.VSetCoalescing(EvtData_Move_Actor::sk_EventType, true);
+}
+
+
+//
+// RecordSession
+//
+//	Pseudo random moves and destroys over NUM_UPDATES updates. Destroying an
+//	actor queues a move from inside the listener, that move is recorded in the
+//	following update. Coalescing drops some moves before they are recorded.
+//
+static void RecordSession(EventRecorder& recorder, EventTrace& trace)
+{
+	EventManager eventManager;
+	AddTraceListeners(eventManager, &trace);
+
+	EventManager* pEventManager = &eventManager;
+	eventManager.VAddListener([pEventManager](const IEventDataPtr& pEvent)
+	{
+		const EvtData_Destroy_Actor* pDestroy = static_cast<const EvtData_Destroy_Actor*>(pEvent.get());
+		pEventManager->VQueueEvent(MakeEvent<EvtData_Move_Actor>(pDestroy->GetId(), glm::mat4(0.0f)));
+	}, EvtData_Destroy_Actor::sk_EventType);
+
+	eventManager.SetRecorder(&recorder);
+	recorder.Start();
+
+	uint32_t seed = 0x2545f491;
+	for (trace.update = 0; trace.update < NUM_UPDATES; trace.update++)
+	{
+		const uint32_t numEvents = 1 + trace.update % 7;
+		for (uint32_t i = 0; i < numEvents; i++)
+		{
+			seed = seed * 1664525u + 1013904223u;
+			const uint32_t actorId = (seed >> 8) % NUM_ACTORS;
+			if ((seed >> 28) == 0)
+			{
+				eventManager.VQueueEvent(MakeEvent<EvtData_Destroy_Actor>(actorId));
+			}
+			else
+			{
+				const glm::vec3 position(static_cast<float>(seed & 0xff), static_cast<float>(trace.update), -0.25f * i);
+				eventManager.VQueueEvent(MakeEvent<EvtData_Move_Actor>(actorId, glm::translate(glm::mat4(1.0f), position)));
+			}
+		}
+		eventManager.VUpdate();
+	}
+
+	recorder.Stop();
+	eventManager.SetRecorder(nullptr);
+}
+
+
+static void ReplaySession(EventReplayer& replayer, EventTrace& trace)
+{
+	EventManager eventManager;
+	AddTraceListeners(eventManager, &trace);
+
+	replayer.Rewind();
+	for (trace.update = 0; !replayer.IsFinished(); trace.update++)
+	{
+		replayer.QueueNextUpdate(&eventManager);
+		eventManager.VUpdate();
+	}
+}
+
+
+int main()
+{
+	RegisterEngineEvents();
+
+	TestStreamRoundTrip();
+
+	EventRecorder recorder;
+	EventTrace recorded;
+	RecordSession(recorder, recorded);
+
+	TEST_CHECK(recorder.GetNumEvents() == recorded.events.size());
+	TEST_CHECK(recorder.GetNumUpdates() == NUM_UPDATES);
+
+	//Replay from memory twice and from a file, every run dispatches the recorded sequence
+	const EventWriter& capture = recorder.GetCapture();
+	EventReplayer replayer;
+	TEST_CHECK(replayer.Load(capture.GetData(), capture.GetSize()));
+
+	EventTrace replayed;
+	ReplaySession(replayer, replayed);
+	TEST_CHECK(replayed.events == recorded.events);
+
+	EventTrace rewound;
+	ReplaySession(replayer, rewound);
+	TEST_CHECK(rewound.events == recorded.events);
+
+	const std::string fileName = "EventCaptureTest.capture";
+	TEST_CHECK(recorder.Save(fileName));
+	EventReplayer fileReplayer;
+	TEST_CHECK(fileReplayer.Load(fileName));
+
+	EventTrace fromFile;
+	ReplaySession(fileReplayer, fromFile);
+	TEST_CHECK(fromFile.events == recorded.events);
+	remove(fileName.c_str());
+
+	//Not a capture
+	const uint8_t garbage[8] = { 'T', 'Y', 'W', 'X', 1, 0, 0, 0 };
+	EventReplayer badReplayer;
+	TEST_CHECK(!badReplayer.Load(garbage, sizeof(garbage)));
+	TEST_CHECK(badReplayer.IsFinished());
+
+	printf("%u events in %u updates recorded, capture %u bytes, replayed 3 times\n",
+		recorder.GetNumEvents(), recorder.GetNumUpdates(), static_cast<uint32_t>(capture.GetSize()));
+
+	return TEST_RESULT();
+}
@@ -0,0 +1,155 @@
+/*
+*	Copyright 2015-2016 Tomas Mikalauskas. All rights reserved.
+*	GitHub repository - https://github.com/TywyllSoftware/TywRenderer
+*	This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+#include <RendererPch/stdafx.h>
+
+//EventManager Includes
+#include <Renderer/EventManager/EventManagerImpl.h>
+#include <Renderer/EventManager/Events.h>
+
+//Test Includes
+#include <Tests/TestCommon.h>
+
+
+static const uint32_t NUM_ACTORS = 64;
+static const uint32_t MOVES_PER_ACTOR = 8;
+
+
+struct DispatchedMove
+{
+	uint32_t	actorId;
+	float		x;
+};
+
+struct ListenerTrace
+{
+	std::vector<DispatchedMove>	moves;
+	uint32_t					numDestroyed;
+};
+
+
+static IEventDataPtr MakeMove(uint32_t actorId, float x)
+{
+	return MakeEvent<EvtData_Move_Actor>(actorId, glm::translate(glm::mat4(1.0f), glm::vec3(x, 0.0f, 0.0f)));
+}
+
+
+//
+// TestLatestMoveSurvives
+//
+//	Every actor moves MOVES_PER_ACTOR times in one frame, interleaved with the
+//	other actors and with events of a type that does not coalesce. Only the last
+//	move of each actor is dispatched, the destroy events are all kept.
+//
+static void TestLatestMoveSurvives(EventManager& eventManager, ListenerTrace& trace)
+{
+	trace.moves.clear();
+	trace.numDestroyed = 0;
+
+	for (uint32_t move = 0; move < MOVES_PER_ACTOR; move++)
+	{
+		for (uint32_t actor = 0; actor < NUM_ACTORS; actor++)
+		{
+			eventManager.VQueueEvent(MakeMove(actor, static_cast<float>(move)));
+		}
+		eventManager.VQueueEvent(MakeEvent<EvtData_Destroy_Actor>(1000 + move));
+	}
+
+	TEST_CHECK(eventManager.VUpdate(IEventManager::kINFINITE));
+
+	const EventManagerStats& stats = eventManager.GetStats();
+	TEST_CHECK(stats.numCoalesced == NUM_ACTORS * (MOVES_PER_ACTOR - 1));
+	TEST_CHECK(stats.numProcessed == NUM_ACTORS + MOVES_PER_ACTOR);
+	TEST_CHECK(stats.numDeferred == 0);
+	TEST_CHECK(trace.numDestroyed == MOVES_PER_ACTOR);
+
+	//Survivors keep the queue position of the latest move, that is actor order of the last round
+	TEST_CHECK(trace.moves.size() == NUM_ACTORS);
+	for (uint32_t i = 0; i < trace.moves.size(); i++)
+	{
+		TEST_CHECK(trace.moves[i].actorId == i);
+		TEST_CHECK(trace.moves[i].x == static_cast<float>(MOVES_PER_ACTOR - 1));
+	}
+}
+
+
+//
+// TestDeferredMovesCoalesce
+//
+//	A zero budget dispatches one event and defers the rest. Moves queued before
+//	the next update replace the deferred moves of the same actors.
+//
+static void TestDeferredMovesCoalesce(EventManager& eventManager, ListenerTrace& trace)
+{
+	trace.moves.clear();
+	trace.numDestroyed = 0;
+
+	for (uint32_t actor = 0; actor < NUM_ACTORS; actor++)
+	{
+		eventManager.VQueueEvent(MakeMove(actor, 1.0f));
+	}
+
+	TEST_CHECK(!eventManager.VUpdate(0));
+	TEST_CHECK(eventManager.GetStats().numProcessed == 1);
+	TEST_CHECK(eventManager.GetStats().numDeferred == NUM_ACTORS - 1);
+	TEST_CHECK(eventManager.GetStats().numCoalesced == 0);
+	TEST_CHECK(trace.moves.size() == 1);
+
+	for (uint32_t actor = 0; actor < NUM_ACTORS; actor++)
+	{
+		eventManager.VQueueEvent(MakeMove(actor, 2.0f));
+	}
+
+	//Actor 0 was already dispatched, its new move has nothing to replace
+	TEST_CHECK(eventManager.VUpdate());
+	TEST_CHECK(eventManager.GetStats().numProcessed == NUM_ACTORS);
+	TEST_CHECK(eventManager.GetStats().numDeferred == 0);
+	TEST_CHECK(eventManager.GetStats().numCoalesced == NUM_ACTORS - 1);
+
+	TEST_CHECK(trace.moves.size() == NUM_ACTORS + 1);
+	TEST_CHECK(trace.moves[0].actorId == 0 && trace.moves[0].x == 1.0f);
+	for (uint32_t i = 1; i < trace.moves.size(); i++)
+	{
+		TEST_CHECK(trace.moves[i].actorId == i - 1);
+		TEST_CHECK(trace.moves[i].x == 2.0f);
+	}
+
+	//Nothing left over for the following update
+	TEST_CHECK(eventManager.VUpdate());
+	TEST_CHECK(eventManager.GetStats().numProcessed == 0);
+	TEST_CHECK(eventManager.GetStats().numCoalesced == 0);
+}
+
+
+int main()
+{
+	EventManager eventManager;
+	ListenerTrace trace;
+	trace.moves.reserve(NUM_ACTORS * MOVES_PER_ACTOR);
+	trace.numDestroyed = 0;
+
+	ListenerTrace* pTrace = &trace;
+	eventManager.VAddListener([pTrace](const IEventDataPtr& pEvent)
+	{
+		const EvtData_Move_Actor* pMove = static_cast<const EvtData_Move_Actor*>(pEvent.get());
+		DispatchedMove move = { pMove->GetId(), pMove->GetMatrix()[3][0] };
+		pTrace->moves.push_back(move);
+	}, EvtData_Move_Actor::sk_EventType);
+	eventManager.VAddListener([pTrace](const IEventDataPtr&)
+	{
+		pTrace->numDestroyed++;
+	}, EvtData_Destroy_Actor::sk_EventType);
+	eventManager.VSetCoalescing(EvtData_Move_Actor::sk_EventType, true);
+
+	TestLatestMoveSurvives(eventManager, trace);
+	TestDeferredMovesCoalesce(eventManager, trace);
+
+	//Budgets are 64 bit microseconds, 0xffffffff is a budget of 71 minutes and not "process everything"
+	TEST_CHECK(IEventManager::kINFINITE == UINT64_MAX);
+
+	printf("%u actors, %u moves each: %u coalesced\n", NUM_ACTORS, MOVES_PER_ACTOR, NUM_ACTORS * (MOVES_PER_ACTOR - 1));
+
+	return TEST_RESULT();
+}
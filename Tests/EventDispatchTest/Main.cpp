@@ -0,0 +1,203 @@
+/*
+*	Copyright 2015-2016 Tomas Mikalauskas. All rights reserved.
+*	GitHub repository - https://github.com/TywyllSoftware/TywRenderer
+*	This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+#include <RendererPch/stdafx.h>
+
+//EventManager Includes
+#include <Renderer/EventManager/EventManagerImpl.h>
+
+//Test Includes
+#include <Tests/TestCommon.h>
+
+
+static const uint32_t EVENTS_PER_FRAME = 10000;
+static const uint32_t WARMUP_FRAMES = 4;
+static const uint32_t MEASURED_FRAMES = 200;
+
+//Throughput the dispatch path has to reach
+static const double MIN_EVENTS_PER_SEC = 1000000.0;
+
+
+//
+// Every heap allocation of the process goes through these, so the benchmark
+// can tell whether dispatching allocated anything.
+//
+static std::atomic<uint64_t> g_NumHeapAllocations(0);
+
+void* operator new(size_t size)
+{
+	g_NumHeapAllocations.fetch_add(1, std::memory_order_relaxed);
+	if (void* p = malloc(size ? size : 1))
+		return p;
+	throw std::bad_alloc();
+}
+
+void* operator new[](size_t size)
+{
+	return operator new(size);
+}
+
+void operator delete(void* p) noexcept
+{
+	free(p);
+}
+
+void operator delete[](void* p) noexcept
+{
+	free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+	free(p);
+}
+
+void operator delete[](void* p, size_t) noexcept
+{
+	free(p);
+}
+
+
+class EvtData_Test_Move : public BaseEventData
+{
+	uint32_t m_ActorId;
+	float m_X, m_Y, m_Z;
+
+public:
+	static const EventType sk_EventType;
+
+	EvtData_Test_Move() : m_ActorId(0), m_X(0.0f), m_Y(0.0f), m_Z(0.0f) { }
+	EvtData_Test_Move(uint32_t actorId, float x, float y, float z) : m_ActorId(actorId), m_X(x), m_Y(y), m_Z(z) { }
+
+	virtual const EventType& VGetEventType(void) const { return sk_EventType; }
+	virtual IEventDataPtr VCopy(void) const { return MakeEvent<EvtData_Test_Move>(m_ActorId, m_X, m_Y, m_Z); }
+	virtual const char* GetName(void) const { return "EvtData_Test_Move"; }
+
+	uint32_t GetActorId() const { return m_ActorId; }
+	float GetX() const { return m_X; }
+};
+
+class EvtData_Test_Hit : public BaseEventData
+{
+	uint32_t m_ActorId;
+
+public:
+	static const EventType sk_EventType;
+
+	explicit EvtData_Test_Hit(uint32_t actorId = 0) : m_ActorId(actorId) { }
+
+	virtual const EventType& VGetEventType(void) const { return sk_EventType; }
+	virtual IEventDataPtr VCopy(void) const { return MakeEvent<EvtData_Test_Hit>(m_ActorId); }
+	virtual const char* GetName(void) const { return "EvtData_Test_Hit"; }
+
+	uint32_t GetActorId() const { return m_ActorId; }
+};
+
+const EventType EvtData_Test_Move::sk_EventType(0x5d2e91c4);
+const EventType EvtData_Test_Hit::sk_EventType(0x0b7f3a62);
+
+
+struct ListenerTotals
+{
+	uint64_t	numMoves;
+	uint64_t	numHits;
+	uint64_t	numTriggered;
+	double		sumX;
+};
+
+
+//
+// RunFrame
+//
+//	One frame worth of game events: mostly queued moves, some queued hits and
+//	a few triggered right away. Half of the events are created from the pool, the
+//	rest are posted again from a reused pointer.
+//
+static void RunFrame(EventManager& eventManager, const IEventDataPtr& pReusedHit, uint32_t frame)
+{
+	for (uint32_t i = 0; i < EVENTS_PER_FRAME; i++)
+	{
+		if ((i & 1) == 0)
+		{
+			eventManager.VQueueEvent(MakeEvent<EvtData_Test_Move>(i, static_cast<float>(frame), 0.0f, 1.0f));
+		}
+		else if ((i & 15) == 1)
+		{
+			eventManager.VTriggerEvent(pReusedHit);
+		}
+		else
+		{
+			eventManager.VQueueEvent(pReusedHit);
+		}
+	}
+	eventManager.VUpdate();
+}
+
+
+int main()
+{
+	EventManager eventManager;
+	ListenerTotals totals;
+	memset(&totals, 0, sizeof(totals));
+
+	//Captures one pointer, fits into std::function without a heap block
+	ListenerTotals* pTotals = &totals;
+	eventManager.VAddListener([pTotals](const IEventDataPtr& pEvent)
+	{
+		const EvtData_Test_Move* pMove = static_cast<const EvtData_Test_Move*>(pEvent.get());
+		pTotals->numMoves++;
+		pTotals->sumX += pMove->GetX();
+	}, EvtData_Test_Move::sk_EventType);
+	eventManager.VAddListener([pTotals](const IEventDataPtr&)
+	{
+		pTotals->numHits++;
+	}, EvtData_Test_Hit::sk_EventType);
+
+	const IEventDataPtr pReusedHit = MakeEvent<EvtData_Test_Hit>(7);
+
+	//Pool chunks, queue storage and profiler entries are allocated while warming up
+	for (uint32_t frame = 0; frame < WARMUP_FRAMES; frame++)
+	{
+		RunFrame(eventManager, pReusedHit, frame);
+	}
+
+	const EventPoolStats poolBefore = EventPool::Get().GetStats();
+	const uint64_t allocationsBefore = g_NumHeapAllocations.load();
+	uint32_t numProcessed = 0;
+
+	auto tStart = std::chrono::high_resolution_clock::now();
+	for (uint32_t frame = 0; frame < MEASURED_FRAMES; frame++)
+	{
+		RunFrame(eventManager, pReusedHit, frame);
+		numProcessed += eventManager.GetStats().numProcessed;
+	}
+	const double elapsedMs = TestElapsedMs(tStart);
+
+	const uint64_t numHeapAllocations = g_NumHeapAllocations.load() - allocationsBefore;
+	const EventPoolStats poolAfter = EventPool::Get().GetStats();
+
+	const uint64_t numEvents = static_cast<uint64_t>(EVENTS_PER_FRAME) * MEASURED_FRAMES;
+	const double eventsPerSec = numEvents / (std::max(elapsedMs, 0.001) * 0.001);
+
+	TEST_CHECK(numHeapAllocations == 0);
+	TEST_CHECK(poolAfter.numChunkAllocations == poolBefore.numChunkAllocations);
+	TEST_CHECK(poolAfter.numLargeAllocations == poolBefore.numLargeAllocations);
+	TEST_CHECK(poolAfter.numAllocations - poolBefore.numAllocations == numEvents / 2);
+	TEST_CHECK(eventManager.GetStats().numDeferred == 0);
+
+	//Every queued event was dispatched, triggered ones bypass the queue
+	const uint64_t numTriggered = static_cast<uint64_t>((EVENTS_PER_FRAME + 14) / 16) * MEASURED_FRAMES;
+	TEST_CHECK(numProcessed == numEvents - numTriggered);
+	TEST_CHECK(totals.numMoves + totals.numHits == static_cast<uint64_t>(EVENTS_PER_FRAME) * (WARMUP_FRAMES + MEASURED_FRAMES));
+
+	printf("%llu events in %.2f ms: %.2f M events/s, %llu heap allocations, %llu pool chunk allocations, %u pool blocks in use\n",
+		static_cast<unsigned long long>(numEvents), elapsedMs, eventsPerSec / 1000000.0,
+		static_cast<unsigned long long>(numHeapAllocations),
+		static_cast<unsigned long long>(poolAfter.numChunkAllocations - poolBefore.numChunkAllocations), poolAfter.numBlocksInUse);
+
+	TEST_CHECK(eventsPerSec >= MIN_EVENTS_PER_SEC);
+
+	return TEST_RESULT();
+}
@@ -0,0 +1,277 @@
+/*
+*	Copyright 2015-2016 Tomas Mikalauskas. All rights reserved.
+*	GitHub repository - https://github.com/TywyllSoftware/TywRenderer
+*	This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+#include <RendererPch/stdafx.h>
+
+//JobSystem Includes
+#include <Renderer/JobSystem/JobSystem.h>
+
+//Test Includes
+#include <Tests/TestCommon.h>
+
+
+//Items every deque round pushes. Small enough that thieves often race the owner for the last item
+static const uint32_t DEQUE_ITEMS_PER_ROUND = 64;
+static const uint32_t DEQUE_ROUNDS = 2000;
+static const uint32_t DEQUE_THIEVES = 3;
+
+static const uint32_t CONTINUATION_ROUNDS = 200;
+static const uint32_t CONTINUATION_JOBS = 32;
+
+static const uint32_t BENCHMARK_COUNT = 1 << 22;
+
+
+//
+// TestDequeStealRace
+//
+//	Owner pushes and pops while thieves steal. Every item has to be taken
+//	exactly once, also when pop and steal race for the last item.
+//
+static void TestDequeStealRace()
+{
+	WorkStealingDeque<uint32_t> deque(DEQUE_ITEMS_PER_ROUND);
+	std::vector<uint32_t> items(DEQUE_ITEMS_PER_ROUND * DEQUE_ROUNDS);
+	std::vector<std::atomic<uint32_t>> taken(items.size());
+	for (size_t i = 0; i < items.size(); i++)
+	{
+		items[i] = static_cast<uint32_t>(i);
+		taken[i].store(0);
+	}
+
+	std::atomic<bool> bDone(false);
+	std::atomic<uint32_t> numStolen(0);
+	std::vector<std::thread> thieves;
+	for (uint32_t t = 0; t < DEQUE_THIEVES; t++)
+	{
+		thieves.emplace_back([&]()
+		{
+			while (!bDone.load())
+			{
+				if (uint32_t* pItem = deque.Steal())
+				{
+					taken[*pItem].fetch_add(1);
+					numStolen.fetch_add(1);
+				}
+			}
+		});
+	}
+
+	uint32_t numPopped = 0;
+	for (uint32_t round = 0; round < DEQUE_ROUNDS; round++)
+	{
+		for (uint32_t i = 0; i < DEQUE_ITEMS_PER_ROUND; i++)
+		{
+			TEST_CHECK(deque.Push(&items[round * DEQUE_ITEMS_PER_ROUND + i]));
+		}
+
+		//Lets thieves in when there are fewer cores than threads
+		std::this_thread::yield();
+
+		while (!deque.Empty())
+		{
+			if (uint32_t* pItem = deque.Pop())
+			{
+				taken[*pItem].fetch_add(1);
+				numPopped++;
+			}
+		}
+	}
+
+	bDone.store(true);
+	for (auto& thief : thieves)
+	{
+		thief.join();
+	}
+
+	uint32_t numWrong = 0;
+	for (size_t i = 0; i < taken.size(); i++)
+	{
+		numWrong += taken[i].load() != 1 ? 1 : 0;
+	}
+	TEST_CHECK(numWrong == 0);
+	TEST_CHECK(numPopped + numStolen.load() == items.size());
+	printf("Deque: %u popped, %u stolen, %u items taken not exactly once\n", numPopped, numStolen.load(), numWrong);
+}
+
+
+//
+// TestSubmitAfter
+//
+//	A continuation must not start before every job of its dependency finished,
+//	also when the dependency is already done while it is submitted.
+//
+static void TestSubmitAfter(JobSystem& jobs)
+{
+	uint32_t numEarly = 0;
+	uint32_t numMissing = 0;
+	for (uint32_t round = 0; round < CONTINUATION_ROUNDS; round++)
+	{
+		std::atomic<uint32_t> numFinished(0);
+		std::atomic<uint32_t> finishedAtStart(UINT32_MAX);
+		std::atomic<bool> bSecondRan(false);
+
+		JobCounter dependency;
+		JobCounter done;
+		for (uint32_t i = 0; i < CONTINUATION_JOBS; i++)
+		{
+			jobs.Submit([&numFinished]()
+			{
+				std::this_thread::yield();
+				numFinished.fetch_add(1);
+			}, &dependency);
+		}
+
+		jobs.SubmitAfter(&dependency, [&]()
+		{
+			finishedAtStart.store(numFinished.load());
+		}, &done);
+
+		//Chained on a counter that may already be zero
+		JobCounter first;
+		jobs.SubmitAfter(&dependency, [](){}, &first);
+		jobs.Wait(&first);
+		jobs.SubmitAfter(&first, [&bSecondRan]()
+		{
+			bSecondRan.store(true);
+		}, &done);
+
+		jobs.Wait(&done);
+		numEarly += finishedAtStart.load() != CONTINUATION_JOBS ? 1 : 0;
+		numMissing += bSecondRan.load() ? 0 : 1;
+	}
+
+	TEST_CHECK(numEarly == 0);
+	TEST_CHECK(numMissing == 0);
+	printf("SubmitAfter (%u threads): %u early continuations, %u lost continuations\n", jobs.GetThreadCount(), numEarly, numMissing);
+}
+
+
+//
+// CheckRangeCoverage
+//
+//	Every index of [0, count) is visited exactly once
+//
+static void CheckRangeCoverage(const std::function<void(uint32_t, uint32_t, const ParallelForFunction&)>& parallelFor, uint32_t count, uint32_t minBatchSize)
+{
+	std::vector<std::atomic<uint32_t>> visits(count);
+	for (auto& visit : visits)
+	{
+		visit.store(0);
+	}
+
+	std::atomic<uint32_t> numBadRanges(0);
+	parallelFor(count, minBatchSize, [&](uint32_t first, uint32_t last)
+	{
+		if (first >= last || last > count)
+		{
+			numBadRanges.fetch_add(1);
+			return;
+		}
+
+		for (uint32_t i = first; i < last; i++)
+		{
+			visits[i].fetch_add(1);
+		}
+	});
+
+	uint32_t numWrong = 0;
+	for (auto& visit : visits)
+	{
+		numWrong += visit.load() != 1 ? 1 : 0;
+	}
+	TEST_CHECK(numWrong == 0);
+	TEST_CHECK(numBadRanges.load() == 0);
+	if (numWrong || numBadRanges.load())
+	{
+		printf("ParallelFor count %u batch %u: %u indices not visited exactly once, %u bad ranges\n", count, minBatchSize, numWrong, numBadRanges.load());
+	}
+}
+
+
+static void TestParallelForCoverage(JobSystem& jobs)
+{
+	const uint32_t counts[] = { 0, 1, 2, 7, 64, 1000, 4097, 100003 };
+	const uint32_t batchSizes[] = { 0, 1, 3, 64, 5000 };
+	for (uint32_t count : counts)
+	{
+		for (uint32_t minBatchSize : batchSizes)
+		{
+			CheckRangeCoverage([&jobs](uint32_t n, uint32_t batch, const ParallelForFunction& function)
+			{
+				jobs.ParallelFor(n, batch, function);
+			}, count, minBatchSize);
+
+			//Free function on the engine job system
+			jobSystem = &jobs;
+			CheckRangeCoverage(ParallelFor, count, minBatchSize);
+			jobSystem = nullptr;
+		}
+	}
+
+	//Nested ParallelFor from inside jobs
+	std::atomic<uint32_t> numInner(0);
+	jobs.ParallelFor(16, 1, [&](uint32_t first, uint32_t last)
+	{
+		for (uint32_t i = first; i < last; i++)
+		{
+			jobs.ParallelFor(1000, 10, [&](uint32_t innerFirst, uint32_t innerLast)
+			{
+				numInner.fetch_add(innerLast - innerFirst);
+			});
+		}
+	});
+	TEST_CHECK(numInner.load() == 16 * 1000);
+}
+
+
+//
+// BenchmarkParallelFor
+//
+//	Same work serially and on the job system. Printed, not checked, the machine may be busy
+//
+static void BenchmarkParallelFor(JobSystem& jobs)
+{
+	std::vector<float> values(BENCHMARK_COUNT);
+	auto work = [&values](uint32_t first, uint32_t last)
+	{
+		for (uint32_t i = first; i < last; i++)
+		{
+			values[i] = std::sqrt(static_cast<float>(i)) * 0.5f + std::sin(static_cast<float>(i));
+		}
+	};
+
+	auto tStart = std::chrono::high_resolution_clock::now();
+	work(0, BENCHMARK_COUNT);
+	const double serialMs = TestElapsedMs(tStart);
+
+	tStart = std::chrono::high_resolution_clock::now();
+	jobs.ParallelFor(BENCHMARK_COUNT, 4096, work);
+	const double parallelMs = TestElapsedMs(tStart);
+
+	const JobSystemStats stats = jobs.GetStats();
+	printf("ParallelFor %u items: serial %.2f ms, %u threads %.2f ms (%.2fx), %llu jobs executed, %llu stolen\n",
+		BENCHMARK_COUNT, serialMs, stats.numThreads, parallelMs, serialMs / std::max(parallelMs, 0.001),
+		static_cast<unsigned long long>(stats.numExecuted), static_cast<unsigned long long>(stats.numStolen));
+}
+
+
+int main()
+{
+	TestDequeStealRace();
+
+	const uint32_t threadCounts[] = { 1, 4, std::max(1u, std::thread::hardware_concurrency()) };
+	for (uint32_t numThreads : threadCounts)
+	{
+		JobSystem jobs(numThreads);
+		TestSubmitAfter(jobs);
+		TestParallelForCoverage(jobs);
+		BenchmarkParallelFor(jobs);
+	}
+
+	//No engine job system runs inline
+	CheckRangeCoverage(ParallelFor, 1000, 1);
+
+	return TEST_RESULT();
+}
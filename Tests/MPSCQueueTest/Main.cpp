@@ -0,0 +1,251 @@
+/*
+*	Copyright 2015-2016 Tomas Mikalauskas. All rights reserved.
+*	GitHub repository - https://github.com/TywyllSoftware/TywRenderer
+*	This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+#include <RendererPch/stdafx.h>
+
+//EventManager Includes
+#include <Renderer/EventManager/EventManagerImpl.h>
+
+//Test Includes
+#include <Tests/TestCommon.h>
+
+
+static const uint32_t ITEMS_PER_PRODUCER = 200000;
+static const uint32_t EVENTS_PER_PRODUCER = 20000;
+static const uint32_t EVENT_PRODUCERS = 4;
+
+
+//
+// Item of producer p with sequence number s is (p << 32) | s, so the consumer
+// can tell which producer it came from and whether it arrived in order.
+//
+static uint64_t MakeItem(uint32_t producer, uint32_t sequence) { return (static_cast<uint64_t>(producer) << 32) | sequence; }
+static uint32_t GetProducer(uint64_t item) { return static_cast<uint32_t>(item >> 32); }
+static uint32_t GetSequence(uint64_t item) { return static_cast<uint32_t>(item); }
+
+
+/*
+	Checks what the consumer received. A queue may interleave producers in any
+	order, but items of one producer must arrive in the order they were pushed.
+*/
+class ReceiveChecker
+{
+public:
+	explicit ReceiveChecker(uint32_t numProducers):
+		m_NextSequence(numProducers, 0),
+		m_NumOutOfOrder(0),
+		m_NumReceived(0)
+	{
+	}
+
+	void Receive(uint64_t item)
+	{
+		const uint32_t producer = GetProducer(item);
+		if (producer >= m_NextSequence.size() || GetSequence(item) != m_NextSequence[producer])
+		{
+			m_NumOutOfOrder++;
+			return;
+		}
+		m_NextSequence[producer]++;
+		m_NumReceived++;
+	}
+
+	// Producers that did not deliver everything
+	uint32_t GetNumIncomplete(uint32_t itemsPerProducer) const
+	{
+		uint32_t numIncomplete = 0;
+		for (uint32_t next : m_NextSequence)
+		{
+			numIncomplete += next != itemsPerProducer ? 1 : 0;
+		}
+		return numIncomplete;
+	}
+
+	uint32_t GetNumOutOfOrder() const { return m_NumOutOfOrder; }
+	uint64_t GetNumReceived() const { return m_NumReceived; }
+
+private:
+	std::vector<uint32_t>	m_NextSequence;
+	uint32_t				m_NumOutOfOrder;
+	uint64_t				m_NumReceived;
+};
+
+
+//
+// BenchmarkQueue
+//
+//	Producers push as fast as they can, retrying when the queue is full. The
+//	main thread is the single consumer. Nothing may be lost, duplicated or reordered
+//
+static void BenchmarkQueue(uint32_t numProducers, uint32_t capacity)
+{
+	MPSCQueue<uint64_t> queue(capacity);
+	ReceiveChecker checker(numProducers);
+
+	std::atomic<uint32_t> numReady(0);
+	std::atomic<bool> bGo(false);
+	std::vector<std::thread> producers;
+	for (uint32_t p = 0; p < numProducers; p++)
+	{
+		producers.emplace_back([&, p]()
+		{
+			numReady.fetch_add(1);
+			while (!bGo.load())
+			{
+				std::this_thread::yield();
+			}
+
+			for (uint32_t s = 0; s < ITEMS_PER_PRODUCER; s++)
+			{
+				while (!queue.TryPush(MakeItem(p, s)))
+				{
+					std::this_thread::yield();
+				}
+			}
+		});
+	}
+
+	while (numReady.load() != numProducers)
+	{
+		std::this_thread::yield();
+	}
+
+	const uint64_t numExpected = static_cast<uint64_t>(numProducers) * ITEMS_PER_PRODUCER;
+	auto tStart = std::chrono::high_resolution_clock::now();
+	bGo.store(true);
+
+	uint64_t item;
+	while (checker.GetNumReceived() + checker.GetNumOutOfOrder() < numExpected)
+	{
+		if (queue.TryPop(item))
+		{
+			checker.Receive(item);
+		}
+		else
+		{
+			std::this_thread::yield();
+		}
+	}
+	const double elapsedMs = TestElapsedMs(tStart);
+
+	for (auto& producer : producers)
+	{
+		producer.join();
+	}
+
+	//Nothing left over
+	TEST_CHECK(!queue.TryPop(item));
+
+	const MPSCQueueStats stats = queue.GetStats();
+	TEST_CHECK(checker.GetNumOutOfOrder() == 0);
+	TEST_CHECK(checker.GetNumIncomplete(ITEMS_PER_PRODUCER) == 0);
+	TEST_CHECK(stats.numPushed == numExpected);
+	TEST_CHECK(stats.numPopped == numExpected);
+	TEST_CHECK(stats.maxOccupancy <= stats.capacity);
+
+	printf("%u producers, capacity %5u: %.2f M items/s, %llu failed pushes, max occupancy %u, %u out of order, %u producers incomplete\n",
+		numProducers, stats.capacity, numExpected / (std::max(elapsedMs, 0.001) * 1000.0),
+		static_cast<unsigned long long>(stats.numFailedPushes), stats.maxOccupancy,
+		checker.GetNumOutOfOrder(), checker.GetNumIncomplete(ITEMS_PER_PRODUCER));
+}
+
+
+/*
+	Carries the item a producer thread posted
+*/
+class EvtData_Test_Item : public BaseEventData
+{
+	uint64_t m_Item;
+
+public:
+	static const EventType sk_EventType;
+
+	explicit EvtData_Test_Item(uint64_t item = 0) : m_Item(item) { }
+
+	virtual const EventType& VGetEventType(void) const { return sk_EventType; }
+	virtual IEventDataPtr VCopy(void) const { return MakeEvent<EvtData_Test_Item>(m_Item); }
+	virtual const char* GetName(void) const { return "EvtData_Test_Item"; }
+
+	uint64_t GetItem() const { return m_Item; }
+};
+
+const EventType EvtData_Test_Item::sk_EventType(0x3c5be7a1);
+
+
+//
+// TestThreadSafeQueueEvent
+//
+//	Worker threads post with VThreadSafeQueueEvent while the main thread runs
+//	VUpdate. Every event reaches the listener, in order per worker
+//
+static void TestThreadSafeQueueEvent()
+{
+	EventManager eventManager(256);
+	ReceiveChecker checker(EVENT_PRODUCERS);
+	eventManager.VAddListener([&checker](const IEventDataPtr& pEvent)
+	{
+		checker.Receive(static_cast<const EvtData_Test_Item*>(pEvent.get())->GetItem());
+	}, EvtData_Test_Item::sk_EventType);
+
+	std::vector<std::thread> producers;
+	for (uint32_t p = 0; p < EVENT_PRODUCERS; p++)
+	{
+		producers.emplace_back([&eventManager, p]()
+		{
+			for (uint32_t s = 0; s < EVENTS_PER_PRODUCER; s++)
+			{
+				const IEventDataPtr pEvent = MakeEvent<EvtData_Test_Item>(MakeItem(p, s));
+				while (!eventManager.VThreadSafeQueueEvent(pEvent))
+				{
+					std::this_thread::yield();
+				}
+			}
+		});
+	}
+
+	const uint64_t numExpected = static_cast<uint64_t>(EVENT_PRODUCERS) * EVENTS_PER_PRODUCER;
+	uint64_t numRealtime = 0;
+	uint32_t numUpdates = 0;
+	auto tStart = std::chrono::high_resolution_clock::now();
+	while (checker.GetNumReceived() + checker.GetNumOutOfOrder() < numExpected)
+	{
+		eventManager.VUpdate();
+		numRealtime += eventManager.GetStats().numRealtime;
+		numUpdates++;
+		std::this_thread::yield();
+	}
+	const double elapsedMs = TestElapsedMs(tStart);
+
+	for (auto& producer : producers)
+	{
+		producer.join();
+	}
+
+	TEST_CHECK(checker.GetNumOutOfOrder() == 0);
+	TEST_CHECK(checker.GetNumIncomplete(EVENTS_PER_PRODUCER) == 0);
+	TEST_CHECK(numRealtime == numExpected);
+	TEST_CHECK(eventManager.GetRealtimeQueueStats().numPopped == numExpected);
+
+	printf("VThreadSafeQueueEvent, %u producers: %.2f M events/s over %u updates, %u out of order, %u producers incomplete\n",
+		EVENT_PRODUCERS, numExpected / (std::max(elapsedMs, 0.001) * 1000.0), numUpdates,
+		checker.GetNumOutOfOrder(), checker.GetNumIncomplete(EVENTS_PER_PRODUCER));
+}
+
+
+int main()
+{
+	const uint32_t producerCounts[] = { 1, 2, 4, 8 };
+	for (uint32_t numProducers : producerCounts)
+	{
+		BenchmarkQueue(numProducers, EVENTMANAGER_REALTIME_QUEUE_SIZE);
+	}
+
+	//Queue is full most of the time, producers keep racing for the few free slots
+	BenchmarkQueue(4, 2);
+
+	TestThreadSafeQueueEvent();
+
+	return TEST_RESULT();
+}
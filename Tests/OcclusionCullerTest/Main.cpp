@@ -0,0 +1,186 @@
+/*
+*	Copyright 2015-2016 Tomas Mikalauskas. All rights reserved.
+*	GitHub repository - https://github.com/TywyllSoftware/TywRenderer
+*	This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+#include <RendererPch/stdafx.h>
+
+//Renderer Includes
+#include <Renderer/Geometry/VertData.h>
+
+//Culling Includes
+#include <Renderer/Culling/OcclusionCuller.h>
+
+//Test Includes
+#include <Tests/TestCommon.h>
+
+
+//Camera at the origin looking down -z. Wall half size 3 at distance 10 covers the middle of the screen
+static const float WALL_HALF_SIZE = 3.0f;
+static const float WALL_Z = -10.0f;
+
+
+//
+// BuildBox
+//
+//	Closed box, 12 triangles. Used as occluder mesh
+//
+static void BuildBox(const glm::vec3& boundsMin, const glm::vec3& boundsMax, std::vector<drawVert>& verts, std::vector<uint32_t>& indexes)
+{
+	verts.clear();
+	for (uint32_t i = 0; i < 8; i++)
+	{
+		const glm::vec3 corner((i & 1) ? boundsMax.x : boundsMin.x, (i & 2) ? boundsMax.y : boundsMin.y, (i & 4) ? boundsMax.z : boundsMin.z);
+		verts.push_back(drawVert(corner, glm::vec3(0.0f), glm::vec2(0.0f)));
+	}
+
+	const uint32_t faces[6][4] =
+	{
+		{ 0, 1, 3, 2 }, { 4, 6, 7, 5 },		// -z, +z
+		{ 0, 2, 6, 4 }, { 1, 5, 7, 3 },		// -x, +x
+		{ 0, 4, 5, 1 }, { 2, 3, 7, 6 }		// -y, +y
+	};
+	indexes.clear();
+	for (const auto& face : faces)
+	{
+		const uint32_t quad[6] = { face[0], face[1], face[2], face[0], face[2], face[3] };
+		indexes.insert(indexes.end(), quad, quad + 6);
+	}
+}
+
+
+static glm::mat4x4 GetViewProjection(const OcclusionCuller& culler)
+{
+	const float aspect = static_cast<float>(culler.GetWidth()) / culler.GetHeight();
+	const glm::mat4x4 projection = glm::perspective(glm::radians(60.0f), aspect, 0.1f, 256.0f);
+	const glm::mat4x4 view = glm::lookAt(glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+	return projection * view;
+}
+
+
+//
+// TestWall
+//
+//	Flat wall quad as the only occluder
+//
+static void TestWall()
+{
+	OcclusionCuller culler;
+	culler.BeginFrame(GetViewProjection(culler));
+
+	const drawVert wall[4] =
+	{
+		drawVert(glm::vec3(-WALL_HALF_SIZE, -WALL_HALF_SIZE, WALL_Z), glm::vec3(0.0f, 0.0f, 1.0f), glm::vec2(0.0f, 0.0f)),
+		drawVert(glm::vec3( WALL_HALF_SIZE, -WALL_HALF_SIZE, WALL_Z), glm::vec3(0.0f, 0.0f, 1.0f), glm::vec2(1.0f, 0.0f)),
+		drawVert(glm::vec3( WALL_HALF_SIZE,  WALL_HALF_SIZE, WALL_Z), glm::vec3(0.0f, 0.0f, 1.0f), glm::vec2(1.0f, 1.0f)),
+		drawVert(glm::vec3(-WALL_HALF_SIZE,  WALL_HALF_SIZE, WALL_Z), glm::vec3(0.0f, 0.0f, 1.0f), glm::vec2(0.0f, 1.0f))
+	};
+	const uint32_t wallIndexes[6] = { 0, 1, 2, 0, 2, 3 };
+	culler.RenderOccluder(wall, 4, wallIndexes, 6, glm::mat4x4(1.0f));
+	TEST_CHECK(culler.GetStats().numRasterizedTriangles == 2);
+
+	const glm::mat4x4 identity(1.0f);
+
+	//Small box right behind the wall
+	TEST_CHECK(!culler.TestAABB(glm::vec3(-1.0f, -1.0f, -30.0f), glm::vec3(1.0f, 1.0f, -25.0f), identity));
+
+	//Same box moved behind the wall by its world matrix
+	const glm::mat4x4 behind = glm::translate(identity, glm::vec3(0.5f, -0.5f, -40.0f));
+	TEST_CHECK(!culler.TestAABB(glm::vec3(-1.0f), glm::vec3(1.0f), behind));
+
+	//In front of the wall
+	TEST_CHECK(culler.TestAABB(glm::vec3(-1.0f, -1.0f, -6.0f), glm::vec3(1.0f, 1.0f, -5.0f), identity));
+
+	//Behind the wall depth but beside it on screen
+	TEST_CHECK(culler.TestAABB(glm::vec3(15.0f, -1.0f, -30.0f), glm::vec3(17.0f, 1.0f, -28.0f), identity));
+
+	//Behind, but larger than the wall on screen
+	TEST_CHECK(culler.TestAABB(glm::vec3(-20.0f, -2.0f, -30.0f), glm::vec3(20.0f, 2.0f, -25.0f), identity));
+
+	//Crossing the wall
+	TEST_CHECK(culler.TestAABB(glm::vec3(-1.0f, -1.0f, -12.0f), glm::vec3(1.0f, 1.0f, -8.0f), identity));
+
+	//The wall's own bounds must not be hidden by the wall
+	TEST_CHECK(culler.TestAABB(glm::vec3(-WALL_HALF_SIZE, -WALL_HALF_SIZE, WALL_Z), glm::vec3(WALL_HALF_SIZE, WALL_HALF_SIZE, WALL_Z), identity));
+
+	const OcclusionStats& stats = culler.GetStats();
+	TEST_CHECK(stats.numOccludeesTested == 7);
+	TEST_CHECK(stats.numOccludeesCulled == 2);
+	printf("Wall: %u of %u occludees culled, %u outside\n", stats.numOccludeesCulled, stats.numOccludeesTested, stats.numOccludeesOutside);
+}
+
+
+//
+// TestSelfOcclusion
+//
+//	Surfaces that are occluders and occludees at the same time, with and
+//	without a world transform. None of them may cull itself.
+//
+static void TestSelfOcclusion()
+{
+	OcclusionCuller culler;
+	const glm::mat4x4 viewProjection = GetViewProjection(culler);
+
+	const glm::vec3 boundsMin(-2.0f, -2.0f, -2.0f);
+	const glm::vec3 boundsMax(2.0f, 2.0f, 2.0f);
+	std::vector<drawVert> verts;
+	std::vector<uint32_t> indexes;
+	BuildBox(boundsMin, boundsMax, verts, indexes);
+
+	const float distances[] = { 5.0f, 12.0f, 40.0f, 120.0f, 240.0f };
+	uint32_t numSelfCulled = 0;
+	for (float distance : distances)
+	{
+		const glm::mat4x4 world = glm::translate(glm::mat4x4(1.0f), glm::vec3(0.3f, -0.2f, -distance)) *
+			glm::rotate(glm::mat4x4(1.0f), 0.4f, glm::vec3(0.0f, 1.0f, 0.0f));
+
+		culler.BeginFrame(viewProjection);
+		culler.RenderOccluder(verts.data(), static_cast<uint32_t>(verts.size()), indexes.data(), static_cast<uint32_t>(indexes.size()), world);
+		numSelfCulled += culler.TestAABB(boundsMin, boundsMax, world) ? 0 : 1;
+
+		//A box sharing only the front face with the occluder is still in front of it
+		culler.BeginFrame(viewProjection);
+		const drawVert front[3] =
+		{
+			drawVert(glm::vec3(-20.0f, -20.0f, -distance), glm::vec3(0.0f, 0.0f, 1.0f), glm::vec2(0.0f)),
+			drawVert(glm::vec3( 20.0f, -20.0f, -distance), glm::vec3(0.0f, 0.0f, 1.0f), glm::vec2(0.0f)),
+			drawVert(glm::vec3(  0.0f,  20.0f, -distance), glm::vec3(0.0f, 0.0f, 1.0f), glm::vec2(0.0f))
+		};
+		culler.RenderOccluder(front, 3, nullptr, 0, glm::mat4x4(1.0f));
+		numSelfCulled += culler.TestAABB(glm::vec3(-1.0f, -1.0f, -distance - 2.0f), glm::vec3(1.0f, 1.0f, -distance), glm::mat4x4(1.0f)) ? 0 : 1;
+	}
+
+	TEST_CHECK(numSelfCulled == 0);
+	printf("Self occlusion: %u surfaces culled by themselves\n", numSelfCulled);
+}
+
+
+//
+// TestEmpty
+//
+//	Nothing rendered, nothing hidden. Boxes off screen are reported as outside
+//
+static void TestEmpty()
+{
+	OcclusionCuller culler(100, 50);
+	TEST_CHECK(culler.GetWidth() == 104 && culler.GetHeight() == 52);
+
+	culler.BeginFrame(GetViewProjection(culler));
+	TEST_CHECK(culler.TestAABB(glm::vec3(-1.0f, -1.0f, -30.0f), glm::vec3(1.0f, 1.0f, -25.0f), glm::mat4x4(1.0f)));
+
+	//Left of the view frustum
+	TEST_CHECK(!culler.TestAABB(glm::vec3(-200.0f, -1.0f, -30.0f), glm::vec3(-190.0f, 1.0f, -25.0f), glm::mat4x4(1.0f)));
+	TEST_CHECK(culler.GetStats().numOccludeesOutside == 1);
+	TEST_CHECK(culler.GetStats().numOccludeesCulled == 0);
+	TEST_CHECK(culler.GetTileDepth(0, 0) == FLT_MAX);
+}
+
+
+int main()
+{
+	TestWall();
+	TestSelfOcclusion();
+	TestEmpty();
+
+	return TEST_RESULT();
+}
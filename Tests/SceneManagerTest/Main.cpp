@@ -0,0 +1,175 @@
+/*
+*	Copyright 2015-2016 Tomas Mikalauskas. All rights reserved.
+*	GitHub repository - https://github.com/TywyllSoftware/TywRenderer
+*	This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+#include <RendererPch/stdafx.h>
+
+//SceneManager Includes
+#include <Renderer/SceneManager/SceneNode.h>
+#include <Renderer/SceneManager/SceneManager.h>
+
+//JobSystem Includes
+#include <Renderer/JobSystem/JobSystem.h>
+
+//Test Includes
+#include <Tests/TestCommon.h>
+
+
+//1000 subtrees of 10 nodes: subtree root, 3 children, 2 grandchildren each
+static const uint32_t NUM_SUBTREES = 1000;
+static const uint32_t NUM_CHILDREN = 3;
+static const uint32_t NUM_GRANDCHILDREN = 2;
+static const uint32_t NODES_PER_SUBTREE = 1 + NUM_CHILDREN * (1 + NUM_GRANDCHILDREN);
+static const uint32_t NUM_FRAMES = 20;
+static const int FRAME_MILLISEC = 16;
+
+//Busy work per update so a frame costs about as much as a small game update
+static const uint32_t UPDATE_WORK_ITERATIONS = 64;
+
+
+/*
+	Spins around its own axis. Touches only its own state, which is what
+	SceneManager::SetJobSystem asks of VOnUpdate.
+*/
+class SpinNode : public SceneNode
+{
+public:
+	SpinNode(uint32_t actorId, RenderPass renderPass, const glm::vec3& offset, float speed):
+		SceneNode(actorId, renderPass, nullptr),
+		m_Offset(offset),
+		m_Speed(speed),
+		m_Angle(0.0f),
+		m_Wobble(0.0f),
+		m_NumUpdates(0)
+	{
+	}
+
+	virtual bool VOnUpdate(SceneManager* pScene, DWORD const elapsedMs)
+	{
+		m_Angle += m_Speed * elapsedMs * 0.001f;
+
+		float wobble = m_Angle;
+		for (uint32_t i = 0; i < UPDATE_WORK_ITERATIONS; i++)
+		{
+			wobble = std::sin(wobble) * 0.5f + std::cos(wobble * 1.5f) * 0.25f;
+		}
+		m_Wobble = wobble;
+
+		const glm::mat4x4 toWorld = glm::translate(glm::mat4x4(1.0f), m_Offset + glm::vec3(0.0f, m_Wobble, 0.0f)) *
+			glm::rotate(glm::mat4x4(1.0f), m_Angle, glm::vec3(0.0f, 1.0f, 0.0f));
+		VSetTransform(&toWorld);
+		m_NumUpdates++;
+
+		return SceneNode::VOnUpdate(pScene, elapsedMs);
+	}
+
+	uint32_t GetNumUpdates() const { return m_NumUpdates; }
+
+private:
+	glm::vec3	m_Offset;
+	float		m_Speed;
+	float		m_Angle;
+	float		m_Wobble;
+	uint32_t	m_NumUpdates;
+};
+
+
+struct SceneRunResult
+{
+	std::vector<glm::mat4x4>	worldMatrices;
+	double						frameMilliSec;
+	uint32_t					numWrongUpdateCounts;
+	SceneUpdateStats			lastStats;
+};
+
+
+//
+// RunScene
+//
+//	Builds the 10k node scene and updates it NUM_FRAMES times
+//
+static SceneRunResult RunScene(JobSystem* pJobs)
+{
+	SceneManager scene;
+	scene.SetJobSystem(pJobs);
+
+	std::vector<std::shared_ptr<SpinNode>> nodes;
+	nodes.reserve(NUM_SUBTREES * NODES_PER_SUBTREE);
+	for (uint32_t s = 0; s < NUM_SUBTREES; s++)
+	{
+		const RenderPass pass = (s & 1) ? RenderPass::RenderPass_Actor : RenderPass::RenderPass_Static;
+		const glm::vec3 position(static_cast<float>(s % 32) * 4.0f, 0.0f, static_cast<float>(s / 32) * 4.0f);
+
+		std::shared_ptr<SpinNode> subtree(TYW_NEW SpinNode(s + 1, pass, position, 0.5f + (s % 7) * 0.1f));
+		nodes.push_back(subtree);
+		TEST_CHECK(scene.AddChild(s + 1, subtree));
+
+		for (uint32_t c = 0; c < NUM_CHILDREN; c++)
+		{
+			std::shared_ptr<SpinNode> child(TYW_NEW SpinNode(0, pass, glm::vec3(1.0f + c, 0.0f, 0.0f), 1.0f + c));
+			nodes.push_back(child);
+			subtree->VAddChild(child);
+
+			for (uint32_t g = 0; g < NUM_GRANDCHILDREN; g++)
+			{
+				std::shared_ptr<SpinNode> grandchild(TYW_NEW SpinNode(0, pass, glm::vec3(0.0f, 0.0f, 0.5f + g), 2.0f + g));
+				nodes.push_back(grandchild);
+				child->VAddChild(grandchild);
+			}
+		}
+	}
+
+	auto tStart = std::chrono::high_resolution_clock::now();
+	for (uint32_t frame = 0; frame < NUM_FRAMES; frame++)
+	{
+		scene.OnUpdate(FRAME_MILLISEC);
+	}
+
+	SceneRunResult result;
+	result.frameMilliSec = TestElapsedMs(tStart) / NUM_FRAMES;
+	result.lastStats = scene.GetUpdateStats();
+	result.numWrongUpdateCounts = 0;
+	result.worldMatrices.reserve(nodes.size());
+	for (const auto& node : nodes)
+	{
+		result.numWrongUpdateCounts += node->GetNumUpdates() != NUM_FRAMES ? 1 : 0;
+		result.worldMatrices.push_back(node->VGet()->WorldMatrix());
+	}
+	return result;
+}
+
+
+int main()
+{
+	//Serial update is the reference every thread count has to match exactly
+	const SceneRunResult reference = RunScene(nullptr);
+	TEST_CHECK(reference.numWrongUpdateCounts == 0);
+	TEST_CHECK(reference.worldMatrices.size() == NUM_SUBTREES * NODES_PER_SUBTREE);
+	printf("%u nodes, serial: %.3f ms per frame\n", static_cast<uint32_t>(reference.worldMatrices.size()), reference.frameMilliSec);
+
+	const uint32_t threadCounts[] = { 1, 4, 16 };
+	for (uint32_t numThreads : threadCounts)
+	{
+		JobSystem jobs(numThreads);
+		const SceneRunResult result = RunScene(&jobs);
+
+		uint32_t numWrongMatrices = 0;
+		for (size_t i = 0; i < result.worldMatrices.size(); i++)
+		{
+			numWrongMatrices += result.worldMatrices[i] != reference.worldMatrices[i] ? 1 : 0;
+		}
+
+		TEST_CHECK(result.numWrongUpdateCounts == 0);
+		TEST_CHECK(numWrongMatrices == 0);
+		TEST_CHECK(result.lastStats.numThreads == jobs.GetThreadCount());
+		TEST_CHECK(result.lastStats.numSubtrees == NUM_SUBTREES);
+
+		printf("%2u threads: %.3f ms per frame (%.2fx), update %.3f ms, transforms %.3f ms, %u batches, %u nodes updated wrong, %u world matrices differ\n",
+			numThreads, result.frameMilliSec, reference.frameMilliSec / std::max(result.frameMilliSec, 0.001),
+			result.lastStats.updateMilliSec, result.lastStats.transformMilliSec, result.lastStats.numBatches,
+			result.numWrongUpdateCounts, numWrongMatrices);
+	}
+
+	return TEST_RESULT();
+}
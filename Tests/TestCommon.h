@@ -0,0 +1,25 @@
+/*
+*	Copyright 2015-2016 Tomas Mikalauskas. All rights reserved.
+*	GitHub repository - https://github.com/TywyllSoftware/TywRenderer
+*	This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+#pragma once
+
+
+/*
+	Minimal checks for the test executables. A failed check is printed and
+	counted, TEST_RESULT() is the exit code CTest looks at.
+*/
+static int g_NumFailedChecks = 0;
+
+#define TEST_CHECK(condition) \
+	do { if (!(condition)) { g_NumFailedChecks++; printf("FAILED %s(%d): %s\n", __FILE__, __LINE__, #condition); } } while (0)
+
+#define TEST_RESULT() (g_NumFailedChecks == 0 ? 0 : 1)
+
+
+// Milliseconds since tStart
+inline double TestElapsedMs(const std::chrono::high_resolution_clock::time_point& tStart)
+{
+	return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - tStart).count();
+}
@@ -0,0 +1,409 @@
+/*
+*	Copyright 2015-2016 Tomas Mikalauskas. All rights reserved.
+*	GitHub repository - https://github.com/TywyllSoftware/TywRenderer
+*	This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+#include <RendererPch/stdafx.h>
+
+//Vulkan Includes
+#include <Renderer/Vulkan/VulkanMemoryAllocator.h>
+#include <Renderer/Vulkan/VulkanUploadManager.h>
+#include <Renderer/Vulkan/VulkanTools.h>
+
+//Test Includes
+#include <Tests/TestCommon.h>
+#include <Tests/VulkanTestCommon.h>
+
+
+static const VkDeviceSize KB = 1024;
+static const VkDeviceSize MB = 1024 * KB;
+
+//About what a small scene brings in: a vertex and an index buffer per surface,
+//a few textures and one buffer that does not fit into the staging ring
+static const uint32_t NUM_SURFACES = 128;
+static const uint32_t NUM_TEXTURES = 16;
+static const uint32_t TEXTURE_SIZE = 128;
+static const VkDeviceSize TEXTURE_BYTES = TEXTURE_SIZE * TEXTURE_SIZE * 4;
+static const VkDeviceSize BIG_BUFFER_BYTES = 6 * MB;
+
+//Smaller than everything that is uploaded, so the ring wraps and waits for its own batches
+static const VkDeviceSize RING_SIZE = 4 * MB;
+
+static const VkMemoryPropertyFlags HOST_MEMORY = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+
+
+/*
+	Source data of every resource. Generated once, both load paths upload the same bytes
+*/
+struct SceneData
+{
+	std::vector<std::vector<uint8_t>>	buffers;
+	std::vector<std::vector<uint8_t>>	textures;
+	VkDeviceSize						numBytes;
+};
+
+
+/*
+	Destination resources. Created fresh for every load so a load that copies
+	nothing can not pass on data of the load before it. Buffers are host visible
+	to read them back, images are optimal tiled like real textures.
+*/
+struct SceneResources
+{
+	std::vector<VkBuffer>			buffers;
+	std::vector<VulkanAllocation>	bufferAllocations;
+	std::vector<VkImage>			images;
+	std::vector<VulkanAllocation>	imageAllocations;
+};
+
+
+static void FillPattern(std::vector<uint8_t>& data, VkDeviceSize size, uint32_t seed)
+{
+	data.resize(static_cast<size_t>(size));
+	uint32_t value = seed * 2654435761u + 1;
+	for (size_t i = 0; i < data.size(); i++)
+	{
+		value = value * 1664525u + 1013904223u;
+		data[i] = static_cast<uint8_t>(value >> 24);
+	}
+}
+
+
+static SceneData CreateSceneData()
+{
+	SceneData scene;
+	scene.numBytes = 0;
+	for (uint32_t s = 0; s < NUM_SURFACES; s++)
+	{
+		std::vector<uint8_t> vertices, indices;
+		FillPattern(vertices, (32 + (s * 37) % 64) * KB, s * 2);
+		FillPattern(indices, (8 + (s * 13) % 16) * KB, s * 2 + 1);
+		scene.numBytes += vertices.size() + indices.size();
+		scene.buffers.push_back(std::move(vertices));
+		scene.buffers.push_back(std::move(indices));
+	}
+
+	std::vector<uint8_t> big;
+	FillPattern(big, BIG_BUFFER_BYTES, 0xB16);
+	scene.numBytes += big.size();
+	scene.buffers.push_back(std::move(big));
+
+	for (uint32_t t = 0; t < NUM_TEXTURES; t++)
+	{
+		std::vector<uint8_t> texels;
+		FillPattern(texels, TEXTURE_BYTES, 0x7E0 + t);
+		scene.numBytes += texels.size();
+		scene.textures.push_back(std::move(texels));
+	}
+	return scene;
+}
+
+
+static VkImageSubresourceRange ColorRange()
+{
+	VkImageSubresourceRange range = {};
+	range.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	range.levelCount = 1;
+	range.layerCount = 1;
+	return range;
+}
+
+
+static VkBufferImageCopy TextureRegion(VkDeviceSize bufferOffset)
+{
+	VkBufferImageCopy region = {};
+	region.bufferOffset = bufferOffset;
+	region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	region.imageSubresource.layerCount = 1;
+	region.imageExtent = { TEXTURE_SIZE, TEXTURE_SIZE, 1 };
+	return region;
+}
+
+
+static SceneResources CreateSceneResources(const VulkanTestDevice& testDevice, const SceneData& scene)
+{
+	SceneResources resources;
+	for (const auto& data : scene.buffers)
+	{
+		VkBufferCreateInfo bufferInfo = VkTools::Initializer::BufferCreateInfo(VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, data.size());
+		VkBuffer buffer = VK_NULL_HANDLE;
+		VulkanAllocation allocation;
+		TEST_CHECK(vkCreateBuffer(testDevice.device, &bufferInfo, nullptr, &buffer) == VK_SUCCESS);
+		TEST_CHECK(memoryAllocator->AllocateBuffer(buffer, HOST_MEMORY, allocation) == VK_SUCCESS);
+		if (allocation.pMapped)
+		{
+			memset(allocation.pMapped, 0, data.size());
+		}
+		resources.buffers.push_back(buffer);
+		resources.bufferAllocations.push_back(allocation);
+	}
+
+	for (size_t t = 0; t < scene.textures.size(); t++)
+	{
+		VkImageCreateInfo imageInfo = VkTools::Initializer::ImageCreateInfo();
+		imageInfo.imageType = VK_IMAGE_TYPE_2D;
+		imageInfo.format = VK_FORMAT_R8G8B8A8_UNORM;
+		imageInfo.extent = { TEXTURE_SIZE, TEXTURE_SIZE, 1 };
+		imageInfo.mipLevels = 1;
+		imageInfo.arrayLayers = 1;
+		imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+		imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+		imageInfo.usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+		imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+		VkImage image = VK_NULL_HANDLE;
+		VulkanAllocation allocation;
+		TEST_CHECK(vkCreateImage(testDevice.device, &imageInfo, nullptr, &image) == VK_SUCCESS);
+		TEST_CHECK(memoryAllocator->AllocateImage(image, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, VK_IMAGE_TILING_OPTIMAL, false, allocation) == VK_SUCCESS);
+		resources.images.push_back(image);
+		resources.imageAllocations.push_back(allocation);
+	}
+	return resources;
+}
+
+
+static void DestroySceneResources(const VulkanTestDevice& testDevice, SceneResources& resources)
+{
+	for (size_t i = 0; i < resources.buffers.size(); i++)
+	{
+		vkDestroyBuffer(testDevice.device, resources.buffers[i], nullptr);
+		memoryAllocator->Free(resources.bufferAllocations[i]);
+	}
+	for (size_t i = 0; i < resources.images.size(); i++)
+	{
+		vkDestroyImage(testDevice.device, resources.images[i], nullptr);
+		memoryAllocator->Free(resources.imageAllocations[i]);
+	}
+	resources = SceneResources();
+}
+
+
+//
+// SubmitPerResource
+//
+//	What VkBufferObject::SubmitBufferObjects and the texture loaders did before
+//	VulkanUploadManager: own staging memory, own command buffer, one submit and
+//	a vkQueueWaitIdle for every resource
+//
+template<typename RecordFunction>
+static void SubmitPerResource(const VulkanTestDevice& testDevice, VkCommandPool cmdPool, const std::vector<uint8_t>& data, RecordFunction record)
+{
+	VkPhysicalDeviceMemoryProperties memoryProperties;
+	vkGetPhysicalDeviceMemoryProperties(testDevice.physicalDevice, &memoryProperties);
+
+	VkBufferCreateInfo bufferInfo = VkTools::Initializer::BufferCreateInfo(VK_BUFFER_USAGE_TRANSFER_SRC_BIT, data.size());
+	VkBuffer stagingBuffer = VK_NULL_HANDLE;
+	VK_CHECK_RESULT(vkCreateBuffer(testDevice.device, &bufferInfo, nullptr, &stagingBuffer));
+
+	VkMemoryRequirements memReqs;
+	vkGetBufferMemoryRequirements(testDevice.device, stagingBuffer, &memReqs);
+	VkMemoryAllocateInfo memAlloc = VkTools::Initializer::MemoryAllocateInfo();
+	memAlloc.allocationSize = memReqs.size;
+	memAlloc.memoryTypeIndex = VkTools::GetMemoryType(memReqs.memoryTypeBits, HOST_MEMORY, memoryProperties);
+	VkDeviceMemory stagingMemory = VK_NULL_HANDLE;
+	VK_CHECK_RESULT(vkAllocateMemory(testDevice.device, &memAlloc, nullptr, &stagingMemory));
+	VK_CHECK_RESULT(vkBindBufferMemory(testDevice.device, stagingBuffer, stagingMemory, 0));
+
+	void* pMapped = nullptr;
+	VK_CHECK_RESULT(vkMapMemory(testDevice.device, stagingMemory, 0, memAlloc.allocationSize, 0, &pMapped));
+	memcpy(pMapped, data.data(), data.size());
+	vkUnmapMemory(testDevice.device, stagingMemory);
+
+	VkCommandBufferAllocateInfo cmdBufAllocateInfo = VkTools::Initializer::CommandBufferAllocateInfo(cmdPool, VK_COMMAND_BUFFER_LEVEL_PRIMARY, 1);
+	VkCommandBuffer copyCmd = VK_NULL_HANDLE;
+	VK_CHECK_RESULT(vkAllocateCommandBuffers(testDevice.device, &cmdBufAllocateInfo, &copyCmd));
+	VkCommandBufferBeginInfo cmdBufInfo = VkTools::Initializer::CommandBufferBeginInfo();
+	VK_CHECK_RESULT(vkBeginCommandBuffer(copyCmd, &cmdBufInfo));
+	record(copyCmd, stagingBuffer);
+	VK_CHECK_RESULT(vkEndCommandBuffer(copyCmd));
+
+	VkSubmitInfo submitInfo = VkTools::Initializer::SubmitInfo();
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &copyCmd;
+	VK_CHECK_RESULT(vkQueueSubmit(testDevice.queue, 1, &submitInfo, VK_NULL_HANDLE));
+	VK_CHECK_RESULT(vkQueueWaitIdle(testDevice.queue));
+	vkFreeCommandBuffers(testDevice.device, cmdPool, 1, &copyCmd);
+
+	vkDestroyBuffer(testDevice.device, stagingBuffer, nullptr);
+	vkFreeMemory(testDevice.device, stagingMemory, nullptr);
+}
+
+
+static double LoadPerResource(const VulkanTestDevice& testDevice, VkCommandPool cmdPool, const SceneData& scene, const SceneResources& resources)
+{
+	auto tStart = std::chrono::high_resolution_clock::now();
+	for (size_t i = 0; i < scene.buffers.size(); i++)
+	{
+		const VkBuffer dstBuffer = resources.buffers[i];
+		const VkDeviceSize size = scene.buffers[i].size();
+		SubmitPerResource(testDevice, cmdPool, scene.buffers[i], [dstBuffer, size](VkCommandBuffer copyCmd, VkBuffer stagingBuffer)
+		{
+			VkBufferCopy copyRegion = {};
+			copyRegion.size = size;
+			vkCmdCopyBuffer(copyCmd, stagingBuffer, dstBuffer, 1, &copyRegion);
+		});
+	}
+
+	for (size_t t = 0; t < scene.textures.size(); t++)
+	{
+		const VkImage image = resources.images[t];
+		SubmitPerResource(testDevice, cmdPool, scene.textures[t], [image](VkCommandBuffer copyCmd, VkBuffer stagingBuffer)
+		{
+			const VkBufferImageCopy region = TextureRegion(0);
+			VkTools::SetImageLayout(copyCmd, image, VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, ColorRange());
+			vkCmdCopyBufferToImage(copyCmd, stagingBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+			VkTools::SetImageLayout(copyCmd, image, VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, ColorRange());
+		});
+	}
+	return TestElapsedMs(tStart);
+}
+
+
+static double LoadBatched(const SceneData& scene, const SceneResources& resources)
+{
+	auto tStart = std::chrono::high_resolution_clock::now();
+	for (size_t i = 0; i < scene.buffers.size(); i++)
+	{
+		TEST_CHECK(uploadManager->UploadBuffer(resources.buffers[i], 0, scene.buffers[i].data(), scene.buffers[i].size()) == VK_SUCCESS);
+	}
+
+	const VkBufferImageCopy region = TextureRegion(0);
+	for (size_t t = 0; t < scene.textures.size(); t++)
+	{
+		TEST_CHECK(uploadManager->UploadImage(resources.images[t], ColorRange(), scene.textures[t].data(), scene.textures[t].size(), &region, 1, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL) == VK_SUCCESS);
+	}
+	uploadManager->WaitIdle();
+	return TestElapsedMs(tStart);
+}
+
+
+//
+// CountWrongResources
+//
+//	Compares every destination with its source data. Images are copied back
+//	into one host visible buffer first
+//
+static uint32_t CountWrongResources(const VulkanTestDevice& testDevice, VkCommandPool cmdPool, const SceneData& scene, const SceneResources& resources)
+{
+	uint32_t numWrong = 0;
+	for (size_t i = 0; i < scene.buffers.size(); i++)
+	{
+		const void* pMapped = resources.bufferAllocations[i].pMapped;
+		numWrong += !pMapped || memcmp(pMapped, scene.buffers[i].data(), scene.buffers[i].size()) != 0 ? 1 : 0;
+	}
+
+	VkBufferCreateInfo bufferInfo = VkTools::Initializer::BufferCreateInfo(VK_BUFFER_USAGE_TRANSFER_DST_BIT, TEXTURE_BYTES * scene.textures.size());
+	VkBuffer readbackBuffer = VK_NULL_HANDLE;
+	VulkanAllocation readbackAllocation;
+	VK_CHECK_RESULT(vkCreateBuffer(testDevice.device, &bufferInfo, nullptr, &readbackBuffer));
+	VK_CHECK_RESULT(memoryAllocator->AllocateBuffer(readbackBuffer, HOST_MEMORY, readbackAllocation));
+
+	VkCommandBufferAllocateInfo cmdBufAllocateInfo = VkTools::Initializer::CommandBufferAllocateInfo(cmdPool, VK_COMMAND_BUFFER_LEVEL_PRIMARY, 1);
+	VkCommandBuffer readbackCmd = VK_NULL_HANDLE;
+	VK_CHECK_RESULT(vkAllocateCommandBuffers(testDevice.device, &cmdBufAllocateInfo, &readbackCmd));
+	VkCommandBufferBeginInfo cmdBufInfo = VkTools::Initializer::CommandBufferBeginInfo();
+	VK_CHECK_RESULT(vkBeginCommandBuffer(readbackCmd, &cmdBufInfo));
+
+	for (size_t t = 0; t < scene.textures.size(); t++)
+	{
+		VkImageMemoryBarrier barrier = VkTools::Initializer::ImageMemoryBarrier();
+		barrier.srcAccessMask = VK_ACCESS_MEMORY_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+		barrier.oldLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+		barrier.image = resources.images[t];
+		barrier.subresourceRange = ColorRange();
+		vkCmdPipelineBarrier(readbackCmd, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+		const VkBufferImageCopy region = TextureRegion(t * TEXTURE_BYTES);
+		vkCmdCopyImageToBuffer(readbackCmd, resources.images[t], VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, readbackBuffer, 1, &region);
+	}
+
+	VkBufferMemoryBarrier hostBarrier = {};
+	hostBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+	hostBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	hostBarrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+	hostBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	hostBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	hostBarrier.buffer = readbackBuffer;
+	hostBarrier.size = VK_WHOLE_SIZE;
+	vkCmdPipelineBarrier(readbackCmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 0, nullptr, 1, &hostBarrier, 0, nullptr);
+	VK_CHECK_RESULT(vkEndCommandBuffer(readbackCmd));
+
+	VkSubmitInfo submitInfo = VkTools::Initializer::SubmitInfo();
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &readbackCmd;
+	VK_CHECK_RESULT(vkQueueSubmit(testDevice.queue, 1, &submitInfo, VK_NULL_HANDLE));
+	VK_CHECK_RESULT(vkQueueWaitIdle(testDevice.queue));
+	vkFreeCommandBuffers(testDevice.device, cmdPool, 1, &readbackCmd);
+
+	const uint8_t* pTexels = static_cast<const uint8_t*>(readbackAllocation.pMapped);
+	for (size_t t = 0; t < scene.textures.size(); t++)
+	{
+		numWrong += !pTexels || memcmp(pTexels + t * TEXTURE_BYTES, scene.textures[t].data(), static_cast<size_t>(TEXTURE_BYTES)) != 0 ? 1 : 0;
+	}
+
+	vkDestroyBuffer(testDevice.device, readbackBuffer, nullptr);
+	memoryAllocator->Free(readbackAllocation);
+	return numWrong;
+}
+
+
+int main()
+{
+	VulkanTestDevice testDevice;
+	if (!CreateVulkanTestDevice(testDevice, "UploadManagerTest"))
+		return TEST_SKIPPED;
+
+	memoryAllocator = TYW_NEW VulkanMemoryAllocator(testDevice.physicalDevice, testDevice.device);
+	uploadManager = TYW_NEW VulkanUploadManager(testDevice.device, testDevice.queue, testDevice.graphicsFamily, testDevice.transferQueue, testDevice.transferFamily, RING_SIZE);
+
+	VkCommandPoolCreateInfo cmdPoolInfo = {};
+	cmdPoolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	cmdPoolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+	cmdPoolInfo.queueFamilyIndex = testDevice.graphicsFamily;
+	VkCommandPool cmdPool = VK_NULL_HANDLE;
+	VK_CHECK_RESULT(vkCreateCommandPool(testDevice.device, &cmdPoolInfo, nullptr, &cmdPool));
+
+	const SceneData scene = CreateSceneData();
+	const uint32_t numResources = static_cast<uint32_t>(scene.buffers.size() + scene.textures.size());
+
+	//Before: one submit and queue wait per resource
+	SceneResources resources = CreateSceneResources(testDevice, scene);
+	const double perResourceMs = LoadPerResource(testDevice, cmdPool, scene, resources);
+	const uint32_t numWrongPerResource = CountWrongResources(testDevice, cmdPool, scene, resources);
+	DestroySceneResources(testDevice, resources);
+
+	//After: same data through the staging ring, submitted in batches
+	resources = CreateSceneResources(testDevice, scene);
+	const double batchedMs = LoadBatched(scene, resources);
+	const uint32_t numWrongBatched = CountWrongResources(testDevice, cmdPool, scene, resources);
+	DestroySceneResources(testDevice, resources);
+
+	uploadManager->Update();
+	const VulkanUploadStats stats = uploadManager->GetStats();
+
+	TEST_CHECK(numWrongPerResource == 0);
+	TEST_CHECK(numWrongBatched == 0);
+	TEST_CHECK(stats.numBufferCopies == scene.buffers.size());
+	TEST_CHECK(stats.numImageCopies == scene.textures.size());
+	TEST_CHECK(stats.uploadedBytes == scene.numBytes);
+	TEST_CHECK(stats.numBatches > 0 && stats.numBatches < numResources);
+
+	//Scene is bigger than the ring, it must have been reused after its fences signaled
+	TEST_CHECK(stats.numStalls > 0);
+	TEST_CHECK(stats.numInFlight == 0 && stats.ringUsed == 0);
+
+	printf("%u resources, %.2f MB: per resource submit %.2f ms, batched %.2f ms (%.2fx), %llu batches, %llu ring stalls, %s, %u wrong before, %u wrong after\n",
+		numResources, scene.numBytes / static_cast<double>(MB), perResourceMs, batchedMs, perResourceMs / std::max(batchedMs, 0.001),
+		static_cast<unsigned long long>(stats.numBatches), static_cast<unsigned long long>(stats.numStalls),
+		stats.bDedicatedTransferQueue ? "transfer queue" : "graphics queue", numWrongPerResource, numWrongBatched);
+
+	vkDestroyCommandPool(testDevice.device, cmdPool, nullptr);
+	SAFE_DELETE(uploadManager);
+	SAFE_DELETE(memoryAllocator);
+
+	DestroyVulkanTestDevice(testDevice);
+	return TEST_RESULT();
+}
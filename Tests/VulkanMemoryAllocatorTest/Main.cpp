@@ -0,0 +1,252 @@
+/*
+*	Copyright 2015-2016 Tomas Mikalauskas. All rights reserved.
+*	GitHub repository - https://github.com/TywyllSoftware/TywRenderer
+*	This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+#include <RendererPch/stdafx.h>
+
+//Vulkan Includes
+#include <Renderer/Vulkan/VulkanMemoryAllocator.h>
+
+//Test Includes
+#include <Tests/TestCommon.h>
+#include <Tests/VulkanTestCommon.h>
+
+
+static const VkDeviceSize TEST_ALIGNMENT = 256;
+static const VkDeviceSize KB = 1024;
+
+static const VkMemoryPropertyFlags HOST_MEMORY = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+
+
+static VkMemoryRequirements MakeRequirements(const VulkanTestDevice& testDevice, VkDeviceSize size, VkDeviceSize alignment = TEST_ALIGNMENT)
+{
+	VkPhysicalDeviceMemoryProperties memoryProperties;
+	vkGetPhysicalDeviceMemoryProperties(testDevice.physicalDevice, &memoryProperties);
+
+	VkMemoryRequirements memReqs;
+	memReqs.size = size;
+	memReqs.alignment = alignment;
+	memReqs.memoryTypeBits = (1u << memoryProperties.memoryTypeCount) - 1;
+	return memReqs;
+}
+
+
+//
+// TestSplitAndMerge
+//
+//	Ranges are split off the front of the free block and merged back with
+//	both neighbours when freed, until the block is one free range again
+//
+static void TestSplitAndMerge(const VulkanTestDevice& testDevice)
+{
+	VulkanMemoryAllocator allocator(testDevice.physicalDevice, testDevice.device);
+
+	VulkanAllocation a, b, c;
+	TEST_CHECK(allocator.Allocate(MakeRequirements(testDevice, 64 * KB), HOST_MEMORY, RESOURCE_TILING_LINEAR, false, a) == VK_SUCCESS);
+	TEST_CHECK(allocator.Allocate(MakeRequirements(testDevice, 64 * KB), HOST_MEMORY, RESOURCE_TILING_LINEAR, false, b) == VK_SUCCESS);
+	TEST_CHECK(allocator.Allocate(MakeRequirements(testDevice, 64 * KB), HOST_MEMORY, RESOURCE_TILING_LINEAR, false, c) == VK_SUCCESS);
+
+	//Split: one block, ranges one after another
+	TEST_CHECK(a.memory == b.memory && b.memory == c.memory);
+	TEST_CHECK(a.block != VULKAN_DEDICATED_BLOCK && a.block == b.block && b.block == c.block);
+	TEST_CHECK(a.offset == 0 && b.offset == 64 * KB && c.offset == 128 * KB);
+
+	VulkanMemoryStats stats = allocator.GetStats();
+	const VkDeviceSize blockBytes = stats.blockBytes;
+	TEST_CHECK(stats.numBlocks == 1 && stats.numDeviceAllocations == 1 && stats.numAllocations == 3);
+	TEST_CHECK(stats.usedBytes == 192 * KB);
+	TEST_CHECK(stats.freeBytes == blockBytes - 192 * KB);
+	TEST_CHECK(stats.fragmentation == 0.0f);
+
+	//Persistently mapped ranges must not overlap
+	TEST_CHECK(a.pMapped && b.pMapped && c.pMapped);
+	if (a.pMapped && b.pMapped && c.pMapped)
+	{
+		memset(a.pMapped, 0xAA, static_cast<size_t>(a.size));
+		memset(b.pMapped, 0xBB, static_cast<size_t>(b.size));
+		memset(c.pMapped, 0xCC, static_cast<size_t>(c.size));
+		const uint8_t* pA = static_cast<const uint8_t*>(a.pMapped);
+		const uint8_t* pC = static_cast<const uint8_t*>(c.pMapped);
+		TEST_CHECK(pA[0] == 0xAA && pA[a.size - 1] == 0xAA && pC[0] == 0xCC && pC[c.size - 1] == 0xCC);
+	}
+
+	//Hole in the middle is a second free range
+	allocator.Free(b);
+	TEST_CHECK(!b.IsValid());
+	stats = allocator.GetStats();
+	TEST_CHECK(stats.freeBytes == blockBytes - 128 * KB);
+	TEST_CHECK(stats.largestFreeRange == blockBytes - 192 * KB);
+	TEST_CHECK(stats.fragmentation > 0.0f);
+
+	//Merged with the hole behind it. 96K only fits at offset 0 if both 64K ranges became one
+	allocator.Free(a);
+	VulkanAllocation merged;
+	TEST_CHECK(allocator.Allocate(MakeRequirements(testDevice, 96 * KB), HOST_MEMORY, RESOURCE_TILING_LINEAR, false, merged) == VK_SUCCESS);
+	TEST_CHECK(merged.memory == c.memory && merged.offset == 0);
+
+	//Everything merges back into one range, the last empty block is kept
+	allocator.Free(merged);
+	allocator.Free(c);
+	stats = allocator.GetStats();
+	TEST_CHECK(stats.numBlocks == 1 && stats.numAllocations == 0 && stats.usedBytes == 0);
+	TEST_CHECK(stats.freeBytes == blockBytes && stats.largestFreeRange == blockBytes);
+	TEST_CHECK(stats.fragmentation == 0.0f);
+
+	//Alignment is honoured when the free range starts unaligned
+	VulkanAllocation small, aligned;
+	TEST_CHECK(allocator.Allocate(MakeRequirements(testDevice, 1000, 16), HOST_MEMORY, RESOURCE_TILING_LINEAR, false, small) == VK_SUCCESS);
+	TEST_CHECK(allocator.Allocate(MakeRequirements(testDevice, 4 * KB, 4 * KB), HOST_MEMORY, RESOURCE_TILING_LINEAR, false, aligned) == VK_SUCCESS);
+	TEST_CHECK(aligned.offset % (4 * KB) == 0 && aligned.offset >= small.offset + small.size);
+	allocator.Free(small);
+	allocator.Free(aligned);
+	TEST_CHECK(allocator.GetStats().largestFreeRange == blockBytes);
+
+	printf("Split and merge: block %llu KB, 0 bytes lost after merging\n", static_cast<unsigned long long>(blockBytes / KB));
+}
+
+
+//
+// TestGranularityPools
+//
+//	Linear and optimal resources of the same memory type get separate blocks
+//	when bufferImageGranularity > 1 and share blocks otherwise
+//
+static void TestGranularityPools(const VulkanTestDevice& testDevice)
+{
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(testDevice.physicalDevice, &properties);
+	const VkDeviceSize granularity = properties.limits.bufferImageGranularity;
+
+	VulkanMemoryAllocator allocator(testDevice.physicalDevice, testDevice.device);
+
+	VulkanAllocation linear, optimal;
+	TEST_CHECK(allocator.Allocate(MakeRequirements(testDevice, 16 * KB), 0, RESOURCE_TILING_LINEAR, false, linear) == VK_SUCCESS);
+	TEST_CHECK(allocator.Allocate(MakeRequirements(testDevice, 16 * KB), 0, RESOURCE_TILING_OPTIMAL, false, optimal) == VK_SUCCESS);
+
+	if (granularity > 1)
+	{
+		TEST_CHECK(linear.pool != optimal.pool);
+		TEST_CHECK(linear.memory != optimal.memory);
+		TEST_CHECK(allocator.GetStats().numBlocks == 2);
+	}
+	else
+	{
+		TEST_CHECK(linear.pool == optimal.pool);
+		TEST_CHECK(linear.memory == optimal.memory);
+		TEST_CHECK(allocator.GetStats().numBlocks == 1);
+	}
+	allocator.Free(linear);
+	allocator.Free(optimal);
+
+	//Same with real resources and the requirements the driver reports
+	VkBufferCreateInfo bufferInfo = {};
+	bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	bufferInfo.size = 64 * KB;
+	bufferInfo.usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+	bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+	VkImageCreateInfo imageInfo = {};
+	imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+	imageInfo.imageType = VK_IMAGE_TYPE_2D;
+	imageInfo.format = VK_FORMAT_R8G8B8A8_UNORM;
+	imageInfo.extent = { 256, 256, 1 };
+	imageInfo.mipLevels = 1;
+	imageInfo.arrayLayers = 1;
+	imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+	imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+	imageInfo.usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+	imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+	VkBuffer buffer = VK_NULL_HANDLE;
+	VkImage image = VK_NULL_HANDLE;
+	TEST_CHECK(vkCreateBuffer(testDevice.device, &bufferInfo, nullptr, &buffer) == VK_SUCCESS);
+	TEST_CHECK(vkCreateImage(testDevice.device, &imageInfo, nullptr, &image) == VK_SUCCESS);
+
+	VulkanAllocation bufferAllocation, imageAllocation;
+	TEST_CHECK(allocator.AllocateBuffer(buffer, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, bufferAllocation) == VK_SUCCESS);
+	TEST_CHECK(allocator.AllocateImage(image, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, VK_IMAGE_TILING_OPTIMAL, false, imageAllocation) == VK_SUCCESS);
+
+	VkMemoryRequirements imageReqs;
+	vkGetImageMemoryRequirements(testDevice.device, image, &imageReqs);
+	TEST_CHECK(imageAllocation.offset % imageReqs.alignment == 0);
+	if (granularity > 1 && bufferAllocation.pool / RESOURCE_TILING_COUNT == imageAllocation.pool / RESOURCE_TILING_COUNT)
+	{
+		TEST_CHECK(bufferAllocation.memory != imageAllocation.memory);
+	}
+
+	vkDestroyImage(testDevice.device, image, nullptr);
+	vkDestroyBuffer(testDevice.device, buffer, nullptr);
+	allocator.Free(imageAllocation);
+	allocator.Free(bufferAllocation);
+
+	printf("Granularity %llu: linear and optimal resources %s blocks\n", static_cast<unsigned long long>(granularity), granularity > 1 ? "use separate" : "share");
+}
+
+
+//
+// TestDedicatedThreshold
+//
+//	Up to half a block is sub-allocated, anything bigger or asked for gets
+//	its own VkDeviceMemory
+//
+static void TestDedicatedThreshold(const VulkanTestDevice& testDevice)
+{
+	VulkanMemoryAllocator allocator(testDevice.physicalDevice, testDevice.device);
+
+	VulkanAllocation first;
+	TEST_CHECK(allocator.Allocate(MakeRequirements(testDevice, 4 * KB), HOST_MEMORY, RESOURCE_TILING_LINEAR, false, first) == VK_SUCCESS);
+	const uint32_t memoryType = first.pool / RESOURCE_TILING_COUNT;
+	const VkDeviceSize blockSize = allocator.GetBlockSize(memoryType);
+	allocator.Free(first);
+
+	VulkanAllocation half, overHalf, asked;
+	TEST_CHECK(allocator.Allocate(MakeRequirements(testDevice, blockSize / 2), HOST_MEMORY, RESOURCE_TILING_LINEAR, false, half) == VK_SUCCESS);
+	TEST_CHECK(allocator.Allocate(MakeRequirements(testDevice, blockSize / 2 + TEST_ALIGNMENT), HOST_MEMORY, RESOURCE_TILING_LINEAR, false, overHalf) == VK_SUCCESS);
+	TEST_CHECK(allocator.Allocate(MakeRequirements(testDevice, 4 * KB), HOST_MEMORY, RESOURCE_TILING_LINEAR, true, asked) == VK_SUCCESS);
+
+	TEST_CHECK(half.block != VULKAN_DEDICATED_BLOCK);
+	TEST_CHECK(overHalf.block == VULKAN_DEDICATED_BLOCK && overHalf.offset == 0);
+	TEST_CHECK(asked.block == VULKAN_DEDICATED_BLOCK && asked.offset == 0);
+	TEST_CHECK(overHalf.memory != half.memory && asked.memory != half.memory && asked.memory != overHalf.memory);
+
+	VulkanMemoryStats stats = allocator.GetStats();
+	TEST_CHECK(stats.numBlocks == 1 && stats.numDedicated == 2);
+	TEST_CHECK(stats.numDeviceAllocations == 3);
+	TEST_CHECK(stats.dedicatedBytes == blockSize / 2 + TEST_ALIGNMENT + 4 * KB);
+
+	VkDeviceSize heapUsage = 0;
+	for (uint32_t i = 0; i < stats.numHeaps; i++)
+	{
+		heapUsage += stats.heaps[i].usage;
+		TEST_CHECK(stats.heaps[i].budget <= stats.heaps[i].size);
+	}
+	TEST_CHECK(heapUsage == stats.blockBytes + stats.dedicatedBytes);
+
+	//Dedicated memory goes straight back to the driver
+	allocator.Free(overHalf);
+	allocator.Free(asked);
+	stats = allocator.GetStats();
+	TEST_CHECK(stats.numDedicated == 0 && stats.dedicatedBytes == 0 && stats.numDeviceAllocations == 1);
+
+	allocator.Free(half);
+	printf("Dedicated threshold: block %llu KB, %llu KB sub-allocated, %llu KB dedicated\n",
+		static_cast<unsigned long long>(blockSize / KB), static_cast<unsigned long long>(blockSize / 2 / KB),
+		static_cast<unsigned long long>((blockSize / 2 + TEST_ALIGNMENT) / KB));
+}
+
+
+int main()
+{
+	VulkanTestDevice testDevice;
+	if (!CreateVulkanTestDevice(testDevice, "VulkanMemoryAllocatorTest"))
+		return TEST_SKIPPED;
+
+	TestSplitAndMerge(testDevice);
+	TestGranularityPools(testDevice);
+	TestDedicatedThreshold(testDevice);
+
+	DestroyVulkanTestDevice(testDevice);
+	return TEST_RESULT();
+}
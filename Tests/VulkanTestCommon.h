@@ -0,0 +1,138 @@
+/*
+*	Copyright 2015-2016 Tomas Mikalauskas. All rights reserved.
+*	GitHub repository - https://github.com/TywyllSoftware/TywRenderer
+*	This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+#pragma once
+#include <External/vulkan/vulkan.h>
+
+
+//Exit code of tests that found no Vulkan device. CTest reports them as skipped (SKIP_RETURN_CODE)
+static const int TEST_SKIPPED = 77;
+
+
+/*
+	Instance and device without window system. Runs on any ICD, a software
+	driver like lavapipe is enough.
+*/
+struct VulkanTestDevice
+{
+	VkInstance			instance;
+	VkPhysicalDevice	physicalDevice;
+	VkDevice			device;
+	VkQueue				queue;
+	uint32_t			graphicsFamily;
+	VkQueue				transferQueue;		// same as queue when there is no transfer only family
+	uint32_t			transferFamily;
+};
+
+
+/*
+	@param: VulkanTestDevice& testDevice
+	@param: const char* pName - application name
+	@return: false if there is no Vulkan device with a graphics queue
+*/
+inline bool CreateVulkanTestDevice(VulkanTestDevice& testDevice, const char* pName)
+{
+	memset(&testDevice, 0, sizeof(testDevice));
+
+	VkApplicationInfo appInfo = {};
+	appInfo.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
+	appInfo.pApplicationName = pName;
+	appInfo.pEngineName = "TywRenderer";
+	appInfo.apiVersion = VK_API_VERSION_1_0;
+
+	VkInstanceCreateInfo instanceInfo = {};
+	instanceInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+	instanceInfo.pApplicationInfo = &appInfo;
+	if (vkCreateInstance(&instanceInfo, nullptr, &testDevice.instance) != VK_SUCCESS)
+	{
+		printf("%s: no Vulkan instance, skipped\n", pName);
+		return false;
+	}
+
+	uint32_t numDevices = 0;
+	vkEnumeratePhysicalDevices(testDevice.instance, &numDevices, nullptr);
+	std::vector<VkPhysicalDevice> physicalDevices(numDevices);
+	if (numDevices)
+	{
+		vkEnumeratePhysicalDevices(testDevice.instance, &numDevices, physicalDevices.data());
+	}
+
+	for (VkPhysicalDevice physicalDevice : physicalDevices)
+	{
+		uint32_t numFamilies = 0;
+		vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &numFamilies, nullptr);
+		std::vector<VkQueueFamilyProperties> families(numFamilies);
+		vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &numFamilies, families.data());
+
+		uint32_t graphicsFamily = UINT32_MAX;
+		uint32_t transferFamily = UINT32_MAX;
+		for (uint32_t i = 0; i < numFamilies; i++)
+		{
+			const VkQueueFlags flags = families[i].queueFlags;
+			if ((flags & VK_QUEUE_GRAPHICS_BIT) && graphicsFamily == UINT32_MAX)
+			{
+				graphicsFamily = i;
+			}
+			else if ((flags & VK_QUEUE_TRANSFER_BIT) && !(flags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT)) && transferFamily == UINT32_MAX)
+			{
+				transferFamily = i;
+			}
+		}
+		if (graphicsFamily == UINT32_MAX)
+			continue;
+		if (transferFamily == UINT32_MAX)
+		{
+			transferFamily = graphicsFamily;
+		}
+
+		const float priority = 1.0f;
+		VkDeviceQueueCreateInfo queueInfos[2] = {};
+		for (uint32_t i = 0; i < 2; i++)
+		{
+			queueInfos[i].sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+			queueInfos[i].queueFamilyIndex = i == 0 ? graphicsFamily : transferFamily;
+			queueInfos[i].queueCount = 1;
+			queueInfos[i].pQueuePriorities = &priority;
+		}
+
+		VkDeviceCreateInfo deviceInfo = {};
+		deviceInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+		deviceInfo.queueCreateInfoCount = transferFamily != graphicsFamily ? 2 : 1;
+		deviceInfo.pQueueCreateInfos = queueInfos;
+		if (vkCreateDevice(physicalDevice, &deviceInfo, nullptr, &testDevice.device) != VK_SUCCESS)
+			continue;
+
+		testDevice.physicalDevice = physicalDevice;
+		testDevice.graphicsFamily = graphicsFamily;
+		testDevice.transferFamily = transferFamily;
+		vkGetDeviceQueue(testDevice.device, graphicsFamily, 0, &testDevice.queue);
+		vkGetDeviceQueue(testDevice.device, transferFamily, 0, &testDevice.transferQueue);
+
+		VkPhysicalDeviceProperties properties;
+		vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+		printf("%s: running on %s\n", pName, properties.deviceName);
+		return true;
+	}
+
+	printf("%s: no Vulkan device with a graphics queue, skipped\n", pName);
+	vkDestroyInstance(testDevice.instance, nullptr);
+	testDevice.instance = VK_NULL_HANDLE;
+	return false;
+}
+
+
+inline void DestroyVulkanTestDevice(VulkanTestDevice& testDevice)
+{
+	if (testDevice.device)
+	{
+		vkDeviceWaitIdle(testDevice.device);
+		vkDestroyDevice(testDevice.device, nullptr);
+	}
+	if (testDevice.instance)
+	{
+		vkDestroyInstance(testDevice.instance, nullptr);
+	}
+	memset(&testDevice, 0, sizeof(testDevice));
+}